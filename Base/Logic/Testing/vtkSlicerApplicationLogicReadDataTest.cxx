@@ -0,0 +1,275 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+// Slicer includes
+#include "vtkSlicerApplicationLogic.h"
+
+// MRML includes
+#include <vtkCacheManager.h>
+#include <vtkMRMLScalarVolumeNode.h>
+#include <vtkMRMLScene.h>
+
+// VTK includes
+#include <vtkCallbackCommand.h>
+#include <vtkImageData.h>
+#include <vtkNew.h>
+#include <vtkTimerLog.h>
+
+// ITKSYS includes
+#include <itksys/SystemTools.hxx>
+
+// STD includes
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <vector>
+
+namespace
+{
+
+const int VolumeCount = 4;
+
+//---------------------------------------------------------------------------
+struct RequestSpy
+{
+  std::vector<int> Processed;
+  std::vector<int> Progressed;
+};
+
+//---------------------------------------------------------------------------
+void onRequestEvent(vtkObject* vtkNotUsed(caller), unsigned long eid,
+                    void* clientData, void* callData)
+{
+  RequestSpy* spy = reinterpret_cast<RequestSpy*>(clientData);
+  int uid = static_cast<int>(reinterpret_cast<long>(callData));
+  if (eid == vtkSlicerApplicationLogic::RequestProcessedEvent)
+    {
+    spy->Processed.push_back(uid);
+    }
+  else
+    {
+    spy->Progressed.push_back(uid);
+    }
+}
+
+//---------------------------------------------------------------------------
+std::string writeVolume(int index)
+{
+  std::stringstream fileName;
+  fileName << "vtkSlicerApplicationLogicReadDataTest" << index << ".nrrd";
+  const int size = 32;
+  std::ofstream file(fileName.str().c_str(), std::ios::out | std::ios::binary);
+  file << "NRRD0004\n"
+       << "type: unsigned char\n"
+       << "dimension: 3\n"
+       << "sizes: " << size << " " << size << " " << size << "\n"
+       << "encoding: raw\n"
+       << "\n";
+  std::vector<char> voxels(size * size * size, static_cast<char>(index));
+  file.write(&voxels[0], voxels.size());
+  return fileName.str();
+}
+
+//---------------------------------------------------------------------------
+bool checkOrder(const std::vector<int>& processed,
+                const int expected[VolumeCount], int line)
+{
+  if (processed.size() != VolumeCount ||
+      !std::equal(processed.begin(), processed.end(), expected))
+    {
+    std::cerr << "Line " << line << ": requests processed in the wrong order:";
+    for (size_t i = 0; i < processed.size(); ++i)
+      {
+      std::cerr << " " << processed[i];
+      }
+    std::cerr << " instead of";
+    for (int i = 0; i < VolumeCount; ++i)
+      {
+      std::cerr << " " << expected[i];
+      }
+    std::cerr << std::endl;
+    return false;
+    }
+  return true;
+}
+
+} // end of anonymous namespace
+
+//---------------------------------------------------------------------------
+int vtkSlicerApplicationLogicReadDataTest(int , char * [])
+{
+  std::vector<std::string> fileNames;
+  for (int i = 0; i < VolumeCount; ++i)
+    {
+    fileNames.push_back(writeVolume(i));
+    }
+
+  //---------------------------------------------------------------------------
+  // Without read threads, the requests are processed by priority and the
+  // cancelled request is reported without being read.
+  //---------------------------------------------------------------------------
+  {
+  vtkNew<vtkMRMLScene> scene;
+  vtkNew<vtkCacheManager> cacheManager;
+  scene->SetCacheManager(cacheManager.GetPointer());
+  vtkNew<vtkSlicerApplicationLogic> appLogic;
+  appLogic->SetMRMLScene(scene.GetPointer());
+  appLogic->SetNumberOfReadDataThreads(0);
+  appLogic->CreateProcessingThread();
+
+  RequestSpy spy;
+  vtkNew<vtkCallbackCommand> callback;
+  callback->SetCallback(onRequestEvent);
+  callback->SetClientData(&spy);
+  appLogic->AddObserver(vtkSlicerApplicationLogic::RequestProcessedEvent,
+                        callback.GetPointer());
+
+  std::vector<vtkMRMLScalarVolumeNode*> volumeNodes;
+  std::vector<int> uids;
+  for (int i = 0; i < VolumeCount; ++i)
+    {
+    vtkNew<vtkMRMLScalarVolumeNode> volumeNode;
+    scene->AddNode(volumeNode.GetPointer());
+    volumeNodes.push_back(volumeNode.GetPointer());
+    uids.push_back(appLogic->RequestReadData(
+      volumeNode->GetID(), fileNames[i].c_str(), 0, 0, i == 2 ? 5 : 0));
+    if (uids.back() == 0)
+      {
+      std::cerr << "Line " << __LINE__ << ": RequestReadData failed"
+                << std::endl;
+      return EXIT_FAILURE;
+      }
+    }
+  if (!appLogic->SetRequestPriority(uids[3], 10) ||
+      !appLogic->CancelRequest(uids[1]) ||
+      appLogic->CancelRequest(uids[1]) ||
+      appLogic->SetRequestPriority(uids[1], 20) ||
+      appLogic->GetReadDataQueueSize() != VolumeCount)
+    {
+    std::cerr << "Line " << __LINE__ << ": failed to change the requests"
+              << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  appLogic->ProcessReadData();
+  // the requests are all ready now, they can't be reordered anymore
+  if (spy.Processed.size() != 1 ||
+      appLogic->SetRequestPriority(uids[0], 30))
+    {
+    std::cerr << "Line " << __LINE__ << ": a ready request was reordered"
+              << std::endl;
+    return EXIT_FAILURE;
+    }
+  for (int i = 1; i < VolumeCount; ++i)
+    {
+    appLogic->ProcessReadData();
+    }
+  const int expectedOrder[VolumeCount] = {uids[3], uids[2], uids[0], uids[1]};
+  if (!checkOrder(spy.Processed, expectedOrder, __LINE__))
+    {
+    return EXIT_FAILURE;
+    }
+  for (int i = 0; i < VolumeCount; ++i)
+    {
+    bool read = (volumeNodes[i]->GetImageData() != 0);
+    if (read == (i == 1) || appLogic->GetRequestProgress(uids[i]) != -1.)
+      {
+      std::cerr << "Line " << __LINE__ << ": request " << i << " is "
+                << (read ? "" : "not ") << "read" << std::endl;
+      return EXIT_FAILURE;
+      }
+    }
+  appLogic->TerminateProcessingThread();
+  }
+
+  //---------------------------------------------------------------------------
+  // The read threads decode the volumes and their progress is reported in
+  // the main thread.
+  //---------------------------------------------------------------------------
+  {
+  vtkNew<vtkMRMLScene> scene;
+  vtkNew<vtkCacheManager> cacheManager;
+  scene->SetCacheManager(cacheManager.GetPointer());
+  vtkNew<vtkSlicerApplicationLogic> appLogic;
+  appLogic->SetMRMLScene(scene.GetPointer());
+  appLogic->SetNumberOfReadDataThreads(2);
+  appLogic->CreateProcessingThread();
+
+  RequestSpy spy;
+  vtkNew<vtkCallbackCommand> callback;
+  callback->SetCallback(onRequestEvent);
+  callback->SetClientData(&spy);
+  appLogic->AddObserver(vtkSlicerApplicationLogic::RequestProcessedEvent,
+                        callback.GetPointer());
+  appLogic->AddObserver(vtkSlicerApplicationLogic::RequestProgressEvent,
+                        callback.GetPointer());
+
+  std::vector<vtkMRMLScalarVolumeNode*> volumeNodes;
+  std::vector<int> uids;
+  for (int i = 0; i < VolumeCount; ++i)
+    {
+    vtkNew<vtkMRMLScalarVolumeNode> volumeNode;
+    scene->AddNode(volumeNode.GetPointer());
+    volumeNodes.push_back(volumeNode.GetPointer());
+    uids.push_back(appLogic->RequestReadData(
+      volumeNode->GetID(), fileNames[i].c_str()));
+    }
+  appLogic->CancelRequest(uids[2]);
+
+  double startTime = vtkTimerLog::GetUniversalTime();
+  while (spy.Processed.size() < VolumeCount &&
+         vtkTimerLog::GetUniversalTime() - startTime < 30.)
+    {
+    appLogic->ProcessReadData();
+    itksys::SystemTools::Delay(5);
+    }
+  if (spy.Processed.size() != VolumeCount)
+    {
+    std::cerr << "Line " << __LINE__ << ": only " << spy.Processed.size()
+              << " requests processed" << std::endl;
+    return EXIT_FAILURE;
+    }
+  for (int i = 0; i < VolumeCount; ++i)
+    {
+    bool read = (volumeNodes[i]->GetImageData() != 0);
+    bool progressed = std::find(spy.Progressed.begin(), spy.Progressed.end(),
+                                uids[i]) != spy.Progressed.end();
+    if (read == (i == 2) ||
+        std::count(spy.Processed.begin(), spy.Processed.end(), uids[i]) != 1 ||
+        (i != 2 && !progressed))
+      {
+      std::cerr << "Line " << __LINE__ << ": request " << i << " is "
+                << (read ? "" : "not ") << "read, "
+                << (progressed ? "" : "no ") << "progress reported"
+                << std::endl;
+      return EXIT_FAILURE;
+      }
+    }
+  if (volumeNodes[0]->GetImageData()->GetScalarComponentAsDouble(1, 2, 3, 0) != 0. ||
+      volumeNodes[3]->GetImageData()->GetScalarComponentAsDouble(1, 2, 3, 0) != 3.)
+    {
+    std::cerr << "Line " << __LINE__ << ": wrong voxels" << std::endl;
+    return EXIT_FAILURE;
+    }
+  appLogic->TerminateProcessingThread();
+  }
+
+  for (int i = 0; i < VolumeCount; ++i)
+    {
+    itksys::SystemTools::RemoveFile(fileNames[i].c_str());
+    }
+  return EXIT_SUCCESS;
+}
@@ -14,6 +14,7 @@
 
 // MRML includes
 #include <vtkCacheManager.h>
+#include <vtkImageHistogramCache.h>
 #include <vtkMRMLColorTableStorageNode.h>
 #ifdef Slicer_BUILD_CLI_SUPPORT
 # include <vtkMRMLCommandLineModuleNode.h>
@@ -33,6 +34,7 @@
 #include <vtkMRMLModelHierarchyNode.h>
 #include <vtkMRMLNRRDStorageNode.h>
 #include <vtkMRMLNonlinearTransformNode.h>
+#include <vtkMRMLScalarVolumeDisplayNode.h>
 #include <vtkMRMLScene.h>
 #include <vtkMRMLSelectionNode.h>
 #include <vtkMRMLSliceCompositeNode.h>
@@ -42,7 +44,13 @@
 #include <vtkMRMLVectorVolumeNode.h>
 #include <vtkMRMLVolumeArchetypeStorageNode.h>
 
+// vtkITK includes
+#include <vtkITKArchetypeImageSeriesReader.h>
+
 // VTK includes
+#include <vtkCallbackCommand.h>
+#include <vtkImageData.h>
+#include <vtkIntArray.h>
 #include <vtkNew.h>
 #include <vtkObjectFactory.h>
 #include <vtkPointData.h>
@@ -56,12 +64,26 @@
 #ifdef linux
 # include <unistd.h>
 #endif
+#include <list>
 #include <queue>
 
 //----------------------------------------------------------------------------
 class ProcessingTaskQueue : public std::queue<vtkSmartPointer<vtkSlicerTask> > {};
 class ModifiedQueue : public std::queue<vtkSmartPointer<vtkObject> > {};
 
+//----------------------------------------------------------------------------
+// Volume whose auto window/level histogram is computed in the processing
+// thread. It is created in the main thread and deleted by the task.
+struct AutoLevelsHistogramRequest
+{
+  vtkSmartPointer<vtkMRMLScalarVolumeDisplayNode> DisplayNode;
+  // the image of the display node is only used as a key in the cache, the
+  // voxels are read from a shallow copy that nothing else modifies
+  vtkImageData* Key;
+  unsigned long KeyMTime;
+  vtkSmartPointer<vtkImageData> Image;
+};
+
 //----------------------------------------------------------------------------
 class DataRequest
 {
@@ -145,12 +167,14 @@ public:
                   int displayData, int deleteFile, int uid = 0)
     : DataRequest( node, filename, displayData, deleteFile, uid)
   {
+    this->Initialize();
   }
 
   ReadDataRequest(const char *node, const char *filename, int displayData,
                   int deleteFile, int uid = 0)
     : DataRequest(node, filename, displayData, deleteFile, uid)
   {
+    this->Initialize();
   }
 
   ReadDataRequest(const std::vector<std::string>& targetNodes,
@@ -161,14 +185,191 @@ public:
     : DataRequest(targetNodes, sourceNodes, filename,
                   displayData, deleteFile, uid)
   {
+    this->Initialize();
   }
 
   ReadDataRequest()
   {
+    this->Initialize();
+  }
+
+  /// Processing state of a read request
+  /// - Pending: not yet seen by the main thread
+  /// - Queued: waiting for a read thread to decode the file
+  /// - Decoding: the file is being decoded by a read thread
+  /// - Ready: to be processed by the main thread
+  /// - Cancelled: to be discarded by the main thread
+  enum StateType
+  {
+    Pending = 0,
+    Queued,
+    Decoding,
+    Ready,
+    Cancelled
+  };
+
+  StateType GetState()const { return m_State; }
+  void SetState(StateType state) { m_State = state; }
+  int GetPriority()const { return m_Priority; }
+  void SetPriority(int priority) { m_Priority = priority; }
+  bool GetVisible()const { return m_Visible; }
+  void SetVisible(bool visible) { m_Visible = visible; }
+  bool GetCancelRequested()const { return m_CancelRequested; }
+  void SetCancelRequested(bool cancel) { m_CancelRequested = cancel; }
+  /// Decoding progress. It is changed by the read thread through the
+  /// progress observer of the decode reader, with the queue lock locked.
+  double GetProgress()const { return m_Progress; }
+  void SetProgress(double progress) { m_Progress = progress; }
+  double GetReportedProgress()const { return m_ReportedProgress; }
+  void SetReportedProgress(double progress) { m_ReportedProgress = progress; }
+
+  /// Storage node (not in the scene) used by the read thread to decode the
+  /// file. The reference node is only used to know the type of volume to
+  /// decode, the decoded reader is kept by the storage node until the main
+  /// thread reads the data into the requested node.
+  vtkMRMLScalarVolumeNode* GetDecodeReferenceNode()const { return m_DecodeReferenceNode; }
+  void SetDecodeReferenceNode(vtkMRMLScalarVolumeNode* node) { m_DecodeReferenceNode = node; }
+  vtkMRMLVolumeArchetypeStorageNode* GetDecodeStorageNode()const { return m_DecodeStorageNode; }
+  void SetDecodeStorageNode(vtkMRMLVolumeArchetypeStorageNode* storageNode)
+    { m_DecodeStorageNode = storageNode; }
+  vtkITKArchetypeImageSeriesReader* GetDecodeReader()const { return m_DecodeReader; }
+  void SetDecodeReader(vtkITKArchetypeImageSeriesReader* reader) { m_DecodeReader = reader; }
+  /// True if the read thread successfully decoded the file
+  bool GetDecoded()const { return m_Decoded; }
+  void SetDecoded(bool decoded) { m_Decoded = decoded; }
+
+  /// Copy the decision made by PrepareReadDataRequest() on \a prepared,
+  /// a copy of this request.
+  void CopyPreparation(const ReadDataRequest& prepared)
+  {
+    m_State = prepared.m_State;
+    m_Visible = prepared.m_Visible;
+    m_DecodeReferenceNode = prepared.m_DecodeReferenceNode;
+    m_DecodeStorageNode = prepared.m_DecodeStorageNode;
+    m_DecodeReader = prepared.m_DecodeReader;
+  }
+
+  /// Observe the progress of the decode reader. Must be called in the main
+  /// thread on the request in the queue, before a read thread decodes it.
+  void ObserveDecodeProgress(itk::MutexLock* queueLock)
+  {
+    m_QueueLock = queueLock;
+    vtkNew<vtkCallbackCommand> progressCallback;
+    progressCallback->SetCallback(ReadDataRequest::OnDecodeProgress);
+    progressCallback->SetClientData(this);
+    m_ProgressObserverTag = m_DecodeReader->AddObserver(
+      vtkCommand::ProgressEvent, progressCallback.GetPointer());
+  }
+
+  /// Must be called in the main thread once the request is not decoded
+  /// anymore.
+  void RemoveDecodeProgressObserver()
+  {
+    if (m_DecodeReader && m_ProgressObserverTag)
+      {
+      m_DecodeReader->RemoveObserver(m_ProgressObserverTag);
+      }
+    m_ProgressObserverTag = 0;
+  }
+
+  /// Return true if the request must be processed before \a other
+  bool HasPriorityOver(const ReadDataRequest& other)const
+  {
+    if (m_Priority != other.m_Priority)
+      {
+      return m_Priority > other.m_Priority;
+      }
+    // the queue is ordered, older requests are already first.
+    return m_Visible && !other.m_Visible;
+  }
+
+protected:
+  StateType m_State;
+  int m_Priority;
+  bool m_Visible;
+  bool m_CancelRequested;
+  double m_Progress;
+  double m_ReportedProgress;
+  vtkSmartPointer<vtkMRMLScalarVolumeNode> m_DecodeReferenceNode;
+  vtkSmartPointer<vtkMRMLVolumeArchetypeStorageNode> m_DecodeStorageNode;
+  vtkSmartPointer<vtkITKArchetypeImageSeriesReader> m_DecodeReader;
+  bool m_Decoded;
+  itk::MutexLock* m_QueueLock;
+  unsigned long m_ProgressObserverTag;
+
+  void Initialize(int priority = 0)
+  {
+    m_State = Pending;
+    m_Priority = priority;
+    m_Visible = false;
+    m_CancelRequested = false;
+    m_Progress = 0.;
+    m_ReportedProgress = 0.;
+    m_Decoded = false;
+    m_QueueLock = 0;
+    m_ProgressObserverTag = 0;
+  }
+
+  /// Called in the read thread
+  static void OnDecodeProgress(vtkObject* vtkNotUsed(caller),
+                               unsigned long vtkNotUsed(eid),
+                               void* clientData, void* callData)
+  {
+    ReadDataRequest* req = reinterpret_cast<ReadDataRequest*>(clientData);
+    double* progress = reinterpret_cast<double*>(callData);
+    if (!progress)
+      {
+      return;
+      }
+    req->m_QueueLock->Lock();
+    req->m_Progress = *progress;
+    req->m_QueueLock->Unlock();
+  }
+
+  friend class ReadDataQueue;
+};
+
+//----------------------------------------------------------------------------
+// Requests are referenced by the read threads while they are decoded, a
+// list is used to keep them valid when other requests are added or removed.
+class ReadDataQueue : public std::list<ReadDataRequest>
+{
+public:
+  void Push(const ReadDataRequest& req, int priority = 0)
+  {
+    this->push_back(req);
+    this->back().Initialize(priority);
   }
 
+  /// Return the request with the highest priority among the requests in
+  /// state \a state1 or \a state2, end() if there is none.
+  iterator Next(ReadDataRequest::StateType state1,
+                ReadDataRequest::StateType state2)
+  {
+    iterator next = this->end();
+    for (iterator it = this->begin(); it != this->end(); ++it)
+      {
+      if ((it->GetState() == state1 || it->GetState() == state2) &&
+          (next == this->end() || it->HasPriorityOver(*next)))
+        {
+        next = it;
+        }
+      }
+    return next;
+  }
+
+  iterator Find(int uid)
+  {
+    for (iterator it = this->begin(); it != this->end(); ++it)
+      {
+      if (it->GetUID() == uid)
+        {
+        return it;
+        }
+      }
+    return this->end();
+  }
 };
-class ReadDataQueue : public std::queue<ReadDataRequest> {} ;
 
 //----------------------------------------------------------------------------
 class WriteDataRequest: public DataRequest
@@ -211,6 +412,8 @@ vtkSlicerApplicationLogic::vtkSlicerApplicationLogic()
 {
   this->ProcessingThreader = itk::MultiThreader::New();
   this->ProcessingThreadId = -1;
+  this->NumberOfReadDataThreads =
+    itk::MultiThreader::GetGlobalDefaultNumberOfThreads();
   this->ProcessingThreadActive = false;
   this->ProcessingThreadActiveLock = itk::MutexLock::New();
   this->ProcessingTaskQueueLock = itk::MutexLock::New();
@@ -222,6 +425,8 @@ vtkSlicerApplicationLogic::vtkSlicerApplicationLogic()
   this->ReadDataQueueActive = false;
   this->ReadDataQueueActiveLock = itk::MutexLock::New();
   this->ReadDataQueueLock = itk::MutexLock::New();
+  this->ReadDataTasksCondition = itk::ConditionVariable::New();
+  this->NumberOfReadDataTasks = 0;
 
   this->WriteDataQueueActive = false;
   this->WriteDataQueueActiveLock = itk::MutexLock::New();
@@ -252,6 +457,7 @@ vtkSlicerApplicationLogic::~vtkSlicerApplicationLogic()
 
     this->ProcessingThreadId = -1;
     }
+  this->TerminateReadDataThreads();
 
   delete this->InternalTaskQueue;
 
@@ -271,7 +477,11 @@ vtkSlicerApplicationLogic::~vtkSlicerApplicationLogic()
 //----------------------------------------------------------------------------
 unsigned int vtkSlicerApplicationLogic::GetReadDataQueueSize()
 {
-  return static_cast<unsigned int>( (*this->InternalReadDataQueue).size() );
+  this->ReadDataQueueLock->Lock();
+  unsigned int size =
+    static_cast<unsigned int>( (*this->InternalReadDataQueue).size() );
+  this->ReadDataQueueLock->Unlock();
+  return size;
 }
 
 //----------------------------------------------------------------------------
@@ -313,6 +523,14 @@ void vtkSlicerApplicationLogic::CreateProcessingThread()
     this->NetworkingThreadIDs.push_back ( this->ProcessingThreader
           ->SpawnThread(vtkSlicerApplicationLogic::NetworkingThreaderCallback,
                     this) );
+
+    // Start the pool of read threads
+    for (int i = 0; i < this->NumberOfReadDataThreads; ++i)
+      {
+      this->ReadDataThreadIDs.push_back( this->ProcessingThreader
+          ->SpawnThread(vtkSlicerApplicationLogic::ReadDataThreaderCallback,
+                    this) );
+      }
     /*
      * TODO: it looks like curl is not thread safe by default
      * - maybe there's a setting that cmcurl can have
@@ -381,9 +599,47 @@ void vtkSlicerApplicationLogic::TerminateProcessingThread()
       }
     this->NetworkingThreadIDs.clear();
 
+    this->TerminateReadDataThreads();
     }
 }
 
+//----------------------------------------------------------------------------
+void vtkSlicerApplicationLogic::TerminateReadDataThreads()
+{
+  // the read threads stop when ProcessingThreadActive is false, wake up
+  // the ones that are waiting for a request
+  this->ProcessingThreadActiveLock->Lock();
+  this->ProcessingThreadActive = false;
+  this->ProcessingThreadActiveLock->Unlock();
+  this->ReadDataTasksLock.Lock();
+  this->ReadDataTasksCondition->Broadcast();
+  this->ReadDataTasksLock.Unlock();
+
+  std::vector<int>::const_iterator idIterator;
+  for (idIterator = this->ReadDataThreadIDs.begin();
+       idIterator != this->ReadDataThreadIDs.end(); ++idIterator)
+    {
+    this->ProcessingThreader->TerminateThread( *idIterator );
+    }
+  this->ReadDataThreadIDs.clear();
+  this->NumberOfReadDataTasks = 0;
+
+  // requests queued for the read threads are now processed in the main
+  // thread, they are not decoded.
+  this->ReadDataQueueLock->Lock();
+  ReadDataQueue::iterator it;
+  for (it = this->InternalReadDataQueue->begin();
+       it != this->InternalReadDataQueue->end(); ++it)
+    {
+    if (it->GetState() == ReadDataRequest::Queued)
+      {
+      it->RemoveDecodeProgressObserver();
+      it->SetState(ReadDataRequest::Ready);
+      }
+    }
+  this->ReadDataQueueLock->Unlock();
+}
+
 //----------------------------------------------------------------------------
 ITK_THREAD_RETURN_TYPE
 vtkSlicerApplicationLogic
@@ -535,6 +791,107 @@ void vtkSlicerApplicationLogic::ProcessNetworkingTasks()
     }
 }
 
+//----------------------------------------------------------------------------
+ITK_THREAD_RETURN_TYPE
+vtkSlicerApplicationLogic
+::ReadDataThreaderCallback( void *arg )
+{
+  // pull out the reference to the appLogic
+  vtkSlicerApplicationLogic *appLogic
+    = (vtkSlicerApplicationLogic*)
+    (((itk::MultiThreader::ThreadInfoStruct *)(arg))->UserData);
+
+  // Decode the files of the read requests
+  appLogic->ProcessReadDataTasks();
+
+  return ITK_THREAD_RETURN_VALUE;
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerApplicationLogic::ProcessReadDataTasks()
+{
+  while (true)
+    {
+    // Sleep until a request is queued for the read threads or until they
+    // must stop. ProcessingThreadActive is checked with ReadDataTasksLock
+    // locked to not miss the wake up of TerminateReadDataThreads().
+    int active = true;
+    this->ReadDataTasksLock.Lock();
+    while (true)
+      {
+      this->ProcessingThreadActiveLock->Lock();
+      active = this->ProcessingThreadActive;
+      this->ProcessingThreadActiveLock->Unlock();
+      if (!active || this->NumberOfReadDataTasks > 0)
+        {
+        break;
+        }
+      this->ReadDataTasksCondition->Wait(&this->ReadDataTasksLock);
+      }
+    if (active)
+      {
+      --this->NumberOfReadDataTasks;
+      }
+    this->ReadDataTasksLock.Unlock();
+    if (!active)
+      {
+      return;
+      }
+
+    // pull the most urgent request waiting to be decoded, it may have been
+    // cancelled meanwhile
+    ReadDataRequest* req = 0;
+    this->ReadDataQueueLock->Lock();
+    ReadDataQueue::iterator it = this->InternalReadDataQueue->Next(
+      ReadDataRequest::Queued, ReadDataRequest::Queued);
+    if (it != this->InternalReadDataQueue->end())
+      {
+      req = &(*it);
+      req->SetState(ReadDataRequest::Decoding);
+      }
+    this->ReadDataQueueLock->Unlock();
+    if (!req)
+      {
+      continue;
+      }
+
+    // The request stays in the queue while it is Decoding. The decode
+    // storage node is not in the scene and its reader was set up and
+    // observed by the main thread: DecodeData() doesn't touch the scene nor
+    // observers, it can safely be used outside of the main thread.
+    bool decoded = false;
+    try
+      {
+      decoded = req->GetDecodeStorageNode()->DecodeData(
+        req->GetDecodeReader(), req->GetDecodeReferenceNode());
+      }
+    catch (...)
+      {
+      decoded = false;
+      }
+
+    this->ReadDataQueueLock->Lock();
+    req->SetDecoded(decoded);
+    req->SetProgress(1.);
+    req->SetState(req->GetCancelRequested() ?
+      ReadDataRequest::Cancelled : ReadDataRequest::Ready);
+    this->ReadDataQueueLock->Unlock();
+    }
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerApplicationLogic::AddReadDataTasks(int count)
+{
+  this->ReadDataTasksLock.Lock();
+  this->NumberOfReadDataTasks =
+    std::max(0, this->NumberOfReadDataTasks + count);
+  for (int i = 0; i < count; ++i)
+    {
+    this->ReadDataTasksCondition->Signal();
+    }
+  this->ReadDataTasksLock.Unlock();
+}
+
 //----------------------------------------------------------------------------
 int vtkSlicerApplicationLogic::ScheduleTask( vtkSlicerTask *task )
 {
@@ -591,7 +948,7 @@ int vtkSlicerApplicationLogic::RequestModified( vtkObject *obj )
 }
 
 //----------------------------------------------------------------------------
-int vtkSlicerApplicationLogic::RequestReadData( const char *refNode, const char *filename, int displayData, int deleteFile )
+int vtkSlicerApplicationLogic::RequestReadData( const char *refNode, const char *filename, int displayData, int deleteFile, int priority )
 {
   int active;
 
@@ -607,8 +964,9 @@ int vtkSlicerApplicationLogic::RequestReadData( const char *refNode, const char
     this->ReadDataQueueLock->Lock();
     this->RequestTimeStamp.Modified();
     int uid = static_cast<int>(this->RequestTimeStamp.GetMTime());
-    (*this->InternalReadDataQueue).push(
-      ReadDataRequest(refNode, filename, displayData, deleteFile, uid) );
+    (*this->InternalReadDataQueue).Push(
+      ReadDataRequest(refNode, filename, displayData, deleteFile, uid),
+      priority );
 //     std::cout << " [" << (*this->InternalReadDataQueue).size()
 //               << "] " << std::endl;
     this->ReadDataQueueLock->Unlock();
@@ -670,7 +1028,7 @@ int vtkSlicerApplicationLogic::RequestReadScene(
     this->ReadDataQueueLock->Lock();
     this->RequestTimeStamp.Modified();
     int uid = static_cast<int>(this->RequestTimeStamp.GetMTime());
-    (*this->InternalReadDataQueue).push(
+    (*this->InternalReadDataQueue).Push(
       ReadDataRequest(targetIDs, sourceIDs, filename, displayData, deleteFile, uid) );
     this->ReadDataQueueLock->Unlock();
 
@@ -681,6 +1039,63 @@ int vtkSlicerApplicationLogic::RequestReadScene(
   return 0;
 }
 
+//----------------------------------------------------------------------------
+bool vtkSlicerApplicationLogic::CancelRequest(int uid)
+{
+  this->ReadDataQueueLock->Lock();
+  ReadDataQueue::iterator it = this->InternalReadDataQueue->Find(uid);
+  bool pending = (it != this->InternalReadDataQueue->end() &&
+                  it->GetState() != ReadDataRequest::Cancelled &&
+                  !it->GetCancelRequested());
+  bool queued = false;
+  if (pending)
+    {
+    it->SetCancelRequested(true);
+    // a request being decoded is cancelled by its read thread when done
+    if (it->GetState() != ReadDataRequest::Decoding)
+      {
+      queued = (it->GetState() == ReadDataRequest::Queued);
+      it->SetState(ReadDataRequest::Cancelled);
+      }
+    }
+  this->ReadDataQueueLock->Unlock();
+  if (queued)
+    {
+    // one less request for the read threads
+    this->AddReadDataTasks(-1);
+    }
+  return pending;
+}
+
+//----------------------------------------------------------------------------
+bool vtkSlicerApplicationLogic::SetRequestPriority(int uid, int priority)
+{
+  this->ReadDataQueueLock->Lock();
+  ReadDataQueue::iterator it = this->InternalReadDataQueue->Find(uid);
+  // the requests being decoded or ready are not reordered anymore
+  bool pending = (it != this->InternalReadDataQueue->end() &&
+                  (it->GetState() == ReadDataRequest::Pending ||
+                   it->GetState() == ReadDataRequest::Queued) &&
+                  !it->GetCancelRequested());
+  if (pending)
+    {
+    it->SetPriority(priority);
+    }
+  this->ReadDataQueueLock->Unlock();
+  return pending;
+}
+
+//----------------------------------------------------------------------------
+double vtkSlicerApplicationLogic::GetRequestProgress(int uid)
+{
+  this->ReadDataQueueLock->Lock();
+  ReadDataQueue::iterator it = this->InternalReadDataQueue->Find(uid);
+  double progress = (it != this->InternalReadDataQueue->end()) ?
+    it->GetProgress() : -1.;
+  this->ReadDataQueueLock->Unlock();
+  return progress;
+}
+
 //----------------------------------------------------------------------------
 void vtkSlicerApplicationLogic::ProcessModified()
 {
@@ -727,6 +1142,107 @@ void vtkSlicerApplicationLogic::ProcessModified()
   this->InvokeEvent(vtkSlicerApplicationLogic::RequestModifiedEvent, &delay);
 }
 
+//----------------------------------------------------------------------------
+void vtkSlicerApplicationLogic::SetMRMLSceneInternal(vtkMRMLScene* newScene)
+{
+  this->Superclass::SetMRMLSceneInternal(newScene);
+
+  vtkNew<vtkIntArray> events;
+  events->InsertNextValue(vtkMRMLScene::NodeAddedEvent);
+  events->InsertNextValue(vtkMRMLScene::NodeRemovedEvent);
+  this->GetMRMLSceneObserverManager()->AddObjectEvents(newScene,
+                                                       events.GetPointer());
+  if (!newScene)
+    {
+    return;
+    }
+  std::vector<vtkMRMLNode*> displayNodes;
+  newScene->GetNodesByClass("vtkMRMLScalarVolumeDisplayNode", displayNodes);
+  for (std::vector<vtkMRMLNode*>::iterator it = displayNodes.begin();
+       it != displayNodes.end(); ++it)
+    {
+    this->OnMRMLSceneNodeAdded(*it);
+    }
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerApplicationLogic::OnMRMLSceneNodeAdded(vtkMRMLNode* node)
+{
+  if (!vtkMRMLScalarVolumeDisplayNode::SafeDownCast(node))
+    {
+    return;
+    }
+  vtkNew<vtkIntArray> events;
+  events->InsertNextValue(
+    vtkMRMLScalarVolumeDisplayNode::AutoLevelsEstimatedEvent);
+  vtkUnObserveMRMLNodeMacro(node);
+  vtkObserveMRMLNodeEventsMacro(node, events.GetPointer());
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerApplicationLogic::OnMRMLSceneNodeRemoved(vtkMRMLNode* node)
+{
+  if (!vtkMRMLScalarVolumeDisplayNode::SafeDownCast(node))
+    {
+    return;
+    }
+  vtkUnObserveMRMLNodeMacro(node);
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerApplicationLogic::ProcessMRMLNodesEvents(vtkObject* caller,
+                                                       unsigned long event,
+                                                       void* callData)
+{
+  vtkMRMLScalarVolumeDisplayNode* displayNode =
+    vtkMRMLScalarVolumeDisplayNode::SafeDownCast(caller);
+  vtkImageData* image = reinterpret_cast<vtkImageData*>(callData);
+  if (!displayNode || !image ||
+      event != vtkMRMLScalarVolumeDisplayNode::AutoLevelsEstimatedEvent)
+    {
+    this->Superclass::ProcessMRMLNodesEvents(caller, event, callData);
+    return;
+    }
+
+  AutoLevelsHistogramRequest* request = new AutoLevelsHistogramRequest;
+  request->DisplayNode = displayNode;
+  request->Key = image;
+  request->KeyMTime = image->GetMTime();
+  request->Image = vtkSmartPointer<vtkImageData>::New();
+  request->Image->ShallowCopy(image);
+
+  vtkSlicerTask* task = vtkSlicerTask::New();
+  task->SetTypeToProcessing();
+  task->SetTaskFunction(this, (vtkSlicerTask::TaskFunctionPointer)
+                        &vtkSlicerApplicationLogic::ComputeAutoLevelsHistogram,
+                        request);
+  if (!this->ScheduleTask(task))
+    {
+    // no processing thread, the window/level stays estimated
+    delete request;
+    }
+  task->Delete();
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerApplicationLogic::ComputeAutoLevelsHistogram(void* clientdata)
+{
+  AutoLevelsHistogramRequest* request =
+    reinterpret_cast<AutoLevelsHistogramRequest*>(clientdata);
+
+  double binOrigin, binSpacing;
+  int numberOfBins;
+  vtkMRMLScalarVolumeDisplayNode::GetAutoLevelsHistogramBins(
+    binOrigin, binSpacing, numberOfBins);
+  vtkImageHistogramCache::GetInstance()->AddHistogram(
+    request->Key, request->KeyMTime, request->Image,
+    binOrigin, binSpacing, numberOfBins);
+
+  // The display node uses the cached histogram when it is modified
+  this->RequestModified(request->DisplayNode);
+  delete request;
+}
+
 //----------------------------------------------------------------------------
 void vtkSlicerApplicationLogic::ProcessReadData()
 {
@@ -739,18 +1255,119 @@ void vtkSlicerApplicationLogic::ProcessReadData()
     {
     return;
     }
+  // The new requests are prepared outside of the critical section: the
+  // scene is looked up and other threads may request reads meanwhile.
+  std::vector<ReadDataRequest> newRequests;
+  this->ReadDataQueueLock->Lock();
+  ReadDataQueue::iterator it;
+  for (it = this->InternalReadDataQueue->begin();
+       it != this->InternalReadDataQueue->end(); ++it)
+    {
+    if (it->GetState() == ReadDataRequest::Pending)
+      {
+      newRequests.push_back(*it);
+      }
+    }
+  this->ReadDataQueueLock->Unlock();
+  std::vector<ReadDataRequest>::iterator newIt;
+  for (newIt = newRequests.begin(); newIt != newRequests.end(); ++newIt)
+    {
+    this->PrepareReadDataRequest(*newIt);
+    }
+
   ReadDataRequest req;
-  // pull an object off the queue
+  std::vector<int> progressedRequests;
+  int queuedCount = 0;
   this->ReadDataQueueLock->Lock();
-  if ((*this->InternalReadDataQueue).size() > 0)
+  // dispatch the new requests to the read threads, unless they were
+  // cancelled meanwhile
+  for (newIt = newRequests.begin(); newIt != newRequests.end(); ++newIt)
     {
-    req = (*this->InternalReadDataQueue).front();
-    (*this->InternalReadDataQueue).pop();
+    it = this->InternalReadDataQueue->Find(newIt->GetUID());
+    if (it == this->InternalReadDataQueue->end() ||
+        it->GetState() != ReadDataRequest::Pending)
+      {
+      continue;
+      }
+    it->CopyPreparation(*newIt);
+    if (it->GetState() == ReadDataRequest::Queued)
+      {
+      it->ObserveDecodeProgress(this->ReadDataQueueLock);
+      ++queuedCount;
+      }
+    }
+  for (it = this->InternalReadDataQueue->begin();
+       it != this->InternalReadDataQueue->end(); ++it)
+    {
+    // report progress
+    if (it->GetProgress() != it->GetReportedProgress())
+      {
+      it->SetReportedProgress(it->GetProgress());
+      progressedRequests.push_back(it->GetUID());
+      }
+    }
+  // pull the most urgent request ready for the main thread off the queue
+  it = this->InternalReadDataQueue->Next(
+    ReadDataRequest::Ready, ReadDataRequest::Cancelled);
+  if (it != this->InternalReadDataQueue->end())
+    {
+    // the read threads are done with the request
+    it->RemoveDecodeProgressObserver();
+    req = *it;
+    this->InternalReadDataQueue->erase(it);
+    }
+  // schedule the next timer sooner in case there is stuff ready in the
+  // queue, a bit later if requests are still being decoded, otherwise for
+  // a while later
+  int delay = 200;
+  if (this->InternalReadDataQueue->Next(ReadDataRequest::Ready,
+        ReadDataRequest::Cancelled) != this->InternalReadDataQueue->end())
+    {
+    delay = 0;
+    }
+  else if (this->InternalReadDataQueue->size() > 0)
+    {
+    delay = 20;
     }
   this->ReadDataQueueLock->Unlock();
+  newRequests.clear();
+  if (queuedCount > 0)
+    {
+    this->AddReadDataTasks(queuedCount);
+    }
 
-  if (!req.GetNode().empty())
+  for (std::vector<int>::const_iterator uidIt = progressedRequests.begin();
+       uidIt != progressedRequests.end(); ++uidIt)
     {
+    this->InvokeEvent(vtkSlicerApplicationLogic::RequestProgressEvent,
+                      reinterpret_cast<void*>(*uidIt));
+    }
+
+  if (req.GetState() == ReadDataRequest::Cancelled)
+    {
+    // Delete the file if requested, nobody will use it
+    if (req.GetDeleteFile() &&
+        req.GetFilename().find("slicer:") == std::string::npos)
+      {
+      itksys::SystemTools::RemoveFile( req.GetFilename().c_str() );
+      }
+    }
+  else if (!req.GetNode().empty())
+    {
+    if (req.GetDecodeStorageNode())
+      {
+      if (req.GetDecoded())
+        {
+        req.GetDecodeStorageNode()->SetDecodedReader(req.GetDecodeReader());
+        }
+      else
+        {
+        // read the file again in the main thread to report the error
+        req.SetDecodeReferenceNode(0);
+        req.SetDecodeStorageNode(0);
+        }
+      req.SetDecodeReader(0);
+      }
     if (req.GetIsScene())
       {
       this->ProcessReadSceneData(req);
@@ -761,9 +1378,6 @@ void vtkSlicerApplicationLogic::ProcessReadData()
       }
     }
 
-  int delay = (*this->InternalReadDataQueue).size() > 0 ? 0: 200;
-  // schedule the next timer sooner in case there is stuff in the queue
-  // otherwise for a while later
   this->InvokeEvent(vtkSlicerApplicationLogic::RequestReadDataEvent, &delay);
   if (req.GetUID())
     {
@@ -772,6 +1386,85 @@ void vtkSlicerApplicationLogic::ProcessReadData()
     }
 }
 
+//----------------------------------------------------------------------------
+void vtkSlicerApplicationLogic::PrepareReadDataRequest(ReadDataRequest& req)
+{
+  req.SetState(ReadDataRequest::Ready);
+  if (req.GetIsScene() || !this->GetMRMLScene())
+    {
+    return;
+    }
+  vtkMRMLNode* nd = this->GetMRMLScene()->GetNodeByID( req.GetNode().c_str() );
+  if (!nd)
+    {
+    return;
+    }
+
+  // volumes displayed in a slice view are loaded first
+  int compositeCount =
+    this->GetMRMLScene()->GetNumberOfNodesByClass("vtkMRMLSliceCompositeNode");
+  for (int i = 0; i < compositeCount; ++i)
+    {
+    vtkMRMLSliceCompositeNode* compositeNode = vtkMRMLSliceCompositeNode::SafeDownCast(
+      this->GetMRMLScene()->GetNthNodeByClass(i, "vtkMRMLSliceCompositeNode"));
+    const char* volumeIDs[3] = {compositeNode->GetBackgroundVolumeID(),
+                                compositeNode->GetForegroundVolumeID(),
+                                compositeNode->GetLabelVolumeID()};
+    for (int j = 0; j < 3; ++j)
+      {
+      if (volumeIDs[j] && req.GetNode() == volumeIDs[j])
+        {
+        req.SetVisible(true);
+        }
+      }
+    }
+
+  // Only local scalar and vector volumes that don't have a storage node for
+  // the file yet are decoded by the read threads. The volume archetype
+  // storage node doesn't need the scene to decode them.
+  vtkMRMLScalarVolumeNode* volumeNode = vtkMRMLScalarVolumeNode::SafeDownCast(nd);
+  if (this->ReadDataThreadIDs.empty() ||
+      !volumeNode ||
+      volumeNode->IsA("vtkMRMLDiffusionWeightedVolumeNode") ||
+      volumeNode->IsA("vtkMRMLDiffusionTensorVolumeNode") ||
+      !this->GetMRMLScene()->GetCacheManager() ||
+      this->GetMRMLScene()->GetCacheManager()->IsRemoteReference(req.GetFilename().c_str()) ||
+      !itksys::SystemTools::FileExists( req.GetFilename().c_str() ))
+    {
+    return;
+    }
+  for (int n = 0; n < volumeNode->GetNumberOfStorageNodes(); ++n)
+    {
+    vtkMRMLStorageNode* storageNode = volumeNode->GetNthStorageNode(n);
+    if (storageNode && storageNode->GetFileName() &&
+        req.GetFilename().compare(storageNode->GetFileName()) == 0)
+      {
+      return;
+      }
+    }
+
+  vtkSmartPointer<vtkMRMLScalarVolumeNode> referenceNode;
+  referenceNode.TakeReference(
+    vtkMRMLScalarVolumeNode::SafeDownCast(volumeNode->CreateNodeInstance()));
+  vtkNew<vtkMRMLVolumeArchetypeStorageNode> storageNode;
+  // Need to maintain the original coordinate frame established by
+  // the images sent to the execution model
+  storageNode->SetCenterImage(0);
+  storageNode->SetFileName( req.GetFilename().c_str() );
+  // the reader is created here so that its observers are added in the main
+  // thread
+  vtkSmartPointer<vtkITKArchetypeImageSeriesReader> reader;
+  reader.TakeReference(storageNode->CreateDecodeReader(referenceNode));
+  if (!reader)
+    {
+    return;
+    }
+  req.SetDecodeReferenceNode(referenceNode);
+  req.SetDecodeStorageNode(storageNode.GetPointer());
+  req.SetDecodeReader(reader);
+  req.SetState(ReadDataRequest::Queued);
+}
+
 //----------------------------------------------------------------------------
 void vtkSlicerApplicationLogic::ProcessWriteData()
 {
@@ -910,8 +1603,19 @@ void vtkSlicerApplicationLogic::ProcessReadNodeData(ReadDataRequest& req)
       }
     }
 
+  // the file may have already been decoded by a read thread, its storage
+  // node then reads the decoded data instead of the file.
+  bool decoded = false;
+  if (!storageNodeExists && (svnd || vvnd) && req.GetDecodeStorageNode())
+    {
+    decoded = true;
+    storageNode = req.GetDecodeStorageNode();
+    // released with the storage nodes created below
+    storageNode->Register(this);
+    }
+
   // if there wasn't already a matching storage node on the node, make one
-  if (!storageNodeExists)
+  if (!storageNodeExists && !decoded)
     {
     // Read the data into the referenced node
     if (itksys::SystemTools::FileExists( req.GetFilename().c_str() ))
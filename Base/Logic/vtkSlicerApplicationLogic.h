@@ -29,6 +29,7 @@
 #include <vtkSmartPointer.h>
 
 // ITK includes
+#include <itkConditionVariable.h>
 #include <itkMultiThreader.h>
 #include <itkMutexLock.h>
 
@@ -56,7 +57,8 @@ class VTK_SLICER_BASE_LOGIC_EXPORT vtkSlicerApplicationLogic
   /// (display it in the Fiducials GUI)
   void PropagateFiducialListSelection();
 
-  /// Create a thread for processing
+  /// Create a thread for processing and the pool of read threads
+  /// \sa SetNumberOfReadDataThreads()
   void CreateProcessingThread();
 
   /// Shutdown the processing thread
@@ -71,7 +73,12 @@ class VTK_SLICER_BASE_LOGIC_EXPORT vtkSlicerApplicationLogic
       /// has been processed.
       /// The uid of the request is passed as callData.
       /// \todo Add support for "modified" request.
-      RequestProcessedEvent
+      RequestProcessedEvent,
+      /// Event fired in the main thread when the progress of a readData
+      /// request being decoded by a read thread has changed.
+      /// The uid of the request is passed as callData.
+      /// \sa GetRequestProgress()
+      RequestProgressEvent
     };
 
   /// Schedule a task to run in the processing thread. Returns true if
@@ -92,15 +99,42 @@ class VTK_SLICER_BASE_LOGIC_EXPORT vtkSlicerApplicationLogic
 
   /// Request that data be read from a file and set it on the referenced
   /// node.  The request will be sent to the main thread which will be
-  /// responsible for reading the data, setting it on the referenced
-  /// node, and updating the display.
+  /// responsible for setting the data on the referenced node, and
+  /// updating the display. Local scalar and vector volume files are
+  /// decoded beforehand by the pool of read threads, in parallel.
+  /// Requests with a higher \a priority are handled first. For a same
+  /// priority, the volumes displayed in a slice view are handled first,
+  /// then the requests are handled in order.
   /// Return the request UID (monotonically increasing) of the request or 0 if
   /// the request failed to be registered. When the request is processed,
   /// RequestProcessedEvent is invoked with the request UID as calldata.
   /// \sa RequestReadScene(), RequestWriteData(), RequestModified()
+  /// \sa CancelRequest(), GetRequestProgress(), SetRequestPriority()
   int RequestReadData(const char *refNode, const char *filename,
                        int displayData = false,
-                       int deleteFile=false);
+                       int deleteFile=false,
+                       int priority = 0);
+
+  /// Cancel a pending readData or readScene request. The data is not set
+  /// on the node but RequestProcessedEvent is still invoked.
+  /// Return true if the request was pending.
+  bool CancelRequest(int uid);
+
+  /// Change the priority of a readData or readScene request that is not
+  /// being decoded nor ready to be processed by the main thread yet.
+  /// Return false if the request is not found, cancelled, being decoded or
+  /// ready.
+  bool SetRequestPriority(int uid, int priority);
+
+  /// Return the progress (between 0 and 1) of the decoding of a pending
+  /// readData request or -1 if the request is not pending anymore.
+  double GetRequestProgress(int uid);
+
+  /// Number of threads that decode the files of the readData requests.
+  /// Must be set before CreateProcessingThread() is called.
+  /// By default, one thread per processor.
+  vtkSetMacro(NumberOfReadDataThreads, int);
+  vtkGetMacro(NumberOfReadDataThreads, int);
 
   /// Return the number of items that need to be read from the queue
   /// (this allows code that invokes command line modules to know when
@@ -194,6 +228,41 @@ protected:
   /// Networking Task processing loop that is run in a networking thread
   void ProcessNetworkingTasks();
 
+  /// Callback used by a MultiThreader to start a read thread
+  static ITK_THREAD_RETURN_TYPE ReadDataThreaderCallback( void * );
+
+  /// Decoding loop of the readData requests that is run in the read threads
+  void ProcessReadDataTasks();
+
+  /// Decide in the main thread how a new readData request is processed:
+  /// decoded by a read thread or entirely in the main thread.
+  /// It looks up the scene: it must be called on a copy of the queued
+  /// request, without the ReadDataQueueLock locked.
+  void PrepareReadDataRequest( ReadDataRequest &req );
+
+  /// Change the number of requests queued for the read threads by \a count
+  /// and wake up as many read threads.
+  void AddReadDataTasks(int count);
+
+  /// Stop and wait for the read threads.
+  void TerminateReadDataThreads();
+
+  /// Observe the scalar volume display nodes of the scene to refine their
+  /// auto window/level in the processing thread.
+  virtual void SetMRMLSceneInternal(vtkMRMLScene* newScene);
+  virtual void OnMRMLSceneNodeAdded(vtkMRMLNode* node);
+  virtual void OnMRMLSceneNodeRemoved(vtkMRMLNode* node);
+  virtual void ProcessMRMLNodesEvents(vtkObject* caller,
+                                      unsigned long event,
+                                      void* callData);
+
+  /// Compute in the processing thread the histogram of all the voxels of a
+  /// volume whose auto window/level was estimated from a sample, then
+  /// request a Modified() of its display node that refines the window/level
+  /// in the main thread.
+  /// \sa vtkMRMLScalarVolumeDisplayNode::AutoLevelsEstimatedEvent
+  void ComputeAutoLevelsHistogram(void* clientdata);
+
   /// Process a request to read data into a node.  This method is
   /// called by ProcessReadData() in the application main thread
   /// because calls to load data will cause a Modified() on a node
@@ -224,6 +293,14 @@ private:
   vtkTimeStamp RequestTimeStamp;
   int ProcessingThreadId;
   std::vector<int> NetworkingThreadIDs;
+  std::vector<int> ReadDataThreadIDs;
+  int NumberOfReadDataThreads;
+  /// The read threads wait on the condition until requests are queued for
+  /// them. NumberOfReadDataTasks counts the requests queued and not yet
+  /// pulled, it is protected by ReadDataTasksLock.
+  itk::SimpleMutexLock ReadDataTasksLock;
+  itk::ConditionVariable::Pointer ReadDataTasksCondition;
+  int NumberOfReadDataTasks;
   int ProcessingThreadActive;
   int ModifiedQueueActive;
   int ReadDataQueueActive;
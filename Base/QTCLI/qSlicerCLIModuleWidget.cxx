@@ -23,9 +23,11 @@
 #include <QDebug>
 #include <QFormLayout>
 #include <QMenu>
+#include <QSettings>
 
 // SlicerQt includes
 #include "qSlicerCLIModule.h"
+#include "qSlicerCoreApplication.h"
 #include "qSlicerCLIModuleWidget_p.h"
 #include "vtkSlicerCLIModuleLogic.h"
 #include "qSlicerCLIModuleUIHelper.h"
@@ -432,6 +434,15 @@ void qSlicerCLIModuleWidget::run(vtkMRMLCommandLineModuleNode* parameterNode, bo
   Q_D(qSlicerCLIModuleWidget);
   Q_ASSERT(d->logic());
 
+  // Executable CLIs can exchange their volumes through shared memory,
+  // see the Modules settings.
+  qSlicerCoreApplication* app = qSlicerCoreApplication::application();
+  if (app && app->userSettings())
+    {
+    d->logic()->SetSharedMemoryTransfer(
+      app->userSettings()->value("Modules/CLISharedMemoryTransfer", false).toBool());
+    }
+
   if (waitForCompletion)
     {
     d->logic()->ApplyAndWait(parameterNode);
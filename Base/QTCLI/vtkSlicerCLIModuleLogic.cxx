@@ -42,6 +42,13 @@
 #include <itksys/SystemTools.hxx>
 #include <itksys/RegularExpression.hxx>
 
+// ITK includes
+#include <itkConfigure.h>
+#if ITK_VERSION_MAJOR > 3
+# include <itkImageIOFactory.h>
+# include <itkSharedMemoryImageIO.h>
+#endif
+
 // QT includes
 #include <QDebug>
 
@@ -53,7 +60,9 @@
 #include <algorithm>
 #include <cassert>
 #include <ctime>
+#include <map>
 #include <set>
+#include <sstream>
 
 #ifdef _WIN32
 #else
@@ -77,6 +86,131 @@ struct DigitsToCharacters
 
 typedef std::pair<vtkSlicerCLIModuleLogic *, vtkMRMLCommandLineModuleNode *> LogicNodePair;
 
+//----------------------------------------------------------------------------
+// Return the filename used by itkMRMLIDImageIO to access a node of the scene
+static std::string vtkSlicerCLIMRMLIDFileName(vtkMRMLScene* scene,
+                                              const std::string& nodeID)
+{
+  // Must be large enough to hold slicer:, #, an ascii
+  // representation of the scene pointer and the MRML node ID.
+  char *tname = new char[nodeID.size() + 100];
+  sprintf(tname, "slicer:%p#%s", scene, nodeID.c_str());
+  std::string fname = tname;
+  delete [] tname;
+  return fname;
+}
+
+#if ITK_VERSION_MAJOR > 3
+//----------------------------------------------------------------------------
+static void vtkSlicerCLICopyImageInformation(itk::ImageIOBase* from,
+                                             itk::ImageIOBase* to)
+{
+  unsigned int dimension = from->GetNumberOfDimensions();
+  to->SetNumberOfDimensions(dimension);
+  for (unsigned int i = 0; i < dimension; ++i)
+    {
+    to->SetDimensions(i, from->GetDimensions(i));
+    to->SetSpacing(i, from->GetSpacing(i));
+    to->SetOrigin(i, from->GetOrigin(i));
+    to->SetDirection(i, from->GetDirection(i));
+    }
+  to->SetComponentType(from->GetComponentType());
+  to->SetPixelType(from->GetPixelType());
+  to->SetNumberOfComponents(from->GetNumberOfComponents());
+  to->SetMetaDataDictionary(from->GetMetaDataDictionary());
+}
+#endif
+
+//----------------------------------------------------------------------------
+// Copy the image of a volume node into a shared memory segment.
+// The pixels are read by itkMRMLIDImageIO directly into the segment.
+static bool vtkSlicerCLIWriteSharedMemoryImage(vtkMRMLScene* scene,
+                                               const std::string& nodeID,
+                                               const std::string& fileName)
+{
+#if ITK_VERSION_MAJOR > 3
+  std::string nodeFileName = vtkSlicerCLIMRMLIDFileName(scene, nodeID);
+  try
+    {
+    itk::ImageIOBase::Pointer nodeIO = itk::ImageIOFactory::CreateImageIO(
+      nodeFileName.c_str(), itk::ImageIOFactory::ReadMode);
+    if (nodeIO.IsNull())
+      {
+      return false;
+      }
+    nodeIO->SetFileName(nodeFileName);
+    nodeIO->ReadImageInformation();
+
+    itk::SharedMemoryImageIO::Pointer sharedMemoryIO =
+      itk::SharedMemoryImageIO::New();
+    vtkSlicerCLICopyImageInformation(nodeIO, sharedMemoryIO);
+    sharedMemoryIO->SetFileName(fileName);
+    sharedMemoryIO->WriteImageInformation();
+    nodeIO->Read(sharedMemoryIO->GetBufferPointer());
+    }
+  catch (itk::ExceptionObject&)
+    {
+    return false;
+    }
+  return true;
+#else
+  (void)scene;
+  (void)nodeID;
+  (void)fileName;
+  return false;
+#endif
+}
+
+//----------------------------------------------------------------------------
+// Copy a shared memory segment written by a CLI into the image of a
+// volume node.
+static bool vtkSlicerCLIReadSharedMemoryImage(vtkMRMLScene* scene,
+                                              const std::string& nodeID,
+                                              const std::string& fileName)
+{
+#if ITK_VERSION_MAJOR > 3
+  std::string nodeFileName = vtkSlicerCLIMRMLIDFileName(scene, nodeID);
+  try
+    {
+    itk::SharedMemoryImageIO::Pointer sharedMemoryIO =
+      itk::SharedMemoryImageIO::New();
+    sharedMemoryIO->SetFileName(fileName);
+    sharedMemoryIO->ReadImageInformation();
+
+    itk::ImageIOBase::Pointer nodeIO = itk::ImageIOFactory::CreateImageIO(
+      nodeFileName.c_str(), itk::ImageIOFactory::WriteMode);
+    if (nodeIO.IsNull())
+      {
+      return false;
+      }
+    vtkSlicerCLICopyImageInformation(sharedMemoryIO, nodeIO);
+    nodeIO->SetFileName(nodeFileName);
+    nodeIO->Write(sharedMemoryIO->GetBufferPointer());
+    }
+  catch (itk::ExceptionObject&)
+    {
+    return false;
+    }
+  return true;
+#else
+  (void)scene;
+  (void)nodeID;
+  (void)fileName;
+  return false;
+#endif
+}
+
+//----------------------------------------------------------------------------
+static bool vtkSlicerCLIRemoveSharedMemoryImage(const std::string& fileName)
+{
+#if ITK_VERSION_MAJOR > 3
+  return itk::SharedMemoryImageIO::RemoveSegment(fileName.c_str());
+#else
+  (void)fileName;
+  return false;
+#endif
+}
+
 //---------------------------------------------------------------------------
 class vtkSlicerCLIRescheduleCallback : public vtkCallbackCommand
 {
@@ -130,7 +264,9 @@ public:
       }
     else
       {
-      std::remove(this->ThreadIDs.begin(), this->ThreadIDs.end(), id);
+      this->ThreadIDs.erase(
+        std::remove(this->ThreadIDs.begin(), this->ThreadIDs.end(), id),
+        this->ThreadIDs.end());
       }
   }
 protected:
@@ -256,6 +392,8 @@ public:
 
   int RedirectModuleStreams;
 
+  int SharedMemoryTransfer;
+
   std::string TemporaryDirectory;
 
   typedef std::vector<std::pair<int, vtkMRMLCommandLineModuleNode*> > RequestType;
@@ -354,6 +492,7 @@ vtkSlicerCLIModuleLogic::vtkSlicerCLIModuleLogic()
 
   this->Internal->DeleteTemporaryFiles = 1;
   this->Internal->RedirectModuleStreams = 1;
+  this->Internal->SharedMemoryTransfer = 0;
   this->Internal->RescheduleCallback =
     vtkSmartPointer<vtkSlicerCLIRescheduleCallback>::New();
   this->Internal->RescheduleCallback->SetCLIModuleLogic(this);
@@ -467,6 +606,35 @@ int vtkSlicerCLIModuleLogic::GetRedirectModuleStreams() const
   return this->Internal->RedirectModuleStreams;
 }
 
+//----------------------------------------------------------------------------
+void vtkSlicerCLIModuleLogic::SharedMemoryTransferOn()
+{
+  this->SetSharedMemoryTransfer(1);
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerCLIModuleLogic::SharedMemoryTransferOff()
+{
+  this->SetSharedMemoryTransfer(0);
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerCLIModuleLogic::SetSharedMemoryTransfer(int value)
+{
+  vtkDebugMacro(<< this->GetClassName() << " (" << this << "): setting SharedMemoryTransfer to " << value);
+  if (this->Internal->SharedMemoryTransfer != value)
+    {
+    this->Internal->SharedMemoryTransfer = value;
+    this->Modified();
+    }
+}
+
+//----------------------------------------------------------------------------
+int vtkSlicerCLIModuleLogic::GetSharedMemoryTransfer() const
+{
+  return this->Internal->SharedMemoryTransfer;
+}
+
 //----------------------------------------------------------------------------
 std::string
 vtkSlicerCLIModuleLogic
@@ -507,6 +675,39 @@ vtkSlicerCLIModuleLogic
   return fname;
 }
 
+//----------------------------------------------------------------------------
+std::string vtkSlicerCLIModuleLogic
+::ConstructSharedMemoryFileName(const std::string& nodeID,
+                                vtkMRMLCommandLineModuleNode* cliNode)
+{
+#if ITK_VERSION_MAJOR > 3
+  if (!itk::SharedMemoryImageIO::IsSupported())
+    {
+    return std::string();
+    }
+  // Segment names are limited (31 characters on Mac OS X): hash the node
+  // and CLI node IDs so that CLIs running at the same time on the same
+  // node don't use the same segment.
+  std::string key = nodeID + "#" + (cliNode->GetID() ? cliNode->GetID() : "");
+  unsigned int hash = 2166136261u;
+  for (std::string::size_type i = 0; i < key.size(); ++i)
+    {
+    hash = (hash ^ static_cast<unsigned char>(key[i])) * 16777619u;
+    }
+  std::ostringstream name;
+  name << "/slicer_";
+#ifndef _WIN32
+  name << getpid() << "_";
+#endif
+  name << std::hex << hash;
+  return itk::SharedMemoryImageIO::GetFileName(name.str());
+#else
+  (void)nodeID;
+  (void)cliNode;
+  return std::string();
+#endif
+}
+
 //----------------------------------------------------------------------------
 std::string
 vtkSlicerCLIModuleLogic
@@ -594,16 +795,7 @@ vtkSlicerCLIModuleLogic
       // tree.
 
       // Redefine the filename to be a reference to a slicer node.
-
-      // Must be large enough to hold slicer:, #, an ascii
-      // representation of the scene pointer and the MRML node ID.
-      char *tname = new char[name.size() + 100];
-
-      sprintf(tname, "slicer:%p#%s", this->GetMRMLScene(), name.c_str());
-
-      fname = tname;
-
-      delete [] tname;
+      fname = vtkSlicerCLIMRMLIDFileName(this->GetMRMLScene(), name);
       }
     }
 
@@ -895,6 +1087,13 @@ void vtkSlicerCLIModuleLogic::ApplyTask(void *clientdata)
   // vector of files to delete
   std::set<std::string> filesToDelete;
 
+  // shared memory segments used to exchange images with an executable CLI
+  // and the files to use instead if the segment can't be created
+  std::set<std::string> sharedMemoryClassNames;
+  sharedMemoryClassNames.insert("vtkMRMLScalarVolumeNode");
+  sharedMemoryClassNames.insert("vtkMRMLVectorVolumeNode");
+  std::map<std::string, std::string> sharedMemoryFiles;
+
   // iterators for parameter groups
   std::vector<ModuleParameterGroup>::iterator pgbeginit
     = node0->GetModuleDescription().GetParameterGroups().begin();
@@ -945,7 +1144,28 @@ void vtkSlicerCLIModuleLogic::ApplyTask(void *clientdata)
                                              (*pit).GetFileExtensions(),
                                              commandType);
 
-        filesToDelete.insert(fname);
+        // Executable CLIs can exchange scalar and vector volumes through
+        // shared memory, the file name is kept in case the volume can't be
+        // written in a segment.
+        std::string sharedMemoryFileName;
+        vtkMRMLNode* imageNode = this->GetMRMLScene()->GetNodeByID(id);
+        if (this->GetSharedMemoryTransfer() && imageNode &&
+            commandType == CommandLineModule &&
+            (*pit).GetTag() == "image" &&
+            (*pit).GetType() != "dynamic-contrast-enhanced" &&
+            sharedMemoryClassNames.count(imageNode->GetClassName()))
+          {
+          sharedMemoryFileName = this->ConstructSharedMemoryFileName(id, node0);
+          }
+        if (!sharedMemoryFileName.empty())
+          {
+          sharedMemoryFiles[sharedMemoryFileName] = fname;
+          fname = sharedMemoryFileName;
+          }
+        else
+          {
+          filesToDelete.insert(fname);
+          }
 
         if ((*pit).GetChannel() == "input")
           {
@@ -978,6 +1198,23 @@ void vtkSlicerCLIModuleLogic::ApplyTask(void *clientdata)
     vtkMRMLNode *nd
       = this->GetMRMLScene()->GetNodeByID( (*id2fn0).first.c_str() );
 
+    std::map<std::string, std::string>::const_iterator sharedMemoryIt =
+      sharedMemoryFiles.find((*id2fn0).second);
+    if (sharedMemoryIt != sharedMemoryFiles.end())
+      {
+      if (vtkSlicerCLIWriteSharedMemoryImage(this->GetMRMLScene(),
+                                             (*id2fn0).first,
+                                             (*id2fn0).second))
+        {
+        continue;
+        }
+      vtkWarningMacro("Unable to write " << nd->GetID() << " in "
+                      << (*id2fn0).second << ", using "
+                      << sharedMemoryIt->second << " instead");
+      nodesToWrite[(*id2fn0).first] = sharedMemoryIt->second;
+      filesToDelete.insert(sharedMemoryIt->second);
+      }
+
     vtkSmartPointer<vtkMRMLStorageNode> out = 0;
     vtkSmartPointer<vtkMRMLStorageNode> defaultOut = 0;
 
@@ -2262,10 +2499,33 @@ void vtkSlicerCLIModuleLogic::ApplyTask(void *clientdata)
         // reloaded.) We assume that if the user is looking at the node
         // now, he/she will still be looking at the node by the time the
         // data is reloaded by the main thread.
+        std::string fileName = (*id2fn0).second;
+        if (sharedMemoryFiles.find(fileName) != sharedMemoryFiles.end())
+          {
+          // Copy the segment into the node from this thread, like a shared
+          // object module would do, and reload the node from memory.
+          vtkMRMLNode* node = this->GetMRMLScene()->GetNodeByID((*id2fn0).first);
+          this->Internal->StartRescheduleNodeEvents(node);
+          this->Internal->RescheduleCallback->RescheduleEventsFromThreadID(
+            vtkMultiThreader::GetCurrentThreadID(), true);
+          bool read = vtkSlicerCLIReadSharedMemoryImage(
+            this->GetMRMLScene(), (*id2fn0).first, fileName);
+          this->Internal->RescheduleCallback->RescheduleEventsFromThreadID(
+            vtkMultiThreader::GetCurrentThreadID(), false);
+          this->Internal->StopRescheduleNodeEvents(node);
+          if (!read)
+            {
+            vtkErrorMacro("Unable to read " << (*id2fn0).first
+                          << " from " << fileName);
+            continue;
+            }
+          fileName = vtkSlicerCLIMRMLIDFileName(this->GetMRMLScene(),
+                                                (*id2fn0).first);
+          }
         bool displayData = this->IsCommandLineModuleNodeUpdatingDisplay(node0);
         bool deleteFile = this->GetDeleteTemporaryFiles();
         int requestUID = this->GetApplicationLogic()
-          ->RequestReadData((*id2fn0).first.c_str(), (*id2fn0).second.c_str(),
+          ->RequestReadData((*id2fn0).first.c_str(), fileName.c_str(),
                             displayData, deleteFile);
         this->Internal->SetLastRequest(node0, requestUID);
 
@@ -2431,6 +2691,13 @@ void vtkSlicerCLIModuleLogic::ApplyTask(void *clientdata)
           }
         }
       }
+    // Segments that were never created (e.g. input written in a file
+    // instead) are simply not found.
+    std::map<std::string, std::string>::const_iterator sit;
+    for (sit = sharedMemoryFiles.begin(); sit != sharedMemoryFiles.end(); ++sit)
+      {
+      vtkSlicerCLIRemoveSharedMemoryImage(sit->first);
+      }
     }
 
   // The CLI node is only completed if the outputs are loaded back into the
@@ -80,6 +80,17 @@ public:
   void SetRedirectModuleStreams(int value);
   int GetRedirectModuleStreams() const;
 
+  /// Pass the scalar and vector volumes to and from executable CLIs through
+  /// shared memory segments instead of temporary files.
+  /// The CLI must read and write its images with ITK and register the Slicer
+  /// ITK factories (all the CLIs built with SlicerExecutionModel do).
+  /// Volumes that can't be written in a segment are passed in files.
+  /// Off by default.
+  virtual void SharedMemoryTransferOn();
+  virtual void SharedMemoryTransferOff();
+  void SetSharedMemoryTransfer(int value);
+  int GetSharedMemoryTransfer() const;
+
   /// Schedules the command line module to run.
   /// The CLI is scheduled to be run in a separate thread. This methods
   /// is non blocking and returns immediately.
@@ -121,6 +132,12 @@ protected:
                                      const std::vector<std::string>& extensions,
                                      CommandLineModuleType commandType);
   std::string ConstructTemporarySceneFileName(vtkMRMLScene *scene);
+  /// Return the name of the shared memory segment used to pass the image of
+  /// a node to an executable CLI, or an empty string if shared memory
+  /// is not supported.
+  /// \sa SetSharedMemoryTransfer()
+  std::string ConstructSharedMemoryFileName(const std::string& nodeID,
+                                    vtkMRMLCommandLineModuleNode* cliNode);
   std::string FindHiddenNodeID(const ModuleDescription& d,
                                const ModuleParameter& p);
 
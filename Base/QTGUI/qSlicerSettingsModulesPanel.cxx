@@ -118,6 +118,7 @@ void qSlicerSettingsModulesPanelPrivate::init()
 
   // Default values
   this->PreferExecutableCLICheckBox->setChecked(false);
+  this->CLISharedMemoryTransferCheckBox->setChecked(false);
   this->TemporaryDirectoryButton->setDirectory(coreApp->defaultTemporaryPath());
   this->DisableModulesListView->setFactoryManager( factoryManager );
   this->FavoritesModulesListView->setFactoryManager( factoryManager );
@@ -143,6 +144,8 @@ void qSlicerSettingsModulesPanelPrivate::init()
 
   q->registerProperty("Modules/PreferExecutableCLI", this->PreferExecutableCLICheckBox,
                       "checked", SIGNAL(toggled(bool)));
+  q->registerProperty("Modules/CLISharedMemoryTransfer", this->CLISharedMemoryTransferCheckBox,
+                      "checked", SIGNAL(toggled(bool)));
   q->registerProperty("Modules/HomeModule", this->ModulesMenu,
                       "currentModule", SIGNAL(currentModuleChanged(QString)));
   q->registerProperty("Modules/FavoriteModules", this->FavoritesModulesListView->filterModel(),
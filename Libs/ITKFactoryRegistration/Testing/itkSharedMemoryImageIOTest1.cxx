@@ -0,0 +1,263 @@
+// ITKFactoryRegistration includes
+#include "itkFactoryRegistration.h"
+#include "itkSharedMemoryImageIO.h"
+
+// ITK includes
+#include <itkImage.h>
+#include <itkImageFileReader.h>
+#include <itkImageFileWriter.h>
+#include <itkVectorImage.h>
+#include <itksys/SystemTools.hxx>
+
+// STD includes
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+
+#ifndef _WIN32
+# include <unistd.h>
+#endif
+
+namespace
+{
+
+//----------------------------------------------------------------------------
+template <class TImage>
+typename TImage::Pointer CreateImage(unsigned int numberOfComponents)
+{
+  typename TImage::Pointer image = TImage::New();
+  typename TImage::SizeType size;
+  typename TImage::SpacingType spacing;
+  typename TImage::PointType origin;
+  for (unsigned int i = 0; i < TImage::ImageDimension; ++i)
+    {
+    size[i] = 5 - i;
+    spacing[i] = 0.5 + i;
+    origin[i] = -10. + 3. * i;
+    }
+  typename TImage::RegionType region;
+  region.SetSize(size);
+  image->SetRegions(region);
+  image->SetSpacing(spacing);
+  image->SetOrigin(origin);
+  // rotation of the first 2 axes
+  typename TImage::DirectionType direction;
+  direction.SetIdentity();
+  direction[0][0] = 0.6;
+  direction[0][1] = -0.8;
+  direction[1][0] = 0.8;
+  direction[1][1] = 0.6;
+  image->SetDirection(direction);
+  image->SetNumberOfComponentsPerPixel(numberOfComponents);
+  image->Allocate();
+
+  typedef typename TImage::InternalPixelType ValueType;
+  ValueType* buffer = image->GetBufferPointer();
+  size_t count = region.GetNumberOfPixels() * numberOfComponents;
+  for (size_t i = 0; i < count; ++i)
+    {
+    buffer[i] = static_cast<ValueType>(static_cast<int>((i * 37) % 251) - 100);
+    }
+  return image;
+}
+
+//----------------------------------------------------------------------------
+template <class TImage>
+bool CompareImages(TImage* expected, TImage* actual, const char* name)
+{
+  if (expected->GetLargestPossibleRegion() != actual->GetLargestPossibleRegion() ||
+      expected->GetNumberOfComponentsPerPixel() != actual->GetNumberOfComponentsPerPixel())
+    {
+    std::cerr << name << ": wrong region or number of components" << std::endl;
+    return false;
+    }
+  for (unsigned int i = 0; i < TImage::ImageDimension; ++i)
+    {
+    if (fabs(expected->GetSpacing()[i] - actual->GetSpacing()[i]) > 1e-9 ||
+        fabs(expected->GetOrigin()[i] - actual->GetOrigin()[i]) > 1e-9)
+      {
+      std::cerr << name << ": wrong spacing or origin" << std::endl;
+      return false;
+      }
+    for (unsigned int j = 0; j < TImage::ImageDimension; ++j)
+      {
+      if (fabs(expected->GetDirection()[i][j] - actual->GetDirection()[i][j]) > 1e-9)
+        {
+        std::cerr << name << ": wrong direction" << std::endl;
+        return false;
+        }
+      }
+    }
+  size_t count = expected->GetLargestPossibleRegion().GetNumberOfPixels() *
+    expected->GetNumberOfComponentsPerPixel();
+  for (size_t i = 0; i < count; ++i)
+    {
+    if (expected->GetBufferPointer()[i] != actual->GetBufferPointer()[i])
+      {
+      std::cerr << name << ": wrong value " << i << std::endl;
+      return false;
+      }
+    }
+  return true;
+}
+
+//----------------------------------------------------------------------------
+// Write the image in the segment, or in the file if the segment can't be
+// written, like vtkSlicerCLIModuleLogic does. Return the name used.
+template <class TImage>
+std::string WriteImage(TImage* image, const std::string& sharedMemoryFileName,
+                       const std::string& fallbackFileName)
+{
+  typedef itk::ImageFileWriter<TImage> WriterType;
+  typename WriterType::Pointer writer = WriterType::New();
+  writer->SetInput(image);
+  try
+    {
+    writer->SetFileName(sharedMemoryFileName);
+    writer->Update();
+    return sharedMemoryFileName;
+    }
+  catch (itk::ExceptionObject&)
+    {
+    itk::SharedMemoryImageIO::RemoveSegment(sharedMemoryFileName.c_str());
+    }
+  writer = WriterType::New();
+  writer->SetInput(image);
+  writer->SetFileName(fallbackFileName);
+  writer->Update();
+  return fallbackFileName;
+}
+
+//----------------------------------------------------------------------------
+template <class TImage>
+typename TImage::Pointer ReadImage(const std::string& fileName)
+{
+  typedef itk::ImageFileReader<TImage> ReaderType;
+  typename ReaderType::Pointer reader = ReaderType::New();
+  reader->SetFileName(fileName);
+  reader->Update();
+  return reader->GetOutput();
+}
+
+} // end of anonymous namespace
+
+//----------------------------------------------------------------------------
+int main(int argc, char* argv[])
+{
+  if (argc < 2)
+    {
+    std::cerr << "Usage: " << argv[0] << " <temporary directory>" << std::endl;
+    return EXIT_FAILURE;
+    }
+  std::string temporaryDirectory = argv[1];
+
+  itk::itkFactoryRegistration();
+
+  std::ostringstream segmentName;
+  segmentName << "/slicer_test_";
+#ifndef _WIN32
+  segmentName << getpid();
+#endif
+  std::string sharedMemoryFileName =
+    itk::SharedMemoryImageIO::GetFileName(segmentName.str());
+  std::string fallbackFileName =
+    temporaryDirectory + "/itkSharedMemoryImageIOTest1.nrrd";
+
+  itk::SharedMemoryImageIO::Pointer io = itk::SharedMemoryImageIO::New();
+  if (io->CanWriteFile(fallbackFileName.c_str()) ||
+      io->CanReadFile(fallbackFileName.c_str()) ||
+      io->CanWriteFile(sharedMemoryFileName.c_str()) !=
+        itk::SharedMemoryImageIO::IsSupported())
+    {
+    std::cerr << "Line " << __LINE__ << ": wrong file name support" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  try
+    {
+    //------------------------------------------------------------------------
+    // Scalar image round trip through the segment
+    typedef itk::Image<short, 3> ScalarImageType;
+    ScalarImageType::Pointer scalarImage = CreateImage<ScalarImageType>(1);
+    std::string fileName = WriteImage<ScalarImageType>(
+      scalarImage, sharedMemoryFileName, fallbackFileName);
+    if (itk::SharedMemoryImageIO::IsSupported() &&
+        fileName != sharedMemoryFileName)
+      {
+      std::cerr << "Line " << __LINE__ << ": the segment was not written"
+                << std::endl;
+      return EXIT_FAILURE;
+      }
+    ScalarImageType::Pointer readScalarImage = ReadImage<ScalarImageType>(fileName);
+    if (!CompareImages<ScalarImageType>(scalarImage, readScalarImage, "Scalar"))
+      {
+      return EXIT_FAILURE;
+      }
+
+    //------------------------------------------------------------------------
+    // The segment is resized for a vector image
+    typedef itk::VectorImage<float, 3> VectorImageType;
+    VectorImageType::Pointer vectorImage = CreateImage<VectorImageType>(3);
+    fileName = WriteImage<VectorImageType>(
+      vectorImage, sharedMemoryFileName, fallbackFileName);
+    VectorImageType::Pointer readVectorImage = ReadImage<VectorImageType>(fileName);
+    if (!CompareImages<VectorImageType>(vectorImage, readVectorImage, "Vector"))
+      {
+      return EXIT_FAILURE;
+      }
+
+    if (itk::SharedMemoryImageIO::IsSupported())
+      {
+      if (!itk::SharedMemoryImageIO::RemoveSegment(sharedMemoryFileName.c_str()))
+        {
+        std::cerr << "Line " << __LINE__ << ": the segment was not removed"
+                  << std::endl;
+        return EXIT_FAILURE;
+        }
+      // the removed segment can't be read anymore
+      bool exceptionCaught = false;
+      try
+        {
+        ReadImage<ScalarImageType>(sharedMemoryFileName);
+        }
+      catch (itk::ExceptionObject&)
+        {
+        exceptionCaught = true;
+        }
+      if (!exceptionCaught)
+        {
+        std::cerr << "Line " << __LINE__ << ": a removed segment was read"
+                  << std::endl;
+        return EXIT_FAILURE;
+        }
+      }
+
+    //------------------------------------------------------------------------
+    // Images that can't be written in a segment fall back to a file
+    typedef itk::Image<short, 4> Image4DType;
+    Image4DType::Pointer image4D = CreateImage<Image4DType>(1);
+    fileName = WriteImage<Image4DType>(
+      image4D, sharedMemoryFileName, fallbackFileName);
+    if (fileName != fallbackFileName)
+      {
+      std::cerr << "Line " << __LINE__ << ": 4D image written in a segment"
+                << std::endl;
+      return EXIT_FAILURE;
+      }
+    Image4DType::Pointer readImage4D = ReadImage<Image4DType>(fileName);
+    if (!CompareImages<Image4DType>(image4D, readImage4D, "Fallback"))
+      {
+      return EXIT_FAILURE;
+      }
+    itksys::SystemTools::RemoveFile(fallbackFileName.c_str());
+    }
+  catch (itk::ExceptionObject& exception)
+    {
+    std::cerr << exception << std::endl;
+    itk::SharedMemoryImageIO::RemoveSegment(sharedMemoryFileName.c_str());
+    return EXIT_FAILURE;
+    }
+
+  return EXIT_SUCCESS;
+}
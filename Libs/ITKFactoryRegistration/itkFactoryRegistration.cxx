@@ -1,5 +1,5 @@
-
 #include "itkFactoryRegistration.h"
+#include "itkSharedMemoryImageIOFactory.h"
 
 // ITK includes
 #include <itkImageFileReader.h>
@@ -10,6 +10,13 @@
 // optimized out by the compiler.
 void itk::itkFactoryRegistration(void)
 {
+  // Images exchanged with Slicer through shared memory
+  // (see vtkSlicerCLIModuleLogic::SetSharedMemoryTransfer())
+  static bool sharedMemoryFactoryRegistered = false;
+  if (!sharedMemoryFactoryRegistered)
+    {
+    itk::SharedMemoryImageIOFactory::RegisterOneFactory();
+    sharedMemoryFactoryRegistered = true;
+    }
   return;
 }
-
@@ -0,0 +1,329 @@
+#include "itkSharedMemoryImageIO.h"
+
+// STD includes
+#include <cstring>
+
+#ifndef _WIN32
+# include <fcntl.h>
+# include <sys/mman.h>
+# include <sys/stat.h>
+# include <unistd.h>
+#endif
+
+namespace
+{
+
+const char SharedMemoryScheme[] = "slicershm:";
+const char SharedMemoryMagic[8] = "SLCRSHM";
+const unsigned int SharedMemoryVersion = 1;
+
+// Layout of the beginning of the segment, the pixels start at
+// SharedMemoryHeaderSize.
+struct SharedMemoryImageHeader
+{
+  char Magic[8];
+  unsigned int Version;
+  unsigned int NumberOfDimensions;
+  int ComponentType;
+  int PixelType;
+  unsigned int NumberOfComponents;
+  unsigned int Reserved;
+  unsigned long long Dimensions[3];
+  double Spacing[3];
+  double Origin[3];
+  // Direction[3*i + j] is the component j of the axis i
+  double Direction[9];
+  unsigned long long ImageSizeInBytes;
+};
+
+// Keep the pixels aligned on a cache line
+const size_t SharedMemoryHeaderSize = 512;
+
+} // end of anonymous namespace
+
+namespace itk
+{
+
+SharedMemoryImageIO
+::SharedMemoryImageIO()
+{
+  this->Mapping = 0;
+  this->MappingSize = 0;
+  this->MappingWritable = false;
+}
+
+SharedMemoryImageIO
+::~SharedMemoryImageIO()
+{
+  this->UnmapSegment();
+}
+
+bool
+SharedMemoryImageIO
+::IsSupported()
+{
+#ifndef _WIN32
+  return true;
+#else
+  return false;
+#endif
+}
+
+bool
+SharedMemoryImageIO
+::IsSharedMemoryFileName(const char* filename)
+{
+  return filename &&
+    strncmp(filename, SharedMemoryScheme, strlen(SharedMemoryScheme)) == 0 &&
+    filename[strlen(SharedMemoryScheme)] == '/';
+}
+
+std::string
+SharedMemoryImageIO
+::GetFileName(const std::string& segmentName)
+{
+  return std::string(SharedMemoryScheme) + segmentName;
+}
+
+bool
+SharedMemoryImageIO
+::RemoveSegment(const char* filename)
+{
+  if (!IsSupported() || !IsSharedMemoryFileName(filename))
+    {
+    return false;
+    }
+#ifndef _WIN32
+  return shm_unlink(filename + strlen(SharedMemoryScheme)) == 0;
+#else
+  return false;
+#endif
+}
+
+bool
+SharedMemoryImageIO
+::SupportsDimension(unsigned long dim)
+{
+  return dim >= 1 && dim <= 3;
+}
+
+bool
+SharedMemoryImageIO
+::CanReadFile(const char* filename)
+{
+  return IsSupported() && IsSharedMemoryFileName(filename);
+}
+
+bool
+SharedMemoryImageIO
+::CanWriteFile(const char* filename)
+{
+  return IsSupported() && IsSharedMemoryFileName(filename);
+}
+
+void*
+SharedMemoryImageIO
+::GetBufferPointer()
+{
+  if (!this->Mapping)
+    {
+    return 0;
+    }
+  return static_cast<char*>(this->Mapping) + SharedMemoryHeaderSize;
+}
+
+bool
+SharedMemoryImageIO
+::MapSegment(size_t size)
+{
+  this->UnmapSegment();
+  if (!this->CanReadFile(m_FileName.c_str()))
+    {
+    return false;
+    }
+#ifndef _WIN32
+  const char* segmentName = m_FileName.c_str() + strlen(SharedMemoryScheme);
+  bool create = (size != 0);
+  int fd = create ? shm_open(segmentName, O_CREAT | O_RDWR, 0600)
+                  : shm_open(segmentName, O_RDONLY, 0);
+  if (fd < 0)
+    {
+    return false;
+    }
+  if (create)
+    {
+    if (ftruncate(fd, size) != 0)
+      {
+      close(fd);
+      return false;
+      }
+    }
+  else
+    {
+    struct stat status;
+    if (fstat(fd, &status) != 0 ||
+        static_cast<size_t>(status.st_size) < SharedMemoryHeaderSize)
+      {
+      close(fd);
+      return false;
+      }
+    size = static_cast<size_t>(status.st_size);
+    }
+  void* mapping = mmap(0, size, create ? (PROT_READ | PROT_WRITE) : PROT_READ,
+                       MAP_SHARED, fd, 0);
+  // the mapping stays valid after the descriptor is closed
+  close(fd);
+  if (mapping == MAP_FAILED)
+    {
+    return false;
+    }
+  this->Mapping = mapping;
+  this->MappingSize = size;
+  this->MappingWritable = create;
+  this->MappedFileName = m_FileName;
+  return true;
+#else
+  return false;
+#endif
+}
+
+void
+SharedMemoryImageIO
+::UnmapSegment()
+{
+#ifndef _WIN32
+  if (this->Mapping)
+    {
+    munmap(this->Mapping, this->MappingSize);
+    }
+#endif
+  this->Mapping = 0;
+  this->MappingSize = 0;
+  this->MappingWritable = false;
+  this->MappedFileName = "";
+}
+
+void
+SharedMemoryImageIO
+::ReadImageInformation()
+{
+  if (!this->MapSegment(0))
+    {
+    itkExceptionMacro("Could not map the shared memory segment " << m_FileName);
+    }
+  const SharedMemoryImageHeader* header =
+    static_cast<const SharedMemoryImageHeader*>(this->Mapping);
+  if (memcmp(header->Magic, SharedMemoryMagic, sizeof(SharedMemoryMagic)) != 0 ||
+      header->Version != SharedMemoryVersion ||
+      header->NumberOfDimensions < 1 || header->NumberOfDimensions > 3 ||
+      SharedMemoryHeaderSize + header->ImageSizeInBytes > this->MappingSize)
+    {
+    this->UnmapSegment();
+    itkExceptionMacro(<< m_FileName << " is not a valid image segment");
+    }
+
+  unsigned int dimension = header->NumberOfDimensions;
+  this->SetNumberOfDimensions(dimension);
+  for (unsigned int i = 0; i < dimension; ++i)
+    {
+    this->SetDimensions(i, header->Dimensions[i]);
+    this->SetSpacing(i, header->Spacing[i]);
+    this->SetOrigin(i, header->Origin[i]);
+    std::vector<double> axis(dimension);
+    for (unsigned int j = 0; j < dimension; ++j)
+      {
+      axis[j] = header->Direction[3*i + j];
+      }
+    this->SetDirection(i, axis);
+    }
+  this->SetComponentType(static_cast<IOComponentType>(header->ComponentType));
+  this->SetPixelType(static_cast<IOPixelType>(header->PixelType));
+  this->SetNumberOfComponents(header->NumberOfComponents);
+
+  if (static_cast<unsigned long long>(this->GetImageSizeInBytes()) !=
+      header->ImageSizeInBytes)
+    {
+    this->UnmapSegment();
+    itkExceptionMacro(<< m_FileName << " has an inconsistent image size");
+    }
+}
+
+void
+SharedMemoryImageIO
+::Read(void* buffer)
+{
+  if (!this->Mapping || this->MappedFileName != m_FileName)
+    {
+    this->ReadImageInformation();
+    }
+  memcpy(buffer, this->GetBufferPointer(), this->GetImageSizeInBytes());
+}
+
+void
+SharedMemoryImageIO
+::WriteImageInformation()
+{
+  unsigned int dimension = this->GetNumberOfDimensions();
+  if (!this->SupportsDimension(dimension))
+    {
+    itkExceptionMacro("Images of dimension " << dimension
+                      << " are not supported");
+    }
+  size_t imageSize = static_cast<size_t>(this->GetImageSizeInBytes());
+  if (!this->MapSegment(SharedMemoryHeaderSize + imageSize))
+    {
+    itkExceptionMacro("Could not create the shared memory segment "
+                      << m_FileName);
+    }
+
+  SharedMemoryImageHeader* header =
+    static_cast<SharedMemoryImageHeader*>(this->Mapping);
+  memset(header, 0, sizeof(SharedMemoryImageHeader));
+  memcpy(header->Magic, SharedMemoryMagic, sizeof(SharedMemoryMagic));
+  header->Version = SharedMemoryVersion;
+  header->NumberOfDimensions = dimension;
+  header->ComponentType = this->GetComponentType();
+  header->PixelType = this->GetPixelType();
+  header->NumberOfComponents = this->GetNumberOfComponents();
+  for (unsigned int i = 0; i < dimension; ++i)
+    {
+    header->Dimensions[i] = this->GetDimensions(i);
+    header->Spacing[i] = this->GetSpacing(i);
+    header->Origin[i] = this->GetOrigin(i);
+    std::vector<double> axis = this->GetDirection(i);
+    for (unsigned int j = 0; j < dimension && j < axis.size(); ++j)
+      {
+      header->Direction[3*i + j] = axis[j];
+      }
+    }
+  header->ImageSizeInBytes = imageSize;
+}
+
+void
+SharedMemoryImageIO
+::Write(const void* buffer)
+{
+  if (!this->Mapping || !this->MappingWritable ||
+      this->MappedFileName != m_FileName ||
+      this->MappingSize !=
+        SharedMemoryHeaderSize + static_cast<size_t>(this->GetImageSizeInBytes()))
+    {
+    this->WriteImageInformation();
+    }
+  if (buffer != this->GetBufferPointer())
+    {
+    memcpy(this->GetBufferPointer(), buffer, this->GetImageSizeInBytes());
+    }
+}
+
+void
+SharedMemoryImageIO
+::PrintSelf(std::ostream& os, Indent indent) const
+{
+  Superclass::PrintSelf(os, indent);
+
+  os << indent << "MappedFileName: " << this->MappedFileName << std::endl;
+  os << indent << "MappingSize: " << this->MappingSize << std::endl;
+}
+
+} // end namespace itk
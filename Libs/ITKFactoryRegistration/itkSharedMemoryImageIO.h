@@ -0,0 +1,108 @@
+#ifndef __itkSharedMemoryImageIO_h
+#define __itkSharedMemoryImageIO_h
+
+// ITK includes
+#include <itkImageIOBase.h>
+
+#include "itkFactoryRegistrationConfigure.h"
+
+namespace itk
+{
+/** \class SharedMemoryImageIO
+ * \brief ImageIO object to exchange images through a POSIX shared memory
+ * segment
+ *
+ * SharedMemoryImageIO allows Slicer to pass images to an executable command
+ * line module (and to get them back) without writing them to disk. The
+ * "filename" of the image is the name of the segment prefixed with
+ * "slicershm:":
+ *     slicershm:/<segment name>
+ *
+ * The segment contains a fixed size header with the image information
+ * (dimensions, spacing, origin, direction and pixel type) followed by the
+ * pixels.
+ * WriteImageInformation() creates (or resizes) the segment and maps it,
+ * ReadImageInformation() maps an existing segment. Once mapped,
+ * GetBufferPointer() gives access to the pixels so that they can be
+ * read or written in place.
+ *
+ * The segment is not removed when the IO is destroyed: the process that
+ * named it is in charge of calling RemoveSegment().
+ */
+class ITKFactoryRegistration_EXPORT SharedMemoryImageIO : public ImageIOBase
+{
+public:
+  /** Standard class typedefs. */
+  typedef SharedMemoryImageIO Self;
+  typedef ImageIOBase         Superclass;
+  typedef SmartPointer<Self>  Pointer;
+
+  /** Method for creation through the object factory. */
+  itkNewMacro(Self);
+
+  /** Run-time type information (and related methods). */
+  itkTypeMacro(SharedMemoryImageIO, ImageIOBase);
+
+  /** Return true if shared memory segments can be used on this platform. */
+  static bool IsSupported();
+
+  /** Return true if the filename is a shared memory segment URI. */
+  static bool IsSharedMemoryFileName(const char* filename);
+
+  /** Return the URI of the segment named \a segmentName. */
+  static std::string GetFileName(const std::string& segmentName);
+
+  /** Remove the segment referenced by \a filename.
+   * Return false if there is no such segment. */
+  static bool RemoveSegment(const char* filename);
+
+  /** Images up to 3D are supported. */
+  virtual bool SupportsDimension(unsigned long dim);
+
+  /** Determine the file type. Returns true if this ImageIO can read the
+   * file specified. */
+  virtual bool CanReadFile(const char*);
+
+  /** Map the segment and read the image information from its header. */
+  virtual void ReadImageInformation();
+
+  /** Copy the pixels of the segment into the memory buffer provided. */
+  virtual void Read(void* buffer);
+
+  /** Returns true if the filename is a shared memory segment URI. */
+  virtual bool CanWriteFile(const char*);
+
+  /** Create the segment, map it and write the image information in its
+   * header. */
+  virtual void WriteImageInformation();
+
+  /** Copy the memory buffer provided into the segment. Nothing is copied if
+   * the buffer is the one returned by GetBufferPointer(). */
+  virtual void Write(const void* buffer);
+
+  /** Pixels of the mapped segment, NULL if no segment is mapped. */
+  void* GetBufferPointer();
+
+protected:
+  SharedMemoryImageIO();
+  ~SharedMemoryImageIO();
+  void PrintSelf(std::ostream& os, Indent indent) const;
+
+  /** Map the segment of m_FileName, create it with \a size bytes
+   * if \a size is not 0. */
+  bool MapSegment(size_t size);
+  void UnmapSegment();
+
+private:
+  SharedMemoryImageIO(const Self&); //purposely not implemented
+  void operator=(const Self&); //purposely not implemented
+
+  void*       Mapping;
+  size_t      MappingSize;
+  bool        MappingWritable;
+  std::string MappedFileName;
+};
+
+} // end namespace itk
+
+#endif // __itkSharedMemoryImageIO_h
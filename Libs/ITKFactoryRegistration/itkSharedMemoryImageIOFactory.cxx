@@ -0,0 +1,35 @@
+#include "itkSharedMemoryImageIOFactory.h"
+#include "itkSharedMemoryImageIO.h"
+
+// ITK includes
+#include <itkVersion.h>
+
+namespace itk
+{
+
+SharedMemoryImageIOFactory::SharedMemoryImageIOFactory()
+{
+  this->RegisterOverride("itkImageIOBase",
+                         "itkSharedMemoryImageIO",
+                         "ImageIO to exchange images through shared memory.",
+                         1,
+                         CreateObjectFunction<SharedMemoryImageIO>::New());
+}
+
+SharedMemoryImageIOFactory::~SharedMemoryImageIOFactory()
+{
+}
+
+const char*
+SharedMemoryImageIOFactory::GetITKSourceVersion(void) const
+{
+  return ITK_SOURCE_VERSION;
+}
+
+const char*
+SharedMemoryImageIOFactory::GetDescription() const
+{
+  return "ImageIOFactory that imports/exports data to a shared memory segment.";
+}
+
+} // end namespace itk
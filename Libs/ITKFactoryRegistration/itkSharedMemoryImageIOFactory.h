@@ -0,0 +1,55 @@
+#ifndef __itkSharedMemoryImageIOFactory_h
+#define __itkSharedMemoryImageIOFactory_h
+
+// ITK includes
+#include <itkImageIOBase.h>
+#include <itkObjectFactoryBase.h>
+
+#include "itkFactoryRegistrationConfigure.h"
+
+namespace itk
+{
+/** \class SharedMemoryImageIOFactory
+ * \brief Create instances of SharedMemoryImageIO objects using an object
+ * factory.
+ */
+class ITKFactoryRegistration_EXPORT SharedMemoryImageIOFactory
+  : public ObjectFactoryBase
+{
+public:
+  /** Standard class typedefs. */
+  typedef SharedMemoryImageIOFactory Self;
+  typedef ObjectFactoryBase          Superclass;
+  typedef SmartPointer<Self>         Pointer;
+  typedef SmartPointer<const Self>   ConstPointer;
+
+  /** Class methods used to interface with the registered factories. */
+  virtual const char* GetITKSourceVersion(void) const;
+  virtual const char* GetDescription(void) const;
+
+  /** Method for class instantiation. */
+  itkFactorylessNewMacro(Self);
+
+  /** Run-time type information (and related methods). */
+  itkTypeMacro(SharedMemoryImageIOFactory, ObjectFactoryBase);
+
+  /** Register one factory of this type  */
+  static void RegisterOneFactory(void)
+  {
+    SharedMemoryImageIOFactory::Pointer factory =
+      SharedMemoryImageIOFactory::New();
+    ObjectFactoryBase::RegisterFactory(factory.GetPointer());
+  }
+
+protected:
+  SharedMemoryImageIOFactory();
+  ~SharedMemoryImageIOFactory();
+
+private:
+  SharedMemoryImageIOFactory(const Self&); //purposely not implemented
+  void operator=(const Self&); //purposely not implemented
+};
+
+} // end namespace itk
+
+#endif
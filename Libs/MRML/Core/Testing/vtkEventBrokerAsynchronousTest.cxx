@@ -0,0 +1,304 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+// MRML includes
+#include "vtkEventBroker.h"
+#include "vtkObservation.h"
+
+// VTK includes
+#include <vtkCallbackCommand.h>
+#include <vtkMultiThreader.h>
+#include <vtkMutexLock.h>
+#include <vtkNew.h>
+#include <vtkSmartPointer.h>
+#include <vtkTimerLog.h>
+
+// STD includes
+#include <iostream>
+#include <vector>
+
+namespace
+{
+
+const int PostCount = 1000;
+
+//---------------------------------------------------------------------------
+void onModified(vtkObject* vtkNotUsed(caller), unsigned long vtkNotUsed(eid),
+                void* clientData, void* vtkNotUsed(callData))
+{
+  ++(*reinterpret_cast<int*>(clientData));
+}
+
+//---------------------------------------------------------------------------
+VTK_THREAD_RETURN_TYPE postObservation(void* arg)
+{
+  vtkMultiThreader::ThreadInfo* info =
+    reinterpret_cast<vtkMultiThreader::ThreadInfo*>(arg);
+  vtkObservation* observation =
+    reinterpret_cast<vtkObservation*>(info->UserData);
+  for (int i = 0; i < PostCount; ++i)
+    {
+    observation->GetEventBroker()->QueueObservation(
+      observation, vtkCommand::ModifiedEvent, 0);
+    }
+  return VTK_THREAD_RETURN_VALUE;
+}
+
+//---------------------------------------------------------------------------
+const int RemovedObservationCount = 50;
+
+//---------------------------------------------------------------------------
+// An observation and whether it has been removed
+struct RemovedObservation
+{
+  RemovedObservation()
+    : Observation(0), Removed(false), InvokedAfterRemoval(false) {}
+  vtkObservation* Observation;
+  bool Removed;
+  bool InvokedAfterRemoval;
+};
+
+//---------------------------------------------------------------------------
+// A thread posts calls for its observations one after the other, the main
+// thread removes the observations the thread is done with.
+struct PostingThread
+{
+  PostingThread() : PostedObservationCount(0) {}
+  std::vector<RemovedObservation> Observations;
+  vtkSmartPointer<vtkMutexLock> Lock;
+  int PostedObservationCount;
+};
+
+//---------------------------------------------------------------------------
+void onRemovedModified(vtkObject* vtkNotUsed(caller),
+                       unsigned long vtkNotUsed(eid),
+                       void* clientData, void* vtkNotUsed(callData))
+{
+  RemovedObservation* observation =
+    reinterpret_cast<RemovedObservation*>(clientData);
+  if (observation->Removed)
+    {
+    observation->InvokedAfterRemoval = true;
+    }
+}
+
+//---------------------------------------------------------------------------
+VTK_THREAD_RETURN_TYPE postObservations(void* arg)
+{
+  vtkMultiThreader::ThreadInfo* info =
+    reinterpret_cast<vtkMultiThreader::ThreadInfo*>(arg);
+  PostingThread* thread = reinterpret_cast<PostingThread*>(info->UserData);
+  for (int n = 0; n < RemovedObservationCount; ++n)
+    {
+    vtkObservation* observation = thread->Observations[n].Observation;
+    for (int i = 0; i < PostCount / 10; ++i)
+      {
+      observation->GetEventBroker()->QueueObservation(
+        observation, vtkCommand::ModifiedEvent, 0);
+      }
+    thread->Lock->Lock();
+    thread->PostedObservationCount = n + 1;
+    thread->Lock->Unlock();
+    }
+  return VTK_THREAD_RETURN_VALUE;
+}
+
+} // end of anonymous namespace
+
+//---------------------------------------------------------------------------
+int vtkEventBrokerAsynchronousTest(
+  int vtkNotUsed(argc), char * vtkNotUsed(argv) [] )
+{
+  vtkEventBroker* broker = vtkEventBroker::GetInstance();
+
+  vtkNew<vtkObject> subject;
+  vtkNew<vtkObject> observer;
+  int invocationCount = 0;
+  vtkNew<vtkCallbackCommand> callback;
+  callback->SetCallback(onModified);
+  callback->SetClientData(&invocationCount);
+  vtkObservation* observation = broker->AddObservation(
+    subject.GetPointer(), vtkCommand::ModifiedEvent,
+    observer.GetPointer(), callback.GetPointer());
+
+  broker->SetEventModeToAsynchronous();
+  broker->ResetEventQueueStatistics();
+
+  //---------------------------------------------------------------------------
+  // Repeated events are coalesced
+  //---------------------------------------------------------------------------
+  for (int i = 0; i < 100; ++i)
+    {
+    subject->Modified();
+    }
+  if (invocationCount != 0 ||
+      broker->GetQueueDepth() != 100 ||
+      broker->GetNumberOfQueuedObservations() != 1 ||
+      broker->GetQueueDepth() != 1 ||
+      broker->GetNthQueuedObservation(0) != observation ||
+      broker->GetNumberOfPostedEvents() != 100 ||
+      broker->GetNumberOfCoalescedEvents() != 99)
+    {
+    std::cerr << "Coalescing failed: " << invocationCount << " invocations, "
+              << broker->GetNumberOfQueuedObservations() << " queued, "
+              << broker->GetNumberOfPostedEvents() << " posted, "
+              << broker->GetNumberOfCoalescedEvents() << " coalesced"
+              << std::endl;
+    return EXIT_FAILURE;
+    }
+  broker->ProcessEventQueue();
+  if (invocationCount != 1 ||
+      broker->GetQueueDepth() != 0 ||
+      broker->GetNumberOfDeliveredEvents() != 1 ||
+      broker->GetCoalesceRatio() != 0.99 ||
+      broker->GetMaximumQueueDepth() != 1)
+    {
+    std::cerr << "ProcessEventQueue failed: " << invocationCount
+              << " invocations, ratio: " << broker->GetCoalesceRatio()
+              << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  //---------------------------------------------------------------------------
+  // Observations can be posted from multiple threads
+  //---------------------------------------------------------------------------
+  broker->ResetEventQueueStatistics();
+  invocationCount = 0;
+  vtkNew<vtkMultiThreader> threader;
+  threader->SetNumberOfThreads(4);
+  threader->SetSingleMethod(postObservation, observation);
+  vtkNew<vtkTimerLog> timerLog;
+  timerLog->StartTimer();
+  threader->SingleMethodExecute();
+  timerLog->StopTimer();
+  const int postedCount = 4 * PostCount;
+  if (broker->GetQueueDepth() != postedCount)
+    {
+    std::cerr << "Posting from threads failed: " << broker->GetQueueDepth()
+              << " posted observations instead of " << postedCount
+              << std::endl;
+    return EXIT_FAILURE;
+    }
+  std::cout << postedCount << " observations posted by 4 threads in "
+            << timerLog->GetElapsedTime() << "s" << std::endl;
+  broker->ProcessEventQueue();
+  if (invocationCount != 1 ||
+      broker->GetNumberOfPostedEvents() !=
+        static_cast<unsigned long>(postedCount) ||
+      broker->GetNumberOfCoalescedEvents() !=
+        static_cast<unsigned long>(postedCount - 1))
+    {
+    std::cerr << "Processing posted observations failed: "
+              << invocationCount << " invocations, "
+              << broker->GetNumberOfCoalescedEvents() << " coalesced"
+              << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  //---------------------------------------------------------------------------
+  // Removed observations are not invoked
+  //---------------------------------------------------------------------------
+  invocationCount = 0;
+  subject->Modified();
+  broker->RemoveObservations(observer.GetPointer());
+  broker->ProcessEventQueue();
+  broker->SetEventModeToSynchronous();
+  if (invocationCount != 0 || broker->GetQueueDepth() != 0)
+    {
+    std::cerr << "RemoveObservations failed." << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  //---------------------------------------------------------------------------
+  // Observations can be removed while threads post
+  //---------------------------------------------------------------------------
+  broker->SetEventModeToAsynchronous();
+  const int threadCount = 4;
+  std::vector<PostingThread> threads(threadCount);
+  std::vector<vtkSmartPointer<vtkCallbackCommand> > callbacks;
+  for (int t = 0; t < threadCount; ++t)
+    {
+    threads[t].Lock = vtkSmartPointer<vtkMutexLock>::New();
+    threads[t].Observations.resize(RemovedObservationCount);
+    for (int n = 0; n < RemovedObservationCount; ++n)
+      {
+      vtkSmartPointer<vtkCallbackCommand> removedCallback =
+        vtkSmartPointer<vtkCallbackCommand>::New();
+      removedCallback->SetCallback(onRemovedModified);
+      removedCallback->SetClientData(&threads[t].Observations[n]);
+      callbacks.push_back(removedCallback);
+      threads[t].Observations[n].Observation = broker->AddObservation(
+        subject.GetPointer(), vtkCommand::ModifiedEvent,
+        observer.GetPointer(), removedCallback);
+      }
+    }
+  vtkNew<vtkMultiThreader> postingThreader;
+  std::vector<int> threadIds(threadCount);
+  for (int t = 0; t < threadCount; ++t)
+    {
+    threadIds[t] = postingThreader->SpawnThread(postObservations, &threads[t]);
+    }
+  int removedCount = 0;
+  while (removedCount < threadCount * RemovedObservationCount)
+    {
+    for (int t = 0; t < threadCount; ++t)
+      {
+      threads[t].Lock->Lock();
+      int postedObservationCount = threads[t].PostedObservationCount;
+      threads[t].Lock->Unlock();
+      // remove the observations as soon as the thread is done posting,
+      // their calls may not be collected yet
+      for (int n = 0; n < postedObservationCount; ++n)
+        {
+        RemovedObservation& removedObservation = threads[t].Observations[n];
+        if (!removedObservation.Removed)
+          {
+          removedObservation.Removed = true;
+          broker->RemoveObservation(removedObservation.Observation);
+          ++removedCount;
+          }
+        }
+      }
+    broker->ProcessEventQueue();
+    }
+  for (int t = 0; t < threadCount; ++t)
+    {
+    postingThreader->TerminateThread(threadIds[t]);
+    }
+  broker->ProcessEventQueue();
+  broker->SetEventModeToSynchronous();
+  for (int t = 0; t < threadCount; ++t)
+    {
+    for (int n = 0; n < RemovedObservationCount; ++n)
+      {
+      if (threads[t].Observations[n].InvokedAfterRemoval)
+        {
+        std::cerr << "Observation " << n << " of thread " << t
+                  << " invoked after being removed." << std::endl;
+        return EXIT_FAILURE;
+        }
+      }
+    }
+  if (broker->GetQueueDepth() != 0 ||
+      broker->GetObservationExist(subject.GetPointer(),
+                                  vtkCommand::ModifiedEvent))
+    {
+    std::cerr << "Removing observations while threads post failed: "
+              << broker->GetQueueDepth() << " queued" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,132 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+// MRML includes
+#include "vtkEventBroker.h"
+
+// VTK includes
+#include <vtkCallbackCommand.h>
+#include <vtkNew.h>
+#include <vtkTable.h>
+#include <vtkTimerLog.h>
+
+// STD includes
+#include <iostream>
+#include <sstream>
+
+namespace
+{
+
+//---------------------------------------------------------------------------
+void onModified(vtkObject* vtkNotUsed(caller), unsigned long vtkNotUsed(eid),
+                void* vtkNotUsed(clientData), void* vtkNotUsed(callData))
+{
+  // Take some time
+  volatile double value = 0.;
+  for (int i = 0; i < 1000; ++i)
+    {
+    value += i;
+    }
+}
+
+} // end of anonymous namespace
+
+//---------------------------------------------------------------------------
+int vtkEventBrokerProfilingTest(
+  int vtkNotUsed(argc), char * vtkNotUsed(argv) [] )
+{
+  vtkEventBroker* broker = vtkEventBroker::GetInstance();
+
+  vtkNew<vtkObject> subject;
+  vtkNew<vtkObject> observer;
+  vtkNew<vtkCallbackCommand> callback;
+  callback->SetCallback(onModified);
+  broker->AddObservation(subject.GetPointer(), vtkCommand::ModifiedEvent,
+                         observer.GetPointer(), callback.GetPointer());
+
+  // Invocations are not profiled by default
+  subject->Modified();
+  if (broker->GetEventProfiling() || broker->GetNumberOfProfiles() != 0)
+    {
+    std::cerr << "Profiling should be off by default." << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  broker->EventProfilingOn();
+  const int invocationCount = 10000;
+  vtkNew<vtkTimerLog> timerLog;
+  timerLog->StartTimer();
+  for (int i = 0; i < invocationCount; ++i)
+    {
+    subject->Modified();
+    }
+  timerLog->StopTimer();
+  std::cout << invocationCount << " profiled invocations in "
+            << timerLog->GetElapsedTime() << "s" << std::endl;
+
+  //---------------------------------------------------------------------------
+  // Table snapshot
+  //---------------------------------------------------------------------------
+  vtkNew<vtkTable> table;
+  broker->GetProfiles(table.GetPointer());
+  if (broker->GetNumberOfProfiles() != 1 ||
+      table->GetNumberOfRows() != 1 ||
+      table->GetNumberOfColumns() != 9)
+    {
+    std::cerr << "Wrong profiles: " << broker->GetNumberOfProfiles()
+              << " profiles, " << table->GetNumberOfRows() << " rows, "
+              << table->GetNumberOfColumns() << " columns." << std::endl;
+    return EXIT_FAILURE;
+    }
+  double total = table->GetValueByName(0, "Total").ToDouble();
+  double p50 = table->GetValueByName(0, "P50").ToDouble();
+  double p99 = table->GetValueByName(0, "P99").ToDouble();
+  double max = table->GetValueByName(0, "Max").ToDouble();
+  if (table->GetValueByName(0, "SubjectClass").ToString() != "vtkObject" ||
+      table->GetValueByName(0, "Event").ToString() != "ModifiedEvent" ||
+      table->GetValueByName(0, "ObserverClass").ToString() != "vtkObject" ||
+      table->GetValueByName(0, "Count").ToInt() != invocationCount ||
+      total <= 0. || p50 > p99 || p99 > max || max > total)
+    {
+    std::cerr << "Wrong profile values: Total=" << total << " P50=" << p50
+              << " P99=" << p99 << " Max=" << max << std::endl;
+    table->Dump();
+    return EXIT_FAILURE;
+    }
+
+  //---------------------------------------------------------------------------
+  // JSON snapshot
+  //---------------------------------------------------------------------------
+  std::stringstream json;
+  broker->WriteProfilesAsJSON(json);
+  if (json.str().find("\"SubjectClass\": \"vtkObject\"") == std::string::npos ||
+      json.str().find("\"Count\": 10000") == std::string::npos)
+    {
+    std::cerr << "Wrong JSON: " << json.str() << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  broker->ResetProfiles();
+  broker->EventProfilingOff();
+  subject->Modified();
+  broker->RemoveObservations(observer.GetPointer());
+  if (broker->GetNumberOfProfiles() != 0)
+    {
+    std::cerr << "ResetProfiles failed." << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,250 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+// MRML includes
+#include "vtkImageHistogramCache.h"
+#include "vtkMRMLCoreTestingMacros.h"
+
+// VTK includes
+#include <vtkImageAccumulate.h>
+#include <vtkImageData.h>
+#include <vtkNew.h>
+#include <vtkSmartPointer.h>
+
+// STD includes
+#include <algorithm>
+#include <iostream>
+
+namespace
+{
+
+//---------------------------------------------------------------------------
+bool compareHistograms(vtkImageData* expected, vtkImageData* histogram,
+                       int numberOfBins)
+{
+  if (!histogram)
+    {
+    std::cerr << "No histogram" << std::endl;
+    return false;
+    }
+  int* expectedCounts = static_cast<int*>(expected->GetScalarPointer());
+  int* counts = static_cast<int*>(histogram->GetScalarPointer());
+  for (int bin = 0; bin < numberOfBins; ++bin)
+    {
+    if (expectedCounts[bin] != counts[bin])
+      {
+      std::cerr << "Bin " << bin << ": " << counts[bin]
+                << " instead of " << expectedCounts[bin] << std::endl;
+      return false;
+      }
+    }
+  return true;
+}
+
+} // end of anonymous namespace
+
+//---------------------------------------------------------------------------
+int vtkImageHistogramCacheTest1(int , char * [] )
+{
+  vtkImageHistogramCache* cache = vtkImageHistogramCache::GetInstance();
+  cache->RemoveAllEntries();
+
+  vtkNew<vtkImageData> image;
+  image->SetDimensions(37, 23, 11);
+  image->SetScalarTypeToShort();
+  image->SetNumberOfScalarComponents(1);
+  image->AllocateScalars();
+  short* ptr = static_cast<short*>(image->GetScalarPointer());
+  for (vtkIdType i = 0; i < image->GetNumberOfPoints(); ++i)
+    {
+    ptr[i] = static_cast<short>((i * 37) % 500 - 100);
+    }
+
+  // Same counts as vtkImageAccumulate, out of range voxels are ignored
+  const int numberOfBins = 300;
+  vtkNew<vtkImageAccumulate> accumulate;
+  accumulate->SetInput(image.GetPointer());
+  accumulate->SetComponentExtent(0, numberOfBins - 1, 0, 0, 0, 0);
+  accumulate->SetComponentOrigin(-50., 0., 0.);
+  accumulate->SetComponentSpacing(1., 1., 1.);
+  accumulate->Update();
+
+  const int defaultNumberOfThreads = cache->GetNumberOfThreads();
+  for (int threads = 1; threads <= 4; ++threads)
+    {
+    cache->RemoveAllEntries();
+    cache->SetNumberOfThreads(threads);
+    if (!compareHistograms(accumulate->GetOutput(),
+                           cache->GetHistogram(image.GetPointer(), -50., 1., numberOfBins),
+                           numberOfBins))
+      {
+      return EXIT_FAILURE;
+      }
+    }
+  cache->SetNumberOfThreads(defaultNumberOfThreads);
+
+  // Cached until the image is modified
+  vtkSmartPointer<vtkImageData> histogram =
+    cache->GetHistogram(image.GetPointer(), -50., 1., numberOfBins);
+  if (cache->GetHistogram(image.GetPointer(), -50., 1., numberOfBins) != histogram ||
+      !cache->HasHistogram(image.GetPointer(), -50., 1., numberOfBins) ||
+      cache->HasHistogram(image.GetPointer(), -50., 2., numberOfBins))
+    {
+    std::cerr << "Histogram is not cached" << std::endl;
+    return EXIT_FAILURE;
+    }
+  vtkNew<vtkImageData> oldHistogram;
+  oldHistogram->DeepCopy(histogram);
+  ptr[0] = 10;
+  image->Modified();
+  if (cache->HasHistogram(image.GetPointer(), -50., 1., numberOfBins))
+    {
+    std::cerr << "Histogram of the modified image is still cached" << std::endl;
+    return EXIT_FAILURE;
+    }
+  accumulate->Update();
+  if (!compareHistograms(accumulate->GetOutput(),
+                         cache->GetHistogram(image.GetPointer(), -50., 1., numberOfBins),
+                         numberOfBins))
+    {
+    return EXIT_FAILURE;
+    }
+  // The outdated entry is removed but the histogram returned before is
+  // still referenced and unchanged
+  if (histogram->GetReferenceCount() != 1 ||
+      !compareHistograms(oldHistogram.GetPointer(), histogram, numberOfBins))
+    {
+    std::cerr << "Histogram of the removed entry is not kept" << std::endl;
+    return EXIT_FAILURE;
+    }
+  histogram = 0;
+
+  // Non integer bins
+  accumulate->SetComponentOrigin(-100.5, 0., 0.);
+  accumulate->SetComponentSpacing(2.5, 1., 1.);
+  accumulate->Update();
+  if (!compareHistograms(accumulate->GetOutput(),
+                         cache->GetHistogram(image.GetPointer(), -100.5, 2.5, numberOfBins),
+                         numberOfBins))
+    {
+    return EXIT_FAILURE;
+    }
+
+  // Scalar range
+  double range[2];
+  double expectedRange[2];
+  image->GetScalarRange(expectedRange);
+  if (!cache->GetScalarRange(image.GetPointer(), range) ||
+      range[0] != expectedRange[0] || range[1] != expectedRange[1])
+    {
+    std::cerr << "Wrong range: " << range[0] << " " << range[1] << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // Strided sample
+  if (vtkImageHistogramCache::GetSampleStride(image.GetPointer(), 1000000) != 1 ||
+      vtkImageHistogramCache::GetSampleStride(image.GetPointer(), 19 * 12 * 6) != 2)
+    {
+    std::cerr << "Wrong sample stride" << std::endl;
+    return EXIT_FAILURE;
+    }
+  vtkIdType numberOfSamples =
+    cache->GetNumberOfSamples(image.GetPointer(), -50., 1., numberOfBins, 3);
+  if (numberOfSamples != 13 * 8 * 4)
+    {
+    std::cerr << "Wrong number of samples: " << numberOfSamples << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // Least recently used entries are evicted
+  cache->SetMaximumNumberOfEntries(2);
+  if (cache->GetNumberOfEntries() != 2)
+    {
+    std::cerr << "Entries are not evicted" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  cache->RemoveImage(image.GetPointer());
+  if (cache->GetNumberOfEntries() != 0)
+    {
+    std::cerr << "Entries are not removed" << std::endl;
+    return EXIT_FAILURE;
+    }
+  cache->SetMaximumNumberOfEntries(16);
+
+  // Range estimated from a strided sample until the range of all the
+  // voxels is cached
+  cache->RemoveAllEntries();
+  int dimensions[3];
+  image->GetDimensions(dimensions);
+  double expectedSampleRange[2] = {VTK_DOUBLE_MAX, VTK_DOUBLE_MIN};
+  for (int k = 0; k < dimensions[2]; k += 3)
+    {
+    for (int j = 0; j < dimensions[1]; j += 3)
+      {
+      for (int i = 0; i < dimensions[0]; i += 3)
+        {
+        double value = ptr[(k * dimensions[1] + j) * dimensions[0] + i];
+        expectedSampleRange[0] = std::min(expectedSampleRange[0], value);
+        expectedSampleRange[1] = std::max(expectedSampleRange[1], value);
+        }
+      }
+    }
+  if (!cache->GetScalarRange(image.GetPointer(), range, 3) ||
+      range[0] != expectedSampleRange[0] || range[1] != expectedSampleRange[1] ||
+      cache->HasScalarRange(image.GetPointer()))
+    {
+    std::cerr << "Wrong sample range: " << range[0] << " " << range[1]
+              << " instead of " << expectedSampleRange[0] << " "
+              << expectedSampleRange[1] << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // Histogram added from a shallow copy of the image, as the processing
+  // thread of the application does
+  vtkNew<vtkImageData> imageCopy;
+  imageCopy->ShallowCopy(image.GetPointer());
+  cache->AddHistogram(image.GetPointer(), image->GetMTime(),
+                      imageCopy.GetPointer(), -100.5, 2.5, numberOfBins);
+  if (!cache->HasHistogram(image.GetPointer(), -100.5, 2.5, numberOfBins) ||
+      !cache->HasScalarRange(image.GetPointer()) ||
+      !compareHistograms(accumulate->GetOutput(),
+                         cache->GetHistogram(image.GetPointer(), -100.5, 2.5, numberOfBins),
+                         numberOfBins))
+    {
+    std::cerr << "Added histogram is not cached" << std::endl;
+    return EXIT_FAILURE;
+    }
+  // the range of all the voxels is preferred to the estimate
+  if (!cache->GetScalarRange(image.GetPointer(), range, 3) ||
+      range[0] != expectedRange[0] || range[1] != expectedRange[1])
+    {
+    std::cerr << "Wrong range after AddHistogram: " << range[0] << " "
+              << range[1] << std::endl;
+    return EXIT_FAILURE;
+    }
+  // a histogram of an outdated image is ignored
+  unsigned long imageMTime = image->GetMTime();
+  image->Modified();
+  cache->AddHistogram(image.GetPointer(), imageMTime,
+                      imageCopy.GetPointer(), -50., 1., numberOfBins);
+  if (cache->HasHistogram(image.GetPointer(), -50., 1., numberOfBins))
+    {
+    std::cerr << "Histogram of an outdated image is cached" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,213 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+// MRML includes
+#include "vtkMRMLLinearTransformNode.h"
+#include "vtkMRMLModelDisplayNode.h"
+#include "vtkMRMLModelNode.h"
+#include "vtkMRMLScalarVolumeNode.h"
+#include "vtkMRMLScene.h"
+
+// VTK includes
+#include <vtkCollection.h>
+#include <vtkNew.h>
+#include <vtkSmartPointer.h>
+#include <vtkTimerLog.h>
+
+// STD includes
+#include <iostream>
+#include <vector>
+
+namespace
+{
+
+//---------------------------------------------------------------------------
+// Compare the (cached) class lookups of the scene with a brute force
+// traversal of the Nodes collection.
+bool checkNodesByClass(vtkMRMLScene* scene, const char* className)
+{
+  std::vector<vtkMRMLNode*> expectedNodes;
+  vtkCollection* sceneNodes = scene->GetNodes();
+  for (int i = 0; i < sceneNodes->GetNumberOfItems(); ++i)
+    {
+    vtkMRMLNode* node = vtkMRMLNode::SafeDownCast(sceneNodes->GetItemAsObject(i));
+    if (node->IsA(className))
+      {
+      expectedNodes.push_back(node);
+      }
+    }
+
+  std::vector<vtkMRMLNode*> nodes;
+  scene->GetNodesByClass(className, nodes);
+  vtkSmartPointer<vtkCollection> nodeCollection;
+  nodeCollection.TakeReference(scene->GetNodesByClass(className));
+
+  if (scene->GetNumberOfNodesByClass(className) !=
+        static_cast<int>(expectedNodes.size()) ||
+      nodes != expectedNodes ||
+      nodeCollection->GetNumberOfItems() !=
+        static_cast<int>(expectedNodes.size()))
+    {
+    std::cerr << "Wrong number of nodes for class " << className << ": "
+              << scene->GetNumberOfNodesByClass(className) << " "
+              << nodes.size() << " "
+              << nodeCollection->GetNumberOfItems() << " instead of "
+              << expectedNodes.size() << std::endl;
+    return false;
+    }
+  for (int i = 0; i < static_cast<int>(expectedNodes.size()); ++i)
+    {
+    if (scene->GetNthNodeByClass(i, className) != expectedNodes[i] ||
+        nodeCollection->GetItemAsObject(i) != expectedNodes[i])
+      {
+      std::cerr << "Wrong " << i << "th node for class " << className
+                << std::endl;
+      return false;
+      }
+    }
+  if (scene->GetNthNodeByClass(static_cast<int>(expectedNodes.size()), className) != 0)
+    {
+    std::cerr << "GetNthNodeByClass out of range should return 0 for class "
+              << className << std::endl;
+    return false;
+    }
+  return true;
+}
+
+//---------------------------------------------------------------------------
+bool checkNodesByClass(vtkMRMLScene* scene)
+{
+  return checkNodesByClass(scene, "vtkMRMLNode") &&
+         checkNodesByClass(scene, "vtkMRMLDisplayableNode") &&
+         checkNodesByClass(scene, "vtkMRMLModelNode") &&
+         checkNodesByClass(scene, "vtkMRMLModelDisplayNode") &&
+         checkNodesByClass(scene, "vtkMRMLTransformNode") &&
+         checkNodesByClass(scene, "vtkMRMLScalarVolumeNode");
+}
+
+//---------------------------------------------------------------------------
+void addNodes(vtkMRMLScene* scene, int count)
+{
+  for (int i = 0; i < count; ++i)
+    {
+    vtkNew<vtkMRMLModelNode> modelNode;
+    scene->AddNode(modelNode.GetPointer());
+    vtkNew<vtkMRMLModelDisplayNode> displayNode;
+    scene->AddNode(displayNode.GetPointer());
+    vtkNew<vtkMRMLLinearTransformNode> transformNode;
+    scene->AddNode(transformNode.GetPointer());
+    }
+}
+
+} // end of anonymous namespace
+
+//---------------------------------------------------------------------------
+int vtkMRMLSceneGetNodesByClassTest(
+  int vtkNotUsed(argc), char * vtkNotUsed(argv) [] )
+{
+  vtkNew<vtkMRMLScene> scene;
+
+  //---------------------------------------------------------------------------
+  // Consistency
+  //---------------------------------------------------------------------------
+  if (!checkNodesByClass(scene.GetPointer()))
+    {
+    std::cerr << "Empty scene failed." << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  addNodes(scene.GetPointer(), 10);
+  if (!checkNodesByClass(scene.GetPointer()))
+    {
+    std::cerr << "AddNode failed." << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // Class lists are now cached, they must be updated by AddNode
+  addNodes(scene.GetPointer(), 5);
+  vtkNew<vtkMRMLScalarVolumeNode> volumeNode;
+  scene->AddNode(volumeNode.GetPointer());
+  if (!checkNodesByClass(scene.GetPointer()))
+    {
+    std::cerr << "AddNode with cached classes failed." << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // ... and by RemoveNode
+  scene->RemoveNode(scene->GetNthNodeByClass(3, "vtkMRMLModelNode"));
+  scene->RemoveNode(scene->GetNthNodeByClass(0, "vtkMRMLTransformNode"));
+  scene->RemoveNode(volumeNode.GetPointer());
+  if (!checkNodesByClass(scene.GetPointer()))
+    {
+    std::cerr << "RemoveNode with cached classes failed." << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // InsertBeforeNode doesn't append the node at the end of the collection
+  vtkNew<vtkMRMLModelNode> insertedModelNode;
+  scene->InsertBeforeNode(scene->GetNthNodeByClass(1, "vtkMRMLModelNode"),
+                          insertedModelNode.GetPointer());
+  if (scene->GetNthNodeByClass(1, "vtkMRMLModelNode") !=
+        insertedModelNode.GetPointer() ||
+      !checkNodesByClass(scene.GetPointer()))
+    {
+    std::cerr << "InsertBeforeNode with cached classes failed." << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  if (scene->GetFirstNode(0, "vtkMRMLTransformNode") !=
+        scene->GetNthNodeByClass(0, "vtkMRMLTransformNode"))
+    {
+    std::cerr << "GetFirstNode by class failed." << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  scene->Clear(1);
+  if (!checkNodesByClass(scene.GetPointer()))
+    {
+    std::cerr << "Clear failed." << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  //---------------------------------------------------------------------------
+  // Benchmark: the cost of a lookup doesn't depend on the number of nodes
+  //---------------------------------------------------------------------------
+  const int lookupCount = 1000;
+  for (int size = 1000; size <= 8000; size *= 2)
+    {
+    addNodes(scene.GetPointer(),
+             size / 3 - scene->GetNumberOfNodesByClass("vtkMRMLModelNode"));
+
+    vtkSmartPointer<vtkTimerLog> timerLog = vtkSmartPointer<vtkTimerLog>::New();
+    timerLog->StartTimer();
+    int modelCount = scene->GetNumberOfNodesByClass("vtkMRMLModelNode");
+    for (int i = 0; i < lookupCount; ++i)
+      {
+      scene->GetNthNodeByClass(i % modelCount, "vtkMRMLModelNode");
+      scene->GetNumberOfNodesByClass("vtkMRMLTransformNode");
+      }
+    timerLog->StopTimer();
+    std::cout << scene->GetNumberOfNodes() << " nodes: " << lookupCount
+              << " lookups in " << timerLog->GetElapsedTime() << "s"
+              << std::endl;
+    }
+  if (!checkNodesByClass(scene.GetPointer()))
+    {
+    std::cerr << "Benchmark scene failed." << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,283 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+// MRML includes
+#include "vtkMRMLModelNode.h"
+#include "vtkMRMLScene.h"
+#include "vtkMRMLSceneNodesDelta.h"
+
+// VTK includes
+#include <vtkCallbackCommand.h>
+#include <vtkNew.h>
+#include <vtkSmartPointer.h>
+#include <vtkTimerLog.h>
+
+// STD includes
+#include <iostream>
+#include <vector>
+
+namespace
+{
+
+//---------------------------------------------------------------------------
+struct NodesChangedSpy
+{
+  NodesChangedSpy() : CallCount(0) {}
+  void Clear()
+    {
+    this->CallCount = 0;
+    this->Added.clear();
+    this->Removed.clear();
+    this->Modified.clear();
+    }
+  int CallCount;
+  std::vector<vtkMRMLNode*> Added;
+  std::vector<vtkMRMLNode*> Removed;
+  std::vector<vtkMRMLNode*> Modified;
+};
+
+//---------------------------------------------------------------------------
+void onNodesChanged(vtkObject* vtkNotUsed(caller), unsigned long vtkNotUsed(eid),
+                    void* clientData, void* callData)
+{
+  NodesChangedSpy* spy = reinterpret_cast<NodesChangedSpy*>(clientData);
+  vtkMRMLSceneNodesDelta* delta =
+    reinterpret_cast<vtkMRMLSceneNodesDelta*>(callData);
+  ++spy->CallCount;
+  for (int i = 0; i < delta->GetNumberOfAddedNodes(); ++i)
+    {
+    spy->Added.push_back(delta->GetNthAddedNode(i));
+    }
+  for (int i = 0; i < delta->GetNumberOfRemovedNodes(); ++i)
+    {
+    spy->Removed.push_back(delta->GetNthRemovedNode(i));
+    }
+  for (int i = 0; i < delta->GetNumberOfModifiedNodes(); ++i)
+    {
+    spy->Modified.push_back(delta->GetNthModifiedNode(i));
+    }
+}
+
+//---------------------------------------------------------------------------
+bool checkSpy(const NodesChangedSpy& spy, int callCount,
+              const std::vector<vtkMRMLNode*>& added,
+              const std::vector<vtkMRMLNode*>& removed,
+              const std::vector<vtkMRMLNode*>& modified)
+{
+  if (spy.CallCount != callCount ||
+      spy.Added != added ||
+      spy.Removed != removed ||
+      spy.Modified != modified)
+    {
+    std::cerr << "Wrong NodesChangedEvent: " << spy.CallCount
+              << " call(s) instead of " << callCount << ", "
+              << spy.Added.size() << " added, "
+              << spy.Removed.size() << " removed, "
+              << spy.Modified.size() << " modified node(s) instead of "
+              << added.size() << ", " << removed.size() << ", "
+              << modified.size() << std::endl;
+    return false;
+    }
+  return true;
+}
+
+} // end of anonymous namespace
+
+//---------------------------------------------------------------------------
+int vtkMRMLSceneNodesChangedTest(
+  int vtkNotUsed(argc), char * vtkNotUsed(argv) [] )
+{
+  vtkNew<vtkMRMLScene> scene;
+  std::vector<vtkMRMLNode*> noNodes;
+
+  //---------------------------------------------------------------------------
+  // The delta is not recorded if no nodes delta observer is registered, even
+  // if the scene is observed for any event.
+  //---------------------------------------------------------------------------
+  vtkNew<vtkCallbackCommand> anyEventCallback;
+  scene->AddObserver(vtkCommand::AnyEvent, anyEventCallback.GetPointer());
+  scene->StartState(vtkMRMLScene::BatchProcessState);
+  if (scene->IsRecordingNodesDelta())
+    {
+    std::cerr << "Delta recorded without observer." << std::endl;
+    return EXIT_FAILURE;
+    }
+  scene->EndState(vtkMRMLScene::BatchProcessState);
+  scene->RemoveObserver(anyEventCallback.GetPointer());
+
+  NodesChangedSpy spy;
+  vtkNew<vtkCallbackCommand> callback;
+  callback->SetCallback(onNodesChanged);
+  callback->SetClientData(&spy);
+  scene->AddObserver(vtkMRMLScene::NodesChangedEvent, callback.GetPointer());
+  scene->RegisterNodesDeltaObserver();
+
+  //---------------------------------------------------------------------------
+  // No event outside of a batch process
+  //---------------------------------------------------------------------------
+  vtkNew<vtkMRMLModelNode> modelNode1;
+  scene->AddNode(modelNode1.GetPointer());
+  vtkNew<vtkMRMLModelNode> modelNode2;
+  scene->AddNode(modelNode2.GetPointer());
+  modelNode1->Modified();
+  if (scene->IsRecordingNodesDelta() ||
+      !checkSpy(spy, 0, noNodes, noNodes, noNodes))
+    {
+    std::cerr << "NodesChangedEvent fired outside of a batch." << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  //---------------------------------------------------------------------------
+  // An empty batch doesn't fire the event
+  //---------------------------------------------------------------------------
+  scene->StartState(vtkMRMLScene::BatchProcessState);
+  if (!scene->IsRecordingNodesDelta())
+    {
+    std::cerr << "Delta not recorded." << std::endl;
+    return EXIT_FAILURE;
+    }
+  scene->EndState(vtkMRMLScene::BatchProcessState);
+  if (!checkSpy(spy, 0, noNodes, noNodes, noNodes))
+    {
+    std::cerr << "Empty batch failed." << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  //---------------------------------------------------------------------------
+  // Changes are coalesced into a single event
+  //---------------------------------------------------------------------------
+  vtkNew<vtkMRMLModelNode> modelNode3;
+  vtkNew<vtkMRMLModelNode> modelNode4;
+  scene->StartState(vtkMRMLScene::ImportState);
+  scene->StartState(vtkMRMLScene::BatchProcessState);
+  scene->AddNode(modelNode3.GetPointer());
+  scene->AddNode(modelNode4.GetPointer());
+  // added then removed: not reported
+  scene->RemoveNode(modelNode4.GetPointer());
+  // added then modified: only reported as added
+  modelNode3->Modified();
+  // modified several times: reported once
+  modelNode1->Modified();
+  modelNode1->Modified();
+  scene->RemoveNode(modelNode2.GetPointer());
+  scene->EndState(vtkMRMLScene::BatchProcessState);
+  if (spy.CallCount != 0)
+    {
+    std::cerr << "NodesChangedEvent fired in a nested batch." << std::endl;
+    return EXIT_FAILURE;
+    }
+  scene->EndState(vtkMRMLScene::ImportState);
+
+  std::vector<vtkMRMLNode*> added(1, modelNode3.GetPointer());
+  std::vector<vtkMRMLNode*> removed(1, modelNode2.GetPointer());
+  std::vector<vtkMRMLNode*> modified(1, modelNode1.GetPointer());
+  if (scene->IsRecordingNodesDelta() ||
+      scene->GetNodesDelta()->IsEmpty() == false ||
+      !checkSpy(spy, 1, added, removed, modified))
+    {
+    std::cerr << "Batch process failed." << std::endl;
+    return EXIT_FAILURE;
+    }
+  spy.Clear();
+
+  //---------------------------------------------------------------------------
+  // A node removed then added back is reported as modified
+  //---------------------------------------------------------------------------
+  scene->StartState(vtkMRMLScene::BatchProcessState);
+  scene->RemoveNode(modelNode3.GetPointer());
+  scene->AddNode(modelNode3.GetPointer());
+  scene->EndState(vtkMRMLScene::BatchProcessState);
+  modified[0] = modelNode3.GetPointer();
+  if (!checkSpy(spy, 1, noNodes, noNodes, modified))
+    {
+    std::cerr << "Remove/Add batch failed." << std::endl;
+    return EXIT_FAILURE;
+    }
+  spy.Clear();
+
+  //---------------------------------------------------------------------------
+  // Removed nodes are still alive when the event is fired
+  //---------------------------------------------------------------------------
+  scene->StartState(vtkMRMLScene::BatchProcessState);
+  vtkSmartPointer<vtkMRMLModelNode> tmpNode =
+    vtkSmartPointer<vtkMRMLModelNode>::New();
+  scene->AddNode(tmpNode);
+  scene->EndState(vtkMRMLScene::BatchProcessState);
+  spy.Clear();
+  scene->StartState(vtkMRMLScene::CloseState);
+  scene->RemoveNode(tmpNode);
+  tmpNode = 0;
+  scene->EndState(vtkMRMLScene::CloseState);
+  if (spy.CallCount != 1 || spy.Removed.size() != 1)
+    {
+    std::cerr << "Close batch failed." << std::endl;
+    return EXIT_FAILURE;
+    }
+  spy.Clear();
+
+  //---------------------------------------------------------------------------
+  // A node modified while it is not in the scene is not reported
+  //---------------------------------------------------------------------------
+  vtkNew<vtkMRMLModelNode> orphanNode;
+  orphanNode->SetScene(scene.GetPointer());
+  scene->StartState(vtkMRMLScene::BatchProcessState);
+  orphanNode->Modified();
+  scene->EndState(vtkMRMLScene::BatchProcessState);
+  orphanNode->SetScene(0);
+  if (!checkSpy(spy, 0, noNodes, noNodes, noNodes))
+    {
+    std::cerr << "Node outside of the scene reported." << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  //---------------------------------------------------------------------------
+  // Benchmark: a single event no matter how many nodes are added
+  //---------------------------------------------------------------------------
+  for (int count = 1000; count <= 4000; count *= 2)
+    {
+    vtkSmartPointer<vtkTimerLog> timerLog = vtkSmartPointer<vtkTimerLog>::New();
+    timerLog->StartTimer();
+    scene->StartState(vtkMRMLScene::ImportState);
+    for (int i = 0; i < count; ++i)
+      {
+      vtkNew<vtkMRMLModelNode> modelNode;
+      scene->AddNode(modelNode.GetPointer());
+      }
+    scene->EndState(vtkMRMLScene::ImportState);
+    timerLog->StopTimer();
+    if (spy.CallCount != 1 || static_cast<int>(spy.Added.size()) != count)
+      {
+      std::cerr << "Import of " << count << " nodes failed: "
+                << spy.CallCount << " event(s), "
+                << spy.Added.size() << " added node(s)" << std::endl;
+      return EXIT_FAILURE;
+      }
+    std::cout << count << " nodes imported in "
+              << timerLog->GetElapsedTime() << "s" << std::endl;
+    spy.Clear();
+    }
+
+  scene->UnregisterNodesDeltaObserver();
+  scene->StartState(vtkMRMLScene::BatchProcessState);
+  if (scene->IsRecordingNodesDelta())
+    {
+    std::cerr << "Delta recorded after the observer unregistered."
+              << std::endl;
+    return EXIT_FAILURE;
+    }
+  scene->EndState(vtkMRMLScene::BatchProcessState);
+
+  return EXIT_SUCCESS;
+}
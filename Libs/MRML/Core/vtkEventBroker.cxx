@@ -19,11 +19,281 @@
 // VTK includes
 #include <vtkCallbackCommand.h>
 #include <vtkCollection.h>
+#include <vtkDoubleArray.h>
+#include <vtkIdTypeArray.h>
 #include <vtkObjectFactory.h>
+#include <vtkStringArray.h>
+#include <vtkTable.h>
 #include <vtkTimerLog.h>
+#ifdef _WIN32
+# include <vtkWindows.h>
+#endif
+
+// STD includes
+#include <cmath>
+#include <cstring>
+#include <sstream>
 
 vtkCxxSetObjectMacro(vtkEventBroker, TimerLog, vtkTimerLog);
 
+//----------------------------------------------------------------------------
+// Atomic primitives used by the post queue. They are full memory barriers.
+namespace
+{
+
+//----------------------------------------------------------------------------
+template <class T>
+T* vtkEventBrokerAtomicExchange(T* volatile* pointer, T* value)
+{
+#ifdef _WIN32
+  return static_cast<T*>(InterlockedExchangePointer(
+    reinterpret_cast<PVOID volatile*>(pointer), value));
+#else
+  T* previous = *pointer;
+  while (!__sync_bool_compare_and_swap(pointer, previous, value))
+    {
+    previous = *pointer;
+    }
+  return previous;
+#endif
+}
+
+//----------------------------------------------------------------------------
+template <class T>
+T* vtkEventBrokerAtomicLoad(T* volatile* pointer)
+{
+#ifdef _WIN32
+  MemoryBarrier();
+  T* value = *pointer;
+  MemoryBarrier();
+#else
+  __sync_synchronize();
+  T* value = *pointer;
+  __sync_synchronize();
+#endif
+  return value;
+}
+
+//----------------------------------------------------------------------------
+long vtkEventBrokerAtomicAdd(volatile long* value, long increment)
+{
+#ifdef _WIN32
+  return InterlockedExchangeAdd(value, increment) + increment;
+#else
+  return __sync_add_and_fetch(value, increment);
+#endif
+}
+
+} // end of anonymous namespace
+
+//----------------------------------------------------------------------------
+// Intrusive multiple producers single consumer queue (D. Vyukov).
+// Push is wait free: a producer only exchanges the head pointer. Pop is
+// done by a single consumer and may transiently report an empty queue
+// while a producer is between the exchange and the link of its item.
+class vtkEventBrokerPostQueue
+{
+public:
+  struct Item
+  {
+    Item* volatile Next;
+    vtkObservation* Observation;
+    unsigned long EventID;
+    void* CallData;
+  };
+
+  vtkEventBrokerPostQueue()
+    {
+    this->Stub.Next = 0;
+    this->Stub.Observation = 0;
+    this->Head = &this->Stub;
+    this->Tail = &this->Stub;
+    this->Size = 0;
+    }
+
+  ~vtkEventBrokerPostQueue()
+    {
+    this->Clear();
+    }
+
+  /// Can be called from any thread
+  void Push(vtkObservation* observation, unsigned long eid, void* callData)
+    {
+    Item* item = new Item;
+    item->Observation = observation;
+    item->EventID = eid;
+    item->CallData = callData;
+    vtkEventBrokerAtomicAdd(&this->Size, 1);
+    this->PushItem(item);
+    }
+
+  /// Consumer only. The returned item must be deleted by the caller.
+  Item* Pop()
+    {
+    Item* tail = this->Tail;
+    Item* next = vtkEventBrokerAtomicLoad(&tail->Next);
+    if (tail == &this->Stub)
+      {
+      if (next == 0)
+        {
+        return 0;
+        }
+      this->Tail = next;
+      tail = next;
+      next = vtkEventBrokerAtomicLoad(&next->Next);
+      }
+    if (next == 0)
+      {
+      if (tail != vtkEventBrokerAtomicLoad(&this->Head))
+        {
+        // a producer has not linked its item yet
+        return 0;
+        }
+      this->PushItem(&this->Stub);
+      next = vtkEventBrokerAtomicLoad(&tail->Next);
+      if (next == 0)
+        {
+        return 0;
+        }
+      }
+    this->Tail = next;
+    vtkEventBrokerAtomicAdd(&this->Size, -1);
+    return tail;
+    }
+
+  /// Consumer only. Discard all the items.
+  void Clear()
+    {
+    Item* item;
+    while ((item = this->Pop()) != 0)
+      {
+      delete item;
+      }
+    }
+
+  /// Can be called from any thread
+  int GetSize()
+    {
+    return static_cast<int>(vtkEventBrokerAtomicAdd(&this->Size, 0));
+    }
+
+protected:
+  void PushItem(Item* item)
+    {
+    item->Next = 0;
+    Item* previous = vtkEventBrokerAtomicExchange(&this->Head, item);
+    vtkEventBrokerAtomicExchange(&previous->Next, item);
+    }
+
+  Item* volatile Head;
+  Item* Tail;
+  Item Stub;
+  volatile long Size;
+};
+
+//----------------------------------------------------------------------------
+// Invocation timings per (subject class, event, observer class).
+// Elapsed times are accumulated into a log scale histogram: 4 bins per
+// octave starting at 1 microsecond, which bounds the error of the
+// percentiles to 19% whatever the number of invocations.
+class vtkEventBrokerProfiles
+{
+public:
+  enum
+  {
+    BinsPerOctave = 4,
+    NumberOfBins = 128
+  };
+
+  struct Key
+  {
+    Key(const char* subjectClass, unsigned long event, const char* observerClass)
+      : SubjectClass(subjectClass), Event(event), ObserverClass(observerClass) {}
+    bool operator<(const Key& other)const
+      {
+      int res = strcmp(this->SubjectClass, other.SubjectClass);
+      if (res != 0)
+        {
+        return res < 0;
+        }
+      if (this->Event != other.Event)
+        {
+        return this->Event < other.Event;
+        }
+      return strcmp(this->ObserverClass, other.ObserverClass) < 0;
+      }
+    // Class names are static strings, they outlive the objects
+    const char* SubjectClass;
+    unsigned long Event;
+    const char* ObserverClass;
+  };
+
+  struct Profile
+  {
+    Profile()
+      : Count(0), Total(0.), Max(0.)
+      {
+      memset(this->Bins, 0, sizeof(this->Bins));
+      }
+
+    void AddTime(double elapsedTime)
+      {
+      ++this->Count;
+      this->Total += elapsedTime;
+      if (elapsedTime > this->Max)
+        {
+        this->Max = elapsedTime;
+        }
+      ++this->Bins[vtkEventBrokerProfiles::Bin(elapsedTime)];
+      }
+
+    /// Return the upper bound of the bin that contains the percentile
+    double GetPercentile(double percentile)const
+      {
+      if (this->Count == 0)
+        {
+        return 0.;
+        }
+      double rank = ceil(percentile * this->Count);
+      unsigned long cumulativeCount = 0;
+      for (int bin = 0; bin < NumberOfBins; ++bin)
+        {
+        cumulativeCount += this->Bins[bin];
+        if (cumulativeCount >= rank)
+          {
+          double upperBound = vtkEventBrokerProfiles::BinUpperBound(bin);
+          return upperBound < this->Max ? upperBound : this->Max;
+          }
+        }
+      return this->Max;
+      }
+
+    unsigned long Count;
+    double Total;
+    double Max;
+    unsigned long Bins[NumberOfBins];
+  };
+
+  static int Bin(double elapsedTime)
+    {
+    if (elapsedTime <= 1e-6)
+      {
+      return 0;
+      }
+    int bin = static_cast<int>(
+      floor(log(elapsedTime * 1e6) / log(2.) * BinsPerOctave));
+    return bin < NumberOfBins ? bin : NumberOfBins - 1;
+    }
+
+  static double BinUpperBound(int bin)
+    {
+    return 1e-6 * pow(2., static_cast<double>(bin + 1) / BinsPerOctave);
+    }
+
+  typedef std::map<Key, Profile> ProfileMap;
+  ProfileMap Profiles;
+};
+
 //----------------------------------------------------------------------------
 // The IO manager singleton.
 // This MUST be default initialized to zero by the compiler and is
@@ -94,12 +364,19 @@ vtkEventBroker::vtkEventBroker()
 {
   this->EventMode = vtkEventBroker::Synchronous;
   this->EventLogging = 0;
+  this->EventProfiling = 0;
+  this->Profiles = new vtkEventBrokerProfiles;
   this->EventNestingLevel = 0;
   this->TimerLog = vtkTimerLog::New();
   this->CompressCallData = 0;
   this->LogFileName = NULL;
   this->ScriptHandler = NULL;
   this->ScriptHandlerClientData = NULL;
+  this->PostQueue = new vtkEventBrokerPostQueue;
+  this->MaximumQueueDepth = 0;
+  this->NumberOfPostedEvents = 0;
+  this->NumberOfCoalescedEvents = 0;
+  this->NumberOfDeliveredEvents = 0;
 }
 
 //----------------------------------------------------------------------------
@@ -107,6 +384,17 @@ vtkEventBroker::~vtkEventBroker()
 {
   /// fast and dangerous but ok because we are in the destructor.
   this->DetachObservations();
+  // the posted observations may already be deleted, don't collect them
+  delete this->PostQueue;
+  this->PostQueue = 0;
+  for (std::vector<vtkObservation*>::iterator it = this->RemovedObservations.begin();
+       it != this->RemovedObservations.end(); ++it)
+    {
+    (*it)->Delete();
+    }
+  this->RemovedObservations.clear();
+  delete this->Profiles;
+  this->Profiles = 0;
   
   // close the event log if needed
   if ( this->LogFile.is_open() )
@@ -306,6 +594,8 @@ void vtkEventBroker::RemoveObservations (ObservationVector observations)
     }
 
   // remove from event queue
+  // - collect first the posted observations, they won't be valid anymore
+  this->CollectPostedObservations();
   std::deque< vtkObservation *>::iterator queueIter; 
   for(queueIter=this->EventQueue.begin(); queueIter != this->EventQueue.end();)
     { 
@@ -322,11 +612,23 @@ void vtkEventBroker::RemoveObservations (ObservationVector observations)
     }
 
   // detach and delete each of the observations
+  // - a call may still be in the post queue if another thread is posting it
+  //   or if it is behind a call not yet linked by another thread. The
+  //   observation is then only marked as removed, it is deleted once all
+  //   its calls are collected.
   for(ObservationVector::iterator removeIter=observations.begin(); removeIter != observations.end(); removeIter++)
     {
     (*removeIter)->SetInEventQueue( 0 );
     this->DetachObservation( *removeIter );
-    (*removeIter)->Delete();
+    if ( vtkEventBrokerAtomicAdd( &(*removeIter)->PostedCount, 0 ) != 0 )
+      {
+      (*removeIter)->Removed = 1;
+      this->RemovedObservations.push_back( *removeIter );
+      }
+    else
+      {
+      (*removeIter)->Delete();
+      }
     }
 }
 
@@ -670,6 +972,115 @@ void vtkEventBroker::LogEvent ( vtkObservation *observation )
     }
 }
 
+//----------------------------------------------------------------------------
+int vtkEventBroker::GetNumberOfProfiles ()
+{
+  return static_cast<int>( this->Profiles->Profiles.size() );
+}
+
+//----------------------------------------------------------------------------
+namespace
+{
+std::string vtkEventBrokerEventName(unsigned long eid)
+{
+  const char *eventString = vtkCommand::GetStringFromEventId( eid );
+  if ( !strcmp( eventString, "NoEvent" ) )
+    {
+    std::stringstream ss;
+    ss << eid;
+    return ss.str();
+    }
+  return eventString;
+}
+}
+
+//----------------------------------------------------------------------------
+void vtkEventBroker::GetProfiles ( vtkTable *table )
+{
+  if ( table == NULL )
+    {
+    return;
+    }
+  while ( table->GetNumberOfColumns() > 0 )
+    {
+    table->RemoveColumn( table->GetNumberOfColumns() - 1 );
+    }
+
+  vtkStringArray *subjectClasses = vtkStringArray::New();
+  subjectClasses->SetName( "SubjectClass" );
+  vtkStringArray *events = vtkStringArray::New();
+  events->SetName( "Event" );
+  vtkStringArray *observerClasses = vtkStringArray::New();
+  observerClasses->SetName( "ObserverClass" );
+  vtkIdTypeArray *counts = vtkIdTypeArray::New();
+  counts->SetName( "Count" );
+  const char *timeNames[5] = {"Total", "Mean", "P50", "P99", "Max"};
+  vtkDoubleArray *times[5];
+  for ( int i = 0; i < 5; ++i )
+    {
+    times[i] = vtkDoubleArray::New();
+    times[i]->SetName( timeNames[i] );
+    }
+
+  vtkEventBrokerProfiles::ProfileMap::const_iterator it;
+  for ( it = this->Profiles->Profiles.begin(); it != this->Profiles->Profiles.end(); ++it )
+    {
+    const vtkEventBrokerProfiles::Profile& profile = it->second;
+    subjectClasses->InsertNextValue( it->first.SubjectClass );
+    events->InsertNextValue( vtkEventBrokerEventName( it->first.Event ) );
+    observerClasses->InsertNextValue( it->first.ObserverClass );
+    counts->InsertNextValue( static_cast<vtkIdType>( profile.Count ) );
+    times[0]->InsertNextValue( profile.Total );
+    times[1]->InsertNextValue( profile.Count ? profile.Total / profile.Count : 0. );
+    times[2]->InsertNextValue( profile.GetPercentile( 0.5 ) );
+    times[3]->InsertNextValue( profile.GetPercentile( 0.99 ) );
+    times[4]->InsertNextValue( profile.Max );
+    }
+
+  table->AddColumn( subjectClasses );
+  subjectClasses->Delete();
+  table->AddColumn( events );
+  events->Delete();
+  table->AddColumn( observerClasses );
+  observerClasses->Delete();
+  table->AddColumn( counts );
+  counts->Delete();
+  for ( int i = 0; i < 5; ++i )
+    {
+    table->AddColumn( times[i] );
+    times[i]->Delete();
+    }
+}
+
+//----------------------------------------------------------------------------
+void vtkEventBroker::WriteProfilesAsJSON ( ostream& os )
+{
+  os << "[";
+  vtkEventBrokerProfiles::ProfileMap::const_iterator it;
+  for ( it = this->Profiles->Profiles.begin(); it != this->Profiles->Profiles.end(); ++it )
+    {
+    const vtkEventBrokerProfiles::Profile& profile = it->second;
+    // class and event names are C identifiers, they don't need escaping
+    os << ( it == this->Profiles->Profiles.begin() ? "\n" : ",\n" )
+       << "  {\"SubjectClass\": \"" << it->first.SubjectClass << "\""
+       << ", \"Event\": \"" << vtkEventBrokerEventName( it->first.Event ) << "\""
+       << ", \"ObserverClass\": \"" << it->first.ObserverClass << "\""
+       << ", \"Count\": " << profile.Count
+       << ", \"Total\": " << profile.Total
+       << ", \"Mean\": " << ( profile.Count ? profile.Total / profile.Count : 0. )
+       << ", \"P50\": " << profile.GetPercentile( 0.5 )
+       << ", \"P99\": " << profile.GetPercentile( 0.99 )
+       << ", \"Max\": " << profile.Max << "}";
+    }
+  os << "\n]\n";
+}
+
+//----------------------------------------------------------------------------
+void vtkEventBroker::ResetProfiles ()
+{
+  this->Profiles->Profiles.clear();
+}
+
 //----------------------------------------------------------------------------
 void vtkEventBroker::ProcessEvent ( vtkObservation *observation, vtkObject *caller, unsigned long eid, void *callData )
 {
@@ -741,6 +1152,51 @@ void vtkEventBroker::ProcessEvent ( vtkObservation *observation, vtkObject *call
 void vtkEventBroker::QueueObservation ( vtkObservation *observation,
                                         unsigned long eid,
                                         void *callData )
+{
+  // Only the thread that processes the event queue can touch the
+  // observation call data list, just post the call here.
+  // The posted count keeps the observation alive until the call is
+  // collected, even if it is removed in the meantime.
+  vtkEventBrokerAtomicAdd( &observation->PostedCount, 1 );
+  this->PostQueue->Push( observation, eid, callData );
+}
+
+//----------------------------------------------------------------------------
+void vtkEventBroker::CollectPostedObservations ()
+{
+  vtkEventBrokerPostQueue::Item* item;
+  while ( (item = this->PostQueue->Pop()) != 0 )
+    {
+    vtkObservation* observation = item->Observation;
+    vtkEventBrokerAtomicAdd( &observation->PostedCount, -1 );
+    // calls of removed observations are dropped
+    if ( !observation->Removed )
+      {
+      this->EnqueueObservation( observation, item->EventID, item->CallData );
+      }
+    delete item;
+    }
+
+  // delete the removed observations that have no more posted calls
+  std::vector<vtkObservation*>::iterator it = this->RemovedObservations.begin();
+  while ( it != this->RemovedObservations.end() )
+    {
+    if ( vtkEventBrokerAtomicAdd( &(*it)->PostedCount, 0 ) == 0 )
+      {
+      (*it)->Delete();
+      it = this->RemovedObservations.erase( it );
+      }
+    else
+      {
+      ++it;
+      }
+    }
+}
+
+//----------------------------------------------------------------------------
+void vtkEventBroker::EnqueueObservation ( vtkObservation *observation,
+                                          unsigned long eid,
+                                          void *callData )
 {
   //
   // two modes - 
@@ -753,6 +1209,7 @@ void vtkEventBroker::QueueObservation ( vtkObservation *observation,
   // If the event is not currently in the queue, add it and keep a flag.
   //
   vtkObservation::CallType call(eid, callData);
+  size_t callCount = observation->GetCallDataList()->size();
   if ( this->GetCompressCallData() &&
        observation->GetEvent() != vtkCommand::AnyEvent)
     {
@@ -776,16 +1233,27 @@ void vtkEventBroker::QueueObservation ( vtkObservation *observation,
       }
     }
 
+  ++this->NumberOfPostedEvents;
   if ( !observation->GetInEventQueue() )
     {
     this->EventQueue.push_back( observation );
     observation->SetInEventQueue(1);
+    if ( static_cast<int>( this->EventQueue.size() ) > this->MaximumQueueDepth )
+      {
+      this->MaximumQueueDepth = static_cast<int>( this->EventQueue.size() );
+      }
+    }
+  else if ( observation->GetCallDataList()->size() <= callCount )
+    {
+    // no extra invocation
+    ++this->NumberOfCoalescedEvents;
     }
 }
 
 //----------------------------------------------------------------------------
 int vtkEventBroker::GetNumberOfQueuedObservations ()
 {
+  this->CollectPostedObservations();
   return static_cast<int>( this->EventQueue.size() );
 }
 
@@ -802,6 +1270,11 @@ vtkObservation *vtkEventBroker::GetNthQueuedObservation ( int n )
 //----------------------------------------------------------------------------
 vtkObservation *vtkEventBroker::DequeueObservation ()
 {
+  this->CollectPostedObservations();
+  if ( this->EventQueue.empty() )
+    {
+    return NULL;
+    }
   vtkObservation *observation = this->EventQueue.front();
   this->EventQueue.pop_front();
   observation->SetInEventQueue(0);
@@ -814,6 +1287,26 @@ void vtkEventBroker::InvokeObservation ( vtkObservation *observation,
 {
   this->EventNestingLevel++;
 
+  // the subject and observer may be deleted by the callback
+  const char* subjectClassName = 0;
+  const char* observerClassName = 0;
+  if ( this->EventProfiling )
+    {
+    subjectClassName = observation->GetSubject()->GetClassName();
+    if ( observation->GetScript() != NULL )
+      {
+      observerClassName = "Script";
+      }
+    else if ( observation->GetObserver() )
+      {
+      observerClassName = observation->GetObserver()->GetClassName();
+      }
+    else
+      {
+      observerClassName = "No observer class";
+      }
+    }
+
   double startTime = this->TimerLog->GetUniversalTime();
 
   // Register so observation won't be deleted while callback is running
@@ -844,6 +1337,11 @@ void vtkEventBroker::InvokeObservation ( vtkObservation *observation,
   observation->SetTotalElapsedTime (observation->GetTotalElapsedTime() + elapsedTime);
   observation->SetLastElapsedTime (elapsedTime);
   this->LogEvent (observation);
+  if ( this->EventProfiling )
+    {
+    vtkEventBrokerProfiles::Key key( subjectClassName, eid, observerClassName );
+    this->Profiles->Profiles[key].AddTime( elapsedTime );
+    }
 
   // clear reference to observation (may cause delete)
   observation->Delete();
@@ -861,29 +1359,63 @@ void vtkEventBroker::ProcessEventQueue ()
   // - if the observation is no longer in the queue, stop processing events
   // - unregister before after dequeing in case the observation should go away
   //
+  // - calls queued for the observation while it is invoked are processed
+  //   in the same pass
+  //
   while ( this->GetNumberOfQueuedObservations() > 0 )
     {
     vtkObservation *observation = this->EventQueue.front();
     observation->Register( this );
-    int finished = 0;
-    while ( !finished )
+    while ( !observation->GetCallDataList()->empty() )
       {
       vtkObservation::CallType call = observation->GetCallDataList()->front();
       observation->GetCallDataList()->pop_front();
-      finished = (observation->GetCallDataList()->size() == 0);
+      ++this->NumberOfDeliveredEvents;
       this->InvokeObservation( observation, call.EventID, call.CallData );
+      // observations posted from other threads are coalesced
+      // before the next invocation
+      this->CollectPostedObservations();
       if ( !observation->GetInEventQueue() )
         {
         observation->GetCallDataList()->clear();
-        finished = 1;
         break;
         }
       }
-    this->DequeueObservation();
+    // the observation may have been removed from the queue by the callback
+    if ( !this->EventQueue.empty() && this->EventQueue.front() == observation )
+      {
+      this->DequeueObservation();
+      }
     observation->Delete();
     }
 }
 
+//----------------------------------------------------------------------------
+int vtkEventBroker::GetQueueDepth ()
+{
+  return static_cast<int>( this->EventQueue.size() ) + this->PostQueue->GetSize();
+}
+
+//----------------------------------------------------------------------------
+double vtkEventBroker::GetCoalesceRatio ()
+{
+  if ( this->NumberOfPostedEvents == 0 )
+    {
+    return 0.;
+    }
+  return static_cast<double>( this->NumberOfCoalescedEvents ) /
+         static_cast<double>( this->NumberOfPostedEvents );
+}
+
+//----------------------------------------------------------------------------
+void vtkEventBroker::ResetEventQueueStatistics ()
+{
+  this->MaximumQueueDepth = static_cast<int>( this->EventQueue.size() );
+  this->NumberOfPostedEvents = 0;
+  this->NumberOfCoalescedEvents = 0;
+  this->NumberOfDeliveredEvents = 0;
+}
+
 //----------------------------------------------------------------------------
 void vtkEventBroker::PrintSelf(ostream& os, vtkIndent indent)
 {
@@ -891,8 +1423,15 @@ void vtkEventBroker::PrintSelf(ostream& os, vtkIndent indent)
   
   os << indent << "NumberOfObservations: " << this->GetNumberOfObservations() << "\n";
   os << indent << "NumberOfQueueObservations: " << this->GetNumberOfQueuedObservations() << "\n";
+  os << indent << "MaximumQueueDepth: " << this->MaximumQueueDepth << "\n";
+  os << indent << "NumberOfPostedEvents: " << this->NumberOfPostedEvents << "\n";
+  os << indent << "NumberOfCoalescedEvents: " << this->NumberOfCoalescedEvents << "\n";
+  os << indent << "NumberOfDeliveredEvents: " << this->NumberOfDeliveredEvents << "\n";
+  os << indent << "CoalesceRatio: " << this->GetCoalesceRatio() << "\n";
   os << indent << "EventMode: " << this->GetEventModeAsString() << "\n";
   os << indent << "EventLogging: " << this->EventLogging << "\n";
+  os << indent << "EventProfiling: " << this->EventProfiling << "\n";
+  os << indent << "NumberOfProfiles: " << this->GetNumberOfProfiles() << "\n";
   os << indent << "EventNestingLevel: " << this->EventNestingLevel << "\n";
   os << indent << "LogFileName: " <<
     (this->LogFileName ? this->LogFileName : "(none)") << "\n";
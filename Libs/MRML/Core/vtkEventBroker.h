@@ -31,7 +31,10 @@ class vtkTimerLog;
 
 class vtkCollection;
 class vtkCallbackCommand;
+class vtkEventBrokerPostQueue;
+class vtkEventBrokerProfiles;
 class vtkObservation;
+class vtkTable;
 
 /// \brief Class that manages adding and deleting of observers with events.
 ///
@@ -168,6 +171,38 @@ public:
   /// based on the filename and the EventLogging variable)
   void LogEvent (vtkObservation *observation);
 
+  /// Event Profiling
+  /// 
+  /// Turn on in-memory profiling of the invocations: for each
+  /// (subject class, event, observer class) the broker keeps the
+  /// number of invocations, the total and maximum elapsed times and an
+  /// histogram of the elapsed times to estimate the median and 99th
+  /// percentile. Contrary to event logging, the cost per invocation is
+  /// constant and no file is written.
+  vtkBooleanMacro (EventProfiling, int);
+  vtkSetMacro (EventProfiling, int);
+  vtkGetMacro (EventProfiling, int);
+
+  /// 
+  /// Return the number of profiled (subject class, event, observer class)
+  int GetNumberOfProfiles ();
+
+  /// 
+  /// Fill the table with a snapshot of the profiles: one row per
+  /// (subject class, event, observer class) and the columns
+  /// SubjectClass, Event, ObserverClass, Count, Total, Mean, P50, P99
+  /// and Max. Times are in seconds.
+  void GetProfiles (vtkTable* table);
+
+  /// 
+  /// Write a snapshot of the profiles as a JSON array of objects with the
+  /// same keys as the columns of GetProfiles.
+  void WriteProfilesAsJSON (ostream& os);
+
+  /// 
+  /// Forget all the profiles
+  void ResetProfiles ();
+
   /// Graph File
   /// 
   /// Write out the current list of observations in graphviz format (.dot)
@@ -208,11 +243,19 @@ public:
   /// 
   /// Event queue handling routines
   /// Note:
-  /// - assume here that the information in a vtkObservation contains enough
-  /// information for the observer to handle the event (that is, we don't pass 
-  /// the callData field of the event back)
-  /// TODO: if the callData is needed, we will need another class/struct to 
-  /// go into the event queue that saves them
+  /// - QueueObservation is thread safe and lock free: any thread (e.g. the
+  /// vtkSlicerApplicationLogic processing thread) can post an observation
+  /// without waiting for the thread that processes the queue.
+  /// - all the other routines must be called from the thread that processes
+  /// the queue (typically the GUI thread). They first collect the posted
+  /// observations into the event queue.
+  /// - an observation is in the event queue at most once: repeated events
+  /// for the same (subject, event, observer) are coalesced according to
+  /// CompressCallData.
+  /// - an observation can be removed while other threads post calls for it,
+  /// as long as they called QueueObservation before the removal: these
+  /// calls are dropped and the observation is deleted once they are
+  /// collected.
   void QueueObservation (vtkObservation *observation, unsigned long eid,
                          void *callData);
   int GetNumberOfQueuedObservations (); 
@@ -222,6 +265,32 @@ public:
                           void *callData);
   void ProcessEventQueue (); 
 
+  /// Event queue statistics
+  /// 
+  /// Number of observations currently waiting for invocation, including
+  /// the posted observations not yet collected. Can be called from any thread.
+  int GetQueueDepth ();
+  /// 
+  /// Highest number of observations in the event queue
+  vtkGetMacro (MaximumQueueDepth, int);
+  /// 
+  /// Number of events posted to the queue
+  vtkGetMacro (NumberOfPostedEvents, unsigned long);
+  /// 
+  /// Number of posted events that have been merged into an observation
+  /// already in the queue instead of causing a new invocation
+  vtkGetMacro (NumberOfCoalescedEvents, unsigned long);
+  /// 
+  /// Number of invocations made while processing the event queue
+  vtkGetMacro (NumberOfDeliveredEvents, unsigned long);
+  /// 
+  /// Ratio of coalesced events over posted events, between 0 (no
+  /// coalescing) and 1.
+  double GetCoalesceRatio ();
+  /// 
+  /// Reset the counters above
+  void ResetEventQueueStatistics ();
+
   /// 
   /// two modes - 
   ///  - CompressCallDataOn: only keep the most recent call data.  this means that if the
@@ -272,13 +341,36 @@ protected:
   ObjectToObservationVectorMap SubjectMap;
   ObjectToObservationVectorMap ObserverMap;
 
+  /// 
+  /// Move the observations posted by QueueObservation into EventQueue
+  /// and coalesce them with the observations already queued.
+  void CollectPostedObservations ();
+  /// 
+  /// Add the call to the call data list of the observation and queue the
+  /// observation if it is not yet in EventQueue.
+  void EnqueueObservation (vtkObservation *observation, unsigned long eid,
+                           void *callData);
+
   /// The event queue of triggered but not-yet-invoked observations
   std::deque< vtkObservation * > EventQueue;
+  /// Lock free multiple producers single consumer queue of the posted
+  /// observations not yet moved into EventQueue
+  vtkEventBrokerPostQueue *PostQueue;
+  /// Observations removed while calls were still posted for them. They
+  /// are deleted once the calls are collected.
+  std::vector< vtkObservation * > RemovedObservations;
+
+  int MaximumQueueDepth;
+  unsigned long NumberOfPostedEvents;
+  unsigned long NumberOfCoalescedEvents;
+  unsigned long NumberOfDeliveredEvents;
   
   void (*ScriptHandler) (const char* script, void* clientData);
   void *ScriptHandlerClientData;
 
   int EventLogging;
+  int EventProfiling;
+  vtkEventBrokerProfiles *Profiles;
   int EventNestingLevel;
   char *LogFileName;
   vtkTimerLog *TimerLog;
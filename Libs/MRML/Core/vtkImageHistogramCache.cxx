@@ -0,0 +1,764 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+// MRML includes
+#include "vtkImageHistogramCache.h"
+
+// VTK includes
+#include <vtkDataArray.h>
+#include <vtkImageData.h>
+#include <vtkInstantiator.h>
+#include <vtkMultiThreader.h>
+#include <vtkMutexLock.h>
+#include <vtkObjectFactory.h>
+#include <vtkPointData.h>
+#include <vtkSmartPointer.h>
+#include <vtkTypeTraits.h>
+
+// STD includes
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <list>
+#include <vector>
+
+//----------------------------------------------------------------------------
+class vtkImageHistogramCacheInternals
+{
+public:
+  struct Entry
+  {
+    // the image is only a key, it is not referenced
+    vtkImageData* Image;
+    unsigned long ImageMTime;
+    double BinOrigin;
+    double BinSpacing;
+    // 0 for the entries that only hold the scalar range
+    int NumberOfBins;
+    int SampleStride;
+
+    vtkSmartPointer<vtkImageData> Histogram;
+    double Range[2];
+    vtkIdType NumberOfSamples;
+  };
+  typedef std::list<Entry> EntryList;
+
+  /// Return the entry and make it the most recently used one,
+  /// entries.end() if it is not cached.
+  EntryList::iterator Find(vtkImageData* image, unsigned long imageMTime,
+                           double binOrigin, double binSpacing,
+                           int numberOfBins, int sampleStride);
+  /// Compute the histogram (only the range if numberOfBins is 0) and add it
+  /// to the cache as the most recently used entry.
+  EntryList::iterator Compute(vtkImageData* image, unsigned long imageMTime,
+                              double binOrigin, double binSpacing,
+                              int numberOfBins, int sampleStride,
+                              int numberOfThreads, int maximumNumberOfEntries);
+  /// Compute the histogram without touching the cache.
+  static Entry ComputeEntry(vtkImageData* image, unsigned long imageMTime,
+                            double binOrigin, double binSpacing,
+                            int numberOfBins, int sampleStride,
+                            int numberOfThreads);
+  EntryList::iterator Push(const Entry& entry, int maximumNumberOfEntries);
+  /// Remove the entries of the image that are not up to date.
+  void RemoveOutdatedEntries(vtkImageData* image, unsigned long imageMTime);
+
+  /// Most recently used first
+  EntryList Entries;
+  /// Protects the entries from AddHistogram() called in a background thread
+  vtkSimpleMutexLock Lock;
+};
+
+//----------------------------------------------------------------------------
+vtkImageHistogramCacheInternals::EntryList::iterator
+vtkImageHistogramCacheInternals::Find(vtkImageData* image,
+                                      unsigned long imageMTime,
+                                      double binOrigin, double binSpacing,
+                                      int numberOfBins, int sampleStride)
+{
+  for (EntryList::iterator it = this->Entries.begin();
+       it != this->Entries.end(); ++it)
+    {
+    if (it->Image == image &&
+        it->ImageMTime == imageMTime &&
+        it->NumberOfBins == numberOfBins &&
+        it->SampleStride == sampleStride &&
+        (numberOfBins == 0 ||
+         (it->BinOrigin == binOrigin && it->BinSpacing == binSpacing)))
+      {
+      this->Entries.splice(this->Entries.begin(), this->Entries, it);
+      return this->Entries.begin();
+      }
+    }
+  return this->Entries.end();
+}
+
+//----------------------------------------------------------------------------
+void vtkImageHistogramCacheInternals::RemoveOutdatedEntries(
+  vtkImageData* image, unsigned long imageMTime)
+{
+  EntryList::iterator it = this->Entries.begin();
+  while (it != this->Entries.end())
+    {
+    if (it->Image == image && it->ImageMTime != imageMTime)
+      {
+      it = this->Entries.erase(it);
+      }
+    else
+      {
+      ++it;
+      }
+    }
+}
+
+namespace
+{
+
+//----------------------------------------------------------------------------
+struct vtkImageHistogramCacheThreadData
+{
+  vtkImageData* Image;
+  double        BinOrigin;
+  double        BinSpacing;
+  int           NumberOfBins;
+  int           SampleStride;
+
+  // partial results of each thread, reduced once all the threads are done
+  std::vector<std::vector<int> > Counts;
+  std::vector<double>            Min;
+  std::vector<double>            Max;
+  std::vector<vtkIdType>         NumberOfSamples;
+};
+
+//----------------------------------------------------------------------------
+// Count the samples of the rows [firstRow, lastRow) of the strided sample.
+template <class T>
+void vtkImageHistogramCacheExecute(vtkImageHistogramCacheThreadData* data,
+                                   const T* scalars, int threadId,
+                                   int numberOfThreads)
+{
+  int dimensions[3];
+  data->Image->GetDimensions(dimensions);
+  vtkIdType increments[3];
+  data->Image->GetIncrements(increments);
+
+  const int stride = data->SampleStride;
+  const int ni = (dimensions[0] + stride - 1) / stride;
+  const int nj = (dimensions[1] + stride - 1) / stride;
+  const int nk = (dimensions[2] + stride - 1) / stride;
+  const vtkIdType numberOfRows = static_cast<vtkIdType>(nj) * nk;
+  const vtkIdType firstRow = numberOfRows * threadId / numberOfThreads;
+  const vtkIdType lastRow = numberOfRows * (threadId + 1) / numberOfThreads;
+  const vtkIdType step = increments[0] * stride;
+
+  const int numberOfBins = data->NumberOfBins;
+  int* counts = numberOfBins > 0 ? &data->Counts[threadId][0] : 0;
+  // bins of width 1 on integer values: the bin is an integer subtraction
+  const bool integerBins = std::numeric_limits<T>::is_integer &&
+    sizeof(T) <= 4 && data->BinSpacing == 1. &&
+    data->BinOrigin == floor(data->BinOrigin);
+  const vtkTypeInt64 binOffset = static_cast<vtkTypeInt64>(data->BinOrigin);
+  const double binOrigin = data->BinOrigin;
+  const double binScale = 1. / data->BinSpacing;
+
+  T minValue = vtkTypeTraits<T>::Max();
+  T maxValue = vtkTypeTraits<T>::Min();
+  for (vtkIdType row = firstRow; row < lastRow; ++row)
+    {
+    const vtkIdType j = (row % nj) * stride;
+    const vtkIdType k = (row / nj) * stride;
+    const T* ptr = scalars + k * increments[2] + j * increments[1];
+    if (!counts)
+      {
+      for (int i = 0; i < ni; ++i, ptr += step)
+        {
+        const T value = *ptr;
+        minValue = value < minValue ? value : minValue;
+        maxValue = value > maxValue ? value : maxValue;
+        }
+      }
+    else if (integerBins)
+      {
+      for (int i = 0; i < ni; ++i, ptr += step)
+        {
+        const T value = *ptr;
+        minValue = value < minValue ? value : minValue;
+        maxValue = value > maxValue ? value : maxValue;
+        const vtkTypeInt64 bin = static_cast<vtkTypeInt64>(value) - binOffset;
+        if (static_cast<vtkTypeUInt64>(bin) < static_cast<vtkTypeUInt64>(numberOfBins))
+          {
+          ++counts[bin];
+          }
+        }
+      }
+    else
+      {
+      for (int i = 0; i < ni; ++i, ptr += step)
+        {
+        const T value = *ptr;
+        minValue = value < minValue ? value : minValue;
+        maxValue = value > maxValue ? value : maxValue;
+        // NaN are not counted: comparisons are false
+        const double bin = floor((static_cast<double>(value) - binOrigin) * binScale);
+        if (bin >= 0. && bin < numberOfBins)
+          {
+          ++counts[static_cast<int>(bin)];
+          }
+        }
+      }
+    }
+  data->Min[threadId] = static_cast<double>(minValue);
+  data->Max[threadId] = static_cast<double>(maxValue);
+  data->NumberOfSamples[threadId] = (lastRow - firstRow) * ni;
+}
+
+//----------------------------------------------------------------------------
+VTK_THREAD_RETURN_TYPE vtkImageHistogramCacheThreadedExecute(void *arg)
+{
+  vtkMultiThreader::ThreadInfo *info =
+    static_cast<vtkMultiThreader::ThreadInfo *>(arg);
+  vtkImageHistogramCacheThreadData *data =
+    static_cast<vtkImageHistogramCacheThreadData *>(info->UserData);
+
+  void* scalars = data->Image->GetScalarPointer();
+  switch (data->Image->GetScalarType())
+    {
+    vtkTemplateMacro(
+      vtkImageHistogramCacheExecute(data, static_cast<VTK_TT*>(scalars),
+                                    info->ThreadID, info->NumberOfThreads));
+    default:
+      break;
+    }
+  return VTK_THREAD_RETURN_VALUE;
+}
+
+//----------------------------------------------------------------------------
+// Update the image and return its modification time, 0 if it has no scalars
+unsigned long vtkImageHistogramCacheUpdateImage(vtkImageData* image)
+{
+  if (!image)
+    {
+    return 0;
+    }
+  image->Update();
+  if (!image->GetPointData()->GetScalars() ||
+      image->GetNumberOfPoints() == 0)
+    {
+    return 0;
+    }
+  return image->GetMTime();
+}
+
+} // end of anonymous namespace
+
+//----------------------------------------------------------------------------
+vtkImageHistogramCacheInternals::EntryList::iterator
+vtkImageHistogramCacheInternals::Compute(vtkImageData* image,
+                                         unsigned long imageMTime,
+                                         double binOrigin, double binSpacing,
+                                         int numberOfBins, int sampleStride,
+                                         int numberOfThreads,
+                                         int maximumNumberOfEntries)
+{
+  return this->Push(vtkImageHistogramCacheInternals::ComputeEntry(
+                      image, imageMTime, binOrigin, binSpacing, numberOfBins,
+                      sampleStride, numberOfThreads),
+                    maximumNumberOfEntries);
+}
+
+//----------------------------------------------------------------------------
+vtkImageHistogramCacheInternals::Entry
+vtkImageHistogramCacheInternals::ComputeEntry(vtkImageData* image,
+                                              unsigned long imageMTime,
+                                              double binOrigin,
+                                              double binSpacing,
+                                              int numberOfBins,
+                                              int sampleStride,
+                                              int numberOfThreads)
+{
+  vtkImageHistogramCacheThreadData data;
+  data.Image = image;
+  data.BinOrigin = binOrigin;
+  data.BinSpacing = binSpacing;
+  data.NumberOfBins = numberOfBins;
+  data.SampleStride = sampleStride;
+
+  // don't start more threads than there are slices to share
+  int dimensions[3];
+  image->GetDimensions(dimensions);
+  vtkIdType numberOfRows =
+    static_cast<vtkIdType>((dimensions[1] + sampleStride - 1) / sampleStride) *
+    ((dimensions[2] + sampleStride - 1) / sampleStride);
+  numberOfThreads = static_cast<int>(
+    std::min(static_cast<vtkIdType>(numberOfThreads), numberOfRows));
+  data.Counts.resize(numberOfThreads, std::vector<int>(numberOfBins, 0));
+  data.Min.resize(numberOfThreads);
+  data.Max.resize(numberOfThreads);
+  data.NumberOfSamples.resize(numberOfThreads, 0);
+
+  vtkSmartPointer<vtkMultiThreader> threader =
+    vtkSmartPointer<vtkMultiThreader>::New();
+  threader->SetNumberOfThreads(numberOfThreads);
+  threader->SetSingleMethod(vtkImageHistogramCacheThreadedExecute, &data);
+  threader->SingleMethodExecute();
+
+  vtkImageHistogramCacheInternals::Entry entry;
+  entry.Image = image;
+  entry.ImageMTime = imageMTime;
+  entry.BinOrigin = binOrigin;
+  entry.BinSpacing = binSpacing;
+  entry.NumberOfBins = numberOfBins;
+  entry.SampleStride = sampleStride;
+  entry.Range[0] = VTK_DOUBLE_MAX;
+  entry.Range[1] = VTK_DOUBLE_MIN;
+  entry.NumberOfSamples = 0;
+  for (int t = 0; t < numberOfThreads; ++t)
+    {
+    if (data.NumberOfSamples[t] == 0)
+      {
+      continue;
+      }
+    entry.Range[0] = std::min(entry.Range[0], data.Min[t]);
+    entry.Range[1] = std::max(entry.Range[1], data.Max[t]);
+    entry.NumberOfSamples += data.NumberOfSamples[t];
+    }
+
+  if (numberOfBins == 0)
+    {
+    return entry;
+    }
+
+  // same output as vtkImageAccumulate
+  entry.Histogram = vtkSmartPointer<vtkImageData>::New();
+  entry.Histogram->SetExtent(0, numberOfBins - 1, 0, 0, 0, 0);
+  entry.Histogram->SetWholeExtent(0, numberOfBins - 1, 0, 0, 0, 0);
+  entry.Histogram->SetOrigin(binOrigin, 0., 0.);
+  entry.Histogram->SetSpacing(binSpacing, 1., 1.);
+  entry.Histogram->SetScalarTypeToInt();
+  entry.Histogram->SetNumberOfScalarComponents(1);
+  entry.Histogram->AllocateScalars();
+  int* counts = static_cast<int*>(entry.Histogram->GetScalarPointer());
+  for (int bin = 0; bin < numberOfBins; ++bin)
+    {
+    int count = 0;
+    for (int t = 0; t < numberOfThreads; ++t)
+      {
+      count += data.Counts[t][bin];
+      }
+    counts[bin] = count;
+    }
+
+  return entry;
+}
+
+//----------------------------------------------------------------------------
+vtkImageHistogramCacheInternals::EntryList::iterator
+vtkImageHistogramCacheInternals::Push(const Entry& entry,
+                                      int maximumNumberOfEntries)
+{
+  this->Entries.push_front(entry);
+  while (static_cast<int>(this->Entries.size()) > maximumNumberOfEntries)
+    {
+    this->Entries.pop_back();
+    }
+  return this->Entries.begin();
+}
+
+//----------------------------------------------------------------------------
+// The histogram cache singleton.
+// This MUST be default initialized to zero by the compiler and is
+// therefore not initialized here. The ClassInitialize and
+// ClassFinalize methods handle this instance.
+static vtkImageHistogramCache* vtkImageHistogramCacheInstance;
+
+//----------------------------------------------------------------------------
+// Must NOT be initialized. Default initialization to zero is necessary.
+unsigned int vtkImageHistogramCacheInitialize::Count;
+
+//----------------------------------------------------------------------------
+// Implementation of vtkImageHistogramCacheInitialize class.
+//----------------------------------------------------------------------------
+vtkImageHistogramCacheInitialize::vtkImageHistogramCacheInitialize()
+{
+  if(++Self::Count == 1)
+    {
+    vtkImageHistogramCache::classInitialize();
+    }
+}
+
+//----------------------------------------------------------------------------
+vtkImageHistogramCacheInitialize::~vtkImageHistogramCacheInitialize()
+{
+  if(--Self::Count == 0)
+    {
+    vtkImageHistogramCache::classFinalize();
+    }
+}
+
+//----------------------------------------------------------------------------
+// Needed when we don't use the vtkStandardNewMacro.
+vtkInstantiatorNewMacro(vtkImageHistogramCache);
+
+//----------------------------------------------------------------------------
+vtkCxxRevisionMacro(vtkImageHistogramCache, "$Revision$");
+
+//----------------------------------------------------------------------------
+// Up the reference count so it behaves like New
+vtkImageHistogramCache* vtkImageHistogramCache::New()
+{
+  vtkImageHistogramCache* ret = vtkImageHistogramCache::GetInstance();
+  ret->Register(NULL);
+  return ret;
+}
+
+//----------------------------------------------------------------------------
+// Return the single instance of the vtkImageHistogramCache
+vtkImageHistogramCache* vtkImageHistogramCache::GetInstance()
+{
+  if(!vtkImageHistogramCacheInstance)
+    {
+    // Try the factory first
+    vtkImageHistogramCacheInstance = (vtkImageHistogramCache*)
+      vtkObjectFactory::CreateInstance("vtkImageHistogramCache");
+    // if the factory did not provide one, then create it here
+    if(!vtkImageHistogramCacheInstance)
+      {
+      vtkImageHistogramCacheInstance = new vtkImageHistogramCache;
+      }
+    }
+  // return the instance
+  return vtkImageHistogramCacheInstance;
+}
+
+//----------------------------------------------------------------------------
+void vtkImageHistogramCache::classInitialize()
+{
+  // Allocate the singleton
+  vtkImageHistogramCacheInstance = vtkImageHistogramCache::GetInstance();
+}
+
+//----------------------------------------------------------------------------
+void vtkImageHistogramCache::classFinalize()
+{
+  vtkImageHistogramCacheInstance->Delete();
+  vtkImageHistogramCacheInstance = 0;
+}
+
+//----------------------------------------------------------------------------
+vtkImageHistogramCache::vtkImageHistogramCache()
+{
+  this->MaximumNumberOfEntries = 16;
+  this->NumberOfThreads = vtkMultiThreader::GetGlobalDefaultNumberOfThreads();
+  this->Internals = new vtkImageHistogramCacheInternals;
+}
+
+//----------------------------------------------------------------------------
+vtkImageHistogramCache::~vtkImageHistogramCache()
+{
+  delete this->Internals;
+}
+
+//----------------------------------------------------------------------------
+void vtkImageHistogramCache::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+  os << indent << "MaximumNumberOfEntries: " << this->MaximumNumberOfEntries << "\n";
+  os << indent << "NumberOfThreads: " << this->NumberOfThreads << "\n";
+  os << indent << "NumberOfEntries: " << this->GetNumberOfEntries() << "\n";
+}
+
+//----------------------------------------------------------------------------
+vtkSmartPointer<vtkImageData> vtkImageHistogramCache::GetHistogram(
+  vtkImageData* image, double binOrigin, double binSpacing, int numberOfBins,
+  int sampleStride)
+{
+  if (numberOfBins < 1 || binSpacing <= 0.)
+    {
+    vtkErrorMacro("GetHistogram: invalid bins");
+    return 0;
+    }
+  sampleStride = sampleStride < 1 ? 1 : sampleStride;
+  unsigned long imageMTime = vtkImageHistogramCacheUpdateImage(image);
+  if (imageMTime == 0)
+    {
+    return 0;
+    }
+  this->Internals->Lock.Lock();
+  this->Internals->RemoveOutdatedEntries(image, imageMTime);
+  vtkImageHistogramCacheInternals::EntryList::iterator it =
+    this->Internals->Find(image, imageMTime, binOrigin, binSpacing,
+                          numberOfBins, sampleStride);
+  if (it == this->Internals->Entries.end())
+    {
+    it = this->Internals->Compute(image, imageMTime, binOrigin, binSpacing,
+                                  numberOfBins, sampleStride,
+                                  this->NumberOfThreads,
+                                  this->MaximumNumberOfEntries);
+    }
+  // referenced before releasing the lock, the entry can be evicted as soon
+  // as it is released
+  vtkSmartPointer<vtkImageData> histogram = it->Histogram;
+  this->Internals->Lock.Unlock();
+  return histogram;
+}
+
+//----------------------------------------------------------------------------
+bool vtkImageHistogramCache::HasHistogram(vtkImageData* image,
+                                          double binOrigin,
+                                          double binSpacing,
+                                          int numberOfBins,
+                                          int sampleStride)
+{
+  if (!image)
+    {
+    return false;
+    }
+  sampleStride = sampleStride < 1 ? 1 : sampleStride;
+  unsigned long imageMTime = vtkImageHistogramCacheUpdateImage(image);
+  bool found = false;
+  this->Internals->Lock.Lock();
+  vtkImageHistogramCacheInternals::EntryList::const_iterator it;
+  for (it = this->Internals->Entries.begin();
+       it != this->Internals->Entries.end() && !found; ++it)
+    {
+    found = (it->Image == image &&
+             it->ImageMTime == imageMTime &&
+             it->NumberOfBins == numberOfBins &&
+             it->SampleStride == sampleStride &&
+             it->BinOrigin == binOrigin && it->BinSpacing == binSpacing);
+    }
+  this->Internals->Lock.Unlock();
+  return found;
+}
+
+//----------------------------------------------------------------------------
+void vtkImageHistogramCache::AddHistogram(vtkImageData* key,
+                                          unsigned long keyMTime,
+                                          vtkImageData* image,
+                                          double binOrigin,
+                                          double binSpacing,
+                                          int numberOfBins)
+{
+  // no error macro: it may be called from a background thread
+  if (!key || !image || !image->GetPointData()->GetScalars() ||
+      image->GetNumberOfPoints() == 0 ||
+      numberOfBins < 0 || binSpacing <= 0.)
+    {
+    return;
+    }
+  this->Internals->Lock.Lock();
+  bool cached = this->Internals->Find(key, keyMTime, binOrigin, binSpacing,
+                                      numberOfBins, 1) !=
+    this->Internals->Entries.end();
+  int numberOfThreads = this->NumberOfThreads;
+  this->Internals->Lock.Unlock();
+  if (cached)
+    {
+    return;
+    }
+
+  // The voxels are read without holding the lock, the main thread keeps
+  // using the cache in the meantime.
+  vtkImageHistogramCacheInternals::Entry entry =
+    vtkImageHistogramCacheInternals::ComputeEntry(
+      image, keyMTime, binOrigin, binSpacing, numberOfBins, 1,
+      numberOfThreads);
+  entry.Image = key;
+
+  this->Internals->Lock.Lock();
+  if (this->Internals->Find(key, keyMTime, binOrigin, binSpacing,
+                            numberOfBins, 1) ==
+      this->Internals->Entries.end())
+    {
+    this->Internals->Push(entry, this->MaximumNumberOfEntries);
+    }
+  this->Internals->Lock.Unlock();
+}
+
+//----------------------------------------------------------------------------
+bool vtkImageHistogramCache::GetScalarRange(vtkImageData* image,
+                                            double range[2],
+                                            int sampleStride)
+{
+  range[0] = 0.;
+  range[1] = 0.;
+  sampleStride = sampleStride < 1 ? 1 : sampleStride;
+  unsigned long imageMTime = vtkImageHistogramCacheUpdateImage(image);
+  if (imageMTime == 0)
+    {
+    return false;
+    }
+  this->Internals->Lock.Lock();
+  this->Internals->RemoveOutdatedEntries(image, imageMTime);
+  // any histogram of all the voxels has the range, otherwise any histogram
+  // of the same sample has its estimate
+  vtkImageHistogramCacheInternals::EntryList::iterator it;
+  vtkImageHistogramCacheInternals::EntryList::iterator found =
+    this->Internals->Entries.end();
+  for (it = this->Internals->Entries.begin();
+       it != this->Internals->Entries.end(); ++it)
+    {
+    if (it->Image != image)
+      {
+      continue;
+      }
+    if (it->SampleStride == 1)
+      {
+      found = it;
+      break;
+      }
+    if (it->SampleStride == sampleStride &&
+        found == this->Internals->Entries.end())
+      {
+      found = it;
+      }
+    }
+  if (found == this->Internals->Entries.end())
+    {
+    found = this->Internals->Compute(image, imageMTime, 0., 1., 0,
+                                     sampleStride, this->NumberOfThreads,
+                                     this->MaximumNumberOfEntries);
+    }
+  range[0] = found->Range[0];
+  range[1] = found->Range[1];
+  this->Internals->Lock.Unlock();
+  return true;
+}
+
+//----------------------------------------------------------------------------
+bool vtkImageHistogramCache::HasScalarRange(vtkImageData* image)
+{
+  unsigned long imageMTime = vtkImageHistogramCacheUpdateImage(image);
+  if (imageMTime == 0)
+    {
+    return false;
+    }
+  bool found = false;
+  this->Internals->Lock.Lock();
+  vtkImageHistogramCacheInternals::EntryList::const_iterator it;
+  for (it = this->Internals->Entries.begin();
+       it != this->Internals->Entries.end() && !found; ++it)
+    {
+    found = (it->Image == image &&
+             it->ImageMTime == imageMTime &&
+             it->SampleStride == 1);
+    }
+  this->Internals->Lock.Unlock();
+  return found;
+}
+
+//----------------------------------------------------------------------------
+vtkIdType vtkImageHistogramCache::GetNumberOfSamples(vtkImageData* image,
+                                                     double binOrigin,
+                                                     double binSpacing,
+                                                     int numberOfBins,
+                                                     int sampleStride)
+{
+  if (!this->GetHistogram(image, binOrigin, binSpacing, numberOfBins,
+                          sampleStride))
+    {
+    return 0;
+    }
+  sampleStride = sampleStride < 1 ? 1 : sampleStride;
+  this->Internals->Lock.Lock();
+  vtkImageHistogramCacheInternals::EntryList::iterator it =
+    this->Internals->Find(image, image->GetMTime(), binOrigin, binSpacing,
+                          numberOfBins, sampleStride);
+  vtkIdType numberOfSamples = it != this->Internals->Entries.end() ?
+    it->NumberOfSamples : 0;
+  this->Internals->Lock.Unlock();
+  return numberOfSamples;
+}
+
+//----------------------------------------------------------------------------
+int vtkImageHistogramCache::GetSampleStride(vtkImageData* image,
+                                            vtkIdType maximumNumberOfSamples)
+{
+  if (!image || maximumNumberOfSamples < 1)
+    {
+    return 1;
+    }
+  int dimensions[3];
+  image->GetDimensions(dimensions);
+  int stride = 1;
+  while (true)
+    {
+    vtkIdType numberOfSamples = 1;
+    for (int i = 0; i < 3; ++i)
+      {
+      numberOfSamples *= (dimensions[i] + stride - 1) / stride;
+      }
+    if (numberOfSamples <= maximumNumberOfSamples)
+      {
+      return stride;
+      }
+    ++stride;
+    }
+}
+
+//----------------------------------------------------------------------------
+void vtkImageHistogramCache::SetMaximumNumberOfEntries(int maximum)
+{
+  maximum = maximum < 1 ? 1 : maximum;
+  if (maximum == this->MaximumNumberOfEntries)
+    {
+    return;
+    }
+  this->MaximumNumberOfEntries = maximum;
+  this->Internals->Lock.Lock();
+  while (static_cast<int>(this->Internals->Entries.size()) > maximum)
+    {
+    this->Internals->Entries.pop_back();
+    }
+  this->Internals->Lock.Unlock();
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+void vtkImageHistogramCache::RemoveImage(vtkImageData* image)
+{
+  this->Internals->Lock.Lock();
+  vtkImageHistogramCacheInternals::EntryList::iterator it =
+    this->Internals->Entries.begin();
+  while (it != this->Internals->Entries.end())
+    {
+    if (it->Image == image)
+      {
+      it = this->Internals->Entries.erase(it);
+      }
+    else
+      {
+      ++it;
+      }
+    }
+  this->Internals->Lock.Unlock();
+}
+
+//----------------------------------------------------------------------------
+void vtkImageHistogramCache::RemoveAllEntries()
+{
+  this->Internals->Lock.Lock();
+  this->Internals->Entries.clear();
+  this->Internals->Lock.Unlock();
+}
+
+//----------------------------------------------------------------------------
+int vtkImageHistogramCache::GetNumberOfEntries()const
+{
+  this->Internals->Lock.Lock();
+  int numberOfEntries = static_cast<int>(this->Internals->Entries.size());
+  this->Internals->Lock.Unlock();
+  return numberOfEntries;
+}
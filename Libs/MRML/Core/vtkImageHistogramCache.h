@@ -0,0 +1,172 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+#ifndef __vtkImageHistogramCache_h
+#define __vtkImageHistogramCache_h
+
+// MRML includes
+#include "vtkMRML.h"
+
+// VTK includes
+#include <vtkObject.h>
+#include <vtkSmartPointer.h>
+
+class vtkImageData;
+class vtkImageHistogramCacheInternals;
+
+/// \brief Compute and cache the histogram of the first component of images.
+///
+/// The histogram is computed in one multithreaded pass over the voxels (or
+/// over a strided sample of the voxels) and kept until the image is
+/// modified, so that the display nodes, the widgets and the modules that
+/// need the histogram or the scalar range of the same image only pay for it
+/// once.
+/// A histogram is a vtkImageData with NumberOfBins x 1 x 1 VTK_INT voxels,
+/// its origin is the lower bound of the first bin and its spacing the width
+/// of the bins: it is the output vtkImageAccumulate would generate for the
+/// same bins and can be given to vtkImageBimodalAnalysis. Voxels out of the
+/// bins are not counted.
+/// The cache is a singleton meant to be used from the main thread, only
+/// AddHistogram() can be called from a background thread.
+class VTK_MRML_EXPORT vtkImageHistogramCache : public vtkObject
+{
+public:
+  vtkTypeRevisionMacro(vtkImageHistogramCache, vtkObject);
+  void PrintSelf(ostream& os, vtkIndent indent);
+
+  ///
+  /// Return the singleton instance with no reference counting.
+  static vtkImageHistogramCache* GetInstance();
+
+  ///
+  /// This is a singleton pattern New. Clients that call this must call
+  /// Delete on the object.
+  static vtkImageHistogramCache* New();
+
+  ///
+  /// Return the histogram of the first component of \a image. Only one
+  /// voxel every \a sampleStride voxels along each axis is counted when
+  /// \a sampleStride is larger than 1.
+  /// The histogram is shared with the cache, which never modifies it: it
+  /// stays valid after the entry is evicted or replaced, for example by
+  /// AddHistogram() in a background thread. Return 0 if the image has no
+  /// scalars.
+  vtkSmartPointer<vtkImageData> GetHistogram(vtkImageData* image,
+                                             double binOrigin,
+                                             double binSpacing,
+                                             int numberOfBins,
+                                             int sampleStride = 1);
+
+  ///
+  /// Return true if the histogram is cached and up to date.
+  bool HasHistogram(vtkImageData* image, double binOrigin,
+                    double binSpacing, int numberOfBins,
+                    int sampleStride = 1);
+
+  ///
+  /// Compute the histogram of all the voxels of \a image and cache it for
+  /// the image \a key modified at \a keyMTime, like GetHistogram() would.
+  /// \a numberOfBins can be 0 to only compute the scalar range.
+  /// Unlike the other methods, it can be called from a background thread:
+  /// \a image must be a shallow copy of \a key made in the main thread at
+  /// \a keyMTime, that nothing else modifies. The entry is ignored if \a key
+  /// has been modified in the meantime.
+  void AddHistogram(vtkImageData* key, unsigned long keyMTime,
+                    vtkImageData* image, double binOrigin,
+                    double binSpacing, int numberOfBins);
+
+  ///
+  /// Range of the first component of the image. It reuses any up to date
+  /// histogram of the image computed from all its voxels. Otherwise, if
+  /// \a sampleStride is larger than 1, the range is estimated from the same
+  /// strided sample as GetHistogram().
+  /// Return false (and [0, 0]) if the image has no scalars.
+  bool GetScalarRange(vtkImageData* image, double range[2],
+                      int sampleStride = 1);
+
+  ///
+  /// Return true if the range of all the voxels of the image is cached and
+  /// up to date.
+  bool HasScalarRange(vtkImageData* image);
+
+  ///
+  /// Number of voxels counted in the histogram, including the ones out of
+  /// the bins.
+  vtkIdType GetNumberOfSamples(vtkImageData* image, double binOrigin,
+                               double binSpacing, int numberOfBins,
+                               int sampleStride = 1);
+
+  ///
+  /// Smallest stride along each axis such that a strided sample of
+  /// \a image has no more than \a maximumNumberOfSamples voxels.
+  static int GetSampleStride(vtkImageData* image,
+                             vtkIdType maximumNumberOfSamples);
+
+  ///
+  /// Maximum number of histograms kept in the cache, the least recently
+  /// used ones are evicted first. 16 by default.
+  void SetMaximumNumberOfEntries(int maximum);
+  vtkGetMacro(MaximumNumberOfEntries, int);
+
+  ///
+  /// Number of threads used to compute the histograms.
+  /// By default it is the number of threads of vtkMultiThreader.
+  vtkSetClampMacro(NumberOfThreads, int, 1, VTK_INT_MAX);
+  vtkGetMacro(NumberOfThreads, int);
+
+  ///
+  /// Remove the histograms of an image, or all of them.
+  void RemoveImage(vtkImageData* image);
+  void RemoveAllEntries();
+  int GetNumberOfEntries()const;
+
+protected:
+  vtkImageHistogramCache();
+  virtual ~vtkImageHistogramCache();
+  vtkImageHistogramCache(const vtkImageHistogramCache&);
+  void operator=(const vtkImageHistogramCache&);
+
+  ///
+  /// Singleton management functions.
+  static void classInitialize();
+  static void classFinalize();
+
+  friend class vtkImageHistogramCacheInitialize;
+  typedef vtkImageHistogramCache Self;
+
+  int MaximumNumberOfEntries;
+  int NumberOfThreads;
+  vtkImageHistogramCacheInternals* Internals;
+};
+
+/// Utility class to make sure vtkImageHistogramCache is initialized before
+/// it is used.
+class VTK_MRML_EXPORT vtkImageHistogramCacheInitialize
+{
+public:
+  typedef vtkImageHistogramCacheInitialize Self;
+
+  vtkImageHistogramCacheInitialize();
+  ~vtkImageHistogramCacheInitialize();
+private:
+  static unsigned int Count;
+};
+
+/// This instance will show up in any translation unit that uses
+/// vtkImageHistogramCache. It will make sure vtkImageHistogramCache is
+/// initialized before it is used.
+static vtkImageHistogramCacheInitialize vtkImageHistogramCacheInitializer;
+
+#endif
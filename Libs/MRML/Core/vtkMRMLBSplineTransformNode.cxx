@@ -243,6 +243,23 @@ void vtkMRMLBSplineTransformNode::Copy(vtkMRMLNode *anode)
     }
 }
 
+//----------------------------------------------------------------------------
+bool vtkMRMLBSplineTransformNode::GetControlPointSpacing(double spacing[3])
+{
+  vtkITKBSplineTransform *spline = dynamic_cast<vtkITKBSplineTransform*>(this->WarpTransformToParent);
+  // The fixed parameters are the grid size, origin, spacing and direction
+  if (!spline || spline->GetNumberOfFixedParameters() < 9)
+    {
+    return false;
+    }
+  const double* fixedParameters = spline->GetFixedParameters();
+  for (int i = 0; i < 3; ++i)
+    {
+    spacing[i] = fixedParameters[6 + i];
+    }
+  return true;
+}
+
 //----------------------------------------------------------------------------
 void vtkMRMLBSplineTransformNode::PrintSelf(ostream& os, vtkIndent indent)
 {
@@ -49,6 +49,10 @@ class VTK_MRML_EXPORT vtkMRMLBSplineTransformNode : public vtkMRMLNonlinearTrans
   /// Get node XML tag name (like Volume, Model)
   virtual const char* GetNodeTagName() {return "BSplineTransform";};
 
+  ///
+  /// Spacing of the BSpline grid
+  virtual bool GetControlPointSpacing(double spacing[3]);
+
   /// 
   /// Create default storage node or NULL if does not have one
   virtual vtkMRMLStorageNode* CreateDefaultStorageNode()
@@ -230,6 +230,18 @@ void vtkMRMLGridTransformNode::Copy(vtkMRMLNode *anode)
   Superclass::Copy(anode);
 }
 
+//----------------------------------------------------------------------------
+bool vtkMRMLGridTransformNode::GetControlPointSpacing(double spacing[3])
+{
+  vtkGridTransform* grid = vtkGridTransform::SafeDownCast(this->WarpTransformToParent);
+  if (!grid || !grid->GetDisplacementGrid())
+    {
+    return false;
+    }
+  grid->GetDisplacementGrid()->GetSpacing(spacing);
+  return true;
+}
+
 //----------------------------------------------------------------------------
 void vtkMRMLGridTransformNode::PrintSelf(ostream& os, vtkIndent indent)
 {
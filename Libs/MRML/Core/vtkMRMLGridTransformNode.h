@@ -46,6 +46,10 @@ public:
   /// Get node XML tag name (like Volume, Model)
   virtual const char* GetNodeTagName() {return "GridTransform";};
 
+  ///
+  /// Spacing of the displacement grid
+  virtual bool GetControlPointSpacing(double spacing[3]);
+
 protected:
   vtkMRMLGridTransformNode();
   ~vtkMRMLGridTransformNode();
@@ -85,6 +85,12 @@ vtkImageData* vtkMRMLLabelMapVolumeDisplayNode::GetOutputImageData()
   return this->MapToColors->GetOutput();
 }
 
+//---------------------------------------------------------------------------
+vtkScalarsToColors* vtkMRMLLabelMapVolumeDisplayNode::GetLookupTable()
+{
+  return this->MapToColors->GetLookupTable();
+}
+
 //---------------------------------------------------------------------------
 void vtkMRMLLabelMapVolumeDisplayNode::UpdateImageDataPipeline()
 {
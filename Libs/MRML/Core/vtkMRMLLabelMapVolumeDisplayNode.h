@@ -18,6 +18,7 @@
 #include "vtkMRMLVolumeDisplayNode.h"
 
 class vtkImageMapToColors;
+class vtkScalarsToColors;
 
 /// \brief MRML node for representing a volume display attributes.
 ///
@@ -55,6 +56,11 @@ class VTK_MRML_EXPORT vtkMRMLLabelMapVolumeDisplayNode : public vtkMRMLVolumeDis
 
   virtual void UpdateImageDataPipeline();
 
+  ///
+  /// Lookup table used to map the labels to colors.
+  /// It is updated from the color node by UpdateImageDataPipeline().
+  vtkScalarsToColors* GetLookupTable();
+
 protected:
   vtkMRMLLabelMapVolumeDisplayNode();
   virtual ~vtkMRMLLabelMapVolumeDisplayNode();
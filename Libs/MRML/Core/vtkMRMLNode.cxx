@@ -15,6 +15,7 @@ Version:   $Revision: 1.11 $
 // MRML includes
 #include "vtkMRMLNode.h"
 #include "vtkMRMLScene.h"
+#include "vtkMRMLSceneNodesDelta.h"
 
 // VTK includes
 #include <vtkObjectFactory.h>
@@ -590,6 +591,18 @@ void vtkMRMLNode::ProcessMRMLEvents (vtkObject *caller,
   return;
 }
 
+//----------------------------------------------------------------------------
+void vtkMRMLNode::RecordModifiedInScene()
+{
+  // The scene is set before the node is effectively added, the nodes that
+  // are not in the scene are discarded once at the end of the batch. Nodes
+  // being deleted can't be referenced by the delta.
+  if (this->Scene->IsRecordingNodesDelta() && this->GetReferenceCount() > 0)
+    {
+    this->Scene->GetNodesDelta()->NodeModified(this);
+    }
+}
+
 //----------------------------------------------------------------------------
 void vtkMRMLNode::SetScene(vtkMRMLScene* scene)
 {
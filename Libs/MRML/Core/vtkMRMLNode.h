@@ -359,6 +359,10 @@ public:
     {
     if (!this->GetDisableModifiedEvent())
       {
+      if (this->Scene)
+        {
+        this->RecordModifiedInScene();
+        }
       Superclass::Modified();
       }
     else
@@ -377,6 +381,10 @@ public:
       {
       int oldModifiedEventPending = this->ModifiedEventPending;
       this->ModifiedEventPending = 0;
+      if (this->Scene)
+        {
+        this->RecordModifiedInScene();
+        }
       Superclass::Modified();
       return oldModifiedEventPending;
       }
@@ -621,6 +629,11 @@ protected:
   
   vtkSetMacro(Indent, int);
 
+  /// Add the node to the scene nodes delta if the scene is recording the
+  /// changes of its nodes (batch processing).
+  /// \sa vtkMRMLScene::IsRecordingNodesDelta
+  void RecordModifiedInScene();
+
   /// a shared set of functions that call the
   /// virtual ProcessMRMLEvents
   static void MRMLCallback( vtkObject *caller,
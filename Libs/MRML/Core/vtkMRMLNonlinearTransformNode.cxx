@@ -171,6 +171,12 @@ void vtkMRMLNonlinearTransformNode::SetAndObserveWarpTransformToParent(vtkWarpTr
     }
 }
 
+//----------------------------------------------------------------------------
+bool vtkMRMLNonlinearTransformNode::GetControlPointSpacing(double vtkNotUsed(spacing)[3])
+{
+  return false;
+}
+
 
 //---------------------------------------------------------------------------
 void vtkMRMLNonlinearTransformNode::ProcessMRMLEvents ( vtkObject *caller,
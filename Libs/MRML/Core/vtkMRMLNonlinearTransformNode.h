@@ -62,6 +62,12 @@ class VTK_MRML_EXPORT vtkMRMLNonlinearTransformNode : public vtkMRMLTransformNod
   vtkGetObjectMacro(WarpTransformToParent, vtkWarpTransform); 
   void SetAndObserveWarpTransformToParent(vtkWarpTransform *warp);
 
+  ///
+  /// Spacing of the grid nodes or control points of the warp transform:
+  /// the transform is smooth at a finer scale. Return false if the warp
+  /// transform has no such grid.
+  virtual bool GetControlPointSpacing(double spacing[3]);
+
   /// 
   /// Get concatinated transforms to the top. This method is from
   /// the superclass and probably needs to be moved down a level in the
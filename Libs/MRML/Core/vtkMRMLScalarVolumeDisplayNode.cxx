@@ -14,6 +14,7 @@ Version:   $Revision: 1.2 $
 
 // MRML includes
 #include "vtkEventBroker.h"
+#include "vtkImageHistogramCache.h"
 #include "vtkMRMLScalarVolumeDisplayNode.h"
 #include "vtkMRMLScene.h"
 #include "vtkMRMLProceduralColorNode.h"
@@ -22,7 +23,6 @@ Version:   $Revision: 1.2 $
 // VTK includes
 #include <vtkCallbackCommand.h>
 #include <vtkColorTransferFunction.h>
-#include <vtkImageAccumulate.h>
 #include <vtkImageAppendComponents.h>
 #include <vtkImageExtractComponents.h>
 #include <vtkImageBimodalAnalysis.h>
@@ -41,6 +41,10 @@ Version:   $Revision: 1.2 $
 //----------------------------------------------------------------------------
 vtkMRMLNodeNewMacro(vtkMRMLScalarVolumeDisplayNode);
 
+//----------------------------------------------------------------------------
+// Images with more voxels get their auto levels estimated from a sample first
+static const vtkIdType AutoLevelsMaximumNumberOfSamples = 1 << 24;
+
 //----------------------------------------------------------------------------
 vtkMRMLScalarVolumeDisplayNode::vtkMRMLScalarVolumeDisplayNode()
 {
@@ -105,8 +109,8 @@ vtkMRMLScalarVolumeDisplayNode::vtkMRMLScalarVolumeDisplayNode()
 
 
   this->Bimodal = NULL;
-  this->Accumulate = NULL;
   this->IsInCalculateAutoLevels = false;
+  this->AutoLevelsEstimated = false;
   
   vtkEventBroker::GetInstance()->AddObservation(
     this, vtkCommand::ModifiedEvent, this, this->MRMLCallbackCommand  , 10000.);
@@ -133,11 +137,6 @@ vtkMRMLScalarVolumeDisplayNode::~vtkMRMLScalarVolumeDisplayNode()
     this->Bimodal->Delete();
     this->Bimodal = NULL;
     }
-  if (this->Accumulate)
-    {
-    this->Accumulate->Delete();
-    this->Accumulate = NULL;
-    }
 }
 
 //----------------------------------------------------------------------------
@@ -183,6 +182,12 @@ vtkImageData* vtkMRMLScalarVolumeDisplayNode::GetBackgroundImageData()
   return vtkImageData::SafeDownCast(this->ResliceAlphaCast->GetInput());
 }
 
+//----------------------------------------------------------------------------
+vtkScalarsToColors* vtkMRMLScalarVolumeDisplayNode::GetLookupTable()
+{
+  return this->MapToColors->GetLookupTable();
+}
+
 //----------------------------------------------------------------------------
 vtkImageData* vtkMRMLScalarVolumeDisplayNode::GetInputImageData()
 {
@@ -349,6 +354,7 @@ void vtkMRMLScalarVolumeDisplayNode::Copy(vtkMRMLNode *anode)
   this->SetApplyThreshold(node->GetApplyThreshold());
   this->SetThreshold(node->GetLowerThreshold(), node->GetUpperThreshold());
   this->SetInterpolate(node->Interpolate);
+  this->ResetWindowLevelPresets();
   for (int p = 0; p < node->GetNumberOfWindowLevelPresets(); p++)
     {
     this->AddWindowLevelPreset(node->GetWindowPreset(p), node->GetLevelPreset(p));
@@ -651,6 +657,13 @@ vtkImageData* vtkMRMLScalarVolumeDisplayNode::GetScalarImageData()
 
 //---------------------------------------------------------------------------
 void vtkMRMLScalarVolumeDisplayNode::GetDisplayScalarRange(double range[2])
+{
+  this->CalculateDisplayScalarRange(range, true);
+}
+
+//---------------------------------------------------------------------------
+bool vtkMRMLScalarVolumeDisplayNode::CalculateDisplayScalarRange(
+  double range[2], bool allowEstimate)
 {
   range[0] = 0;
   range[1] = 255.;
@@ -665,20 +678,42 @@ void vtkMRMLScalarVolumeDisplayNode::GetDisplayScalarRange(double range[2])
     assert( !this->GetVolumeNode() || !this->GetVolumeNode()->GetImageData() ||
             !this->GetScene() || this->GetScene()->GetNodeByID(this->GetID()) != this);
     vtkDebugMacro( << "No valid image data, returning default values [0, 255]");
-    return;
+    return false;
     }
-  imageData->Update();
-  imageData->GetScalarRange(range);
+  // Large images get their range estimated from the same sample as their
+  // auto levels histogram until the range of all their voxels is cached.
+  vtkImageHistogramCache* histogramCache =
+    vtkImageHistogramCache::GetInstance();
+  int sampleStride = 1;
+  if (allowEstimate &&
+      imageData->GetNumberOfPoints() > AutoLevelsMaximumNumberOfSamples &&
+      !histogramCache->HasScalarRange(imageData))
+    {
+    sampleStride = vtkImageHistogramCache::GetSampleStride(
+      imageData, AutoLevelsMaximumNumberOfSamples);
+    }
+  histogramCache->GetScalarRange(imageData, range, sampleStride);
   if (imageData->GetNumberOfScalarComponents() >=3 &&
       fabs(range[0]) < 0.000001 && fabs(range[1]) < 0.000001) 
     {
     range[0] = 0;
     range[1] = 255;
     }
+  return sampleStride > 1;
 }
 
 //---------------------------------------------------------------------------
-void vtkMRMLScalarVolumeDisplayNode::CalculateAutoLevels()
+void vtkMRMLScalarVolumeDisplayNode::GetAutoLevelsHistogramBins(
+  double& binOrigin, double& binSpacing, int& numberOfBins)
+{
+  // signed 16-bit integer range
+  binOrigin = -32768;
+  binSpacing = 1.;
+  numberOfBins = 65536;
+}
+
+//---------------------------------------------------------------------------
+void vtkMRMLScalarVolumeDisplayNode::CalculateAutoLevels(bool allowEstimate)
 {
   if (!this->GetAutoWindowLevel() && !this->GetAutoThreshold())
     {
@@ -726,24 +761,39 @@ void vtkMRMLScalarVolumeDisplayNode::CalculateAutoLevels()
       {
       this->Bimodal = vtkImageBimodalAnalysis::New();
       }
-    if (this->Accumulate == NULL)
+
+    // The histogram is shared with the other display nodes and widgets of
+    // the image. Large images get a quick estimate from a sample of their
+    // voxels first.
+    vtkImageHistogramCache* histogramCache =
+      vtkImageHistogramCache::GetInstance();
+    double binOrigin, binSpacing;
+    int numberOfBins;
+    vtkMRMLScalarVolumeDisplayNode::GetAutoLevelsHistogramBins(
+      binOrigin, binSpacing, numberOfBins);
+    int sampleStride = 1;
+    if (allowEstimate &&
+        imageDataScalar->GetNumberOfPoints() > AutoLevelsMaximumNumberOfSamples &&
+        !histogramCache->HasHistogram(imageDataScalar, binOrigin, binSpacing,
+                                      numberOfBins))
       {
-      this->Accumulate = vtkImageAccumulate::New();
+      sampleStride = vtkImageHistogramCache::GetSampleStride(
+        imageDataScalar, AutoLevelsMaximumNumberOfSamples);
       }
+    this->AutoLevelsEstimated = (sampleStride > 1);
 
-    // Setup filter to work with signed 16-bit integer.
-    int extent[6] = {0, 65535, 0, 0, 0, 0};
-    this->Accumulate->SetComponentExtent(extent);
-    double origin[3] = {-32768, 0, 0};
-    this->Accumulate->SetComponentOrigin(origin);
-
-    this->Accumulate->SetInput(imageDataScalar);
-    this->Bimodal->SetInput(this->Accumulate->GetOutput());
-    this->Bimodal->Update();
+    vtkSmartPointer<vtkImageData> histogram = histogramCache->GetHistogram(
+      imageDataScalar, binOrigin, binSpacing, numberOfBins, sampleStride);
+    if (histogram)
+      {
+      this->Bimodal->SetInput(histogram);
+      this->Bimodal->Update();
+      }
     // Workaround for image data where all accumulate samples fall
     // within the same histogram bin
-    if ( this->Bimodal->GetWindow() == 0.0 &&
-         this->Bimodal->GetLevel() == 0.0 )
+    if ( !histogram ||
+         (this->Bimodal->GetWindow() == 0.0 &&
+          this->Bimodal->GetLevel() == 0.0) )
       {
       needAdHoc = 1; 
       }
@@ -754,7 +804,8 @@ void vtkMRMLScalarVolumeDisplayNode::CalculateAutoLevels()
     vtkDebugMacro("CalculateScalarAutoLevels: image data scalar type is not integer,"
                   " doing ad hoc calc of window/level.");
     double range[2];
-    this->GetDisplayScalarRange(range);
+    this->AutoLevelsEstimated =
+      this->CalculateDisplayScalarRange(range, allowEstimate);
 
     double min = range[0];
     double max = range[1];
@@ -787,4 +838,10 @@ void vtkMRMLScalarVolumeDisplayNode::CalculateAutoLevels()
                 << " lower: " << lower << " upper: " << upper);
   this->EndModify(disabledModify);
   this->IsInCalculateAutoLevels = false;
+
+  if (this->AutoLevelsEstimated)
+    {
+    this->InvokeEvent(vtkMRMLScalarVolumeDisplayNode::AutoLevelsEstimatedEvent,
+                      imageDataScalar);
+    }
 }
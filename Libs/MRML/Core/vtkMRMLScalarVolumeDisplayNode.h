@@ -19,7 +19,6 @@
 #include "vtkMRMLVolumeDisplayNode.h"
 
 // VTK includes
-class vtkImageAccumulate;
 class vtkImageAppendComponents;
 class vtkImageBimodalAnalysis;
 class vtkImageCast;
@@ -30,6 +29,7 @@ class vtkImageMapToWindowLevelColors;
 class vtkImageThreshold;
 class vtkImageExtractComponents;
 class vtkImageMathematics;
+class vtkScalarsToColors;
 
 // STD includes
 #include <vector>
@@ -72,6 +72,27 @@ class VTK_MRML_EXPORT vtkMRMLScalarVolumeDisplayNode : public vtkMRMLVolumeDispl
   vtkBooleanMacro(AutoWindowLevel, int);
   vtkGetMacro(AutoWindowLevel, int);
   vtkSetMacro(AutoWindowLevel, int);
+
+  enum
+    {
+    /// Fired when the automatic window/level and threshold have been
+    /// estimated from a sample of the voxels of a large image. The image is
+    /// passed as call data. Once the histogram of all its voxels has been
+    /// added to vtkImageHistogramCache, for example by a background thread,
+    /// a call to Modified() refines them.
+    /// \sa GetAutoLevelsHistogramBins()
+    AutoLevelsEstimatedEvent = 18100
+    };
+
+  /// Return true if the automatic window/level and threshold have been
+  /// estimated from a sample of the voxels of a large image.
+  /// \sa AutoLevelsEstimatedEvent
+  vtkGetMacro(AutoLevelsEstimated, bool);
+
+  /// Bins of the histogram used to compute the automatic window/level and
+  /// threshold, see vtkImageHistogramCache::GetHistogram().
+  static void GetAutoLevelsHistogramBins(double& binOrigin, double& binSpacing,
+                                         int& numberOfBins);
   
   /// 
   /// The window value to use when autoWindowLevel is 'no'
@@ -149,6 +170,11 @@ class VTK_MRML_EXPORT vtkMRMLScalarVolumeDisplayNode : public vtkMRMLVolumeDispl
   virtual void SetBackgroundImageData(vtkImageData *imageData);
   virtual vtkImageData* GetBackgroundImageData();
 
+  ///
+  /// Lookup table used to map the windowed scalars to colors.
+  /// It is the lookup table of the color node.
+  vtkScalarsToColors* GetLookupTable();
+
   /// 
   /// Parse a string with window and level as double|double, and add a preset 
   void AddWindowLevelPresetFromString(const char *preset);
@@ -188,7 +214,16 @@ protected:
 
   virtual void SetColorNodeInternal(vtkMRMLColorNode* newColorNode);
   void UpdateLookupTable(vtkMRMLColorNode* newColorNode);
-  void CalculateAutoLevels();
+  /// Compute the automatic window/level and threshold from the histogram
+  /// of the image. If \a allowEstimate is true and the histogram of a large
+  /// image is not cached yet, a sample of the voxels is used instead.
+  void CalculateAutoLevels(bool allowEstimate = true);
+
+  /// Same as GetDisplayScalarRange(), the range of a large image is
+  /// estimated from a sample of its voxels if \a allowEstimate is true and
+  /// the range of all its voxels is not cached yet.
+  /// Return true if the range is estimated.
+  bool CalculateDisplayScalarRange(double range[2], bool allowEstimate);
 
   /// Return the image data with scalar type, it can be in the middle of the
   /// pipeline, it's typically the input of the threshold/windowlevel filters
@@ -235,9 +270,9 @@ protected:
 
   /// 
   /// Used internally in CalculateScalarAutoLevels and CalculateStatisticsAutoLevels
-  vtkImageAccumulate *Accumulate;
   vtkImageBimodalAnalysis *Bimodal;
   bool IsInCalculateAutoLevels;
+  bool AutoLevelsEstimated;
 };
 
 #endif
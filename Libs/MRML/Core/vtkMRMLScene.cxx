@@ -15,6 +15,7 @@ Version:   $Revision: 1.18 $
 
 #include "vtkMRMLScene.h"
 #include "vtkMRMLParser.h"
+#include "vtkMRMLSceneNodesDelta.h"
 
 #include "vtkCacheManager.h"
 #include "vtkDataIOManager.h"
@@ -95,6 +96,7 @@ vtkCxxSetObjectMacro(vtkMRMLScene, URIHandlerCollection, vtkCollection)
 vtkMRMLScene::vtkMRMLScene()
 {
   this->NodeIDsMTime = 0;
+  this->NodesByClassMTime = 0;
   this->SceneModifiedTime = 0;
 
   this->RegisteredNodeClasses.clear();
@@ -102,6 +104,9 @@ vtkMRMLScene::vtkMRMLScene()
   this->UniqueNames.clear();
 
   this->Nodes =  vtkCollection::New();
+  this->NodesDelta = vtkMRMLSceneNodesDelta::New();
+  this->RecordingNodesDelta = false;
+  this->NodesDeltaObserverCount = 0;
   this->UndoStackSize = 100;
   this->UndoFlag = false;
   this->InUndo = false;
@@ -246,6 +251,11 @@ vtkMRMLScene::~vtkMRMLScene()
     this->DeleteEventCallback->Delete();
     this->DeleteEventCallback = NULL;
     }
+  if ( this->NodesDelta != NULL )
+    {
+    this->NodesDelta->Delete();
+    this->NodesDelta = NULL;
+    }
 }
 
 //------------------------------------------------------------------------------
@@ -566,6 +576,8 @@ void vtkMRMLScene::StartState(unsigned long state, int anticipatedMaxProgress)
   this->States.push_back(state);
   if (this->IsBatchProcessing() && !wasBatchProcessing)
     {
+    // Record the changes only if someone is interested in them.
+    this->RecordingNodesDelta = this->NodesDeltaObserverCount > 0;
     this->InvokeEvent( StateEvent | StartEvent | BatchProcessState);
     }
   if (state != vtkMRMLScene::BatchProcessState &&
@@ -582,6 +594,30 @@ void vtkMRMLScene::EndState(unsigned long state)
   assert(this->States.back() == state);
   this->States.pop_back();
 
+  if ((state & vtkMRMLScene::BatchProcessState) &&
+      !this->IsBatchProcessing() &&
+      this->RecordingNodesDelta)
+    {
+    // Observers must be able to update from the changes before the end
+    // events are fired.
+    this->RecordingNodesDelta = false;
+    // Nodes are recorded as modified as soon as their scene is set, forget
+    // the ones that have not been added.
+    for (int i = this->NodesDelta->GetNumberOfModifiedNodes() - 1; i >= 0; --i)
+      {
+      vtkMRMLNode* node = this->NodesDelta->GetNthModifiedNode(i);
+      if (!node->GetID() || this->GetNodeByID(node->GetID()) != node)
+        {
+        this->NodesDelta->RemoveModifiedNode(node);
+        }
+      }
+    if (!this->NodesDelta->IsEmpty())
+      {
+      this->InvokeEvent(vtkMRMLScene::NodesChangedEvent, this->NodesDelta);
+      }
+    this->NodesDelta->Reset();
+    }
+
   bool isInState = ((this->GetStates() & state) == state);
   // vtkMRMLScene::BatchProcessState is handled after
   if (state != vtkMRMLScene::BatchProcessState &&
@@ -598,6 +634,19 @@ void vtkMRMLScene::EndState(unsigned long state)
     }
 }
 
+//------------------------------------------------------------------------------
+void vtkMRMLScene::RegisterNodesDeltaObserver()
+{
+  ++this->NodesDeltaObserverCount;
+}
+
+//------------------------------------------------------------------------------
+void vtkMRMLScene::UnregisterNodesDeltaObserver()
+{
+  assert(this->NodesDeltaObserverCount > 0);
+  --this->NodesDeltaObserverCount;
+}
+
 //------------------------------------------------------------------------------
 void vtkMRMLScene::ProgressState(unsigned long state, int progress)
 {
@@ -1074,6 +1123,7 @@ vtkMRMLNode*  vtkMRMLScene::AddNodeNoNotify(vtkMRMLNode *n)
 
   // cache the node so the whole scene cache stays up-todate
   this->AddNodeID(n);
+  this->AddNodeByClass(n);
 
   //n->OnNodeAddedToScene();
 
@@ -1128,6 +1178,10 @@ vtkMRMLNode*  vtkMRMLScene::AddNode(vtkMRMLNode *n)
   assert( add || node != n);
   if (add)
     {
+    if (this->RecordingNodesDelta)
+      {
+      this->NodesDelta->NodeAdded(n);
+      }
     this->InvokeEvent(this->NodeAddedEvent, n);
     }
   this->Modified();
@@ -1143,6 +1197,10 @@ vtkMRMLNode*  vtkMRMLScene::AddNode(vtkMRMLNode *n)
 //------------------------------------------------------------------------------
 void vtkMRMLScene::NodeAdded(vtkMRMLNode *n)
 {
+  if (this->RecordingNodesDelta)
+    {
+    this->NodesDelta->NodeAdded(n);
+    }
   this->InvokeEvent(this->NodeAddedEvent, n);
 }
 
@@ -1205,7 +1263,12 @@ void vtkMRMLScene::RemoveNode(vtkMRMLNode *n)
 
   std::string nid=n->GetID();
   this->RemoveNodeID(n->GetID());
+  this->RemoveNodeByClass(n);
 
+  if (this->RecordingNodesDelta)
+    {
+    this->NodesDelta->NodeRemoved(n);
+    }
   this->InvokeEvent(vtkMRMLScene::NodeRemovedEvent, n);
 
   if (!this->IsBatchProcessing() && !this->IsClosing())
@@ -1381,18 +1444,7 @@ int vtkMRMLScene::GetNumberOfNodesByClass(const char *className)
     vtkErrorMacro("GetNumberOfNodesByClass: class name is null.");
     return 0;
     }
-  int num=0;
-  vtkMRMLNode *node;
-  vtkCollectionSimpleIterator it;
-  for (this->Nodes->InitTraversal(it);
-       (node = (vtkMRMLNode*)this->Nodes->GetNextItemAsObject(it)) ;)
-    {
-    if (node->IsA(className))
-      {
-      num++;
-      }
-    }
-  return num;
+  return static_cast<int>(this->GetCachedNodesByClass(className).size());
 }
 
 //------------------------------------------------------------------------------
@@ -1403,16 +1455,9 @@ int vtkMRMLScene::GetNodesByClass(const char *className, std::vector<vtkMRMLNode
     vtkErrorMacro("GetNodesByClass: class name is null.");
     return 0;
     }
-  vtkMRMLNode *node;
-  vtkCollectionSimpleIterator it;
-  for (this->Nodes->InitTraversal(it);
-       (node = (vtkMRMLNode*)this->Nodes->GetNextItemAsObject(it)) ;)
-    {
-    if (node->IsA(className))
-      {
-      nodes.push_back(node);
-      }
-    }
+  const std::vector<vtkMRMLNode*>& classNodes =
+    this->GetCachedNodesByClass(className);
+  nodes.insert(nodes.end(), classNodes.begin(), classNodes.end());
   return static_cast<int>(nodes.size());
 }
 
@@ -1425,15 +1470,12 @@ vtkCollection* vtkMRMLScene::GetNodesByClass(const char *className)
     return 0;
     }
   vtkCollection* nodes = vtkCollection::New();
-  vtkMRMLNode *node;
-  vtkCollectionSimpleIterator it;
-  for (this->Nodes->InitTraversal(it);
-       (node = (vtkMRMLNode*)this->Nodes->GetNextItemAsObject(it)) ;)
+  const std::vector<vtkMRMLNode*>& classNodes =
+    this->GetCachedNodesByClass(className);
+  for (std::vector<vtkMRMLNode*>::const_iterator it = classNodes.begin();
+       it != classNodes.end(); ++it)
     {
-    if (node->IsA(className))
-      {
-      nodes->AddItem(node);
-      }
+    nodes->AddItem(*it);
     }
   return nodes;
 }
@@ -1490,13 +1532,13 @@ vtkMRMLNode* vtkMRMLScene::GetSingletonNode(const char* singletonTag, const char
   assert(singletonTag);
   assert(className);
 
-  vtkCollectionSimpleIterator it;
-  vtkMRMLNode* node = NULL;
-  for (this->Nodes->InitTraversal(it);
-       (node = (vtkMRMLNode*)this->Nodes->GetNextItemAsObject(it)) ;)
+  const std::vector<vtkMRMLNode*>& classNodes =
+    this->GetCachedNodesByClass(className);
+  for (std::vector<vtkMRMLNode*>::const_iterator it = classNodes.begin();
+       it != classNodes.end(); ++it)
     {
-    if (node->IsA(className) &&
-        node->GetSingletonTag() != NULL &&
+    vtkMRMLNode* node = *it;
+    if (node->GetSingletonTag() != NULL &&
         strcmp(node->GetSingletonTag(), singletonTag) == 0)
       {
       return node;
@@ -1565,22 +1607,13 @@ vtkMRMLNode* vtkMRMLScene::GetNthNodeByClass(int n, const char *className)
     return NULL;
     }
 
-  int num=0;
-  vtkMRMLNode *node;
-  vtkCollectionSimpleIterator it;
-  for (this->Nodes->InitTraversal(it);
-       (node = (vtkMRMLNode*)this->Nodes->GetNextItemAsObject(it)) ;)
+  const std::vector<vtkMRMLNode*>& classNodes =
+    this->GetCachedNodesByClass(className);
+  if (n >= static_cast<int>(classNodes.size()))
     {
-    if (node->IsA(className))
-      {
-      if (num == n)
-        {
-        return node;
-        }
-      num++;
-      }
+    return NULL;
     }
-  return NULL;
+  return classNodes[n];
 }
 
 //------------------------------------------------------------------------------
@@ -1613,6 +1646,27 @@ vtkMRMLNode* vtkMRMLScene::GetFirstNode(const char* byName,
                                         const char* byClass,
                                         const int* byHideFromEditors)
 {
+  if (byClass)
+    {
+    const std::vector<vtkMRMLNode*>& classNodes =
+      this->GetCachedNodesByClass(byClass);
+    for (std::vector<vtkMRMLNode*>::const_iterator it = classNodes.begin();
+         it != classNodes.end(); ++it)
+      {
+      vtkMRMLNode* node = *it;
+      if (byName && node->GetName() != 0 && strcmp(node->GetName(), byName) != 0)
+        {
+        continue;
+        }
+      if (byHideFromEditors && node->GetHideFromEditors() != *byHideFromEditors)
+        {
+        continue;
+        }
+      return node;
+      }
+    return 0;
+    }
+
   vtkCollectionSimpleIterator it;
   vtkMRMLNode* node;
   for (this->Nodes->InitTraversal(it);
@@ -1623,10 +1677,6 @@ vtkMRMLNode* vtkMRMLScene::GetFirstNode(const char* byName,
       {
       continue;
       }
-    if (byClass && !node->IsA(byClass))
-      {
-      continue;
-      }
     if (byHideFromEditors && node->GetHideFromEditors() != *byHideFromEditors)
       {
       continue;
@@ -1720,11 +1770,13 @@ vtkCollection* vtkMRMLScene::GetNodesByClassByName(const char* className, const
     return nodes;
     }
 
-  vtkMRMLNode *node;
-  for (int n=0; n < this->Nodes->GetNumberOfItems(); n++)
+  const std::vector<vtkMRMLNode*>& classNodes =
+    this->GetCachedNodesByClass(className);
+  for (std::vector<vtkMRMLNode*>::const_iterator it = classNodes.begin();
+       it != classNodes.end(); ++it)
     {
-    node = (vtkMRMLNode*)this->Nodes->GetItemAsObject(n);
-    if (!strcmp(node->GetName(), name) && node->IsA(className))
+    vtkMRMLNode* node = *it;
+    if (!strcmp(node->GetName(), name))
       {
       nodes->AddItem(node);
       }
@@ -1812,9 +1864,16 @@ vtkMRMLNode* vtkMRMLScene::InsertAfterNode(vtkMRMLNode *item, vtkMRMLNode *n)
     }
   // cache the node so the whole scene cache stays up-todate
   this->AddNodeID(n);
+  // the node is not necessarily at the end of the collection, the class
+  // lists are lazily recomputed to keep the ordering
+  this->ClearNodesByClass();
 
   n->SetDisableModifiedEvent(modifyStatus);
 
+  if (this->RecordingNodesDelta)
+    {
+    this->NodesDelta->NodeAdded(n);
+    }
   this->InvokeEvent(this->NodeAddedEvent, n);
 
   this->Modified();
@@ -1893,9 +1952,16 @@ vtkMRMLNode* vtkMRMLScene::InsertBeforeNode(vtkMRMLNode *item, vtkMRMLNode *n)
     }
   // cache the node so the whole scene cache stays up-todate
   this->AddNodeID(n);
+  // the node is not necessarily at the end of the collection, the class
+  // lists are lazily recomputed to keep the ordering
+  this->ClearNodesByClass();
 
   n->SetDisableModifiedEvent(modifyStatus);
 
+  if (this->RecordingNodesDelta)
+    {
+    this->NodesDelta->NodeAdded(n);
+    }
   this->InvokeEvent(this->NodeAddedEvent, n);
 
   this->Modified();
@@ -2931,6 +2997,101 @@ void vtkMRMLScene::ClearNodeIDs()
   }
 }
 
+//-----------------------------------------------------------------------------
+void vtkMRMLScene::UpdateNodesByClass()
+{
+  // The Nodes collection has been modified without AddNodeByClass() or
+  // RemoveNodeByClass() being called (e.g. the collection was directly
+  // modified). The class lists are lazily recomputed.
+  if (this->Nodes->GetMTime() > this->NodesByClassMTime)
+    {
+    this->ClearNodesByClass();
+    }
+}
+
+//-----------------------------------------------------------------------------
+void vtkMRMLScene::AddNodeByClass(vtkMRMLNode *node)
+{
+  if (!this->Nodes || !node)
+    {
+    return;
+    }
+  // Nodes are appended at the end of the collection, the ordering of the
+  // class lists is preserved.
+  std::map< std::string, std::vector<vtkMRMLNode*> >::iterator it;
+  for (it = this->NodesByClass.begin(); it != this->NodesByClass.end(); ++it)
+    {
+    if (node->IsA(it->first.c_str()))
+      {
+      it->second.push_back(node);
+      }
+    }
+  this->NodesByClassMTime = this->Nodes->GetMTime();
+}
+
+//-----------------------------------------------------------------------------
+void vtkMRMLScene::RemoveNodeByClass(vtkMRMLNode *node)
+{
+  if (!this->Nodes || !node)
+    {
+    return;
+    }
+  std::map< std::string, std::vector<vtkMRMLNode*> >::iterator it;
+  for (it = this->NodesByClass.begin(); it != this->NodesByClass.end(); ++it)
+    {
+    if (!node->IsA(it->first.c_str()))
+      {
+      continue;
+      }
+    std::vector<vtkMRMLNode*>::iterator nodeIt =
+      std::find(it->second.begin(), it->second.end(), node);
+    if (nodeIt != it->second.end())
+      {
+      it->second.erase(nodeIt);
+      }
+    }
+  this->NodesByClassMTime = this->Nodes->GetMTime();
+}
+
+//-----------------------------------------------------------------------------
+void vtkMRMLScene::ClearNodesByClass()
+{
+  if (this->Nodes)
+    {
+    this->NodesByClass.clear();
+    this->NodesByClassMTime = this->Nodes->GetMTime();
+    }
+}
+
+//-----------------------------------------------------------------------------
+const std::vector<vtkMRMLNode*>& vtkMRMLScene::GetCachedNodesByClass(const char* className)
+{
+  assert(className);
+  this->UpdateNodesByClass();
+  std::map< std::string, std::vector<vtkMRMLNode*> >::iterator it =
+    this->NodesByClass.find(std::string(className));
+  if (it != this->NodesByClass.end())
+    {
+    return it->second;
+    }
+#ifdef MRMLSCENE_VERBOSE
+  std::cerr << "Compute node class cache for " << className << "..." << std::endl;
+#endif
+  std::vector<vtkMRMLNode*>& classNodes = this->NodesByClass[std::string(className)];
+  vtkMRMLNode *node;
+  vtkCollectionSimpleIterator nodeIt;
+  for (this->Nodes->InitTraversal(nodeIt);
+       (node = (vtkMRMLNode*)this->Nodes->GetNextItemAsObject(nodeIt)) ;)
+    {
+    if (node->IsA(className))
+      {
+      classNodes.push_back(node);
+      }
+    }
+  this->NodesByClassMTime = this->Nodes->GetMTime();
+  return classNodes;
+}
+
 //------------------------------------------------------------------------------
 void vtkMRMLScene::AddURIHandler(vtkURIHandler *handler)
 {
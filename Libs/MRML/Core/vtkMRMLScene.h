@@ -38,6 +38,7 @@ class vtkCollection;
 class vtkGeneralTransform;
 class vtkURIHandler;
 class vtkMRMLNode;
+class vtkMRMLSceneNodesDelta;
 class vtkMRMLSceneViewNode;
 
 /// \brief A set of MRML Nodes that supports serialization and undo/redo.
@@ -418,6 +419,8 @@ public:
   /// the events NodeAddedEvent and NodeRemovedEvent to
   /// only synchronize with the scene when the scene is no longer in
   ///  \a BatchProcessState (EndBatchProcessEvent being fired).
+  /// Alternatively, observers of NodesChangedEvent receive once per batch
+  /// the list of nodes added, removed and modified during the batch.
   ///
   /// The call <code>scene->Connect("myScene.mrml");</code> that closes and
   /// import a scene will fire the events:
@@ -437,6 +440,7 @@ public:
   /// vtkMRMLScene::ProgressImportEvent,
   /// vtkMRMLScene::ProgressBatchProcessEvent,
   /// ...
+  /// vtkMRMLScene::NodesChangedEvent (if a nodes delta observer is registered),
   /// vtkMRMLScene::EndImportEvent,
   /// vtkMRMLScene::EndBatchProcessEvent
   enum StateType
@@ -503,6 +507,25 @@ public:
   /// TODO: Report progress of the current state.
   void ProgressState(unsigned long state, int progress = 0);
 
+  /// Return true if the nodes added, removed and modified are being recorded
+  /// into the nodes delta. It is the case when the scene is in
+  /// \a BatchProcessState and a nodes delta observer was registered when
+  /// the batch started.
+  /// \sa GetNodesDelta, NodesChangedEvent, RegisterNodesDeltaObserver
+  bool IsRecordingNodesDelta()const {return this->RecordingNodesDelta;}
+
+  /// Observers of NodesChangedEvent must register themselves: the nodes
+  /// delta is only recorded, and NodesChangedEvent only fired, if there is
+  /// at least one registered observer. Calls must be balanced.
+  /// \sa UnregisterNodesDeltaObserver, NodesChangedEvent
+  void RegisterNodesDeltaObserver();
+  void UnregisterNodesDeltaObserver();
+
+  /// Nodes added, removed and modified since the beginning of the current
+  /// batch. It is reset after NodesChangedEvent is fired.
+  /// \sa IsRecordingNodesDelta, NodesChangedEvent
+  vtkGetObjectMacro(NodesDelta, vtkMRMLSceneNodesDelta);
+
   enum SceneEventType
     {
     NodeAboutToBeAddedEvent = 0x2000,
@@ -515,6 +538,16 @@ public:
     MetadataAddedEvent,
     ImportProgressFeedbackEvent,
     SaveProgressFeedbackEvent,
+    /// Fired at the end of a batch process (before EndCloseEvent,
+    /// EndImportEvent, EndRestoreEvent and EndBatchProcessEvent) if nodes
+    /// have been added, removed or modified during the batch.
+    /// The call data is a vtkMRMLSceneNodesDelta listing the changes.
+    /// Observers can then ignore NodeAddedEvent, NodeRemovedEvent and the
+    /// node ModifiedEvent while the scene IsRecordingNodesDelta() and update
+    /// only once.
+    /// The delta is recorded only if an observer is registered with
+    /// RegisterNodesDeltaObserver() when the batch process starts.
+    NodesChangedEvent,
 
     /// \internal
     /// not to be used directly
@@ -620,6 +653,25 @@ protected:
   /// Clear NodeIDs map used to speedup GetByID() method
   void ClearNodeIDs();
 
+  /// Syncronize NodesByClass cache used to speedup GetNodesByClass() methods
+  /// with the Nodes collection
+  void UpdateNodesByClass();
+
+  /// Add node to the NodesByClass lists of all its cached classes
+  void AddNodeByClass(vtkMRMLNode *node);
+
+  /// Remove node from the NodesByClass lists of all its cached classes
+  void RemoveNodeByClass(vtkMRMLNode *node);
+
+  /// Clear NodesByClass cache used to speedup GetNodesByClass() methods
+  void ClearNodesByClass();
+
+  /// Return the nodes of class \a className (or of one of its subclasses) in
+  /// the order they are in the Nodes collection.
+  /// The list is computed the first time a class is requested and is then
+  /// incrementally updated by AddNode() and RemoveNode().
+  const std::vector<vtkMRMLNode*>& GetCachedNodesByClass(const char* className);
+
   /// Get a NodeReferences iterator for a node reference
   NodeReferencesType::iterator FindNodeReference(const char* referencedId, vtkMRMLNode* referencingNode);
 
@@ -634,6 +686,11 @@ protected:
 
   std::vector<unsigned long> States;
 
+  /// Changes recorded during the current batch process
+  vtkMRMLSceneNodesDelta* NodesDelta;
+  bool RecordingNodesDelta;
+  int NodesDeltaObserverCount;
+
   int  UndoStackSize;
   bool UndoFlag;
   bool InUndo;
@@ -655,6 +712,9 @@ protected:
   NodeReferencesType NodeReferences; // ReferencedIDs (string), ReferencingNodes (node pointer)
   std::map< std::string, std::string > ReferencedIDChanges;
   std::map< std::string, vtkSmartPointer<vtkMRMLNode> > NodeIDs;
+  /// Nodes of each queried class name (subclasses included), the nodes are
+  /// not referenced as they are already referenced by the Nodes collection.
+  std::map< std::string, std::vector<vtkMRMLNode*> > NodesByClass;
 
   std::string ErrorMessage;
 
@@ -667,6 +727,7 @@ protected:
   int ReadDataOnLoad;
 
   unsigned long NodeIDsMTime;
+  unsigned long NodesByClassMTime;
 
   void RemoveAllNodes(bool removeSingletons);
 
@@ -0,0 +1,245 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+// MRML includes
+#include "vtkMRMLNode.h"
+#include "vtkMRMLSceneNodesDelta.h"
+
+// VTK includes
+#include <vtkObjectFactory.h>
+
+// STD includes
+#include <algorithm>
+
+//----------------------------------------------------------------------------
+vtkStandardNewMacro(vtkMRMLSceneNodesDelta);
+
+//----------------------------------------------------------------------------
+vtkMRMLSceneNodesDelta::vtkMRMLSceneNodesDelta()
+{
+  this->LastModifiedNode = 0;
+}
+
+//----------------------------------------------------------------------------
+vtkMRMLSceneNodesDelta::~vtkMRMLSceneNodesDelta()
+{
+  this->Reset();
+}
+
+//----------------------------------------------------------------------------
+void vtkMRMLSceneNodesDelta::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+  os << indent << "AddedNodes: " << this->AddedNodes.size() << "\n";
+  os << indent << "RemovedNodes: " << this->RemovedNodes.size() << "\n";
+  os << indent << "ModifiedNodes: " << this->ModifiedNodes.size() << "\n";
+}
+
+//----------------------------------------------------------------------------
+void vtkMRMLSceneNodesDelta::NodeAdded(vtkMRMLNode* node)
+{
+  if (!node || this->AddedNodeSet.count(node))
+    {
+    return;
+    }
+  this->LastModifiedNode = 0;
+  if (this->RemovedNodeSet.erase(node))
+    {
+    // The node was removed then added back, for the observers it is as if it
+    // had just been modified.
+    RemoveFromList(this->RemovedNodes, node);
+    if (this->ModifiedNodeSet.insert(node).second)
+      {
+      this->ModifiedNodes.push_back(node);
+      }
+    return;
+    }
+  if (this->ModifiedNodeSet.erase(node))
+    {
+    RemoveFromList(this->ModifiedNodes, node);
+    }
+  this->AddedNodeSet.insert(node);
+  this->AddedNodes.push_back(node);
+}
+
+//----------------------------------------------------------------------------
+void vtkMRMLSceneNodesDelta::NodeRemoved(vtkMRMLNode* node)
+{
+  if (!node || this->RemovedNodeSet.count(node))
+    {
+    return;
+    }
+  this->LastModifiedNode = 0;
+  if (this->AddedNodeSet.erase(node))
+    {
+    // Added and removed within the same batch: observers never have to know
+    // about it.
+    RemoveFromList(this->AddedNodes, node);
+    return;
+    }
+  if (this->ModifiedNodeSet.erase(node))
+    {
+    RemoveFromList(this->ModifiedNodes, node);
+    }
+  this->RemovedNodeSet.insert(node);
+  this->RemovedNodes.push_back(node);
+}
+
+//----------------------------------------------------------------------------
+void vtkMRMLSceneNodesDelta::NodeModified(vtkMRMLNode* node)
+{
+  if (!node || node == this->LastModifiedNode ||
+      this->AddedNodeSet.count(node) ||
+      this->RemovedNodeSet.count(node))
+    {
+    return;
+    }
+  if (this->ModifiedNodeSet.insert(node).second)
+    {
+    this->ModifiedNodes.push_back(node);
+    }
+  this->LastModifiedNode = node;
+}
+
+//----------------------------------------------------------------------------
+void vtkMRMLSceneNodesDelta::RemoveModifiedNode(vtkMRMLNode* node)
+{
+  if (node == this->LastModifiedNode)
+    {
+    this->LastModifiedNode = 0;
+    }
+  if (this->ModifiedNodeSet.erase(node))
+    {
+    RemoveFromList(this->ModifiedNodes, node);
+    }
+}
+
+//----------------------------------------------------------------------------
+void vtkMRMLSceneNodesDelta::Reset()
+{
+  this->LastModifiedNode = 0;
+  this->AddedNodeSet.clear();
+  this->RemovedNodeSet.clear();
+  this->ModifiedNodeSet.clear();
+  // Releasing the removed nodes may delete them, clear the sets first.
+  this->AddedNodes.clear();
+  this->RemovedNodes.clear();
+  this->ModifiedNodes.clear();
+}
+
+//----------------------------------------------------------------------------
+bool vtkMRMLSceneNodesDelta::IsEmpty()const
+{
+  return this->AddedNodes.empty() &&
+         this->RemovedNodes.empty() &&
+         this->ModifiedNodes.empty();
+}
+
+//----------------------------------------------------------------------------
+int vtkMRMLSceneNodesDelta::GetNumberOfAddedNodes()const
+{
+  return static_cast<int>(this->AddedNodes.size());
+}
+
+//----------------------------------------------------------------------------
+vtkMRMLNode* vtkMRMLSceneNodesDelta::GetNthAddedNode(int n)const
+{
+  return GetNthNode(this->AddedNodes, n);
+}
+
+//----------------------------------------------------------------------------
+int vtkMRMLSceneNodesDelta::GetNumberOfRemovedNodes()const
+{
+  return static_cast<int>(this->RemovedNodes.size());
+}
+
+//----------------------------------------------------------------------------
+vtkMRMLNode* vtkMRMLSceneNodesDelta::GetNthRemovedNode(int n)const
+{
+  return GetNthNode(this->RemovedNodes, n);
+}
+
+//----------------------------------------------------------------------------
+int vtkMRMLSceneNodesDelta::GetNumberOfModifiedNodes()const
+{
+  return static_cast<int>(this->ModifiedNodes.size());
+}
+
+//----------------------------------------------------------------------------
+vtkMRMLNode* vtkMRMLSceneNodesDelta::GetNthModifiedNode(int n)const
+{
+  return GetNthNode(this->ModifiedNodes, n);
+}
+
+//----------------------------------------------------------------------------
+bool vtkMRMLSceneNodesDelta::IsNodeAdded(vtkMRMLNode* node)const
+{
+  return this->AddedNodeSet.count(node) != 0;
+}
+
+//----------------------------------------------------------------------------
+bool vtkMRMLSceneNodesDelta::IsNodeRemoved(vtkMRMLNode* node)const
+{
+  return this->RemovedNodeSet.count(node) != 0;
+}
+
+//----------------------------------------------------------------------------
+bool vtkMRMLSceneNodesDelta::IsNodeModified(vtkMRMLNode* node)const
+{
+  return this->ModifiedNodeSet.count(node) != 0;
+}
+
+//----------------------------------------------------------------------------
+bool vtkMRMLSceneNodesDelta::HasNodeOfClass(const char* className)const
+{
+  return HasNodeOfClass(this->AddedNodes, className) ||
+         HasNodeOfClass(this->RemovedNodes, className) ||
+         HasNodeOfClass(this->ModifiedNodes, className);
+}
+
+//----------------------------------------------------------------------------
+void vtkMRMLSceneNodesDelta::RemoveFromList(NodeListType& nodes, vtkMRMLNode* node)
+{
+  NodeListType::iterator it =
+    std::find(nodes.begin(), nodes.end(), vtkSmartPointer<vtkMRMLNode>(node));
+  if (it != nodes.end())
+    {
+    nodes.erase(it);
+    }
+}
+
+//----------------------------------------------------------------------------
+vtkMRMLNode* vtkMRMLSceneNodesDelta::GetNthNode(const NodeListType& nodes, int n)
+{
+  if (n < 0 || n >= static_cast<int>(nodes.size()))
+    {
+    return 0;
+    }
+  return nodes[n];
+}
+
+//----------------------------------------------------------------------------
+bool vtkMRMLSceneNodesDelta::HasNodeOfClass(const NodeListType& nodes,
+                                            const char* className)
+{
+  for (NodeListType::const_iterator it = nodes.begin(); it != nodes.end(); ++it)
+    {
+    if ((*it)->IsA(className))
+      {
+      return true;
+      }
+    }
+  return false;
+}
@@ -0,0 +1,112 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+#ifndef __vtkMRMLSceneNodesDelta_h
+#define __vtkMRMLSceneNodesDelta_h
+
+// MRML includes
+#include "vtkMRML.h"
+
+// VTK includes
+#include <vtkObject.h>
+#include <vtkSmartPointer.h>
+
+// STD includes
+#include <set>
+#include <vector>
+
+class vtkMRMLNode;
+
+/// \brief Summary of the nodes added, removed and modified during a batch.
+///
+/// The scene records the changes into a delta while it is in
+/// BatchProcessState and sends it as the call data of
+/// vtkMRMLScene::NodesChangedEvent when the batch ends.
+/// The changes are coalesced:
+///  - a node added then removed within the batch is not reported
+///  - a node removed then added back is reported as modified
+///  - a node added within the batch is not reported as modified
+/// Nodes are listed in the order they were first recorded.
+/// Removed nodes are referenced by the delta until it is reset so that
+/// observers can safely query them.
+/// \sa vtkMRMLScene::NodesChangedEvent
+class VTK_MRML_EXPORT vtkMRMLSceneNodesDelta : public vtkObject
+{
+public:
+  static vtkMRMLSceneNodesDelta *New();
+  vtkTypeMacro(vtkMRMLSceneNodesDelta, vtkObject);
+  void PrintSelf(ostream& os, vtkIndent indent);
+
+  /// Record that \a node has been added to the scene.
+  void NodeAdded(vtkMRMLNode* node);
+  /// Record that \a node has been removed from the scene.
+  void NodeRemoved(vtkMRMLNode* node);
+  /// Record that \a node has been modified.
+  void NodeModified(vtkMRMLNode* node);
+  /// Forget that \a node has been modified.
+  void RemoveModifiedNode(vtkMRMLNode* node);
+
+  /// Forget all the recorded changes.
+  void Reset();
+  /// Return true if no change has been recorded.
+  bool IsEmpty()const;
+
+  int GetNumberOfAddedNodes()const;
+  vtkMRMLNode* GetNthAddedNode(int n)const;
+
+  int GetNumberOfRemovedNodes()const;
+  vtkMRMLNode* GetNthRemovedNode(int n)const;
+
+  int GetNumberOfModifiedNodes()const;
+  vtkMRMLNode* GetNthModifiedNode(int n)const;
+
+  /// Return true if \a node has been recorded as added, removed or modified.
+  bool IsNodeAdded(vtkMRMLNode* node)const;
+  bool IsNodeRemoved(vtkMRMLNode* node)const;
+  bool IsNodeModified(vtkMRMLNode* node)const;
+
+  /// Return true if any of the added, removed or modified nodes is
+  /// of type \a className.
+  bool HasNodeOfClass(const char* className)const;
+
+protected:
+  vtkMRMLSceneNodesDelta();
+  virtual ~vtkMRMLSceneNodesDelta();
+
+  typedef std::vector<vtkSmartPointer<vtkMRMLNode> > NodeListType;
+  typedef std::set<vtkMRMLNode*> NodeSetType;
+
+  /// Remove \a node from the ordered list \a nodes.
+  static void RemoveFromList(NodeListType& nodes, vtkMRMLNode* node);
+  static vtkMRMLNode* GetNthNode(const NodeListType& nodes, int n);
+  static bool HasNodeOfClass(const NodeListType& nodes, const char* className);
+
+  NodeListType AddedNodes;
+  NodeListType RemovedNodes;
+  NodeListType ModifiedNodes;
+  /// Fast membership tests
+  NodeSetType AddedNodeSet;
+  NodeSetType RemovedNodeSet;
+  NodeSetType ModifiedNodeSet;
+  /// Last node recorded by NodeModified, nodes are often modified several
+  /// times in a row.
+  vtkMRMLNode* LastModifiedNode;
+
+private:
+  vtkMRMLSceneNodesDelta(const vtkMRMLSceneNodesDelta&); // Not implemented
+  void operator=(const vtkMRMLSceneNodesDelta&);         // Not implemented
+};
+
+#endif
@@ -216,6 +216,7 @@ void vtkMRMLSceneViewNode::ProcessChildNode(vtkMRMLNode *node)
   this->SnapshotScene->GetNodes()->vtkCollection::AddItem((vtkObject *)node);
 
   this->SnapshotScene->AddNodeID(node);
+  this->SnapshotScene->AddNodeByClass(node);
 
   node->SetScene(this->SnapshotScene);
 
@@ -244,6 +245,7 @@ void vtkMRMLSceneViewNode::Copy(vtkMRMLNode *anode)
     {
     this->SnapshotScene->GetNodes()->RemoveAllItems();
     this->SnapshotScene->ClearNodeIDs();
+    this->SnapshotScene->ClearNodesByClass();
     }
   vtkMRMLNode *node = NULL;
   if ( snode->SnapshotScene != NULL )
@@ -48,6 +48,7 @@ Version:   $Revision: 1.6 $
 
 //----------------------------------------------------------------------------
 vtkMRMLNodeNewMacro(vtkMRMLVolumeArchetypeStorageNode);
+vtkCxxSetObjectMacro(vtkMRMLVolumeArchetypeStorageNode, DecodedReader, vtkITKArchetypeImageSeriesReader);
 
 //----------------------------------------------------------------------------
 vtkMRMLVolumeArchetypeStorageNode::vtkMRMLVolumeArchetypeStorageNode()
@@ -55,11 +56,13 @@ vtkMRMLVolumeArchetypeStorageNode::vtkMRMLVolumeArchetypeStorageNode()
   this->CenterImage = 0;
   this->SingleFile  = 0;
   this->UseOrientationFromFile = 1;
+  this->DecodedReader = 0;
 }
 
 //----------------------------------------------------------------------------
 vtkMRMLVolumeArchetypeStorageNode::~vtkMRMLVolumeArchetypeStorageNode()
 {
+  this->SetDecodedReader(0);
 }
 
 //----------------------------------------------------------------------------
@@ -259,14 +262,14 @@ void ApplyImageSeriesReaderWorkaround(vtkMRMLVolumeArchetypeStorageNode * storag
 } // end of anonymous namespace
 
 //----------------------------------------------------------------------------
-int vtkMRMLVolumeArchetypeStorageNode::ReadDataInternal(vtkMRMLNode *refNode)
+vtkITKArchetypeImageSeriesReader* vtkMRMLVolumeArchetypeStorageNode::CreateDecodeReader(vtkMRMLNode *refNode)
 {
   std::string fullName = this->GetFullNameFromFileName();
-  vtkDebugMacro("ReadData: got full archetype name " << fullName);
+  vtkDebugMacro("CreateDecodeReader: got full archetype name " << fullName);
 
   if (fullName.empty())
     {
-    vtkErrorMacro("ReadData: File name not specified");
+    vtkErrorMacro("CreateDecodeReader: File name not specified");
     return 0;
     }
 
@@ -286,10 +289,9 @@ int vtkMRMLVolumeArchetypeStorageNode::ReadDataInternal(vtkMRMLNode *refNode)
   //                  |---vtkMRMLVectorVolumeNode
   //
 
-  vtkMRMLScalarVolumeNode * volNode = vtkMRMLScalarVolumeNode::SafeDownCast(refNode);
-  if(volNode == NULL)
+  if(vtkMRMLScalarVolumeNode::SafeDownCast(refNode) == NULL)
     {
-    vtkErrorMacro("ReadData: Reference node is expected to be a vtkMRMLScalarVolumeNode");
+    vtkErrorMacro("CreateDecodeReader: Reference node is expected to be a vtkMRMLScalarVolumeNode");
     return 0;
     }
 
@@ -314,17 +316,10 @@ int vtkMRMLVolumeArchetypeStorageNode::ReadDataInternal(vtkMRMLNode *refNode)
 
   if (reader.GetPointer() == NULL)
     {
-    vtkErrorMacro("ReadData: Failed to instantiate a file reader");
+    vtkErrorMacro("CreateDecodeReader: Failed to instantiate a file reader");
     return 0;
     }
 
-  reader->AddObserver( vtkCommand::ProgressEvent,  this->MRMLCallbackCommand);
-
-  if (volNode->GetImageData())
-    {
-    volNode->SetAndObserveImageData(NULL);
-    }
-
   // Set the list of file names on the reader
   reader->ResetFileNames();
   reader->SetArchetype(fullName.c_str());
@@ -344,9 +339,24 @@ int vtkMRMLVolumeArchetypeStorageNode::ReadDataInternal(vtkMRMLNode *refNode)
     reader->SetUseNativeOriginOn();
     }
 
+  reader->Register(this);
+  return reader;
+}
+
+//----------------------------------------------------------------------------
+bool vtkMRMLVolumeArchetypeStorageNode::DecodeData(
+  vtkITKArchetypeImageSeriesReader* reader, vtkMRMLNode *refNode)
+{
+  if (reader == NULL || refNode == NULL)
+    {
+    vtkErrorMacro("DecodeData: No reader or reference node");
+    return false;
+    }
+  std::string fullName = reader->GetArchetype() ? reader->GetArchetype() : "";
+
   try
     {
-    vtkDebugMacro("ReadData: right before reader update, reader num files = " << reader->GetNumberOfFileNames());
+    vtkDebugMacro("DecodeData: right before reader update, reader num files = " << reader->GetNumberOfFileNames());
     reader->Update();
     }
   catch (...)
@@ -356,7 +366,7 @@ int vtkMRMLVolumeArchetypeStorageNode::ReadDataInternal(vtkMRMLNode *refNode)
       {
       reader0thFileName = std::string("reader 0th file name = ") + std::string(reader->GetFileName(0));
       }
-    vtkErrorMacro("ReadData: Cannot read file as a volume of type "
+    vtkErrorMacro("DecodeData: Cannot read file as a volume of type "
                   << (refNode ? refNode->GetNodeTagName() : "null")
                   << "[" << "fullName = " << fullName << "]\n"
                   << "\tNumber of files listed in the node = "
@@ -365,37 +375,75 @@ int vtkMRMLVolumeArchetypeStorageNode::ReadDataInternal(vtkMRMLNode *refNode)
                   << reader->GetNumberOfFileNames() << " files.\n"
                   << "\tFile reader used the archetype file name of " << reader->GetArchetype()
                   << " [" << reader0thFileName.c_str() << "]\n");
-    return 0;
+    return false;
     }
 
   if (reader->GetOutput() == NULL || reader->GetOutput()->GetPointData() == NULL)
     {
-    vtkErrorMacro("ReadData: Unable to read data from file: " << fullName);
+    vtkErrorMacro("DecodeData: Unable to read data from file: " << fullName);
+    return false;
     }
 
   vtkPointData * pointData = reader->GetOutput()->GetPointData();
-  if (volNode->IsA("vtkMRMLDiffusionTensorVolumeNode"))
+  if (refNode->IsA("vtkMRMLDiffusionTensorVolumeNode"))
     {
     if (pointData->GetTensors() == NULL || pointData->GetTensors()->GetNumberOfTuples() == 0)
       {
-      vtkErrorMacro("ReadData: Unable to read DiffusionTensorVolume data from file: " << fullName );
-      return 0;
+      vtkErrorMacro("DecodeData: Unable to read DiffusionTensorVolume data from file: " << fullName );
+      return false;
       }
     }
   else
     {
     if (pointData->GetScalars() == NULL || pointData->GetScalars()->GetNumberOfTuples() == 0)
       {
-      vtkErrorMacro("ReadData: Unable to read ScalarVolume data from file: " << fullName );
-      return 0;
+      vtkErrorMacro("DecodeData: Unable to read ScalarVolume data from file: " << fullName );
+      return false;
       }
     }
 
-  if (!volNode->IsA("vtkMRMLVectorVolumeNode")
-      && !volNode->IsA("vtkMRMLDiffusionTensorVolumeNode")
+  if (!refNode->IsA("vtkMRMLVectorVolumeNode")
+      && !refNode->IsA("vtkMRMLDiffusionTensorVolumeNode")
       && reader->GetNumberOfComponents() != 1)
     {
-    vtkErrorMacro("ReadData: Not a scalar volume file: " << fullName );
+    vtkErrorMacro("DecodeData: Not a scalar volume file: " << fullName );
+    }
+
+  return true;
+}
+
+//----------------------------------------------------------------------------
+int vtkMRMLVolumeArchetypeStorageNode::ReadDataInternal(vtkMRMLNode *refNode)
+{
+  vtkMRMLScalarVolumeNode * volNode = vtkMRMLScalarVolumeNode::SafeDownCast(refNode);
+  if(volNode == NULL)
+    {
+    vtkErrorMacro("ReadData: Reference node is expected to be a vtkMRMLScalarVolumeNode");
+    return 0;
+    }
+
+  if (volNode->GetImageData())
+    {
+    volNode->SetAndObserveImageData(NULL);
+    }
+
+  // Use the reader decoded beforehand if any
+  vtkSmartPointer<vtkITKArchetypeImageSeriesReader> reader = this->DecodedReader;
+  this->SetDecodedReader(0);
+  if (reader.GetPointer() == NULL)
+    {
+    reader.TakeReference(this->CreateDecodeReader(refNode));
+    if (reader.GetPointer() == NULL)
+      {
+      return 0;
+      }
+    reader->AddObserver( vtkCommand::ProgressEvent,  this->MRMLCallbackCommand);
+    bool decoded = this->DecodeData(reader, refNode);
+    reader->RemoveObservers( vtkCommand::ProgressEvent, this->MRMLCallbackCommand);
+    if (!decoded)
+      {
+      return 0;
+      }
     }
 
   // Set volume attributes
@@ -427,7 +475,7 @@ int vtkMRMLVolumeArchetypeStorageNode::ReadDataInternal(vtkMRMLNode *refNode)
 
   if (ici->GetOutput() == NULL)
     {
-    vtkErrorMacro("vtkMRMLVolumeArchetypeStorageNode: Cannot read file: " << fullName);
+    vtkErrorMacro("vtkMRMLVolumeArchetypeStorageNode: Cannot read file: " << reader->GetArchetype());
     return 0;
     }
 
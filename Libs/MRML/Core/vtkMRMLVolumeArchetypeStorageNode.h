@@ -86,6 +86,30 @@ public:
   /// instance to turn off compression.
   virtual void ConfigureForDataExchange();
 
+  ///
+  /// Create and set up the reader that decodes the file into a volume of
+  /// the type of \a refNode. Observers of the reader, e.g. of its progress,
+  /// can be added before it is passed to DecodeData().
+  /// Return 0 on failure, the caller owns the reader.
+  /// \sa DecodeData()
+  vtkITKArchetypeImageSeriesReader* CreateDecodeReader(vtkMRMLNode *refNode);
+
+  ///
+  /// Decode the file with a reader created by CreateDecodeReader(), without
+  /// setting the data on a node. Neither the scene nor observers are added
+  /// or removed: on a storage node and a reference node that are not in a
+  /// scene, it can be called outside of the main thread.
+  /// Return false on failure.
+  /// \sa SetDecodedReader()
+  bool DecodeData(vtkITKArchetypeImageSeriesReader* reader,
+                  vtkMRMLNode *refNode);
+
+  ///
+  /// Reader decoded by DecodeData() to use instead of decoding the file
+  /// on the next ReadData(). It is released by ReadData().
+  virtual void SetDecodedReader(vtkITKArchetypeImageSeriesReader* reader);
+  vtkGetObjectMacro(DecodedReader, vtkITKArchetypeImageSeriesReader);
+
 protected:
   vtkMRMLVolumeArchetypeStorageNode();
   ~vtkMRMLVolumeArchetypeStorageNode();
@@ -106,6 +130,7 @@ protected:
   int CenterImage;
   int SingleFile;
   int UseOrientationFromFile;
+  vtkITKArchetypeImageSeriesReader* DecodedReader;
 
 };
 
@@ -30,6 +30,8 @@ vtkObservation::vtkObservation()
 {
   this->EventBroker = NULL;
   this->InEventQueue = 0;
+  this->PostedCount = 0;
+  this->Removed = 0;
   this->Subject = NULL;
   this->Event = 0;
   this->Observer = NULL;
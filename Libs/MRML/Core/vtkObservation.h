@@ -99,6 +99,8 @@ class VTK_MRML_EXPORT vtkObservation : public vtkObject
   std::deque<CallType> *GetCallDataList() {return &(this->CallDataList);};
 
 protected:
+  friend class vtkEventBroker;
+
   vtkObservation();
   virtual ~vtkObservation();
   vtkObservation(const vtkObservation&);
@@ -119,6 +121,16 @@ protected:
   /// to be re-added
   int InEventQueue;
 
+  /// 
+  /// Number of calls posted to the broker from any thread and not yet
+  /// collected into the event queue. Only changed atomically by the broker.
+  volatile long PostedCount;
+
+  /// 
+  /// Flag that tells the broker that this observation has been removed
+  /// while calls were still posted: it is deleted once they are collected
+  int Removed;
+
   /// 
   /// Holder for Subject
   vtkObject *Subject;
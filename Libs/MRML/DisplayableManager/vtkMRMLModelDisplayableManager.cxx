@@ -30,6 +30,7 @@
 #include <vtkMRMLProceduralColorNode.h>
 #include "vtkMRMLClipModelsNode.h"
 #include <vtkMRMLScene.h>
+#include <vtkMRMLSceneNodesDelta.h>
 #include "vtkMRMLSliceNode.h"
 #include "vtkMRMLViewNode.h"
 #include "vtkMRMLInteractionNode.h"
@@ -43,6 +44,7 @@
 #include <vtkImageActor.h>
 #include <vtkImageData.h>
 #include <vtkImplicitBoolean.h>
+#include <vtkIntArray.h>
 #include <vtkLookupTable.h>
 #include <vtkMatrix4x4.h>
 #include <vtkNew.h>
@@ -62,6 +64,7 @@
 
 // STD includes
 #include <cassert>
+#include <set>
 
 //---------------------------------------------------------------------------
 vtkStandardNewMacro (vtkMRMLModelDisplayableManager );
@@ -457,6 +460,15 @@ void vtkMRMLModelDisplayableManager::ProcessMRMLNodesEvents(vtkObject *caller,
     }
 
   bool isUpdating = this->GetMRMLScene()->IsBatchProcessing();
+  // While the scene records the batch changes, the modified models are
+  // processed all at once in OnMRMLSceneNodesChanged.
+  if (this->GetMRMLScene()->IsRecordingNodesDelta() &&
+      (event == vtkCommand::ModifiedEvent ||
+       event == vtkMRMLDisplayableNode::DisplayModifiedEvent) &&
+      vtkMRMLDisplayableNode::SafeDownCast(caller))
+    {
+    return;
+    }
   if (vtkMRMLDisplayableNode::SafeDownCast(caller))
     {
     // There is no need to request a render (which can be expensive if the
@@ -539,6 +551,21 @@ void vtkMRMLModelDisplayableManager::ProcessMRMLNodesEvents(vtkObject *caller,
     }
 }
 
+//---------------------------------------------------------------------------
+void vtkMRMLModelDisplayableManager::SetMRMLSceneInternal(vtkMRMLScene* newScene)
+{
+  this->Superclass::SetMRMLSceneInternal(newScene);
+  if (!newScene)
+    {
+    return;
+    }
+  // Be notified once per batch process instead of once per node.
+  vtkNew<vtkIntArray> sceneEvents;
+  sceneEvents->InsertNextValue(vtkMRMLScene::NodesChangedEvent);
+  this->GetMRMLSceneObserverManager()->AddObjectEvents(
+    newScene, sceneEvents.GetPointer());
+}
+
 //---------------------------------------------------------------------------
 void vtkMRMLModelDisplayableManager::UnobserveMRMLScene()
 {
@@ -588,6 +615,12 @@ void vtkMRMLModelDisplayableManager::OnMRMLSceneNodeAdded(vtkMRMLNode* node)
     return;
     }
 
+  // The added nodes are processed in OnMRMLSceneNodesChanged
+  if (this->GetMRMLScene()->IsRecordingNodesDelta())
+    {
+    return;
+    }
+
   this->SetUpdateFromMRMLRequested(1);
 
   // Escape if the scene a scene is being closed, imported or connected
@@ -621,6 +654,12 @@ void vtkMRMLModelDisplayableManager::OnMRMLSceneNodeRemoved(vtkMRMLNode* node)
     return;
     }
 
+  // The removed nodes are processed in OnMRMLSceneNodesChanged
+  if (this->GetMRMLScene()->IsRecordingNodesDelta())
+    {
+    return;
+    }
+
   this->SetUpdateFromMRMLRequested(1);
 
   // Escape if the scene a scene is being closed, imported or connected
@@ -647,6 +686,84 @@ void vtkMRMLModelDisplayableManager::OnMRMLSceneNodeRemoved(vtkMRMLNode* node)
   this->RequestRender();
 }
 
+//---------------------------------------------------------------------------
+void vtkMRMLModelDisplayableManager::OnMRMLSceneNodesChanged(vtkMRMLSceneNodesDelta* delta)
+{
+  bool updateFromMRML = false;
+  for (int i = 0; i < delta->GetNumberOfRemovedNodes(); ++i)
+    {
+    vtkMRMLNode* node = delta->GetNthRemovedNode(i);
+    if (node->IsA("vtkMRMLDisplayableNode"))
+      {
+      this->RemoveDisplayable(vtkMRMLDisplayableNode::SafeDownCast(node));
+      updateFromMRML = true;
+      }
+    else if (node->IsA("vtkMRMLDisplayNode"))
+      {
+      updateFromMRML = true;
+      }
+    else if (node->IsA("vtkMRMLModelHierarchyNode"))
+      {
+      this->Internal->UpdateHierachyRequested = true;
+      updateFromMRML = true;
+      }
+    else if (node->IsA("vtkMRMLClipModelsNode"))
+      {
+      if (node == this->Internal->ClipModelsNode)
+        {
+        vtkSetMRMLNodeMacro(this->Internal->ClipModelsNode, 0);
+        }
+      updateFromMRML = true;
+      }
+    }
+  for (int i = 0; i < delta->GetNumberOfAddedNodes(); ++i)
+    {
+    vtkMRMLNode* node = delta->GetNthAddedNode(i);
+    if (node->IsA("vtkMRMLDisplayableNode") ||
+        node->IsA("vtkMRMLDisplayNode"))
+      {
+      updateFromMRML = true;
+      }
+    else if (node->IsA("vtkMRMLModelHierarchyNode"))
+      {
+      this->Internal->UpdateHierachyRequested = true;
+      updateFromMRML = true;
+      }
+    else if (node->IsA("vtkMRMLClipModelsNode"))
+      {
+      vtkSetAndObserveMRMLNodeMacro(this->Internal->ClipModelsNode, node);
+      updateFromMRML = true;
+      }
+    }
+  if (updateFromMRML)
+    {
+    // All the models are going to be updated at the end of the batch
+    // process, there is no need to process the modified models.
+    this->SetUpdateFromMRMLRequested(1);
+    return;
+    }
+  // Update each modified model only once, no matter how many times it or
+  // its display nodes have been modified during the batch.
+  std::set<vtkMRMLDisplayableNode*> modifiedModels;
+  for (int i = 0; i < delta->GetNumberOfModifiedNodes(); ++i)
+    {
+    vtkMRMLNode* node = delta->GetNthModifiedNode(i);
+    vtkMRMLDisplayableNode* displayableNode =
+      vtkMRMLDisplayableNode::SafeDownCast(node);
+    vtkMRMLDisplayNode* displayNode = vtkMRMLDisplayNode::SafeDownCast(node);
+    if (displayNode)
+      {
+      displayableNode = displayNode->GetDisplayableNode();
+      }
+    if (displayableNode &&
+        displayableNode->GetScene() == this->GetMRMLScene() &&
+        modifiedModels.insert(displayableNode).second)
+      {
+      this->OnMRMLDisplayableModelNodeModifiedEvent(displayableNode);
+      }
+    }
+}
+
 //---------------------------------------------------------------------------
 bool vtkMRMLModelDisplayableManager::IsModelDisplayable(vtkMRMLDisplayableNode* node)const
 {
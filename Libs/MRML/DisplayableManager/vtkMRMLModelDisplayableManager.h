@@ -142,6 +142,7 @@ protected:
   virtual void AdditionalInitializeStep();
   virtual int ActiveInteractionModes();
 
+  virtual void SetMRMLSceneInternal(vtkMRMLScene* newScene);
   virtual void UnobserveMRMLScene();
 
   virtual void OnMRMLSceneStartClose();
@@ -149,6 +150,7 @@ protected:
   virtual void UpdateFromMRMLScene();
   virtual void OnMRMLSceneNodeAdded(vtkMRMLNode* node);
   virtual void OnMRMLSceneNodeRemoved(vtkMRMLNode* node);
+  virtual void OnMRMLSceneNodesChanged(vtkMRMLSceneNodesDelta* delta);
 
   virtual void OnInteractorStyleEvent(int eventId);
   virtual void ProcessMRMLNodesEvents(vtkObject *caller, unsigned long event, void *callData);
@@ -0,0 +1,179 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+// MRMLLogic includes
+#include <vtkImageLabelStatistics.h>
+
+// VTK includes
+#include <vtkDataArray.h>
+#include <vtkImageData.h>
+#include <vtkNew.h>
+#include <vtkPointData.h>
+#include <vtkSmartPointer.h>
+#include <vtkTable.h>
+
+// STD includes
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <vector>
+
+namespace
+{
+
+//---------------------------------------------------------------------------
+struct ExpectedStatistics
+{
+  ExpectedStatistics() : Count(0), Min(VTK_DOUBLE_MAX), Max(-VTK_DOUBLE_MAX), Sum(0.) {}
+  vtkIdType Count;
+  double Min;
+  double Max;
+  double Sum;
+  std::vector<double> Values;
+};
+
+//---------------------------------------------------------------------------
+vtkSmartPointer<vtkImageData> createImage(int scalarType)
+{
+  vtkSmartPointer<vtkImageData> image = vtkSmartPointer<vtkImageData>::New();
+  image->SetDimensions(31, 17, 9);
+  image->SetSpacing(0.5, 2., 3.);
+  image->SetScalarType(scalarType);
+  image->SetNumberOfScalarComponents(1);
+  image->AllocateScalars();
+  return image;
+}
+
+//---------------------------------------------------------------------------
+bool checkStatistics(vtkImageLabelStatistics* statistics, vtkImageData* labelMap,
+                     vtkImageData* grayscale, double voxelVolume)
+{
+  std::map<int, ExpectedStatistics> expected;
+  for (vtkIdType i = 0; i < labelMap->GetNumberOfPoints(); ++i)
+    {
+    int label = static_cast<int>(labelMap->GetPointData()->GetScalars()->GetTuple1(i));
+    double value = grayscale->GetPointData()->GetScalars()->GetTuple1(i);
+    ExpectedStatistics& labelStatistics = expected[label];
+    ++labelStatistics.Count;
+    labelStatistics.Min = std::min(labelStatistics.Min, value);
+    labelStatistics.Max = std::max(labelStatistics.Max, value);
+    labelStatistics.Sum += value;
+    labelStatistics.Values.push_back(value);
+    }
+
+  vtkTable* table = statistics->GetOutput();
+  if (table->GetNumberOfRows() != static_cast<vtkIdType>(expected.size()) ||
+      table->GetNumberOfColumns() != 8)
+    {
+    std::cerr << "Wrong table size: " << table->GetNumberOfRows() << " x "
+              << table->GetNumberOfColumns() << std::endl;
+    return false;
+    }
+  vtkIdType row = 0;
+  for (std::map<int, ExpectedStatistics>::const_iterator it = expected.begin();
+       it != expected.end(); ++it, ++row)
+    {
+    const ExpectedStatistics& labelStatistics = it->second;
+    double mean = labelStatistics.Sum / labelStatistics.Count;
+    double sumOfSquares = 0.;
+    for (size_t v = 0; v < labelStatistics.Values.size(); ++v)
+      {
+      sumOfSquares += (labelStatistics.Values[v] - mean) * (labelStatistics.Values[v] - mean);
+      }
+    double stdDev = labelStatistics.Count > 1 ?
+      sqrt(sumOfSquares / (labelStatistics.Count - 1)) : 0.;
+    double expectedValues[8] = {
+      static_cast<double>(it->first), static_cast<double>(labelStatistics.Count),
+      labelStatistics.Count * voxelVolume, labelStatistics.Count * voxelVolume * 0.001,
+      labelStatistics.Min, labelStatistics.Max, mean, stdDev};
+    for (int column = 0; column < 8; ++column)
+      {
+      double value = table->GetValue(row, column).ToDouble();
+      if (fabs(value - expectedValues[column]) > 1e-6 * (1. + fabs(expectedValues[column])))
+        {
+        std::cerr << "Label " << it->first << ": wrong "
+                  << table->GetColumnName(column) << " " << value
+                  << " instead of " << expectedValues[column] << std::endl;
+        return false;
+        }
+      }
+    }
+  return true;
+}
+
+} // end of anonymous namespace
+
+//---------------------------------------------------------------------------
+int vtkImageLabelStatisticsTest1(int vtkNotUsed(argc), char * vtkNotUsed(argv)[])
+{
+  vtkSmartPointer<vtkImageData> labelMap = createImage(VTK_SHORT);
+  vtkSmartPointer<vtkImageData> grayscale = createImage(VTK_FLOAT);
+  short* labels = static_cast<short*>(labelMap->GetScalarPointer());
+  float* values = static_cast<float*>(grayscale->GetScalarPointer());
+  for (vtkIdType i = 0; i < labelMap->GetNumberOfPoints(); ++i)
+    {
+    labels[i] = static_cast<short>((i / 7) % 13 - 2);
+    values[i] = static_cast<float>((i * 31) % 101) * 0.5f - 10.f;
+    }
+
+  vtkNew<vtkImageLabelStatistics> statistics;
+  statistics->SetLabelMap(labelMap);
+  statistics->SetGrayscale(grayscale);
+  for (int threads = 1; threads <= 4; ++threads)
+    {
+    statistics->SetNumberOfThreads(threads);
+    statistics->Update();
+    if (!checkStatistics(statistics.GetPointer(), labelMap, grayscale, 0.5 * 2. * 3.))
+      {
+      return EXIT_FAILURE;
+      }
+    }
+
+  // Voxel volume from the volume node
+  statistics->SetVoxelVolume(2.);
+  statistics->Update();
+  if (!checkStatistics(statistics.GetPointer(), labelMap, grayscale, 2.))
+    {
+    return EXIT_FAILURE;
+    }
+
+  // Labels too far apart to be indexed in an array
+  vtkSmartPointer<vtkImageData> sparseLabelMap = createImage(VTK_INT);
+  int* sparseLabels = static_cast<int*>(sparseLabelMap->GetScalarPointer());
+  for (vtkIdType i = 0; i < sparseLabelMap->GetNumberOfPoints(); ++i)
+    {
+    sparseLabels[i] = ((i / 5) % 3) * 100000 - 7;
+    }
+  statistics->SetLabelMap(sparseLabelMap);
+  statistics->Update();
+  if (!checkStatistics(statistics.GetPointer(), sparseLabelMap, grayscale, 2.))
+    {
+    return EXIT_FAILURE;
+    }
+
+  // Without grayscale volume, only the counts and volumes
+  statistics->SetGrayscale(0);
+  statistics->Update();
+  if (statistics->GetOutput()->GetNumberOfColumns() != 4 ||
+      statistics->GetOutput()->GetNumberOfRows() != 3)
+    {
+    std::cerr << "Wrong table without grayscale volume" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  return EXIT_SUCCESS;
+}
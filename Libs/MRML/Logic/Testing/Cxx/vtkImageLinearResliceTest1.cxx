@@ -0,0 +1,204 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+// MRMLLogic includes
+#include <vtkImageLinearReslice.h>
+
+// VTK includes
+#include <vtkImageData.h>
+#include <vtkNew.h>
+#include <vtkSmartPointer.h>
+#include <vtkTimerLog.h>
+#include <vtkTransform.h>
+
+// STD includes
+#include <cmath>
+#include <iostream>
+
+namespace
+{
+
+//---------------------------------------------------------------------------
+// Volume where the value of a voxel is a linear function of its index:
+// linear and cubic interpolations are exact inside the volume.
+double rampValue(double i, double j, double k)
+{
+  return i + 2. * j + 3. * k;
+}
+
+//---------------------------------------------------------------------------
+vtkSmartPointer<vtkImageData> createVolume(int dim, int scalarType, bool ramp)
+{
+  vtkSmartPointer<vtkImageData> volume = vtkSmartPointer<vtkImageData>::New();
+  volume->SetDimensions(dim, dim, dim);
+  volume->SetScalarType(scalarType);
+  volume->SetNumberOfScalarComponents(1);
+  volume->AllocateScalars();
+  for (int k = 0; k < dim; ++k)
+    {
+    for (int j = 0; j < dim; ++j)
+      {
+      for (int i = 0; i < dim; ++i)
+        {
+        volume->SetScalarComponentFromDouble(i, j, k, 0,
+          ramp ? rampValue(i, j, k) : (i * 7 + j * 3 + k) % 1000);
+        }
+      }
+    }
+  return volume;
+}
+
+//---------------------------------------------------------------------------
+bool checkMode(int mode)
+{
+  const int dim = 32;
+  vtkSmartPointer<vtkImageData> volume = createVolume(dim, VTK_FLOAT, true);
+
+  // oblique slice through the center of the volume, half of the slice is
+  // out of the volume
+  vtkNew<vtkTransform> transform;
+  transform->Translate(dim / 2., dim / 2., dim / 2.);
+  transform->RotateX(30.);
+  transform->RotateZ(20.);
+
+  vtkNew<vtkImageLinearReslice> reslice;
+  reslice->SetInput(volume);
+  reslice->SetSliceTransform(transform.GetPointer());
+  reslice->SetOutputDimensions(dim, dim, 1);
+  reslice->SetInterpolationMode(mode);
+  reslice->SetBackgroundLevel(-1.);
+  reslice->Update();
+
+  vtkImageData* output = reslice->GetOutput();
+  int insideCount = 0;
+  int outsideCount = 0;
+  for (int j = 0; j < dim; ++j)
+    {
+    for (int i = 0; i < dim; ++i)
+      {
+      double point[3] = {static_cast<double>(i), static_cast<double>(j), 0.};
+      transform->TransformPoint(point, point);
+      double value = output->GetScalarComponentAsDouble(i, j, 0, 0);
+      // skip the voxels close to the boundaries where the taps are
+      // replicated or that are rounded differently
+      bool inside = true;
+      bool outside = false;
+      for (int c = 0; c < 3; ++c)
+        {
+        inside = inside && point[c] > 1.1 && point[c] < dim - 2.1;
+        outside = outside || point[c] < -1. || point[c] > dim;
+        }
+      double expected = mode == VTK_SLICE_NEAREST ?
+        rampValue(floor(point[0] + 0.5),
+                  floor(point[1] + 0.5),
+                  floor(point[2] + 0.5)) :
+        rampValue(point[0], point[1], point[2]);
+      if (inside && fabs(value - expected) > 1e-3)
+        {
+        std::cerr << reslice->GetInterpolationModeAsString() << ": wrong value "
+                  << value << " instead of " << expected << " for voxel "
+                  << i << " " << j << std::endl;
+        return false;
+        }
+      if (outside && value != -1.)
+        {
+        std::cerr << reslice->GetInterpolationModeAsString() << ": voxel "
+                  << i << " " << j << " out of the volume is not background"
+                  << std::endl;
+        return false;
+        }
+      insideCount += inside ? 1 : 0;
+      outsideCount += outside ? 1 : 0;
+      }
+    }
+  if (insideCount == 0 || outsideCount == 0)
+    {
+    std::cerr << "Slice doesn't cross the volume boundaries" << std::endl;
+    return false;
+    }
+  return true;
+}
+
+} // end of anonymous namespace
+
+//---------------------------------------------------------------------------
+int vtkImageLinearResliceTest1(int vtkNotUsed(argc), char * vtkNotUsed(argv)[])
+{
+  int modes[3] = {VTK_SLICE_NEAREST, VTK_SLICE_LINEAR, VTK_SLICE_CUBIC};
+
+  //---------------------------------------------------------------------------
+  // Interpolation
+  //---------------------------------------------------------------------------
+  for (int m = 0; m < 3; ++m)
+    {
+    if (!checkMode(modes[m]))
+      {
+      return EXIT_FAILURE;
+      }
+    }
+
+  //---------------------------------------------------------------------------
+  // Benchmark: megavoxels per second for each interpolation mode, with an
+  // axial, a sagittal and an oblique slice
+  //---------------------------------------------------------------------------
+  const int dim = 256;
+  const int sliceDim = 512;
+  const int iterations = 10;
+  int scalarTypes[2] = {VTK_SHORT, VTK_FLOAT};
+  for (int t = 0; t < 2; ++t)
+    {
+    vtkSmartPointer<vtkImageData> volume =
+      createVolume(dim, scalarTypes[t], false);
+    for (int m = 0; m < 3; ++m)
+      {
+      vtkNew<vtkImageLinearReslice> reslice;
+      reslice->SetInput(volume);
+      reslice->SetOutputDimensions(sliceDim, sliceDim, 1);
+      reslice->SetInterpolationMode(modes[m]);
+
+      vtkNew<vtkTransform> transform;
+      reslice->SetSliceTransform(transform.GetPointer());
+      vtkSmartPointer<vtkTimerLog> timerLog = vtkSmartPointer<vtkTimerLog>::New();
+      timerLog->StartTimer();
+      for (int i = 0; i < iterations; ++i)
+        {
+        for (int view = 0; view < 3; ++view)
+          {
+          transform->Identity();
+          transform->Translate(0., 0., dim / 2. + i);
+          if (view == 1)
+            {
+            transform->RotateY(90.);
+            }
+          else if (view == 2)
+            {
+            transform->RotateX(30.);
+            transform->RotateZ(20.);
+            }
+          transform->Scale(0.5, 0.5, 0.5);
+          reslice->Update();
+          }
+        }
+      timerLog->StopTimer();
+      double voxels = 3. * iterations * sliceDim * sliceDim;
+      std::cout << volume->GetScalarTypeAsString() << " "
+                << reslice->GetInterpolationModeAsString() << ": "
+                << voxels / timerLog->GetElapsedTime() / 1e6
+                << " megavoxels/s" << std::endl;
+      }
+    }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,187 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+// MRMLLogic includes
+#include <vtkImageResliceMask.h>
+
+// VTK includes
+#include <vtkImageData.h>
+#include <vtkNew.h>
+#include <vtkSmartPointer.h>
+#include <vtkTimerLog.h>
+#include <vtkTransform.h>
+
+// STD includes
+#include <cstdlib>
+#include <iostream>
+
+namespace
+{
+
+//---------------------------------------------------------------------------
+vtkSmartPointer<vtkImageData> createVolume(int dim)
+{
+  vtkSmartPointer<vtkImageData> volume = vtkSmartPointer<vtkImageData>::New();
+  volume->SetDimensions(dim, dim, dim);
+  volume->SetScalarTypeToShort();
+  volume->SetNumberOfScalarComponents(1);
+  volume->AllocateScalars();
+  short* ptr = static_cast<short*>(volume->GetScalarPointer());
+  for (int i = 0; i < dim * dim * dim; ++i)
+    {
+    ptr[i] = static_cast<short>((i * 7) % 1000);
+    }
+  return volume;
+}
+
+//---------------------------------------------------------------------------
+void setupReslice(vtkImageResliceMask* reslice, vtkImageData* input,
+                  vtkTransform* transform, int dim, int tiles)
+{
+  reslice->SetInput(input);
+  reslice->SetResliceTransform(transform);
+  reslice->SetBackgroundColor(0, 0, 0, 0);
+  reslice->AutoCropOutputOff();
+  reslice->SetOutputOrigin(0, 0, 0);
+  reslice->SetOutputSpacing(1, 1, 1);
+  reslice->SetOutputDimensionality(3);
+  reslice->SetOutputExtent(0, dim - 1, 0, dim - 1, 0, tiles - 1);
+}
+
+//---------------------------------------------------------------------------
+bool compare(vtkImageData* expected, vtkImageData* actual, const char* name)
+{
+  int* dims = expected->GetDimensions();
+  int* actualDims = actual->GetDimensions();
+  for (int i = 0; i < 3; ++i)
+    {
+    if (dims[i] != actualDims[i])
+      {
+      std::cerr << name << ": wrong dimensions" << std::endl;
+      return false;
+      }
+    }
+  for (int k = 0; k < dims[2]; ++k)
+    {
+    for (int j = 0; j < dims[1]; ++j)
+      {
+      for (int i = 0; i < dims[0]; ++i)
+        {
+        double expectedValue = expected->GetScalarComponentAsDouble(i, j, k, 0);
+        double value = actual->GetScalarComponentAsDouble(i, j, k, 0);
+        if (value != expectedValue)
+          {
+          std::cerr << name << ": wrong value for voxel "
+                    << i << " " << j << " " << k << ": " << value
+                    << " instead of " << expectedValue << std::endl;
+          return false;
+          }
+        }
+      }
+    }
+  return true;
+}
+
+//---------------------------------------------------------------------------
+bool compareReslices(vtkImageResliceMask* expected, vtkImageResliceMask* actual,
+                     const char* name)
+{
+  expected->Update();
+  expected->GetBackgroundMask()->Update();
+  actual->Update();
+  actual->GetBackgroundMask()->Update();
+  return compare(expected->GetOutput(), actual->GetOutput(), name) &&
+    compare(expected->GetBackgroundMask(), actual->GetBackgroundMask(), name);
+}
+
+} // end of anonymous namespace
+
+//---------------------------------------------------------------------------
+int vtkImageResliceMaskTest1(int vtkNotUsed(argc), char * vtkNotUsed(argv)[])
+{
+  const int dim = 64;
+  const int tiles = 9;
+  vtkSmartPointer<vtkImageData> volume = createVolume(dim);
+
+  vtkNew<vtkTransform> transform;
+  vtkNew<vtkImageResliceMask> reference;
+  setupReslice(reference.GetPointer(), volume, transform.GetPointer(), dim, tiles);
+  vtkNew<vtkImageResliceMask> reslice;
+  setupReslice(reslice.GetPointer(), volume, transform.GetPointer(), dim, tiles);
+  reslice->ReuseShiftedSlicesOn();
+
+  //---------------------------------------------------------------------------
+  // Scroll the tiles forward and backward, in and out of the volume
+  //---------------------------------------------------------------------------
+  const int interpolationModes[2] = {VTK_RESLICE_NEAREST, VTK_RESLICE_LINEAR};
+  const double scrolls[7] = {0., 1., 3., -2., 8., -20., 9.};
+  for (int mode = 0; mode < 2; ++mode)
+    {
+    reference->SetInterpolationMode(interpolationModes[mode]);
+    reslice->SetInterpolationMode(interpolationModes[mode]);
+    double z = 2.;
+    for (int scroll = 0; scroll < 7; ++scroll)
+      {
+      z += scrolls[scroll];
+      transform->Identity();
+      transform->Translate(0.25, -3.5, z);
+      if (!compareReslices(reference.GetPointer(), reslice.GetPointer(), "Scroll"))
+        {
+        std::cerr << "Interpolation mode: " << interpolationModes[mode]
+                  << ", scroll: " << scroll << std::endl;
+        return EXIT_FAILURE;
+        }
+      }
+    }
+
+  // moving within a slice or modifying the volume reslices all the tiles
+  transform->Translate(1., 0., 0.);
+  if (!compareReslices(reference.GetPointer(), reslice.GetPointer(), "Pan"))
+    {
+    return EXIT_FAILURE;
+    }
+  transform->Translate(0., 0., 1.);
+  volume->SetScalarComponentFromDouble(10, 10, 10, 0, 2000.);
+  volume->Modified();
+  if (!compareReslices(reference.GetPointer(), reslice.GetPointer(), "Modified volume"))
+    {
+    return EXIT_FAILURE;
+    }
+
+  //---------------------------------------------------------------------------
+  // Benchmark: scroll one tile at a time
+  //---------------------------------------------------------------------------
+  const int scrollCount = 20;
+  vtkSmartPointer<vtkTimerLog> timerLog = vtkSmartPointer<vtkTimerLog>::New();
+  vtkImageResliceMask* reslices[2] = {reference.GetPointer(), reslice.GetPointer()};
+  double times[2] = {0., 0.};
+  for (int r = 0; r < 2; ++r)
+    {
+    timerLog->StartTimer();
+    for (int scroll = 0; scroll < scrollCount; ++scroll)
+      {
+      transform->Translate(0., 0., 1.);
+      reslices[r]->Update();
+      reslices[r]->GetBackgroundMask()->Update();
+      }
+    timerLog->StopTimer();
+    times[r] = timerLog->GetElapsedTime();
+    }
+  std::cout << "Scroll: " << times[0] / scrollCount << "s, "
+            << "with reused slices: " << times[1] / scrollCount << "s"
+            << std::endl;
+
+  return EXIT_SUCCESS;
+}
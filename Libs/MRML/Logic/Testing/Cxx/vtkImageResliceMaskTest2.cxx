@@ -0,0 +1,190 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+// MRMLLogic includes
+#include <vtkImageResliceMask.h>
+
+// VTK includes
+#include <vtkGeneralTransform.h>
+#include <vtkImageData.h>
+#include <vtkNew.h>
+#include <vtkSmartPointer.h>
+#include <vtkTimerLog.h>
+#include <vtkTransform.h>
+
+// STD includes
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+
+namespace
+{
+
+//---------------------------------------------------------------------------
+vtkSmartPointer<vtkImageData> createVolume(int dim, int scalarType)
+{
+  vtkSmartPointer<vtkImageData> volume = vtkSmartPointer<vtkImageData>::New();
+  volume->SetDimensions(dim, dim, dim);
+  volume->SetSpacing(1., 1.5, 2.);
+  volume->SetScalarType(scalarType);
+  volume->SetNumberOfScalarComponents(1);
+  volume->AllocateScalars();
+  for (int k = 0; k < dim; ++k)
+    {
+    for (int j = 0; j < dim; ++j)
+      {
+      for (int i = 0; i < dim; ++i)
+        {
+        volume->SetScalarComponentFromDouble(i, j, k, 0, (i * 7 + j * 13 + k * 29) % 1000);
+        }
+      }
+    }
+  return volume;
+}
+
+//---------------------------------------------------------------------------
+void setupReslice(vtkImageResliceMask* reslice, vtkImageData* input,
+                  vtkAbstractTransform* transform, int mode, int dim)
+{
+  reslice->SetInput(input);
+  reslice->SetResliceTransform(transform);
+  reslice->SetInterpolationMode(mode);
+  reslice->SetBackgroundColor(-1, -1, -1, -1);
+  reslice->AutoCropOutputOff();
+  reslice->SetOutputOrigin(-5., -5., 20.);
+  reslice->SetOutputSpacing(0.7, 0.7, 1.);
+  reslice->SetOutputDimensionality(2);
+  reslice->SetOutputExtent(0, 2 * dim - 1, 0, 2 * dim - 1, 0, 0);
+}
+
+//---------------------------------------------------------------------------
+// The row interpolation of the optimized path must give the same output and
+// background mask as the voxel by voxel interpolation of the unoptimized
+// path. The positions are computed differently by both paths, the
+// interpolated values may differ by a rounding error.
+bool compareReslices(vtkImageData* input, vtkAbstractTransform* transform,
+                     int mode, int dim, const char* name)
+{
+  vtkNew<vtkImageResliceMask> reference;
+  setupReslice(reference.GetPointer(), input, transform, mode, dim);
+  reference->OptimizationOff();
+  reference->Update();
+  reference->GetBackgroundMask()->Update();
+
+  vtkNew<vtkImageResliceMask> reslice;
+  setupReslice(reslice.GetPointer(), input, transform, mode, dim);
+  reslice->Update();
+  reslice->GetBackgroundMask()->Update();
+
+  vtkImageData* expected = reference->GetOutput();
+  vtkImageData* actual = reslice->GetOutput();
+  int* dims = expected->GetDimensions();
+  int inside = 0;
+  for (int j = 0; j < dims[1]; ++j)
+    {
+    for (int i = 0; i < dims[0]; ++i)
+      {
+      double expectedValue = expected->GetScalarComponentAsDouble(i, j, 0, 0);
+      double value = actual->GetScalarComponentAsDouble(i, j, 0, 0);
+      double expectedMask =
+        reference->GetBackgroundMask()->GetScalarComponentAsDouble(i, j, 0, 0);
+      double mask =
+        reslice->GetBackgroundMask()->GetScalarComponentAsDouble(i, j, 0, 0);
+      if (fabs(value - expectedValue) > 1. || mask != expectedMask)
+        {
+        std::cerr << name << ", interpolation mode " << mode
+                  << ": wrong value for voxel " << i << " " << j << ": "
+                  << value << " (mask " << mask << ") instead of "
+                  << expectedValue << " (mask " << expectedMask << ")"
+                  << std::endl;
+        return false;
+        }
+      inside += (mask != 0.);
+      }
+    }
+  // the slice must cross the volume and its border
+  if (inside == 0 || inside == dims[0] * dims[1])
+    {
+    std::cerr << name << ": the slice doesn't cross the volume border"
+              << std::endl;
+    return false;
+    }
+  return true;
+}
+
+} // end of anonymous namespace
+
+//---------------------------------------------------------------------------
+int vtkImageResliceMaskTest2(int vtkNotUsed(argc), char * vtkNotUsed(argv)[])
+{
+  const int dim = 40;
+  vtkSmartPointer<vtkImageData> shortVolume = createVolume(dim, VTK_SHORT);
+  vtkSmartPointer<vtkImageData> floatVolume = createVolume(dim, VTK_FLOAT);
+
+  // oblique slice
+  vtkNew<vtkTransform> rotation;
+  rotation->Translate(0.31, 0.17, 0.23);
+  rotation->RotateWXYZ(37., 1., 2., 3.);
+
+  // the same slice through a transform that is not homogeneous, the
+  // positions are transformed voxel by voxel
+  vtkNew<vtkGeneralTransform> generalTransform;
+  generalTransform->Concatenate(rotation.GetPointer());
+
+  vtkAbstractTransform* transforms[2] =
+    {rotation.GetPointer(), generalTransform.GetPointer()};
+  const char* transformNames[2] = {"Oblique", "General transform"};
+  const int modes[2] = {VTK_RESLICE_LINEAR, VTK_RESLICE_CUBIC};
+  vtkImageData* volumes[2] = {shortVolume, floatVolume};
+  for (int t = 0; t < 2; ++t)
+    {
+    for (int m = 0; m < 2; ++m)
+      {
+      for (int v = 0; v < 2; ++v)
+        {
+        if (!compareReslices(volumes[v], transforms[t], modes[m], dim,
+                             transformNames[t]))
+          {
+          return EXIT_FAILURE;
+          }
+        }
+      }
+    }
+
+  //---------------------------------------------------------------------------
+  // Benchmark: megavoxels per second for an oblique slice
+  //---------------------------------------------------------------------------
+  const int sliceCount = 20;
+  vtkSmartPointer<vtkTimerLog> timerLog = vtkSmartPointer<vtkTimerLog>::New();
+  for (int m = 0; m < 2; ++m)
+    {
+    vtkNew<vtkImageResliceMask> reslice;
+    setupReslice(reslice.GetPointer(), shortVolume, rotation.GetPointer(),
+                 modes[m], 4 * dim);
+    timerLog->StartTimer();
+    for (int slice = 0; slice < sliceCount; ++slice)
+      {
+      reslice->SetOutputOrigin(-5., -5., 20. + slice);
+      reslice->Update();
+      }
+    timerLog->StopTimer();
+    double megavoxels = sliceCount * (8. * dim) * (8. * dim) / 1e6;
+    std::cout << "Interpolation mode " << modes[m] << ": "
+              << megavoxels / timerLog->GetElapsedTime() << " Mvoxels/s"
+              << std::endl;
+    }
+
+  return EXIT_SUCCESS;
+}
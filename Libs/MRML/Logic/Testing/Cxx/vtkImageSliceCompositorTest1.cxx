@@ -0,0 +1,278 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+// MRMLLogic includes
+#include <vtkImageSliceCompositor.h>
+
+// MRML includes
+#include <vtkMRMLColorTableNode.h>
+#include <vtkMRMLLabelMapVolumeDisplayNode.h>
+#include <vtkMRMLScalarVolumeDisplayNode.h>
+#include <vtkMRMLScene.h>
+
+// VTK includes
+#include <vtkImageBlend.h>
+#include <vtkImageData.h>
+#include <vtkNew.h>
+#include <vtkSmartPointer.h>
+#include <vtkTimerLog.h>
+
+// STD includes
+#include <cstdlib>
+#include <iostream>
+
+namespace
+{
+
+//---------------------------------------------------------------------------
+vtkSmartPointer<vtkImageData> createSlice(int dim, int scalarType,
+                                          int modulo, int offset)
+{
+  vtkSmartPointer<vtkImageData> slice = vtkSmartPointer<vtkImageData>::New();
+  slice->SetDimensions(dim, dim, 1);
+  slice->SetScalarType(scalarType);
+  slice->SetNumberOfScalarComponents(1);
+  slice->AllocateScalars();
+  for (int j = 0; j < dim; ++j)
+    {
+    for (int i = 0; i < dim; ++i)
+      {
+      slice->SetScalarComponentFromDouble(i, j, 0, 0,
+        (i * 7 + j * 13) % modulo - offset);
+      }
+    }
+  return slice;
+}
+
+//---------------------------------------------------------------------------
+// Background mask of vtkImageResliceMask: 0 out of the volume
+vtkSmartPointer<vtkImageData> createMask(int dim, int border)
+{
+  vtkSmartPointer<vtkImageData> mask = vtkSmartPointer<vtkImageData>::New();
+  mask->SetDimensions(dim, dim, 1);
+  mask->SetScalarTypeToUnsignedChar();
+  mask->SetNumberOfScalarComponents(1);
+  mask->AllocateScalars();
+  for (int j = 0; j < dim; ++j)
+    {
+    for (int i = 0; i < dim; ++i)
+      {
+      mask->SetScalarComponentFromDouble(i, j, 0, 0,
+        (i < border || j < border) ? 0 : 255);
+      }
+    }
+  return mask;
+}
+
+//---------------------------------------------------------------------------
+bool compare(vtkImageData* expected, vtkImageData* actual,
+             int components, int tolerance, const char* name)
+{
+  int* dims = expected->GetDimensions();
+  int* actualDims = actual->GetDimensions();
+  if (dims[0] != actualDims[0] || dims[1] != actualDims[1] ||
+      actual->GetNumberOfScalarComponents() != 4 ||
+      actual->GetScalarType() != VTK_UNSIGNED_CHAR)
+    {
+    std::cerr << name << ": wrong output image" << std::endl;
+    return false;
+    }
+  for (int j = 0; j < dims[1]; ++j)
+    {
+    for (int i = 0; i < dims[0]; ++i)
+      {
+      for (int c = 0; c < components; ++c)
+        {
+        double expectedValue = expected->GetScalarComponentAsDouble(i, j, 0, c);
+        double value = actual->GetScalarComponentAsDouble(i, j, 0, c);
+        if (value < expectedValue - tolerance || value > expectedValue + tolerance)
+          {
+          std::cerr << name << ": wrong component " << c << " for pixel "
+                    << i << " " << j << ": " << value << " instead of "
+                    << expectedValue << std::endl;
+          return false;
+          }
+        }
+      }
+    }
+  return true;
+}
+
+//---------------------------------------------------------------------------
+void setWindowLevelMapping(vtkImageSliceCompositor* compositor, int layer,
+                           vtkMRMLScalarVolumeDisplayNode* displayNode)
+{
+  compositor->SetLayerWindowLevelMapping(layer,
+    displayNode->GetWindow(), displayNode->GetLevel(),
+    displayNode->GetLowerThreshold(), displayNode->GetUpperThreshold(),
+    displayNode->GetApplyThreshold(), displayNode->GetLookupTable());
+}
+
+} // end of anonymous namespace
+
+//---------------------------------------------------------------------------
+int vtkImageSliceCompositorTest1(int vtkNotUsed(argc), char * vtkNotUsed(argv)[])
+{
+  if (!vtkImageSliceCompositor::IsScalarTypeSupported(VTK_SHORT) ||
+      vtkImageSliceCompositor::IsScalarTypeSupported(VTK_FLOAT))
+    {
+    std::cerr << "Wrong supported scalar types" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  const int dim = 64;
+  vtkNew<vtkMRMLScene> scene;
+  vtkNew<vtkMRMLColorTableNode> greyNode;
+  greyNode->SetTypeToGrey();
+  scene->AddNode(greyNode.GetPointer());
+  vtkNew<vtkMRMLColorTableNode> labelsNode;
+  labelsNode->SetTypeToLabels();
+  scene->AddNode(labelsNode.GetPointer());
+
+  // background: short, thresholded, half masked
+  vtkSmartPointer<vtkImageData> background = createSlice(dim, VTK_SHORT, 1000, 300);
+  vtkSmartPointer<vtkImageData> backgroundMask = createMask(dim, dim / 4);
+  vtkNew<vtkMRMLScalarVolumeDisplayNode> backgroundDisplayNode;
+  scene->AddNode(backgroundDisplayNode.GetPointer());
+  backgroundDisplayNode->SetAutoWindowLevel(0);
+  backgroundDisplayNode->SetAutoThreshold(0);
+  backgroundDisplayNode->SetWindowLevel(300., 50.);
+  backgroundDisplayNode->SetThreshold(-100., 400.);
+  backgroundDisplayNode->SetApplyThreshold(1);
+  backgroundDisplayNode->SetAndObserveColorNodeID(greyNode->GetID());
+  backgroundDisplayNode->SetInputImageData(background);
+  backgroundDisplayNode->SetBackgroundImageData(backgroundMask);
+  backgroundDisplayNode->UpdateImageDataPipeline();
+
+  // foreground: unsigned char
+  vtkSmartPointer<vtkImageData> foreground = createSlice(dim, VTK_UNSIGNED_CHAR, 256, 0);
+  vtkSmartPointer<vtkImageData> foregroundMask = createMask(dim, dim / 8);
+  vtkNew<vtkMRMLScalarVolumeDisplayNode> foregroundDisplayNode;
+  scene->AddNode(foregroundDisplayNode.GetPointer());
+  foregroundDisplayNode->SetAutoWindowLevel(0);
+  foregroundDisplayNode->SetAutoThreshold(0);
+  foregroundDisplayNode->SetWindowLevel(200., 100.);
+  foregroundDisplayNode->SetAndObserveColorNodeID(greyNode->GetID());
+  foregroundDisplayNode->SetInputImageData(foreground);
+  foregroundDisplayNode->SetBackgroundImageData(foregroundMask);
+  foregroundDisplayNode->UpdateImageDataPipeline();
+
+  // label map: short
+  vtkSmartPointer<vtkImageData> labels = createSlice(dim, VTK_SHORT, 6, 0);
+  vtkSmartPointer<vtkImageData> labelsMask = createMask(dim, 0);
+  vtkNew<vtkMRMLLabelMapVolumeDisplayNode> labelsDisplayNode;
+  scene->AddNode(labelsDisplayNode.GetPointer());
+  labelsDisplayNode->SetAndObserveColorNodeID(labelsNode->GetID());
+  labelsDisplayNode->SetInputImageData(labels);
+  labelsDisplayNode->UpdateImageDataPipeline();
+
+  //---------------------------------------------------------------------------
+  // A single layer is mapped exactly like the display node
+  //---------------------------------------------------------------------------
+  vtkNew<vtkImageSliceCompositor> compositor;
+  compositor->SetNumberOfLayers(1);
+  compositor->SetLayerInput(0, background, backgroundMask);
+  setWindowLevelMapping(compositor.GetPointer(), 0,
+                        backgroundDisplayNode.GetPointer());
+  compositor->Update();
+  backgroundDisplayNode->GetImageData()->Update();
+  if (!compare(backgroundDisplayNode->GetImageData(), compositor->GetOutput(),
+               4, 0, "Background"))
+    {
+    return EXIT_FAILURE;
+    }
+
+  // the color table is recomputed when the window changes
+  backgroundDisplayNode->SetWindowLevel(600., -20.);
+  setWindowLevelMapping(compositor.GetPointer(), 0,
+                        backgroundDisplayNode.GetPointer());
+  compositor->Update();
+  backgroundDisplayNode->GetImageData()->Update();
+  if (!compare(backgroundDisplayNode->GetImageData(), compositor->GetOutput(),
+               4, 0, "Background window"))
+    {
+    return EXIT_FAILURE;
+    }
+
+  compositor->SetLayerInput(0, labels, labelsMask);
+  compositor->SetLayerLookupTableMapping(0, labelsDisplayNode->GetLookupTable());
+  compositor->Update();
+  labelsDisplayNode->GetImageData()->Update();
+  if (!compare(labelsDisplayNode->GetImageData(), compositor->GetOutput(),
+               4, 0, "Label map"))
+    {
+    return EXIT_FAILURE;
+    }
+
+  //---------------------------------------------------------------------------
+  // Layers are blended like vtkImageBlend
+  //---------------------------------------------------------------------------
+  vtkNew<vtkImageBlend> blend;
+  blend->AddInput(backgroundDisplayNode->GetImageData());
+  blend->AddInput(foregroundDisplayNode->GetImageData());
+  blend->AddInput(labelsDisplayNode->GetImageData());
+  blend->SetOpacity(1, 0.5);
+  blend->SetOpacity(2, 0.7);
+
+  compositor->SetNumberOfLayers(3);
+  compositor->SetLayerInput(0, background, backgroundMask);
+  setWindowLevelMapping(compositor.GetPointer(), 0,
+                        backgroundDisplayNode.GetPointer());
+  compositor->SetLayerInput(1, foreground, foregroundMask);
+  setWindowLevelMapping(compositor.GetPointer(), 1,
+                        foregroundDisplayNode.GetPointer());
+  compositor->SetLayerOpacity(1, 0.5);
+  compositor->SetLayerInput(2, labels, labelsMask);
+  compositor->SetLayerLookupTableMapping(2, labelsDisplayNode->GetLookupTable());
+  compositor->SetLayerOpacity(2, 0.7);
+  compositor->Update();
+  blend->Update();
+  if (!compare(blend->GetOutput(), compositor->GetOutput(), 3, 1, "Blend"))
+    {
+    return EXIT_FAILURE;
+    }
+
+  //---------------------------------------------------------------------------
+  // Benchmark: display node pipelines and vtkImageBlend vs compositor
+  //---------------------------------------------------------------------------
+  const int iterations = 20;
+  vtkSmartPointer<vtkTimerLog> timerLog = vtkSmartPointer<vtkTimerLog>::New();
+  timerLog->StartTimer();
+  for (int i = 0; i < iterations; ++i)
+    {
+    background->Modified();
+    foreground->Modified();
+    labels->Modified();
+    blend->Update();
+    }
+  timerLog->StopTimer();
+  double pipelineTime = timerLog->GetElapsedTime();
+
+  timerLog->StartTimer();
+  for (int i = 0; i < iterations; ++i)
+    {
+    background->Modified();
+    foreground->Modified();
+    labels->Modified();
+    compositor->Update();
+    }
+  timerLog->StopTimer();
+  double compositorTime = timerLog->GetElapsedTime();
+  std::cout << "Pipeline: " << pipelineTime / iterations << "s, "
+            << "compositor: " << compositorTime / iterations << "s"
+            << std::endl;
+
+  return EXIT_SUCCESS;
+}
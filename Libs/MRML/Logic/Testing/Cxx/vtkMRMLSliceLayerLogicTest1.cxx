@@ -0,0 +1,261 @@
+/*=auto=========================================================================
+
+  Portions (c) Copyright 2005 Brigham and Women's Hospital (BWH)
+  All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Program:   3D Slicer
+
+=========================================================================auto=*/
+
+// MRMLLogic includes
+#include <vtkImageResliceMask.h>
+#include <vtkMRMLSliceLayerLogic.h>
+
+// MRML includes
+#include <vtkMRMLBSplineTransformNode.h>
+#include <vtkMRMLGridTransformNode.h>
+#include <vtkMRMLScalarVolumeDisplayNode.h>
+#include <vtkMRMLScalarVolumeNode.h>
+#include <vtkMRMLScene.h>
+#include <vtkMRMLSliceNode.h>
+
+// VTK includes
+#include <vtkAbstractTransform.h>
+#include <vtkGeneralTransform.h>
+#include <vtkGridTransform.h>
+#include <vtkImageData.h>
+#include <vtkMatrix4x4.h>
+#include <vtkNew.h>
+
+// STD includes
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+#include <vector>
+
+//-----------------------------------------------------------------------------
+namespace
+{
+
+void SetConstantDisplacement(vtkGridTransform* gridTransform, double dx)
+{
+  vtkNew<vtkImageData> grid;
+  grid->SetOrigin(-50., -50., -50.);
+  grid->SetSpacing(50., 50., 50.);
+  grid->SetDimensions(3, 3, 3);
+  grid->SetScalarTypeToDouble();
+  grid->SetNumberOfScalarComponents(3);
+  grid->AllocateScalars();
+  double* displacement = static_cast<double*>(grid->GetScalarPointer());
+  for (int i = 0; i < 27; ++i)
+    {
+    *displacement++ = dx;
+    *displacement++ = 0.;
+    *displacement++ = 0.;
+    }
+  gridTransform->SetDisplacementGrid(grid.GetPointer());
+}
+
+// The volume is translated by dx along R, check the reslice transform
+// of the center of the slice.
+bool CheckResliceTransform(vtkMRMLSliceLayerLogic* logic, double dx)
+{
+  double xy[4] = {32., 32., 0., 1.};
+  double ras[4];
+  logic->GetSliceNode()->GetXYToRAS()->MultiplyPoint(xy, ras);
+  ras[0] -= dx;
+  vtkNew<vtkMatrix4x4> rasToIJK;
+  logic->GetVolumeNode()->GetRASToIJKMatrix(rasToIJK.GetPointer());
+  double expectedIJK[4];
+  rasToIJK->MultiplyPoint(ras, expectedIJK);
+
+  double ijk[3];
+  logic->GetXYToIJKResliceTransform()->TransformPoint(xy, ijk);
+  for (int i = 0; i < 3; ++i)
+    {
+    if (fabs(ijk[i] - expectedIJK[i]) > 1e-3)
+      {
+      std::cerr << "Wrong IJK " << ijk[0] << " " << ijk[1] << " " << ijk[2]
+                << ", expected " << expectedIJK[0] << " " << expectedIJK[1]
+                << " " << expectedIJK[2] << std::endl;
+      return false;
+      }
+    }
+  return true;
+}
+
+// Cubic BSpline with control points 15mm apart from -60 to 75mm along
+// each axis, all at rest but 2 displaced by 6mm around the origin.
+void SetBSplineBump(vtkMRMLBSplineTransformNode* transformNode)
+{
+  const int numberOfNodes = 10 * 10 * 10;
+  std::vector<double> parameters(3 * numberOfNodes, 0.);
+  // x displacement of the node (4,4,4) at (0,0,0)
+  parameters[4 + 4 * 10 + 4 * 100] = 6.;
+  // y displacement of the node (5,3,4) at (15,-15,0)
+  parameters[numberOfNodes + 5 + 3 * 10 + 4 * 100] = -6.;
+  std::stringstream ss;
+  for (size_t i = 0; i < parameters.size(); ++i)
+    {
+    ss << parameters[i] << " ";
+    }
+  std::string param = ss.str();
+  // grid size, origin, spacing and direction
+  const char* atts[] = {
+    "order", "3",
+    "fixedParam", "10 10 10 -60 -60 -60 15 15 15 1 0 0 0 1 0 0 0 1",
+    "param", param.c_str(),
+    0};
+  transformNode->ReadXMLAttributes(atts);
+}
+
+// Largest difference, in voxels, between the reslice transform of the
+// slice pixels and the direct evaluation of the inverse of the nonlinear
+// transform of the volume.
+double ResliceTransformError(vtkMRMLSliceLayerLogic* logic)
+{
+  vtkNew<vtkGeneralTransform> volumeRASToWorld;
+  logic->GetVolumeNode()->GetParentTransformNode()->GetTransformToWorld(
+    volumeRASToWorld.GetPointer());
+  vtkAbstractTransform* worldToVolumeRAS = volumeRASToWorld->GetInverse();
+  vtkNew<vtkMatrix4x4> rasToIJK;
+  logic->GetVolumeNode()->GetRASToIJKMatrix(rasToIJK.GetPointer());
+
+  int dimensions[3];
+  logic->GetSliceNode()->GetDimensions(dimensions);
+  double maxError = 0.;
+  for (int y = 0; y < dimensions[1]; y += 3)
+    {
+    for (int x = 0; x < dimensions[0]; x += 3)
+      {
+      double xy[4] = {static_cast<double>(x), static_cast<double>(y), 0., 1.};
+      double world[4];
+      logic->GetSliceNode()->GetXYToRAS()->MultiplyPoint(xy, world);
+      double ras[4] = {0., 0., 0., 1.};
+      worldToVolumeRAS->TransformPoint(world, ras);
+      double expectedIJK[4];
+      rasToIJK->MultiplyPoint(ras, expectedIJK);
+
+      double ijk[3];
+      logic->GetXYToIJKResliceTransform()->TransformPoint(xy, ijk);
+      for (int i = 0; i < 3; ++i)
+        {
+        maxError = std::max(maxError, fabs(ijk[i] - expectedIJK[i]));
+        }
+      }
+    }
+  return maxError;
+}
+
+}
+
+//-----------------------------------------------------------------------------
+int vtkMRMLSliceLayerLogicTest1(int , char * [] )
+{
+  vtkNew<vtkMRMLScene> scene;
+
+  vtkNew<vtkImageData> imageData;
+  imageData->SetDimensions(10, 10, 10);
+  imageData->SetScalarTypeToShort();
+  imageData->SetNumberOfScalarComponents(1);
+  imageData->AllocateScalars();
+
+  vtkNew<vtkMRMLScalarVolumeDisplayNode> displayNode;
+  scene->AddNode(displayNode.GetPointer());
+  vtkNew<vtkMRMLScalarVolumeNode> volumeNode;
+  volumeNode->SetAndObserveImageData(imageData.GetPointer());
+  volumeNode->SetAndObserveDisplayNodeID(displayNode->GetID());
+  scene->AddNode(volumeNode.GetPointer());
+
+  vtkNew<vtkMRMLGridTransformNode> transformNode;
+  vtkGridTransform* gridTransform =
+    vtkGridTransform::SafeDownCast(transformNode->GetWarpTransformToParent());
+  SetConstantDisplacement(gridTransform, 2.);
+  scene->AddNode(transformNode.GetPointer());
+  volumeNode->SetAndObserveTransformNodeID(transformNode->GetID());
+
+  vtkNew<vtkMRMLSliceNode> sliceNode;
+  sliceNode->SetDimensions(64, 64, 1);
+  scene->AddNode(sliceNode.GetPointer());
+
+  vtkNew<vtkMRMLSliceLayerLogic> logic;
+  logic->SetMRMLScene(scene.GetPointer());
+  logic->SetSliceNode(sliceNode.GetPointer());
+  logic->SetVolumeNode(volumeNode.GetPointer());
+  logic->UpdateTransforms();
+
+  if (logic->GetReslice()->GetResliceTransform() == logic->GetXYToIJKTransform() ||
+      logic->GetXYToIJKResliceTransform() != logic->GetReslice()->GetResliceTransform() ||
+      !CheckResliceTransform(logic.GetPointer(), 2.))
+    {
+    std::cerr << "Line " << __LINE__ << ": nonlinear transform not applied"
+              << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // The displacement grid is reused while the transform is not modified
+  unsigned long resliceTransformMTime =
+    logic->GetReslice()->GetResliceTransform()->GetMTime();
+  logic->UpdateTransforms();
+  if (logic->GetReslice()->GetResliceTransform()->GetMTime() != resliceTransformMTime)
+    {
+    std::cerr << "Line " << __LINE__ << ": displacement grid not reused"
+              << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  SetConstantDisplacement(gridTransform, 3.);
+  logic->UpdateTransforms();
+  if (!CheckResliceTransform(logic.GetPointer(), 3.))
+    {
+    std::cerr << "Line " << __LINE__ << ": displacement grid not updated"
+              << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // Back to the linear reslice transform without the nonlinear transform
+  volumeNode->SetAndObserveTransformNodeID(0);
+  logic->UpdateTransforms();
+  if (logic->GetReslice()->GetResliceTransform() != logic->GetXYToIJKTransform() ||
+      logic->GetXYToIJKResliceTransform() != logic->GetXYToIJKTransform() ||
+      !CheckResliceTransform(logic.GetPointer(), 0.))
+    {
+    std::cerr << "Line " << __LINE__ << ": linear transform not restored"
+              << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // A BSpline bending within its 15mm control point spacing, on a coarse
+  // volume of 10mm voxels from -45 to 45mm viewed from -40 to 40mm.
+  volumeNode->SetSpacing(10., 10., 10.);
+  volumeNode->SetOrigin(-45., -45., -45.);
+  sliceNode->SetFieldOfView(80., 80., 1.);
+  vtkNew<vtkMRMLBSplineTransformNode> bsplineTransformNode;
+  SetBSplineBump(bsplineTransformNode.GetPointer());
+  scene->AddNode(bsplineTransformNode.GetPointer());
+  double controlPointSpacing[3] = {0., 0., 0.};
+  if (!bsplineTransformNode->GetControlPointSpacing(controlPointSpacing) ||
+      controlPointSpacing[0] != 15. || controlPointSpacing[1] != 15. ||
+      controlPointSpacing[2] != 15.)
+    {
+    std::cerr << "Line " << __LINE__ << ": wrong control point spacing "
+              << controlPointSpacing[0] << " " << controlPointSpacing[1]
+              << " " << controlPointSpacing[2] << std::endl;
+    return EXIT_FAILURE;
+    }
+  volumeNode->SetAndObserveTransformNodeID(bsplineTransformNode->GetID());
+  logic->UpdateTransforms();
+  double error = ResliceTransformError(logic.GetPointer());
+  if (logic->GetReslice()->GetResliceTransform() == logic->GetXYToIJKTransform() ||
+      error > 0.05)
+    {
+    std::cerr << "Line " << __LINE__ << ": BSpline transform error of "
+              << error << " voxel" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  return EXIT_SUCCESS;
+}
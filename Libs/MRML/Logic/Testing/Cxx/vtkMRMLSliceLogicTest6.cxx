@@ -0,0 +1,218 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+// MRMLLogic includes
+#include <vtkImageResliceMask.h>
+#include <vtkMRMLSliceLayerLogic.h>
+#include <vtkMRMLSliceLogic.h>
+
+// MRML includes
+#include <vtkMRMLColorTableNode.h>
+#include <vtkMRMLLabelMapVolumeDisplayNode.h>
+#include <vtkMRMLScalarVolumeDisplayNode.h>
+#include <vtkMRMLScalarVolumeNode.h>
+#include <vtkMRMLScene.h>
+#include <vtkMRMLSliceCompositeNode.h>
+
+// VTK includes
+#include <vtkImageBlend.h>
+#include <vtkImageData.h>
+#include <vtkNew.h>
+#include <vtkSmartPointer.h>
+#include <vtkTimerLog.h>
+
+// STD includes
+#include <iostream>
+
+namespace
+{
+
+//---------------------------------------------------------------------------
+vtkMRMLScalarVolumeNode* addVolume(vtkMRMLScene* scene, bool labelMap,
+                                   const char* colorNodeID)
+{
+  const int dim = 64;
+  vtkNew<vtkImageData> imageData;
+  imageData->SetDimensions(dim, dim, dim);
+  imageData->SetScalarTypeToShort();
+  imageData->SetNumberOfScalarComponents(1);
+  imageData->AllocateScalars();
+  short* ptr = static_cast<short*>(imageData->GetScalarPointer());
+  for (int i = 0; i < dim * dim * dim; ++i)
+    {
+    ptr[i] = labelMap ? (i % 3) : (i % 500);
+    }
+
+  vtkSmartPointer<vtkMRMLVolumeDisplayNode> displayNode;
+  if (labelMap)
+    {
+    displayNode = vtkSmartPointer<vtkMRMLLabelMapVolumeDisplayNode>::New();
+    }
+  else
+    {
+    vtkSmartPointer<vtkMRMLScalarVolumeDisplayNode> scalarDisplayNode =
+      vtkSmartPointer<vtkMRMLScalarVolumeDisplayNode>::New();
+    scalarDisplayNode->SetAutoWindowLevel(0);
+    scalarDisplayNode->SetWindowLevel(500., 250.);
+    displayNode = scalarDisplayNode;
+    }
+  scene->AddNode(displayNode);
+  displayNode->SetAndObserveColorNodeID(colorNodeID);
+
+  vtkNew<vtkMRMLScalarVolumeNode> volumeNode;
+  volumeNode->SetLabelMap(labelMap ? 1 : 0);
+  volumeNode->SetAndObserveImageData(imageData.GetPointer());
+  volumeNode->SetAndObserveDisplayNodeID(displayNode->GetID());
+  scene->AddNode(volumeNode.GetPointer());
+  return volumeNode.GetPointer();
+}
+
+//---------------------------------------------------------------------------
+bool checkUpdated(vtkDataObject* output, unsigned long& lastUpdateTime,
+                  bool expectedUpdate, const char* name, const char* action)
+{
+  output->Update();
+  bool updated = output->GetUpdateTime() != lastUpdateTime;
+  lastUpdateTime = output->GetUpdateTime();
+  if (updated != expectedUpdate)
+    {
+    std::cerr << action << ": " << name
+              << (updated ? " was re-executed" : " was not re-executed")
+              << std::endl;
+    return false;
+    }
+  return true;
+}
+
+} // end of anonymous namespace
+
+//---------------------------------------------------------------------------
+int vtkMRMLSliceLogicTest6(int vtkNotUsed(argc), char * vtkNotUsed(argv) [] )
+{
+  vtkNew<vtkMRMLScene> scene;
+  vtkNew<vtkMRMLSliceLogic> sliceLogic;
+  sliceLogic->SetName("Red");
+  sliceLogic->SetMRMLScene(scene.GetPointer());
+  sliceLogic->ResizeSliceNode(256, 256);
+
+  vtkNew<vtkMRMLSliceLayerLogic> backgroundLayer;
+  sliceLogic->SetBackgroundLayer(backgroundLayer.GetPointer());
+  vtkNew<vtkMRMLSliceLayerLogic> labelLayer;
+  labelLayer->IsLabelLayerOn();
+  sliceLogic->SetLabelLayer(labelLayer.GetPointer());
+
+  vtkNew<vtkMRMLColorTableNode> greyNode;
+  greyNode->SetTypeToGrey();
+  scene->AddNode(greyNode.GetPointer());
+  vtkNew<vtkMRMLColorTableNode> labelsNode;
+  labelsNode->SetTypeToLabels();
+  scene->AddNode(labelsNode.GetPointer());
+
+  vtkMRMLScalarVolumeNode* backgroundNode =
+    addVolume(scene.GetPointer(), false, greyNode->GetID());
+  vtkMRMLScalarVolumeNode* labelNode =
+    addVolume(scene.GetPointer(), true, labelsNode->GetID());
+
+  vtkMRMLSliceCompositeNode* sliceCompositeNode = sliceLogic->GetSliceCompositeNode();
+  sliceCompositeNode->SetBackgroundVolumeID(backgroundNode->GetID());
+  sliceCompositeNode->SetLabelVolumeID(labelNode->GetID());
+  if (!sliceLogic->GetImageData() ||
+      !backgroundLayer->GetImageData() || !labelLayer->GetImageData())
+    {
+    std::cerr << "Slice pipeline not set up." << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  vtkDataObject* backgroundReslice = backgroundLayer->GetReslice()->GetOutput();
+  vtkDataObject* backgroundColors = backgroundLayer->GetImageData();
+  vtkDataObject* labelReslice = labelLayer->GetReslice()->GetOutput();
+  vtkDataObject* blend = sliceLogic->GetBlend()->GetOutput();
+  unsigned long backgroundResliceTime = 0;
+  unsigned long backgroundColorsTime = 0;
+  unsigned long labelResliceTime = 0;
+  unsigned long blendTime = 0;
+  sliceLogic->GetImageData()->Update();
+  if (!checkUpdated(backgroundReslice, backgroundResliceTime, true, "Background reslice", "First render") ||
+      !checkUpdated(backgroundColors, backgroundColorsTime, true, "Background colors", "First render") ||
+      !checkUpdated(labelReslice, labelResliceTime, true, "Label reslice", "First render") ||
+      !checkUpdated(blend, blendTime, true, "Blend", "First render"))
+    {
+    return EXIT_FAILURE;
+    }
+
+  //---------------------------------------------------------------------------
+  // Painting the label map only re-executes the label layer and the blend
+  //---------------------------------------------------------------------------
+  for (int stroke = 0; stroke < 5; ++stroke)
+    {
+    vtkImageData* labelImage = labelNode->GetImageData();
+    labelImage->SetScalarComponentFromDouble(stroke, stroke, 0, 0, 5.);
+    labelImage->Modified();
+    labelNode->Modified();
+    sliceLogic->GetImageData()->Update();
+    if (!checkUpdated(backgroundReslice, backgroundResliceTime, false, "Background reslice", "Paint") ||
+        !checkUpdated(backgroundColors, backgroundColorsTime, false, "Background colors", "Paint") ||
+        !checkUpdated(labelReslice, labelResliceTime, true, "Label reslice", "Paint") ||
+        !checkUpdated(blend, blendTime, true, "Blend", "Paint"))
+      {
+      return EXIT_FAILURE;
+      }
+    }
+
+  //---------------------------------------------------------------------------
+  // Changing the opacity only re-executes the blend
+  //---------------------------------------------------------------------------
+  sliceCompositeNode->SetLabelOpacity(0.3);
+  sliceLogic->GetImageData()->Update();
+  if (!checkUpdated(backgroundReslice, backgroundResliceTime, false, "Background reslice", "Opacity") ||
+      !checkUpdated(backgroundColors, backgroundColorsTime, false, "Background colors", "Opacity") ||
+      !checkUpdated(labelReslice, labelResliceTime, false, "Label reslice", "Opacity") ||
+      !checkUpdated(blend, blendTime, true, "Blend", "Opacity"))
+    {
+    return EXIT_FAILURE;
+    }
+
+  //---------------------------------------------------------------------------
+  // Changing the window only re-maps the background colors
+  //---------------------------------------------------------------------------
+  vtkMRMLScalarVolumeDisplayNode::SafeDownCast(
+    backgroundNode->GetDisplayNode())->SetWindowLevel(300., 100.);
+  sliceLogic->GetImageData()->Update();
+  if (!checkUpdated(backgroundReslice, backgroundResliceTime, false, "Background reslice", "Window") ||
+      !checkUpdated(backgroundColors, backgroundColorsTime, true, "Background colors", "Window") ||
+      !checkUpdated(labelReslice, labelResliceTime, false, "Label reslice", "Window") ||
+      !checkUpdated(blend, blendTime, true, "Blend", "Window"))
+    {
+    return EXIT_FAILURE;
+    }
+
+  //---------------------------------------------------------------------------
+  // Benchmark: paint strokes
+  //---------------------------------------------------------------------------
+  const int strokes = 20;
+  vtkSmartPointer<vtkTimerLog> timerLog = vtkSmartPointer<vtkTimerLog>::New();
+  timerLog->StartTimer();
+  for (int stroke = 0; stroke < strokes; ++stroke)
+    {
+    labelNode->GetImageData()->Modified();
+    labelNode->Modified();
+    sliceLogic->GetImageData()->Update();
+    }
+  timerLog->StopTimer();
+  std::cout << "Paint stroke: " << timerLog->GetElapsedTime() / strokes
+            << "s" << std::endl;
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,220 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+// MRMLLogic includes
+#include <vtkMultiLabelMarchingCubes.h>
+
+// VTK includes
+#include <vtkCellArray.h>
+#include <vtkDiscreteMarchingCubes.h>
+#include <vtkImageData.h>
+#include <vtkMultiBlockDataSet.h>
+#include <vtkNew.h>
+#include <vtkPolyData.h>
+#include <vtkSmartPointer.h>
+#include <vtkTimerLog.h>
+
+// STD includes
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+
+namespace
+{
+
+//---------------------------------------------------------------------------
+// Atlas of parcels x parcels x parcels labels, surrounded by background.
+// Some voxels are moved to the next label so that the boundaries are not
+// all planar.
+vtkSmartPointer<vtkImageData> createAtlas(int parcels, int parcelSize)
+{
+  const int dim = parcels * parcelSize + 2;
+  vtkSmartPointer<vtkImageData> atlas = vtkSmartPointer<vtkImageData>::New();
+  atlas->SetDimensions(dim, dim, dim);
+  atlas->SetSpacing(0.5, 1., 2.);
+  atlas->SetOrigin(-10., 3., 7.);
+  atlas->SetScalarTypeToShort();
+  atlas->SetNumberOfScalarComponents(1);
+  atlas->AllocateScalars();
+  short* ptr = static_cast<short*>(atlas->GetScalarPointer());
+  for (int k = 0; k < dim; ++k)
+    {
+    for (int j = 0; j < dim; ++j)
+      {
+      for (int i = 0; i < dim; ++i, ++ptr)
+        {
+        if (i == 0 || j == 0 || k == 0 ||
+            i == dim - 1 || j == dim - 1 || k == dim - 1)
+          {
+          *ptr = 0;
+          continue;
+          }
+        int label = 1 + (i - 1) / parcelSize
+          + ((j - 1) / parcelSize) * parcels
+          + ((k - 1) / parcelSize) * parcels * parcels;
+        if ((i * 7 + j * 3 + k) % 11 == 0)
+          {
+          label = label % (parcels * parcels * parcels) + 1;
+          }
+        *ptr = static_cast<short>(label);
+        }
+      }
+    }
+  return atlas;
+}
+
+//---------------------------------------------------------------------------
+bool compareSurfaces(vtkPolyData* expected, vtkPolyData* surface, int label)
+{
+  if (!surface)
+    {
+    std::cerr << "No surface for label " << label << std::endl;
+    return false;
+    }
+  if (expected->GetNumberOfPoints() != surface->GetNumberOfPoints() ||
+      expected->GetNumberOfPolys() != surface->GetNumberOfPolys())
+    {
+    std::cerr << "Label " << label << ": "
+              << surface->GetNumberOfPoints() << " points and "
+              << surface->GetNumberOfPolys() << " triangles instead of "
+              << expected->GetNumberOfPoints() << " and "
+              << expected->GetNumberOfPolys() << std::endl;
+    return false;
+    }
+  for (vtkIdType i = 0; i < expected->GetNumberOfPoints(); ++i)
+    {
+    double* expectedPoint = expected->GetPoint(i);
+    double* point = surface->GetPoint(i);
+    for (int d = 0; d < 3; ++d)
+      {
+      if (fabs(expectedPoint[d] - point[d]) > 1e-6)
+        {
+        std::cerr << "Label " << label << ": wrong point " << i << std::endl;
+        return false;
+        }
+      }
+    }
+  // same triangles with the same orientation
+  vtkCellArray* expectedPolys = expected->GetPolys();
+  vtkCellArray* polys = surface->GetPolys();
+  expectedPolys->InitTraversal();
+  polys->InitTraversal();
+  vtkIdType expectedNpts = 0;
+  vtkIdType* expectedPts = 0;
+  vtkIdType npts = 0;
+  vtkIdType* pts = 0;
+  while (expectedPolys->GetNextCell(expectedNpts, expectedPts))
+    {
+    polys->GetNextCell(npts, pts);
+    if (npts != expectedNpts ||
+        pts[0] != expectedPts[0] || pts[1] != expectedPts[1] || pts[2] != expectedPts[2])
+      {
+      std::cerr << "Label " << label << ": wrong triangle" << std::endl;
+      return false;
+      }
+    }
+  return true;
+}
+
+} // end of anonymous namespace
+
+//---------------------------------------------------------------------------
+int vtkMultiLabelMarchingCubesTest1(int vtkNotUsed(argc), char * vtkNotUsed(argv)[])
+{
+  // 125 labels
+  const int parcels = 5;
+  const int numberOfLabels = parcels * parcels * parcels;
+  vtkSmartPointer<vtkImageData> atlas = createAtlas(parcels, 8);
+
+  //---------------------------------------------------------------------------
+  // All the labels: same surfaces as vtkDiscreteMarchingCubes
+  //---------------------------------------------------------------------------
+  vtkNew<vtkMultiLabelMarchingCubes> multiLabelCubes;
+  multiLabelCubes->SetInput(atlas);
+  multiLabelCubes->Update();
+  if (multiLabelCubes->GetOutput()->GetNumberOfBlocks() !=
+      static_cast<unsigned int>(numberOfLabels))
+    {
+    std::cerr << "Wrong number of surfaces: "
+              << multiLabelCubes->GetOutput()->GetNumberOfBlocks() << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  vtkNew<vtkDiscreteMarchingCubes> cubes;
+  cubes->SetInput(atlas);
+  cubes->ComputeScalarsOff();
+  cubes->ComputeNormalsOff();
+  cubes->ComputeGradientsOff();
+  for (int label = 1; label <= numberOfLabels; ++label)
+    {
+    cubes->SetValue(0, label);
+    cubes->Update();
+    if (!compareSurfaces(cubes->GetOutput(),
+                         multiLabelCubes->GetLabelSurface(label), label))
+      {
+      return EXIT_FAILURE;
+      }
+    }
+
+  //---------------------------------------------------------------------------
+  // Selected labels: one block per label in the given order, empty surface
+  // for missing labels
+  //---------------------------------------------------------------------------
+  multiLabelCubes->AddLabel(12);
+  multiLabelCubes->AddLabel(3);
+  multiLabelCubes->AddLabel(1000);
+  multiLabelCubes->Update();
+  vtkMultiBlockDataSet* output = multiLabelCubes->GetOutput();
+  vtkPolyData* missing = vtkPolyData::SafeDownCast(output->GetBlock(2));
+  if (output->GetNumberOfBlocks() != 3 ||
+      multiLabelCubes->GetLabelSurface(12) != output->GetBlock(0) ||
+      multiLabelCubes->GetLabelSurface(3) != output->GetBlock(1) ||
+      !missing || missing->GetNumberOfPolys() != 0)
+    {
+    std::cerr << "Wrong surfaces for selected labels" << std::endl;
+    return EXIT_FAILURE;
+    }
+  cubes->SetValue(0, 3);
+  cubes->Update();
+  if (!compareSurfaces(cubes->GetOutput(), multiLabelCubes->GetLabelSurface(3), 3))
+    {
+    return EXIT_FAILURE;
+    }
+
+  //---------------------------------------------------------------------------
+  // Benchmark: one pass against one vtkDiscreteMarchingCubes per label
+  //---------------------------------------------------------------------------
+  vtkSmartPointer<vtkImageData> bigAtlas = createAtlas(parcels, 24);
+  vtkSmartPointer<vtkTimerLog> timerLog = vtkSmartPointer<vtkTimerLog>::New();
+  timerLog->StartTimer();
+  cubes->SetInput(bigAtlas);
+  for (int label = 1; label <= numberOfLabels; ++label)
+    {
+    cubes->SetValue(0, label);
+    cubes->Update();
+    }
+  timerLog->StopTimer();
+  double perLabelTime = timerLog->GetElapsedTime();
+
+  timerLog->StartTimer();
+  multiLabelCubes->RemoveAllLabels();
+  multiLabelCubes->SetInput(bigAtlas);
+  multiLabelCubes->Update();
+  timerLog->StopTimer();
+  std::cout << numberOfLabels << " labels: " << perLabelTime << "s per label, "
+            << timerLog->GetElapsedTime() << "s in one pass" << std::endl;
+
+  return EXIT_SUCCESS;
+}
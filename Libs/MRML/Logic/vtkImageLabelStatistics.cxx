@@ -0,0 +1,455 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+#include "vtkImageLabelStatistics.h"
+
+// MRML includes
+#include <vtkImageHistogramCache.h>
+
+// VTK includes
+#include <vtkDoubleArray.h>
+#include <vtkIdTypeArray.h>
+#include <vtkImageData.h>
+#include <vtkInformation.h>
+#include <vtkInformationVector.h>
+#include <vtkIntArray.h>
+#include <vtkMultiThreader.h>
+#include <vtkObjectFactory.h>
+#include <vtkPointData.h>
+#include <vtkSmartPointer.h>
+#include <vtkStreamingDemandDrivenPipeline.h>
+#include <vtkTable.h>
+
+// STD includes
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <vector>
+
+vtkCxxRevisionMacro(vtkImageLabelStatistics, "$Revision$");
+vtkStandardNewMacro(vtkImageLabelStatistics);
+
+namespace
+{
+
+//----------------------------------------------------------------------------
+// Labels in a range smaller than this are indexed in an array, the others
+// in a map
+const double MaximumNumberOfDenseLabels = 65536;
+
+//----------------------------------------------------------------------------
+struct LabelStatistics
+{
+  LabelStatistics()
+    : Count(0), Min(VTK_DOUBLE_MAX), Max(-VTK_DOUBLE_MAX), Sum(0.),
+      SumOfSquares(0.)
+  {}
+
+  void Add(double value)
+  {
+    ++this->Count;
+    this->Min = value < this->Min ? value : this->Min;
+    this->Max = value > this->Max ? value : this->Max;
+    this->Sum += value;
+    this->SumOfSquares += value * value;
+  }
+
+  void Add(const LabelStatistics& other)
+  {
+    this->Count += other.Count;
+    this->Min = other.Min < this->Min ? other.Min : this->Min;
+    this->Max = other.Max > this->Max ? other.Max : this->Max;
+    this->Sum += other.Sum;
+    this->SumOfSquares += other.SumOfSquares;
+  }
+
+  vtkIdType Count;
+  double    Min;
+  double    Max;
+  double    Sum;
+  double    SumOfSquares;
+};
+
+typedef std::map<int, LabelStatistics> LabelStatisticsMap;
+
+//----------------------------------------------------------------------------
+struct vtkImageLabelStatisticsThreadData
+{
+  vtkImageData* LabelMap;
+  vtkImageData* Grayscale;
+
+  // labels are in [MinimumLabel, MinimumLabel + NumberOfDenseLabels) if
+  // NumberOfDenseLabels is not 0
+  int MinimumLabel;
+  int NumberOfDenseLabels;
+
+  // partial statistics of each thread
+  std::vector<std::vector<LabelStatistics> > Dense;
+  std::vector<LabelStatisticsMap>            Sparse;
+};
+
+//----------------------------------------------------------------------------
+// Copy the first component of a row of the grayscale volume
+template <class T>
+void vtkImageLabelStatisticsCopyRow(const T* ptr, vtkIdType step, int n,
+                                    double* row)
+{
+  for (int i = 0; i < n; ++i, ptr += step)
+    {
+    row[i] = static_cast<double>(*ptr);
+    }
+}
+
+//----------------------------------------------------------------------------
+template <class T>
+bool vtkImageLabelStatisticsLabel(T value, int& label)
+{
+  double doubleValue = static_cast<double>(value);
+  if (doubleValue < VTK_INT_MIN || doubleValue > VTK_INT_MAX ||
+      doubleValue != floor(doubleValue))
+    {
+    return false;
+    }
+  label = static_cast<int>(doubleValue);
+  return true;
+}
+
+//----------------------------------------------------------------------------
+template <class T>
+void vtkImageLabelStatisticsExecute(vtkImageLabelStatisticsThreadData* data,
+                                    const T* labels, int threadId,
+                                    int numberOfThreads)
+{
+  int dimensions[3];
+  data->LabelMap->GetDimensions(dimensions);
+  vtkIdType increments[3];
+  data->LabelMap->GetIncrements(increments);
+
+  const vtkIdType numberOfRows =
+    static_cast<vtkIdType>(dimensions[1]) * dimensions[2];
+  const vtkIdType firstRow = numberOfRows * threadId / numberOfThreads;
+  const vtkIdType lastRow = numberOfRows * (threadId + 1) / numberOfThreads;
+
+  vtkDataArray* grayscaleScalars = data->Grayscale ?
+    data->Grayscale->GetPointData()->GetScalars() : 0;
+  vtkIdType grayscaleIncrements[3] = {0, 0, 0};
+  if (grayscaleScalars)
+    {
+    data->Grayscale->GetIncrements(grayscaleIncrements);
+    }
+  std::vector<double> grayscaleRow(dimensions[0], 0.);
+
+  LabelStatistics* dense = data->NumberOfDenseLabels > 0 ?
+    &data->Dense[threadId][0] : 0;
+  LabelStatisticsMap& sparse = data->Sparse[threadId];
+  // labels come in runs: remember the statistics of the last label
+  int lastLabel = 0;
+  LabelStatistics* lastStatistics = 0;
+
+  for (vtkIdType row = firstRow; row < lastRow; ++row)
+    {
+    const vtkIdType j = row % dimensions[1];
+    const vtkIdType k = row / dimensions[1];
+    const T* ptr = labels + k * increments[2] + j * increments[1];
+    if (grayscaleScalars)
+      {
+      void* grayscalePtr = grayscaleScalars->GetVoidPointer(
+        k * grayscaleIncrements[2] + j * grayscaleIncrements[1]);
+      switch (grayscaleScalars->GetDataType())
+        {
+        vtkTemplateMacro(
+          vtkImageLabelStatisticsCopyRow(static_cast<const VTK_TT*>(grayscalePtr),
+                                         grayscaleIncrements[0], dimensions[0],
+                                         &grayscaleRow[0]));
+        default:
+          break;
+        }
+      }
+    for (int i = 0; i < dimensions[0]; ++i, ptr += increments[0])
+      {
+      int label = 0;
+      if (!vtkImageLabelStatisticsLabel(*ptr, label))
+        {
+        continue;
+        }
+      LabelStatistics* statistics = 0;
+      const unsigned int denseIndex =
+        static_cast<unsigned int>(label - data->MinimumLabel);
+      if (dense && denseIndex < static_cast<unsigned int>(data->NumberOfDenseLabels))
+        {
+        statistics = &dense[denseIndex];
+        }
+      else if (lastStatistics && label == lastLabel)
+        {
+        statistics = lastStatistics;
+        }
+      else
+        {
+        statistics = &sparse[label];
+        lastLabel = label;
+        lastStatistics = statistics;
+        }
+      statistics->Add(grayscaleRow[i]);
+      }
+    }
+}
+
+//----------------------------------------------------------------------------
+VTK_THREAD_RETURN_TYPE vtkImageLabelStatisticsThreadedExecute(void *arg)
+{
+  vtkMultiThreader::ThreadInfo *info =
+    static_cast<vtkMultiThreader::ThreadInfo *>(arg);
+  vtkImageLabelStatisticsThreadData *data =
+    static_cast<vtkImageLabelStatisticsThreadData *>(info->UserData);
+
+  void* labels = data->LabelMap->GetScalarPointer();
+  switch (data->LabelMap->GetScalarType())
+    {
+    vtkTemplateMacro(
+      vtkImageLabelStatisticsExecute(data, static_cast<const VTK_TT*>(labels),
+                                     info->ThreadID, info->NumberOfThreads));
+    default:
+      break;
+    }
+  return VTK_THREAD_RETURN_VALUE;
+}
+
+//----------------------------------------------------------------------------
+vtkDoubleArray* vtkImageLabelStatisticsAddColumn(vtkTable* table,
+                                                 const char* name,
+                                                 vtkIdType numberOfRows)
+{
+  vtkSmartPointer<vtkDoubleArray> column = vtkSmartPointer<vtkDoubleArray>::New();
+  column->SetName(name);
+  column->SetNumberOfValues(numberOfRows);
+  table->AddColumn(column);
+  return column;
+}
+
+} // end of anonymous namespace
+
+//----------------------------------------------------------------------------
+vtkImageLabelStatistics::vtkImageLabelStatistics()
+{
+  this->VoxelVolume = 0.;
+  this->NumberOfThreads = vtkMultiThreader::GetGlobalDefaultNumberOfThreads();
+  this->SetNumberOfInputPorts(2);
+}
+
+//----------------------------------------------------------------------------
+vtkImageLabelStatistics::~vtkImageLabelStatistics()
+{
+}
+
+//----------------------------------------------------------------------------
+void vtkImageLabelStatistics::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+  os << indent << "VoxelVolume: " << this->VoxelVolume << "\n";
+  os << indent << "NumberOfThreads: " << this->NumberOfThreads << "\n";
+}
+
+//----------------------------------------------------------------------------
+void vtkImageLabelStatistics::SetLabelMap(vtkImageData* labelMap)
+{
+  this->SetInputConnection(0, labelMap ? labelMap->GetProducerPort() : 0);
+}
+
+//----------------------------------------------------------------------------
+void vtkImageLabelStatistics::SetGrayscale(vtkImageData* grayscale)
+{
+  this->SetInputConnection(1, grayscale ? grayscale->GetProducerPort() : 0);
+}
+
+//----------------------------------------------------------------------------
+int vtkImageLabelStatistics::FillInputPortInformation(int port,
+                                                      vtkInformation *info)
+{
+  info->Set(vtkAlgorithm::INPUT_REQUIRED_DATA_TYPE(), "vtkImageData");
+  if (port == 1)
+    {
+    info->Set(vtkAlgorithm::INPUT_IS_OPTIONAL(), 1);
+    }
+  return 1;
+}
+
+//----------------------------------------------------------------------------
+int vtkImageLabelStatistics::RequestUpdateExtent(
+  vtkInformation *vtkNotUsed(request),
+  vtkInformationVector **inputVector,
+  vtkInformationVector *vtkNotUsed(outputVector))
+{
+  // the whole volumes are needed
+  for (int port = 0; port < 2; ++port)
+    {
+    vtkInformation *inInfo = inputVector[port]->GetInformationObject(0);
+    if (inInfo)
+      {
+      inInfo->Set(vtkStreamingDemandDrivenPipeline::UPDATE_EXTENT(),
+                  inInfo->Get(vtkStreamingDemandDrivenPipeline::WHOLE_EXTENT()), 6);
+      }
+    }
+  return 1;
+}
+
+//----------------------------------------------------------------------------
+int vtkImageLabelStatistics::RequestData(
+  vtkInformation *vtkNotUsed(request),
+  vtkInformationVector **inputVector,
+  vtkInformationVector *outputVector)
+{
+  vtkImageData *labelMap = vtkImageData::GetData(inputVector[0]);
+  vtkImageData *grayscale = vtkImageData::GetData(inputVector[1]);
+  vtkTable *output = vtkTable::GetData(outputVector);
+  if (!labelMap || !output)
+    {
+    return 0;
+    }
+  if (grayscale && !grayscale->GetPointData()->GetScalars())
+    {
+    grayscale = 0;
+    }
+  if (grayscale)
+    {
+    int labelDimensions[3];
+    labelMap->GetDimensions(labelDimensions);
+    int grayscaleDimensions[3];
+    grayscale->GetDimensions(grayscaleDimensions);
+    if (labelDimensions[0] != grayscaleDimensions[0] ||
+        labelDimensions[1] != grayscaleDimensions[1] ||
+        labelDimensions[2] != grayscaleDimensions[2])
+      {
+      vtkErrorMacro(<< "The label map and the grayscale volume don't have "
+                    << "the same dimensions");
+      return 0;
+      }
+    }
+
+  LabelStatisticsMap statistics;
+  double labelRange[2];
+  if (labelMap->GetPointData()->GetScalars() &&
+      vtkImageHistogramCache::GetInstance()->GetScalarRange(labelMap, labelRange))
+    {
+    vtkImageLabelStatisticsThreadData data;
+    data.LabelMap = labelMap;
+    data.Grayscale = grayscale;
+    data.MinimumLabel = 0;
+    data.NumberOfDenseLabels = 0;
+    labelRange[0] = std::max(ceil(labelRange[0]), static_cast<double>(VTK_INT_MIN));
+    labelRange[1] = std::min(floor(labelRange[1]), static_cast<double>(VTK_INT_MAX));
+    if (labelRange[1] >= labelRange[0] &&
+        labelRange[1] - labelRange[0] < MaximumNumberOfDenseLabels)
+      {
+      data.MinimumLabel = static_cast<int>(labelRange[0]);
+      data.NumberOfDenseLabels =
+        static_cast<int>(labelRange[1] - labelRange[0]) + 1;
+      }
+
+    int dimensions[3];
+    labelMap->GetDimensions(dimensions);
+    int numberOfThreads = static_cast<int>(std::min(
+      static_cast<vtkIdType>(this->NumberOfThreads),
+      static_cast<vtkIdType>(dimensions[1]) * dimensions[2]));
+    data.Dense.resize(numberOfThreads,
+                      std::vector<LabelStatistics>(data.NumberOfDenseLabels));
+    data.Sparse.resize(numberOfThreads);
+
+    vtkSmartPointer<vtkMultiThreader> threader =
+      vtkSmartPointer<vtkMultiThreader>::New();
+    threader->SetNumberOfThreads(numberOfThreads);
+    threader->SetSingleMethod(vtkImageLabelStatisticsThreadedExecute, &data);
+    threader->SingleMethodExecute();
+
+    // reduce the partial statistics of the threads
+    for (int t = 0; t < numberOfThreads; ++t)
+      {
+      for (int l = 0; l < data.NumberOfDenseLabels; ++l)
+        {
+        if (data.Dense[t][l].Count > 0)
+          {
+          statistics[data.MinimumLabel + l].Add(data.Dense[t][l]);
+          }
+        }
+      for (LabelStatisticsMap::const_iterator it = data.Sparse[t].begin();
+           it != data.Sparse[t].end(); ++it)
+        {
+        statistics[it->first].Add(it->second);
+        }
+      }
+    }
+
+  double voxelVolume = this->VoxelVolume;
+  if (voxelVolume == 0.)
+    {
+    double spacing[3];
+    labelMap->GetSpacing(spacing);
+    voxelVolume = spacing[0] * spacing[1] * spacing[2];
+    }
+  const double ccPerCubicMM = 0.001;
+
+  output->Initialize();
+  const vtkIdType numberOfRows = static_cast<vtkIdType>(statistics.size());
+  vtkSmartPointer<vtkIntArray> indexColumn = vtkSmartPointer<vtkIntArray>::New();
+  indexColumn->SetName("Index");
+  indexColumn->SetNumberOfValues(numberOfRows);
+  output->AddColumn(indexColumn);
+  vtkSmartPointer<vtkIdTypeArray> countColumn = vtkSmartPointer<vtkIdTypeArray>::New();
+  countColumn->SetName("Count");
+  countColumn->SetNumberOfValues(numberOfRows);
+  output->AddColumn(countColumn);
+  vtkDoubleArray* volumeColumn =
+    vtkImageLabelStatisticsAddColumn(output, "Volume mm^3", numberOfRows);
+  vtkDoubleArray* volumeCCColumn =
+    vtkImageLabelStatisticsAddColumn(output, "Volume cc", numberOfRows);
+  vtkDoubleArray* minColumn = 0;
+  vtkDoubleArray* maxColumn = 0;
+  vtkDoubleArray* meanColumn = 0;
+  vtkDoubleArray* stdDevColumn = 0;
+  if (grayscale)
+    {
+    minColumn = vtkImageLabelStatisticsAddColumn(output, "Min", numberOfRows);
+    maxColumn = vtkImageLabelStatisticsAddColumn(output, "Max", numberOfRows);
+    meanColumn = vtkImageLabelStatisticsAddColumn(output, "Mean", numberOfRows);
+    stdDevColumn = vtkImageLabelStatisticsAddColumn(output, "StdDev", numberOfRows);
+    }
+
+  vtkIdType row = 0;
+  for (LabelStatisticsMap::const_iterator it = statistics.begin();
+       it != statistics.end(); ++it, ++row)
+    {
+    const LabelStatistics& labelStatistics = it->second;
+    const double count = static_cast<double>(labelStatistics.Count);
+    indexColumn->SetValue(row, it->first);
+    countColumn->SetValue(row, labelStatistics.Count);
+    volumeColumn->SetValue(row, count * voxelVolume);
+    volumeCCColumn->SetValue(row, count * voxelVolume * ccPerCubicMM);
+    if (!grayscale)
+      {
+      continue;
+      }
+    const double mean = labelStatistics.Sum / count;
+    double variance = 0.;
+    if (labelStatistics.Count > 1)
+      {
+      variance = (labelStatistics.SumOfSquares - labelStatistics.Sum * mean) /
+        (count - 1.);
+      }
+    minColumn->SetValue(row, labelStatistics.Min);
+    maxColumn->SetValue(row, labelStatistics.Max);
+    meanColumn->SetValue(row, mean);
+    stdDevColumn->SetValue(row, sqrt(variance > 0. ? variance : 0.));
+    }
+  return 1;
+}
@@ -0,0 +1,83 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+#ifndef __vtkImageLabelStatistics_h
+#define __vtkImageLabelStatistics_h
+
+// VTK includes
+#include <vtkTableAlgorithm.h>
+
+#include "vtkMRMLLogicWin32Header.h"
+
+class vtkImageData;
+
+/// \brief Compute the statistics of all the labels of a label map in one pass.
+///
+/// Thresholding the label map and running vtkImageAccumulate for each label
+/// walks the volumes once per label. vtkImageLabelStatistics walks the label
+/// map (input port 0) and the grayscale volume (optional input port 1) once,
+/// with one thread per piece of the volume, and sums the partial statistics
+/// of each thread per label.
+///
+/// The output is a vtkTable with one row per label found in the label map,
+/// in increasing order, and the columns:
+/// "Index", "Count", "Volume mm^3", "Volume cc" and, if a grayscale volume
+/// is set, "Min", "Max", "Mean" and "StdDev" of the grayscale voxels of the
+/// label (StdDev is computed like vtkImageAccumulate does, with count - 1).
+/// The label map and the grayscale volume must have the same dimensions.
+/// The voxel values of the label map that are not integers are ignored.
+class VTK_MRML_LOGIC_EXPORT vtkImageLabelStatistics : public vtkTableAlgorithm
+{
+public:
+  static vtkImageLabelStatistics *New();
+  vtkTypeRevisionMacro(vtkImageLabelStatistics, vtkTableAlgorithm);
+  virtual void PrintSelf(ostream& os, vtkIndent indent);
+
+  /// Convenience methods to set the inputs without a pipeline connection.
+  void SetLabelMap(vtkImageData* labelMap);
+  void SetGrayscale(vtkImageData* grayscale);
+
+  /// Volume of a voxel in mm^3. If 0 (default), it is the product of the
+  /// spacing of the label map. It is typically set from the spacing of
+  /// the MRML volume node as the image data of a volume node has a spacing
+  /// of 1.
+  vtkSetMacro(VoxelVolume, double);
+  vtkGetMacro(VoxelVolume, double);
+
+  /// Number of threads to use, vtkMultiThreader default by default.
+  vtkSetClampMacro(NumberOfThreads, int, 1, VTK_INT_MAX);
+  vtkGetMacro(NumberOfThreads, int);
+
+protected:
+  vtkImageLabelStatistics();
+  ~vtkImageLabelStatistics();
+
+  virtual int FillInputPortInformation(int port, vtkInformation *info);
+  virtual int RequestUpdateExtent(vtkInformation *request,
+                                  vtkInformationVector **inputVector,
+                                  vtkInformationVector *outputVector);
+  virtual int RequestData(vtkInformation *request,
+                          vtkInformationVector **inputVector,
+                          vtkInformationVector *outputVector);
+
+  double VoxelVolume;
+  int NumberOfThreads;
+
+private:
+  vtkImageLabelStatistics(const vtkImageLabelStatistics&);  // Not implemented.
+  void operator=(const vtkImageLabelStatistics&);  // Not implemented.
+};
+
+#endif
@@ -16,13 +16,16 @@
 
 // VTK includes
 #include <vtkDataArray.h>
+#include <vtkHomogeneousTransform.h>
 #include <vtkImageData.h>
 #include <vtkInformation.h>
 #include <vtkInformationVector.h>
+#include <vtkMatrix4x4.h>
 #include <vtkObjectFactory.h>
 #include <vtkPointData.h>
 #include <vtkStreamingDemandDrivenPipeline.h>
 #include <vtkTransform.h>
+#include <vtkTypeTraits.h>
 
 // turn off 64-bit ints when templating over all types
 # undef VTK_USE_INT64
@@ -31,6 +34,8 @@
 # define VTK_USE_UINT64 0
 
 // STD includes
+#include <cmath>
+#include <vector>
 
 vtkCxxRevisionMacro(vtkImageLinearReslice, "$Revision$");
 vtkStandardNewMacro(vtkImageLinearReslice);
@@ -192,133 +197,322 @@ int vtkImageLinearReslice::RequestInformation(
 }
 
 //----------------------------------------------------------------------------
-// This function executes the filter for any type of data.  
+// Clamp and round an interpolated value into the output scalar type
 template <class T>
+inline void vtkImageLinearResliceClamp(double val, T& out)
+{
+  if (val < static_cast<double>(vtkTypeTraits<T>::Min()))
+    {
+    val = static_cast<double>(vtkTypeTraits<T>::Min());
+    }
+  if (val > static_cast<double>(vtkTypeTraits<T>::Max()))
+    {
+    val = static_cast<double>(vtkTypeTraits<T>::Max());
+    }
+  out = static_cast<T>(floor(val + 0.5));
+}
+
+inline void vtkImageLinearResliceClamp(double val, float& out)
+{
+  out = static_cast<float>(val);
+}
+
+inline void vtkImageLinearResliceClamp(double val, double& out)
+{
+  out = val;
+}
+
+//----------------------------------------------------------------------------
+// Interpolation taps of an output voxel: along each axis, N input
+// offsets and weights. The kernels are separable: the value is the sum over
+// the N*N*N combinations of the taps. N is 1 for nearest neighbor, 2 for
+// linear and 4 for cubic interpolation.
+template <int N>
+struct vtkImageLinearResliceTaps
+{
+  vtkIdType Offsets[3][N];
+  double Weights[3][N];
+  bool Inside;
+};
+
+//----------------------------------------------------------------------------
+// Compute the taps along one axis of the continuous input index \a x.
+// \a ext are the bounds of the axis and \a inc the increment of the axis.
+// Return false if \a x is outside the input.
+inline bool vtkImageLinearResliceAxisTaps(double x, const int ext[2],
+                                          vtkIdType inc,
+                                          vtkIdType (&offsets)[1],
+                                          double (&weights)[1])
+{
+  if (x < ext[0] - 0.5 || x >= ext[1] + 0.5)
+    {
+    return false;
+    }
+  int i = static_cast<int>(floor(x + 0.5));
+  i = (i > ext[1] ? ext[1] : i);
+  offsets[0] = (i - ext[0]) * inc;
+  weights[0] = 1.;
+  return true;
+}
+
+inline bool vtkImageLinearResliceAxisTaps(double x, const int ext[2],
+                                          vtkIdType inc,
+                                          vtkIdType (&offsets)[2],
+                                          double (&weights)[2])
+{
+  // tolerance for the points that are right on the boundary
+  const double tolerance = 1e-3;
+  if (x < ext[0] - tolerance || x > ext[1] + tolerance)
+    {
+    return false;
+    }
+  x = (x < ext[0] ? ext[0] : (x > ext[1] ? ext[1] : x));
+  int i = static_cast<int>(floor(x));
+  double f = x - i;
+  if (i >= ext[1])
+    {
+    // last slice: interpolate with the previous slice if any
+    i = ext[1] > ext[0] ? ext[1] - 1 : ext[1];
+    f = ext[1] > ext[0] ? 1. : 0.;
+    }
+  offsets[0] = (i - ext[0]) * inc;
+  offsets[1] = (i + (ext[1] > ext[0] ? 1 : 0) - ext[0]) * inc;
+  weights[0] = 1. - f;
+  weights[1] = f;
+  return true;
+}
+
+inline bool vtkImageLinearResliceAxisTaps(double x, const int ext[2],
+                                          vtkIdType inc,
+                                          vtkIdType (&offsets)[4],
+                                          double (&weights)[4])
+{
+  const double tolerance = 1e-3;
+  if (x < ext[0] - tolerance || x > ext[1] + tolerance)
+    {
+    return false;
+    }
+  x = (x < ext[0] ? ext[0] : (x > ext[1] ? ext[1] : x));
+  int i = static_cast<int>(floor(x));
+  double f = x - i;
+  // Catmull-Rom spline, the same kernel as vtkImageReslice
+  double f2 = f * f;
+  double f3 = f2 * f;
+  weights[0] = -0.5 * f3 + f2 - 0.5 * f;
+  weights[1] = 1.5 * f3 - 2.5 * f2 + 1.;
+  weights[2] = -1.5 * f3 + 2. * f2 + 0.5 * f;
+  weights[3] = 0.5 * f3 - 0.5 * f2;
+  for (int t = 0; t < 4; ++t)
+    {
+    // replicate the boundary slices
+    int it = i - 1 + t;
+    it = (it < ext[0] ? ext[0] : (it > ext[1] ? ext[1] : it));
+    offsets[t] = (it - ext[0]) * inc;
+    }
+  return true;
+}
+
+//----------------------------------------------------------------------------
+// Resample a row of output voxels. The row is processed in 2 passes: the
+// taps of all the voxels are first computed from the input indices of the
+// row, then the input is gathered and the taps are weighted.
+template <int N, class T>
+void vtkImageLinearResliceRow(const double* points, int count,
+                              const int inExt[6], const vtkIdType inIncs[3],
+                              const T* inPtr, int numscalars,
+                              const T* background,
+                              vtkImageLinearResliceTaps<N>* taps,
+                              T* outPtr)
+{
+  for (int idX = 0; idX < count; ++idX)
+    {
+    vtkImageLinearResliceTaps<N>& tap = taps[idX];
+    const double* point = points + 3 * idX;
+    tap.Inside =
+      vtkImageLinearResliceAxisTaps(point[0], inExt, inIncs[0],
+                                    tap.Offsets[0], tap.Weights[0]) &&
+      vtkImageLinearResliceAxisTaps(point[1], inExt + 2, inIncs[1],
+                                    tap.Offsets[1], tap.Weights[1]) &&
+      vtkImageLinearResliceAxisTaps(point[2], inExt + 4, inIncs[2],
+                                    tap.Offsets[2], tap.Weights[2]);
+    }
+
+  for (int idX = 0; idX < count; ++idX)
+    {
+    const vtkImageLinearResliceTaps<N>& tap = taps[idX];
+    if (!tap.Inside)
+      {
+      for (int c = 0; c < numscalars; ++c)
+        {
+        *outPtr++ = background[c];
+        }
+      continue;
+      }
+    for (int c = 0; c < numscalars; ++c)
+      {
+      double value = 0.;
+      for (int k = 0; k < N; ++k)
+        {
+        for (int j = 0; j < N; ++j)
+          {
+          const T* rowPtr = inPtr + tap.Offsets[2][k] + tap.Offsets[1][j] + c;
+          double weightYZ = tap.Weights[2][k] * tap.Weights[1][j];
+          for (int i = 0; i < N; ++i)
+            {
+            value += weightYZ * tap.Weights[0][i] * rowPtr[tap.Offsets[0][i]];
+            }
+          }
+        }
+      vtkImageLinearResliceClamp(value, *outPtr++);
+      }
+    }
+}
+
+//----------------------------------------------------------------------------
+// Nearest neighbor doesn't need any weighting, the input values are copied.
+template <class T>
+void vtkImageLinearResliceRow(const double* points, int count,
+                              const int inExt[6], const vtkIdType inIncs[3],
+                              const T* inPtr, int numscalars,
+                              const T* background,
+                              vtkImageLinearResliceTaps<1>* taps,
+                              T* outPtr)
+{
+  for (int idX = 0; idX < count; ++idX)
+    {
+    vtkImageLinearResliceTaps<1>& tap = taps[idX];
+    const double* point = points + 3 * idX;
+    tap.Inside =
+      vtkImageLinearResliceAxisTaps(point[0], inExt, inIncs[0],
+                                    tap.Offsets[0], tap.Weights[0]) &&
+      vtkImageLinearResliceAxisTaps(point[1], inExt + 2, inIncs[1],
+                                    tap.Offsets[1], tap.Weights[1]) &&
+      vtkImageLinearResliceAxisTaps(point[2], inExt + 4, inIncs[2],
+                                    tap.Offsets[2], tap.Weights[2]);
+    if (tap.Inside)
+      {
+      // collapse the offsets, only the first one is used
+      tap.Offsets[0][0] += tap.Offsets[1][0] + tap.Offsets[2][0];
+      }
+    }
+
+  for (int idX = 0; idX < count; ++idX)
+    {
+    const vtkImageLinearResliceTaps<1>& tap = taps[idX];
+    const T* valuePtr = tap.Inside ? inPtr + tap.Offsets[0][0] : background;
+    for (int c = 0; c < numscalars; ++c)
+      {
+      *outPtr++ = valuePtr[c];
+      }
+    }
+}
+
+//----------------------------------------------------------------------------
+// This function executes the filter for any type of data.
+// For linear slice transforms, the input index of the voxels of a row are
+// computed incrementally from the first voxel of the row.
+template <int N, class T>
 void vtkImageLinearResliceExecute(vtkImageLinearReslice *self,
-                            vtkImageData *inData, 
-                            vtkImageData *outData, T *outPtr,
-                            int outExt[6], int id)
+                                  vtkImageData *inData,
+                                  vtkImageData *outData, T *outPtr,
+                                  int outExt[6], int id)
 {
-  int numscalars;
-  int idX, idY, idZ;
   vtkIdType outIncX, outIncY, outIncZ;
-  int scalarSize;
   int inExt[6];
+  vtkIdType inIncs[3];
   unsigned long count = 0;
   unsigned long target;
-  int intPoint[3];
-  vtkIdType scalarIncs[3], scalarsMaxId;
 
   vtkDataArray *inScalars = inData->GetPointData()->GetScalars();
-  inData->GetArrayIncrements(inScalars, scalarIncs);
-  scalarsMaxId = inScalars->GetMaxId();
+  inData->GetArrayIncrements(inScalars, inIncs);
+  inData->GetExtent(inExt);
+  const T *inPtr = static_cast<const T*>(inScalars->GetVoidPointer(0));
+  int numscalars = inData->GetNumberOfScalarComponents();
+  outData->GetContinuousIncrements(outExt, outIncX, outIncY, outIncZ);
+
+  std::vector<T> background(numscalars);
+  for (int c = 0; c < numscalars; ++c)
+    {
+    vtkImageLinearResliceClamp(self->GetBackgroundColor()[c < 4 ? c : 3],
+                               background[c]);
+    }
 
-  // the transformation to apply to the data
+  // the transformation to apply to the data: a matrix if it is linear
   vtkAbstractTransform *transform = self->GetSliceTransform();
+  double matrix[4][4];
+  bool linear = true;
+  vtkMatrix4x4::Identity(*matrix);
+  if (vtkHomogeneousTransform::SafeDownCast(transform))
+    {
+    vtkMatrix4x4::DeepCopy(*matrix,
+      vtkHomogeneousTransform::SafeDownCast(transform)->GetMatrix());
+    linear = (matrix[3][0] == 0. && matrix[3][1] == 0. &&
+              matrix[3][2] == 0. && matrix[3][3] == 1.);
+    }
+  else if (transform)
+    {
+    linear = false;
+    }
+
+  int rowLength = outExt[1] - outExt[0] + 1;
+  std::vector<double> points(3 * rowLength);
+  std::vector<vtkImageLinearResliceTaps<N> > taps(rowLength);
 
   // for the progress meter
   target = (unsigned long)
     ((outExt[5]-outExt[4]+1)*(outExt[3]-outExt[2]+1)/50.0);
   target++;
-  
-  // Get Increments to march through data 
-  inData->GetExtent(inExt);
-  outData->GetContinuousIncrements(outExt, outIncX, outIncY, outIncZ);
-  scalarSize = outData->GetScalarSize();
-  numscalars = inData->GetNumberOfScalarComponents();
-
-//vtkDebugMacro( "id " << id << " ext " << outExt[0] << " " << outExt[1] << " " << outExt[2] << " " << outExt[3] << " " << outExt[4] << " " << outExt[5] << "\n"); 
 
-  double steps = (outExt[1] - outExt[0]);
-  double invSteps = ( ( steps == 0.0 ) ? 1.0 : 1.0 / steps );
-
-
-  // Loop through output voxels
-  for (idZ = outExt[4]; idZ <= outExt[5]; idZ++)
+  // Loop through output rows
+  for (int idZ = outExt[4]; idZ <= outExt[5]; idZ++)
     {
-    for (idY = outExt[2]; idY <= outExt[3]; idY++)
+    for (int idY = outExt[2]; idY <= outExt[3]; idY++)
       {
-      if (id == 0) 
+      if (id == 0)
         { // update the progress if this is the main thread
-        if (!(count%target)) 
+        if (!(count%target))
           {
           self->UpdateProgress(count/(50.0*target));
           }
         count++;
         }
 
-      // 
-      // calculate the delta IJK with per step of X
-      //
-
-      double ijk[3], ijkStart[3], ijkEnd[3];
-      double dIJKdX[3];
-
-      ijkStart[0] = outExt[0];
-      ijkEnd[0] = outExt[1];
-      ijkStart[1] = ijkEnd[1] = idY;
-      ijkStart[2] = ijkEnd[2] = idZ;
-
-      // apply SliceTransform
-      if (transform)
-        {
-        transform->InternalTransformPoint(ijkStart, ijkStart);
-        transform->InternalTransformPoint(ijkEnd, ijkEnd);
-        }
-      
-      dIJKdX[0] = (ijkEnd[0] - ijkStart[0]) * invSteps;
-      dIJKdX[1] = (ijkEnd[1] - ijkStart[1]) * invSteps;
-      dIJKdX[2] = (ijkEnd[2] - ijkStart[2]) * invSteps;
-
-      ijk[0] = ijkStart[0];
-      ijk[1] = ijkStart[1];
-      ijk[2] = ijkStart[2];
-      T *inPtr;
-      T *baseInPtr = (T *) inScalars->GetVoidPointer(0);
-      
-      for (idX = outExt[0]; idX <= outExt[1]; idX++)
+      if (linear)
         {
-
-        intPoint[0] = (int) (ijk[0] += dIJKdX[0]);
-        intPoint[1] = (int) (ijk[1] += dIJKdX[1]);
-        intPoint[2] = (int) (ijk[2] += dIJKdX[2]);
-
-        if ( intPoint[0] < inExt[0] || intPoint[0] > inExt[1] ||
-             intPoint[1] < inExt[2] || intPoint[1] > inExt[3] ||
-             intPoint[2] < inExt[4] || intPoint[2] > inExt[5] )
+        double start[3], step[3];
+        for (int i = 0; i < 3; ++i)
           {
-          for (int i = 0; i < numscalars; i++)
-            {
-            *outPtr++ = (T)100;
-            }
+          start[i] = matrix[i][0] * outExt[0] + matrix[i][1] * idY +
+                     matrix[i][2] * idZ + matrix[i][3];
+          step[i] = matrix[i][0];
           }
-        else
+        double* point = &points[0];
+        for (int idX = 0; idX < rowLength; ++idX)
           {
-          //T *inPtr = (T *) (inData->GetArrayPointer(inScalars, intPoint));
-
-
-          // compute the index of the vector.
-          vtkIdType idx = ((intPoint[0] - inExt[0]) * scalarIncs[0]
-                         + (intPoint[1] - inExt[2]) * scalarIncs[1]
-                         + (intPoint[2] - inExt[4]) * scalarIncs[2]);
-
-          if ( idx < 0 || idx > scalarsMaxId )
-            {
-            vtkErrorWithObjectMacro(self, "Bad index calculation!");
-            }
-
-          inPtr = baseInPtr + idx;
-          for (int i = 0; i < numscalars; i++)
-            {
-            *outPtr++ = *inPtr++;
-            }
+          *point++ = start[0] + idX * step[0];
+          *point++ = start[1] + idX * step[1];
+          *point++ = start[2] + idX * step[2];
+          }
+        }
+      else
+        {
+        for (int idX = 0; idX < rowLength; ++idX)
+          {
+          double* point = &points[3 * idX];
+          point[0] = outExt[0] + idX;
+          point[1] = idY;
+          point[2] = idZ;
+          transform->InternalTransformPoint(point, point);
           }
         }
-      outPtr = (T *)((char *)outPtr + outIncY*scalarSize);
+
+      vtkImageLinearResliceRow(&points[0], rowLength, inExt, inIncs,
+                               inPtr, numscalars, &background[0],
+                               &taps[0], outPtr);
+      outPtr += rowLength * numscalars + outIncY;
       }
-    outPtr = (T *)((char *)outPtr + outIncZ*scalarSize);
+    outPtr += outIncZ;
     }
-
 }
 
 //----------------------------------------------------------------------------
@@ -351,15 +545,47 @@ void vtkImageLinearReslice::ThreadedRequestData(
   // Get the output pointer
   void *outPtr = outData[0]->GetScalarPointerForExtent(outExt);
 
-  switch (inData[0][0]->GetScalarType())
+  if (!inData[0][0]->GetPointData()->GetScalars())
     {
-    vtkTemplateMacro( 
-      vtkImageLinearResliceExecute(this, inData[0][0],  outData[0], (VTK_TT *)outPtr, outExt, id) );
-    default: 
-      {
-      vtkErrorMacro(<< "Execute: Unknown ScalarType\n");
-      return;
-      }
+    return;
+    }
+
+  switch (this->InterpolationMode)
+    {
+    case VTK_SLICE_LINEAR:
+      switch (inData[0][0]->GetScalarType())
+        {
+        vtkTemplateMacro(
+          vtkImageLinearResliceExecute<2>(this, inData[0][0], outData[0],
+                                          (VTK_TT *)outPtr, outExt, id) );
+        default:
+          vtkErrorMacro(<< "Execute: Unknown ScalarType\n");
+          return;
+        }
+      break;
+    case VTK_SLICE_CUBIC:
+      switch (inData[0][0]->GetScalarType())
+        {
+        vtkTemplateMacro(
+          vtkImageLinearResliceExecute<4>(this, inData[0][0], outData[0],
+                                          (VTK_TT *)outPtr, outExt, id) );
+        default:
+          vtkErrorMacro(<< "Execute: Unknown ScalarType\n");
+          return;
+        }
+      break;
+    case VTK_SLICE_NEAREST:
+    default:
+      switch (inData[0][0]->GetScalarType())
+        {
+        vtkTemplateMacro(
+          vtkImageLinearResliceExecute<1>(this, inData[0][0], outData[0],
+                                          (VTK_TT *)outPtr, outExt, id) );
+        default:
+          vtkErrorMacro(<< "Execute: Unknown ScalarType\n");
+          return;
+        }
+      break;
     }
 }
 
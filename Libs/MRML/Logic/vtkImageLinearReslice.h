@@ -37,6 +37,14 @@ class vtkMatrix4x4;
 /// This is based on David Gobbi's vtkImageReslice, but tries to be more
 /// efficient by only treating the special case of a linear transform
 ///
+/// The output is computed row by row: for a linear transform, the input
+/// index of the voxels of a row are incremented from the first voxel of the
+/// row, then the interpolation taps of the whole row are computed before the
+/// input values are gathered. Nearest neighbor, linear and cubic (Catmull-Rom)
+/// interpolation are supported for all the scalar types but 64-bit integers.
+/// Voxels outside of the input are set to the background color.
+/// The output extent is split among the threads.
+///
 /// \sa vtkImageReslice
 /// \sa vtkAbstractTransform
 /// \sa vtkMatrix4x4
@@ -16,6 +16,7 @@
 #include "vtkImageResliceMask.h"
 
 // VTK includes
+#include <vtkDataArray.h>
 #include <vtkDataSetAttributes.h>
 #include <vtkImageData.h>
 #include <vtkImageStencilData.h>
@@ -23,6 +24,7 @@
 #include <vtkInformationVector.h>
 #include <vtkNew.h>
 #include <vtkObjectFactory.h>
+#include <vtkPointData.h>
 #include <vtkStreamingDemandDrivenPipeline.h>
 #include <vtkTransform.h>
 
@@ -35,6 +37,8 @@
 
 // STD includes
 #include <cassert>
+#include <cstring>
+#include <vector>
 
 vtkCxxRevisionMacro(vtkImageResliceMask, "$Revision$");
 vtkStandardNewMacro(vtkImageResliceMask);
@@ -120,6 +124,7 @@ vtkImageResliceMask::vtkImageResliceMask()
   this->Border = 1; // apply a border
   this->InterpolationMode = VTK_RESLICE_NEAREST; // no interpolation
   this->Optimization = 1; // turn off when you're paranoid 
+  this->ReuseShiftedSlices = 0;
 
   // default black background
   this->BackgroundColor[0] = 0;
@@ -154,6 +159,27 @@ vtkImageResliceMask::vtkImageResliceMask()
   // set to zero when we completely missed the input extent
   this->HitInputExtent = 1;
 
+  // slices of the previous output, see ReuseShiftedSlices
+  this->RestrictSlices = 0;
+  this->SliceRange[0] = 0;
+  this->SliceRange[1] = -1;
+  this->PreviousScalars = NULL;
+  this->PreviousBackgroundMask = NULL;
+  this->PreviousInput = NULL;
+  this->PreviousInputMTime = 0;
+  for (int i = 0; i < 6; i++)
+    {
+    this->PreviousExtent[i] = 0;
+    }
+  for (int i = 0; i < 16; i++)
+    {
+    this->PreviousIndexMatrix[i] = 0.0;
+    }
+  for (int i = 0; i < 8; i++)
+    {
+    this->PreviousParameters[i] = 0.0;
+    }
+
   // There is an optional second input.
   this->SetNumberOfInputPorts(2);
   this->SetNumberOfOutputPorts(2);
@@ -177,6 +203,7 @@ vtkImageResliceMask::~vtkImageResliceMask()
     this->OptimizedTransform->Delete();
     }
   this->SetInformationInput(NULL);
+  this->ReleasePreviousSlices();
   //if( this->BackgroundMask)
   //  {
   //  this->BackgroundMask->Delete();
@@ -238,6 +265,8 @@ void vtkImageResliceMask::PrintSelf(ostream& os, vtkIndent indent)
   os << indent << "InterpolationMode: " 
      << this->GetInterpolationModeAsString() << "\n";
   os << indent << "Optimization: " << (this->Optimization ? "On\n":"Off\n");
+  os << indent << "ReuseShiftedSlices: "
+     << (this->ReuseShiftedSlices ? "On\n":"Off\n");
   os << indent << "BackgroundColor: " <<
     this->BackgroundColor[0] << " " << this->BackgroundColor[1] << " " <<
     this->BackgroundColor[2] << " " << this->BackgroundColor[3] << "\n";
@@ -1744,7 +1773,262 @@ void vtkGetResliceInterpFunc(vtkImageResliceMask *self,
     }
 }
 
+//----------------------------------------------------------------------------
+// Row interpolation: the output voxels of a row are resampled in 2 passes.
+// The taps (input offsets and weights along each axis) of all the voxels of
+// the row are computed first, then the input values are gathered and
+// weighted. The taps and the arithmetic are the same as
+// vtkTrilinearInterpolation and vtkTricubicInterpolation in the
+// VTK_RESLICE_BACKGROUND mode, the output is identical.
+template <class F>
+struct vtkResliceRowTaps
+{
+  vtkIdType Offsets[3][4];
+  F Weights[3][4];
+  // first and last non-null taps along Y and Z (cubic only)
+  int Range[2][2];
+  int Inside;
+};
+
+//----------------------------------------------------------------------------
+template <class F, class T>
+void vtkTrilinearInterpolationRow(T *&outPtr, const T *inPtr,
+                                  const int inExt[6],
+                                  const vtkIdType inInc[3],
+                                  int numscalars, const F *points, int n,
+                                  const T *background,
+                                  unsigned char *&BackgroundMaskPtr,
+                                  vtkResliceRowTaps<F> *taps)
+{
+  int inExtX = inExt[1] - inExt[0] + 1;
+  int inExtY = inExt[3] - inExt[2] + 1;
+  int inExtZ = inExt[5] - inExt[4] + 1;
+  int inExtXYZ[3] = {inExtX, inExtY, inExtZ};
+
+  for (int idX = 0; idX < n; ++idX)
+    {
+    vtkResliceRowTaps<F>& tap = taps[idX];
+    const F *point = points + 3*idX;
+    tap.Inside = 1;
+    for (int axis = 0; axis < 3; ++axis)
+      {
+      F f;
+      int inId0 = vtkResliceFloor(point[axis], f) - inExt[2*axis];
+      int inId1 = inId0 + (f != 0);
+      if (inId0 < 0 || inId1 >= inExtXYZ[axis])
+        {
+        tap.Inside = 0;
+        break;
+        }
+      tap.Offsets[axis][0] = inId0*inInc[axis];
+      tap.Offsets[axis][1] = inId1*inInc[axis];
+      tap.Weights[axis][0] = 1 - f;
+      tap.Weights[axis][1] = f;
+      }
+    }
+
+  for (int idX = 0; idX < n; ++idX)
+    {
+    const vtkResliceRowTaps<F>& tap = taps[idX];
+    if (!tap.Inside)
+      {
+      *BackgroundMaskPtr++ = (unsigned char)(0);
+      for (int c = 0; c < numscalars; ++c)
+        {
+        *outPtr++ = background[c];
+        }
+      continue;
+      }
+
+    vtkIdType i00 = tap.Offsets[1][0] + tap.Offsets[2][0];
+    vtkIdType i01 = tap.Offsets[1][0] + tap.Offsets[2][1];
+    vtkIdType i10 = tap.Offsets[1][1] + tap.Offsets[2][0];
+    vtkIdType i11 = tap.Offsets[1][1] + tap.Offsets[2][1];
+
+    F rx = tap.Weights[0][0];
+    F fx = tap.Weights[0][1];
+    F ryrz = tap.Weights[1][0]*tap.Weights[2][0];
+    F fyrz = tap.Weights[1][1]*tap.Weights[2][0];
+    F ryfz = tap.Weights[1][0]*tap.Weights[2][1];
+    F fyfz = tap.Weights[1][1]*tap.Weights[2][1];
+
+    const T *inPtr0 = inPtr + tap.Offsets[0][0];
+    const T *inPtr1 = inPtr + tap.Offsets[0][1];
+    *BackgroundMaskPtr++ = (unsigned char)(255);
+    for (int c = 0; c < numscalars; ++c)
+      {
+      F result = (rx*(ryrz*inPtr0[i00] + ryfz*inPtr0[i01] +
+                      fyrz*inPtr0[i10] + fyfz*inPtr0[i11]) +
+                  fx*(ryrz*inPtr1[i00] + ryfz*inPtr1[i01] +
+                      fyrz*inPtr1[i10] + fyfz*inPtr1[i11]));
+
+      vtkResliceRound(result, *outPtr++);
+      inPtr0++;
+      inPtr1++;
+      }
+    }
+}
+
+//----------------------------------------------------------------------------
+template <class F, class T>
+void vtkTricubicInterpolationRow(T *&outPtr, const T *inPtr,
+                                 const int inExt[6],
+                                 const vtkIdType inInc[3],
+                                 int numscalars, const F *points, int n,
+                                 const T *background,
+                                 unsigned char *&BackgroundMaskPtr,
+                                 vtkResliceRowTaps<F> *taps)
+{
+  int inExtX = inExt[1] - inExt[0] + 1;
+  int inExtY = inExt[3] - inExt[2] + 1;
+  int inExtZ = inExt[5] - inExt[4] + 1;
+  int inExtXYZ[3] = {inExtX, inExtY, inExtZ};
+
+  for (int idX = 0; idX < n; ++idX)
+    {
+    vtkResliceRowTaps<F>& tap = taps[idX];
+    const F *point = points + 3*idX;
+    tap.Inside = 1;
+    for (int axis = 0; axis < 3; ++axis)
+      {
+      F f;
+      int inId0 = vtkResliceFloor(point[axis], f) - inExt[2*axis];
+      int fIsNotZero = (f != 0);
+      if (inId0 < 0 || inId0 + fIsNotZero >= inExtXYZ[axis])
+        {
+        tap.Inside = 0;
+        break;
+        }
+      // depending on whether we are at the edge of the input extent,
+      // choose the appropriate interpolation method to use
+      int t1 = 1 - (inId0 > 0)*fIsNotZero;
+      int t2 = 1 + (1 + (inId0 + 2 < inExtXYZ[axis]))*fIsNotZero;
+      vtkTricubicInterpCoeffs(tap.Weights[axis], t1, t2, f);
+
+      vtkIdType *offsets = tap.Offsets[axis];
+      offsets[1] = inId0*inInc[axis];
+      offsets[0] = offsets[1] - inInc[axis];
+      offsets[2] = offsets[1] + inInc[axis];
+      offsets[3] = offsets[2] + inInc[axis];
+      if (axis == 0)
+        {
+        // the loop over x is unrolled, point the null taps to a valid voxel
+        if (t1 > 0)
+          {
+          offsets[0] = offsets[1];
+          }
+        if (t2 < 3)
+          {
+          offsets[3] = offsets[1];
+          if (t2 < 2)
+            {
+            offsets[2] = offsets[1];
+            }
+          }
+        }
+      else
+        {
+        tap.Range[axis - 1][0] = t1;
+        tap.Range[axis - 1][1] = t2;
+        }
+      }
+    }
+
+  for (int idX = 0; idX < n; ++idX)
+    {
+    const vtkResliceRowTaps<F>& tap = taps[idX];
+    if (!tap.Inside)
+      {
+      *BackgroundMaskPtr++ = (unsigned char)(0);
+      for (int c = 0; c < numscalars; ++c)
+        {
+        *outPtr++ = background[c];
+        }
+      continue;
+      }
+
+    const vtkIdType *factX = tap.Offsets[0];
+    const F *fX = tap.Weights[0];
+    *BackgroundMaskPtr++ = (unsigned char)(255);
+    for (int c = 0; c < numscalars; ++c)
+      {
+      F val = 0;
+      int k = tap.Range[1][0];
+      do // loop over z
+        {
+        F ifz = tap.Weights[2][k];
+        vtkIdType factz = tap.Offsets[2][k];
+        int j = tap.Range[0][0];
+        do // loop over y
+          {
+          F fzy = ifz*tap.Weights[1][j];
+          const T *tmpPtr = inPtr + c + factz + tap.Offsets[1][j];
+          val += fzy*(fX[0]*tmpPtr[factX[0]] +
+                      fX[1]*tmpPtr[factX[1]] +
+                      fX[2]*tmpPtr[factX[2]] +
+                      fX[3]*tmpPtr[factX[3]]);
+          }
+        while (++j <= tap.Range[0][1]);
+        }
+      while (++k <= tap.Range[1][1]);
+
+      vtkResliceClamp(val, *outPtr++);
+      }
+    }
+}
+
+//--------------------------------------------------------------------------
+// get the row interpolation function according to interpolation mode
+// and scalar type, or NULL if the mode has no row interpolation
+template<class F>
+void vtkGetResliceRowInterpFunc(vtkImageResliceMask *self,
+                                void (**interpolate)(void *&outPtr,
+                                                     const void *inPtr,
+                                                     const int inExt[6],
+                                                     const vtkIdType inInc[3],
+                                                     int numscalars,
+                                                     const F *points, int n,
+                                                     const void *background,
+                                                     void *&backgroundmask,
+                                                     vtkResliceRowTaps<F> *taps))
+{
+  int dataType = self->GetOutput()->GetScalarType();
+  int interpolationMode = self->GetInterpolationMode();
 
+  switch (interpolationMode)
+    {
+    case VTK_RESLICE_LINEAR:
+      switch (dataType)
+        {
+        vtkTemplateAliasMacro(*((void (**)(VTK_TT *&outPtr, const VTK_TT *inPtr,
+                                     const int inExt[6],
+                                     const vtkIdType inInc[3],
+                                     int numscalars, const F *points, int n,
+                                     const VTK_TT *background, unsigned char *&backgroundmask,
+                                     vtkResliceRowTaps<F> *taps))interpolate) = \
+                         &vtkTrilinearInterpolationRow);
+        default:
+          *interpolate = 0;
+        }
+      break;
+    case VTK_RESLICE_CUBIC:
+      switch (dataType)
+        {
+        vtkTemplateAliasMacro(*((void (**)(VTK_TT *&outPtr, const VTK_TT *inPtr,
+                                     const int inExt[6],
+                                     const vtkIdType inInc[3],
+                                     int numscalars, const F *points, int n,
+                                     const VTK_TT *background, unsigned char *&backgroundmask,
+                                     vtkResliceRowTaps<F> *taps))interpolate) = \
+                         &vtkTricubicInterpolationRow);
+        default:
+          *interpolate = 0;
+        }
+      break;
+    default:
+      *interpolate = 0;
+    }
+}
 
 //----------------------------------------------------------------------------
 // Some helper functions for 'RequestData'
@@ -2210,6 +2494,11 @@ void vtkOptimizedExecute(vtkImageResliceMask *self,
                      const int inExt[6], const vtkIdType inInc[3],
                      int numscalars, const F point[3],
                      int mode, const void *background, void *&outMask, bool flag);
+  void (*interpolateRow)(void *&outPtr, const void *inPtr,
+                         const int inExt[6], const vtkIdType inInc[3],
+                         int numscalars, const F *points, int n,
+                         const void *background, void *&outMask,
+                         vtkResliceRowTaps<F> *taps);
   void (*setpixels)(void *&out, const void *in, int numscalars, int n, void *&outMask, bool flag);
 
   int mode = VTK_RESLICE_BACKGROUND;
@@ -2285,6 +2574,17 @@ void vtkOptimizedExecute(vtkImageResliceMask *self,
   vtkGetResliceInterpFunc(self, &interpolate);
   vtkGetSetPixelsFunc(self, &setpixels);
 
+  // linear and cubic interpolation resample whole rows when the voxels out
+  // of the input are set to the background
+  interpolateRow = 0;
+  if (mode == VTK_RESLICE_BACKGROUND && !optimizeNearest)
+    {
+    vtkGetResliceRowInterpFunc(self, &interpolateRow);
+    }
+  int rowLength = outExt[1] - outExt[0] + 1;
+  std::vector<F> rowPoints(interpolateRow ? 3*rowLength : 0);
+  std::vector<vtkResliceRowTaps<F> > rowTaps(interpolateRow ? rowLength : 0);
+
   // get the stencil
   vtkImageStencilData *stencil = self->GetStencil();
 
@@ -2318,7 +2618,36 @@ void vtkOptimizedExecute(vtkImageResliceMask *self,
                                      outPtr, background, numscalars, 
                                      setpixels, iter, BackgroundMaskPtr, false))
         {
-        if (!optimizeNearest)
+        if (interpolateRow)
+          {
+          // the input points of the row, then the row interpolation
+          F *point = &rowPoints[0];
+          for (idX = idXmin; idX <= idXmax; idX++, point += 3)
+            {
+            point[0] = inPoint1[0] + idX*xAxis[0];
+            point[1] = inPoint1[1] + idX*xAxis[1];
+            point[2] = inPoint1[2] + idX*xAxis[2];
+            if (perspective)
+              {
+              f = 1/(inPoint1[3] + idX*xAxis[3]);
+              point[0] *= f;
+              point[1] *= f;
+              point[2] *= f;
+              }
+            if (newtrans)
+              {
+              vtkResliceApplyTransform(newtrans, point, inOrigin,
+                                       inInvSpacing);
+              }
+            }
+          if (idXmax >= idXmin)
+            {
+            interpolateRow(outPtr, inPtr, inExt, inInc, numscalars,
+                           &rowPoints[0], idXmax - idXmin + 1, background,
+                           BackgroundMaskPtr, &rowTaps[0]);
+            }
+          }
+        else if (!optimizeNearest)
           {
           for (idX = idXmin; idX <= idXmax; idX++)
             {
@@ -3353,6 +3682,231 @@ vtkMatrix4x4 *vtkImageResliceMask::GetIndexMatrix(vtkInformation *inInfo,
   return this->IndexMatrix;
 }
 
+//----------------------------------------------------------------------------
+// Reuse the slices of the previous output when the output only moved by a
+// whole number of slices along its z axis: the new slices are resliced by
+// the threads (see SplitExtent), the other ones are copied.
+int vtkImageResliceMask::RequestData(vtkInformation *request,
+                                     vtkInformationVector **inputVector,
+                                     vtkInformationVector *outputVector)
+{
+  if (!this->ReuseShiftedSlices)
+    {
+    this->ReleasePreviousSlices();
+    return this->Superclass::RequestData(request, inputVector, outputVector);
+    }
+
+  vtkImageData *input = vtkImageData::SafeDownCast(
+    inputVector[0]->GetInformationObject(0)->Get(vtkDataObject::DATA_OBJECT()));
+  vtkInformation *outInfo = outputVector->GetInformationObject(0);
+  int outExt[6];
+  outInfo->Get(vtkStreamingDemandDrivenPipeline::UPDATE_EXTENT(), outExt);
+  int numberOfSlices = outExt[5] - outExt[4] + 1;
+
+  int shift = this->GetSliceShift(input, outputVector);
+  if (shift > 0)
+    {
+    this->SliceRange[0] = outExt[5] - shift + 1;
+    this->SliceRange[1] = outExt[5];
+    }
+  else if (shift < 0)
+    {
+    this->SliceRange[0] = outExt[4];
+    this->SliceRange[1] = outExt[4] - shift - 1;
+    }
+  this->RestrictSlices = (shift != 0);
+  int res = this->Superclass::RequestData(request, inputVector, outputVector);
+  this->RestrictSlices = 0;
+
+  vtkImageData *output = vtkImageData::SafeDownCast(
+    outInfo->Get(vtkDataObject::DATA_OBJECT()));
+  vtkImageData *backgroundMask = vtkImageData::SafeDownCast(
+    outputVector->GetInformationObject(1)->Get(vtkDataObject::DATA_OBJECT()));
+  vtkDataArray *scalars = output->GetPointData()->GetScalars();
+  vtkDataArray *maskScalars = backgroundMask->GetPointData()->GetScalars();
+  if (shift != 0)
+    {
+    int reusedSlices = numberOfSlices - (shift > 0 ? shift : -shift);
+    vtkDataArray *arrays[2] = {scalars, maskScalars};
+    vtkDataArray *previousArrays[2] =
+      {this->PreviousScalars, this->PreviousBackgroundMask};
+    for (int i = 0; i < 2; i++)
+      {
+      // slices are contiguous: slice z of the output is slice z + shift
+      // of the previous output
+      size_t sliceSize = static_cast<size_t>(
+        previousArrays[i]->GetNumberOfTuples() / numberOfSlices) *
+        previousArrays[i]->GetNumberOfComponents() *
+        previousArrays[i]->GetDataTypeSize();
+      char *outPtr = static_cast<char*>(arrays[i]->GetVoidPointer(0));
+      char *previousPtr =
+        static_cast<char*>(previousArrays[i]->GetVoidPointer(0));
+      if (shift > 0)
+        {
+        previousPtr += shift * sliceSize;
+        }
+      else
+        {
+        outPtr += -shift * sliceSize;
+        }
+      memmove(outPtr, previousPtr, reusedSlices * sliceSize);
+      }
+    }
+
+  // keep the output for the next execution
+  this->ReleasePreviousSlices();
+  if (numberOfSlices > 1 && this->OptimizedTransform == NULL &&
+      this->HitInputExtent && this->GetNumberOfInputConnections(1) == 0 &&
+      scalars && maskScalars)
+    {
+    this->PreviousScalars = scalars;
+    this->PreviousScalars->Register(this);
+    this->PreviousBackgroundMask = maskScalars;
+    this->PreviousBackgroundMask->Register(this);
+    this->PreviousInput = input;
+    this->PreviousInputMTime = input->GetMTime();
+    memcpy(this->PreviousExtent, outExt, sizeof(int) * 6);
+    memcpy(this->PreviousIndexMatrix, *this->IndexMatrix->Element,
+           sizeof(double) * 16);
+    this->GetReuseParameters(this->PreviousParameters);
+    }
+  return res;
+}
+
+//----------------------------------------------------------------------------
+int vtkImageResliceMask::GetSliceShift(vtkImageData *input,
+                                       vtkInformationVector *outputVector)
+{
+  if (!this->PreviousScalars || !this->PreviousBackgroundMask || !input ||
+      this->OptimizedTransform != NULL || !this->HitInputExtent ||
+      this->GetNumberOfInputConnections(1) > 0 ||
+      input != this->PreviousInput ||
+      input->GetMTime() != this->PreviousInputMTime)
+    {
+    return 0;
+    }
+  vtkDataArray *inScalars = input->GetPointData()->GetScalars();
+  if (!inScalars ||
+      inScalars->GetDataType() != this->PreviousScalars->GetDataType() ||
+      inScalars->GetNumberOfComponents() !=
+        this->PreviousScalars->GetNumberOfComponents())
+    {
+    return 0;
+    }
+  // both outputs must have the extent of the previous output
+  for (int port = 0; port < 2; port++)
+    {
+    int outExt[6];
+    outputVector->GetInformationObject(port)->Get(
+      vtkStreamingDemandDrivenPipeline::UPDATE_EXTENT(), outExt);
+    for (int i = 0; i < 6; i++)
+      {
+      if (outExt[i] != this->PreviousExtent[i])
+        {
+        return 0;
+        }
+      }
+    }
+  double parameters[8];
+  this->GetReuseParameters(parameters);
+  for (int i = 0; i < 8; i++)
+    {
+    if (parameters[i] != this->PreviousParameters[i])
+      {
+      return 0;
+      }
+    }
+
+  // the axes must be the same, only the translation can change
+  const double tolerance = 1e-5;
+  double (*matrix)[4] = this->IndexMatrix->Element;
+  const double *previousMatrix = this->PreviousIndexMatrix;
+  for (int i = 0; i < 4; i++)
+    {
+    for (int j = 0; j < 4; j++)
+      {
+      if ((i == 3 || j < 3) &&
+          fabs(matrix[i][j] - previousMatrix[4*i + j]) > tolerance)
+        {
+        return 0;
+        }
+      }
+    }
+  // the translation must be a whole number of z axis
+  double zAxis[3] = {matrix[0][2], matrix[1][2], matrix[2][2]};
+  double translation[3];
+  double norm2 = 0.;
+  double dot = 0.;
+  for (int i = 0; i < 3; i++)
+    {
+    translation[i] = matrix[i][3] - previousMatrix[4*i + 3];
+    norm2 += zAxis[i] * zAxis[i];
+    dot += zAxis[i] * translation[i];
+    }
+  if (norm2 == 0.)
+    {
+    return 0;
+    }
+  int shift = vtkResliceRound(dot / norm2);
+  for (int i = 0; i < 3; i++)
+    {
+    if (fabs(translation[i] - shift * zAxis[i]) > tolerance)
+      {
+      return 0;
+      }
+    }
+  int numberOfSlices = this->PreviousExtent[5] - this->PreviousExtent[4] + 1;
+  if (shift >= numberOfSlices || -shift >= numberOfSlices)
+    {
+    return 0;
+    }
+  return shift;
+}
+
+//----------------------------------------------------------------------------
+void vtkImageResliceMask::GetReuseParameters(double parameters[8])
+{
+  parameters[0] = this->InterpolationMode;
+  parameters[1] = this->Wrap;
+  parameters[2] = this->Mirror;
+  parameters[3] = this->Border;
+  parameters[4] = this->BackgroundColor[0];
+  parameters[5] = this->BackgroundColor[1];
+  parameters[6] = this->BackgroundColor[2];
+  parameters[7] = this->BackgroundColor[3];
+}
+
+//----------------------------------------------------------------------------
+void vtkImageResliceMask::ReleasePreviousSlices()
+{
+  if (this->PreviousScalars)
+    {
+    this->PreviousScalars->UnRegister(this);
+    this->PreviousScalars = NULL;
+    }
+  if (this->PreviousBackgroundMask)
+    {
+    this->PreviousBackgroundMask->UnRegister(this);
+    this->PreviousBackgroundMask = NULL;
+    }
+  this->PreviousInput = NULL;
+}
+
+//----------------------------------------------------------------------------
+int vtkImageResliceMask::SplitExtent(int splitExt[6], int startExt[6],
+                                     int num, int total)
+{
+  if (!this->RestrictSlices)
+    {
+    return this->Superclass::SplitExtent(splitExt, startExt, num, total);
+    }
+  int ext[6];
+  memcpy(ext, startExt, sizeof(int) * 6);
+  ext[4] = std::max(ext[4], this->SliceRange[0]);
+  ext[5] = std::min(ext[5], this->SliceRange[1]);
+  return this->Superclass::SplitExtent(splitExt, ext, num, total);
+}
+
 //----------------------------------------------------------------------------
 // This method is passed a input and output region, and executes the filter
 // algorithm to fill the output from the input.
@@ -22,6 +22,7 @@
 #include <vtkImageReslice.h> // for VTK_RESLICE_NEAREST, LINEAR, CUBIC
 #include <vtkThreadedImageAlgorithm.h>
 class vtkAbstractTransform;
+class vtkDataArray;
 class vtkImageData;
 class vtkImageStencilData;
 class vtkMatrix4x4;
@@ -213,6 +214,17 @@ public:
   vtkGetMacro(Optimization, int);
   vtkBooleanMacro(Optimization, int);
 
+  /// 
+  /// Reuse the slices of the previous output when the output has only been
+  /// moved by a whole number of slices along its z axis, e.g. when a
+  /// lightbox is scrolled: only the new slices are resliced, the others are
+  /// copied. It requires a linear transform and no stencil, and a copy of
+  /// the previous output is kept if it has more than one slice.
+  /// Default is off.
+  vtkSetMacro(ReuseShiftedSlices, int);
+  vtkGetMacro(ReuseShiftedSlices, int);
+  vtkBooleanMacro(ReuseShiftedSlices, int);
+
   /// 
   /// Set the background color (for multi-component images).
   vtkSetVector4Macro(BackgroundColor, double);
@@ -293,6 +305,13 @@ public:
   vtkImageStencilData *GetStencil();
 
   vtkImageData *GetBackgroundMask();
+
+  /// 
+  /// Reimplemented to only split the slices that are resliced when the
+  /// previous output is reused.
+  /// \sa SetReuseShiftedSlices()
+  virtual int SplitExtent(int splitExt[6], int startExt[6],
+                          int num, int total);
 protected:
   vtkImageResliceMask();
   ~vtkImageResliceMask();
@@ -307,6 +326,7 @@ protected:
   int Border;
   int InterpolationMode;
   int Optimization;
+  int ReuseShiftedSlices;
   double BackgroundColor[4];
   double OutputOrigin[3];
   double OutputSpacing[3];
@@ -326,6 +346,8 @@ protected:
                                  vtkInformationVector *);
   virtual int RequestUpdateExtent(vtkInformation *, vtkInformationVector **,
                                   vtkInformationVector *);
+  virtual int RequestData(vtkInformation *, vtkInformationVector **,
+                          vtkInformationVector *);
   virtual void ThreadedRequestData(vtkInformation *request,
                                    vtkInformationVector **inputVector,
                                    vtkInformationVector *outputVector,
@@ -338,6 +360,25 @@ protected:
   vtkAbstractTransform *GetOptimizedTransform() { 
     return this->OptimizedTransform; };
 
+  /// Return the number of slices the output moved along its z axis since
+  /// the previous execution: slice z of the new output is slice z + shift
+  /// of the previous output. Return 0 if the previous output can't be reused.
+  int GetSliceShift(vtkImageData *input, vtkInformationVector *outputVector);
+  void GetReuseParameters(double parameters[8]);
+  void ReleasePreviousSlices();
+
+  /// Range of slices to reslice if RestrictSlices is set
+  int RestrictSlices;
+  int SliceRange[2];
+  /// State of the previous execution
+  vtkDataArray *PreviousScalars;
+  vtkDataArray *PreviousBackgroundMask;
+  vtkImageData *PreviousInput;
+  unsigned long PreviousInputMTime;
+  int PreviousExtent[6];
+  double PreviousIndexMatrix[16];
+  double PreviousParameters[8];
+
 private:
   vtkImageResliceMask(const vtkImageResliceMask&);  /// Not implemented.
   void operator=(const vtkImageResliceMask&);  /// Not implemented.
@@ -0,0 +1,536 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+#include "vtkImageSliceCompositor.h"
+
+// VTK includes
+#include <vtkDataArray.h>
+#include <vtkImageData.h>
+#include <vtkImageMapToColors.h>
+#include <vtkImageMapToWindowLevelColors.h>
+#include <vtkImageThreshold.h>
+#include <vtkInformation.h>
+#include <vtkInformationVector.h>
+#include <vtkNew.h>
+#include <vtkObjectFactory.h>
+#include <vtkPointData.h>
+#include <vtkScalarsToColors.h>
+#include <vtkSmartPointer.h>
+#include <vtkStreamingDemandDrivenPipeline.h>
+#include <vtkTimeStamp.h>
+
+// STD includes
+#include <vector>
+
+//----------------------------------------------------------------------------
+class vtkImageSliceCompositorInternals
+{
+public:
+  struct Layer
+  {
+    enum MappingType
+    {
+      NoMapping = 0,
+      WindowLevelMapping,
+      LookupTableMapping
+    };
+
+    Layer()
+      : Mapping(NoMapping)
+      , Window(256.)
+      , Level(128.)
+      , LowerThreshold(0.)
+      , UpperThreshold(0.)
+      , ApplyThreshold(0)
+      , Opacity(1.)
+      , ColorTableScalarType(-1)
+      , ColorTableMinimum(0)
+    {
+    }
+
+    MappingType Mapping;
+    double Window;
+    double Level;
+    double LowerThreshold;
+    double UpperThreshold;
+    int ApplyThreshold;
+    vtkSmartPointer<vtkScalarsToColors> LookupTable;
+    double Opacity;
+    /// Modified when the mapping parameters change
+    vtkTimeStamp MappingTime;
+
+    /// RGBA of each value of the scalar type, computed by UpdateColorTable()
+    std::vector<unsigned char> ColorTable;
+    int ColorTableScalarType;
+    int ColorTableMinimum;
+    vtkTimeStamp ColorTableTime;
+  };
+
+  std::vector<Layer> Layers;
+};
+
+//----------------------------------------------------------------------------
+vtkCxxRevisionMacro(vtkImageSliceCompositor, "$Revision$");
+vtkStandardNewMacro(vtkImageSliceCompositor);
+
+//----------------------------------------------------------------------------
+vtkImageSliceCompositor::vtkImageSliceCompositor()
+{
+  this->Internals = new vtkImageSliceCompositorInternals;
+  // layer scalars and background masks
+  this->SetNumberOfInputPorts(2);
+}
+
+//----------------------------------------------------------------------------
+vtkImageSliceCompositor::~vtkImageSliceCompositor()
+{
+  delete this->Internals;
+}
+
+//----------------------------------------------------------------------------
+void vtkImageSliceCompositor::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+  os << indent << "NumberOfLayers: " << this->GetNumberOfLayers() << "\n";
+  for (int layer = 0; layer < this->GetNumberOfLayers(); ++layer)
+    {
+    const vtkImageSliceCompositorInternals::Layer& l =
+      this->Internals->Layers[layer];
+    os << indent << "Layer " << layer << ":\n";
+    os << indent.GetNextIndent() << "Mapping: "
+       << (l.Mapping == vtkImageSliceCompositorInternals::Layer::WindowLevelMapping ?
+           "WindowLevel" :
+           (l.Mapping == vtkImageSliceCompositorInternals::Layer::LookupTableMapping ?
+            "LookupTable" : "None")) << "\n";
+    os << indent.GetNextIndent() << "Window: " << l.Window << "\n";
+    os << indent.GetNextIndent() << "Level: " << l.Level << "\n";
+    os << indent.GetNextIndent() << "Threshold: " << l.LowerThreshold << " "
+       << l.UpperThreshold << (l.ApplyThreshold ? " (applied)" : "") << "\n";
+    os << indent.GetNextIndent() << "Opacity: " << l.Opacity << "\n";
+    }
+}
+
+//----------------------------------------------------------------------------
+void vtkImageSliceCompositor::SetNumberOfLayers(int number)
+{
+  if (number < 0 || number == this->GetNumberOfLayers())
+    {
+    return;
+    }
+  this->SetNumberOfInputConnections(0, number);
+  this->SetNumberOfInputConnections(1, number);
+  this->Internals->Layers.resize(number);
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+int vtkImageSliceCompositor::GetNumberOfLayers()
+{
+  return static_cast<int>(this->Internals->Layers.size());
+}
+
+//----------------------------------------------------------------------------
+void vtkImageSliceCompositor::SetLayerInput(int layer, vtkImageData* scalars,
+                                            vtkImageData* mask)
+{
+  if (layer < 0 || layer >= this->GetNumberOfLayers())
+    {
+    vtkErrorMacro("SetLayerInput: invalid layer " << layer);
+    return;
+    }
+  this->SetNthInputConnection(0, layer, scalars ? scalars->GetProducerPort() : 0);
+  this->SetNthInputConnection(1, layer, mask ? mask->GetProducerPort() : 0);
+}
+
+//----------------------------------------------------------------------------
+void vtkImageSliceCompositor::SetLayerWindowLevelMapping(
+  int layer, double window, double level,
+  double lowerThreshold, double upperThreshold, int applyThreshold,
+  vtkScalarsToColors* lut)
+{
+  if (layer < 0 || layer >= this->GetNumberOfLayers())
+    {
+    vtkErrorMacro("SetLayerWindowLevelMapping: invalid layer " << layer);
+    return;
+    }
+  vtkImageSliceCompositorInternals::Layer& l = this->Internals->Layers[layer];
+  if (l.Mapping == vtkImageSliceCompositorInternals::Layer::WindowLevelMapping &&
+      l.Window == window && l.Level == level &&
+      l.LowerThreshold == lowerThreshold &&
+      l.UpperThreshold == upperThreshold &&
+      l.ApplyThreshold == applyThreshold &&
+      l.LookupTable == lut)
+    {
+    return;
+    }
+  l.Mapping = vtkImageSliceCompositorInternals::Layer::WindowLevelMapping;
+  l.Window = window;
+  l.Level = level;
+  l.LowerThreshold = lowerThreshold;
+  l.UpperThreshold = upperThreshold;
+  l.ApplyThreshold = applyThreshold;
+  l.LookupTable = lut;
+  l.MappingTime.Modified();
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+void vtkImageSliceCompositor::SetLayerLookupTableMapping(int layer,
+                                                         vtkScalarsToColors* lut)
+{
+  if (layer < 0 || layer >= this->GetNumberOfLayers())
+    {
+    vtkErrorMacro("SetLayerLookupTableMapping: invalid layer " << layer);
+    return;
+    }
+  vtkImageSliceCompositorInternals::Layer& l = this->Internals->Layers[layer];
+  if (l.Mapping == vtkImageSliceCompositorInternals::Layer::LookupTableMapping &&
+      l.LookupTable == lut)
+    {
+    return;
+    }
+  l.Mapping = vtkImageSliceCompositorInternals::Layer::LookupTableMapping;
+  l.LookupTable = lut;
+  l.MappingTime.Modified();
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+void vtkImageSliceCompositor::SetLayerOpacity(int layer, double opacity)
+{
+  if (layer < 0 || layer >= this->GetNumberOfLayers())
+    {
+    vtkErrorMacro("SetLayerOpacity: invalid layer " << layer);
+    return;
+    }
+  opacity = (opacity < 0. ? 0. : (opacity > 1. ? 1. : opacity));
+  if (this->Internals->Layers[layer].Opacity == opacity)
+    {
+    return;
+    }
+  this->Internals->Layers[layer].Opacity = opacity;
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+double vtkImageSliceCompositor::GetLayerOpacity(int layer)
+{
+  if (layer < 0 || layer >= this->GetNumberOfLayers())
+    {
+    vtkErrorMacro("GetLayerOpacity: invalid layer " << layer);
+    return 0.;
+    }
+  return this->Internals->Layers[layer].Opacity;
+}
+
+//----------------------------------------------------------------------------
+bool vtkImageSliceCompositor::IsScalarTypeSupported(int scalarType)
+{
+  switch (scalarType)
+    {
+    case VTK_CHAR:
+    case VTK_SIGNED_CHAR:
+    case VTK_UNSIGNED_CHAR:
+    case VTK_SHORT:
+    case VTK_UNSIGNED_SHORT:
+      return true;
+    default:
+      return false;
+    }
+}
+
+//----------------------------------------------------------------------------
+unsigned long vtkImageSliceCompositor::GetMTime()
+{
+  unsigned long mTime = this->Superclass::GetMTime();
+  std::vector<vtkImageSliceCompositorInternals::Layer>::const_iterator it;
+  for (it = this->Internals->Layers.begin();
+       it != this->Internals->Layers.end(); ++it)
+    {
+    if (it->LookupTable && it->LookupTable->GetMTime() > mTime)
+      {
+      mTime = it->LookupTable->GetMTime();
+      }
+    }
+  return mTime;
+}
+
+//----------------------------------------------------------------------------
+int vtkImageSliceCompositor::FillInputPortInformation(int port,
+                                                      vtkInformation* info)
+{
+  info->Set(vtkAlgorithm::INPUT_REQUIRED_DATA_TYPE(), "vtkImageData");
+  info->Set(vtkAlgorithm::INPUT_IS_REPEATABLE(), 1);
+  if (port == 1)
+    {
+    info->Set(vtkAlgorithm::INPUT_IS_OPTIONAL(), 1);
+    }
+  return 1;
+}
+
+//----------------------------------------------------------------------------
+int vtkImageSliceCompositor::RequestInformation(
+  vtkInformation* vtkNotUsed(request),
+  vtkInformationVector** vtkNotUsed(inputVector),
+  vtkInformationVector* outputVector)
+{
+  // the extent, spacing and origin are the ones of the first layer
+  vtkInformation* outInfo = outputVector->GetInformationObject(0);
+  vtkDataObject::SetPointDataActiveScalarInfo(outInfo, VTK_UNSIGNED_CHAR, 4);
+  return 1;
+}
+
+//----------------------------------------------------------------------------
+bool vtkImageSliceCompositor::UpdateColorTable(int layer, int scalarType)
+{
+  vtkImageSliceCompositorInternals::Layer& l = this->Internals->Layers[layer];
+  if (l.Mapping == vtkImageSliceCompositorInternals::Layer::NoMapping ||
+      l.LookupTable.GetPointer() == 0 ||
+      !vtkImageSliceCompositor::IsScalarTypeSupported(scalarType))
+    {
+    return false;
+    }
+  if (l.ColorTableScalarType == scalarType &&
+      l.ColorTableTime > l.MappingTime &&
+      l.ColorTableTime > l.LookupTable->GetMTime())
+    {
+    return true;
+    }
+
+  // Image with all the values of the scalar type, mapped by the same filters
+  // as the display nodes.
+  vtkNew<vtkImageData> values;
+  values->SetScalarType(scalarType);
+  int minimum = static_cast<int>(values->GetScalarTypeMin());
+  int count = static_cast<int>(values->GetScalarTypeMax()) - minimum + 1;
+  values->SetDimensions(count, 1, 1);
+  values->SetNumberOfScalarComponents(1);
+  values->AllocateScalars();
+  vtkDataArray* valueArray = values->GetPointData()->GetScalars();
+  for (int i = 0; i < count; ++i)
+    {
+    valueArray->SetComponent(i, 0, minimum + i);
+    }
+
+  vtkNew<vtkImageMapToColors> mapToColors;
+  mapToColors->SetOutputFormatToRGBA();
+  mapToColors->SetLookupTable(l.LookupTable);
+  vtkNew<vtkImageMapToWindowLevelColors> mapToWindowLevelColors;
+  vtkNew<vtkImageThreshold> threshold;
+  bool windowLevel =
+    (l.Mapping == vtkImageSliceCompositorInternals::Layer::WindowLevelMapping);
+  if (windowLevel)
+    {
+    // see vtkMRMLScalarVolumeDisplayNode
+    mapToWindowLevelColors->SetOutputFormatToLuminance();
+    mapToWindowLevelColors->SetWindow(l.Window);
+    mapToWindowLevelColors->SetLevel(l.Level);
+    mapToWindowLevelColors->SetInput(values.GetPointer());
+    mapToColors->SetInputConnection(mapToWindowLevelColors->GetOutputPort());
+
+    threshold->ReplaceInOn();
+    threshold->SetInValue(255);
+    threshold->ReplaceOutOn();
+    threshold->SetOutValue(l.ApplyThreshold ? 0 : 255);
+    threshold->SetOutputScalarTypeToUnsignedChar();
+    threshold->ThresholdBetween(l.LowerThreshold, l.UpperThreshold);
+    threshold->SetInput(values.GetPointer());
+    threshold->Update();
+    }
+  else
+    {
+    // see vtkMRMLLabelMapVolumeDisplayNode
+    mapToColors->SetInput(values.GetPointer());
+    }
+  mapToColors->Update();
+
+  vtkImageData* colors = mapToColors->GetOutput();
+  if (colors->GetNumberOfScalarComponents() != 4 ||
+      colors->GetScalarType() != VTK_UNSIGNED_CHAR)
+    {
+    vtkErrorMacro("UpdateColorTable: failed to map the colors of layer " << layer);
+    return false;
+    }
+  const unsigned char* colorPtr =
+    static_cast<unsigned char*>(colors->GetScalarPointer());
+  const unsigned char* thresholdPtr = windowLevel ?
+    static_cast<unsigned char*>(threshold->GetOutput()->GetScalarPointer()) : 0;
+  l.ColorTable.resize(4 * count);
+  for (int i = 0; i < count; ++i)
+    {
+    l.ColorTable[4 * i] = colorPtr[4 * i];
+    l.ColorTable[4 * i + 1] = colorPtr[4 * i + 1];
+    l.ColorTable[4 * i + 2] = colorPtr[4 * i + 2];
+    // out of the threshold, the alpha is cleared
+    l.ColorTable[4 * i + 3] =
+      (thresholdPtr && thresholdPtr[i] == 0) ? 0 : colorPtr[4 * i + 3];
+    }
+  l.ColorTableScalarType = scalarType;
+  l.ColorTableMinimum = minimum;
+  l.ColorTableTime.Modified();
+  return true;
+}
+
+//----------------------------------------------------------------------------
+int vtkImageSliceCompositor::RequestData(vtkInformation* request,
+                                         vtkInformationVector** inputVector,
+                                         vtkInformationVector* outputVector)
+{
+  // The color tables are computed before the threads are spawned
+  int numberOfLayers = inputVector[0]->GetNumberOfInformationObjects();
+  if (numberOfLayers > this->GetNumberOfLayers())
+    {
+    numberOfLayers = this->GetNumberOfLayers();
+    }
+  for (int layer = 0; layer < numberOfLayers; ++layer)
+    {
+    vtkImageData* scalars = vtkImageData::GetData(inputVector[0], layer);
+    if (!scalars ||
+        scalars->GetNumberOfScalarComponents() != 1 ||
+        !this->UpdateColorTable(layer, scalars->GetScalarType()))
+      {
+      vtkErrorMacro("RequestData: layer " << layer << " can't be composited");
+      return 0;
+      }
+    }
+  return this->Superclass::RequestData(request, inputVector, outputVector);
+}
+
+//----------------------------------------------------------------------------
+// Map a row of scalars to RGBA and blend it into the output row.
+// The blending is the one of vtkImageBlend for unsigned char RGBA images.
+template <class T>
+void vtkImageSliceCompositorRow(const T* inPtr, const unsigned char* maskPtr,
+                                int count, const unsigned char* colorTable,
+                                int minimum, bool windowLevel, bool first,
+                                double opacity, unsigned char* outPtr)
+{
+  // opacity in the range [0,256], see vtkImageBlend
+  unsigned short o = static_cast<unsigned short>(256 * opacity);
+  for (int idX = 0; idX < count; ++idX, outPtr += 4)
+    {
+    const unsigned char* rgba = colorTable + 4 * (static_cast<int>(inPtr[idX]) - minimum);
+    unsigned char alpha = rgba[3];
+    if (windowLevel)
+      {
+      // see the alpha logic of vtkMRMLScalarVolumeDisplayNode: the alpha is
+      // multiplied by the background mask (as unsigned char) then binarized
+      unsigned char mask = maskPtr ? maskPtr[idX] : 255;
+      alpha = static_cast<unsigned char>(alpha * mask) ? 255 : 0;
+      }
+    if (first)
+      {
+      outPtr[0] = rgba[0];
+      outPtr[1] = rgba[1];
+      outPtr[2] = rgba[2];
+      outPtr[3] = alpha;
+      continue;
+      }
+    // multiply to get a number in the range [0,65280]
+    unsigned short r = alpha * o;
+    unsigned short f = 65280 - r;
+    outPtr[0] = (outPtr[0] * f + rgba[0] * r) >> 16;
+    outPtr[1] = (outPtr[1] * f + rgba[1] * r) >> 16;
+    outPtr[2] = (outPtr[2] * f + rgba[2] * r) >> 16;
+    }
+}
+
+//----------------------------------------------------------------------------
+void vtkImageSliceCompositor::ThreadedRequestData(
+  vtkInformation* vtkNotUsed(request),
+  vtkInformationVector** inputVector,
+  vtkInformationVector* vtkNotUsed(outputVector),
+  vtkImageData*** inData, vtkImageData** outData,
+  int outExt[6], int vtkNotUsed(threadId))
+{
+  int numberOfLayers = inputVector[0]->GetNumberOfInformationObjects();
+  if (numberOfLayers > this->GetNumberOfLayers())
+    {
+    numberOfLayers = this->GetNumberOfLayers();
+    }
+  int numberOfMasks = inputVector[1]->GetNumberOfInformationObjects();
+  int rowLength = outExt[1] - outExt[0] + 1;
+
+  vtkIdType outIncX, outIncY, outIncZ;
+  outData[0]->GetContinuousIncrements(outExt, outIncX, outIncY, outIncZ);
+  unsigned char* outPtr =
+    static_cast<unsigned char*>(outData[0]->GetScalarPointerForExtent(outExt));
+
+  // pointers and increments of the layer inputs
+  std::vector<unsigned char*> inPtrs(numberOfLayers);
+  std::vector<vtkIdType> inIncYs(numberOfLayers);
+  std::vector<vtkIdType> inIncZs(numberOfLayers);
+  std::vector<unsigned char*> maskPtrs(numberOfLayers);
+  std::vector<vtkIdType> maskIncYs(numberOfLayers);
+  std::vector<vtkIdType> maskIncZs(numberOfLayers);
+  for (int layer = 0; layer < numberOfLayers; ++layer)
+    {
+    vtkIdType incX;
+    vtkImageData* scalars = inData[0][layer];
+    scalars->GetContinuousIncrements(outExt, incX, inIncYs[layer], inIncZs[layer]);
+    inPtrs[layer] = static_cast<unsigned char*>(
+      scalars->GetScalarPointerForExtent(outExt));
+    inIncYs[layer] *= scalars->GetScalarSize();
+    inIncZs[layer] *= scalars->GetScalarSize();
+
+    vtkImageData* mask = layer < numberOfMasks ? inData[1][layer] : 0;
+    maskPtrs[layer] = 0;
+    maskIncYs[layer] = maskIncZs[layer] = 0;
+    if (mask && mask->GetScalarType() == VTK_UNSIGNED_CHAR &&
+        mask->GetNumberOfScalarComponents() == 1)
+      {
+      mask->GetContinuousIncrements(outExt, incX, maskIncYs[layer], maskIncZs[layer]);
+      maskPtrs[layer] = static_cast<unsigned char*>(
+        mask->GetScalarPointerForExtent(outExt));
+      }
+    }
+
+  for (int idZ = outExt[4]; idZ <= outExt[5]; ++idZ)
+    {
+    for (int idY = outExt[2]; idY <= outExt[3]; ++idY)
+      {
+      for (int layer = 0; layer < numberOfLayers; ++layer)
+        {
+        const vtkImageSliceCompositorInternals::Layer& l =
+          this->Internals->Layers[layer];
+        bool windowLevel =
+          (l.Mapping == vtkImageSliceCompositorInternals::Layer::WindowLevelMapping);
+        switch (inData[0][layer]->GetScalarType())
+          {
+          vtkTemplateMacro(
+            vtkImageSliceCompositorRow(
+              reinterpret_cast<VTK_TT*>(inPtrs[layer]), maskPtrs[layer],
+              rowLength, &l.ColorTable[0], l.ColorTableMinimum,
+              windowLevel, layer == 0, l.Opacity, outPtr));
+          }
+        inPtrs[layer] += rowLength * inData[0][layer]->GetScalarSize() + inIncYs[layer];
+        if (maskPtrs[layer])
+          {
+          maskPtrs[layer] += rowLength + maskIncYs[layer];
+          }
+        }
+      outPtr += 4 * rowLength + outIncY;
+      }
+    for (int layer = 0; layer < numberOfLayers; ++layer)
+      {
+      inPtrs[layer] += inIncZs[layer];
+      if (maskPtrs[layer])
+        {
+        maskPtrs[layer] += maskIncZs[layer];
+        }
+      }
+    outPtr += outIncZ;
+    }
+}
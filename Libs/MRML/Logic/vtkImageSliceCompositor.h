@@ -0,0 +1,109 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+#ifndef __vtkImageSliceCompositor_h
+#define __vtkImageSliceCompositor_h
+
+// VTK includes
+#include <vtkThreadedImageAlgorithm.h>
+
+#include "vtkMRMLLogicWin32Header.h"
+
+class vtkImageData;
+class vtkScalarsToColors;
+class vtkImageSliceCompositorInternals;
+
+/// \brief Map and blend the resliced layers of a slice view in a single pass.
+///
+/// The regular slice pipeline maps each layer to RGBA with the pipeline of
+/// its display node (vtkImageMapToWindowLevelColors, vtkImageMapToColors,
+/// vtkImageThreshold...) then blends the RGBA images with vtkImageBlend.
+/// Each stage writes a full intermediate image.
+/// vtkImageSliceCompositor computes the final RGBA image in one pass over
+/// the output pixels: each layer is mapped through a color table that is
+/// computed once by running the same VTK filters on all the values of the
+/// scalar type, then the layers are blended like vtkImageBlend does.
+///
+/// Layers are blended in order, the opacity of the first layer is ignored.
+/// Only single component images of 8 or 16 bit integer types are supported.
+/// All the layers must have the same extent.
+/// \sa vtkMRMLSliceLogic::SetFusedCompositing()
+class VTK_MRML_LOGIC_EXPORT vtkImageSliceCompositor
+  : public vtkThreadedImageAlgorithm
+{
+public:
+  static vtkImageSliceCompositor *New();
+  vtkTypeRevisionMacro(vtkImageSliceCompositor, vtkThreadedImageAlgorithm);
+  virtual void PrintSelf(ostream& os, vtkIndent indent);
+
+  /// Set the number of layers to composite. Existing layers are kept.
+  void SetNumberOfLayers(int number);
+  int GetNumberOfLayers();
+
+  /// Set the resliced scalars of a layer and its background mask
+  /// (e.g. vtkImageResliceMask::GetBackgroundMask()).
+  void SetLayerInput(int layer, vtkImageData* scalars, vtkImageData* mask);
+
+  /// Map the scalars of a layer like vtkMRMLScalarVolumeDisplayNode:
+  /// window/level, then lookup table. The alpha is 0 out of the threshold
+  /// range (if \a applyThreshold) and where the background mask is 0.
+  void SetLayerWindowLevelMapping(int layer, double window, double level,
+                                  double lowerThreshold, double upperThreshold,
+                                  int applyThreshold, vtkScalarsToColors* lut);
+
+  /// Map the scalars of a layer through a lookup table like
+  /// vtkMRMLLabelMapVolumeDisplayNode. The background mask is not used.
+  void SetLayerLookupTableMapping(int layer, vtkScalarsToColors* lut);
+
+  /// Opacity of the layer when blended with the layers below.
+  void SetLayerOpacity(int layer, double opacity);
+  double GetLayerOpacity(int layer);
+
+  /// Return true if images of type \a scalarType can be composited.
+  static bool IsScalarTypeSupported(int scalarType);
+
+  /// Take into account the modification time of the lookup tables.
+  virtual unsigned long GetMTime();
+
+protected:
+  vtkImageSliceCompositor();
+  virtual ~vtkImageSliceCompositor();
+
+  virtual int FillInputPortInformation(int port, vtkInformation* info);
+  virtual int RequestInformation(vtkInformation* request,
+                                 vtkInformationVector** inputVector,
+                                 vtkInformationVector* outputVector);
+  virtual int RequestData(vtkInformation* request,
+                          vtkInformationVector** inputVector,
+                          vtkInformationVector* outputVector);
+  virtual void ThreadedRequestData(vtkInformation* request,
+                                   vtkInformationVector** inputVector,
+                                   vtkInformationVector* outputVector,
+                                   vtkImageData*** inData,
+                                   vtkImageData** outData,
+                                   int outExt[6], int threadId);
+
+  /// Compute the color table of a layer if needed.
+  /// Return false if the layer can't be mapped.
+  bool UpdateColorTable(int layer, int scalarType);
+
+  vtkImageSliceCompositorInternals* Internals;
+
+private:
+  vtkImageSliceCompositor(const vtkImageSliceCompositor&); // Not implemented
+  void operator=(const vtkImageSliceCompositor&);          // Not implemented
+};
+
+#endif
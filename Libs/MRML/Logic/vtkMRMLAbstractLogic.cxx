@@ -19,11 +19,13 @@
 // MRML includes
 #include "vtkMRMLNode.h"
 #include "vtkMRMLScene.h"
+#include "vtkMRMLSceneNodesDelta.h"
 
 // VTK includes
 #include <vtkCallbackCommand.h>
 #include <vtkObjectFactory.h>
 #include <vtkSmartPointer.h>
+#include <vtkWeakPointer.h>
 
 // STD includes
 #include <cassert>
@@ -46,6 +48,8 @@ public:
 
   int                  InMRMLSceneCallbackFlag;
   int                  ProcessingMRMLSceneEvent;
+  /// Scene the logic is registered to as a nodes delta observer
+  vtkWeakPointer<vtkMRMLScene> NodesDeltaScene;
 
   vtkObserverManager * MRMLNodesObserverManager;
   int                  InMRMLNodesCallbackFlag;
@@ -286,9 +290,34 @@ void vtkMRMLAbstractLogic::SetMRMLScene(vtkMRMLScene * newScene)
     this->RegisterNodes();
     this->ObserveMRMLScene();
     }
+  this->UpdateNodesDeltaObserver();
   this->Modified();
 }
 
+//----------------------------------------------------------------------------
+void vtkMRMLAbstractLogic::UpdateNodesDeltaObserver()
+{
+  vtkMRMLScene* scene = this->Internal->MRMLScene;
+  if (scene && this->GetMRMLSceneObserverManager()->GetObservationsCount(
+        scene, vtkMRMLScene::NodesChangedEvent) == 0)
+    {
+    scene = 0;
+    }
+  if (scene == this->Internal->NodesDeltaScene)
+    {
+    return;
+    }
+  if (this->Internal->NodesDeltaScene)
+    {
+    this->Internal->NodesDeltaScene->UnregisterNodesDeltaObserver();
+    }
+  this->Internal->NodesDeltaScene = scene;
+  if (scene)
+    {
+    scene->RegisterNodesDeltaObserver();
+    }
+}
+
 //----------------------------------------------------------------------------
 void vtkMRMLAbstractLogic::SetMRMLSceneInternal(vtkMRMLScene * newScene)
 {
@@ -316,6 +345,7 @@ void vtkMRMLAbstractLogic::SetAndObserveMRMLScene(vtkMRMLScene *newScene)
     this->ObserveMRMLScene();
     }
 
+  this->UpdateNodesDeltaObserver();
   this->Modified();
 }
 
@@ -345,6 +375,7 @@ void vtkMRMLAbstractLogic::SetAndObserveMRMLSceneEvents(vtkMRMLScene *newScene,
     {
     this->ObserveMRMLScene();
     }
+  this->UpdateNodesDeltaObserver();
   this->Modified();
 }
 
@@ -480,6 +511,11 @@ void vtkMRMLAbstractLogic
       assert(node);
       this->OnMRMLSceneNodeRemoved(node);
       break;
+    case vtkMRMLScene::NodesChangedEvent:
+      assert(callData);
+      this->OnMRMLSceneNodesChanged(
+        reinterpret_cast<vtkMRMLSceneNodesDelta*>(callData));
+      break;
     default:
       break;
     }
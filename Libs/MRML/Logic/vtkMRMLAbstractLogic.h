@@ -22,6 +22,7 @@ class vtkMRMLApplicationLogic;
 #include <vtkObserverManager.h>
 class vtkMRMLNode;
 class vtkMRMLScene;
+class vtkMRMLSceneNodesDelta;
 
 // VTK includes
 #include <vtkCommand.h>
@@ -311,6 +312,20 @@ protected:
   /// \sa ProcessMRMLSceneEvents, SetMRMLSceneInternal
   /// \sa OnMRMLSceneNodeAdded, vtkMRMLScene::NodeAboutToBeRemoved
   virtual void OnMRMLSceneNodeRemoved(vtkMRMLNode* /*node*/){}
+  /// If vtkMRMLScene::NodesChangedEvent has been set to be observed in
+  ///  SetMRMLSceneInternal, it is called once at the end of a batch process
+  /// with all the nodes added, removed and modified during the batch.
+  /// It is called before OnMRMLSceneEndImport, OnMRMLSceneEndClose...
+  /// and OnMRMLSceneEndBatchProcess.
+  /// \sa ProcessMRMLSceneEvents, SetMRMLSceneInternal
+  /// \sa vtkMRMLScene::IsRecordingNodesDelta
+  virtual void OnMRMLSceneNodesChanged(vtkMRMLSceneNodesDelta* /*delta*/){}
+
+  /// Register the logic as a nodes delta observer of its scene if it
+  /// observes vtkMRMLScene::NodesChangedEvent, unregister it otherwise.
+  /// Called each time the scene is set.
+  /// \sa vtkMRMLScene::RegisterNodesDeltaObserver
+  void UpdateNodesDeltaObserver();
 
   /// Called after the corresponding MRML event is triggered.
   /// \sa ProcessMRMLNodesEvents
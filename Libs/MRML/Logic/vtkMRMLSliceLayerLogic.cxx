@@ -21,6 +21,7 @@
 #include "vtkMRMLDiffusionWeightedVolumeDisplayNode.h"
 #include "vtkMRMLDiffusionTensorVolumeDisplayNode.h"
 #include "vtkMRMLLinearTransformNode.h"
+#include "vtkMRMLNonlinearTransformNode.h"
 #include "vtkMRMLDiffusionTensorVolumeSliceDisplayNode.h"
 #include "vtkMRMLScene.h"
 
@@ -28,20 +29,27 @@
 #include <vtkAssignAttribute.h>
 #include <vtkDiffusionTensorMathematics.h>
 #include <vtkFloatArray.h>
+#include <vtkGeneralTransform.h>
+#include <vtkGridTransform.h>
 #include <vtkImageData.h>
-#include <vtkImageLinearReslice.h>
 #include <vtkImageResliceMask.h>
 #include <vtkImageReslice.h>
 #include <vtkInformation.h>
 #include <vtkInformationVector.h>
+#include <vtkMultiThreader.h>
 #include <vtkNew.h>
 #include <vtkObjectFactory.h>
 #include <vtkPointData.h>
 #include <vtkTransform.h>
+#include <vtkWarpTransform.h>
 
 //
 #include "vtkImageLabelOutline.h"
 
+// STD includes
+#include <algorithm>
+#include <cmath>
+
 //----------------------------------------------------------------------------
 vtkCxxRevisionMacro(vtkMRMLSliceLayerLogic, "$Revision$");
 vtkStandardNewMacro(vtkMRMLSliceLayerLogic);
@@ -66,6 +74,112 @@ bool AreMatricesEqual(const vtkMatrix4x4* first, const vtkMatrix4x4* second)
          first->GetElement(3,3) == second->GetElement(3,3);
 }
 
+//----------------------------------------------------------------------------
+// Modification time of the transforms from transformNode to the world, it
+// changes when any transform node or its matrix or warp transform changes.
+static unsigned long GetTransformToWorldMTime(vtkMRMLTransformNode* transformNode)
+{
+  unsigned long mtime = 0;
+  for (; transformNode; transformNode = transformNode->GetParentTransformNode())
+    {
+    mtime = std::max(mtime, transformNode->GetMTime());
+    vtkMRMLLinearTransformNode* linearTransformNode =
+      vtkMRMLLinearTransformNode::SafeDownCast(transformNode);
+    if (linearTransformNode && linearTransformNode->GetMatrixTransformToParent())
+      {
+      mtime = std::max(mtime,
+        linearTransformNode->GetMatrixTransformToParent()->GetMTime());
+      }
+    vtkMRMLNonlinearTransformNode* nonlinearTransformNode =
+      vtkMRMLNonlinearTransformNode::SafeDownCast(transformNode);
+    if (nonlinearTransformNode && nonlinearTransformNode->GetWarpTransformToParent())
+      {
+      mtime = std::max(mtime,
+        nonlinearTransformNode->GetWarpTransformToParent()->GetMTime());
+      }
+    }
+  return mtime;
+}
+
+//----------------------------------------------------------------------------
+// Finest spacing of the grids or control points of the nonlinear transforms
+// from transformNode to the world, false if one of them has none.
+static bool GetControlPointSpacingToWorld(vtkMRMLTransformNode* transformNode,
+                                          double spacing[3])
+{
+  bool found = false;
+  std::fill(spacing, spacing + 3, VTK_DOUBLE_MAX);
+  for (; transformNode; transformNode = transformNode->GetParentTransformNode())
+    {
+    if (transformNode->IsLinear())
+      {
+      continue;
+      }
+    vtkMRMLNonlinearTransformNode* nonlinearTransformNode =
+      vtkMRMLNonlinearTransformNode::SafeDownCast(transformNode);
+    double nodeSpacing[3];
+    if (!nonlinearTransformNode ||
+        !nonlinearTransformNode->GetControlPointSpacing(nodeSpacing))
+      {
+      return false;
+      }
+    for (int axis = 0; axis < 3; ++axis)
+      {
+      spacing[axis] = std::min(spacing[axis], std::fabs(nodeSpacing[axis]));
+      }
+    found = true;
+    }
+  return found;
+}
+
+//----------------------------------------------------------------------------
+// Arguments of the threaded sampling of the displacement grid
+struct vtkMRMLSliceLayerLogicDisplacementGridInfo
+{
+  vtkAbstractTransform* WorldToVolumeRAS;
+  double Origin[3];
+  double Spacing[3];
+  int Dimensions[3];
+  float* Displacements;
+};
+
+//----------------------------------------------------------------------------
+// Each thread samples the displacements of a slab of slices of the grid
+static VTK_THREAD_RETURN_TYPE vtkMRMLSliceLayerLogicSampleDisplacementGrid(void* arg)
+{
+  vtkMultiThreader::ThreadInfo* threadInfo =
+    static_cast<vtkMultiThreader::ThreadInfo*>(arg);
+  vtkMRMLSliceLayerLogicDisplacementGridInfo* info =
+    static_cast<vtkMRMLSliceLayerLogicDisplacementGridInfo*>(threadInfo->UserData);
+  const int* dimensions = info->Dimensions;
+  const int firstSlice =
+    threadInfo->ThreadID * dimensions[2] / threadInfo->NumberOfThreads;
+  const int lastSlice =
+    (threadInfo->ThreadID + 1) * dimensions[2] / threadInfo->NumberOfThreads;
+
+  float* displacement = info->Displacements +
+    3 * static_cast<vtkIdType>(firstSlice) * dimensions[0] * dimensions[1];
+  for (int k = firstSlice; k < lastSlice; ++k)
+    {
+    for (int j = 0; j < dimensions[1]; ++j)
+      {
+      for (int i = 0; i < dimensions[0]; ++i)
+        {
+        double world[3] = {info->Origin[0] + i * info->Spacing[0],
+                           info->Origin[1] + j * info->Spacing[1],
+                           info->Origin[2] + k * info->Spacing[2]};
+        double ras[3];
+        // the transform is up to date, skip its (locked) update
+        info->WorldToVolumeRAS->InternalTransformPoint(world, ras);
+        *displacement++ = static_cast<float>(ras[0] - world[0]);
+        *displacement++ = static_cast<float>(ras[1] - world[1]);
+        *displacement++ = static_cast<float>(ras[2] - world[2]);
+        }
+      }
+    }
+  return VTK_THREAD_RETURN_VALUE;
+}
+
 //----------------------------------------------------------------------------
 vtkMRMLSliceLayerLogic::vtkMRMLSliceLayerLogic()
 {
@@ -78,6 +192,26 @@ vtkMRMLSliceLayerLogic::vtkMRMLSliceLayerLogic()
   this->XYToIJKTransform = vtkTransform::New();
   this->UVWToIJKTransform = vtkTransform::New();
 
+  this->XYToRASTransform = vtkTransform::New();
+  this->UVWToRASTransform = vtkTransform::New();
+  this->RASToIJKTransform = vtkTransform::New();
+  this->DisplacementGridTransform = vtkGridTransform::New();
+  this->XYToIJKNonlinearTransform = vtkGeneralTransform::New();
+  this->XYToIJKNonlinearTransform->PostMultiply();
+  this->XYToIJKNonlinearTransform->Concatenate(this->XYToRASTransform);
+  this->XYToIJKNonlinearTransform->Concatenate(this->DisplacementGridTransform);
+  this->XYToIJKNonlinearTransform->Concatenate(this->RASToIJKTransform);
+  this->UVWToIJKNonlinearTransform = vtkGeneralTransform::New();
+  this->UVWToIJKNonlinearTransform->PostMultiply();
+  this->UVWToIJKNonlinearTransform->Concatenate(this->UVWToRASTransform);
+  this->UVWToIJKNonlinearTransform->Concatenate(this->DisplacementGridTransform);
+  this->UVWToIJKNonlinearTransform->Concatenate(this->RASToIJKTransform);
+  this->DisplacementGridTransformNode = 0;
+  this->DisplacementGridVolumeDimensions[0] = 0;
+  this->DisplacementGridVolumeDimensions[1] = 0;
+  this->DisplacementGridVolumeDimensions[2] = 0;
+  this->DisplacementGridMaximumDimension = 128;
+
   this->IsLabelLayer = 0;
 
   this->AssignAttributeTensorsToScalars= vtkAssignAttribute::New();
@@ -102,6 +236,9 @@ vtkMRMLSliceLayerLogic::vtkMRMLSliceLayerLogic()
   this->Reslice->SetOutputOrigin( 0, 0, 0 );
   this->Reslice->SetOutputSpacing( 1, 1, 1 );
   this->Reslice->SetOutputDimensionality( 3 );
+  // In lightbox mode, each slice of the output is a tile: scrolling only
+  // reslices the tiles that are new.
+  this->Reslice->ReuseShiftedSlicesOn();
   
   this->ResliceUVW->SetBackgroundColor(0, 0, 0, 0); // only first two are used
   this->ResliceUVW->AutoCropOutputOff();
@@ -110,7 +247,8 @@ vtkMRMLSliceLayerLogic::vtkMRMLSliceLayerLogic()
   this->ResliceUVW->SetOutputSpacing( 1, 1, 1 );
   this->ResliceUVW->SetOutputDimensionality( 3 );
   
-  // Only the transform matrix can change, not the transform itself
+  // Only the transform matrix can change, not the transform itself (unless
+  // the volume is under a nonlinear transform, see UpdateTransforms())
   this->Reslice->SetResliceTransform( this->XYToIJKTransform ); 
   this->ResliceUVW->SetResliceTransform( this->UVWToIJKTransform ); 
 
@@ -137,6 +275,12 @@ vtkMRMLSliceLayerLogic::~vtkMRMLSliceLayerLogic()
   this->SetVolumeNode(0);
   this->XYToIJKTransform->Delete();
   this->UVWToIJKTransform->Delete();
+  this->XYToIJKNonlinearTransform->Delete();
+  this->UVWToIJKNonlinearTransform->Delete();
+  this->XYToRASTransform->Delete();
+  this->UVWToRASTransform->Delete();
+  this->RASToIJKTransform->Delete();
+  this->DisplacementGridTransform->Delete();
 
   this->Reslice->SetInput( 0 );
   this->ResliceUVW->SetInput( 0 );
@@ -441,8 +585,6 @@ void vtkMRMLSliceLayerLogic::UpdateVolumeDisplayNode()
 //----------------------------------------------------------------------------
 void vtkMRMLSliceLayerLogic::UpdateTransforms()
 {
-  static bool reportedNonlinearTransformSupport = false;
-  
   if (this->UpdatingTransforms) 
     {
     return;
@@ -478,6 +620,8 @@ void vtkMRMLSliceLayerLogic::UpdateTransforms()
     this->SliceNode->GetUVWDimensions(dimensionsUVW);
     }
 
+  bool nonlinear = false;
+  bool nonlinearTransformModified = false;
   if (this->VolumeNode && this->VolumeNode->GetImageData())
     {
     // Apply the transform, if it exists
@@ -486,11 +630,10 @@ void vtkMRMLSliceLayerLogic::UpdateTransforms()
       {
       if ( !transformNode->IsTransformToWorldLinear() )
         {
-        if (!reportedNonlinearTransformSupport)
-          {
-          vtkErrorMacro ("Nonlinear transforms are not yet supported in slice viewers.");
-          reportedNonlinearTransformSupport = true;
-          }
+        // Reslice through the displacement grid sampling the transform,
+        // XYToIJKTransform and UVWToIJKTransform ignore it.
+        nonlinear = true;
+        nonlinearTransformModified = this->UpdateDisplacementGrid(transformNode);
         }
       else
         {
@@ -524,6 +667,41 @@ void vtkMRMLSliceLayerLogic::UpdateTransforms()
     this->UVWToIJKTransform->SetMatrix(uvwToIJK.GetPointer());
     }
 
+  if (nonlinear)
+    {
+    vtkNew<vtkMatrix4x4> xyToRAS;
+    vtkNew<vtkMatrix4x4> uvwToRAS;
+    if (this->SliceNode)
+      {
+      xyToRAS->DeepCopy(this->SliceNode->GetXYToRAS());
+      uvwToRAS->DeepCopy(this->SliceNode->GetUVWToRAS());
+      }
+    if (!AreMatricesEqual(this->XYToRASTransform->GetMatrix(), xyToRAS.GetPointer()))
+      {
+      this->XYToRASTransform->SetMatrix(xyToRAS.GetPointer());
+      nonlinearTransformModified = true;
+      }
+    if (!AreMatricesEqual(this->UVWToRASTransform->GetMatrix(), uvwToRAS.GetPointer()))
+      {
+      this->UVWToRASTransform->SetMatrix(uvwToRAS.GetPointer());
+      nonlinearTransformModified = true;
+      }
+    }
+
+  vtkAbstractTransform* resliceTransform = nonlinear ?
+    static_cast<vtkAbstractTransform*>(this->XYToIJKNonlinearTransform) :
+    static_cast<vtkAbstractTransform*>(this->XYToIJKTransform);
+  vtkAbstractTransform* resliceTransformUVW = nonlinear ?
+    static_cast<vtkAbstractTransform*>(this->UVWToIJKNonlinearTransform) :
+    static_cast<vtkAbstractTransform*>(this->UVWToIJKTransform);
+  if (this->Reslice->GetResliceTransform() != resliceTransform ||
+      this->ResliceUVW->GetResliceTransform() != resliceTransformUVW)
+    {
+    this->Reslice->SetResliceTransform(resliceTransform);
+    this->ResliceUVW->SetResliceTransform(resliceTransformUVW);
+    nonlinearTransformModified = true;
+    }
+
   this->Reslice->SetOutputExtent( 0, dimensions[0]-1,
                                   0, dimensions[1]-1,
                                   0, dimensions[2]-1);
@@ -534,12 +712,147 @@ void vtkMRMLSliceLayerLogic::UpdateTransforms()
 
   this->UpdatingTransforms = 0; 
 
-  if (transformModified || transformModifiedUVW)
+  if (transformModified || transformModifiedUVW || nonlinearTransformModified)
     {
     this->Modified();
     }
 }
 
+//----------------------------------------------------------------------------
+vtkAbstractTransform* vtkMRMLSliceLayerLogic::GetXYToIJKResliceTransform()
+{
+  return this->Reslice->GetResliceTransform();
+}
+
+//----------------------------------------------------------------------------
+bool vtkMRMLSliceLayerLogic::UpdateDisplacementGrid(vtkMRMLTransformNode* transformNode)
+{
+  int dimensions[3];
+  this->VolumeNode->GetImageData()->GetDimensions(dimensions);
+  vtkNew<vtkMatrix4x4> rasToIJK;
+  this->VolumeNode->GetRASToIJKMatrix(rasToIJK.GetPointer());
+
+  bool geometryModified =
+    !AreMatricesEqual(this->RASToIJKTransform->GetMatrix(), rasToIJK.GetPointer()) ||
+    dimensions[0] != this->DisplacementGridVolumeDimensions[0] ||
+    dimensions[1] != this->DisplacementGridVolumeDimensions[1] ||
+    dimensions[2] != this->DisplacementGridVolumeDimensions[2];
+  if (geometryModified)
+    {
+    this->RASToIJKTransform->SetMatrix(rasToIJK.GetPointer());
+    std::copy(dimensions, dimensions + 3, this->DisplacementGridVolumeDimensions);
+    }
+  else if (transformNode == this->DisplacementGridTransformNode &&
+           GetTransformToWorldMTime(transformNode) <
+             this->DisplacementGridBuildTime.GetMTime())
+    {
+    return false;
+    }
+
+  vtkNew<vtkGeneralTransform> volumeRASToWorld;
+  transformNode->GetTransformToWorld(volumeRASToWorld.GetPointer());
+
+  // A few samples between the grid nodes or control points of the
+  // transforms, where they bend, or the resolution of the volume if their
+  // spacing is unknown. Up to DisplacementGridMaximumDimension samples.
+  double controlPointSpacing[3];
+  double sampleSpacing[3];
+  if (GetControlPointSpacingToWorld(transformNode, controlPointSpacing))
+    {
+    const double samplesPerControlPoint = 4.;
+    for (int axis = 0; axis < 3; ++axis)
+      {
+      sampleSpacing[axis] = controlPointSpacing[axis] / samplesPerControlPoint;
+      }
+    }
+  else
+    {
+    double spacing[3];
+    this->VolumeNode->GetSpacing(spacing);
+    double minSpacing = std::min(spacing[0], std::min(spacing[1], spacing[2]));
+    std::fill(controlPointSpacing, controlPointSpacing + 3, minSpacing);
+    std::fill(sampleSpacing, sampleSpacing + 3, minSpacing);
+    }
+
+  // The grid covers the volume before and after transform. The transform
+  // is evaluated on a lattice of the volume rather than only at its
+  // corners because it can move the inside of the volume further out, and
+  // the bounds are padded by one control point spacing for the
+  // displacements between the lattice points.
+  vtkNew<vtkMatrix4x4> ijkToRAS;
+  this->VolumeNode->GetIJKToRASMatrix(ijkToRAS.GetPointer());
+  double bounds[6] = {VTK_DOUBLE_MAX, VTK_DOUBLE_MIN,
+                      VTK_DOUBLE_MAX, VTK_DOUBLE_MIN,
+                      VTK_DOUBLE_MAX, VTK_DOUBLE_MIN};
+  const int latticeDimension = 5;
+  for (int point = 0; point < latticeDimension * latticeDimension * latticeDimension; ++point)
+    {
+    const int latticeIndex[3] = {point % latticeDimension,
+                                 (point / latticeDimension) % latticeDimension,
+                                 point / (latticeDimension * latticeDimension)};
+    double ijk[4] = {0., 0., 0., 1.};
+    for (int axis = 0; axis < 3; ++axis)
+      {
+      ijk[axis] = (dimensions[axis] - 1.) * latticeIndex[axis] / (latticeDimension - 1.);
+      }
+    double ras[4];
+    ijkToRAS->MultiplyPoint(ijk, ras);
+    double world[3];
+    volumeRASToWorld->TransformPoint(ras, world);
+    for (int axis = 0; axis < 3; ++axis)
+      {
+      bounds[2*axis] = std::min(bounds[2*axis], std::min(ras[axis], world[axis]));
+      bounds[2*axis+1] = std::max(bounds[2*axis+1], std::max(ras[axis], world[axis]));
+      }
+    }
+  for (int axis = 0; axis < 3; ++axis)
+    {
+    bounds[2*axis] -= controlPointSpacing[axis];
+    bounds[2*axis+1] += controlPointSpacing[axis];
+    }
+
+  int gridDimensions[3];
+  double gridSpacing[3];
+  for (int axis = 0; axis < 3; ++axis)
+    {
+    double size = bounds[2*axis+1] - bounds[2*axis];
+    int samples = sampleSpacing[axis] > 0. ?
+      static_cast<int>(std::ceil(size / sampleSpacing[axis])) + 1 : 2;
+    gridDimensions[axis] = std::max(2,
+      std::min(samples, this->DisplacementGridMaximumDimension));
+    gridSpacing[axis] = size > 0. ? size / (gridDimensions[axis] - 1) : 1.;
+    }
+
+  vtkNew<vtkImageData> grid;
+  grid->SetOrigin(bounds[0], bounds[2], bounds[4]);
+  grid->SetSpacing(gridSpacing);
+  grid->SetDimensions(gridDimensions);
+  grid->SetScalarTypeToFloat();
+  grid->SetNumberOfScalarComponents(3);
+  grid->AllocateScalars();
+
+  // Displacement from the world to the volume RAS coordinates, each
+  // thread samples a slab of the grid
+  vtkMRMLSliceLayerLogicDisplacementGridInfo info;
+  info.WorldToVolumeRAS = volumeRASToWorld->GetInverse();
+  info.WorldToVolumeRAS->Update();
+  grid->GetOrigin(info.Origin);
+  std::copy(gridSpacing, gridSpacing + 3, info.Spacing);
+  std::copy(gridDimensions, gridDimensions + 3, info.Dimensions);
+  info.Displacements = static_cast<float*>(grid->GetScalarPointer());
+
+  vtkNew<vtkMultiThreader> threader;
+  threader->SetNumberOfThreads(
+    std::min(threader->GetNumberOfThreads(), gridDimensions[2]));
+  threader->SetSingleMethod(vtkMRMLSliceLayerLogicSampleDisplacementGrid, &info);
+  threader->SingleMethodExecute();
+
+  this->DisplacementGridTransform->SetDisplacementGrid(grid.GetPointer());
+  this->DisplacementGridTransformNode = transformNode;
+  this->DisplacementGridBuildTime.Modified();
+  return true;
+}
+
 //----------------------------------------------------------------------------
 vtkImageData* vtkMRMLSliceLayerLogic::GetImageData()
 {
@@ -738,8 +1051,16 @@ void vtkMRMLSliceLayerLogic::UpdateImageDisplay()
     if (volumeNode != 0 && volumeNode->GetImageData() != 0)
       {
       //int wasModifying = volumeDisplayNode->StartModify();
-      volumeDisplayNode->SetInputImageData(this->GetSliceImageData());
-      volumeDisplayNode->SetBackgroundImageData(this->Reslice->GetBackgroundMask());
+      // Setting the same input would modify the display node and trigger
+      // an update of the whole slice pipeline for nothing.
+      if (volumeDisplayNode->GetInputImageData() != this->GetSliceImageData())
+        {
+        volumeDisplayNode->SetInputImageData(this->GetSliceImageData());
+        }
+      if (volumeDisplayNode->GetBackgroundImageData() != this->Reslice->GetBackgroundMask())
+        {
+        volumeDisplayNode->SetBackgroundImageData(this->Reslice->GetBackgroundMask());
+        }
       // If the background mask is not used, make sure the update extent of the
       // background mask is set to the whole extent so the reslice filter can write
       // into the entire extent instead of trying to access an update extent that won't
@@ -757,8 +1078,14 @@ void vtkMRMLSliceLayerLogic::UpdateImageDisplay()
     if (volumeNode != 0 && volumeNode->GetImageData() != 0)
       {
       //int wasModifying = volumeDisplayNode->StartModify();
-      volumeDisplayNodeUVW->SetInputImageData(this->GetSliceImageDataUVW());
-      volumeDisplayNodeUVW->SetBackgroundImageData(this->ResliceUVW->GetBackgroundMask());
+      if (volumeDisplayNodeUVW->GetInputImageData() != this->GetSliceImageDataUVW())
+        {
+        volumeDisplayNodeUVW->SetInputImageData(this->GetSliceImageDataUVW());
+        }
+      if (volumeDisplayNodeUVW->GetBackgroundImageData() != this->ResliceUVW->GetBackgroundMask())
+        {
+        volumeDisplayNodeUVW->SetBackgroundImageData(this->ResliceUVW->GetBackgroundMask());
+        }
       //volumeDisplayNode->EndModify(wasModifying);
       }
     }
@@ -952,6 +1279,8 @@ void vtkMRMLSliceLayerLogic::PrintSelf(ostream& os, vtkIndent indent)
     }
 
   os << indent << "IsLabelLayer: " << this->GetIsLabelLayer() << "\n";
+  os << indent << "DisplacementGridMaximumDimension: "
+     << this->DisplacementGridMaximumDimension << "\n";
   os << indent << "LabelOutline:\n";
   if (this->LabelOutline)
     {
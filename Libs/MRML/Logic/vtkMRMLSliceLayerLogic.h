@@ -53,6 +53,9 @@ class vtkImageResliceMask;
 //#include <cstdlib>
 
 class vtkImageLabelOutline;
+class vtkAbstractTransform;
+class vtkGeneralTransform;
+class vtkGridTransform;
 class vtkTransform;
 
 class VTK_MRML_LOGIC_EXPORT vtkMRMLSliceLayerLogic
@@ -121,9 +124,28 @@ public:
   void UpdateNodeReferences(); 
 
   /// 
-  /// The current reslice transform XYToIJK
+  /// The current reslice transform XYToIJK.
+  /// It is linear: when the volume is under a nonlinear transform, it only
+  /// holds the slice and volume geometry and ignores the nonlinear transform.
+  /// \sa GetXYToIJKResliceTransform()
   vtkGetObjectMacro (XYToIJKTransform, vtkTransform);
 
+  ///
+  /// The transform from XY to IJK the volume is actually resliced with:
+  /// XYToIJKTransform, or the transform through the displacement grid of
+  /// the nonlinear transforms of the volume. To be used to find the voxel
+  /// under a slice view position.
+  vtkAbstractTransform* GetXYToIJKResliceTransform();
+
+  ///
+  /// Maximum number of samples along each axis of the displacement grid
+  /// used to reslice volumes under nonlinear transforms. The grid samples
+  /// the transforms 4 times per spacing of their grid nodes or control
+  /// points, or at the resolution of the volume if they have none, up to
+  /// this number of samples. 128 by default.
+  vtkSetClampMacro (DisplacementGridMaximumDimension, int, 2, 1024);
+  vtkGetMacro (DisplacementGridMaximumDimension, int);
+
 
 protected:
   vtkMRMLSliceLayerLogic();
@@ -153,6 +175,15 @@ protected:
   // Copy VolumeDisplayNodeObserved into VolumeDisplayNode
   void UpdateVolumeDisplayNode();
 
+  ///
+  /// Sample the nonlinear transform from world to the volume RAS
+  /// coordinates on a grid covering the volume. Evaluating the (inverse)
+  /// nonlinear transform for each resliced pixel is much slower than
+  /// interpolating the displacements of the grid, which is only computed
+  /// again when the transforms or the volume geometry change. Return
+  /// true if the grid or the volume geometry changed.
+  bool UpdateDisplacementGrid(vtkMRMLTransformNode* transformNode);
+
   /// 
   /// the MRML Nodes that define this Logic's parameters
   vtkMRMLVolumeNode *VolumeNode;
@@ -172,10 +203,25 @@ protected:
   vtkAssignAttribute* AssignAttributeScalarsToTensors;
   vtkAssignAttribute* AssignAttributeScalarsToTensorsUVW;
 
-  /// TODO: make this a vtkAbstractTransform for non-linear
+  /// Linear reslice transforms, the nonlinear transforms of the volume
+  /// are not included
   vtkTransform *XYToIJKTransform;
   vtkTransform *UVWToIJKTransform;
 
+  /// Reslice transforms used when the volume is under a nonlinear
+  /// transform: XY (or UVW) to world RAS, world RAS to volume RAS by the
+  /// displacement grid and volume RAS to IJK.
+  vtkTransform *XYToRASTransform;
+  vtkTransform *UVWToRASTransform;
+  vtkTransform *RASToIJKTransform;
+  vtkGridTransform *DisplacementGridTransform;
+  vtkGeneralTransform *XYToIJKNonlinearTransform;
+  vtkGeneralTransform *UVWToIJKNonlinearTransform;
+  vtkMRMLTransformNode *DisplacementGridTransformNode;
+  int DisplacementGridVolumeDimensions[3];
+  vtkTimeStamp DisplacementGridBuildTime;
+  int DisplacementGridMaximumDimension;
+
   int IsLabelLayer;
 
   int UpdatingTransforms;
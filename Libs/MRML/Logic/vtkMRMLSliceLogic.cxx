@@ -15,17 +15,21 @@
 // MRMLLogic includes
 #include "vtkMRMLSliceLogic.h"
 #include "vtkMRMLSliceLayerLogic.h"
+#include "vtkImageResliceMask.h"
+#include "vtkImageSliceCompositor.h"
 
 // MRML includes
 #include <vtkEventBroker.h>
 #include <vtkMRMLCrosshairNode.h>
 #include <vtkMRMLDiffusionTensorVolumeSliceDisplayNode.h>
 #include <vtkMRMLGlyphableVolumeDisplayNode.h>
+#include <vtkMRMLLabelMapVolumeDisplayNode.h>
 #include <vtkMRMLLinearTransformNode.h>
 #include <vtkMRMLModelNode.h>
 #include <vtkMRMLProceduralColorNode.h>
 #include <vtkMRMLScalarVolumeDisplayNode.h>
 #include <vtkMRMLScene.h>
+#include <vtkMRMLSceneNodesDelta.h>
 #include <vtkMRMLSliceCompositeNode.h>
 
 // VTK includes
@@ -46,6 +50,8 @@
 #include <vtkTransform.h>
 
 // STD includes
+#include <algorithm>
+#include <vector>
 
 //----------------------------------------------------------------------------
 // Convenient macros
@@ -81,6 +87,19 @@ vtkMRMLSliceLogic::vtkMRMLSliceLogic()
   this->LabelOpacity = 1.0;
   this->Blend = vtkImageBlend::New();
   this->BlendUVW = vtkImageBlend::New();
+  this->AddSubtractMath = vtkImageMathematics::New();
+  this->AddSubtractMath->GetOutput()->SetScalarType(VTK_SHORT);
+  this->AddSubtractCast = vtkImageCast::New();
+  this->AddSubtractCast->SetInput(this->AddSubtractMath->GetOutput());
+  this->AddSubtractCast->SetOutputScalarTypeToUnsignedChar();
+  this->AddSubtractMathUVW = vtkImageMathematics::New();
+  this->AddSubtractMathUVW->GetOutput()->SetScalarType(VTK_SHORT);
+  this->AddSubtractCastUVW = vtkImageCast::New();
+  this->AddSubtractCastUVW->SetInput(this->AddSubtractMathUVW->GetOutput());
+  this->AddSubtractCastUVW->SetOutputScalarTypeToUnsignedChar();
+  this->FusedCompositing = false;
+  this->FusedCompositingActive = false;
+  this->Compositor = vtkImageSliceCompositor::New();
 
   this->ExtractModelTexture = vtkImageReslice::New();
   this->ExtractModelTexture->SetOutputDimensionality (2);
@@ -99,6 +118,7 @@ vtkMRMLSliceLogic::vtkMRMLSliceLogic()
   this->ImageData = 0;
   this->SliceSpacing[0] = this->SliceSpacing[1] = this->SliceSpacing[2] = 1;
   this->AddingSliceModelNodes = false;
+  this->UpdateSliceNodesAfterBatch = true;
 }
 
 //----------------------------------------------------------------------------
@@ -123,6 +143,31 @@ vtkMRMLSliceLogic::~vtkMRMLSliceLogic()
     this->BlendUVW->Delete();
     this->BlendUVW = 0;
     }
+  if (this->Compositor)
+    {
+    this->Compositor->Delete();
+    this->Compositor = 0;
+    }
+  if (this->AddSubtractMath)
+    {
+    this->AddSubtractMath->Delete();
+    this->AddSubtractMath = 0;
+    }
+  if (this->AddSubtractCast)
+    {
+    this->AddSubtractCast->Delete();
+    this->AddSubtractCast = 0;
+    }
+  if (this->AddSubtractMathUVW)
+    {
+    this->AddSubtractMathUVW->Delete();
+    this->AddSubtractMathUVW = 0;
+    }
+  if (this->AddSubtractCastUVW)
+    {
+    this->AddSubtractCastUVW->Delete();
+    this->AddSubtractCastUVW = 0;
+    }
   if (this->ExtractModelTexture)
     {
     this->ExtractModelTexture->Delete();
@@ -195,6 +240,7 @@ void vtkMRMLSliceLogic::SetMRMLSceneInternal(vtkMRMLScene * newScene)
   events->InsertNextValue(vtkMRMLScene::EndRestoreEvent);
   events->InsertNextValue(vtkMRMLScene::NodeAddedEvent);
   events->InsertNextValue(vtkMRMLScene::NodeRemovedEvent);
+  events->InsertNextValue(vtkMRMLScene::NodesChangedEvent);
 
   this->SetAndObserveMRMLSceneEventsInternal(newScene, events.GetPointer());
 
@@ -386,6 +432,37 @@ void vtkMRMLSliceLogic::OnMRMLSceneNodeRemoved(vtkMRMLNode* node)
   this->UpdateSliceNodes();
 }
 
+//----------------------------------------------------------------------------
+void vtkMRMLSliceLogic::OnMRMLSceneNodesChanged(vtkMRMLSceneNodesDelta* delta)
+{
+  // Same filter as OnMRMLSceneNodeAdded/Removed: if the batch didn't touch
+  // any node the logic depends on and the slice model is still in the
+  // scene, there is no need to update the slice nodes at the end of the
+  // batch.
+  vtkMRMLScene* scene = this->GetMRMLScene();
+  this->UpdateSliceNodesAfterBatch =
+    delta->HasNodeOfClass("vtkMRMLSliceCompositeNode")
+    || delta->HasNodeOfClass("vtkMRMLSliceNode")
+    || delta->HasNodeOfClass("vtkMRMLVolumeNode")
+    || !this->SliceNode || !this->SliceCompositeNode
+    || !this->SliceModelNode || this->SliceModelNode->GetScene() != scene
+    || !this->SliceModelDisplayNode
+    || this->SliceModelDisplayNode->GetScene() != scene
+    || !this->SliceModelTransformNode
+    || this->SliceModelTransformNode->GetScene() != scene;
+}
+
+//----------------------------------------------------------------------------
+void vtkMRMLSliceLogic::OnMRMLSceneEndBatchProcess()
+{
+  bool update = this->UpdateSliceNodesAfterBatch;
+  this->UpdateSliceNodesAfterBatch = true;
+  if (update)
+    {
+    this->Superclass::OnMRMLSceneEndBatchProcess();
+    }
+}
+
 //----------------------------------------------------------------------------
 void vtkMRMLSliceLogic::OnMRMLSceneStartClose()
 {
@@ -740,6 +817,161 @@ void vtkMRMLSliceLogic::SetLabelOpacity(double labelOpacity)
     }
 }
 
+//----------------------------------------------------------------------------
+void vtkMRMLSliceLogic::SetFusedCompositing(bool fused)
+{
+  if (this->FusedCompositing == fused)
+    {
+    return;
+    }
+  this->FusedCompositing = fused;
+  this->UpdatePipeline();
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+bool vtkMRMLSliceLogic::UpdateCompositor()
+{
+  if (!this->SliceCompositeNode)
+    {
+    return false;
+    }
+  vtkMRMLSliceLayerLogic* background =
+    (this->BackgroundLayer && this->BackgroundLayer->GetImageData()) ?
+    this->BackgroundLayer : 0;
+  vtkMRMLSliceLayerLogic* foreground =
+    (this->ForegroundLayer && this->ForegroundLayer->GetImageData()) ?
+    this->ForegroundLayer : 0;
+  vtkMRMLSliceLayerLogic* label =
+    (this->LabelLayer && this->LabelLayer->GetImageData()) ?
+    this->LabelLayer : 0;
+
+  // same layers and opacities as the inputs of Blend in UpdatePipeline()
+  std::vector<vtkMRMLSliceLayerLogic*> layers;
+  std::vector<double> opacities;
+  const int sliceCompositing = this->SliceCompositeNode->GetCompositing();
+  if (sliceCompositing == vtkMRMLSliceCompositeNode::Alpha)
+    {
+    if (background)
+      {
+      layers.push_back(background);
+      opacities.push_back(1.);
+      }
+    if (foreground)
+      {
+      layers.push_back(foreground);
+      opacities.push_back(this->SliceCompositeNode->GetForegroundOpacity());
+      }
+    }
+  else if (sliceCompositing == vtkMRMLSliceCompositeNode::ReverseAlpha)
+    {
+    if (foreground)
+      {
+      layers.push_back(foreground);
+      opacities.push_back(1.);
+      }
+    if (background)
+      {
+      layers.push_back(background);
+      opacities.push_back(this->SliceCompositeNode->GetForegroundOpacity());
+      }
+    }
+  else if (background && foreground)
+    {
+    // add/subtract compositing is done by the regular pipeline
+    return false;
+    }
+  if (label)
+    {
+    layers.push_back(label);
+    opacities.push_back(this->SliceCompositeNode->GetLabelOpacity());
+    }
+  if (layers.size() == 0)
+    {
+    return false;
+    }
+
+  // check all the layers before changing the compositor
+  std::vector<vtkImageData*> scalars(layers.size());
+  std::vector<vtkMRMLScalarVolumeDisplayNode*> scalarDisplayNodes(layers.size());
+  std::vector<vtkScalarsToColors*> lookupTables(layers.size());
+  std::vector<std::pair<vtkMRMLVolumeDisplayNode*, unsigned long> >
+    labelMapDisplayNodes;
+  for (size_t i = 0; i < layers.size(); ++i)
+    {
+    vtkMRMLVolumeDisplayNode* displayNode = layers[i]->GetVolumeDisplayNode();
+    if (!displayNode)
+      {
+      return false;
+      }
+    // subclasses have their own pipelines
+    scalarDisplayNodes[i] = 0;
+    if (!strcmp(displayNode->GetClassName(), "vtkMRMLScalarVolumeDisplayNode"))
+      {
+      scalarDisplayNodes[i] =
+        vtkMRMLScalarVolumeDisplayNode::SafeDownCast(displayNode);
+      lookupTables[i] = scalarDisplayNodes[i]->GetLookupTable();
+      }
+    else if (!strcmp(displayNode->GetClassName(), "vtkMRMLLabelMapVolumeDisplayNode"))
+      {
+      vtkMRMLLabelMapVolumeDisplayNode* labelMapDisplayNode =
+        vtkMRMLLabelMapVolumeDisplayNode::SafeDownCast(displayNode);
+      // the lookup table is set by the display node pipeline, only update it
+      // if the display node changed since the last update
+      std::pair<vtkMRMLVolumeDisplayNode*, unsigned long> labelMapDisplayNodeMTime(
+        displayNode, displayNode->GetMTime());
+      if (std::find(this->CompositorLabelMapDisplayNodes.begin(),
+                    this->CompositorLabelMapDisplayNodes.end(),
+                    labelMapDisplayNodeMTime) ==
+          this->CompositorLabelMapDisplayNodes.end())
+        {
+        labelMapDisplayNode->UpdateImageDataPipeline();
+        }
+      labelMapDisplayNodes.push_back(labelMapDisplayNodeMTime);
+      lookupTables[i] = labelMapDisplayNode->GetLookupTable();
+      }
+    else
+      {
+      return false;
+      }
+    scalars[i] = displayNode->GetInputImageData();
+    if (!scalars[i] || !lookupTables[i])
+      {
+      return false;
+      }
+    scalars[i]->UpdateInformation();
+    if (scalars[i]->GetNumberOfScalarComponents() != 1 ||
+        !vtkImageSliceCompositor::IsScalarTypeSupported(scalars[i]->GetScalarType()))
+      {
+      return false;
+      }
+    }
+
+  this->CompositorLabelMapDisplayNodes = labelMapDisplayNodes;
+  this->Compositor->SetNumberOfLayers(static_cast<int>(layers.size()));
+  for (size_t i = 0; i < layers.size(); ++i)
+    {
+    int layer = static_cast<int>(i);
+    this->Compositor->SetLayerInput(layer, scalars[i],
+                                    layers[i]->GetReslice()->GetBackgroundMask());
+    if (scalarDisplayNodes[i])
+      {
+      vtkMRMLScalarVolumeDisplayNode* displayNode = scalarDisplayNodes[i];
+      this->Compositor->SetLayerWindowLevelMapping(layer,
+        displayNode->GetWindow(), displayNode->GetLevel(),
+        displayNode->GetLowerThreshold(), displayNode->GetUpperThreshold(),
+        displayNode->GetApplyThreshold(), lookupTables[i]);
+      }
+    else
+      {
+      this->Compositor->SetLayerLookupTableMapping(layer, lookupTables[i]);
+      }
+    this->Compositor->SetLayerOpacity(layer, opacities[i]);
+    }
+  return true;
+}
+
+//----------------------------------------------------------------------------
 void vtkMRMLSliceLogic
 ::SetBackgroundWindowLevel(double newWindow, double newLevel)
 {
@@ -803,10 +1035,13 @@ vtkImageData * vtkMRMLSliceLogic::GetImageData()
 //----------------------------------------------------------------------------
 void vtkMRMLSliceLogic::UpdateImageData ()
 {
+  // output of the 2D view pipeline
+  vtkImageData* blendOutput = this->FusedCompositingActive ?
+    this->Compositor->GetOutput() : this->Blend->GetOutput();
   if (this->SliceNode->GetSliceResolutionMode() == vtkMRMLSliceNode::SliceResolutionMatch2DView)
     {
-    this->ExtractModelTexture->SetInput( this->Blend->GetOutput() );
-    this->ImageData = this->Blend->GetOutput();
+    this->ExtractModelTexture->SetInput( blendOutput );
+    this->ImageData = blendOutput;
     }
   else
     {
@@ -825,7 +1060,7 @@ void vtkMRMLSliceLogic::UpdateImageData ()
       //this->Blend->Update();
       }
     //this->ImageData = this->Blend->GetOutput();
-    if (this->ImageData== 0 || this->Blend->GetOutput()->GetMTime() > this->ImageData->GetMTime())
+    if (this->ImageData== 0 || blendOutput->GetMTime() > this->ImageData->GetMTime())
       {
       // Pipeline driven, no need to copy image data.
       //if (this->ImageData== 0)
@@ -833,7 +1068,7 @@ void vtkMRMLSliceLogic::UpdateImageData ()
       //  this->ImageData = vtkImageData::New();
       //  }
       //this->ImageData->DeepCopy( this->Blend->GetOutput());
-      this->ImageData = this->Blend->GetOutput();
+      this->ImageData = blendOutput;
       //this->ExtractModelTexture->SetInput( this->ImageData );
       // Doesn't seem needed, not sure though.
       //this->ActiveSliceTransform->Identity();
@@ -859,6 +1094,22 @@ void vtkMRMLSliceLogic::UpdateImageData ()
     }
 }
 
+//----------------------------------------------------------------------------
+static void vtkMRMLSliceLogicSetAddSubtractOperation(
+  vtkImageMathematics* math, int sliceCompositing)
+{
+  if (sliceCompositing == vtkMRMLSliceCompositeNode::Add)
+    {
+    // add the foreground and background
+    math->SetOperationToAdd();
+    }
+  else if (sliceCompositing == vtkMRMLSliceCompositeNode::Subtract)
+    {
+    // subtract the foreground and background
+    math->SetOperationToSubtract();
+    }
+}
+
 //----------------------------------------------------------------------------
 void vtkMRMLSliceLogic::UpdatePipeline()
 {
@@ -972,58 +1223,22 @@ void vtkMRMLSliceLogic::UpdatePipeline()
 
     if (!alphaBlending)
       {
-      vtkImageMathematics *tempMath = vtkImageMathematics::New();
-      if (sliceCompositing == vtkMRMLSliceCompositeNode::Add)
-        {
-        // add the foreground and background
-        tempMath->SetOperationToAdd();
-        }
-      else if (sliceCompositing == vtkMRMLSliceCompositeNode::Subtract)
-        {
-        // subtract the foreground and background
-        tempMath->SetOperationToSubtract();
-        }
+      // The filters are only modified if the operation or the inputs
+      // change, a change of opacity doesn't re-execute them.
+      vtkMRMLSliceLogicSetAddSubtractOperation(this->AddSubtractMath, sliceCompositing);
+      this->AddSubtractMath->SetInput1( foregroundImage );
+      this->AddSubtractMath->SetInput2( backgroundImage );
 
-      tempMath->SetInput1( foregroundImage );
-      tempMath->SetInput2( backgroundImage );
-      tempMath->GetOutput()->SetScalarType(VTK_SHORT);
-
-      vtkImageCast *tempCast = vtkImageCast::New();
-      tempCast->SetInput( tempMath->GetOutput() );
-      tempCast->SetOutputScalarTypeToUnsignedChar();
-
-      this->Blend->SetInput( layerIndex, tempCast->GetOutput() );
+      this->Blend->SetInput( layerIndex, this->AddSubtractCast->GetOutput() );
       this->Blend->SetOpacity( layerIndex++, 1.0 );
 
-      tempMath->Delete();  // Blend may still be holding a reference
-      tempCast->Delete();  // Blend may still be holding a reference
-
       // UVW pipeline
-      vtkImageMathematics *tempMathUVW = vtkImageMathematics::New();
-      if (sliceCompositing == vtkMRMLSliceCompositeNode::Add)
-        {
-        // add the foreground and background
-        tempMathUVW->SetOperationToAdd();
-        }
-      else if (sliceCompositing == vtkMRMLSliceCompositeNode::Subtract)
-        {
-        // subtract the foreground and background
-        tempMathUVW->SetOperationToSubtract();
-        }
+      vtkMRMLSliceLogicSetAddSubtractOperation(this->AddSubtractMathUVW, sliceCompositing);
+      this->AddSubtractMathUVW->SetInput1( foregroundImageUVW );
+      this->AddSubtractMathUVW->SetInput2( backgroundImageUVW );
 
-      tempMathUVW->SetInput1( foregroundImageUVW );
-      tempMathUVW->SetInput2( backgroundImageUVW );
-      tempMathUVW->GetOutput()->SetScalarType(VTK_SHORT);
-
-      vtkImageCast *tempCastUVW = vtkImageCast::New();
-      tempCastUVW->SetInput( tempMathUVW->GetOutput() );
-      tempCastUVW->SetOutputScalarTypeToUnsignedChar();
-
-      this->BlendUVW->SetInput( layerIndexUVW, tempCastUVW->GetOutput() );
+      this->BlendUVW->SetInput( layerIndexUVW, this->AddSubtractCastUVW->GetOutput() );
       this->BlendUVW->SetOpacity( layerIndexUVW++, 1.0 );
-
-      tempMathUVW->Delete();  // Blend may still be holding a reference
-      tempCastUVW->Delete();  // Blend may still be holding a reference
       }
     else
       {
@@ -1106,6 +1321,15 @@ void vtkMRMLSliceLogic::UpdatePipeline()
       {
       modified = 1;
       }
+    unsigned long int oldCompositorMTime = this->Compositor->GetMTime();
+    bool fusedCompositingActive =
+      this->FusedCompositing && this->UpdateCompositor();
+    if (fusedCompositingActive != this->FusedCompositingActive ||
+        (fusedCompositingActive && this->Compositor->GetMTime() > oldCompositorMTime))
+      {
+      modified = 1;
+      }
+    this->FusedCompositingActive = fusedCompositingActive;
 
     //Models
     this->UpdateImageData();
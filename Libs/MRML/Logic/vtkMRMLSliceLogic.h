@@ -19,19 +19,25 @@
 #include "vtkMRMLAbstractLogic.h"
 
 // STD includes
+#include <utility>
 #include <vector>
 
 class vtkMRMLDisplayNode;
 class vtkMRMLLinearTransformNode;
 class vtkMRMLModelDisplayNode;
 class vtkMRMLModelNode;
+class vtkMRMLSceneNodesDelta;
 class vtkMRMLSliceCompositeNode;
 class vtkMRMLSliceLayerLogic;
 class vtkMRMLSliceNode;
+class vtkMRMLVolumeDisplayNode;
 class vtkMRMLVolumeNode;
 
 class vtkCollection;
 class vtkImageBlend;
+class vtkImageCast;
+class vtkImageMathematics;
+class vtkImageSliceCompositor;
 class vtkTransform;
 class vtkImageData;
 class vtkImageReslice;
@@ -136,6 +142,19 @@ public:
   vtkGetObjectMacro(Blend, vtkImageBlend);
   vtkGetObjectMacro(BlendUVW, vtkImageBlend);
 
+  /// Map and blend the layers of the 2D view in a single pass with
+  /// vtkImageSliceCompositor instead of the display node pipelines followed
+  /// by vtkImageBlend. It is only used for the alpha compositing modes of
+  /// scalar and label map volumes of 8 or 16 bit integer types, the regular
+  /// pipeline is used otherwise. Off by default.
+  /// \sa GetCompositor(), GetFusedCompositingActive()
+  vtkGetMacro(FusedCompositing, bool);
+  void SetFusedCompositing(bool fused);
+  vtkBooleanMacro(FusedCompositing, bool);
+  vtkGetObjectMacro(Compositor, vtkImageSliceCompositor);
+  /// Return true if the 2D view image is currently computed by the compositor
+  vtkGetMacro(FusedCompositingActive, bool);
+
   /// 
   /// The offset to the correct slice for lightbox mode
   vtkGetObjectMacro(ActiveSliceTransform, vtkTransform);
@@ -362,6 +381,8 @@ protected:
 
   virtual void OnMRMLSceneNodeAdded(vtkMRMLNode* node);
   virtual void OnMRMLSceneNodeRemoved(vtkMRMLNode* node);
+  virtual void OnMRMLSceneNodesChanged(vtkMRMLSceneNodesDelta* delta);
+  virtual void OnMRMLSceneEndBatchProcess();
   virtual void UpdateFromMRMLScene();
   virtual void OnMRMLSceneStartClose();
   virtual void OnMRMLSceneEndImport();
@@ -372,7 +393,16 @@ protected:
 
   virtual void OnMRMLNodeModified(vtkMRMLNode* node);
 
+  /// Set the layers of the compositor from the layer logics.
+  /// Return false if a layer can't be composited by vtkImageSliceCompositor.
+  /// \sa SetFusedCompositing()
+  bool UpdateCompositor();
+
   bool                        AddingSliceModelNodes;
+  /// False if the last batch process didn't change any node used by the
+  /// logic.
+  /// \sa OnMRMLSceneNodesChanged
+  bool                        UpdateSliceNodesAfterBatch;
   bool                        Initialized;
 
   char *                      Name;
@@ -387,6 +417,20 @@ protected:
 
   vtkImageBlend *   Blend;
   vtkImageBlend *   BlendUVW;
+  /// Filters of the add/subtract compositing modes. They are kept between
+  /// calls to UpdatePipeline() so they only re-execute when their inputs
+  /// change.
+  vtkImageMathematics * AddSubtractMath;
+  vtkImageCast *        AddSubtractCast;
+  vtkImageMathematics * AddSubtractMathUVW;
+  vtkImageCast *        AddSubtractCastUVW;
+  bool              FusedCompositing;
+  bool              FusedCompositingActive;
+  vtkImageSliceCompositor * Compositor;
+  /// Label map display nodes of the composited layers and their MTime when
+  /// their pipeline was last updated by UpdateCompositor().
+  std::vector<std::pair<vtkMRMLVolumeDisplayNode*, unsigned long> >
+                    CompositorLabelMapDisplayNodes;
   vtkImageReslice * ExtractModelTexture;
   vtkImageData *    ImageData;
   vtkTransform *    ActiveSliceTransform;
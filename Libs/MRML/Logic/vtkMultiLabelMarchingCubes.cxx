@@ -0,0 +1,399 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+#include "vtkMultiLabelMarchingCubes.h"
+
+// VTK includes
+#include <vtkCellArray.h>
+#include <vtkCompositeDataSet.h>
+#include <vtkFieldData.h>
+#include <vtkImageData.h>
+#include <vtkInformation.h>
+#include <vtkInformationVector.h>
+#include <vtkIntArray.h>
+#include <vtkMarchingCubesCases.h>
+#include <vtkMultiBlockDataSet.h>
+#include <vtkObjectFactory.h>
+#include <vtkPointData.h>
+#include <vtkPoints.h>
+#include <vtkPolyData.h>
+#include <vtkSmartPointer.h>
+#include <vtkStreamingDemandDrivenPipeline.h>
+
+// STD includes
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <sstream>
+#include <vector>
+
+vtkCxxRevisionMacro(vtkMultiLabelMarchingCubes, "$Revision$");
+vtkStandardNewMacro(vtkMultiLabelMarchingCubes);
+
+namespace
+{
+
+//----------------------------------------------------------------------------
+// Corners of a cube, in the order of vtkMarchingCubes
+const int CubeCorners[8][3] = {
+  {0, 0, 0}, {1, 0, 0}, {1, 1, 0}, {0, 1, 0},
+  {0, 0, 1}, {1, 0, 1}, {1, 1, 1}, {0, 1, 1}};
+
+// Corners of the edges of a cube, in the order of vtkMarchingCubes
+const int CubeEdges[12][2] = {
+  {0, 1}, {1, 2}, {3, 2}, {0, 3},
+  {4, 5}, {5, 6}, {7, 6}, {4, 7},
+  {0, 4}, {1, 5}, {3, 7}, {2, 6}};
+
+//----------------------------------------------------------------------------
+struct LabelSurface
+{
+  vtkSmartPointer<vtkPoints>    Points;
+  vtkSmartPointer<vtkCellArray> Polys;
+};
+
+typedef std::map<int, LabelSurface> LabelSurfaceMap;
+
+//----------------------------------------------------------------------------
+// Return the label of a voxel value, false if the value can't be a label.
+template <class T>
+bool vtkMultiLabelMarchingCubesLabel(T value, int& label)
+{
+  double doubleValue = static_cast<double>(value);
+  if (doubleValue < VTK_INT_MIN || doubleValue > VTK_INT_MAX ||
+      doubleValue != floor(doubleValue))
+    {
+    return false;
+    }
+  label = static_cast<int>(doubleValue);
+  return true;
+}
+
+//----------------------------------------------------------------------------
+template <class T>
+void vtkMultiLabelMarchingCubesExecute(vtkMultiLabelMarchingCubes* self,
+                                       const T* scalars, const int extent[6],
+                                       const double origin[3],
+                                       const double spacing[3],
+                                       bool allLabels,
+                                       LabelSurfaceMap& surfaces)
+{
+  vtkMarchingCubesTriangleCases* triangleCases =
+    vtkMarchingCubesTriangleCases::GetCases();
+
+  const vtkIdType incY = extent[1] - extent[0] + 1;
+  const vtkIdType incZ = incY * (extent[3] - extent[2] + 1);
+  const vtkIdType cornerOffsets[8] = {
+    0, 1, 1 + incY, incY, incZ, 1 + incZ, 1 + incY + incZ, incY + incZ};
+
+  // Point ids of the edges starting in the slice of the cubes and in the
+  // next slice, swapped after each slice of cubes. An edge crossed by the
+  // surfaces separates two labels: it has the id of the point of the label
+  // of its first voxel and the id of the point of the label of its second
+  // voxel, at 2 * (3 * voxel index in the slice + axis) + side.
+  const vtkIdType sliceSize = 6 * incZ;
+  if (sliceSize <= 0)
+    {
+    return;
+    }
+  std::vector<vtkIdType> edgePoints(2 * sliceSize, -1);
+  vtkIdType* sliceEdgePoints = &edgePoints[0];
+  vtkIdType* nextSliceEdgePoints = sliceEdgePoints + sliceSize;
+
+  LabelSurface* lastSurface = 0;
+  int lastLabel = 0;
+  const int numberOfSlices = extent[5] - extent[4];
+  for (int k = extent[4]; k < extent[5]; ++k)
+    {
+    if (self->GetAbortExecute())
+      {
+      break;
+      }
+    for (int j = extent[2]; j < extent[3]; ++j)
+      {
+      const T* ptr = scalars + (k - extent[4]) * incZ + (j - extent[2]) * incY;
+      for (int i = extent[0]; i < extent[1]; ++i, ++ptr)
+        {
+        T values[8];
+        bool uniform = true;
+        for (int c = 0; c < 8; ++c)
+          {
+          values[c] = ptr[cornerOffsets[c]];
+          uniform = uniform && values[c] == values[0];
+          }
+        // most of the cubes are inside a label
+        if (uniform)
+          {
+          continue;
+          }
+        int done = 0;
+        for (int c = 0; c < 8; ++c)
+          {
+          if (done & (1 << c))
+            {
+            continue;
+            }
+          // the corners of the label are "inside"
+          int caseIndex = 0;
+          for (int cc = c; cc < 8; ++cc)
+            {
+            if (values[cc] == values[c])
+              {
+              caseIndex |= (1 << cc);
+              }
+            }
+          done |= caseIndex;
+
+          int label = 0;
+          if (!vtkMultiLabelMarchingCubesLabel(values[c], label))
+            {
+            continue;
+            }
+          LabelSurface* surface = lastSurface;
+          if (!surface || label != lastLabel)
+            {
+            LabelSurfaceMap::iterator it = surfaces.find(label);
+            if (it == surfaces.end())
+              {
+              if (!allLabels || label == 0)
+                {
+                continue;
+                }
+              it = surfaces.insert(LabelSurfaceMap::value_type(label, LabelSurface())).first;
+              it->second.Points = vtkSmartPointer<vtkPoints>::New();
+              it->second.Polys = vtkSmartPointer<vtkCellArray>::New();
+              }
+            surface = &it->second;
+            lastSurface = surface;
+            lastLabel = label;
+            }
+
+          for (int* edge = triangleCases[caseIndex].edges; edge[0] > -1; edge += 3)
+            {
+            vtkIdType ptIds[3];
+            for (int e = 0; e < 3; ++e)
+              {
+              const int* corner0 = CubeCorners[CubeEdges[edge[e]][0]];
+              const int* corner1 = CubeCorners[CubeEdges[edge[e]][1]];
+              int axis = corner0[0] != corner1[0] ? 0 : (corner0[1] != corner1[1] ? 1 : 2);
+              // the first point of the edge is corner0 (see CubeEdges), the
+              // label is either on its side or on the side of corner1
+              const int side = values[CubeEdges[edge[e]][0]] == values[c] ? 0 : 1;
+              vtkIdType& edgePointId = (corner0[2] ? nextSliceEdgePoints : sliceEdgePoints)[
+                2 * (3 * ((j + corner0[1] - extent[2]) * incY +
+                          (i + corner0[0] - extent[0])) + axis) + side];
+              if (edgePointId >= 0)
+                {
+                ptIds[e] = edgePointId;
+                continue;
+                }
+              double x[3];
+              const int index[3] = {i, j, k};
+              for (int d = 0; d < 3; ++d)
+                {
+                double x0 = origin[d] + spacing[d] * (index[d] + corner0[d]);
+                double x1 = origin[d] + spacing[d] * (index[d] + corner1[d]);
+                x[d] = x0 + 0.5 * (x1 - x0);
+                }
+              ptIds[e] = surface->Points->InsertNextPoint(x);
+              edgePointId = ptIds[e];
+              }
+            surface->Polys->InsertNextCell(3, ptIds);
+            }
+          }
+        }
+      }
+    // the edges of the slice k are not shared with the next cubes
+    std::swap(sliceEdgePoints, nextSliceEdgePoints);
+    std::fill(nextSliceEdgePoints, nextSliceEdgePoints + sliceSize, -1);
+    self->UpdateProgress(static_cast<double>(k - extent[4] + 1) / numberOfSlices);
+    }
+}
+
+} // end of anonymous namespace
+
+//----------------------------------------------------------------------------
+vtkMultiLabelMarchingCubes::vtkMultiLabelMarchingCubes()
+{
+}
+
+//----------------------------------------------------------------------------
+vtkMultiLabelMarchingCubes::~vtkMultiLabelMarchingCubes()
+{
+}
+
+//----------------------------------------------------------------------------
+void vtkMultiLabelMarchingCubes::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+  os << indent << "Labels:";
+  for (size_t i = 0; i < this->Labels.size(); ++i)
+    {
+    os << " " << this->Labels[i];
+    }
+  os << (this->Labels.size() ? "" : " (all)") << "\n";
+}
+
+//----------------------------------------------------------------------------
+void vtkMultiLabelMarchingCubes::AddLabel(int label)
+{
+  this->Labels.push_back(label);
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+void vtkMultiLabelMarchingCubes::RemoveAllLabels()
+{
+  if (this->Labels.empty())
+    {
+    return;
+    }
+  this->Labels.clear();
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+int vtkMultiLabelMarchingCubes::GetNumberOfLabels()const
+{
+  return static_cast<int>(this->Labels.size());
+}
+
+//----------------------------------------------------------------------------
+int vtkMultiLabelMarchingCubes::GetLabel(int index)const
+{
+  if (index < 0 || index >= static_cast<int>(this->Labels.size()))
+    {
+    return 0;
+    }
+  return this->Labels[index];
+}
+
+//----------------------------------------------------------------------------
+vtkPolyData* vtkMultiLabelMarchingCubes::GetLabelSurface(int label)
+{
+  vtkMultiBlockDataSet* output = this->GetOutput();
+  for (unsigned int block = 0; output && block < output->GetNumberOfBlocks(); ++block)
+    {
+    vtkPolyData* surface = vtkPolyData::SafeDownCast(output->GetBlock(block));
+    vtkIntArray* labelArray = surface ?
+      vtkIntArray::SafeDownCast(surface->GetFieldData()->GetArray("Label")) : 0;
+    if (labelArray && labelArray->GetValue(0) == label)
+      {
+      return surface;
+      }
+    }
+  return 0;
+}
+
+//----------------------------------------------------------------------------
+int vtkMultiLabelMarchingCubes::FillInputPortInformation(int vtkNotUsed(port),
+                                                         vtkInformation *info)
+{
+  info->Set(vtkAlgorithm::INPUT_REQUIRED_DATA_TYPE(), "vtkImageData");
+  return 1;
+}
+
+//----------------------------------------------------------------------------
+int vtkMultiLabelMarchingCubes::RequestUpdateExtent(
+  vtkInformation *vtkNotUsed(request),
+  vtkInformationVector **inputVector,
+  vtkInformationVector *vtkNotUsed(outputVector))
+{
+  // the whole volume is needed
+  vtkInformation *inInfo = inputVector[0]->GetInformationObject(0);
+  inInfo->Set(vtkStreamingDemandDrivenPipeline::UPDATE_EXTENT(),
+              inInfo->Get(vtkStreamingDemandDrivenPipeline::WHOLE_EXTENT()), 6);
+  return 1;
+}
+
+//----------------------------------------------------------------------------
+int vtkMultiLabelMarchingCubes::RequestData(
+  vtkInformation *vtkNotUsed(request),
+  vtkInformationVector **inputVector,
+  vtkInformationVector *outputVector)
+{
+  vtkImageData *input = vtkImageData::GetData(inputVector[0]);
+  vtkMultiBlockDataSet *output = vtkMultiBlockDataSet::GetData(outputVector);
+  if (!input || !output)
+    {
+    return 0;
+    }
+
+  LabelSurfaceMap surfaces;
+  for (size_t i = 0; i < this->Labels.size(); ++i)
+    {
+    LabelSurface& surface = surfaces[this->Labels[i]];
+    surface.Points = vtkSmartPointer<vtkPoints>::New();
+    surface.Polys = vtkSmartPointer<vtkCellArray>::New();
+    }
+
+  vtkDataArray* scalars = input->GetPointData()->GetScalars();
+  if (scalars && scalars->GetNumberOfComponents() != 1)
+    {
+    vtkErrorMacro(<< "Only single component images are supported");
+    scalars = 0;
+    }
+  if (scalars)
+    {
+    int extent[6];
+    input->GetExtent(extent);
+    double origin[3];
+    input->GetOrigin(origin);
+    double spacing[3];
+    input->GetSpacing(spacing);
+    switch (scalars->GetDataType())
+      {
+      vtkTemplateMacro(
+        vtkMultiLabelMarchingCubesExecute(this,
+          static_cast<const VTK_TT*>(scalars->GetVoidPointer(0)),
+          extent, origin, spacing, this->Labels.empty(), surfaces));
+      default:
+        vtkErrorMacro(<< "Unsupported scalar type " << scalars->GetDataType());
+        break;
+      }
+    }
+
+  // one block per label, in the order of the labels
+  std::vector<int> labels = this->Labels;
+  if (labels.empty())
+    {
+    for (LabelSurfaceMap::iterator it = surfaces.begin(); it != surfaces.end(); ++it)
+      {
+      labels.push_back(it->first);
+      }
+    }
+  output->SetNumberOfBlocks(static_cast<unsigned int>(labels.size()));
+  for (size_t block = 0; block < labels.size(); ++block)
+    {
+    LabelSurface& surface = surfaces[labels[block]];
+    vtkSmartPointer<vtkPolyData> polyData = vtkSmartPointer<vtkPolyData>::New();
+    polyData->SetPoints(surface.Points);
+    polyData->SetPolys(surface.Polys);
+    polyData->Squeeze();
+
+    vtkSmartPointer<vtkIntArray> labelArray = vtkSmartPointer<vtkIntArray>::New();
+    labelArray->SetName("Label");
+    labelArray->InsertNextValue(labels[block]);
+    polyData->GetFieldData()->AddArray(labelArray);
+
+    unsigned int blockIndex = static_cast<unsigned int>(block);
+    output->SetBlock(blockIndex, polyData);
+    std::stringstream name;
+    name << labels[block];
+    output->GetMetaData(blockIndex)->Set(vtkCompositeDataSet::NAME(),
+                                         name.str().c_str());
+    }
+  return 1;
+}
@@ -0,0 +1,84 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+#ifndef __vtkMultiLabelMarchingCubes_h
+#define __vtkMultiLabelMarchingCubes_h
+
+// VTK includes
+#include <vtkMultiBlockDataSetAlgorithm.h>
+
+#include "vtkMRMLLogicWin32Header.h"
+
+// STD includes
+#include <vector>
+
+class vtkPolyData;
+
+/// \brief Extract the surface of every label of a label map in one pass.
+///
+/// Running vtkDiscreteMarchingCubes (or a threshold followed by
+/// vtkMarchingCubes) once per label walks the whole volume for each label.
+/// vtkMultiLabelMarchingCubes walks the cubes of the volume once and adds
+/// the triangles of each label found at the corners of a cube to the
+/// surface of that label.
+///
+/// The output is a vtkMultiBlockDataSet with one vtkPolyData per label, in
+/// the order of the labels (see GetLabel()). The name of a block is its
+/// label and its field data has a single value "Label" array.
+/// The surface of a label is the one vtkDiscreteMarchingCubes generates for
+/// that label: points are at the middle of the cube edges so adjacent
+/// labels share their boundaries, and triangles are oriented like
+/// vtkMarchingCubes orients them (the label is "inside").
+/// Only single component images are supported.
+class VTK_MRML_LOGIC_EXPORT vtkMultiLabelMarchingCubes
+  : public vtkMultiBlockDataSetAlgorithm
+{
+public:
+  static vtkMultiLabelMarchingCubes *New();
+  vtkTypeRevisionMacro(vtkMultiLabelMarchingCubes, vtkMultiBlockDataSetAlgorithm);
+  virtual void PrintSelf(ostream& os, vtkIndent indent);
+
+  /// Labels to extract a surface for, one output block per label.
+  /// If no label is set, all the labels but 0 found in the input
+  /// are extracted, in increasing order.
+  void AddLabel(int label);
+  void RemoveAllLabels();
+  int GetNumberOfLabels()const;
+  int GetLabel(int index)const;
+
+  /// Convenience method to get the surface of a label after Update().
+  /// Return 0 if the label is not in the output.
+  vtkPolyData* GetLabelSurface(int label);
+
+protected:
+  vtkMultiLabelMarchingCubes();
+  ~vtkMultiLabelMarchingCubes();
+
+  virtual int FillInputPortInformation(int port, vtkInformation *info);
+  virtual int RequestUpdateExtent(vtkInformation *request,
+                                  vtkInformationVector **inputVector,
+                                  vtkInformationVector *outputVector);
+  virtual int RequestData(vtkInformation *request,
+                          vtkInformationVector **inputVector,
+                          vtkInformationVector *outputVector);
+
+  std::vector<int> Labels;
+
+private:
+  vtkMultiLabelMarchingCubes(const vtkMultiLabelMarchingCubes&);  // Not implemented.
+  void operator=(const vtkMultiLabelMarchingCubes&);  // Not implemented.
+};
+
+#endif
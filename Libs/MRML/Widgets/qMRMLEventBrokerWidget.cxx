@@ -19,6 +19,10 @@
 ==============================================================================*/
 
 // Qt includes
+#include <QCheckBox>
+#include <QHeaderView>
+#include <QTabWidget>
+#include <QTableWidget>
 #include <QTreeWidget>
 #include <QVBoxLayout>
 
@@ -35,7 +39,10 @@
 #include <vtkObservation.h>
 
 // VTK includes
+#include <vtkAbstractArray.h>
 #include <vtkCallbackCommand.h>
+#include <vtkNew.h>
+#include <vtkTable.h>
 
 // STD includes
 #ifdef HAVE_STDINT_H
@@ -74,12 +81,16 @@ public:
   void addObservation(vtkObservation* observation);
 
   QTreeWidget* ConnectionsTreeWidget;
+  QCheckBox* ProfilingCheckBox;
+  QTableWidget* ProfilesTableWidget;
 };
 
 //------------------------------------------------------------------------------
 qMRMLEventBrokerWidgetPrivate::qMRMLEventBrokerWidgetPrivate()
 {
   this->ConnectionsTreeWidget = 0;
+  this->ProfilingCheckBox = 0;
+  this->ProfilesTableWidget = 0;
 }
 
 //------------------------------------------------------------------------------
@@ -280,8 +291,33 @@ void qMRMLEventBrokerWidgetPrivate::setupUi(QWidget* parentWidget)
   QObject::connect(this->ConnectionsTreeWidget, SIGNAL(currentItemChanged(QTreeWidgetItem*,QTreeWidgetItem*)),
                    parentWidget, SLOT(onCurrentItemChanged(QTreeWidgetItem*)));
 
+  // Profiles
+  this->ProfilingCheckBox = new QCheckBox("Profile invocations");
+  this->ProfilingCheckBox->setToolTip(
+    "Collect the timings of the invocations per subject class, event and observer class");
+  this->ProfilingCheckBox->setChecked(
+    vtkEventBroker::GetInstance()->GetEventProfiling());
+  QObject::connect(this->ProfilingCheckBox, SIGNAL(toggled(bool)),
+                   parentWidget, SLOT(setProfilingEnabled(bool)));
+
+  this->ProfilesTableWidget = new QTableWidget;
+  this->ProfilesTableWidget->setEditTriggers(QAbstractItemView::NoEditTriggers);
+  this->ProfilesTableWidget->setSelectionBehavior(QAbstractItemView::SelectRows);
+  this->ProfilesTableWidget->verticalHeader()->hide();
+
+  QWidget* profilesWidget = new QWidget;
+  QVBoxLayout* profilesLayout = new QVBoxLayout;
+  profilesLayout->addWidget(this->ProfilingCheckBox);
+  profilesLayout->addWidget(this->ProfilesTableWidget);
+  profilesLayout->setContentsMargins(0, 0, 0, 0);
+  profilesWidget->setLayout(profilesLayout);
+
+  QTabWidget* tabWidget = new QTabWidget;
+  tabWidget->addTab(this->ConnectionsTreeWidget, "Connections");
+  tabWidget->addTab(profilesWidget, "Profiles");
+
   QVBoxLayout* vBoxLayout = new QVBoxLayout;
-  vBoxLayout->addWidget(this->ConnectionsTreeWidget);
+  vBoxLayout->addWidget(tabWidget);
   vBoxLayout->setContentsMargins(0, 0, 0, 0);
   parentWidget->setLayout(vBoxLayout);
   
@@ -323,6 +359,55 @@ void qMRMLEventBrokerWidget::refresh()
   d->ConnectionsTreeWidget->setSortingEnabled(isSortingEnabled);
   //d->ConnectionsTreeWidget->expandAll();
   d->ConnectionsTreeWidget->resizeColumnToContents(0);
+
+  this->refreshProfiles();
+}
+
+//------------------------------------------------------------------------------
+void qMRMLEventBrokerWidget::setProfilingEnabled(bool enable)
+{
+  Q_D(qMRMLEventBrokerWidget);
+  vtkEventBroker::GetInstance()->SetEventProfiling(enable ? 1 : 0);
+  d->ProfilingCheckBox->setChecked(enable);
+}
+
+//------------------------------------------------------------------------------
+void qMRMLEventBrokerWidget::refreshProfiles()
+{
+  Q_D(qMRMLEventBrokerWidget);
+  vtkNew<vtkTable> profiles;
+  vtkEventBroker::GetInstance()->GetProfiles(profiles.GetPointer());
+
+  d->ProfilesTableWidget->setSortingEnabled(false);
+  d->ProfilesTableWidget->clear();
+  d->ProfilesTableWidget->setColumnCount(profiles->GetNumberOfColumns());
+  d->ProfilesTableWidget->setRowCount(profiles->GetNumberOfRows());
+  QStringList headers;
+  for (vtkIdType column = 0; column < profiles->GetNumberOfColumns(); ++column)
+    {
+    vtkAbstractArray* array = profiles->GetColumn(column);
+    headers << array->GetName();
+    for (vtkIdType row = 0; row < profiles->GetNumberOfRows(); ++row)
+      {
+      vtkVariant value = profiles->GetValue(row, column);
+      QTableWidgetItem* item = new QTableWidgetItem;
+      if (value.IsString())
+        {
+        item->setText(value.ToString().c_str());
+        }
+      else
+        {
+        // Keep the value numeric for sorting
+        item->setData(Qt::DisplayRole, value.ToDouble());
+        }
+      d->ProfilesTableWidget->setItem(row, column, item);
+      }
+    }
+  d->ProfilesTableWidget->setHorizontalHeaderLabels(headers);
+  d->ProfilesTableWidget->setSortingEnabled(true);
+  // Slowest observations first
+  d->ProfilesTableWidget->sortItems(headers.indexOf("Total"), Qt::DescendingOrder);
+  d->ProfilesTableWidget->resizeColumnsToContents();
 }
 
 //------------------------------------------------------------------------------
@@ -374,6 +459,7 @@ void qMRMLEventBrokerWidget::resetElapsedTimes()
     observation->SetTotalElapsedTime(0.);
     observation->SetLastElapsedTime(0.);
     }
+  eventBroker->ResetProfiles();
   this->refresh();
 }
 
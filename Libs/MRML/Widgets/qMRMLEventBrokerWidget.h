@@ -49,6 +49,12 @@ public slots:
   void resetElapsedTimes();
   void expandElapsedTimeItems();
 
+  /// Turn on/off the profiling of the invocations by the event broker.
+  /// \sa vtkEventBroker::SetEventProfiling
+  void setProfilingEnabled(bool enable);
+  /// Update the table of profiles with the current timings of the broker.
+  void refreshProfiles();
+
 signals:
   void currentObjectChanged(vtkObject*);
 
@@ -30,6 +30,7 @@
 #include <vtkMRMLDisplayableNode.h>
 #include <vtkMRMLDisplayNode.h>
 #include <vtkMRMLScene.h>
+#include <vtkMRMLSceneNodesDelta.h>
 
 // VTK includes
 #include <vtkCollection.h>
@@ -44,6 +45,7 @@ qMRMLSceneModelPrivate::qMRMLSceneModelPrivate(qMRMLSceneModel& object)
 
   this->CallBack = vtkSmartPointer<vtkCallbackCommand>::New();
   this->LazyUpdate = false;
+  this->UpToDateAfterBatchProcess = false;
   this->ListenNodeModifiedEvent = qMRMLSceneModel::NoNodes;
   this->PendingItemModified = -1; // -1 means not updating
 
@@ -70,6 +72,7 @@ qMRMLSceneModelPrivate::~qMRMLSceneModelPrivate()
   if (this->MRMLScene)
     {
     this->MRMLScene->RemoveObserver(this->CallBack);
+    this->MRMLScene->UnregisterNodesDeltaObserver();
     }
 }
 
@@ -342,6 +345,7 @@ void qMRMLSceneModel::setMRMLScene(vtkMRMLScene* scene)
   if (d->MRMLScene)
     {
     d->MRMLScene->RemoveObserver(d->CallBack);
+    d->MRMLScene->UnregisterNodesDeltaObserver();
     }
   d->MRMLScene = scene;
   this->updateScene();
@@ -358,6 +362,8 @@ void qMRMLSceneModel::setMRMLScene(vtkMRMLScene* scene)
     scene->AddObserver(vtkMRMLScene::EndImportEvent, d->CallBack);
     scene->AddObserver(vtkMRMLScene::StartBatchProcessEvent, d->CallBack);
     scene->AddObserver(vtkMRMLScene::EndBatchProcessEvent, d->CallBack);
+    scene->AddObserver(vtkMRMLScene::NodesChangedEvent, d->CallBack);
+    scene->RegisterNodesDeltaObserver();
     }
 }
 
@@ -1150,6 +1156,11 @@ void qMRMLSceneModel::onMRMLSceneEvent(vtkObject* vtk_obj, unsigned long event,
     case vtkMRMLScene::EndBatchProcessEvent:
       sceneModel->onMRMLSceneEndBatchProcess(scene);
       break;
+    case vtkMRMLScene::NodesChangedEvent:
+      Q_ASSERT(call_data);
+      sceneModel->onMRMLSceneNodesChanged(
+        scene, reinterpret_cast<vtkMRMLSceneNodesDelta*>(call_data));
+      break;
     }
 }
 
@@ -1453,9 +1464,14 @@ void qMRMLSceneModel::onMRMLSceneImported(vtkMRMLScene* scene)
 {
   Q_D(qMRMLSceneModel);
   Q_UNUSED(scene);
-  if (d->LazyUpdate)
+  // In lazy mode, the model is updated only once at the end of the batch
+  // process.
+  if (d->LazyUpdate &&
+      !d->UpToDateAfterBatchProcess &&
+      !d->MRMLScene->IsBatchProcessing())
     {
     this->updateScene();
+    d->UpToDateAfterBatchProcess = true;
     }
   //this->endResetModel();
 }
@@ -1472,6 +1488,11 @@ void qMRMLSceneModel::onMRMLSceneClosed(vtkMRMLScene* scene)
 {
   Q_D(qMRMLSceneModel);
   Q_UNUSED(scene);
+  if (d->LazyUpdate && d->UpToDateAfterBatchProcess)
+    {
+    // Already done in onMRMLSceneNodesChanged
+    return;
+    }
   this->updateScene();
 }
 
@@ -1480,6 +1501,7 @@ void qMRMLSceneModel::onMRMLSceneStartBatchProcess(vtkMRMLScene* scene)
 {
   Q_D(qMRMLSceneModel);
   Q_UNUSED(scene);
+  d->UpToDateAfterBatchProcess = false;
   if (d->LazyUpdate)
     {
     emit sceneAboutToBeUpdated();
@@ -1493,9 +1515,59 @@ void qMRMLSceneModel::onMRMLSceneEndBatchProcess(vtkMRMLScene* scene)
   Q_UNUSED(scene);
   if (d->LazyUpdate)
     {
-    this->updateScene();
+    if (!d->UpToDateAfterBatchProcess)
+      {
+      this->updateScene();
+      }
     emit sceneUpdated();
     }
+  d->UpToDateAfterBatchProcess = false;
+}
+
+//------------------------------------------------------------------------------
+void qMRMLSceneModel::onMRMLSceneNodesChanged(vtkMRMLScene* scene,
+                                              vtkMRMLSceneNodesDelta* delta)
+{
+  Q_D(qMRMLSceneModel);
+  Q_ASSERT(scene == d->MRMLScene);
+  Q_ASSERT(delta);
+  if (!d->LazyUpdate)
+    {
+    // The model has been kept in sync node by node.
+    return;
+    }
+  // Searching the items of a node browses the whole model, resetting the
+  // model is faster when a significant part of the scene has changed.
+  const int changeCount = delta->GetNumberOfAddedNodes()
+    + delta->GetNumberOfRemovedNodes()
+    + delta->GetNumberOfModifiedNodes();
+  if (changeCount * 8 > scene->GetNumberOfNodes())
+    {
+    this->updateScene();
+    d->UpToDateAfterBatchProcess = true;
+    return;
+    }
+  // The scene is no longer in batch process mode, the nodes can be
+  // processed as if they were added or removed one by one.
+  for (int i = 0; i < delta->GetNumberOfRemovedNodes(); ++i)
+    {
+    vtkMRMLNode* node = delta->GetNthRemovedNode(i);
+    this->onMRMLSceneNodeAboutToBeRemoved(scene, node);
+    this->onMRMLSceneNodeRemoved(scene, node);
+    }
+  for (int i = 0; i < delta->GetNumberOfAddedNodes(); ++i)
+    {
+    this->insertNode(delta->GetNthAddedNode(i));
+    }
+  for (int i = 0; i < delta->GetNumberOfModifiedNodes(); ++i)
+    {
+    vtkMRMLNode* node = delta->GetNthModifiedNode(i);
+    if (this->itemFromNode(node))
+      {
+      this->updateNodeItems(node, QString(node->GetID()));
+      }
+    }
+  d->UpToDateAfterBatchProcess = true;
 }
 
 //------------------------------------------------------------------------------
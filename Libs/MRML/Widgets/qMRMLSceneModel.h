@@ -33,6 +33,7 @@
 
 class vtkMRMLNode;
 class vtkMRMLScene;
+class vtkMRMLSceneNodesDelta;
 class QAction;
 
 class qMRMLSceneModelPrivate;
@@ -72,7 +73,9 @@ class QMRML_WIDGETS_EXPORT qMRMLSceneModel : public QStandardItemModel
   /// Control wether the model actively listens to the scene.
   /// If LazyUpdate is true, the model ignores added node events when the
   /// scene is importing/restoring, but synchronize with the scene once its
-  /// imported/restored.
+  /// imported/restored. When the batch process only changed a few nodes
+  /// (vtkMRMLScene::NodesChangedEvent), only their items are updated
+  /// instead of resetting the whole model.
   Q_PROPERTY (bool lazyUpdate READ lazyUpdate WRITE setLazyUpdate)
 
   /// Control in which column vtkMRMLNode names are displayed (Qt::DisplayRole).
@@ -230,6 +233,8 @@ protected slots:
   virtual void onMRMLSceneClosed(vtkMRMLScene* scene);
   virtual void onMRMLSceneStartBatchProcess(vtkMRMLScene* scene);
   virtual void onMRMLSceneEndBatchProcess(vtkMRMLScene* scene);
+  virtual void onMRMLSceneNodesChanged(vtkMRMLScene* scene,
+                                       vtkMRMLSceneNodesDelta* delta);
 
   void onMRMLSceneDeleted(vtkObject* scene);
 
@@ -63,6 +63,9 @@ public:
   vtkSmartPointer<vtkCallbackCommand> CallBack;
   qMRMLSceneModel::NodeTypes ListenNodeModifiedEvent;
   bool LazyUpdate;
+  /// True if the model has already been synchronized with the scene since
+  /// the last batch process started.
+  bool UpToDateAfterBatchProcess;
   int PendingItemModified;
   
   int NameColumn;
@@ -32,6 +32,7 @@
 #include "qMRMLVolumeWidget_p.h"
 
 // MRML includes
+#include "vtkImageHistogramCache.h"
 #include "vtkMRMLScalarVolumeNode.h"
 #include "vtkMRMLScalarVolumeDisplayNode.h"
 
@@ -182,7 +183,8 @@ void qMRMLVolumeWidgetPrivate
     }
   else if (this->VolumeNode->GetImageData())
     {
-    this->VolumeNode->GetImageData()->GetScalarRange(range);
+    vtkImageHistogramCache::GetInstance()->GetScalarRange(
+      this->VolumeNode->GetImageData(), range);
     }
   else
     {
@@ -0,0 +1,180 @@
+// vtkITK includes
+#include "vtkITKGrowCutSegmentationImageFilter.h"
+
+// VTK includes
+#include <vtkImageData.h>
+#include <vtkNew.h>
+#include <vtkSmartPointer.h>
+
+// STD includes
+#include <cstring>
+#include <iostream>
+
+namespace
+{
+const int Size = 32;
+
+//-----------------------------------------------------------------------------
+vtkSmartPointer<vtkImageData> newImage(int scalarType)
+{
+  vtkSmartPointer<vtkImageData> image = vtkSmartPointer<vtkImageData>::New();
+  image->SetDimensions(Size, Size, Size);
+  image->SetScalarType(scalarType);
+  image->SetNumberOfScalarComponents(1);
+  image->AllocateScalars();
+  return image;
+}
+
+//-----------------------------------------------------------------------------
+int squaredDistanceToCenter(int i, int j, int k)
+{
+  const int c = Size / 2;
+  return (i - c) * (i - c) + (j - c) * (j - c) + (k - c) * (k - c);
+}
+
+//-----------------------------------------------------------------------------
+void paint(vtkImageData* gestures, int i, int j, int k, short label)
+{
+  for (int z = k - 1; z <= k + 1; ++z)
+    {
+    for (int y = j - 1; y <= j + 1; ++y)
+      {
+      for (int x = i - 1; x <= i + 1; ++x)
+        {
+        *static_cast<short*>(gestures->GetScalarPointer(x, y, z)) = label;
+        }
+      }
+    }
+}
+
+//-----------------------------------------------------------------------------
+vtkImageData* runGrowCut(vtkITKGrowCutSegmentationImageFilter* filter,
+                         vtkImageData* intensities, vtkImageData* gestures)
+{
+  vtkSmartPointer<vtkImageData> previous = newImage(VTK_SHORT);
+  memset(previous->GetScalarPointer(), 0, Size * Size * Size * sizeof(short));
+  filter->SetInput(0, intensities);
+  filter->SetInput(1, gestures);
+  filter->SetInput(2, previous);
+  filter->SetObjectSize(Size * 2);
+  filter->SetContrastNoiseRatio(0.8);
+  filter->SetPriorSegmentConfidence(0.003);
+  filter->Update();
+  return filter->GetOutput();
+}
+
+//-----------------------------------------------------------------------------
+vtkIdType countDifferences(vtkImageData* expected, vtkImageData* segmentation)
+{
+  const vtkIdType numberOfVoxels = expected->GetNumberOfPoints();
+  const short* expectedLabels = static_cast<short*>(expected->GetScalarPointer());
+  const short* labels = static_cast<short*>(segmentation->GetScalarPointer());
+  vtkIdType differences = 0;
+  for (vtkIdType i = 0; i < numberOfVoxels; ++i)
+    {
+    differences += (expectedLabels[i] != labels[i]) ? 1 : 0;
+    }
+  return differences;
+}
+
+} // end of anonymous namespace
+
+//-----------------------------------------------------------------------------
+int main( int, char** )
+{
+  // bright sphere on a dark, slightly textured background
+  vtkSmartPointer<vtkImageData> intensities = newImage(VTK_FLOAT);
+  vtkSmartPointer<vtkImageData> gestures = newImage(VTK_SHORT);
+  for (int k = 0; k < Size; ++k)
+    {
+    for (int j = 0; j < Size; ++j)
+      {
+      for (int i = 0; i < Size; ++i)
+        {
+        *static_cast<float*>(intensities->GetScalarPointer(i, j, k)) =
+          (squaredDistanceToCenter(i, j, k) < 8 * 8 ? 100.f : 0.f) +
+          static_cast<float>((i * 7 + j * 13 + k * 3) % 5);
+        *static_cast<short*>(gestures->GetScalarPointer(i, j, k)) = 0;
+        }
+      }
+    }
+  paint(gestures, Size / 2, Size / 2, Size / 2, 1);
+  paint(gestures, 2, 2, 2, 2);
+
+  vtkNew<vtkITKGrowCutSegmentationImageFilter> growCut;
+  growCut->UsePreviousSegmentationOn();
+  vtkImageData* segmentation = runGrowCut(growCut.GetPointer(), intensities, gestures);
+  for (int k = 1; k < Size - 1; ++k)
+    {
+    for (int j = 1; j < Size - 1; ++j)
+      {
+      for (int i = 1; i < Size - 1; ++i)
+        {
+        const int distance = squaredDistanceToCenter(i, j, k);
+        const short label = *static_cast<short*>(segmentation->GetScalarPointer(i, j, k));
+        if ((distance < 6 * 6 && label != 1) || (distance > 10 * 10 && label != 2))
+          {
+          std::cerr << "Wrong label " << label << " at " << i << " " << j << " " << k << std::endl;
+          return 1;
+          }
+        }
+      }
+    }
+
+  // Add a seed to the previous segmentation: the filter restarts from the
+  // previous strengths, which gives the segmentation of all the seeds.
+  vtkSmartPointer<vtkImageData> newGestures = newImage(VTK_SHORT);
+  newGestures->DeepCopy(segmentation);
+  paint(newGestures, Size - 4, 3, 3, 1);
+  vtkSmartPointer<vtkImageData> restarted = vtkSmartPointer<vtkImageData>::New();
+  restarted->DeepCopy(runGrowCut(growCut.GetPointer(), intensities, newGestures));
+
+  vtkSmartPointer<vtkImageData> allGestures = newImage(VTK_SHORT);
+  allGestures->DeepCopy(gestures);
+  paint(allGestures, Size - 4, 3, 3, 1);
+  vtkNew<vtkITKGrowCutSegmentationImageFilter> fromScratch;
+  vtkImageData* expected = runGrowCut(fromScratch.GetPointer(), intensities, allGestures);
+
+  const vtkIdType numberOfVoxels = expected->GetNumberOfPoints();
+  vtkIdType differences = countDifferences(expected, restarted);
+  // ties between equally strong labels may be broken differently
+  if (differences > numberOfVoxels / 100 ||
+      *static_cast<short*>(restarted->GetScalarPointer(Size - 4, 3, 3)) != 1)
+    {
+    std::cerr << "Restarted segmentation differs in " << differences
+              << " voxels" << std::endl;
+    return 1;
+    }
+
+  // The active front gives the same segmentation as the evaluation of all
+  // the voxels at each iteration
+  vtkNew<vtkITKGrowCutSegmentationImageFilter> allVoxels;
+  allVoxels->UseActiveFrontOff();
+  differences = countDifferences(
+    expected, runGrowCut(allVoxels.GetPointer(), intensities, allGestures));
+  // ties between equally strong labels may be broken differently
+  if (differences > numberOfVoxels / 100)
+    {
+    std::cerr << "Segmentation without active front differs in "
+              << differences << " voxels" << std::endl;
+    return 1;
+    }
+
+  // The cells of the active front are evaluated independently: the
+  // segmentation does not depend on the number of threads
+  for (int threads = 1; threads <= 4; threads *= 2)
+    {
+    vtkNew<vtkITKGrowCutSegmentationImageFilter> threaded;
+    threaded->SetNumberOfThreads(threads);
+    differences = countDifferences(
+      expected, runGrowCut(threaded.GetPointer(), intensities, allGestures));
+    if (differences != 0)
+      {
+      std::cerr << "Segmentation with " << threads << " threads differs in "
+                << differences << " voxels" << std::endl;
+      return 1;
+      }
+    }
+
+  return 0;
+}
@@ -0,0 +1,274 @@
+// vtkITK includes
+#include "itkTimeSeriesDatabase.h"
+
+// ITK includes
+#include <itkImage.h>
+#include <itkImageFileWriter.h>
+#include <itkImageRegionIteratorWithIndex.h>
+#include <itksys/SystemTools.hxx>
+
+// STD includes
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace
+{
+typedef itk::Image<short, 3> ImageType;
+typedef itk::TimeSeriesDatabase<short> DatabaseType;
+
+// Not a multiple of the 16 voxel blocks, so that there are edge blocks
+// along each axis.
+const int Dimensions[3] = {20, 17, 33};
+const unsigned int NumberOfVolumes = 5;
+// 16 blocks per file, the database is split in several files
+const unsigned long FileSize = 16 * 16 * 16 * 16 * sizeof(short);
+
+//-----------------------------------------------------------------------------
+short expectedValue(const ImageType::IndexType& index, unsigned int volume)
+{
+  return static_cast<short>(
+    (index[0] + 3 * index[1] + 7 * index[2] + 101 * volume) % 3000 - 1000);
+}
+
+//-----------------------------------------------------------------------------
+std::string volumeFileName(const std::string& directory, unsigned int volume)
+{
+  std::ostringstream fileName;
+  fileName << directory << "/timeSeriesVolume_0" << volume << ".nrrd";
+  return fileName.str();
+}
+
+//-----------------------------------------------------------------------------
+void writeVolumes(const std::string& directory)
+{
+  ImageType::RegionType region;
+  ImageType::SizeType size;
+  for (int i = 0; i < 3; ++i)
+    {
+    size[i] = Dimensions[i];
+    }
+  region.SetSize(size);
+  for (unsigned int volume = 0; volume < NumberOfVolumes; ++volume)
+    {
+    ImageType::Pointer image = ImageType::New();
+    image->SetRegions(region);
+    image->Allocate();
+    itk::ImageRegionIteratorWithIndex<ImageType> it(image, region);
+    for (it.GoToBegin(); !it.IsAtEnd(); ++it)
+      {
+      it.Set(expectedValue(it.GetIndex(), volume));
+      }
+    typedef itk::ImageFileWriter<ImageType> WriterType;
+    WriterType::Pointer writer = WriterType::New();
+    writer->SetInput(image);
+    writer->SetFileName(volumeFileName(directory, volume));
+    writer->Update();
+    }
+}
+
+//-----------------------------------------------------------------------------
+// Return the content of the database files, the header file first.
+std::vector<std::string> readDatabaseFiles(const std::string& databaseFileName)
+{
+  std::vector<std::string> contents;
+  for (unsigned int fileIndex = 0; ; ++fileIndex)
+    {
+    std::ostringstream fileName;
+    fileName << databaseFileName;
+    if (fileIndex > 0)
+      {
+      fileName << fileIndex;
+      }
+    std::ifstream file(fileName.str().c_str(), std::ios::in | std::ios::binary);
+    if (!file)
+      {
+      break;
+      }
+    std::ostringstream content;
+    content << file.rdbuf();
+    contents.push_back(content.str());
+    }
+  return contents;
+}
+
+//-----------------------------------------------------------------------------
+bool checkVoxelTimeSeries(DatabaseType* database)
+{
+  DatabaseType::ArrayType timeSeries;
+  ImageType::IndexType index;
+  for (index[2] = 0; index[2] < Dimensions[2]; ++index[2])
+    {
+    for (index[1] = 0; index[1] < Dimensions[1]; ++index[1])
+      {
+      for (index[0] = 0; index[0] < Dimensions[0]; ++index[0])
+        {
+        database->GetVoxelTimeSeries(index, timeSeries);
+        if (timeSeries.GetSize() != NumberOfVolumes)
+          {
+          std::cerr << "Wrong time series size " << timeSeries.GetSize() << std::endl;
+          return false;
+          }
+        for (unsigned int volume = 0; volume < NumberOfVolumes; ++volume)
+          {
+          if (timeSeries[volume] != expectedValue(index, volume))
+            {
+            std::cerr << "Wrong time series value at " << index << " volume "
+                      << volume << ": " << timeSeries[volume] << std::endl;
+            return false;
+            }
+          }
+        }
+      }
+    }
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+bool checkVolume(DatabaseType* database, unsigned int volume,
+                 const ImageType::RegionType& region)
+{
+  database->SetCurrentImage(volume);
+  database->UpdateOutputInformation();
+  database->GetOutput()->SetRequestedRegion(region);
+  database->Update();
+  ImageType* output = database->GetOutput();
+  if (!output->GetBufferedRegion().IsInside(region))
+    {
+    std::cerr << "Region " << region << " not generated" << std::endl;
+    return false;
+    }
+  itk::ImageRegionIteratorWithIndex<ImageType> it(output, region);
+  for (it.GoToBegin(); !it.IsAtEnd(); ++it)
+    {
+    if (it.Get() != expectedValue(it.GetIndex(), volume))
+      {
+      std::cerr << "Wrong value at " << it.GetIndex() << " of volume "
+                << volume << ": " << it.Get() << std::endl;
+      return false;
+      }
+    }
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+bool checkDatabase(const std::string& databaseFileName, bool useMemoryMapping)
+{
+  DatabaseType::Pointer database = DatabaseType::New();
+  database->SetUseMemoryMapping(useMemoryMapping);
+  // A small cache, so that blocks are evicted
+  database->SetCacheSizeInMiB(0.05);
+  database->Connect(databaseFileName.c_str());
+#ifndef _WIN32
+  if (database->IsMemoryMapped() != useMemoryMapping)
+    {
+    std::cerr << "Memory mapping is not " << useMemoryMapping << std::endl;
+    return false;
+    }
+#endif
+  if (database->GetNumberOfVolumes() != static_cast<int>(NumberOfVolumes))
+    {
+    std::cerr << "Wrong number of volumes " << database->GetNumberOfVolumes()
+              << std::endl;
+    return false;
+    }
+
+  if (!checkVoxelTimeSeries(database))
+    {
+    return false;
+    }
+
+  // A region across the edge blocks and one inside a single block
+  ImageType::RegionType edgeRegion;
+  edgeRegion.SetIndex(0, 3);
+  edgeRegion.SetIndex(1, 5);
+  edgeRegion.SetIndex(2, 10);
+  edgeRegion.SetSize(0, Dimensions[0] - 3);
+  edgeRegion.SetSize(1, Dimensions[1] - 5);
+  edgeRegion.SetSize(2, Dimensions[2] - 10);
+  ImageType::RegionType innerRegion;
+  innerRegion.SetIndex(0, 17);
+  innerRegion.SetIndex(1, 2);
+  innerRegion.SetIndex(2, 20);
+  innerRegion.SetSize(0, 2);
+  innerRegion.SetSize(1, 4);
+  innerRegion.SetSize(2, 8);
+  for (unsigned int volume = 0; volume < NumberOfVolumes; ++volume)
+    {
+    // from the smallest region to the largest, so that each is generated
+    if (!checkVolume(database, volume, innerRegion) ||
+        !checkVolume(database, volume, edgeRegion) ||
+        !checkVolume(database, volume, database->GetOutputRegion()))
+      {
+      return false;
+      }
+    }
+  database->Disconnect();
+  return true;
+}
+
+} // end of anonymous namespace
+
+//-----------------------------------------------------------------------------
+int main(int argc, char* argv[])
+{
+  if (argc < 2)
+    {
+    std::cerr << "Usage: " << argv[0] << " <temporary directory>" << std::endl;
+    return EXIT_FAILURE;
+    }
+  std::string directory = argv[1];
+  std::string databaseFileName = directory + "/VTKITKTimeSeriesDatabase.tsd";
+
+  try
+    {
+    writeVolumes(directory);
+
+    // The threads write the volumes at their own place in the files
+    DatabaseType::CreateFromFileArchetype(databaseFileName.c_str(),
+      volumeFileName(directory, 0).c_str(), FileSize, 1);
+    std::vector<std::string> singleThreadFiles = readDatabaseFiles(databaseFileName);
+    if (singleThreadFiles.size() < 2)
+      {
+      std::cerr << "The database is not split in several files" << std::endl;
+      return EXIT_FAILURE;
+      }
+    DatabaseType::CreateFromFileArchetype(databaseFileName.c_str(),
+      volumeFileName(directory, 0).c_str(), FileSize, 3);
+    if (readDatabaseFiles(databaseFileName) != singleThreadFiles)
+      {
+      std::cerr << "The database depends on the number of threads" << std::endl;
+      return EXIT_FAILURE;
+      }
+
+    if (!checkDatabase(databaseFileName, true) ||
+        !checkDatabase(databaseFileName, false))
+      {
+      return EXIT_FAILURE;
+      }
+
+    for (unsigned int volume = 0; volume < NumberOfVolumes; ++volume)
+      {
+      itksys::SystemTools::RemoveFile(volumeFileName(directory, volume).c_str());
+      }
+    for (unsigned int fileIndex = 0; fileIndex < singleThreadFiles.size(); ++fileIndex)
+      {
+      std::ostringstream fileName;
+      fileName << databaseFileName;
+      if (fileIndex > 0)
+        {
+        fileName << fileIndex;
+        }
+      itksys::SystemTools::RemoveFile(fileName.str().c_str());
+      }
+    }
+  catch (itk::ExceptionObject& exception)
+    {
+    std::cerr << exception << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  return EXIT_SUCCESS;
+}
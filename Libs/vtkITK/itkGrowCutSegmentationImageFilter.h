@@ -3,6 +3,7 @@
 
 #include "itkImage.h"
 #include "itkImageToImageFilter.h"
+#include "itkMultiThreader.h"
 #include "itkSimpleDataObjectDecorator.h"
 #include "itkVectorContainer.h"
 //#include "itkCommand.h"
@@ -261,6 +262,18 @@ template<class TInputImage,
   itkGetConstMacro(SetMaxSaturationImage, bool);
   itkBooleanMacro(SetMaxSaturationImage);
 
+  /**Set/Get whether the filter runs until convergence by only
+  * re-evaluating the cells next to a cell that changed in the previous
+  * iteration (the active front), splitting each iteration across the
+  * threads of the filter. The first iteration evaluates the whole region
+  * of interest, so the filter can restart from a previous segmentation
+  * passed as label and strength images. Default setting is on. When off,
+  * every cell of the region of interest is re-evaluated on each iteration.
+  **/
+  itkSetMacro(UseActiveFront, bool);
+  itkGetConstMacro(UseActiveFront, bool);
+  itkBooleanMacro(UseActiveFront);
+
  protected:
   
   GrowCutSegmentationImageFilter();
@@ -290,6 +303,28 @@ template<class TInputImage,
 
   void GrowCutSlowROI( TOutputImage *);
 
+  void GrowCutActiveFront( TOutputImage *);
+
+  /** Buffers shared by the threads evaluating the active front **/
+  struct ActiveFrontThreadStruct
+  {
+    Self *                  Filter;
+    const InputPixelType *  Intensities;
+    const WeightPixelType * MaxDistances;
+    const OutputPixelType * Labels;
+    const WeightPixelType * Strengths;
+  };
+
+  /** Static function used as a "callback" by the MultiThreader. **/
+  static ITK_THREAD_RETURN_TYPE ActiveFrontThreaderCallback( void *arg );
+
+  /** Evaluate the part of the active front assigned to a thread. The new
+   * labels and strengths are written in m_FrontLabels and m_FrontStrengths
+   * so that all the cells of an iteration see the same previous state. **/
+  void ThreadedEvaluateActiveFront( const ActiveFrontThreadStruct &str,
+                                    unsigned int threadId,
+                                    unsigned int numberOfThreads );
+
   
  private:
 
@@ -305,6 +340,15 @@ template<class TInputImage,
   void ComputeLabelVolumes(TOutputImage *outputImage, vcl_vector< unsigned > &volumes, vcl_vector< unsigned > &phyVolumes);
 
   void MaskSegmentedImageByWeight(float upperThresh);
+
+  typedef typename OutputImageType::OffsetType      OutputOffsetType;
+  typedef typename OutputImageType::OffsetValueType OffsetValueType;
+
+  /** Index, relative to the buffered region, of a cell of the active front **/
+  void ComputeFrontIndex( OffsetValueType cell, OutputIndexType &index ) const;
+
+  /** Whether the n-th neighbor of the cell at index is in the region of interest **/
+  bool IsNeighborInRegionOfInterest( const OutputIndexType &index, unsigned int n ) const;
   
    
   WeightPixelType                            m_ConfThresh;
@@ -320,6 +364,7 @@ template<class TInputImage,
   bool                                       m_SetStateImage;
   bool                                       m_SetDistancesImage;
   bool                                       m_SetMaxSaturationImage;
+  bool                                       m_UseActiveFront;
 
   unsigned int                               m_MaxIterations;
   unsigned int                               m_ObjectRadius;
@@ -331,6 +376,17 @@ template<class TInputImage,
   OutputIndexType                            m_roiStart;
   OutputIndexType                            m_roiEnd;
 
+  // Active front of the cellular automaton, offsets in the output buffer
+  vcl_vector< OffsetValueType >              m_ActiveFront;
+  vcl_vector< OutputPixelType >              m_FrontLabels;
+  vcl_vector< WeightPixelType >              m_FrontStrengths;
+  vcl_vector< unsigned char >                m_FrontChanged;
+  vcl_vector< OutputOffsetType >             m_NeighborOffsets;
+  vcl_vector< OffsetValueType >              m_NeighborBufferOffsets;
+  OutputOffsetType                           m_BufferStrides;
+  OutputIndexType                            m_FrontLower;
+  OutputIndexType                            m_FrontUpper;
+
 };
 
 } // namespace itk
@@ -10,6 +10,7 @@
 #include "itkNeighborhoodAlgorithm.h"
 #include "itkImageRegionIterator.h"
 #include "itkImageRegionConstIterator.h"
+#include "itkImageRegionConstIteratorWithIndex.h"
 #include "itkConstantBoundaryCondition.h"
 #include "itkNumericTraits.h"
 #include "itkImageFileWriter.h"
@@ -26,6 +27,8 @@
 #include <vcl_algorithm.h>
 #include <vcl_utility.h>
 
+#include <algorithm>
+
 #include <iostream>
 #include <ctime>
 
@@ -52,6 +55,8 @@ GrowCutSegmentationImageFilter<TInputImage, TOutputImage, TWeightPixelType>
 
   m_SetMaxSaturationImage = false;
 
+  m_UseActiveFront = true;
+
   m_ConfThresh = 0.2;
   
   m_MaxIterations = 500;
@@ -84,6 +89,7 @@ GrowCutSegmentationImageFilter<TInputImage, TOutputImage, TWeightPixelType>
   //   os << indent << "max enemies for attack T1 : " << m_T1<< std::endl;  
   // os << indent << "min enemies for submit T2 : " << m_T2<< std::endl;  
   os << indent << "starting seed strength :" <<m_SeedStrength<< std::endl;     
+  os << indent << "use active front : " << m_UseActiveFront << std::endl;
   //os << indent << "use Algorithm Speed Slow : " << m_UseSlow<< std::endl; 
 } 
 
@@ -488,6 +494,317 @@ MaskSegmentedImageByWeight( float confThresh)
 
 
 
+template<class TInputImage, class TOutputImage, class TWeightPixelType>
+void GrowCutSegmentationImageFilter<TInputImage, TOutputImage, TWeightPixelType>::
+ComputeFrontIndex( OffsetValueType cell, OutputIndexType &index ) const
+{
+  for (int d = ImageDimension - 1; d >= 0; --d)
+    {
+    index[d] = cell / m_BufferStrides[d];
+    cell -= index[d] * m_BufferStrides[d];
+    }
+}
+
+template<class TInputImage, class TOutputImage, class TWeightPixelType>
+bool GrowCutSegmentationImageFilter<TInputImage, TOutputImage, TWeightPixelType>::
+IsNeighborInRegionOfInterest( const OutputIndexType &index, unsigned int n ) const
+{
+  const OutputOffsetType &offset = m_NeighborOffsets[n];
+  for (unsigned int d = 0; d < ImageDimension; ++d)
+    {
+    if (index[d] + offset[d] < m_FrontLower[d] ||
+        index[d] + offset[d] > m_FrontUpper[d])
+      {
+      return false;
+      }
+    }
+  return true;
+}
+
+template<class TInputImage, class TOutputImage, class TWeightPixelType>
+ITK_THREAD_RETURN_TYPE
+GrowCutSegmentationImageFilter<TInputImage, TOutputImage, TWeightPixelType>::
+ActiveFrontThreaderCallback( void *arg )
+{
+  MultiThreader::ThreadInfoStruct *info =
+    static_cast< MultiThreader::ThreadInfoStruct * >( arg );
+  ActiveFrontThreadStruct *str =
+    static_cast< ActiveFrontThreadStruct * >( info->UserData );
+
+  str->Filter->ThreadedEvaluateActiveFront( *str, info->ThreadID,
+                                            info->NumberOfThreads );
+
+  return ITK_THREAD_RETURN_VALUE;
+}
+
+template<class TInputImage, class TOutputImage, class TWeightPixelType>
+void GrowCutSegmentationImageFilter<TInputImage, TOutputImage, TWeightPixelType>::
+ThreadedEvaluateActiveFront( const ActiveFrontThreadStruct &str,
+                             unsigned int threadId,
+                             unsigned int numberOfThreads )
+{
+  const size_t frontSize = m_ActiveFront.size();
+  const size_t begin = frontSize * threadId / numberOfThreads;
+  const size_t end = frontSize * (threadId + 1) / numberOfThreads;
+  const unsigned int numberOfNeighbors =
+    static_cast< unsigned int >( m_NeighborOffsets.size() );
+
+  OutputIndexType index;
+  for (size_t i = begin; i < end; ++i)
+    {
+    const OffsetValueType cell = m_ActiveFront[i];
+
+    // only the cells on the border of the region of interest need their
+    // neighbors to be checked
+    this->ComputeFrontIndex( cell, index );
+    bool interior = true;
+    for (unsigned int d = 0; d < ImageDimension && interior; ++d)
+      {
+      interior = index[d] > m_FrontLower[d] && index[d] < m_FrontUpper[d];
+      }
+
+    const WeightPixelType center = static_cast< WeightPixelType >( str.Intensities[cell] );
+    const WeightPixelType maxDistance = str.MaxDistances[cell];
+
+    OutputPixelType winnerLabel = str.Labels[cell];
+    WeightPixelType winnerStrength = str.Strengths[cell];
+
+    for (unsigned int n = 0; n < numberOfNeighbors; ++n)
+      {
+      if (!interior && !this->IsNeighborInRegionOfInterest( index, n ))
+        {
+        continue;
+        }
+      const OffsetValueType neighbor = cell + m_NeighborBufferOffsets[n];
+      const WeightPixelType strength = str.Strengths[neighbor];
+      // the attack of a neighbor is never stronger than the neighbor itself
+      if (str.Labels[neighbor] == m_UnknownLabel || strength <= winnerStrength)
+        {
+        continue;
+        }
+      const WeightPixelType difference =
+        center - static_cast< WeightPixelType >( str.Intensities[neighbor] );
+      const WeightPixelType attackStrength = (maxDistance > 0) ?
+        static_cast< WeightPixelType >(
+          (1.0 - difference * difference / maxDistance) * strength ) : strength;
+      if (attackStrength > winnerStrength)
+        {
+        winnerStrength = attackStrength;
+        winnerLabel = str.Labels[neighbor];
+        }
+      }
+
+    m_FrontLabels[i] = winnerLabel;
+    m_FrontStrengths[i] = winnerStrength;
+    m_FrontChanged[i] = (winnerStrength != str.Strengths[cell]) ? 1 : 0;
+    }
+}
+
+template<class TInputImage, class TOutputImage, class TWeightPixelType>
+void GrowCutSegmentationImageFilter<TInputImage, TOutputImage, TWeightPixelType>::
+GrowCutActiveFront( TOutputImage *output )
+{
+  typename InputImageType::Pointer inputImage = InputImageType::New();
+  inputImage->Graft( this->ProcessObject::GetInput(0) );
+
+  typename WeightImageType::Pointer strengthImage = this->GetStrengthImage();
+
+  const OutputImageRegionType region = output->GetBufferedRegion();
+  const size_t numberOfPixels = region.GetNumberOfPixels();
+  if (inputImage->GetBufferedRegion() != region ||
+      m_LabelImage->GetBufferedRegion() != region ||
+      strengthImage->GetBufferedRegion() != region)
+    {
+    itkExceptionMacro( << "The input, label and strength images must have the same buffered region" );
+    }
+
+  // The output holds the current labels and m_WeightImage the current
+  // strengths, starting from the label and strength images
+  OutputPixelType *labels = output->GetBufferPointer();
+  std::copy( m_LabelImage->GetBufferPointer(),
+             m_LabelImage->GetBufferPointer() + numberOfPixels, labels );
+
+  m_WeightImage = WeightImageType::New();
+  m_WeightImage->CopyInformation( output );
+  m_WeightImage->SetRegions( region );
+  m_WeightImage->Allocate();
+  WeightPixelType *strengths = m_WeightImage->GetBufferPointer();
+  std::copy( strengthImage->GetBufferPointer(),
+             strengthImage->GetBufferPointer() + numberOfPixels, strengths );
+
+  typename WeightImageType::Pointer maxDistancesImage;
+  if (m_SetDistancesImage)
+    {
+    maxDistancesImage = this->GetDistancesImage();
+    }
+  else
+    {
+    maxDistancesImage = WeightImageType::New();
+    maxDistancesImage->CopyInformation( strengthImage );
+    maxDistancesImage->SetRegions( region );
+    maxDistancesImage->Allocate();
+    this->InitializeDistancesImage( inputImage, maxDistancesImage );
+    }
+
+  // The region of interest is around the labeled cells
+  typename OutputImageType::Pointer pixelStateImage = OutputImageType::New();
+  pixelStateImage->CopyInformation( output );
+  pixelStateImage->SetRegions( region );
+  pixelStateImage->Allocate();
+  pixelStateImage->FillBuffer( UNLABELED );
+  const bool noLabels = this->InitializeStateImage( pixelStateImage );
+  pixelStateImage = 0;
+
+  m_LabelImage = output;
+  if (noLabels)
+    {
+    this->UpdateProgress(1.0);
+    return;
+    }
+
+  // Cells are addressed by their offset in the buffers, the region of
+  // interest is kept relative to the buffered region
+  OffsetValueType stride = 1;
+  for (unsigned int d = 0; d < ImageDimension; ++d)
+    {
+    m_BufferStrides[d] = stride;
+    stride *= static_cast< OffsetValueType >( region.GetSize()[d] );
+    m_FrontLower[d] = vcl_max( m_roiStart[d], region.GetIndex()[d] ) - region.GetIndex()[d];
+    m_FrontUpper[d] = vcl_min( m_roiEnd[d], static_cast< typename OutputIndexType::IndexValueType >(
+      region.GetIndex()[d] + region.GetSize()[d] - 1 ) ) - region.GetIndex()[d];
+    }
+
+  // All the cells of the 3x3x3 (in 3D) neighborhood
+  m_NeighborOffsets.clear();
+  m_NeighborBufferOffsets.clear();
+  unsigned int neighborhoodSize = 1;
+  for (unsigned int d = 0; d < ImageDimension; ++d)
+    {
+    neighborhoodSize *= 3;
+    }
+  for (unsigned int n = 0; n < neighborhoodSize; ++n)
+    {
+    OutputOffsetType offset;
+    OffsetValueType bufferOffset = 0;
+    bool isCenter = true;
+    unsigned int code = n;
+    for (unsigned int d = 0; d < ImageDimension; ++d)
+      {
+      offset[d] = static_cast< OffsetValueType >( code % 3 ) - 1;
+      code /= 3;
+      bufferOffset += offset[d] * m_BufferStrides[d];
+      isCenter = isCenter && offset[d] == 0;
+      }
+    if (!isCenter)
+      {
+      m_NeighborOffsets.push_back( offset );
+      m_NeighborBufferOffsets.push_back( bufferOffset );
+      }
+    }
+  const unsigned int numberOfNeighbors =
+    static_cast< unsigned int >( m_NeighborOffsets.size() );
+
+  // The first iteration evaluates the whole region of interest, then only
+  // the neighbors of the cells that changed
+  m_ActiveFront.clear();
+  OutputImageRegionType roi;
+  OutputIndexType roiIndex;
+  OutputSizeType roiSize;
+  for (unsigned int d = 0; d < ImageDimension; ++d)
+    {
+    roiIndex[d] = m_FrontLower[d] + region.GetIndex()[d];
+    roiSize[d] = m_FrontUpper[d] - m_FrontLower[d] + 1;
+    }
+  roi.SetIndex( roiIndex );
+  roi.SetSize( roiSize );
+  m_ActiveFront.reserve( roi.GetNumberOfPixels() );
+  ImageRegionConstIteratorWithIndex< OutputImageType > roiIt( output, roi );
+  for (roiIt.GoToBegin(); !roiIt.IsAtEnd(); ++roiIt)
+    {
+    m_ActiveFront.push_back( output->ComputeOffset( roiIt.GetIndex() ) );
+    }
+
+  ActiveFrontThreadStruct str;
+  str.Filter = this;
+  str.Intensities = inputImage->GetBufferPointer();
+  str.MaxDistances = maxDistancesImage->GetBufferPointer();
+  str.Labels = labels;
+  str.Strengths = strengths;
+
+  this->GetMultiThreader()->SetNumberOfThreads( this->GetNumberOfThreads() );
+  this->GetMultiThreader()->SetSingleMethod( Self::ActiveFrontThreaderCallback, &str );
+
+  // small fronts are not worth starting the threads
+  const size_t minimumThreadedFrontSize = 4096;
+
+  vcl_vector< unsigned char > inFront( numberOfPixels, 0 );
+  vcl_vector< OffsetValueType > nextFront;
+  OutputIndexType index;
+
+  unsigned int iter = 0;
+  while (!m_ActiveFront.empty() && iter < m_MaxIterations)
+    {
+    const size_t frontSize = m_ActiveFront.size();
+    m_FrontLabels.resize( frontSize );
+    m_FrontStrengths.resize( frontSize );
+    m_FrontChanged.resize( frontSize );
+
+    if (frontSize < minimumThreadedFrontSize || this->GetNumberOfThreads() <= 1)
+      {
+      this->ThreadedEvaluateActiveFront( str, 0, 1 );
+      }
+    else
+      {
+      this->GetMultiThreader()->SingleMethodExecute();
+      }
+
+    // Apply the changes and collect the neighbors of the changed cells
+    nextFront.clear();
+    for (size_t i = 0; i < frontSize; ++i)
+      {
+      if (!m_FrontChanged[i])
+        {
+        continue;
+        }
+      const OffsetValueType cell = m_ActiveFront[i];
+      labels[cell] = m_FrontLabels[i];
+      strengths[cell] = m_FrontStrengths[i];
+
+      this->ComputeFrontIndex( cell, index );
+      for (unsigned int n = 0; n < numberOfNeighbors; ++n)
+        {
+        if (!this->IsNeighborInRegionOfInterest( index, n ))
+          {
+          continue;
+          }
+        const OffsetValueType neighbor = cell + m_NeighborBufferOffsets[n];
+        if (!inFront[neighbor])
+          {
+          inFront[neighbor] = 1;
+          nextFront.push_back( neighbor );
+          }
+        }
+      }
+    for (size_t i = 0; i < nextFront.size(); ++i)
+      {
+      inFront[nextFront[i]] = 0;
+      }
+    m_ActiveFront.swap( nextFront );
+
+    ++iter;
+    this->UpdateProgress( static_cast< float >( iter ) / m_MaxIterations );
+    }
+
+  m_ActiveFront.clear();
+  m_FrontLabels.clear();
+  m_FrontStrengths.clear();
+  m_FrontChanged.clear();
+
+  this->MaskSegmentedImageByWeight( m_ConfThresh );
+  this->UpdateProgress( 1.0 );
+}
+
+
 template <class TInputImage, class TOutputImage, class TWeightPixelType>
 void 
 GrowCutSegmentationImageFilter<TInputImage, TOutputImage, TWeightPixelType>
@@ -510,6 +827,12 @@ GrowCutSegmentationImageFilter<TInputImage, TOutputImage, TWeightPixelType>
     return;
     }
 
+  if(m_UseActiveFront)
+    {
+    this->GrowCutActiveFront(output);
+    return;
+    }
+
     
   unsigned int ndims = static_cast< unsigned int>(output->GetImageDimension());
   
@@ -5,8 +5,10 @@
 #include <itkImage.h>
 #include <itkArray.h>
 #include <itkImageSource.h>
+#include <itkMultiThreader.h>
 #include <iostream>
 #include <fstream>
+#include <itkImageFileReader.h>
 #include <itkTimeSeriesDatabaseHelper.h>
 
 #define TimeSeriesBlockSize 16
@@ -69,6 +71,14 @@ public:
   static void CreateFromFileArchetype ( const char* filename, const char* archetype );
   static void CreateFromFileArchetype ( const char* filename, const char* archetype, unsigned long BlocksPerFile );
 
+  /** Create a new TimeSeriesDatabase from an Archetype filename,
+   * reading and writing NumberOfThreads volumes at a time.
+   * The database is the same as with one thread, the volumes
+   * are written at different places in the files.  The two
+   * argument version uses the default number of threads.
+   */
+  static void CreateFromFileArchetype ( const char* filename, const char* archetype, unsigned long BlocksPerFile, unsigned int NumberOfThreads );
+
   /** Set the image to be read when GenerateData is called.
    * This method selects the image to be returned by an Update
    * call.  By changing the CurrentImage, a pipeline can process
@@ -101,6 +111,20 @@ public:
    */
   float GetCacheSizeInMiB ();
 
+  /** Map the database files in memory on Connect instead of
+   * reading the blocks into the cache.  The blocks are then
+   * used in place, without copies, and the system keeps the
+   * recently used ones in memory.  On by default, ignored where
+   * memory mapping is not supported or fails (e.g. not enough
+   * address space), the cache is used instead.
+   */
+  itkSetMacro ( UseMemoryMapping, bool );
+  itkGetMacro ( UseMemoryMapping, bool );
+  itkBooleanMacro ( UseMemoryMapping );
+
+  /** Return true if the database files are memory mapped */
+  bool IsMemoryMapped() const { return !this->m_MappedFiles.empty(); };
+
 
 protected:
   TimeSeriesDatabase();
@@ -144,6 +168,33 @@ protected:
   };
   TimeSeriesDatabaseHelper::LRUCache<unsigned long, CacheBlock> m_Cache;
   CacheBlock* GetCacheBlock ( unsigned long index );
+
+  /// Pixels of a block, in the memory mapped files or in the cache
+  const TPixel* GetBlock ( unsigned long index );
+  /// Ask the system to read the blocks of all the volumes at Block
+  void PrefetchTimeSeries ( Size<3> Block );
+
+  bool m_UseMemoryMapping;
+  std::vector<char*> m_MappedFiles;
+  std::vector<size_t> m_MappedFileSizes;
+  bool MapDatabaseFiles();
+  void UnmapDatabaseFiles();
+
+  /// Write the blocks of the ImagePosition'th volume in the database files
+  static void WriteVolumeBlocks ( OutputImageType* image, unsigned int ImagePosition,
+                                  unsigned int BlocksPerImage[3], unsigned long BlocksPerFile,
+                                  std::vector<StreamPtr>& db );
+
+  struct CreateThreadStruct
+  {
+    std::vector<std::string> CandidateFiles;
+    std::vector<std::string> Filenames;
+    std::vector<typename ImageFileReader<OutputImageType>::Pointer> Readers;
+    unsigned int Dimensions[3];
+    unsigned long BlocksPerFile;
+    std::vector<std::string> Errors;
+  };
+  static ITK_THREAD_RETURN_TYPE CreateThreaderCallback ( void* arg );
 };
 
 } // end namespace itk
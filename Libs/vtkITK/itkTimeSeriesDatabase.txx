@@ -9,9 +9,17 @@
 #include <itkImageFileReader.h>
 #include <itksys/SystemTools.hxx>
 #include "itkArchetypeSeriesFileNames.h"
+#include <algorithm>
 #include <fstream>
 #include <vector>
 
+#ifndef _WIN32
+# include <fcntl.h>
+# include <sys/mman.h>
+# include <sys/stat.h>
+# include <unistd.h>
+#endif
+
 namespace itk {
 
   // template<class TPixel> int TimeSeriesDatabase<TPixel>::BlockSize = 16;
@@ -57,6 +65,8 @@ bool TimeSeriesDatabase<TPixel>::IsOpen () const
 template <class TPixel>
 void TimeSeriesDatabase<TPixel>::Disconnect ()
 {
+  this->UnmapDatabaseFiles();
+  this->m_Cache.clear();
   for ( int idx = 0; idx < this->m_DatabaseFiles.size(); idx++ )
     {
     this->m_DatabaseFiles[idx]->close();
@@ -128,6 +138,10 @@ void TimeSeriesDatabase<TPixel>::Connect ( const char* filename )
     this->m_DatabaseFileNames.push_back ( Filename );
     this->m_DatabaseFiles.push_back ( StreamPtr ( new std::fstream ( Filename.c_str(), ::std::ios::in | ::std::ios::binary ) ) );
     }
+  if ( this->m_UseMemoryMapping && !this->MapDatabaseFiles() )
+    {
+    itkDebugMacro ( << "TimeSeriesDatabase::Connect: could not map the database files, using the cache" );
+    }
   /*
   std::cout << "ImageSize: " << m_OutputRegion.GetSize() << endl;
   std::cout << "ImageOrigin: " << m_OutputOrigin << endl;
@@ -197,6 +211,98 @@ typename TimeSeriesDatabase<TPixel>::CacheBlock* TimeSeriesDatabase<TPixel>::Get
   return Buffer;
 }
 
+template <class TPixel>
+const TPixel* TimeSeriesDatabase<TPixel>::GetBlock ( unsigned long index )
+{
+  if ( this->m_MappedFiles.empty() )
+    {
+    return this->GetCacheBlock ( index )->data;
+    }
+  unsigned int FileIdx = this->CalculateFileIndex ( index );
+  size_t position = static_cast<size_t> ( static_cast< ::std::streamoff > ( this->CalculatePosition ( index, this->m_BlocksPerFile ) ) );
+  if ( FileIdx >= this->m_MappedFiles.size()
+       || position + TimeSeriesVolumeBlockSize * sizeof ( TPixel ) > this->m_MappedFileSizes[FileIdx] )
+    {
+    itkExceptionMacro ( "TimeSeriesDatabase::GetBlock: block " << index << " is not in the database files" );
+    }
+  return reinterpret_cast<const TPixel*> ( this->m_MappedFiles[FileIdx] + position );
+}
+
+template <class TPixel>
+bool TimeSeriesDatabase<TPixel>::MapDatabaseFiles ()
+{
+  this->UnmapDatabaseFiles();
+#ifndef _WIN32
+  for ( ::size_t idx = 0; idx < this->m_DatabaseFileNames.size(); idx++ )
+    {
+    int fd = open ( this->m_DatabaseFileNames[idx].c_str(), O_RDONLY );
+    if ( fd < 0 )
+      {
+      this->UnmapDatabaseFiles();
+      return false;
+      }
+    struct stat status;
+    void* mapping = MAP_FAILED;
+    if ( fstat ( fd, &status ) == 0 && status.st_size > 0 )
+      {
+      mapping = mmap ( 0, status.st_size, PROT_READ, MAP_SHARED, fd, 0 );
+      }
+    // the mapping stays valid after the descriptor is closed
+    close ( fd );
+    if ( mapping == MAP_FAILED )
+      {
+      this->UnmapDatabaseFiles();
+      return false;
+      }
+    this->m_MappedFiles.push_back ( static_cast<char*> ( mapping ) );
+    this->m_MappedFileSizes.push_back ( static_cast<size_t> ( status.st_size ) );
+    }
+  return true;
+#else
+  return false;
+#endif
+}
+
+template <class TPixel>
+void TimeSeriesDatabase<TPixel>::UnmapDatabaseFiles ()
+{
+#ifndef _WIN32
+  for ( ::size_t idx = 0; idx < this->m_MappedFiles.size(); idx++ )
+    {
+    munmap ( this->m_MappedFiles[idx], this->m_MappedFileSizes[idx] );
+    }
+#endif
+  this->m_MappedFiles.clear();
+  this->m_MappedFileSizes.clear();
+}
+
+template <class TPixel>
+void TimeSeriesDatabase<TPixel>::PrefetchTimeSeries ( Size<3> Block )
+{
+#ifndef _WIN32
+  if ( this->m_MappedFiles.empty() )
+    {
+    return;
+    }
+  // The blocks of a voxel are one volume apart in the files, read them
+  // ahead all at once instead of faulting them in one after the other.
+  const size_t PageSize = static_cast<size_t> ( sysconf ( _SC_PAGESIZE ) );
+  for ( unsigned int volume = 0; volume < this->m_Dimensions[3]; volume++ )
+    {
+    unsigned long index = this->CalculateIndex ( Block, volume );
+    const char* block = reinterpret_cast<const char*> ( this->GetBlock ( index ) );
+    size_t FileIdx = this->CalculateFileIndex ( index );
+    size_t start = static_cast<size_t> ( block - this->m_MappedFiles[FileIdx] );
+    size_t alignedStart = start - start % PageSize;
+    posix_madvise ( this->m_MappedFiles[FileIdx] + alignedStart,
+                    start - alignedStart + TimeSeriesVolumeBlockSize * sizeof ( TPixel ),
+                    POSIX_MADV_WILLNEED );
+    }
+#else
+  (void)Block;
+#endif
+}
+
 
 template <class TPixel>
 void TimeSeriesDatabase<TPixel>::GetVoxelTimeSeries ( typename OutputImageType::IndexType idx, ArrayType& array )
@@ -206,17 +312,17 @@ void TimeSeriesDatabase<TPixel>::GetVoxelTimeSeries ( typename OutputImageType::
   Size<3> CurrentBlock;
   Size<3> Offset;
   for ( int i = 0; i < 3; i++ ) {
-    if ( idx[i] < 0 || idx[i] > this->m_OutputRegion.Size[i] ) {
-      throw 1;
+    if ( idx[i] < 0 || idx[i] >= static_cast<long> ( this->m_OutputRegion.GetSize ( i ) ) ) {
+      itkExceptionMacro ( "TimeSeriesDatabase::GetVoxelTimeSeries: index " << idx << " is outside the volume" );
     }
-    CurrentBlock[i] = reinterpret_cast<unsigned long> ( idx[i] / (double)TimeSeriesBlockSize );
+    CurrentBlock[i] = idx[i] / TimeSeriesBlockSize;
     Offset[i] = idx[i] % TimeSeriesBlockSize;
   }
   unsigned long offset = Offset[0] + Offset[1] * TimeSeriesBlockSize + Offset[2] * TimeSeriesBlockSizeP2;
-  array = ArrayType ( this->m_Dimensions[3] );
-  for ( int volume = 0; volume < this->m_Dimensions[3]; volume++ ) {
-    CacheBlock* cache = this->GetCacheBlock ( CurrentBlock, volume );
-    array[volume] = cache->data[offset];
+  array.SetSize ( this->m_Dimensions[3] );
+  this->PrefetchTimeSeries ( CurrentBlock );
+  for ( unsigned int volume = 0; volume < this->m_Dimensions[3]; volume++ ) {
+    array[volume] = this->GetBlock ( this->CalculateIndex ( CurrentBlock, volume ) )[offset];
   }
 }
 
@@ -272,7 +378,7 @@ void TimeSeriesDatabase<TPixel>::GenerateData()
         typename OutputImageType::RegionType BR, IR;
         if ( print ) {  std::cout << "For Block Index: " << CurrentBlock << std::endl; }
         unsigned long index = this->CalculateIndex ( CurrentBlock, this->m_CurrentImage );
-        CacheBlock* Buffer = this->GetCacheBlock ( index );
+        const TPixel* Buffer = this->GetBlock ( index );
         if ( this->CalculateIntersection ( CurrentBlock, Region, BR, IR ) ) {
           // Just iterate over whole block
           // Good we can use an iterator!
@@ -285,7 +391,7 @@ void TimeSeriesDatabase<TPixel>::GenerateData()
           BlockRegion.SetIndex ( BlockIndex );
           ImageRegionIterator<OutputImageType> it ( output, IR );
           it.GoToBegin();
-          TPixel* ptr = Buffer->data;
+          const TPixel* ptr = Buffer;
           while ( !it.IsAtEnd() ) {
             it.Set ( *ptr );
             ++it;
@@ -300,7 +406,7 @@ void TimeSeriesDatabase<TPixel>::GenerateData()
             std::cout << "Count: " << Count << std::endl;
             std::cout << "Block Region: " << BR;
             std::cout << "Image Region: " << IR;
-            std::cout << "First voxel: " << Buffer->data[0] << std::endl;
+            std::cout << "First voxel: " << Buffer[0] << std::endl;
           }
           unsigned int bx, by, bz, x, y, z;
           for ( z = 0; z < Count[2]; z++ ) {
@@ -320,7 +426,7 @@ void TimeSeriesDatabase<TPixel>::GenerateData()
                 }
                 */
 
-                output->SetPixel ( ImageIndex, Buffer->data[bx + TimeSeriesBlockSize*by + TimeSeriesBlockSize*TimeSeriesBlockSize*bz] );
+                output->SetPixel ( ImageIndex, Buffer[bx + TimeSeriesBlockSize*by + TimeSeriesBlockSize*TimeSeriesBlockSize*bz] );
                 }
               }
             }
@@ -339,11 +445,165 @@ void TimeSeriesDatabase<TPixel>::CreateFromFileArchetype ( const char* TSDFilena
   // How many blocks go in each file, allowing for 1GiB per file
   // 1073741824 is 1 GiB
   unsigned long FileSize = 1073741824;
-  CreateFromFileArchetype ( TSDFilename, archetype, FileSize );
+  CreateFromFileArchetype ( TSDFilename, archetype, FileSize, MultiThreader::GetGlobalDefaultNumberOfThreads() );
 }
 
 template <class TPixel>
 void TimeSeriesDatabase<TPixel>::CreateFromFileArchetype ( const char* TSDFilename, const char* archetype, unsigned long FileSize )
+{
+  CreateFromFileArchetype ( TSDFilename, archetype, FileSize, 1 );
+}
+
+template <class TPixel>
+void TimeSeriesDatabase<TPixel>::WriteVolumeBlocks ( OutputImageType* image, unsigned int ImagePosition,
+                                                     unsigned int BlocksPerImage[3], unsigned long BlocksPerFile,
+                                                     std::vector<StreamPtr>& db )
+{
+  // Build and write our blocks
+  TPixel buffer[TimeSeriesBlockSize*TimeSeriesBlockSize*TimeSeriesBlockSize];
+  Size<3> BlockSize = { {TimeSeriesBlockSize, TimeSeriesBlockSize, TimeSeriesBlockSize }};
+  ImageRegion<3> BlockRegion;
+  ImageRegion<3> region = image->GetLargestPossibleRegion();
+
+  BlockRegion.SetSize ( BlockSize );
+  Size<3> CurrentBlock;
+  for ( CurrentBlock[2] = 0; CurrentBlock[2] < BlocksPerImage[2]; CurrentBlock[2]++ )
+    {
+    for ( CurrentBlock[1] = 0; CurrentBlock[1] < BlocksPerImage[1]; CurrentBlock[1]++ )
+      {
+      for ( CurrentBlock[0] = 0; CurrentBlock[0] < BlocksPerImage[0]; CurrentBlock[0]++ )
+        {
+        /*
+        std::cout << "Reading/Writing Block: " << CurrentBlock[0] << ", " << CurrentBlock[1] << ", " << CurrentBlock[2] << endl;
+        std::cout << "Debug: " << ( ( CurrentBlock[2] * TimeSeriesBlockSize + TimeSeriesBlockSize ) < region.GetSize()[2] ) << endl;
+        std::cout << "Debug: " << CurrentBlock[2] * TimeSeriesBlockSize + TimeSeriesBlockSize << " Region size  " << region.GetSize()[2] << endl;
+        */
+        // Load up the block, and save it at the proper index
+        // Is this block fully within the image?
+        if ( ( ( CurrentBlock[0] * TimeSeriesBlockSize + TimeSeriesBlockSize ) < region.GetSize()[0] )
+             && ( ( CurrentBlock[1] * TimeSeriesBlockSize + TimeSeriesBlockSize ) < region.GetSize()[1] )
+             && ( ( CurrentBlock[2] * TimeSeriesBlockSize + TimeSeriesBlockSize ) < region.GetSize()[2] ) )
+          {
+          // Good we can use an iterator!
+          Index<3> BlockIndex = { {CurrentBlock[0] * TimeSeriesBlockSize,  CurrentBlock[1] * TimeSeriesBlockSize,  CurrentBlock[2] * TimeSeriesBlockSize }};
+          BlockRegion.SetIndex ( BlockIndex );
+          ImageRegionIteratorWithIndex<OutputImageType> it ( image, BlockRegion );
+          it.GoToBegin();
+          TPixel* ptr = buffer;
+          while ( !it.IsAtEnd() )
+            {
+            *ptr = it.Value();
+            ++it;
+            ++ptr;
+            }
+          } 
+        else
+          {
+          // cout << "The Hard way" << std::endl;
+          // Now we do it the hard way...
+          // Pad the edge blocks with zeros rather than with what the buffer
+          // held before, so that the files don't depend on the write order.
+          std::fill ( buffer, buffer + TimeSeriesVolumeBlockSize, TPixel() );
+          Index<3> BlockIndex;
+          Size<3> StartIndex, EndIndex;
+          for ( int ii = 0; ii < 3; ii++ ) 
+            {
+            StartIndex[ii] = CurrentBlock[ii]*TimeSeriesBlockSize;
+            EndIndex[ii] = TSD_MIN ( StartIndex[ii] + TimeSeriesBlockSize, region.GetSize()[ii] );
+            }            
+          for ( unsigned int bz = StartIndex[2]; bz < EndIndex[2]; bz++ ) 
+            {
+            BlockIndex[2] = bz;
+            for ( unsigned int by = StartIndex[1]; by < EndIndex[1]; by++ ) 
+              {
+              BlockIndex[1] = by;
+              for ( unsigned int bx = StartIndex[0]; bx < EndIndex[0]; bx++ ) 
+                {
+                // Put bx,by,bz into bx-xoff,by-yoff,bz-zoff
+                BlockIndex[0] = bx;
+                TPixel value = image->GetPixel ( BlockIndex );
+                buffer[bx-StartIndex[0] + TimeSeriesBlockSize*(by-StartIndex[1]) + TimeSeriesBlockSize*TimeSeriesBlockSize*(bz-StartIndex[2])] = value;
+                }
+              }
+            }
+          }
+        // Calculate where to write...  This code is copied from CalculatePosition and CalculateIndex
+        unsigned long index = CalculateIndex ( CurrentBlock, ImagePosition, BlocksPerImage );
+        // Adjust the position, based on the FileIndex
+        ::std::streampos position = CalculatePosition ( index, BlocksPerFile );
+        unsigned long FileIndex = CalculateFileIndex ( index, BlocksPerFile );
+        // std::cout << "Found FileIndex : " << FileIndex << " For index: " << index << " position: " << position << std::endl;
+
+        db[FileIndex]->seekp ( position );
+        db[FileIndex]->write ( reinterpret_cast<char*> ( buffer ), TimeSeriesBlockSize*TimeSeriesBlockSize*TimeSeriesBlockSize*sizeof(TPixel) );
+        }
+      }
+    }
+}
+
+template <class TPixel>
+ITK_THREAD_RETURN_TYPE TimeSeriesDatabase<TPixel>::CreateThreaderCallback ( void* arg )
+{
+  MultiThreader::ThreadInfoStruct* info = (MultiThreader::ThreadInfoStruct*)arg;
+  unsigned int ThreadID = info->ThreadID;
+  unsigned int NumberOfThreads = info->NumberOfThreads;
+  CreateThreadStruct* str = (CreateThreadStruct*)info->UserData;
+
+  // Each thread has its own streams on the files, the volumes are written at different places
+  std::vector<StreamPtr> db;
+  for ( ::size_t idx = 0; idx < str->Filenames.size(); idx++ )
+    {
+    db.push_back ( StreamPtr ( new std::fstream ( str->Filenames[idx].c_str(), ::std::ios::in | ::std::ios::out | ::std::ios::binary ) ) );
+    }
+
+  unsigned int BlocksPerImage[3];
+  for ( int idx = 0; idx < 3; idx++ )
+    {
+    BlocksPerImage[idx] = (unsigned int) ceil ( str->Dimensions[idx] / (float)TimeSeriesBlockSize );
+    }
+
+  typename ImageFileReader<OutputImageType>::Pointer reader = str->Readers[ThreadID];
+  for ( unsigned int i = ThreadID; i < str->CandidateFiles.size(); i += NumberOfThreads )
+    {
+    try {
+      reader->SetFileName ( itksys::SystemTools::CollapseFullPath ( str->CandidateFiles[i].c_str() ) );
+      reader->Update();
+    } catch ( ExceptionObject& e ) {
+      ::std::ostringstream msg;
+      msg << "Failed to read " << str->CandidateFiles[i] << " caught " << e;
+      str->Errors[ThreadID] = msg.str();
+      break;
+    }
+    // Verify that we have the same size as expected
+    ImageRegion<3> region = reader->GetOutput()->GetLargestPossibleRegion();
+    if ( str->Dimensions[0] != region.GetSize()[0]
+         || str->Dimensions[1] != region.GetSize()[1]
+         || str->Dimensions[2] != region.GetSize()[2] ) {
+      ::std::ostringstream msg;
+      msg << " size of the data in " << str->CandidateFiles[i] << " is ("
+          << region.GetSize()[0] << ", "
+          << region.GetSize()[1] << ", "
+          << region.GetSize()[2] << ") "
+          << " and does not match the expectected size ("
+          << str->Dimensions[0] << ", "
+          << str->Dimensions[1] << ", "
+          << str->Dimensions[2] << ")";
+      str->Errors[ThreadID] = msg.str();
+      break;
+    }
+    WriteVolumeBlocks ( reader->GetOutput(), i, BlocksPerImage, str->BlocksPerFile, db );
+    }
+
+  for ( ::size_t idx = 0; idx < db.size(); idx++ )
+    {
+    db[idx]->flush();
+    db[idx]->close();
+    }
+  return ITK_THREAD_RETURN_VALUE;
+}
+
+template <class TPixel>
+void TimeSeriesDatabase<TPixel>::CreateFromFileArchetype ( const char* TSDFilename, const char* archetype, unsigned long FileSize, unsigned int NumberOfThreads )
 {
 
   unsigned long BlocksPerFile = FileSize / ( TimeSeriesVolumeBlockSize * sizeof ( TPixel ) );
@@ -357,8 +617,7 @@ void TimeSeriesDatabase<TPixel>::CreateFromFileArchetype ( const char* TSDFilena
   ArchetypeSeriesFileNames::Pointer fit = itk::ArchetypeSeriesFileNames::New();
   fit->SetArchetype ( fileNameCollapsed );
   
-  typedef Image<TPixel,3> ImageType;
-  typedef ImageFileReader<ImageType> ReaderType;
+  typedef ImageFileReader<OutputImageType> ReaderType;
   ImageRegion<3> region;
 
   // Load the first image's size
@@ -384,138 +643,70 @@ void TimeSeriesDatabase<TPixel>::CreateFromFileArchetype ( const char* TSDFilena
   m_OutputOrigin = reader->GetOutput()->GetOrigin();
   m_OutputDirection = reader->GetOutput()->GetDirection();
 
-
-  // Make our array, and open it
-  std::vector<StreamPtr> db;
-  db.push_back ( StreamPtr ( new std::fstream ( TSDFilename, ::std::ios::out | ::std::ios::binary ) ) );
-
-  // Filenames
-  std::vector<std::string> Filenames;
-  Filenames.push_back ( std::string ( TSDFilename ) );
-
-  // Start reading and writing out the images, 16x16x16 blocks at a time.
-  for ( unsigned int i = 0; i < candidateFiles.size(); i++ )
+  CreateThreadStruct str;
+  str.CandidateFiles = candidateFiles;
+  str.BlocksPerFile = BlocksPerFile;
+  unsigned int m_BlocksPerImage[3];
+  for ( int idx = 0; idx < 3; idx++ )
     {
-    reader->SetFileName ( itksys::SystemTools::CollapseFullPath ( candidateFiles[i].c_str() ) );
-    try {
-      reader->Update();
-    } catch ( ExceptionObject& e ) {
-      itkGenericExceptionMacro ( << "Failed to read " << candidateFiles[i] << " caught " << e );
+    str.Dimensions[idx] = m_Dimensions[idx];
+    m_BlocksPerImage[idx] = (unsigned int) ceil ( m_Dimensions[idx] / (float)TimeSeriesBlockSize );
     }
-    // Verify that we have the same size as expected
-    region = reader->GetOutput()->GetLargestPossibleRegion();
-    if ( m_Dimensions[0] != region.GetSize()[0]
-         || m_Dimensions[1] != region.GetSize()[1]
-         || m_Dimensions[2] != region.GetSize()[2] ) {
 
-      // close them all
-    for ( int idx = 0; idx < (int)(db.size()); idx++ )
+  // Filenames, the last block of the last volume tells how many files we need
+  Size<3> LastBlock = { { m_BlocksPerImage[0] - 1, m_BlocksPerImage[1] - 1, m_BlocksPerImage[2] - 1 } };
+  unsigned long LastIndex = CalculateIndex ( LastBlock, m_Dimensions[3] - 1, m_BlocksPerImage );
+  unsigned int NumberOfFiles = CalculateFileIndex ( LastIndex, BlocksPerFile ) + 1;
+  str.Filenames.push_back ( std::string ( TSDFilename ) );
+  for ( unsigned int FileIndex = 1; FileIndex < NumberOfFiles; FileIndex++ )
+    {
+    ::std::ostringstream newFN;
+    newFN << TSDFilename << FileIndex;
+    str.Filenames.push_back ( newFN.str() );
+    }
+  // Create (or truncate) them all before the threads open them for update
+  for ( ::size_t idx = 0; idx < str.Filenames.size(); idx++ )
+    {
+    std::ofstream create ( str.Filenames[idx].c_str(), ::std::ios::out | ::std::ios::binary );
+    if ( !create )
       {
-      db[idx]->close();
+      itkGenericExceptionMacro ( "TimeSeriesDatabase::CreateFromFileArchetype: could not create " << str.Filenames[idx] );
       }
-    itkGenericExceptionMacro ( << " size of the data in " << candidateFiles[i] << " is (" 
-                               << region.GetSize()[0] << ", "
-                               << region.GetSize()[1] << ", "
-                               << region.GetSize()[2] << ") "
-                               << " and does not match the expectected size ("
-                               << m_Dimensions[0] << ", "
-                               << m_Dimensions[1] << ", "
-                               << m_Dimensions[2] << ")" );
     }
-    
-    // Build and write our blocks
-    TPixel buffer[TimeSeriesBlockSize*TimeSeriesBlockSize*TimeSeriesBlockSize];
-    Size<3> BlockSize = { {TimeSeriesBlockSize, TimeSeriesBlockSize, TimeSeriesBlockSize }};
-    ImageRegion<3> BlockRegion;
-    unsigned int m_BlocksPerImage[3];
-    
-    BlockRegion.SetSize ( BlockSize );
-    for ( int idx = 0; idx < 3; idx++ )
+
+  // Start reading and writing out the images, 16x16x16 blocks at a time,
+  // NumberOfThreads images at a time.
+  NumberOfThreads = TSD_MIN ( TSD_MIN ( NumberOfThreads, static_cast<unsigned int> ( ITK_MAX_THREADS ) ),
+                              static_cast<unsigned int> ( candidateFiles.size() ) );
+  NumberOfThreads = NumberOfThreads < 1 ? 1 : NumberOfThreads;
+  str.Errors.resize ( NumberOfThreads );
+  // The readers are created here, the IO factories are not thread safe
+  str.Readers.push_back ( reader );
+  for ( unsigned int t = 1; t < NumberOfThreads; t++ )
+    {
+    typename ReaderType::Pointer threadReader = ReaderType::New();
+    LightObject::Pointer io = reader->GetImageIO()->CreateAnother();
+    threadReader->SetImageIO ( dynamic_cast<ImageIOBase*> ( io.GetPointer() ) );
+    str.Readers.push_back ( threadReader );
+    }
+
+  MultiThreader::Pointer threader = MultiThreader::New();
+  threader->SetNumberOfThreads ( NumberOfThreads );
+  threader->SetSingleMethod ( CreateThreaderCallback, &str );
+  threader->SingleMethodExecute();
+
+  for ( ::size_t idx = 0; idx < str.Errors.size(); idx++ )
+    {
+    if ( !str.Errors[idx].empty() )
       {
-      m_BlocksPerImage[idx] = (unsigned int) ceil ( m_Dimensions[idx] / (float)TimeSeriesBlockSize );
-      }
-    Size<3> CurrentBlock;
-    for ( CurrentBlock[2] = 0; CurrentBlock[2] < m_BlocksPerImage[2]; CurrentBlock[2]++ )
-      {
-      for ( CurrentBlock[1] = 0; CurrentBlock[1] < m_BlocksPerImage[1]; CurrentBlock[1]++ )
-        {
-        for ( CurrentBlock[0] = 0; CurrentBlock[0] < m_BlocksPerImage[0]; CurrentBlock[0]++ )
-          {
-          /*
-          std::cout << "Reading/Writing Block: " << CurrentBlock[0] << ", " << CurrentBlock[1] << ", " << CurrentBlock[2] << endl;
-          std::cout << "Debug: " << ( ( CurrentBlock[2] * TimeSeriesBlockSize + TimeSeriesBlockSize ) < region.GetSize()[2] ) << endl;
-          std::cout << "Debug: " << CurrentBlock[2] * TimeSeriesBlockSize + TimeSeriesBlockSize << " Region size  " << region.GetSize()[2] << endl;
-          */
-          // Load up the block, and save it at the proper index
-          // Is this block fully within the image?
-          if ( ( ( CurrentBlock[0] * TimeSeriesBlockSize + TimeSeriesBlockSize ) < region.GetSize()[0] )
-               && ( ( CurrentBlock[1] * TimeSeriesBlockSize + TimeSeriesBlockSize ) < region.GetSize()[1] )
-               && ( ( CurrentBlock[2] * TimeSeriesBlockSize + TimeSeriesBlockSize ) < region.GetSize()[2] ) )
-            {
-            // Good we can use an iterator!
-            Index<3> BlockIndex = { {CurrentBlock[0] * TimeSeriesBlockSize,  CurrentBlock[1] * TimeSeriesBlockSize,  CurrentBlock[2] * TimeSeriesBlockSize }};
-            BlockRegion.SetIndex ( BlockIndex );
-            ImageRegionIteratorWithIndex<ImageType> it ( reader->GetOutput(), BlockRegion );
-            it.GoToBegin();
-            TPixel* ptr = buffer;
-            while ( !it.IsAtEnd() )
-              {
-              *ptr = it.Value();
-              ++it;
-              ++ptr;
-              }
-            } 
-          else
-            {
-            // cout << "The Hard way" << std::endl;
-            // Now we do it the hard way...
-            Index<3> BlockIndex;
-            Size<3> StartIndex, EndIndex;
-            for ( int ii = 0; ii < 3; ii++ ) 
-              {
-              StartIndex[ii] = CurrentBlock[ii]*TimeSeriesBlockSize;
-              EndIndex[ii] = TSD_MIN ( StartIndex[ii] + TimeSeriesBlockSize, region.GetSize()[ii] );
-              }            
-            for ( unsigned int bz = StartIndex[2]; bz < EndIndex[2]; bz++ ) 
-              {
-              BlockIndex[2] = bz;
-              for ( unsigned int by = StartIndex[1]; by < EndIndex[1]; by++ ) 
-                {
-                BlockIndex[1] = by;
-                for ( unsigned int bx = StartIndex[0]; bx < EndIndex[0]; bx++ ) 
-                  {
-                  // Put bx,by,bz into bx-xoff,by-yoff,bz-zoff
-                  BlockIndex[0] = bx;
-                  TPixel value = reader->GetOutput()->GetPixel ( BlockIndex );
-                  buffer[bx-StartIndex[0] + TimeSeriesBlockSize*(by-StartIndex[1]) + TimeSeriesBlockSize*TimeSeriesBlockSize*(bz-StartIndex[2])] = value;
-                  }
-                }
-              }
-            }
-          // Calculate where to write...  This code is copied from CalculatePosition and CalculateIndex
-          unsigned long index = CalculateIndex ( CurrentBlock, i, m_BlocksPerImage );
-          // Adjust the position, based on the FileIndex
-          ::std::streampos position = CalculatePosition ( index, BlocksPerFile );
-          unsigned long FileIndex = CalculateFileIndex ( index, BlocksPerFile );
-          // std::cout << "Found FileIndex : " << FileIndex << " For index: " << index << " position: " << position << std::endl;
-
-          while ( FileIndex >= db.size() )
-            {
-            // push on the next one.
-            ::std::ostringstream newFN;
-            newFN << TSDFilename << FileIndex;
-            // ::std::cout << "opening new file : " << newFN.str() << std::endl;
-            db.push_back ( StreamPtr ( new std::fstream ( newFN.str().c_str(), ::std::ios::out | ::std::ios::binary ) ) );
-            Filenames.push_back ( newFN.str() );
-            }
-          
-          db[FileIndex]->seekp ( position );
-          db[FileIndex]->write ( reinterpret_cast<char*> ( buffer ), TimeSeriesBlockSize*TimeSeriesBlockSize*TimeSeriesBlockSize*sizeof(TPixel) );
-          }
-        }
+      itkGenericExceptionMacro ( << str.Errors[idx] );
       }
     }
+
   // Write the header
+  std::vector<StreamPtr> db;
+  db.push_back ( StreamPtr ( new std::fstream ( TSDFilename, ::std::ios::in | ::std::ios::out | ::std::ios::binary ) ) );
+  std::vector<std::string>& Filenames = str.Filenames;
   db[0]->seekp ( 0 );
   ::std::ostringstream b;
   b << "TimeSeriesDatabase" << ::std::endl;
@@ -536,7 +727,7 @@ void TimeSeriesDatabase<TPixel>::CreateFromFileArchetype ( const char* TSDFilena
   b << "BlocksPerFile: " << BlocksPerFile << std::endl;
   b << "NumberOfFiles: " << Filenames.size() << std::endl;
   b << "Filenames: " << std::endl;
-  for ( ::size_t idx = 0; idx < db.size(); idx++ )
+  for ( ::size_t idx = 0; idx < Filenames.size(); idx++ )
     {
     b << Filenames[idx] << std::endl;
     }
@@ -561,7 +752,7 @@ void TimeSeriesDatabase<TPixel>::SetCacheSizeInMiB ( float sz )
 {
   // How many blocks is this?
   double BlockSizeInMiB = sizeof ( TPixel ) * TimeSeriesVolumeBlockSize / ( 1024*1024.);
-  unsigned long int blocks = (unsigned long int) ceil ( sz * BlockSizeInMiB );
+  unsigned long int blocks = (unsigned long int) ceil ( sz / BlockSizeInMiB );
   this->m_Cache.set_maxsize ( blocks );
 }
 
@@ -571,11 +762,13 @@ template <class TPixel>
 TimeSeriesDatabase<TPixel>::TimeSeriesDatabase () : m_Cache ( 1024 ){
   this->m_Dimensions.SetSize ( 4 );
   this->m_BlocksPerImage.SetSize ( 4 );
+  this->m_UseMemoryMapping = true;
 }
   
 template <class TPixel>
 TimeSeriesDatabase<TPixel>::~TimeSeriesDatabase () {
   // m_Cache.statistics ( std::cout );
+  this->UnmapDatabaseFiles();
 }
   
 
@@ -596,6 +789,7 @@ TimeSeriesDatabase<TPixel>
   if ( this->IsOpen() ) {
     os << indent << "Database is open." << "\n";
     os << indent << "Blocks per file: " << this->m_BlocksPerFile << "\n";
+    os << indent << "Memory mapped: " << this->IsMemoryMapped() << "\n";
     os << indent << "File names: " << "\n";
     for ( ::size_t idx = 0; idx < this->m_DatabaseFileNames.size(); idx++ )
       {
@@ -7,15 +7,21 @@
 #include "vtkITKGrowCutSegmentationImageFilter.h"
 
 // VTK includes
+#include <vtkFloatArray.h>
 #include <vtkImageCast.h>
 #include <vtkImageData.h>
 #include <vtkObjectFactory.h>
+#include <vtkPointData.h>
+#include <vtkTypeTraits.h>
 
 // ITK includes
 #include <itkGrowCutSegmentationImageFilter.h>
 #include <itkImageRegionIteratorWithIndex.h>
 #include <itkRegionOfInterestImageFilter.h>
 
+// STD includes
+#include <algorithm>
+
 //-----------------------------------------------------------------------------
 vtkCxxRevisionMacro(vtkITKGrowCutSegmentationImageFilter, "$Revision: 1.3 $");
 vtkStandardNewMacro(vtkITKGrowCutSegmentationImageFilter);
@@ -59,6 +65,9 @@ void vtkITKImageGrowCutExecute3D(vtkImageData *inData,
   OT *output, double &ObjectSize,
   double &contrastNoiseRatio,
   double &priorSegmentStrength,
+  vtkImageData *previousSegmentation,
+  vtkFloatArray *strengths,
+  int useActiveFront, int numberOfThreads,
   itk::CStyleCommand::Pointer progressCommand)
 {
   typedef itk::Image<IT1, 3> InImageType;
@@ -125,6 +134,28 @@ void vtkITKImageGrowCutExecute3D(vtkImageData *inData,
   itk::ImageRegionConstIterator< OutImageType > plabel(prevSegmentedImage,
     prevSegmentedImage->GetBufferedRegion() );
 
+  // Restart from the previous segmentation only if the gestures were added
+  // to it: a voxel that was erased from the previous output can not be
+  // unlabeled by the cellular automaton, whose strengths only increase.
+  const vtkIdType numberOfVoxels = static_cast<vtkIdType>(dims[0]) * dims[1] * dims[2];
+  OT *previousOutput = 0;
+  if (previousSegmentation && strengths &&
+      previousSegmentation->GetScalarType() == vtkTypeTraits<OT>::VTKTypeID() &&
+      previousSegmentation->GetNumberOfPoints() == numberOfVoxels &&
+      strengths->GetNumberOfTuples() == numberOfVoxels)
+    {
+    previousOutput = static_cast<OT*>(previousSegmentation->GetScalarPointer());
+    for (vtkIdType i = 0; i < numberOfVoxels; ++i)
+      {
+      if (inPtr2[i] == 0 && previousOutput[i] != 0)
+        {
+        previousOutput = 0;
+        break;
+        }
+      }
+    }
+  const float *previousStrengths = previousOutput ? strengths->GetPointer(0) : 0;
+
   if(contrastNoiseRatio > 1.0)
     {
     contrastNoiseRatio /= 100.0;
@@ -147,8 +178,9 @@ void vtkITKImageGrowCutExecute3D(vtkImageData *inData,
 
   bool foundLabel = false;
 
+  vtkIdType voxel = 0;
   for(weight.GoToBegin(), label.GoToBegin(); !weight.IsAtEnd();
-      ++weight, ++label)
+      ++weight, ++label, ++voxel)
   {
     typename OutImageType::PixelType color = label.Get();
     if(color == 0)
@@ -157,7 +189,16 @@ void vtkITKImageGrowCutExecute3D(vtkImageData *inData,
       }
     else
       {
-      weight.Set( contrastNoiseRatio );
+      // the voxels labeled by the previous segmentation keep their strength,
+      // the others are new seeds
+      if (previousOutput && previousOutput[voxel] == color)
+        {
+        weight.Set( previousStrengths[voxel] );
+        }
+      else
+        {
+        weight.Set( contrastNoiseRatio );
+        }
 
       typename OutImageType::IndexType idx = label.GetIndex();
       for (unsigned i = 0; i < ndims; i++)
@@ -288,6 +329,11 @@ void vtkITKImageGrowCutExecute3D(vtkImageData *inData,
   typename WeightImageType::Pointer wtImage = WeightImageType::New();
   wtImage = fWeight->GetOutput();
 
+  if (previousOutput)
+    {
+    std::cout << " Restarting from the previous segmentation " << std::endl;
+    }
+
   filter->SetInput( inImage );
   filter->SetLabelImage( labImage );
 
@@ -295,6 +341,8 @@ void vtkITKImageGrowCutExecute3D(vtkImageData *inData,
 
   filter->SetSeedStrength( contrastNoiseRatio );
   filter->SetObjectRadius((unsigned int)ObjectSize);
+  filter->SetUseActiveFront( useActiveFront != 0 );
+  filter->SetNumberOfThreads( numberOfThreads );
 
   filter->Update();
   outputImageROI = filter->GetOutput();
@@ -315,6 +363,29 @@ void vtkITKImageGrowCutExecute3D(vtkImageData *inData,
     out.Set(filterOut.Get());
     }
 
+  // keep the strengths of the whole image for the next execution
+  if (strengths)
+    {
+    strengths->SetNumberOfTuples(numberOfVoxels);
+    strengths->FillComponent(0, 0.);
+
+    typename WeightImageType::Pointer strengthsImage = WeightImageType::New();
+    strengthsImage->CopyInformation( labelImage );
+    strengthsImage->SetRegions( labelImage->GetBufferedRegion() );
+    strengthsImage->GetPixelContainer()->SetImportPointer(
+      strengths->GetPointer(0), numberOfVoxels, false);
+
+    const typename WeightImageType::Pointer filterStrengths = filter->GetUpdatedStrengthImage();
+    itk::ImageRegionConstIterator< WeightImageType > strengthOut(filterStrengths,
+      filterStrengths->GetBufferedRegion());
+    itk::ImageRegionIterator< WeightImageType > strength(strengthsImage, oRegion);
+    for (strengthOut.GoToBegin(), strength.GoToBegin(); !strengthOut.IsAtEnd();
+         ++strengthOut, ++strength)
+      {
+      strength.Set(strengthOut.Get());
+      }
+    }
+
  memcpy(output, outputImage->GetBufferPointer(),
          outputImage->GetBufferedRegion().GetNumberOfPixels()*sizeof(OT) );
 }
@@ -325,6 +396,18 @@ vtkITKGrowCutSegmentationImageFilter::vtkITKGrowCutSegmentationImageFilter()
   this->ObjectSize = 20;
   this->ContrastNoiseRatio = 1.0;
   this->PriorSegmentConfidence = 0.003;
+  this->UsePreviousSegmentation = 0;
+  this->UseActiveFront = 1;
+  this->PreviousSegmentation = vtkImageData::New();
+  this->Strengths = vtkFloatArray::New();
+  this->PreviousIntensityMTime = 0;
+}
+
+//-----------------------------------------------------------------------------
+vtkITKGrowCutSegmentationImageFilter::~vtkITKGrowCutSegmentationImageFilter()
+{
+  this->PreviousSegmentation->Delete();
+  this->Strengths->Delete();
 }
 
 //-----------------------------------------------------------------------------
@@ -334,6 +417,8 @@ void ExecuteGrowCut( vtkITKGrowCutSegmentationImageFilter *self,
           vtkImageData *input2,
           vtkImageData *input3,
           vtkImageData *outData,
+          vtkImageData *previousSegmentation,
+          vtkFloatArray *strengths,
           IT1 *)
 {
   int outExt[6];
@@ -402,6 +487,8 @@ void ExecuteGrowCut( vtkITKGrowCutSegmentationImageFilter *self,
           (short*)(outPtr),
           self->ObjectSize, self->ContrastNoiseRatio,
           self->PriorSegmentConfidence,
+          previousSegmentation, strengths,
+          self->UseActiveFront, self->GetNumberOfThreads(),
           progressCommand);
         imageCaster1->Delete();
         }
@@ -418,6 +505,8 @@ void ExecuteGrowCut( vtkITKGrowCutSegmentationImageFilter *self,
             (unsigned short*)(outPtr),
             self->ObjectSize, self->ContrastNoiseRatio,
             self->PriorSegmentConfidence,
+            previousSegmentation, strengths,
+            self->UseActiveFront, self->GetNumberOfThreads(),
             progressCommand);
           }
         else if (input2->GetScalarType() == VTK_SHORT)
@@ -427,6 +516,8 @@ void ExecuteGrowCut( vtkITKGrowCutSegmentationImageFilter *self,
             (short*)(outPtr),
             self->ObjectSize, self->ContrastNoiseRatio,
             self->PriorSegmentConfidence,
+            previousSegmentation, strengths,
+            self->UseActiveFront, self->GetNumberOfThreads(),
             progressCommand);
           }
         else if(input2->GetScalarType() == VTK_UNSIGNED_CHAR)
@@ -436,6 +527,8 @@ void ExecuteGrowCut( vtkITKGrowCutSegmentationImageFilter *self,
             (unsigned char*)(outPtr),
             self->ObjectSize, self->ContrastNoiseRatio,
             self->PriorSegmentConfidence,
+            previousSegmentation, strengths,
+            self->UseActiveFront, self->GetNumberOfThreads(),
             progressCommand);
           }
         else if(input2->GetScalarType() == VTK_CHAR)
@@ -445,6 +538,8 @@ void ExecuteGrowCut( vtkITKGrowCutSegmentationImageFilter *self,
             (char*)(outPtr),
             self->ObjectSize, self->ContrastNoiseRatio,
             self->PriorSegmentConfidence,
+            previousSegmentation, strengths,
+            self->UseActiveFront, self->GetNumberOfThreads(),
             progressCommand);
           }
         else if(input2->GetScalarType() == VTK_UNSIGNED_LONG)
@@ -454,6 +549,8 @@ void ExecuteGrowCut( vtkITKGrowCutSegmentationImageFilter *self,
             (unsigned long*)(outPtr),
             self->ObjectSize, self->ContrastNoiseRatio,
             self->PriorSegmentConfidence,
+            previousSegmentation, strengths,
+            self->UseActiveFront, self->GetNumberOfThreads(),
             progressCommand);
           }
         else if(input2->GetScalarType() == VTK_LONG)
@@ -463,6 +560,8 @@ void ExecuteGrowCut( vtkITKGrowCutSegmentationImageFilter *self,
             (long*)(outPtr),
             self->ObjectSize, self->ContrastNoiseRatio,
             self->PriorSegmentConfidence,
+            previousSegmentation, strengths,
+            self->UseActiveFront, self->GetNumberOfThreads(),
             progressCommand);
           }
         }
@@ -494,6 +593,8 @@ void ExecuteGrowCut( vtkITKGrowCutSegmentationImageFilter *self,
         (short*)(outPtr),
         self->ObjectSize, self->ContrastNoiseRatio,
         self->PriorSegmentConfidence,
+        previousSegmentation, strengths,
+        self->UseActiveFront, self->GetNumberOfThreads(),
         progressCommand);
 
       imageCaster1->Delete();
@@ -510,6 +611,8 @@ void ExecuteGrowCut( vtkITKGrowCutSegmentationImageFilter *self,
           (unsigned short*)(outPtr),
           self->ObjectSize, self->ContrastNoiseRatio,
           self->PriorSegmentConfidence,
+          previousSegmentation, strengths,
+          self->UseActiveFront, self->GetNumberOfThreads(),
           progressCommand);
         }
       else if (input2->GetScalarType() == VTK_SHORT)
@@ -519,6 +622,8 @@ void ExecuteGrowCut( vtkITKGrowCutSegmentationImageFilter *self,
           (short*)(outPtr),
           self->ObjectSize, self->ContrastNoiseRatio,
           self->PriorSegmentConfidence,
+          previousSegmentation, strengths,
+          self->UseActiveFront, self->GetNumberOfThreads(),
           progressCommand);
         }
       else if(input2->GetScalarType() == VTK_UNSIGNED_CHAR)
@@ -528,6 +633,8 @@ void ExecuteGrowCut( vtkITKGrowCutSegmentationImageFilter *self,
           (unsigned char*)(outPtr),
           self->ObjectSize, self->ContrastNoiseRatio,
           self->PriorSegmentConfidence,
+          previousSegmentation, strengths,
+          self->UseActiveFront, self->GetNumberOfThreads(),
           progressCommand);
         }
       else if(input2->GetScalarType() == VTK_CHAR)
@@ -537,6 +644,8 @@ void ExecuteGrowCut( vtkITKGrowCutSegmentationImageFilter *self,
           (char*)(outPtr),
           self->ObjectSize, self->ContrastNoiseRatio,
           self->PriorSegmentConfidence,
+          previousSegmentation, strengths,
+          self->UseActiveFront, self->GetNumberOfThreads(),
           progressCommand);
         }
       else if(input2->GetScalarType() == VTK_UNSIGNED_LONG)
@@ -546,6 +655,8 @@ void ExecuteGrowCut( vtkITKGrowCutSegmentationImageFilter *self,
         (unsigned long*)(outPtr),
         self->ObjectSize, self->ContrastNoiseRatio,
         self->PriorSegmentConfidence,
+        previousSegmentation, strengths,
+        self->UseActiveFront, self->GetNumberOfThreads(),
         progressCommand);
       }
       else if(input2->GetScalarType() == VTK_LONG)
@@ -555,6 +666,8 @@ void ExecuteGrowCut( vtkITKGrowCutSegmentationImageFilter *self,
           (long*)(outPtr),
           self->ObjectSize, self->ContrastNoiseRatio,
           self->PriorSegmentConfidence,
+          previousSegmentation, strengths,
+          self->UseActiveFront, self->GetNumberOfThreads(),
           progressCommand);
         }
       }
@@ -571,12 +684,41 @@ void vtkITKGrowCutSegmentationImageFilter::ExecuteData(
 
   vtkImageData * out = vtkImageData::SafeDownCast(outData);
 
+  // The previous segmentation is only valid for the same intensity image
+  vtkImageData *previousSegmentation = 0;
+  vtkFloatArray *strengths = 0;
+  if (this->UsePreviousSegmentation)
+    {
+    int extent[6];
+    int previousExtent[6];
+    input1->GetExtent(extent);
+    this->PreviousSegmentation->GetExtent(previousExtent);
+    if (this->PreviousSegmentation->GetPointData()->GetScalars() &&
+        input1->GetMTime() == this->PreviousIntensityMTime &&
+        std::equal(extent, extent + 6, previousExtent))
+      {
+      previousSegmentation = this->PreviousSegmentation;
+      }
+    strengths = this->Strengths;
+    }
+
   switch(input1->GetScalarType() ) {
     vtkTemplateMacro( ExecuteGrowCut(this, input1, input2,
-             input3, out,
+             input3, out, previousSegmentation, strengths,
              static_cast< VTK_TT*>(0)));
     break;
   }
+
+  if (this->UsePreviousSegmentation)
+    {
+    this->PreviousSegmentation->DeepCopy(out);
+    this->PreviousIntensityMTime = input1->GetMTime();
+    }
+  else
+    {
+    this->PreviousSegmentation->Initialize();
+    this->Strengths->Initialize();
+    }
 }
 
 //-----------------------------------------------------------------------------
@@ -604,4 +746,6 @@ void vtkITKGrowCutSegmentationImageFilter::PrintSelf(ostream& os, vtkIndent inde
 
   os << indent << "Object Size : " << this->ObjectSize << std::endl;
   os << indent << "ContrastNoiseRatio : " << this->ContrastNoiseRatio << std::endl;
+  os << indent << "UsePreviousSegmentation : " << this->UsePreviousSegmentation << std::endl;
+  os << indent << "UseActiveFront : " << this->UseActiveFront << std::endl;
 }
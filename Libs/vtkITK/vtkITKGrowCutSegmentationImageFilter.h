@@ -7,6 +7,7 @@
 // VTK includes
 #include <vtkImageMultipleInputFilter.h>
 
+class vtkFloatArray;
 class vtkImageData;
 
 /// \brief- Wrapper class around itk::GrowCutSegmentationImageFilter
@@ -43,6 +44,25 @@ public:
   vtkSetMacro(PriorSegmentConfidence, double);
   vtkGetMacro(PriorSegmentConfidence, double);
 
+  /// When on, the filter keeps the label strengths of its last execution.
+  /// If the next execution has the same intensity image and the gesture
+  /// image only differs from the last output by new gestures (e.g. the
+  /// user added seeds to the previous segmentation), the segmentation
+  /// restarts from the previous labels and strengths instead of from
+  /// the gestures only, so only the region around the new seeds is
+  /// recomputed. Off by default.
+  vtkSetMacro(UsePreviousSegmentation, int);
+  vtkGetMacro(UsePreviousSegmentation, int);
+  vtkBooleanMacro(UsePreviousSegmentation, int);
+
+  /// When on, each iteration only evaluates the voxels next to a voxel
+  /// that changed at the previous iteration, with NumberOfThreads threads.
+  /// When off, all the voxels are evaluated at each iteration.
+  /// Both give the same segmentation. On by default.
+  vtkSetMacro(UseActiveFront, int);
+  vtkGetMacro(UseActiveFront, int);
+  vtkBooleanMacro(UseActiveFront, int);
+
 public:
   double ObjectSize;
   double PriorSegmentConfidence;
@@ -51,7 +71,7 @@ public:
 
 protected:
   vtkITKGrowCutSegmentationImageFilter();
-  ~vtkITKGrowCutSegmentationImageFilter(){}
+  ~vtkITKGrowCutSegmentationImageFilter();
 
   virtual void ExecuteData(vtkDataObject *outData);
 
@@ -64,6 +84,15 @@ protected:
   /// override to ExecuteInformation(vtkImageData**, vtkImageData**)
   virtual void ExecuteInformation();
 
+  int UsePreviousSegmentation;
+  int UseActiveFront;
+
+  /// Output and label strengths of the last execution, and modification
+  /// time of the intensity image it was computed from.
+  vtkImageData* PreviousSegmentation;
+  vtkFloatArray* Strengths;
+  unsigned long PreviousIntensityMTime;
+
 private:
   vtkITKGrowCutSegmentationImageFilter(const vtkITKGrowCutSegmentationImageFilter&);  // Not implemented.
   void operator=(const vtkITKGrowCutSegmentationImageFilter&);  // Not implemented.
@@ -0,0 +1,213 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+// vtkTeem includes
+#include <vtkFiberBundleLevelOfDetail.h>
+
+// VTK includes
+#include <vtkCellArray.h>
+#include <vtkCellData.h>
+#include <vtkIntArray.h>
+#include <vtkMath.h>
+#include <vtkNew.h>
+#include <vtkPointData.h>
+#include <vtkPoints.h>
+#include <vtkPolyData.h>
+#include <vtkSmartPointer.h>
+
+// STD includes
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+
+namespace
+{
+
+const int NumberOfFibers = 64;
+const int NumberOfPointsPerFiber = 15;
+
+//----------------------------------------------------------------------------
+// Each fiber goes straight for 4 steps, turns by 15 degrees and goes
+// straight for 5 steps, then turns by 90 degrees and goes straight for 5
+// steps. Without kinks, the fibers are straight lines.
+// The fibers and their points are numbered in the cell and point data.
+void createFibers(vtkPolyData* fibers, bool kinks)
+{
+  vtkNew<vtkPoints> points;
+  vtkNew<vtkCellArray> lines;
+  vtkNew<vtkIntArray> fiberIds;
+  fiberIds->SetName("FiberId");
+  vtkNew<vtkIntArray> pointIds;
+  pointIds->SetName("PointId");
+  const double kinkAngle = kinks ? vtkMath::RadiansFromDegrees(15.) : 0.;
+  const double cornerAngle = kinks ? vtkMath::RadiansFromDegrees(105.) : 0.;
+  for (int fiber = 0; fiber < NumberOfFibers; ++fiber)
+    {
+    double point[3] = {0., 0., static_cast<double>(fiber)};
+    lines->InsertNextCell(NumberOfPointsPerFiber);
+    for (int i = 0; i < NumberOfPointsPerFiber; ++i)
+      {
+      lines->InsertCellPoint(points->InsertNextPoint(point));
+      pointIds->InsertNextValue(i);
+      double angle = (i >= 9 ? cornerAngle : (i >= 4 ? kinkAngle : 0.));
+      point[0] += cos(angle);
+      point[1] += sin(angle);
+      }
+    fiberIds->InsertNextValue(fiber);
+    }
+  fibers->SetPoints(points.GetPointer());
+  fibers->SetLines(lines.GetPointer());
+  fibers->GetPointData()->AddArray(pointIds.GetPointer());
+  fibers->GetCellData()->AddArray(fiberIds.GetPointer());
+  fibers->Modified();
+}
+
+//----------------------------------------------------------------------------
+// Check that the output has one fiber out of 2^level, starting with the
+// first one, and that each fiber has the expected points of the input fiber.
+bool checkLevel(vtkPolyData* output, int level,
+                const int* expectedPointIds, int expectedNumberOfPoints)
+{
+  const int expectedNumberOfFibers = ((NumberOfFibers - 1) >> level) + 1;
+  vtkIntArray* fiberIds = vtkIntArray::SafeDownCast(
+    output->GetCellData()->GetArray("FiberId"));
+  vtkIntArray* pointIds = vtkIntArray::SafeDownCast(
+    output->GetPointData()->GetArray("PointId"));
+  if (output->GetNumberOfLines() != expectedNumberOfFibers ||
+      !fiberIds || !pointIds ||
+      fiberIds->GetNumberOfTuples() != expectedNumberOfFibers ||
+      output->GetNumberOfPoints() != expectedNumberOfFibers * expectedNumberOfPoints)
+    {
+    std::cerr << "Level " << level << ": wrong number of fibers "
+              << output->GetNumberOfLines() << " or points "
+              << output->GetNumberOfPoints() << std::endl;
+    return false;
+    }
+  vtkIdType npts = 0;
+  vtkIdType* pts = 0;
+  output->GetLines()->InitTraversal();
+  for (int fiber = 0; output->GetLines()->GetNextCell(npts, pts); ++fiber)
+    {
+    if (fiberIds->GetValue(fiber) != (fiber << level) ||
+        npts != expectedNumberOfPoints)
+      {
+      std::cerr << "Level " << level << ": wrong fiber " << fiber
+                << ", input fiber " << fiberIds->GetValue(fiber)
+                << " with " << npts << " points" << std::endl;
+      return false;
+      }
+    for (vtkIdType i = 0; i < npts; ++i)
+      {
+      if (pointIds->GetValue(pts[i]) != expectedPointIds[i] ||
+          output->GetPoint(pts[i])[2] != (fiber << level))
+        {
+        std::cerr << "Level " << level << ": wrong point " << i
+                  << " of fiber " << fiber << ", input point "
+                  << pointIds->GetValue(pts[i]) << std::endl;
+        return false;
+        }
+      }
+    }
+  return true;
+}
+
+} // end of anonymous namespace
+
+//----------------------------------------------------------------------------
+int vtkFiberBundleLevelOfDetailTest1(int vtkNotUsed(argc), char * vtkNotUsed(argv)[])
+{
+  vtkNew<vtkPolyData> fibers;
+  createFibers(fibers.GetPointer(), true);
+  vtkNew<vtkFiberBundleLevelOfDetail> levelOfDetail;
+  levelOfDetail->SetInput(fibers.GetPointer());
+  vtkPolyData* output = levelOfDetail->GetOutput();
+
+  // Level 0 is the input
+  levelOfDetail->Update();
+  if (output->GetNumberOfLines() != NumberOfFibers ||
+      output->GetNumberOfPoints() != fibers->GetNumberOfPoints() ||
+      output->GetPoints() != fibers->GetPoints())
+    {
+    std::cerr << "Level 0 is not the input" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // Level 1 keeps the 15 degree kink and the corner (tolerance 10 degrees)
+  levelOfDetail->SetLevel(1);
+  levelOfDetail->Update();
+  const int level1PointIds[4] = {0, 4, 9, 14};
+  if (!checkLevel(output, 1, level1PointIds, 4))
+    {
+    return EXIT_FAILURE;
+    }
+  vtkSmartPointer<vtkPoints> level1Points = output->GetPoints();
+
+  // Level 2 only keeps the corner (tolerance 20 degrees)
+  levelOfDetail->SetLevel(2);
+  levelOfDetail->Update();
+  const int level2PointIds[3] = {0, 9, 14};
+  if (!checkLevel(output, 2, level2PointIds, 3))
+    {
+    return EXIT_FAILURE;
+    }
+
+  // Level 10 keeps only the first fiber, and only its end points
+  // (tolerance 100 degrees)
+  levelOfDetail->SetLevel(10);
+  levelOfDetail->Update();
+  const int level10PointIds[2] = {0, 14};
+  if (!checkLevel(output, 10, level10PointIds, 2))
+    {
+    return EXIT_FAILURE;
+    }
+
+  // Going back to a computed level reuses the cached fibers
+  levelOfDetail->SetLevel(1);
+  levelOfDetail->Update();
+  if (output->GetPoints() != level1Points ||
+      !checkLevel(output, 1, level1PointIds, 4))
+    {
+    std::cerr << "Level 1 was not cached" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // Modifying the input invalidates the cache
+  createFibers(fibers.GetPointer(), false);
+  levelOfDetail->Update();
+  const int straightPointIds[2] = {0, 14};
+  if (output->GetPoints() == level1Points ||
+      !checkLevel(output, 1, straightPointIds, 2))
+    {
+    std::cerr << "Level 1 was not computed again" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // and so does changing the tolerance
+  createFibers(fibers.GetPointer(), true);
+  levelOfDetail->Update();
+  if (!checkLevel(output, 1, level1PointIds, 4))
+    {
+    return EXIT_FAILURE;
+    }
+  levelOfDetail->SetAngleTolerance(20.);
+  levelOfDetail->Update();
+  if (!checkLevel(output, 1, level2PointIds, 3))
+    {
+    std::cerr << "Level 1 ignores the angle tolerance" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,150 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+// vtkTeem includes
+#include <vtkFiberBundleLocator.h>
+
+// VTK includes
+#include <vtkCellArray.h>
+#include <vtkIdList.h>
+#include <vtkNew.h>
+#include <vtkPoints.h>
+#include <vtkPolyData.h>
+#include <vtkSphere.h>
+
+// STD includes
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+
+namespace
+{
+
+//----------------------------------------------------------------------------
+// Helices of different radii and axes in a 100mm cube
+void createFibers(vtkPolyData* fibers)
+{
+  vtkNew<vtkPoints> points;
+  vtkNew<vtkCellArray> lines;
+  for (int fiber = 0; fiber < 200; ++fiber)
+    {
+    double center[2] = {10. + (fiber * 37) % 80, 10. + (fiber * 53) % 80};
+    double radius = 2. + fiber % 7;
+    int numberOfPoints = 20 + fiber % 30;
+    lines->InsertNextCell(numberOfPoints);
+    for (int i = 0; i < numberOfPoints; ++i)
+      {
+      double angle = 0.3 * i;
+      lines->InsertCellPoint(points->InsertNextPoint(
+        center[0] + radius * cos(angle), center[1] + radius * sin(angle),
+        100. * i / numberOfPoints));
+      }
+    }
+  fibers->SetPoints(points.GetPointer());
+  fibers->SetLines(lines.GetPointer());
+}
+
+//----------------------------------------------------------------------------
+bool isFiberInSphere(vtkPolyData* fibers, vtkIdType fiberId, vtkSphere* sphere)
+{
+  vtkIdType numberOfPoints = 0;
+  vtkIdType* pointIds = 0;
+  vtkIdType location = 0;
+  for (vtkIdType i = 0; i < fiberId; ++i)
+    {
+    location += fibers->GetLines()->GetPointer()[location] + 1;
+    }
+  fibers->GetLines()->GetCell(location, numberOfPoints, pointIds);
+  for (vtkIdType i = 0; i < numberOfPoints; ++i)
+    {
+    if (sphere->FunctionValue(fibers->GetPoint(pointIds[i])) < 0.)
+      {
+      return true;
+      }
+    }
+  return false;
+}
+
+} // end of anonymous namespace
+
+//----------------------------------------------------------------------------
+int vtkFiberBundleLocatorTest1(int vtkNotUsed(argc), char * vtkNotUsed(argv)[])
+{
+  vtkNew<vtkPolyData> fibers;
+  createFibers(fibers.GetPointer());
+  vtkNew<vtkFiberBundleLocator> locator;
+  locator->SetPolyData(fibers.GetPointer());
+  locator->SetNumberOfPointsPerBin(8);
+  if (locator->GetNumberOfFibers() != fibers->GetNumberOfLines())
+    {
+    std::cerr << "Wrong number of fibers: " << locator->GetNumberOfFibers()
+              << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // Move a sphere through the bundle, the incremental selection must always
+  // be the selection of all the fibers.
+  vtkNew<vtkSphere> sphere;
+  sphere->SetRadius(12.);
+  vtkNew<vtkIdList> candidates;
+  int numberOfSelections = 0;
+  for (int step = 0; step < 20; ++step)
+    {
+    double center[3] = {5. + 4.5 * step, 50. + 2. * step, 30. + step};
+    sphere->SetCenter(center);
+    double bounds[6];
+    for (int i = 0; i < 3; ++i)
+      {
+      bounds[2*i] = center[i] - sphere->GetRadius();
+      bounds[2*i+1] = center[i] + sphere->GetRadius();
+      }
+    locator->UpdateSelection(sphere.GetPointer(), bounds);
+    locator->FindCandidateFibers(bounds, candidates.GetPointer());
+    for (vtkIdType fiberId = 0; fiberId < fibers->GetNumberOfLines(); ++fiberId)
+      {
+      bool expected = isFiberInSphere(fibers.GetPointer(), fiberId, sphere.GetPointer());
+      if (locator->IsFiberSelected(fiberId) != expected)
+        {
+        std::cerr << "Step " << step << ": fiber " << fiberId
+                  << " selection is wrong" << std::endl;
+        return EXIT_FAILURE;
+        }
+      if (expected && candidates->IsId(fiberId) < 0)
+        {
+        std::cerr << "Step " << step << ": fiber " << fiberId
+                  << " is not a candidate" << std::endl;
+        return EXIT_FAILURE;
+        }
+      numberOfSelections += expected ? 1 : 0;
+      }
+    }
+  if (numberOfSelections == 0)
+    {
+    std::cerr << "No fiber was ever selected" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // Modifying the fibers rebuilds the locator and resets the selection
+  fibers->GetPoints()->SetPoint(0, -50., -50., -50.);
+  fibers->Modified();
+  if (locator->GetNumberOfFibers() != fibers->GetNumberOfLines() ||
+      locator->IsFiberSelected(0))
+    {
+    std::cerr << "Locator not rebuilt" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  return EXIT_SUCCESS;
+}
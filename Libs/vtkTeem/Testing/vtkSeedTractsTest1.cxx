@@ -0,0 +1,217 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+// vtkTeem includes
+#include <vtkSeedTracts.h>
+
+// VTK includes
+#include <vtkCellArray.h>
+#include <vtkFloatArray.h>
+#include <vtkImageData.h>
+#include <vtkMatrix4x4.h>
+#include <vtkNew.h>
+#include <vtkPointData.h>
+#include <vtkPolyData.h>
+#include <vtkSmartPointer.h>
+#include <vtkTransform.h>
+
+// STD includes
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+
+namespace
+{
+const int Size = 24;
+
+//----------------------------------------------------------------------------
+// Tensors with a strong major eigenvector in the xy plane that turns with y,
+// so that the tracts bend.
+vtkSmartPointer<vtkImageData> createTensorField()
+{
+  vtkSmartPointer<vtkImageData> tensorField = vtkSmartPointer<vtkImageData>::New();
+  tensorField->SetDimensions(Size, Size, Size);
+  vtkNew<vtkFloatArray> tensors;
+  tensors->SetNumberOfComponents(9);
+  tensors->SetNumberOfTuples(Size * Size * Size);
+  float* tensor = tensors->GetPointer(0);
+  for (int k = 0; k < Size; ++k)
+    {
+    for (int j = 0; j < Size; ++j)
+      {
+      for (int i = 0; i < Size; ++i)
+        {
+        double angle = 0.04 * j + 0.01 * k;
+        double e[3] = {cos(angle), sin(angle), 0.};
+        for (int row = 0; row < 3; ++row)
+          {
+          for (int col = 0; col < 3; ++col)
+            {
+            // 0.1 * I + 0.9 * e e'
+            tensor[3 * row + col] = static_cast<float>(
+              (row == col ? 0.1 : 0.) + 0.9 * e[row] * e[col]);
+            }
+          }
+        tensor += 9;
+        }
+      }
+    }
+  tensorField->GetPointData()->SetTensors(tensors.GetPointer());
+  return tensorField;
+}
+
+//----------------------------------------------------------------------------
+vtkSmartPointer<vtkImageData> createROI()
+{
+  vtkSmartPointer<vtkImageData> roi = vtkSmartPointer<vtkImageData>::New();
+  roi->SetDimensions(Size, Size, Size);
+  roi->SetWholeExtent(roi->GetExtent());
+  roi->SetScalarTypeToShort();
+  roi->AllocateScalars();
+  short* label = static_cast<short*>(roi->GetScalarPointer());
+  for (int k = 0; k < Size; ++k)
+    {
+    for (int j = 0; j < Size; ++j)
+      {
+      for (int i = 0; i < Size; ++i)
+        {
+        *label++ = (i >= 10 && i <= 12 && j >= 4 && j <= 18 && k >= 3 && k <= 20) ? 1 : 0;
+        }
+      }
+    }
+  return roi;
+}
+
+//----------------------------------------------------------------------------
+void setUp(vtkSeedTracts* seed, vtkImageData* tensorField,
+           vtkHyperStreamlineDTMRI* settings)
+{
+  seed->SetInputTensorField(tensorField);
+  vtkNew<vtkTransform> worldToTensorScaledIJK;
+  worldToTensorScaledIJK->Translate(0.5, 0.25, 0.);
+  seed->SetWorldToTensorScaledIJK(worldToTensorScaledIJK.GetPointer());
+  vtkNew<vtkTransform> rotation;
+  rotation->RotateZ(90.);
+  seed->SetTensorRotationMatrix(rotation->GetMatrix());
+  seed->SetMinimumPathLength(10.);
+  seed->UseVtkHyperStreamlinePoints();
+  seed->SetVtkHyperStreamlinePointsSettings(settings);
+}
+
+//----------------------------------------------------------------------------
+bool comparePolyData(vtkPolyData* polyData, vtkPolyData* expected,
+                     double tolerance)
+{
+  if (polyData->GetNumberOfPoints() != expected->GetNumberOfPoints() ||
+      polyData->GetNumberOfLines() != expected->GetNumberOfLines())
+    {
+    std::cerr << "Got " << polyData->GetNumberOfLines() << " lines and "
+              << polyData->GetNumberOfPoints() << " points instead of "
+              << expected->GetNumberOfLines() << " lines and "
+              << expected->GetNumberOfPoints() << " points" << std::endl;
+    return false;
+    }
+  vtkIdTypeArray* lines = polyData->GetLines()->GetData();
+  vtkIdTypeArray* expectedLines = expected->GetLines()->GetData();
+  for (vtkIdType i = 0; i < expectedLines->GetNumberOfTuples(); ++i)
+    {
+    if (lines->GetValue(i) != expectedLines->GetValue(i))
+      {
+      std::cerr << "Different lines" << std::endl;
+      return false;
+      }
+    }
+  vtkDataArray* tensors = polyData->GetPointData()->GetTensors();
+  vtkDataArray* expectedTensors = expected->GetPointData()->GetTensors();
+  for (vtkIdType i = 0; i < expected->GetNumberOfPoints(); ++i)
+    {
+    double point[3];
+    double expectedPoint[3];
+    polyData->GetPoint(i, point);
+    expected->GetPoint(i, expectedPoint);
+    double tensor[9];
+    double expectedTensor[9];
+    tensors->GetTuple(i, tensor);
+    expectedTensors->GetTuple(i, expectedTensor);
+    for (int c = 0; c < 9; ++c)
+      {
+      if ((c < 3 && fabs(point[c] - expectedPoint[c]) > tolerance) ||
+          fabs(tensor[c] - expectedTensor[c]) > tolerance)
+        {
+        std::cerr << "Different point or tensor " << i << std::endl;
+        return false;
+        }
+      }
+    }
+  return true;
+}
+
+} // end of anonymous namespace
+
+//----------------------------------------------------------------------------
+int vtkSeedTractsTest1(int vtkNotUsed(argc), char * vtkNotUsed(argv)[])
+{
+  vtkSmartPointer<vtkImageData> tensorField = createTensorField();
+  vtkSmartPointer<vtkImageData> roi = createROI();
+  vtkNew<vtkHyperStreamlineDTMRI> settings;
+  settings->SetIntegrationStepLength(0.5);
+  settings->SetRadiusOfCurvature(0.8);
+  settings->SetStoppingThreshold(0.1);
+
+  // Tracts seeded in the ROI with 1 and 4 threads are identical
+  vtkNew<vtkPolyData> fibers[2];
+  for (int run = 0; run < 2; ++run)
+    {
+    vtkNew<vtkSeedTracts> seed;
+    setUp(seed.GetPointer(), tensorField, settings.GetPointer());
+    seed->SetInputROI(roi);
+    seed->SetInputROIValue(1);
+    seed->SetNumberOfThreads(run == 0 ? 1 : 4);
+    seed->SeedStreamlinesInROI();
+    seed->TransformStreamlinesToRASAndAppendToPolyData(fibers[run].GetPointer());
+    }
+  if (fibers[0]->GetNumberOfLines() == 0 ||
+      !comparePolyData(fibers[1].GetPointer(), fibers[0].GetPointer(), 0.))
+    {
+    std::cerr << "Tracts depend on the number of threads" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // and the same as the tracts of one vtkHyperStreamlineDTMRI per seed
+  vtkNew<vtkSeedTracts> seed;
+  setUp(seed.GetPointer(), tensorField, settings.GetPointer());
+  for (int k = 0; k < Size; ++k)
+    {
+    for (int j = 0; j < Size; ++j)
+      {
+      for (int i = 0; i < Size; ++i)
+        {
+        if (*static_cast<short*>(roi->GetScalarPointer(i, j, k)) == 1)
+          {
+          seed->SeedStreamlineFromPoint(i, j, k);
+          }
+        }
+      }
+    }
+  vtkNew<vtkPolyData> expectedFibers;
+  seed->TransformStreamlinesToRASAndAppendToPolyData(expectedFibers.GetPointer());
+  if (!comparePolyData(fibers[0].GetPointer(), expectedFibers.GetPointer(), 1e-5))
+    {
+    std::cerr << "Tracts differ from the tracts of vtkHyperStreamlineDTMRI" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,209 @@
+/*=auto=========================================================================
+
+  Portions (c) Copyright 2005 Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Program:   3D Slicer
+
+=========================================================================auto=*/
+
+// vtkTeem includes
+#include "vtkFiberBundleLevelOfDetail.h"
+
+// VTK includes
+#include <vtkCellArray.h>
+#include <vtkCellData.h>
+#include <vtkInformation.h>
+#include <vtkInformationVector.h>
+#include <vtkMath.h>
+#include <vtkObjectFactory.h>
+#include <vtkPointData.h>
+#include <vtkPoints.h>
+#include <vtkPolyData.h>
+#include <vtkSmartPointer.h>
+
+// STD includes
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+//----------------------------------------------------------------------------
+class vtkFiberBundleLevelOfDetail::vtkInternal
+{
+public:
+  vtkInternal()
+    {
+    this->Input = 0;
+    this->InputMTime = 0;
+    this->AngleTolerance = 0.;
+    }
+
+  /// Levels computed from Input, Levels[n] is null if level n was not
+  /// requested yet.
+  std::vector<vtkSmartPointer<vtkPolyData> > Levels;
+  vtkPolyData* Input;
+  unsigned long InputMTime;
+  double AngleTolerance;
+};
+
+//----------------------------------------------------------------------------
+vtkCxxRevisionMacro(vtkFiberBundleLevelOfDetail, "$Revision$");
+vtkStandardNewMacro(vtkFiberBundleLevelOfDetail);
+
+//----------------------------------------------------------------------------
+vtkFiberBundleLevelOfDetail::vtkFiberBundleLevelOfDetail()
+{
+  this->Level = 0;
+  this->AngleTolerance = 10.;
+  this->Internal = new vtkInternal;
+}
+
+//----------------------------------------------------------------------------
+vtkFiberBundleLevelOfDetail::~vtkFiberBundleLevelOfDetail()
+{
+  delete this->Internal;
+}
+
+//----------------------------------------------------------------------------
+void vtkFiberBundleLevelOfDetail::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os,indent);
+  os << indent << "Level: " << this->Level << "\n";
+  os << indent << "AngleTolerance: " << this->AngleTolerance << "\n";
+}
+
+//----------------------------------------------------------------------------
+int vtkFiberBundleLevelOfDetail::RequestData(
+  vtkInformation *vtkNotUsed(request),
+  vtkInformationVector **inputVector,
+  vtkInformationVector *outputVector)
+{
+  vtkInformation *inInfo = inputVector[0]->GetInformationObject(0);
+  vtkInformation *outInfo = outputVector->GetInformationObject(0);
+  vtkPolyData *input = vtkPolyData::SafeDownCast(
+    inInfo->Get(vtkDataObject::DATA_OBJECT()));
+  vtkPolyData *output = vtkPolyData::SafeDownCast(
+    outInfo->Get(vtkDataObject::DATA_OBJECT()));
+
+  if (this->Level == 0)
+    {
+    output->ShallowCopy(input);
+    return 1;
+    }
+
+  vtkInternal* internal = this->Internal;
+  if (internal->Input != input ||
+      internal->InputMTime != input->GetMTime() ||
+      internal->AngleTolerance != this->AngleTolerance)
+    {
+    internal->Levels.clear();
+    internal->Input = input;
+    internal->InputMTime = input->GetMTime();
+    internal->AngleTolerance = this->AngleTolerance;
+    }
+  if (static_cast<int>(internal->Levels.size()) <= this->Level)
+    {
+    internal->Levels.resize(this->Level + 1);
+    }
+  if (!internal->Levels[this->Level])
+    {
+    vtkDebugMacro(<< "Computing level " << this->Level);
+    internal->Levels[this->Level] = vtkSmartPointer<vtkPolyData>::New();
+    this->SimplifyFibers(input, this->Level, internal->Levels[this->Level]);
+    }
+  output->ShallowCopy(internal->Levels[this->Level]);
+  return 1;
+}
+
+//----------------------------------------------------------------------------
+void vtkFiberBundleLevelOfDetail::SimplifyFibers(vtkPolyData *input, int level,
+                                                 vtkPolyData *output)
+{
+  vtkPoints* inPoints = input->GetPoints();
+  vtkCellArray* inLines = input->GetLines();
+  if (!inPoints || !inLines)
+    {
+    return;
+    }
+  vtkPointData* inPD = input->GetPointData();
+  vtkCellData* inCD = input->GetCellData();
+
+  const vtkIdType fiberStep = static_cast<vtkIdType>(1) << level;
+  const double cosTolerance = cos(vtkMath::RadiansFromDegrees(
+    std::min(180., level * this->AngleTolerance)));
+  const vtkIdType estimatedSize = inPoints->GetNumberOfPoints() / fiberStep + 1;
+
+  vtkSmartPointer<vtkPoints> outPoints = vtkSmartPointer<vtkPoints>::New();
+  outPoints->SetDataType(inPoints->GetDataType());
+  outPoints->Allocate(estimatedSize);
+  vtkSmartPointer<vtkCellArray> outLines = vtkSmartPointer<vtkCellArray>::New();
+  outLines->Allocate(estimatedSize + inLines->GetNumberOfCells() / fiberStep + 1);
+  vtkPointData* outPD = output->GetPointData();
+  vtkCellData* outCD = output->GetCellData();
+  outPD->CopyAllocate(inPD, estimatedSize);
+  outCD->CopyAllocate(inCD, inLines->GetNumberOfCells() / fiberStep + 1);
+
+  // The lines follow the vertices in the cell ids of the input
+  vtkIdType cellId = input->GetNumberOfVerts();
+  std::vector<vtkIdType> keptPoints;
+  vtkIdType npts = 0;
+  vtkIdType* pts = 0;
+  inLines->InitTraversal();
+  for (vtkIdType fiberId = 0; inLines->GetNextCell(npts, pts); ++fiberId, ++cellId)
+    {
+    if (fiberId % fiberStep != 0 || npts < 1)
+      {
+      continue;
+      }
+    // Keep the point where the fiber turns by more than the tolerance since
+    // the last kept point.
+    keptPoints.clear();
+    keptPoints.push_back(pts[0]);
+    double lastKept[3];
+    double current[3];
+    double next[3];
+    inPoints->GetPoint(pts[0], lastKept);
+    if (npts > 1)
+      {
+      inPoints->GetPoint(pts[1], current);
+      }
+    for (vtkIdType i = 1; i < npts - 1; ++i)
+      {
+      inPoints->GetPoint(pts[i + 1], next);
+      double incoming[3];
+      double outgoing[3];
+      vtkMath::Subtract(current, lastKept, incoming);
+      vtkMath::Subtract(next, current, outgoing);
+      double norms = vtkMath::Norm(incoming) * vtkMath::Norm(outgoing);
+      if (norms > 0. && vtkMath::Dot(incoming, outgoing) < cosTolerance * norms)
+        {
+        keptPoints.push_back(pts[i]);
+        lastKept[0] = current[0];
+        lastKept[1] = current[1];
+        lastKept[2] = current[2];
+        }
+      current[0] = next[0];
+      current[1] = next[1];
+      current[2] = next[2];
+      }
+    if (npts > 1)
+      {
+      keptPoints.push_back(pts[npts - 1]);
+      }
+
+    vtkIdType outCellId = outLines->InsertNextCell(static_cast<int>(keptPoints.size()));
+    for (size_t i = 0; i < keptPoints.size(); ++i)
+      {
+      vtkIdType outPointId = outPoints->InsertNextPoint(inPoints->GetPoint(keptPoints[i]));
+      outPD->CopyData(inPD, keptPoints[i], outPointId);
+      outLines->InsertCellPoint(outPointId);
+      }
+    outCD->CopyData(inCD, cellId, outCellId);
+    }
+
+  output->SetPoints(outPoints);
+  output->SetLines(outLines);
+  output->Squeeze();
+}
@@ -0,0 +1,68 @@
+/*=auto=========================================================================
+
+  Portions (c) Copyright 2005 Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Program:   3D Slicer
+
+=========================================================================auto=*/
+
+#ifndef __vtkFiberBundleLevelOfDetail_h
+#define __vtkFiberBundleLevelOfDetail_h
+
+#include "vtkPolyDataAlgorithm.h"
+#include "vtkTeemConfigure.h"
+
+/// \brief Coarser versions of the fibers (lines) of a polydata.
+///
+/// Level 0 passes the input through. Level n keeps one fiber out of 2^n and
+/// removes the points of the kept fibers where they turn by less than
+/// n * AngleTolerance since the last kept point, the end points are always
+/// kept. The point and cell data of the kept points and fibers are copied.
+///
+/// The fibers are expected to be in random order (e.g. shuffled by the fiber
+/// bundle node) so that the kept fibers are a uniform subset of the bundle.
+/// Each level is computed the first time it is requested and cached until
+/// the input is modified, so switching levels during an interaction only
+/// costs a shallow copy.
+class VTK_Teem_EXPORT vtkFiberBundleLevelOfDetail : public vtkPolyDataAlgorithm
+{
+public:
+  static vtkFiberBundleLevelOfDetail *New();
+  vtkTypeRevisionMacro(vtkFiberBundleLevelOfDetail,vtkPolyDataAlgorithm);
+  void PrintSelf(ostream& os, vtkIndent indent);
+
+  ///
+  /// Level of detail of the output, 0 (full detail) by default.
+  vtkSetClampMacro(Level, int, 0, 16);
+  vtkGetMacro(Level, int);
+
+  ///
+  /// Turning angle in degrees under which the points are removed at level 1,
+  /// 10 by default.
+  vtkSetClampMacro(AngleTolerance, double, 0., 180.);
+  vtkGetMacro(AngleTolerance, double);
+
+protected:
+  vtkFiberBundleLevelOfDetail();
+  ~vtkFiberBundleLevelOfDetail();
+
+  virtual int RequestData(vtkInformation *, vtkInformationVector **, vtkInformationVector *);
+
+  /// Compute the level of input in output.
+  void SimplifyFibers(vtkPolyData *input, int level, vtkPolyData *output);
+
+  int Level;
+  double AngleTolerance;
+
+  class vtkInternal;
+  vtkInternal* Internal;
+
+private:
+  vtkFiberBundleLevelOfDetail(const vtkFiberBundleLevelOfDetail&);  /// Not implemented.
+  void operator=(const vtkFiberBundleLevelOfDetail&);  /// Not implemented.
+};
+
+#endif
@@ -0,0 +1,414 @@
+/*=auto=========================================================================
+
+  Portions (c) Copyright 2005 Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Program:   3D Slicer
+
+=========================================================================auto=*/
+
+// vtkTeem includes
+#include "vtkFiberBundleLocator.h"
+
+// VTK includes
+#include <vtkCellArray.h>
+#include <vtkIdList.h>
+#include <vtkImplicitFunction.h>
+#include <vtkObjectFactory.h>
+#include <vtkPoints.h>
+#include <vtkPolyData.h>
+
+// STD includes
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+//----------------------------------------------------------------------------
+class vtkFiberBundleLocator::vtkInternal
+{
+public:
+  vtkInternal();
+
+  void Clear();
+  int GetBin(int axis, double x);
+  /// Bin range (imin, imax, jmin, ...) intersecting bounds, false if empty.
+  bool GetBinRange(const double bounds[6], int range[6]);
+  /// Add to fiberIds the fibers of the bins of bounds not marked yet.
+  void MarkCandidateFibers(const double bounds[6], std::vector<vtkIdType>& fiberIds);
+  bool IsFiberInFunction(vtkPolyData* polyData, vtkIdType fiberId,
+                         vtkImplicitFunction* function);
+
+  double Origin[3];
+  double BinSize[3];
+  int Dimensions[3];
+  /// Fibers of bin b are BinFibers[BinOffsets[b]] to BinFibers[BinOffsets[b+1]-1]
+  std::vector<vtkIdType> BinOffsets;
+  std::vector<vtkIdType> BinFibers;
+  /// Location of each fiber in the connectivity array of the lines
+  std::vector<vtkIdType> FiberLocations;
+  /// Fibers already added to the current query
+  std::vector<unsigned int> FiberMarks;
+  unsigned int Mark;
+
+  std::vector<unsigned char> Selected;
+  bool HasSelectionBounds;
+  double SelectionBounds[6];
+};
+
+//----------------------------------------------------------------------------
+vtkFiberBundleLocator::vtkInternal::vtkInternal()
+{
+  this->Clear();
+}
+
+//----------------------------------------------------------------------------
+void vtkFiberBundleLocator::vtkInternal::Clear()
+{
+  for (int i = 0; i < 3; ++i)
+    {
+    this->Origin[i] = 0.;
+    this->BinSize[i] = 1.;
+    this->Dimensions[i] = 0;
+    }
+  this->BinOffsets.clear();
+  this->BinFibers.clear();
+  this->FiberLocations.clear();
+  this->FiberMarks.clear();
+  this->Mark = 0;
+  this->Selected.clear();
+  this->HasSelectionBounds = false;
+}
+
+//----------------------------------------------------------------------------
+int vtkFiberBundleLocator::vtkInternal::GetBin(int axis, double x)
+{
+  double bin = floor((x - this->Origin[axis]) / this->BinSize[axis]);
+  if (bin < 0.)
+    {
+    return 0;
+    }
+  if (bin >= this->Dimensions[axis])
+    {
+    return this->Dimensions[axis] - 1;
+    }
+  return static_cast<int>(bin);
+}
+
+//----------------------------------------------------------------------------
+bool vtkFiberBundleLocator::vtkInternal::GetBinRange(const double bounds[6], int range[6])
+{
+  if (this->BinOffsets.empty())
+    {
+    return false;
+    }
+  for (int axis = 0; axis < 3; ++axis)
+    {
+    double gridMax = this->Origin[axis] + this->Dimensions[axis] * this->BinSize[axis];
+    if (bounds[2*axis] > gridMax || bounds[2*axis+1] < this->Origin[axis] ||
+        bounds[2*axis] > bounds[2*axis+1])
+      {
+      return false;
+      }
+    range[2*axis] = this->GetBin(axis, bounds[2*axis]);
+    range[2*axis+1] = this->GetBin(axis, bounds[2*axis+1]);
+    }
+  return true;
+}
+
+//----------------------------------------------------------------------------
+void vtkFiberBundleLocator::vtkInternal::MarkCandidateFibers(
+  const double bounds[6], std::vector<vtkIdType>& fiberIds)
+{
+  int range[6];
+  if (!this->GetBinRange(bounds, range))
+    {
+    return;
+    }
+  for (int k = range[4]; k <= range[5]; ++k)
+    {
+    for (int j = range[2]; j <= range[3]; ++j)
+      {
+      for (int i = range[0]; i <= range[1]; ++i)
+        {
+        vtkIdType bin = (static_cast<vtkIdType>(k) * this->Dimensions[1] + j) *
+          this->Dimensions[0] + i;
+        for (vtkIdType b = this->BinOffsets[bin]; b < this->BinOffsets[bin + 1]; ++b)
+          {
+          vtkIdType fiberId = this->BinFibers[b];
+          if (this->FiberMarks[fiberId] != this->Mark)
+            {
+            this->FiberMarks[fiberId] = this->Mark;
+            fiberIds.push_back(fiberId);
+            }
+          }
+        }
+      }
+    }
+}
+
+//----------------------------------------------------------------------------
+bool vtkFiberBundleLocator::vtkInternal::IsFiberInFunction(
+  vtkPolyData* polyData, vtkIdType fiberId, vtkImplicitFunction* function)
+{
+  vtkIdType* connectivity = polyData->GetLines()->GetPointer();
+  vtkIdType* fiber = connectivity + this->FiberLocations[fiberId];
+  vtkPoints* points = polyData->GetPoints();
+  double x[3];
+  for (vtkIdType i = 1; i <= fiber[0]; ++i)
+    {
+    points->GetPoint(fiber[i], x);
+    if (function->FunctionValue(x) < 0.)
+      {
+      return true;
+      }
+    }
+  return false;
+}
+
+//----------------------------------------------------------------------------
+vtkCxxRevisionMacro(vtkFiberBundleLocator, "$Revision$");
+vtkStandardNewMacro(vtkFiberBundleLocator);
+
+//----------------------------------------------------------------------------
+vtkFiberBundleLocator::vtkFiberBundleLocator()
+{
+  this->PolyData = NULL;
+  this->NumberOfPointsPerBin = 32;
+  this->Internal = new vtkInternal;
+}
+
+//----------------------------------------------------------------------------
+vtkFiberBundleLocator::~vtkFiberBundleLocator()
+{
+  this->SetPolyData(NULL);
+  delete this->Internal;
+}
+
+//----------------------------------------------------------------------------
+void vtkFiberBundleLocator::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os,indent);
+  os << indent << "PolyData: " << this->PolyData << "\n";
+  os << indent << "NumberOfPointsPerBin: " << this->NumberOfPointsPerBin << "\n";
+  os << indent << "Dimensions: " << this->Internal->Dimensions[0] << " "
+     << this->Internal->Dimensions[1] << " " << this->Internal->Dimensions[2] << "\n";
+}
+
+//----------------------------------------------------------------------------
+void vtkFiberBundleLocator::SetPolyData(vtkPolyData *polyData)
+{
+  if (this->PolyData == polyData)
+    {
+    return;
+    }
+  if (this->PolyData)
+    {
+    this->PolyData->UnRegister(this);
+    }
+  this->PolyData = polyData;
+  if (this->PolyData)
+    {
+    this->PolyData->Register(this);
+    }
+  this->Internal->Clear();
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+void vtkFiberBundleLocator::BuildLocator()
+{
+  if (!this->PolyData)
+    {
+    this->Internal->Clear();
+    return;
+    }
+  if (this->BuildTime > this->GetMTime() &&
+      this->BuildTime > this->PolyData->GetMTime())
+    {
+    return;
+    }
+  vtkInternal* internal = this->Internal;
+  internal->Clear();
+  this->BuildTime.Modified();
+
+  vtkCellArray* lines = this->PolyData->GetLines();
+  vtkPoints* points = this->PolyData->GetPoints();
+  if (!lines || !points || lines->GetNumberOfCells() == 0)
+    {
+    return;
+    }
+
+  // Bins of about the same size along each axis, NumberOfPointsPerBin
+  // points per bin on average.
+  double bounds[6];
+  points->GetBounds(bounds);
+  double targetNumberOfBins = std::max(1., static_cast<double>(
+    points->GetNumberOfPoints()) / this->NumberOfPointsPerBin);
+  double lengths[3];
+  double product = 1.;
+  int numberOfAxes = 0;
+  for (int axis = 0; axis < 3; ++axis)
+    {
+    lengths[axis] = bounds[2*axis+1] - bounds[2*axis];
+    if (lengths[axis] > 0.)
+      {
+      product *= lengths[axis];
+      ++numberOfAxes;
+      }
+    }
+  double binSize = numberOfAxes ?
+    pow(product / targetNumberOfBins, 1. / numberOfAxes) : 1.;
+  for (int axis = 0; axis < 3; ++axis)
+    {
+    internal->Origin[axis] = bounds[2*axis];
+    if (lengths[axis] > 0.)
+      {
+      internal->Dimensions[axis] = static_cast<int>(std::min(1024., std::max(1.,
+        ceil(lengths[axis] / binSize))));
+      internal->BinSize[axis] = lengths[axis] / internal->Dimensions[axis];
+      }
+    else
+      {
+      internal->Dimensions[axis] = 1;
+      internal->BinSize[axis] = 1.;
+      }
+    }
+  vtkIdType numberOfBins = static_cast<vtkIdType>(internal->Dimensions[0]) *
+    internal->Dimensions[1] * internal->Dimensions[2];
+
+  // Bin of each point
+  std::vector<vtkIdType> pointBins(points->GetNumberOfPoints());
+  double x[3];
+  for (vtkIdType pointId = 0; pointId < points->GetNumberOfPoints(); ++pointId)
+    {
+    points->GetPoint(pointId, x);
+    pointBins[pointId] =
+      (static_cast<vtkIdType>(internal->GetBin(2, x[2])) * internal->Dimensions[1] +
+       internal->GetBin(1, x[1])) * internal->Dimensions[0] + internal->GetBin(0, x[0]);
+    }
+
+  // Count, then list the fibers of each bin, each fiber once per bin
+  vtkIdType numberOfFibers = lines->GetNumberOfCells();
+  internal->FiberLocations.resize(numberOfFibers);
+  internal->BinOffsets.assign(numberOfBins + 1, 0);
+  std::vector<vtkIdType> lastFiberOfBin(numberOfBins, -1);
+  vtkIdType* connectivity = lines->GetPointer();
+  for (int pass = 0; pass < 2; ++pass)
+    {
+    if (pass == 1)
+      {
+      for (vtkIdType bin = 0; bin < numberOfBins; ++bin)
+        {
+        internal->BinOffsets[bin + 1] += internal->BinOffsets[bin];
+        }
+      internal->BinFibers.resize(internal->BinOffsets[numberOfBins]);
+      lastFiberOfBin.assign(numberOfBins, -1);
+      }
+    std::vector<vtkIdType> binEnds(internal->BinOffsets.begin(),
+                                   internal->BinOffsets.end() - 1);
+    vtkIdType location = 0;
+    for (vtkIdType fiberId = 0; fiberId < numberOfFibers; ++fiberId)
+      {
+      internal->FiberLocations[fiberId] = location;
+      vtkIdType numberOfFiberPoints = connectivity[location];
+      for (vtkIdType i = 1; i <= numberOfFiberPoints; ++i)
+        {
+        vtkIdType bin = pointBins[connectivity[location + i]];
+        if (lastFiberOfBin[bin] == fiberId)
+          {
+          continue;
+          }
+        lastFiberOfBin[bin] = fiberId;
+        if (pass == 0)
+          {
+          ++internal->BinOffsets[bin + 1];
+          }
+        else
+          {
+          internal->BinFibers[binEnds[bin]++] = fiberId;
+          }
+        }
+      location += numberOfFiberPoints + 1;
+      }
+    }
+  internal->FiberMarks.assign(numberOfFibers, 0);
+  internal->Selected.assign(numberOfFibers, 0);
+}
+
+//----------------------------------------------------------------------------
+vtkIdType vtkFiberBundleLocator::GetNumberOfFibers()
+{
+  this->BuildLocator();
+  return static_cast<vtkIdType>(this->Internal->FiberLocations.size());
+}
+
+//----------------------------------------------------------------------------
+void vtkFiberBundleLocator::FindCandidateFibers(const double bounds[6],
+                                                vtkIdList *fiberIds)
+{
+  this->BuildLocator();
+  std::vector<vtkIdType> candidates;
+  ++this->Internal->Mark;
+  this->Internal->MarkCandidateFibers(bounds, candidates);
+  std::sort(candidates.begin(), candidates.end());
+  fiberIds->SetNumberOfIds(static_cast<vtkIdType>(candidates.size()));
+  for (size_t i = 0; i < candidates.size(); ++i)
+    {
+    fiberIds->SetId(static_cast<vtkIdType>(i), candidates[i]);
+    }
+}
+
+//----------------------------------------------------------------------------
+void vtkFiberBundleLocator::UpdateSelection(vtkImplicitFunction *function,
+                                            const double bounds[6])
+{
+  this->BuildLocator();
+  vtkInternal* internal = this->Internal;
+  if (!function || internal->FiberLocations.empty())
+    {
+    return;
+    }
+
+  // The fibers selected by the previous call are around its bounds
+  std::vector<vtkIdType> candidates;
+  ++internal->Mark;
+  if (internal->HasSelectionBounds)
+    {
+    internal->MarkCandidateFibers(internal->SelectionBounds, candidates);
+    for (size_t i = 0; i < candidates.size(); ++i)
+      {
+      internal->Selected[candidates[i]] = 0;
+      }
+    candidates.clear();
+    ++internal->Mark;
+    }
+  internal->MarkCandidateFibers(bounds, candidates);
+  for (size_t i = 0; i < candidates.size(); ++i)
+    {
+    internal->Selected[candidates[i]] =
+      internal->IsFiberInFunction(this->PolyData, candidates[i], function) ? 1 : 0;
+    }
+
+  internal->HasSelectionBounds = true;
+  std::copy(bounds, bounds + 6, internal->SelectionBounds);
+}
+
+//----------------------------------------------------------------------------
+bool vtkFiberBundleLocator::IsFiberSelected(vtkIdType fiberId)
+{
+  if (fiberId < 0 ||
+      fiberId >= static_cast<vtkIdType>(this->Internal->Selected.size()))
+    {
+    return false;
+    }
+  return this->Internal->Selected[fiberId] != 0;
+}
+
+//----------------------------------------------------------------------------
+void vtkFiberBundleLocator::ResetSelection()
+{
+  std::fill(this->Internal->Selected.begin(), this->Internal->Selected.end(), 0);
+  this->Internal->HasSelectionBounds = false;
+}
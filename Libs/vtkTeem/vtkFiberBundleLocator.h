@@ -0,0 +1,99 @@
+/*=auto=========================================================================
+
+  Portions (c) Copyright 2005 Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Program:   3D Slicer
+
+=========================================================================auto=*/
+
+#ifndef __vtkFiberBundleLocator_h
+#define __vtkFiberBundleLocator_h
+
+#include "vtkTeemConfigure.h"
+
+#include "vtkObject.h"
+
+class vtkIdList;
+class vtkImplicitFunction;
+class vtkPolyData;
+
+/// \brief Uniform grid over the points of the fibers (lines) of a polydata.
+///
+/// Each bin of the grid lists the fibers that have a point in the bin, so
+/// that selecting the fibers in a region only tests the points of the
+/// fibers that have a point in the bins of the bounds of the region instead
+/// of all the points of the bundle. Fibers are identified by their index in
+/// the lines of the polydata.
+///
+/// The grid is built on demand and rebuilt when the polydata is modified.
+/// UpdateSelection keeps the fibers selected by a region between calls and
+/// only tests again the fibers around the previous and the new bounds, which
+/// makes dragging a ROI through a large bundle interactive.
+class VTK_Teem_EXPORT vtkFiberBundleLocator : public vtkObject
+{
+public:
+  static vtkFiberBundleLocator *New();
+  vtkTypeRevisionMacro(vtkFiberBundleLocator,vtkObject);
+  void PrintSelf(ostream& os, vtkIndent indent);
+
+  ///
+  /// Polydata whose lines are the fibers to locate.
+  virtual void SetPolyData(vtkPolyData *polyData);
+  vtkGetObjectMacro(PolyData, vtkPolyData);
+
+  ///
+  /// Average number of fiber points per bin, 32 by default.
+  vtkSetClampMacro(NumberOfPointsPerBin, int, 1, VTK_INT_MAX);
+  vtkGetMacro(NumberOfPointsPerBin, int);
+
+  ///
+  /// Build the grid if the polydata was modified since the last build.
+  /// The queries call it.
+  void BuildLocator();
+
+  ///
+  /// Number of fibers of the polydata at the last build.
+  vtkIdType GetNumberOfFibers();
+
+  ///
+  /// Fill fiberIds with the fibers, in increasing order, that have a point
+  /// in a bin intersecting bounds (xmin, xmax, ymin, ymax, zmin, zmax). It is
+  /// a superset of the fibers that have a point in bounds.
+  void FindCandidateFibers(const double bounds[6], vtkIdList *fiberIds);
+
+  ///
+  /// Select the fibers that have a point where function is negative. All the
+  /// points where function is negative must be in bounds. Only the fibers
+  /// around the bounds of the previous call and around the new bounds are
+  /// tested, the others keep being unselected.
+  void UpdateSelection(vtkImplicitFunction *function, const double bounds[6]);
+
+  ///
+  /// Whether the fiber was selected by the last UpdateSelection.
+  bool IsFiberSelected(vtkIdType fiberId);
+
+  ///
+  /// Unselect all the fibers, the next UpdateSelection tests only the fibers
+  /// around its bounds.
+  void ResetSelection();
+
+protected:
+  vtkFiberBundleLocator();
+  ~vtkFiberBundleLocator();
+
+  vtkPolyData *PolyData;
+  int NumberOfPointsPerBin;
+  vtkTimeStamp BuildTime;
+
+  class vtkInternal;
+  vtkInternal* Internal;
+
+private:
+  vtkFiberBundleLocator(const vtkFiberBundleLocator&);  /// Not implemented.
+  void operator=(const vtkFiberBundleLocator&);  /// Not implemented.
+};
+
+#endif
@@ -15,6 +15,8 @@
 
 #include "vtkCellArray.h"
 #include "vtkFloatArray.h"
+#include "vtkGenericCell.h"
+#include "vtkIdList.h"
 #include "vtkMath.h"
 #include "vtkObjectFactory.h"
 #include "vtkPointData.h"
@@ -140,24 +142,119 @@ vtkPolyData *output = vtkPolyData::SafeDownCast(
   outInfo->Get(vtkDataObject::DATA_OBJECT()));
 
 
+  vtkTractographyPoint *sPtr;
+  vtkCell *cell;
+  vtkFloatingPointType *w;
+  vtkFloatingPointType tol2;
+
+  vtkDebugMacro(<<"Generating hyperstreamline(s)");
+  this->NumberOfStreamers = 0;
+
+  if ( ! input->GetPointData()->GetTensors() )
+    {
+    vtkErrorMacro(<<"No tensor data defined!");
+    return 0;
+    }
+
+  tol2 = input->GetLength() / 1000.0;
+  tol2 = tol2 * tol2;
+  //
+  // Create starting points
+  //
+  this->NumberOfStreamers = 1;
+
+  if ( this->IntegrationDirection == VTK_INTEGRATE_BOTH_DIRECTIONS )
+    {
+    this->NumberOfStreamers *= 2;
+    }
+
+  this->Streamers = new vtkTractographyArray[this->NumberOfStreamers];
+
+  if ( this->StartFrom == VTK_START_FROM_POSITION )
+    {
+    this->IntegrateFromPosition(input, this->StartPosition, tol2, this->Streamers);
+    }
+
+  else //VTK_START_FROM_LOCATION
+    {
+    w = new vtkFloatingPointType[input->GetMaxCellSize()];
+    sPtr = this->Streamers[0].InsertNextTractographyPoint();
+    cell =  input->GetCell(sPtr->CellId);
+    cell->EvaluateLocation(sPtr->SubId, sPtr->P, sPtr->X, w);
+    delete [] w;
+    this->IntegrateStreamers(input, tol2, this->Streamers);
+    }
+
+  this->BuildLines(input,output);
+
+  // note: these two lines fix memory leak in code copied from vtk
+  delete [] this->Streamers;
+  this->Streamers = NULL;
+  return 1;
+}
+
+//----------------------------------------------------------------------------
+void vtkHyperStreamlineDTMRI::IntegrateFromPosition(vtkDataSet *input,
+                                                    vtkFloatingPointType startPosition[3],
+                                                    vtkFloatingPointType tol2,
+                                                    vtkTractographyArray *streamers)
+{
+  vtkTractographyPoint *sPtr;
+  vtkFloatingPointType *w = new vtkFloatingPointType[input->GetMaxCellSize()];
+  vtkGenericCell *genericCell = vtkGenericCell::New();
+
+  sPtr = streamers[0].InsertNextTractographyPoint();
+  for (int i=0; i<3; i++)
+    {
+    sPtr->X[i] = startPosition[i];
+    }
+  sPtr->CellId = input->FindCell(startPosition, NULL, genericCell, (-1), 0.0,
+                                 sPtr->SubId, sPtr->P, w);
+
+  genericCell->Delete();
+  delete [] w;
+
+  this->IntegrateStreamers(input, tol2, streamers);
+}
+
+// Copy the tuples of the points of a cell into a caller buffer.
+// vtkDataArray::GetTuples() goes through the internal tuple of the
+// array, which is not safe when several threads read the same array.
+//----------------------------------------------------------------------------
+static void GetCellTuples(vtkDataArray *array, vtkIdList *ptIds,
+                          vtkFloatingPointType *tuples)
+{
+  int numComp = array->GetNumberOfComponents();
+  for (vtkIdType k=0; k < ptIds->GetNumberOfIds(); k++)
+    {
+    array->GetTuple(ptIds->GetId(k), tuples + k * numComp);
+    }
+}
+
+//----------------------------------------------------------------------------
+void vtkHyperStreamlineDTMRI::IntegrateStreamers(vtkDataSet *input,
+                                                 vtkFloatingPointType tol2,
+                                                 vtkTractographyArray *streamers)
+{
   vtkPointData *pd=input->GetPointData();
   vtkDataArray *inScalars;
   vtkDataArray *inTensors;
   vtkFloatingPointType *tensor;
   vtkTractographyPoint *sNext, *sPtr;
   int i, j, k, ptId, subId, iv, ix, iy;
-  vtkCell *cell;
+  vtkGenericCell *cell;
+  vtkGenericCell *findCell;
   vtkFloatingPointType ev[3];
   vtkFloatingPointType xNext[3];
-  vtkFloatingPointType d, step, dir, tol2, p[3];
+  vtkFloatingPointType d, step, dir, p[3];
   vtkFloatingPointType *w;
   vtkFloatingPointType dist2;
   vtkFloatingPointType closestPoint[3];
   vtkFloatingPointType *m[3], *v[3];
   vtkFloatingPointType m0[3], m1[3], m2[3];
   vtkFloatingPointType v0[3], v1[3], v2[3];
-  vtkDataArray *cellTensors = 0;
-  vtkDataArray *cellScalars = 0;
+  vtkFloatingPointType *cellTensors = 0;
+  vtkFloatingPointType *cellScalars = 0;
   int pointCount;
   vtkTractographyPoint *sPrev, *sPrevPrev;
   vtkFloatingPointType kv1[3], kv2[3], ku1[3], ku2[3], kl1, kl2, kn[3], K = 0.0;
@@ -167,87 +264,46 @@ vtkPolyData *output = vtkPolyData::SafeDownCast(
   float stop = 0.0;
   //static const float sqrt3halves = sqrt((float)3/2);
   int keepIntegrating;
+  int numberOfStreamers;
 
-  vtkDebugMacro(<<"Generating hyperstreamline(s)");
-  this->NumberOfStreamers = 0;
-
-  if ( ! (inTensors=pd->GetTensors()) )
-    {
-    vtkErrorMacro(<<"No tensor data defined!");
-    return 0;
-    }
-  w = new vtkFloatingPointType[input->GetMaxCellSize()];
-
+  inTensors = pd->GetTensors();
   inScalars = pd->GetScalars();
-  if (inTensors)
-    {
-    cellTensors = vtkDataArray::CreateDataArray(inTensors->GetDataType());
-    }
+
+  // per call working storage, so that several threads can integrate
+  // in the same input
+  int maxCellSize = input->GetMaxCellSize();
+  w = new vtkFloatingPointType[maxCellSize];
+  cellTensors = new vtkFloatingPointType[maxCellSize * inTensors->GetNumberOfComponents()];
   if (inScalars)
     {
-    cellScalars = vtkDataArray::CreateDataArray(inScalars->GetDataType());
-    }
-  int numComp;
-  if (inTensors && cellTensors)
-    {
-    numComp = inTensors->GetNumberOfComponents();
-    cellTensors->SetNumberOfComponents(numComp);
-    cellTensors->SetNumberOfTuples(VTK_CELL_SIZE);
+    cellScalars = new vtkFloatingPointType[maxCellSize * inScalars->GetNumberOfComponents()];
     }
-  if (inScalars && cellScalars)
-    {
-    numComp = inScalars->GetNumberOfComponents();
-    cellScalars->SetNumberOfComponents(numComp);
-    cellScalars->SetNumberOfTuples(VTK_CELL_SIZE);
-    }
-
+  int scalarComp = inScalars ? inScalars->GetNumberOfComponents() : 0;
+  cell = vtkGenericCell::New();
+  findCell = vtkGenericCell::New();
 
-  tol2 = input->GetLength() / 1000.0;
-  tol2 = tol2 * tol2;
   iv = this->IntegrationEigenvector;
   ix = (iv + 1) % 3;
   iy = (iv + 2) % 3;
-  //
-  // Create starting points
-  //
-  this->NumberOfStreamers = 1;
 
+  numberOfStreamers = 1;
   if ( this->IntegrationDirection == VTK_INTEGRATE_BOTH_DIRECTIONS )
     {
-    this->NumberOfStreamers *= 2;
-    }
-
-  this->Streamers = new vtkTractographyArray[this->NumberOfStreamers];
-
-  if ( this->StartFrom == VTK_START_FROM_POSITION )
-    {
-    sPtr = this->Streamers[0].InsertNextTractographyPoint();
-    for (i=0; i<3; i++)
-      {
-      sPtr->X[i] = this->StartPosition[i];
-      }
-    sPtr->CellId = input->FindCell(this->StartPosition, NULL, (-1), 0.0, 
-                                   sPtr->SubId, sPtr->P, w);
+    numberOfStreamers *= 2;
     }
 
-  else //VTK_START_FROM_LOCATION
-    {
-    sPtr = this->Streamers[0].InsertNextTractographyPoint();
-    cell =  input->GetCell(sPtr->CellId);
-    cell->EvaluateLocation(sPtr->SubId, sPtr->P, sPtr->X, w);
-    }
   //
   // Finish initializing each hyperstreamline
   //
-  this->Streamers[0].Direction = 1.0;
-  sPtr = this->Streamers[0].GetTractographyPoint(0);
+  streamers[0].Direction = 1.0;
+  sPtr = streamers[0].GetTractographyPoint(0);
   sPtr->D = 0.0;
   if ( sPtr->CellId >= 0 ) //starting point in dataset
     {
-    cell = input->GetCell(sPtr->CellId);
+    input->GetCell(sPtr->CellId, cell);
     cell->EvaluateLocation(sPtr->SubId, sPtr->P, xNext, w);
 
-    inTensors->GetTuples(cell->PointIds, cellTensors);
+    GetCellTuples(inTensors, cell->PointIds, cellTensors);
 
     // interpolate tensor, compute eigenfunctions
     for (j=0; j<3; j++)
@@ -259,7 +315,7 @@ vtkPolyData *output = vtkPolyData::SafeDownCast(
       }
     for (k=0; k < cell->GetNumberOfPoints(); k++)
       {
-      tensor = cellTensors->GetTuple(k);
+      tensor = cellTensors + 9 * k;
       for (j=0; j<3; j++) 
         {
         for (i=0; i<3; i++) 
@@ -285,10 +341,10 @@ vtkPolyData *output = vtkPolyData::SafeDownCast(
 
     if ( inScalars )
       {
-      inScalars->GetTuples(cell->PointIds, cellScalars);
+      GetCellTuples(inScalars, cell->PointIds, cellScalars);
       for (sPtr->S=0, i=0; i < cell->GetNumberOfPoints(); i++)
         {
-        sPtr->S += cellScalars->GetTuple(i)[0] * w[i];
+        sPtr->S += cellScalars[i * scalarComp] * w[i];
         // for curvature coloring for debugging purposes:
         //sPtr->S =0;
         }
@@ -296,34 +352,34 @@ vtkPolyData *output = vtkPolyData::SafeDownCast(
 
     if ( this->IntegrationDirection == VTK_INTEGRATE_BOTH_DIRECTIONS )
       {
-      this->Streamers[1].Direction = -1.0;
-      sNext = this->Streamers[1].InsertNextTractographyPoint();
+      streamers[1].Direction = -1.0;
+      sNext = streamers[1].InsertNextTractographyPoint();
       *sNext = *sPtr;
       }
     else if ( this->IntegrationDirection == VTK_INTEGRATE_BACKWARD )
       {
-      this->Streamers[0].Direction = -1.0;
+      streamers[0].Direction = -1.0;
       }
     } //for hyperstreamline in dataset
 
   //
   // For each hyperstreamline, integrate in appropriate direction (using RK2).
   //
-  for (ptId=0; ptId < this->NumberOfStreamers; ptId++)
+  for (ptId=0; ptId < numberOfStreamers; ptId++)
     {
     //get starting step
-    sPtr = this->Streamers[ptId].GetTractographyPoint(0);
+    sPtr = streamers[ptId].GetTractographyPoint(0);
     if ( sPtr->CellId < 0 )
       {
       continue;
       }
 
-    dir = this->Streamers[ptId].Direction;
-    cell = input->GetCell(sPtr->CellId);
+    dir = streamers[ptId].Direction;
+    input->GetCell(sPtr->CellId, cell);
     cell->EvaluateLocation(sPtr->SubId, sPtr->P, xNext, w);
     step = this->IntegrationStepLength;
-    inTensors->GetTuples(cell->PointIds, cellTensors);
-    if ( inScalars ) {inScalars->GetTuples(cell->PointIds, cellScalars);}
+    GetCellTuples(inTensors, cell->PointIds, cellTensors);
+    if ( inScalars ) {GetCellTuples(inScalars, cell->PointIds, cellScalars);}
 
 
     // This is the flag for integration to continue if FA, curvature
@@ -352,8 +408,8 @@ vtkPolyData *output = vtkPolyData::SafeDownCast(
             // kn=2*(u2-u1)/(norm(v1)+norm(v2));
             // absk=norm(kn);  % absolute value of the curvature
 
-            sPrev = this->Streamers[ptId].GetTractographyPoint(pointCount-1);
-            sPrevPrev = this->Streamers[ptId].GetTractographyPoint(pointCount-2);
+            sPrev = streamers[ptId].GetTractographyPoint(pointCount-1);
+            sPrevPrev = streamers[ptId].GetTractographyPoint(pointCount-2);
             kl2=0;
             kl1=0;
             for (i=0; i<3; i++)
@@ -417,7 +473,7 @@ vtkPolyData *output = vtkPolyData::SafeDownCast(
         }
       for (k=0; k < cell->GetNumberOfPoints(); k++)
         {
-        tensor = cellTensors->GetTuple(k);
+        tensor = cellTensors + 9 * k;
         for (j=0; j<3; j++)
           {
           for (i=0; i<3; i++)
@@ -437,7 +493,7 @@ vtkPolyData *output = vtkPolyData::SafeDownCast(
         xNext[i] = sPtr->X[i] + 
                    dir * (step/2.0) * (sPtr->V[i][iv] + v[i][iv]);
         }
-      sNext = this->Streamers[ptId].InsertNextTractographyPoint();
+      sNext = streamers[ptId].InsertNextTractographyPoint();
 
       if ( cell->EvaluatePosition(xNext, closestPoint, sNext->SubId, 
       sNext->P, dist2, w) )
@@ -451,7 +507,7 @@ vtkPolyData *output = vtkPolyData::SafeDownCast(
         }
       else
         { //integration has passed out of cell
-        sNext->CellId = input->FindCell(xNext, cell, sPtr->CellId, tol2, 
+        sNext->CellId = input->FindCell(xNext, cell, findCell, sPtr->CellId, tol2, 
                                         sNext->SubId, sNext->P, w);
         if ( sNext->CellId >= 0 ) //make sure not out of dataset
           {
@@ -459,9 +515,9 @@ vtkPolyData *output = vtkPolyData::SafeDownCast(
             {
             sNext->X[i] = xNext[i];
             }
-          cell = input->GetCell(sNext->CellId);
-          inTensors->GetTuples(cell->PointIds, cellTensors);
-          if (inScalars){inScalars->GetTuples(cell->PointIds, cellScalars);}
+          input->GetCell(sNext->CellId, cell);
+          GetCellTuples(inTensors, cell->PointIds, cellTensors);
+          if (inScalars){GetCellTuples(inScalars, cell->PointIds, cellScalars);}
           step = this->IntegrationStepLength;
           }
         }
@@ -478,7 +534,7 @@ vtkPolyData *output = vtkPolyData::SafeDownCast(
           }
         for (k=0; k < cell->GetNumberOfPoints(); k++)
           {
-          tensor = cellTensors->GetTuple(k);
+          tensor = cellTensors + 9 * k;
           for (j=0; j<3; j++) 
             {
             for (i=0; i<3; i++) 
@@ -493,7 +549,7 @@ vtkPolyData *output = vtkPolyData::SafeDownCast(
         FixVectors(sPtr->V, sNext->V, iv, ix, iy);
 
         // compute invariants at final position                                         
-        switch (this->GetStoppingMode()) {
+        switch (this->StoppingMode) {
         case vtkDiffusionTensorMathematics::VTK_TENS_FRACTIONAL_ANISOTROPY:
             stop = vtkDiffusionTensorMathematics::FractionalAnisotropy(sNext->W);
             break;
@@ -521,7 +577,7 @@ vtkPolyData *output = vtkPolyData::SafeDownCast(
           for (sNext->S=0.0, i=0; i < cell->GetNumberOfPoints(); i++)
             {
               // output interpolated scalar data
-              sNext->S += cellScalars->GetTuple(i)[0] * w[i];
+              sNext->S += cellScalars[i * scalarComp] * w[i];
               // for curvature coloring for debugging purposes:
               //sNext->S =K;
 
@@ -550,22 +606,11 @@ vtkPolyData *output = vtkPolyData::SafeDownCast(
 
     } //for each hyperstreamline
 
-  this->BuildLines(input,output);
-
   delete [] w;
-  if (inTensors)
-    {
-    cellTensors->Delete();
-    }
-  if (inScalars)
-    {
-    cellScalars->Delete();
-    }
-
-  // note: these two lines fix memory leak in code copied from vtk
-  delete [] this->Streamers;
-  this->Streamers = NULL;
-  return 1;
+  delete [] cellTensors;
+  delete [] cellScalars;
+  cell->Delete();
+  findCell->Delete();
 }
 
 void vtkHyperStreamlineDTMRI::BuildLines(vtkDataSet *input, vtkPolyData *output)
@@ -100,12 +100,28 @@ public:
   vtkSetMacro(OneTrajectoryPerSeedPoint, int);
   vtkBooleanMacro(OneTrajectoryPerSeedPoint, int);
 
+  /// 
+  /// Integrate from a start position (in the coordinates of the input)
+  /// into streamers, an array of one vtkTractographyArray, or two if
+  /// IntegrationDirection is both directions. tol2 is the squared tolerance
+  /// used to find the cells, RequestData uses (input->GetLength()/1000)^2.
+  /// Only the thread-safe methods of the input are used and the object is
+  /// not modified, so several threads can integrate from different start
+  /// positions with the same settings and input.
+  void IntegrateFromPosition(vtkDataSet *input,
+                             vtkFloatingPointType startPosition[3],
+                             vtkFloatingPointType tol2,
+                             vtkTractographyArray *streamers);
+
 protected:
   vtkHyperStreamlineDTMRI();
   ~vtkHyperStreamlineDTMRI();
 
   /// Integrate data
   virtual int RequestData(vtkInformation *,vtkInformationVector**, vtkInformationVector *);
+  /// Integrate the streamers from their first point, which must be set.
+  void IntegrateStreamers(vtkDataSet *input, vtkFloatingPointType tol2,
+                          vtkTractographyArray *streamers);
   void BuildLines(vtkDataSet *input, vtkPolyData *output);
   void BuildLinesForSingleTrajectory(vtkDataSet *input, vtkPolyData *output);
   void BuildLinesForTwoTrajectories(vtkDataSet *input, vtkPolyData *output);
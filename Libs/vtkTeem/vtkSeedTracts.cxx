@@ -18,15 +18,20 @@
 // VTK includes
 #include <vtkCellArray.h>
 #include <vtkCommand.h>
+#include <vtkFloatArray.h>
 #include <vtkMath.h>
+#include <vtkMultiThreader.h>
 #include <vtkNew.h>
 #include <vtkPointData.h>
 #include <vtkPolyDataWriter.h>
+#include <vtkSmartPointer.h>
 #include <vtkTimerLog.h>
 #include <vtkTransformPolyDataFilter.h>
 
 // STD includes
+#include <algorithm>
 #include <sstream>
+#include <vector>
 
 //----------------------------------------------------------------------------
 vtkStandardNewMacro(vtkSeedTracts);
@@ -64,6 +69,9 @@ vtkSeedTracts::vtkSeedTracts()
 
   // collections
   this->Streamlines = vtkCollection::New();
+  this->ROIStreamlines = vtkPolyData::New();
+
+  this->NumberOfThreads = vtkMultiThreader::GetGlobalDefaultNumberOfThreads();
 
 
   // Streamline parameters for all streamlines
@@ -106,6 +114,7 @@ vtkSeedTracts::~vtkSeedTracts()
     this->DeleteAllStreamlines();
     this->Streamlines->Delete();
     }
+  this->ROIStreamlines->Delete();
   if (FileDirectoryName) 
     {
     delete [] FileDirectoryName;
@@ -513,8 +522,8 @@ void vtkSeedTracts::SeedStreamlinesInROI()
   this->InputTensorField->GetWholeExtent(extent);
   this->InputTensorField->GetSpacing(spacing);
 
-  // currently this filter is not multithreaded, though in the future 
-  // it could be (especially if it inherits from an image filter class)
+  // the seeds are found in this thread, the streamlines are tracked
+  // in TrackStreamlinesInROI with NumberOfThreads threads
   this->InputROI->GetWholeExtent(inExt);
 
   // find the region to loop over
@@ -554,16 +563,10 @@ void vtkSeedTracts::SeedStreamlinesInROI()
   // filename index
   idx=0;
 
-  int gridIncXYZ = gridIncX*gridIncY*gridIncZ;
-  int numLabelVoxels = 0;
-  if (gridIncXYZ)
-    {
-    numLabelVoxels = maxX*maxY*maxZ/gridIncXYZ;
-    }
-  int labelVoxelCount = 0;
-  int progressCount = 0;
-  int progressCountMax = 100;
-  double progress;
+  // seed points in scaled ijk of the input tensors, in the order of the
+  // grid (including the random jitter) so that the tracts do not depend
+  // on how they are then spread across threads
+  std::vector<double> seeds;
 
   for (idxZ = 0; idxZ <= maxZ; idxZ+=gridIncZ)
     {
@@ -576,7 +579,6 @@ void vtkSeedTracts::SeedStreamlinesInROI()
           
           for (idxX = 0; idxX <= maxX; idxX+=gridIncX)
             {
-              labelVoxelCount++;
               // get the pointer to the nearest voxel at this location
               int pt[3];
               pt[0]= (int) floor(idxX + 0.5);
@@ -656,87 +658,348 @@ void vtkSeedTracts::SeedStreamlinesInROI()
                         }
                       } // end if (UseStartingThreshold)
 
-                      // Report progress
-                      if (numLabelVoxels && progressCount == progressCountMax)
-                        {
-                        progressCount = 0;
-                        progress = (labelVoxelCount+0.0)/numLabelVoxels;
-                        this->InvokeEvent(vtkCommand::ProgressEvent, (void *)&progress);
-                        }
-                      else
-                        {
-                        progressCount++;
-                        }
-                      // Now create a streamline 
-                      newStreamline=(vtkHyperStreamlineDTMRI *) 
-                        this->CreateHyperStreamline();
-                      
-                      // Set its input information.
-                      newStreamline->SetInput(this->InputTensorField);
-                      newStreamline->SetStartPosition(point[0],point[1],point[2]);
-                      //newStreamline->DebugOn();
+                      // The streamlines are tracked once all the seeds
+                      // are known, so that they can be spread across threads
+                      seeds.push_back(point[0]);
+                      seeds.push_back(point[1]);
+                      seeds.push_back(point[2]);
+                    }
+                }
 
-                      // Ask it to output tensors and to only do one trajectory per start point
-                      newStreamline->OutputTensorsOn();
-                      newStreamline->OneTrajectoryPerSeedPointOn();
+            }
 
-                      // Force it to execute
-                      newStreamline->Update();
+        }
 
-                      // See if we like it enough to add to the collection
-                      // This relies on the fact that the step length is in units of
-                      // length (unlike fractions of a cell in vtkHyperStreamline).
-                      double length = 
-                        (newStreamline->GetOutput()->GetNumberOfPoints() - 1) * 
-                        newStreamline->GetIntegrationStepLength();
- 
-                      if (length > this->MinimumPathLength)
-                        {
-                        if (this->FileDirectoryName) 
-                          // write streamline to disk
-                          {
-                          if (this->FilePrefix == NULL)
-                            {
-                            this->SetFilePrefix("line");
-                            }
-                          // transform model
-                          transformer->SetInput(newStreamline->GetOutput());
-                          
-                          // Save the model to disk
-                          writer->SetInput(transformer->GetOutput());
-                          writer->SetFileType(2);
+    }
 
-                          std::stringstream fileNameStr;
-                          fileNameStr << FileDirectoryName << "/" << FilePrefix << '_' << idx << ".vtk";
-                          writer->SetFileName(fileNameStr.str().c_str());
-                          writer->Write();
-                          newStreamline->Delete();
-                          }
-                        else
-                          {
-                          // keep the streamline in memory
-                          this->Streamlines->AddItem((vtkObject *) newStreamline);
-                          }
-                        idx++;
-                        }
-                      else
-                        {
-                        newStreamline->Delete();
-                        }
-                    }
-                }
+  vtkIdType numberOfSeeds = static_cast<vtkIdType>(seeds.size() / 3);
+  if (!this->FileDirectoryName)
+    {
+    this->TrackStreamlinesInROI(numberOfSeeds ? &seeds[0] : NULL, numberOfSeeds);
+    return;
+    }
 
-            }
+  // write each streamline to disk
+  if (this->FilePrefix == NULL)
+    {
+    this->SetFilePrefix("line");
+    }
+  int progressCount = 0;
+  int progressCountMax = 100;
+  double progress;
+  for (vtkIdType seedId = 0; seedId < numberOfSeeds; ++seedId)
+    {
+    // Report progress
+    if (progressCount == progressCountMax)
+      {
+      progressCount = 0;
+      progress = (seedId+0.0)/numberOfSeeds;
+      this->InvokeEvent(vtkCommand::ProgressEvent, (void *)&progress);
+      }
+    else
+      {
+      progressCount++;
+      }
+    // Now create a streamline 
+    newStreamline=(vtkHyperStreamlineDTMRI *) 
+      this->CreateHyperStreamline();
 
+    // Set its input information.
+    newStreamline->SetInput(this->InputTensorField);
+    newStreamline->SetStartPosition(seeds[3*seedId],seeds[3*seedId+1],seeds[3*seedId+2]);
+
+    // Ask it to output tensors and to only do one trajectory per start point
+    newStreamline->OutputTensorsOn();
+    newStreamline->OneTrajectoryPerSeedPointOn();
+
+    // Force it to execute
+    newStreamline->Update();
+
+    // See if we like it enough to write it
+    // This relies on the fact that the step length is in units of
+    // length (unlike fractions of a cell in vtkHyperStreamline).
+    double length = 
+      (newStreamline->GetOutput()->GetNumberOfPoints() - 1) * 
+      newStreamline->GetIntegrationStepLength();
+
+    if (length > this->MinimumPathLength)
+      {
+      // transform model
+      transformer->SetInput(newStreamline->GetOutput());
+
+      // Save the model to disk
+      writer->SetInput(transformer->GetOutput());
+      writer->SetFileType(2);
+
+      std::stringstream fileNameStr;
+      fileNameStr << FileDirectoryName << "/" << FilePrefix << '_' << idx << ".vtk";
+      writer->SetFileName(fileNameStr.str().c_str());
+      writer->Write();
+      idx++;
+      }
+    newStreamline->Delete();
+    }
+}
+
+namespace
+{
+
+//----------------------------------------------------------------------------
+// Streamlines tracked by one thread, in the order of their seeds
+struct vtkSeedTractsThreadBuffer
+{
+  std::vector<float> Points;
+  std::vector<float> Tensors;
+  std::vector<vtkIdType> NumberOfLinePoints;
+};
+
+//----------------------------------------------------------------------------
+struct vtkSeedTractsThreadData
+{
+  vtkHyperStreamlineDTMRI *Streamline;
+  vtkImageData *TensorField;
+  double Tolerance2;
+  double MinimumPathLength;
+  double TensorScaledIJKToRAS[4][4];
+  double Rotation[3][3];
+  double RotationTranspose[3][3];
+  // seeds of the current batch
+  const double *Seeds;
+  vtkIdType NumberOfSeeds;
+  // whether the streamline of each seed of the batch is kept
+  std::vector<char> Kept;
+  std::vector<vtkSeedTractsThreadBuffer> Buffers;
+};
+
+//----------------------------------------------------------------------------
+// Append a point of a streamline to the buffer, transformed to RAS the same
+// way TransformStreamlinesToRASAndAppendToPolyData transforms the output of
+// a vtkHyperStreamlineDTMRI (float points and tensors, R T R' rotation).
+void vtkSeedTractsAppendPoint(vtkSeedTractsThreadData *data,
+                              vtkTractographyPoint *sPtr,
+                              vtkSeedTractsThreadBuffer &buffer)
+{
+  float x[3] = {static_cast<float>(sPtr->X[0]),
+                static_cast<float>(sPtr->X[1]),
+                static_cast<float>(sPtr->X[2])};
+  double (*matrix)[4] = data->TensorScaledIJKToRAS;
+  for (int row = 0; row < 3; row++)
+    {
+    buffer.Points.push_back(static_cast<float>(
+      matrix[row][0] * x[0] + matrix[row][1] * x[1] + matrix[row][2] * x[2] +
+      matrix[row][3]));
+    }
+
+  double tensor3x3[3][3];
+  double temp3x3[3][3];
+  for (int row = 0; row < 3; row++)
+    {
+    for (int col = 0; col < 3; col++)
+      {
+      tensor3x3[row][col] = static_cast<float>(sPtr->T[row][col]);
+      }
+    }
+  vtkMath::Multiply3x3(data->Rotation,tensor3x3,temp3x3);
+  vtkMath::Multiply3x3(temp3x3,data->RotationTranspose,tensor3x3);
+  for (int row = 0; row < 3; row++)
+    {
+    for (int col = 0; col < 3; col++)
+      {
+      buffer.Tensors.push_back(static_cast<float>(tensor3x3[row][col]));
+      }
+    }
+}
+
+//----------------------------------------------------------------------------
+// Thread threadId tracks the seeds threadId, threadId + numberOfThreads, ...
+// which balances the work better than contiguous blocks of seeds when the
+// length of the tracts varies across the ROI.
+void vtkSeedTractsExecute(vtkSeedTractsThreadData *data,
+                          int threadId, int numberOfThreads)
+{
+  vtkSeedTractsThreadBuffer &buffer = data->Buffers[threadId];
+  double step = data->Streamline->GetIntegrationStepLength();
+  for (vtkIdType seedId = threadId; seedId < data->NumberOfSeeds;
+       seedId += numberOfThreads)
+    {
+    vtkTractographyArray streamers[2];
+    double seed[3] = {data->Seeds[3*seedId],
+                      data->Seeds[3*seedId+1],
+                      data->Seeds[3*seedId+2]};
+    data->Streamline->IntegrateFromPosition(data->TensorField, seed,
+                                            data->Tolerance2, streamers);
+
+    // Same points as vtkHyperStreamlineDTMRI::BuildLinesForSingleTrajectory:
+    // the first streamer backwards without the seed point, then the second
+    // streamer from the seed point.
+    size_t numberOfPoints = buffer.Points.size();
+    vtkIdType numberOfLinePoints = 0;
+    for (vtkIdType i = streamers[0].GetNumberOfPoints() - 1; i > 0; i--)
+      {
+      vtkTractographyPoint *sPtr = streamers[0].GetTractographyPoint(i);
+      if (sPtr->CellId >= 0)
+        {
+        vtkSeedTractsAppendPoint(data, sPtr, buffer);
+        ++numberOfLinePoints;
+        }
+      }
+    for (vtkIdType i = 0; i < streamers[1].GetNumberOfPoints(); i++)
+      {
+      vtkTractographyPoint *sPtr = streamers[1].GetTractographyPoint(i);
+      if (sPtr->CellId < 0)
+        {
+        break;
         }
+      vtkSeedTractsAppendPoint(data, sPtr, buffer);
+      ++numberOfLinePoints;
+      }
 
+    double length = (numberOfLinePoints - 1) * step;
+    if (length > data->MinimumPathLength)
+      {
+      buffer.NumberOfLinePoints.push_back(numberOfLinePoints);
+      data->Kept[seedId] = 1;
+      }
+    else
+      {
+      buffer.Points.resize(numberOfPoints);
+      buffer.Tensors.resize(numberOfPoints * 3);
+      data->Kept[seedId] = 0;
+      }
     }
+}
 
+//----------------------------------------------------------------------------
+VTK_THREAD_RETURN_TYPE vtkSeedTractsThreadedExecute(void *arg)
+{
+  vtkMultiThreader::ThreadInfo *info =
+    static_cast<vtkMultiThreader::ThreadInfo *>(arg);
+  vtkSeedTractsThreadData *data =
+    static_cast<vtkSeedTractsThreadData *>(info->UserData);
+  vtkSeedTractsExecute(data, info->ThreadID, info->NumberOfThreads);
+  return VTK_THREAD_RETURN_VALUE;
 }
 
+} // end of anonymous namespace
 
+// The seeds are tracked by batches: the threads fill their own buffers
+// with the streamlines of their seeds of the batch, then the buffers are
+// merged in the order of the seeds, so the output is the same for any
+// number of threads. Progress is reported between the batches, from the
+// calling thread.
+//----------------------------------------------------------------------------
+void vtkSeedTracts::TrackStreamlinesInROI(const double *seeds,
+                                          vtkIdType numberOfSeeds)
+{
+  // one streamline object holds the settings shared by all the threads
+  vtkHyperStreamlineDTMRI *streamline =
+    (vtkHyperStreamlineDTMRI *) this->CreateHyperStreamline();
+  streamline->OutputTensorsOn();
+  streamline->OneTrajectoryPerSeedPointOn();
+  if (streamline->GetIntegrationDirection() != VTK_INTEGRATE_BOTH_DIRECTIONS ||
+      !this->InputTensorField->GetPointData()->GetTensors())
+    {
+    vtkErrorMacro("Streamlines in ROI need tensors and both integration directions.");
+    streamline->Delete();
+    return;
+    }
+
+  vtkSeedTractsThreadData data;
+  data.Streamline = streamline;
+  data.TensorField = this->InputTensorField;
+  // Same tolerance as vtkHyperStreamlineDTMRI::RequestData. The bounds of
+  // the tensor field are computed here, not in the threads.
+  data.Tolerance2 = this->InputTensorField->GetLength() / 1000.0;
+  data.Tolerance2 *= data.Tolerance2;
+  data.MinimumPathLength = this->MinimumPathLength;
+
+  vtkNew<vtkMatrix4x4> tensorScaledIJKToRAS;
+  vtkMatrix4x4::Invert(this->WorldToTensorScaledIJK->GetMatrix(),
+                       tensorScaledIJKToRAS.GetPointer());
+  for (int row = 0; row < 4; row++)
+    {
+    for (int col = 0; col < 4; col++)
+      {
+      data.TensorScaledIJKToRAS[row][col] =
+        tensorScaledIJKToRAS->GetElement(row, col);
+      }
+    }
+  for (int row = 0; row < 3; row++)
+    {
+    for (int col = 0; col < 3; col++)
+      {
+      data.Rotation[row][col] = this->TensorRotationMatrix->GetElement(row, col);
+      data.RotationTranspose[row][col] = this->TensorRotationMatrix->GetElement(col, row);
+      }
+    }
+
+  // output arrays, appended to the streamlines of previous calls
+  if (!this->ROIStreamlines->GetPoints())
+    {
+    vtkNew<vtkPoints> points;
+    this->ROIStreamlines->SetPoints(points.GetPointer());
+    vtkNew<vtkCellArray> lines;
+    this->ROIStreamlines->SetLines(lines.GetPointer());
+    vtkNew<vtkFloatArray> tensors;
+    tensors->SetNumberOfComponents(9);
+    this->ROIStreamlines->GetPointData()->SetTensors(tensors.GetPointer());
+    }
+  vtkPoints *points = this->ROIStreamlines->GetPoints();
+  vtkCellArray *lines = this->ROIStreamlines->GetLines();
+  vtkDataArray *tensors = this->ROIStreamlines->GetPointData()->GetTensors();
+
+  const vtkIdType batchSize = 1000;
+  vtkSmartPointer<vtkMultiThreader> threader =
+    vtkSmartPointer<vtkMultiThreader>::New();
+  for (vtkIdType firstSeed = 0; firstSeed < numberOfSeeds; firstSeed += batchSize)
+    {
+    data.Seeds = seeds + 3 * firstSeed;
+    data.NumberOfSeeds = std::min(batchSize, numberOfSeeds - firstSeed);
+    data.Kept.assign(data.NumberOfSeeds, 0);
+    int numberOfThreads = static_cast<int>(std::min(
+      static_cast<vtkIdType>(this->NumberOfThreads), data.NumberOfSeeds));
+    data.Buffers.assign(numberOfThreads, vtkSeedTractsThreadBuffer());
+
+    threader->SetNumberOfThreads(numberOfThreads);
+    threader->SetSingleMethod(vtkSeedTractsThreadedExecute, &data);
+    threader->SingleMethodExecute();
+
+    // merge in the order of the seeds: seed i was tracked by thread
+    // i % numberOfThreads, after the previous seeds of that thread
+    std::vector<size_t> nextLine(numberOfThreads, 0);
+    std::vector<size_t> nextPoint(numberOfThreads, 0);
+    for (vtkIdType seedId = 0; seedId < data.NumberOfSeeds; ++seedId)
+      {
+      if (!data.Kept[seedId])
+        {
+        continue;
+        }
+      int threadId = static_cast<int>(seedId % numberOfThreads);
+      vtkSeedTractsThreadBuffer &buffer = data.Buffers[threadId];
+      vtkIdType numberOfLinePoints = buffer.NumberOfLinePoints[nextLine[threadId]++];
+      lines->InsertNextCell(numberOfLinePoints);
+      for (vtkIdType i = 0; i < numberOfLinePoints; ++i)
+        {
+        size_t pointId = nextPoint[threadId]++;
+        lines->InsertCellPoint(points->InsertNextPoint(&buffer.Points[3 * pointId]));
+        float *tensor = &buffer.Tensors[9 * pointId];
+        double tensorTuple[9];
+        std::copy(tensor, tensor + 9, tensorTuple);
+        tensors->InsertNextTuple(tensorTuple);
+        }
+      }
+    // free the buffers of the batch
+    data.Buffers.clear();
 
+    double progress = static_cast<double>(firstSeed + data.NumberOfSeeds) / numberOfSeeds;
+    this->InvokeEvent(vtkCommand::ProgressEvent, (void *)&progress);
+    }
+
+  this->ROIStreamlines->Modified();
+  streamline->Delete();
+}
 
+//----------------------------------------------------------------------------
 void vtkSeedTracts::SeedStreamlinesInROIWithMultipleValues()
 {
 
@@ -807,6 +1070,8 @@ void vtkSeedTracts::TransformStreamlinesToRASAndAppendToPolyData(vtkPolyData *ou
     npts += streamline->GetOutput()->GetNumberOfPoints();
     ncells += streamline->GetOutput()->GetNumberOfLines();
     }
+  npts += this->ROIStreamlines->GetNumberOfPoints();
+  ncells += this->ROIStreamlines->GetNumberOfLines();
   if (npts == 0 || ncells == 0)
     {
     return;
@@ -821,7 +1086,8 @@ void vtkSeedTracts::TransformStreamlinesToRASAndAppendToPolyData(vtkPolyData *ou
   vtkCellArray *outFibersCellArray = vtkCellArray::New();
   outFibers->SetLines(outFibersCellArray);
   outFibersCellArray->Delete();
-  outFibersCellArray->SetNumberOfCells(this->Streamlines->GetNumberOfItems());
+  outFibersCellArray->SetNumberOfCells(this->Streamlines->GetNumberOfItems() +
+                                       this->ROIStreamlines->GetNumberOfLines());
   outFibersCellArray = outFibers->GetLines();
   cellArray=outFibersCellArray->GetData();
   cellArray->SetNumberOfTuples(npts+ncells);
@@ -920,6 +1186,35 @@ void vtkSeedTracts::TransformStreamlinesToRASAndAppendToPolyData(vtkPolyData *ou
     // End of tensor rotation code.
     // -------------------------------------------------
     }
+
+  // The streamlines seeded in the ROI are already in RAS
+  if (this->ROIStreamlines->GetNumberOfLines() > 0)
+    {
+    vtkPoints *roiPoints = this->ROIStreamlines->GetPoints();
+    vtkDataArray *roiTensors = this->ROIStreamlines->GetPointData()->GetTensors();
+    for (vtkIdType k=0; k<roiPoints->GetNumberOfPoints(); k++)
+      {
+      outFibers->GetPoints()->InsertNextPoint(roiPoints->GetPoint(k));
+      newTensors->InsertNextTuple(roiTensors->GetTuple(k));
+      }
+    vtkCellArray *roiLines = this->ROIStreamlines->GetLines();
+    vtkIdType numberOfLinePoints;
+    vtkIdType *linePoints;
+    roiLines->InitTraversal();
+    while (roiLines->GetNextCell(numberOfLinePoints, linePoints))
+      {
+      cellArray->SetTupleValue(cellId, &numberOfLinePoints);
+      cellId++;
+      for (vtkIdType k=0; k<numberOfLinePoints; k++)
+        {
+        cellIndex = ptOffset+linePoints[k];
+        cellArray->SetTupleValue(cellId, &cellIndex);
+        cellId++;
+        }
+      }
+    ptOffset += roiPoints->GetNumberOfPoints();
+    }
+
   outFibers->SetLines(outFibersCellArray);
   outFibers->GetPointData()->SetTensors(newTensors);
   // Remove the scalars if any, we don't need
@@ -1181,7 +1476,8 @@ void vtkSeedTracts::DeleteAllStreamlines()
       this->DeleteStreamline(0);
       i++;
     }
-  
+  this->ROIStreamlines->Initialize();
+
 }
 
 // Delete one streamline and all of its associated objects.
@@ -45,15 +45,16 @@ public:
 
   /// Description
   /// Start a streamline from each voxel which has the value InputROIValue
-  /// in the InputROI volume.  Streamlines are added to the vtkCollection
-  /// this->Streamlines.
+  /// in the InputROI volume.  The streamlines are tracked with
+  /// NumberOfThreads threads and appended to ROIStreamlines, or written
+  /// one per file if FileDirectoryName is set.
   void SeedStreamlinesInROI();
   
   /// Description
   /// Start a streamline from each voxel which has the values stored in
   /// the vtkShortArray InputMultipleROIValues
-  /// in the InputROI volume.  Streamlines are added to the vtkCollection
-  /// this->Streamlines.
+  /// in the InputROI volume.  Streamlines are added to ROIStreamlines
+  /// like in SeedStreamlinesInROI.
   void SeedStreamlinesInROIWithMultipleValues();
 
   /// Description
@@ -64,7 +65,8 @@ public:
  /// Description
  /// Store all the streamlines in one vtkPolyData and
  /// transform the points to be in RAS. It takes
- /// special care of transforming the tensor
+ /// special care of transforming the tensor.
+ /// The streamlines of the collection come first, then ROIStreamlines.
  void TransformStreamlinesToRASAndAppendToPolyData(vtkPolyData *outFibers);
 
   /// Description
@@ -167,6 +169,21 @@ public:
   vtkSetObjectMacro(Streamlines, vtkCollection);
   vtkGetObjectMacro(Streamlines, vtkCollection);
 
+  /// Description
+  /// Streamlines seeded in the ROI, one line per seed point in the order of
+  /// the seeds, with the tensors of the points. The points are already
+  /// transformed to RAS and the tensors rotated with the WorldToTensorScaledIJK
+  /// and TensorRotationMatrix of the time of seeding.
+  vtkGetObjectMacro(ROIStreamlines, vtkPolyData);
+
+  /// Description
+  /// Number of threads tracking the streamlines seeded in the ROI,
+  /// vtkMultiThreader default by default. The seeds are spread across the
+  /// threads that share the read-only tensor field; the output does not
+  /// depend on the number of threads.
+  vtkSetClampMacro(NumberOfThreads, int, 1, VTK_INT_MAX);
+  vtkGetMacro(NumberOfThreads, int);
+
   /// Description
   /// Type of vtkHyperStreamline subclass to create.
   /// Use standard VTK class.
@@ -222,7 +239,7 @@ public:
  void UpdateAllHyperStreamlineSettings();
 
   /// Description
-  /// Delete all streamlines
+  /// Delete all streamlines, including ROIStreamlines
   void DeleteAllStreamlines();
 
   /// Description
@@ -265,6 +282,13 @@ protected:
   vtkHyperStreamline *CreateHyperStreamline();
 
   vtkCollection *Streamlines;
+  vtkPolyData *ROIStreamlines;
+
+  int NumberOfThreads;
+
+  /// Track a streamline from each seed (3 coordinates per seed, in scaled
+  /// IJK of the tensor field) and append those long enough to ROIStreamlines.
+  void TrackStreamlinesInROI(const double *seeds, vtkIdType numberOfSeeds);
 
   vtkTransform *ROIToWorld;
   vtkTransform *ROI2ToWorld;
@@ -14,9 +14,13 @@
 // vtkITK includes
 #include <vtkITKArchetypeImageSeriesScalarReader.h>
 
+// vtkTeem includes
+#include <vtkFiberBundleLocator.h>
+
 // VTK includes
 #include <vtkCellArray.h>
 #include <vtkFloatArray.h>
+#include <vtkIdList.h>
 #include <vtkImageCast.h>
 #include <vtkImageData.h>
 #include <vtkMath.h>
@@ -148,6 +152,81 @@ int main( int argc, char * argv[] )
     }
 
   int *labelDims = imageCastLabel_A->GetOutput()->GetDimensions();
+
+  // Only the fibers that have a point in the bounding box of every pass
+  // label (AND) or of a pass label (OR) can pass, the others are not probed.
+  std::vector<unsigned int> candidateLabels(numLines, 0);
+  unsigned int minCandidateLabels =
+    (includeOperation == 1) ? static_cast<unsigned int>(PassLabel.size()) : 1;
+  if (PassLabel.size() > 0)
+    {
+    std::vector<int> labelExtents(6 * PassLabel.size());
+    for (label=0; label<PassLabel.size(); label++)
+      {
+      labelExtents[6*label] = labelExtents[6*label+2] = labelExtents[6*label+4] = VTK_INT_MAX;
+      labelExtents[6*label+1] = labelExtents[6*label+3] = labelExtents[6*label+5] = VTK_INT_MIN;
+      }
+    short *labelPtr = (short *) imageCastLabel_A->GetOutput()->GetScalarPointer();
+    int ijk[3];
+    for (ijk[2]=0; ijk[2] < labelDims[2]; ijk[2]++)
+      {
+      for (ijk[1]=0; ijk[1] < labelDims[1]; ijk[1]++)
+        {
+        for (ijk[0]=0; ijk[0] < labelDims[0]; ijk[0]++, labelPtr++)
+          {
+          for (label=0; label<PassLabel.size(); label++)
+            {
+            if (*labelPtr == PassLabel[label])
+              {
+              for (int axis=0; axis<3; axis++)
+                {
+                labelExtents[6*label+2*axis] = std::min(labelExtents[6*label+2*axis], ijk[axis]);
+                labelExtents[6*label+2*axis+1] = std::max(labelExtents[6*label+2*axis+1], ijk[axis]);
+                }
+              }
+            }
+          }
+        }
+      }
+
+    vtkNew<vtkMatrix4x4> Label_A_IJKToRAS;
+    vtkMatrix4x4::Invert(Label_A_RASToIJK.GetPointer(), Label_A_IJKToRAS.GetPointer());
+    vtkNew<vtkFiberBundleLocator> locator;
+    locator->SetPolyData(input);
+    vtkNew<vtkIdList> candidates;
+    for (label=0; label<PassLabel.size(); label++)
+      {
+      int *extent = &labelExtents[6*label];
+      if (extent[0] > extent[1])
+        {
+        continue; // label not in the volume
+        }
+      // voxel i contains the points whose i coordinate is in [i, i+1)
+      double bounds[6] = {VTK_DOUBLE_MAX, -VTK_DOUBLE_MAX, VTK_DOUBLE_MAX,
+                          -VTK_DOUBLE_MAX, VTK_DOUBLE_MAX, -VTK_DOUBLE_MAX};
+      for (int corner=0; corner<8; corner++)
+        {
+        double cornerIJK[4] = {
+          static_cast<double>((corner & 1) ? extent[1] + 1 : extent[0]),
+          static_cast<double>((corner & 2) ? extent[3] + 1 : extent[2]),
+          static_cast<double>((corner & 4) ? extent[5] + 1 : extent[4]),
+          1.};
+        double cornerRAS[4];
+        Label_A_IJKToRAS->MultiplyPoint(cornerIJK, cornerRAS);
+        for (int axis=0; axis<3; axis++)
+          {
+          bounds[2*axis] = std::min(bounds[2*axis], cornerRAS[axis]);
+          bounds[2*axis+1] = std::max(bounds[2*axis+1], cornerRAS[axis]);
+          }
+        }
+      locator->FindCandidateFibers(bounds, candidates.GetPointer());
+      for (vtkIdType i=0; i<candidates->GetNumberOfIds(); i++)
+        {
+        candidateLabels[candidates->GetId(i)]++;
+        }
+      }
+    }
+
   // Check lines
   vtkIdType inCellId;
   for (inCellId=0, inLines->InitTraversal(); 
@@ -159,6 +238,12 @@ int main( int argc, char * argv[] )
       std::cerr << "Less than two points in line " << inCellId << std::endl;
       continue; //skip this polyline
       }
+    if (PassLabel.size() > 0 && candidateLabels[inCellId] < minCandidateLabels)
+      {
+      addLines.push_back(false);
+      continue; //no point in the pass labels
+      }
+    std::fill(passAll.begin(), passAll.end(), false);
     double pIJK[3];
     int pt[3];
     short *inPtr;
@@ -17,6 +17,9 @@ Version:   $Revision$
 // Slicer includes
 #include <vtkPluginFilterWatcher.h>
 
+// SlicerExecutionModel includes
+#include <ModuleProcessInformation.h>
+
 // MRML includes
 #include "vtkMRMLColorTableNode.h"
 #include "vtkMRMLColorTableStorageNode.h"
@@ -26,6 +29,9 @@ Version:   $Revision$
 #include "vtkMRMLModelStorageNode.h"
 #include "vtkMRMLScene.h"
 
+// MRMLLogic includes
+#include "vtkMultiLabelMarchingCubes.h"
+
 // vtkITK includes
 #include "vtkITKArchetypeImageSeriesScalarReader.h"
 
@@ -41,8 +47,14 @@ Version:   $Revision$
 #include <vtkImageThreshold.h>
 #include <vtkImageToStructuredPoints.h>
 #include <vtkLookupTable.h>
+#include <vtkMarchingCubes.h>
+#include <vtkMatrix4x4.h>
+#include <vtkMultiThreader.h>
+#include <vtkMutexLock.h>
 #include <vtkNew.h>
 #include <vtkPointData.h>
+#include <vtkPolyData.h>
+#include <vtkPolyDataAlgorithm.h>
 #include <vtkPolyDataNormals.h>
 #include <vtkPolyDataWriter.h>
 #include <vtkReverseSense.h>
@@ -58,6 +70,553 @@ Version:   $Revision$
 // VTKsys includes
 #include <vtksys/SystemTools.hxx>
 
+// STD includes
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+
+//----------------------------------------------------------------------------
+// Status of a label processed by a worker thread
+enum
+{
+  LabelPending,
+  LabelDone,
+  LabelEmpty,
+  LabelFailed
+};
+
+//----------------------------------------------------------------------------
+// A label to make a model from in a worker thread
+struct ModelMakerLabelJob
+{
+  int         Label;
+  std::string LabelName;
+  std::string FileName;
+  // bounding box of the label voxels, grown by one voxel
+  int         Extent[6];
+  // surface extracted by vtkMultiLabelMarchingCubes, NULL to threshold
+  // the bounding box instead
+  vtkPolyData *Surface;
+  int         Status;
+};
+
+//----------------------------------------------------------------------------
+// Parameters and state shared by the worker threads
+struct ModelMakerThreadData
+{
+  // label volume, only read by the threads
+  const void *                     Scalars;
+  int                              ScalarType;
+  int                              WholeExtent[6];
+  double                           Spacing[3];
+  double                           Origin[3];
+  vtkMatrix4x4 *                   IJKToRAS;
+
+  std::string                      FilterType;
+  int                              Smooth;
+  float                            Decimate;
+  bool                             SplitNormals;
+  bool                             PointNormals;
+  bool                             SaveIntermediateModels;
+  bool                             Debug;
+  std::string                      RootDir;
+
+  std::vector<ModelMakerLabelJob> *Jobs;
+  ModuleProcessInformation *       ProcessInformation;
+  float                            ProgressStart;
+  float                            ProgressStep;
+
+  // protected by Lock
+  vtkMutexLock *                   Lock;
+  ::size_t                         NextJob;
+  int                              NumberOfJobsDone;
+  bool                             Failed;
+};
+
+//----------------------------------------------------------------------------
+// Grow the bounding boxes of the labels in [minLabel, minLabel + number of
+// boxes[ with the voxels of the volume
+template <class T>
+void ModelMakerLabelBoxes(const T *scalars, const int extent[6], int minLabel,
+                          std::vector<int>& boxes)
+{
+  const double maxLabel = minLabel + static_cast<double>(boxes.size() / 6);
+  const T *    ptr = scalars;
+  for(int k = extent[4]; k <= extent[5]; k++)
+    {
+    for(int j = extent[2]; j <= extent[3]; j++)
+      {
+      for(int i = extent[0]; i <= extent[1]; i++, ptr++)
+        {
+        const double value = static_cast<double>(*ptr);
+        if (value < minLabel || value >= maxLabel ||
+            value != floor(value))
+          {
+          continue;
+          }
+        int *box = &boxes[6 * (static_cast<int>(value) - minLabel)];
+        box[0] = std::min(box[0], i);
+        box[1] = std::max(box[1], i);
+        box[2] = std::min(box[2], j);
+        box[3] = std::max(box[3], j);
+        box[4] = std::min(box[4], k);
+        box[5] = std::max(box[5], k);
+        }
+      }
+    }
+}
+
+//----------------------------------------------------------------------------
+// Same as vtkImageThreshold::ThresholdBetween(label, label) with an in value
+// of inValue and an out value of 0, restricted to extent
+template <class T>
+void ModelMakerThresholdLabel(const T *scalars, const int wholeExtent[6],
+                              int label, unsigned char inValue,
+                              const int extent[6], unsigned char *output)
+{
+  const vtkIdType incY = wholeExtent[1] - wholeExtent[0] + 1;
+  const vtkIdType incZ = incY * (wholeExtent[3] - wholeExtent[2] + 1);
+  for(int k = extent[4]; k <= extent[5]; k++)
+    {
+    for(int j = extent[2]; j <= extent[3]; j++)
+      {
+      const T *ptr = scalars + (k - wholeExtent[4]) * incZ
+        + (j - wholeExtent[2]) * incY + (extent[0] - wholeExtent[0]);
+      for(int i = extent[0]; i <= extent[1]; i++, ptr++)
+        {
+        *output++ = (static_cast<double>(*ptr) == label) ? inValue : 0;
+        }
+      }
+    }
+}
+
+//----------------------------------------------------------------------------
+std::string ModelMakerFileName(const std::string& rootDir,
+                               const std::string& name)
+{
+  if (rootDir != "")
+    {
+    return rootDir + std::string("/") + name;
+    }
+  return name;
+}
+
+//----------------------------------------------------------------------------
+void ModelMakerWriteIntermediateModel(vtkPolyData *polyData,
+                                      const std::string& fileName, bool debug)
+{
+  vtkNew<vtkPolyDataWriter> writer;
+  writer->SetInput(polyData);
+  writer->SetFileType(2);
+  if (debug)
+    {
+    std::cout << "Writing intermediate file " << fileName.c_str() << std::endl;
+    }
+  writer->SetFileName(fileName.c_str());
+  if (!writer->Write())
+    {
+    std::cerr << "ERROR: Failed to write intermediate file " << fileName.c_str() << std::endl;
+    }
+  writer->SetInput(NULL);
+}
+
+//----------------------------------------------------------------------------
+// Threshold the bounding box of the label and run the marching cubes of the
+// serial loop on it. Voxels out of the box are not part of the label so the
+// surface is the same as with the whole volume.
+int ModelMakerThresholdLabelSurface(const ModelMakerLabelJob& job,
+                                    const ModelMakerThreadData& data,
+                                    vtkMarchingCubes *mcubes)
+{
+  const int i = job.Label;
+
+  // threshold
+  double spacing[3] = {data.Spacing[0], data.Spacing[1], data.Spacing[2]};
+  double origin[3] = {data.Origin[0], data.Origin[1], data.Origin[2]};
+  vtkNew<vtkImageData> labelImage;
+  labelImage->SetExtent(job.Extent);
+  labelImage->SetWholeExtent(job.Extent);
+  labelImage->SetSpacing(spacing);
+  labelImage->SetOrigin(origin);
+  labelImage->SetScalarTypeToUnsignedChar();
+  labelImage->SetNumberOfScalarComponents(1);
+  labelImage->AllocateScalars();
+  // vtkImageThreshold clamps the in value to the range of the input type
+  double maxValue = 200.;
+  switch (data.ScalarType)
+    {
+    case VTK_CHAR:
+    case VTK_SIGNED_CHAR:
+      maxValue = VTK_SIGNED_CHAR_MAX;
+      break;
+    default:
+      break;
+    }
+  unsigned char inValue = static_cast<unsigned char>(maxValue);
+  unsigned char *output =
+    static_cast<unsigned char *>(labelImage->GetScalarPointer());
+  switch (data.ScalarType)
+    {
+    vtkTemplateMacro(
+      ModelMakerThresholdLabel(static_cast<const VTK_TT *>(data.Scalars),
+                               data.WholeExtent, i, inValue, job.Extent,
+                               output));
+    default:
+      std::cerr << "ERROR: unsupported scalar type for label " << i << std::endl;
+      return LabelFailed;
+    }
+
+  mcubes->SetInput(labelImage.GetPointer());
+  mcubes->SetValue(0, 100.5);
+  mcubes->ComputeScalarsOff();
+  mcubes->ComputeGradientsOff();
+  mcubes->ComputeNormalsOff();
+  try
+    {
+    mcubes->Update();
+    }
+  catch(...)
+    {
+    std::cerr << "ERROR while running marching cubes, for label " << i << std::endl;
+    return LabelFailed;
+    }
+  return LabelDone;
+}
+
+//----------------------------------------------------------------------------
+// Run the same pipeline as the serial loop (without joint smoothing) on the
+// surface of the label, extracted beforehand or from its bounding box.
+int ModelMakerMakeLabelModel(ModelMakerLabelJob& job,
+                             const ModelMakerThreadData& data)
+{
+  const int   i = job.Label;
+  std::string labelName = job.LabelName;
+
+  vtkNew<vtkMarchingCubes> mcubes;
+  vtkPolyData *surface = job.Surface;
+  if (surface == NULL)
+    {
+    int status = ModelMakerThresholdLabelSurface(job, data, mcubes.GetPointer());
+    if (status != LabelDone)
+      {
+      return status;
+      }
+    surface = mcubes->GetOutput();
+    }
+  if (surface->GetNumberOfPolys()  == 0)
+    {
+    return LabelEmpty;
+    }
+  if (data.SaveIntermediateModels)
+    {
+    ModelMakerWriteIntermediateModel(
+      surface,
+      ModelMakerFileName(data.RootDir, labelName + std::string("-MarchingCubes.vtk")),
+      data.Debug);
+    }
+
+  vtkNew<vtkDecimatePro> decimator;
+  decimator->SetInput(surface);
+  decimator->SetFeatureAngle(60);
+  decimator->SplittingOff();
+  decimator->PreserveTopologyOn();
+  decimator->SetMaximumError(1);
+  decimator->SetTargetReduction(data.Decimate);
+  try
+    {
+    decimator->Update();
+    }
+  catch(...)
+    {
+    std::cerr << "ERROR decimating model " << i << std::endl;
+    return LabelFailed;
+    }
+  if (data.SaveIntermediateModels)
+    {
+    ModelMakerWriteIntermediateModel(
+      decimator->GetOutput(),
+      ModelMakerFileName(data.RootDir, labelName + std::string("-Decimated.vtk")),
+      data.Debug);
+    }
+
+  vtkPolyDataAlgorithm *decimated = decimator.GetPointer();
+  vtkNew<vtkReverseSense> reverser;
+  if (data.IJKToRAS->Determinant() < 0)
+    {
+    reverser->SetInput(decimator->GetOutput());
+    reverser->ReverseNormalsOn();
+    decimated = reverser.GetPointer();
+    }
+
+  vtkSmartPointer<vtkPolyDataAlgorithm> smoother;
+  if (strcmp(data.FilterType.c_str(), "Sinc") == 0)
+    {
+    vtkSmartPointer<vtkWindowedSincPolyDataFilter> smootherSinc =
+      vtkSmartPointer<vtkWindowedSincPolyDataFilter>::New();
+    smootherSinc->SetPassBand(0.1);
+    smootherSinc->SetInput(decimated->GetOutput());
+    smootherSinc->SetNumberOfIterations(data.Smooth);
+    smootherSinc->FeatureEdgeSmoothingOff();
+    smootherSinc->BoundarySmoothingOff();
+    smoother = smootherSinc;
+    }
+  else
+    {
+    vtkSmartPointer<vtkSmoothPolyDataFilter> smootherPoly =
+      vtkSmartPointer<vtkSmoothPolyDataFilter>::New();
+    // this next line massively rounds corners
+    smootherPoly->SetRelaxationFactor(0.33);
+    smootherPoly->SetFeatureAngle(60);
+    smootherPoly->SetConvergence(0);
+    smootherPoly->SetInput(decimated->GetOutput());
+    smootherPoly->SetNumberOfIterations(data.Smooth);
+    smootherPoly->FeatureEdgeSmoothingOff();
+    smootherPoly->BoundarySmoothingOff();
+    smoother = smootherPoly;
+    }
+  try
+    {
+    smoother->Update();
+    }
+  catch(...)
+    {
+    std::cerr << "ERROR updating " << data.FilterType << " smoother for model " << i << std::endl;
+    return LabelFailed;
+    }
+  if (data.SaveIntermediateModels)
+    {
+    ModelMakerWriteIntermediateModel(
+      smoother->GetOutput(),
+      ModelMakerFileName(data.RootDir, labelName + std::string("-Smoothed.vtk")),
+      data.Debug);
+    }
+
+  // vtkTransform is not thread safe, each thread has its own
+  vtkNew<vtkTransform> transformIJKtoRAS;
+  transformIJKtoRAS->SetMatrix(data.IJKToRAS);
+  vtkNew<vtkTransformPolyDataFilter> transformer;
+  transformer->SetInput(smoother->GetOutput());
+  transformer->SetTransform(transformIJKtoRAS.GetPointer());
+
+  vtkNew<vtkPolyDataNormals> normals;
+  normals->SetComputePointNormals(data.PointNormals);
+  normals->SetInput(transformer->GetOutput());
+  normals->SetFeatureAngle(60);
+  normals->SetSplitting(data.SplitNormals);
+
+  vtkNew<vtkStripper> stripper;
+  stripper->SetInput(normals->GetOutput());
+  try
+    {
+    (stripper->GetOutput())->Update();
+    }
+  catch(...)
+    {
+    std::cerr << "ERROR updating stripper for model " << i << std::endl;
+    return LabelFailed;
+    }
+
+  vtkNew<vtkPolyDataWriter> writer;
+  writer->SetInput(stripper->GetOutput());
+  writer->SetFileType(2);
+  writer->SetFileName(job.FileName.c_str());
+  if (data.Debug)
+    {
+    std::cout << "Writing model " << " " << labelName << " to file " << writer->GetFileName()  << endl;
+    }
+  if (!writer->Write())
+    {
+    std::cerr << "ERROR: Failed to write model file " << job.FileName.c_str() << std::endl;
+    }
+  writer->SetInput(NULL);
+  return LabelDone;
+}
+
+//----------------------------------------------------------------------------
+// Same output as vtkPluginFilterWatcher, for the worker threads
+void ModelMakerReportProgress(ModuleProcessInformation *processInformation,
+                              const std::string& comment, float progress)
+{
+  if (processInformation)
+    {
+    strncpy(processInformation->ProgressMessage, comment.c_str(), 1023);
+    processInformation->Progress = progress;
+    if (processInformation->ProgressCallbackFunction
+        && processInformation->ProgressCallbackClientData)
+      {
+      (*(processInformation->ProgressCallbackFunction))(processInformation->ProgressCallbackClientData);
+      }
+    }
+  else
+    {
+    std::cout << "<filter-progress>" << progress << "</filter-progress>"
+              << std::endl << std::flush;
+    }
+}
+
+//----------------------------------------------------------------------------
+VTK_THREAD_RETURN_TYPE ModelMakerThreadedExecute(void *arg)
+{
+  vtkMultiThreader::ThreadInfo *info =
+    static_cast<vtkMultiThreader::ThreadInfo *>(arg);
+  ModelMakerThreadData *data =
+    static_cast<ModelMakerThreadData *>(info->UserData);
+  while (true)
+    {
+    // take the next label
+    data->Lock->Lock();
+    ::size_t jobIndex = data->NextJob++;
+    bool     stop = data->Failed || jobIndex >= data->Jobs->size() ||
+      (data->ProcessInformation && data->ProcessInformation->Abort);
+    data->Lock->Unlock();
+    if (stop)
+      {
+      break;
+      }
+
+    ModelMakerLabelJob& job = (*data->Jobs)[jobIndex];
+    int status = job.Status;
+    if (status == LabelPending)
+      {
+      status = ModelMakerMakeLabelModel(job, *data);
+      }
+
+    data->Lock->Lock();
+    job.Status = status;
+    data->Failed = data->Failed || status == LabelFailed;
+    data->NumberOfJobsDone++;
+    ModelMakerReportProgress(data->ProcessInformation,
+                             "Make model " + job.LabelName,
+                             data->ProgressStart +
+                             data->NumberOfJobsDone * data->ProgressStep);
+    data->Lock->Unlock();
+    }
+  return VTK_THREAD_RETURN_VALUE;
+}
+
+//----------------------------------------------------------------------------
+// Add a model node and its storage, display and hierarchy nodes to the
+// output scene
+void ModelMakerAddModelToScene(vtkMRMLScene *modelScene,
+                               const std::string& labelName,
+                               const std::string& fileName, int i,
+                               vtkMRMLColorTableNode *colorNode,
+                               vtkMRMLModelHierarchyNode *topColorHierarchyNode,
+                               vtkMRMLNode *rnd, bool debug)
+{
+  if (debug)
+    {
+    std::cout << "Adding model " << labelName << " to the output scene, with filename " << fileName.c_str()
+              << endl;
+    }
+  // each model needs a mrml node, a storage node and a display node
+  vtkNew<vtkMRMLModelNode> mnode;
+  mnode->SetScene(modelScene);
+  mnode->SetName(labelName.c_str());
+
+  vtkNew<vtkMRMLModelStorageNode> snode;
+  snode->SetFileName(fileName.c_str());
+  if (modelScene->AddNode(snode.GetPointer()) == NULL)
+    {
+    std::cerr << "ERROR: unable to add the storage node to the model scene" << endl;
+    }
+  vtkNew<vtkMRMLModelDisplayNode> dnode;
+  dnode->SetColor(0.5, 0.5, 0.5);
+  double *rgba;
+  if (colorNode != NULL)
+    {
+    rgba = colorNode->GetLookupTable()->GetTableValue(i);
+    if (rgba != NULL)
+      {
+      if (debug)
+        {
+        std::cout << "Got colour: " << rgba[0] << " " << rgba[1] << " " << rgba[2] << " " << rgba[3] << endl;
+        }
+      dnode->SetColor(rgba[0], rgba[1], rgba[2]);
+      }
+    else
+      {
+      std::cerr << "Couldn't get look up table value for " << i << ", display node colour is not set (grey)"
+                << endl;
+      }
+    }
+
+  dnode->SetVisibility(1);
+  modelScene->AddNode(dnode.GetPointer());
+  if (debug)
+    {
+    std::cout << "Added display node: id = " << (dnode->GetID() == NULL ? "(null)" : dnode->GetID()) << endl;
+    std::cout << "Setting model's storage node: id = "
+              << (snode->GetID() == NULL ? "(null)" : snode->GetID()) << endl;
+    }
+  mnode->SetAndObserveStorageNodeID(snode->GetID());
+  mnode->SetAndObserveDisplayNodeID(dnode->GetID());
+  modelScene->AddNode(mnode.GetPointer());
+
+  // put it in the hierarchy, either the flat one by default or 
+  // try to find the matching color hierarchy node to make this an
+  // associated node
+  std::string colorName;
+  if (colorNode != NULL)
+    {
+    colorName = std::string(colorNode->GetColorNameAsFileName(i));
+    }
+  else
+    {
+    // might be in a testing case where the hierarchy nodes are
+    // numbered (made from the generic colors)
+    std::stringstream ss;
+    ss << i;
+    colorName = ss.str();
+    if (debug)
+      {
+      std::cout << "No color node, guessing at color name being same as label number " << colorName.c_str() << std::endl;
+      }
+    }
+  vtkMRMLNode *mrmlNode = NULL;
+  if (colorName.compare("") != 0)
+    {
+    mrmlNode = modelScene->GetFirstNodeByName(colorName.c_str());
+    }
+  // if there's no color hierarchy, or no color name or the mrml node
+  // named for the color isn't a model hierarchy node, use a flat hierarchy
+  if (topColorHierarchyNode == NULL ||
+      colorName.compare("") == 0 ||
+      mrmlNode == NULL ||
+      strcmp(mrmlNode->GetClassName(),"vtkMRMLModelHierarchyNode") != 0)
+    {
+    vtkNew<vtkMRMLModelHierarchyNode> mhnd;
+    mhnd->SetHideFromEditors(1);
+    modelScene->AddNode(mhnd.GetPointer());
+    mhnd->SetParentNodeID(rnd->GetID());
+    mhnd->SetModelNodeID(mnode->GetID());
+    }
+  else
+    {
+    // use the template color hierarchy
+    vtkMRMLModelHierarchyNode *colorHierarchyNode = vtkMRMLModelHierarchyNode::SafeDownCast(mrmlNode);
+    if (colorHierarchyNode)
+      {
+      colorHierarchyNode->SetAssociatedNodeID(mnode->GetID());
+      // and hide it so that it doesn't clutter up the tree
+      colorHierarchyNode->SetHideFromEditors(1);
+      if (debug)
+        {
+        std::cout << "Found a color hierarchy node with name " << colorHierarchyNode->GetName() << ", set it's associated node to this model id: " << mnode->GetID() << std::endl;
+        }
+      }
+    }
+  if (debug)
+    {
+    std::cout << "...done adding model to output scene" << endl;
+    }
+}
+
+} // end of anonymous namespace
+
+//----------------------------------------------------------------------------
 int main(int argc, char * argv[])
 {
   PARSE_ARGS;
@@ -376,6 +935,19 @@ int main(int argc, char * argv[])
     numSingletonFilterSteps = 1;
     numRepeatedFilterSteps = 9;
     }
+  // Models smoothed independently can have their surfaces extracted in one
+  // pass over the volume instead of thresholding it for each label.
+  const bool useLabelCubes = MultiLabel && !JointSmoothing;
+  if (useLabelCubes)
+    {
+    // the pass replaces the threshold and marching cubes steps of each
+    // label, and the discrete marching cubes of all the labels
+    numRepeatedFilterSteps -= 2;
+    if (!makeMultiple)
+      {
+      numSingletonFilterSteps += 1;
+      }
+    }
   numFilterSteps = numSingletonFilterSteps + (numRepeatedFilterSteps * numModelsToGenerate);
   if (SaveIntermediateModels)
     {
@@ -464,6 +1036,21 @@ int main(int argc, char * argv[])
                                  extent[2], extent[3] + 2,
                                  extent[4], extent[5] + 2);
     }
+
+  // Models smoothed independently can be made in parallel, one label per
+  // thread.
+  int numberOfThreads = NumberOfThreads;
+  if (numberOfThreads <= 0)
+    {
+    numberOfThreads = vtkMultiThreader::GetGlobalDefaultNumberOfThreads();
+    }
+  const bool parallel = makeMultiple && !JointSmoothing && numberOfThreads > 1 &&
+    image->GetNumberOfScalarComponents() == 1;
+  if (debug)
+    {
+    std::cout << "Number of threads: " << (parallel ? numberOfThreads : 1) << std::endl;
+    }
+
   if (useColorNode)
     {
     colorNode = vtkSmartPointer<vtkMRMLColorTableNode>::New();
@@ -640,56 +1227,61 @@ int main(int argc, char * argv[])
         }
       }
 
-    if (cubes)
-      {
-      cubes->SetInput(NULL);
-      cubes = NULL;
-      }
-    cubes = vtkSmartPointer<vtkDiscreteMarchingCubes>::New();
-    std::string            comment1 = "Discrete Marching Cubes";
-    vtkPluginFilterWatcher watchDMCubes(cubes,
-                                        comment1.c_str(),
-                                        CLPProcessInformation,
-                                        1.0 / numFilterSteps,
-                                        currentFilterOffset / numFilterSteps);
-    if (debug)
-      {
-      watchDMCubes.QuietOn();
-      }
-    currentFilterOffset += 1.0;
-    // add padding if flag is set
-    if (Pad)
-      {
-      cubes->SetInput(padder->GetOutput());
-      }
-    else
-      {
-      cubes->SetInput(image);
-      }
-    if (useStartEnd)
+    // neither the worker threads nor the surfaces extracted in one pass use
+    // the marching cubes of all the labels
+    if (!parallel && !useLabelCubes)
       {
-      if (debug)
+      if (cubes)
         {
-        std::cout << "Marching cubes: Using end label = " << EndLabel << ", start label = " << StartLabel << endl;
+        cubes->SetInput(NULL);
+        cubes = NULL;
         }
-      cubes->GenerateValues((EndLabel - StartLabel + 1), StartLabel, EndLabel);
-      }
-    else
-      {
+      cubes = vtkSmartPointer<vtkDiscreteMarchingCubes>::New();
+      std::string            comment1 = "Discrete Marching Cubes";
+      vtkPluginFilterWatcher watchDMCubes(cubes,
+                                          comment1.c_str(),
+                                          CLPProcessInformation,
+                                          1.0 / numFilterSteps,
+                                          currentFilterOffset / numFilterSteps);
       if (debug)
         {
-        std::cout << "Marching cubes: Using max = " << labelsMax << ", min = " << labelsMin << endl;
+        watchDMCubes.QuietOn();
+        }
+      currentFilterOffset += 1.0;
+      // add padding if flag is set
+      if (Pad)
+        {
+        cubes->SetInput(padder->GetOutput());
+        }
+      else
+        {
+        cubes->SetInput(image);
+        }
+      if (useStartEnd)
+        {
+        if (debug)
+          {
+          std::cout << "Marching cubes: Using end label = " << EndLabel << ", start label = " << StartLabel << endl;
+          }
+        cubes->GenerateValues((EndLabel - StartLabel + 1), StartLabel, EndLabel);
+        }
+      else
+        {
+        if (debug)
+          {
+          std::cout << "Marching cubes: Using max = " << labelsMax << ", min = " << labelsMin << endl;
+          }
+        cubes->GenerateValues((labelsMax - labelsMin + 1), labelsMin, labelsMax);
+        }
+      try
+        {
+        cubes->Update();
+        }
+      catch(...)
+        {
+        std::cerr << "ERROR while updating marching cubes filter." << std::endl;
+        return EXIT_FAILURE;
         }
-      cubes->GenerateValues((labelsMax - labelsMin + 1), labelsMin, labelsMax);
-      }
-    try
-      {
-      cubes->Update();
-      }
-    catch(...)
-      {
-      std::cerr << "ERROR while updating marching cubes filter." << std::endl;
-      return EXIT_FAILURE;
       }
     if (JointSmoothing)
       {
@@ -849,6 +1441,8 @@ int main(int argc, char * argv[])
   // Loop through all the labels
   //
   std::vector<int> loopLabels;
+  // labels to make models from in parallel
+  std::vector<ModelMakerLabelJob> labelJobs;
   if (useStartEnd || GenerateAll)
     {
     // set up the loop list with all the labels between start and end
@@ -865,6 +1459,54 @@ int main(int argc, char * argv[])
       loopLabels.push_back(Labels[i]);
       }
     }
+
+  // Extract the surfaces of all the labels in one pass over the volume
+  vtkSmartPointer<vtkMultiLabelMarchingCubes> labelCubes;
+  if (useLabelCubes)
+    {
+    labelCubes = vtkSmartPointer<vtkMultiLabelMarchingCubes>::New();
+    for(::size_t l = 0; l < loopLabels.size(); l++)
+      {
+      // labels without voxels are skipped
+      if (!makeMultiple ||
+          (((hist->GetOutput())->GetPointData())->GetScalars())->GetTuple1(loopLabels[l]) > 0.0)
+        {
+        labelCubes->AddLabel(loopLabels[l]);
+        }
+      }
+    std::string            comment5 = "Marching Cubes All Models";
+    vtkPluginFilterWatcher watchLabelCubes(labelCubes,
+                                           comment5.c_str(),
+                                           CLPProcessInformation,
+                                           1.0 / numFilterSteps,
+                                           currentFilterOffset / numFilterSteps);
+    currentFilterOffset += 1.0;
+    if (debug)
+      {
+      watchLabelCubes.QuietOn();
+      }
+    if (Pad)
+      {
+      labelCubes->SetInput(padder->GetOutput());
+      }
+    else
+      {
+      labelCubes->SetInput(image);
+      }
+    if (labelCubes->GetNumberOfLabels() > 0)
+      {
+      try
+        {
+        labelCubes->Update();
+        }
+      catch(...)
+        {
+        std::cerr << "ERROR while running marching cubes." << std::endl;
+        return EXIT_FAILURE;
+        }
+      }
+    }
+
   for(::size_t l = 0; l < loopLabels.size(); l++)
     {
     // get the label out of the vector
@@ -975,8 +1617,33 @@ int main(int argc, char * argv[])
       */
       }
 
-    // threshold
-    if (JointSmoothing == 0)
+    if (parallel)
+      {
+      // the model is made by a worker thread once all the labels are named
+      ModelMakerLabelJob job;
+      job.Label = i;
+      job.LabelName = labelName;
+      if (rootDir == "")
+        {
+        std::cout << "WARNING: output directory is an empty string..." << endl;
+        }
+      job.FileName = ModelMakerFileName(rootDir, labelName + std::string(".vtk"));
+      job.Surface = NULL;
+      job.Status = LabelPending;
+      if (useLabelCubes)
+        {
+        job.Surface = labelCubes->GetLabelSurface(i);
+        if (job.Surface == NULL || job.Surface->GetNumberOfPolys() == 0)
+          {
+          job.Status = LabelEmpty;
+          }
+        }
+      labelJobs.push_back(job);
+      continue;
+      }
+
+    // threshold, unless the surface is already extracted
+    if (JointSmoothing == 0 && !useLabelCubes)
       {
       if (imageThreshold)
         {
@@ -1031,7 +1698,7 @@ int main(int argc, char * argv[])
         }
       imageToStructuredPoints->ReleaseDataFlagOn();
       }
-    else
+    else if (JointSmoothing)
       {
       // use the output of the smoother
       if (threshold)
@@ -1077,46 +1744,55 @@ int main(int argc, char * argv[])
 
     // if not joint smoothing, may need to skip this label
     int skipLabel = 0;
+    vtkPolyData *labelSurface = NULL;
     if (JointSmoothing == 0)
       {
-      if (mcubes)
+      if (useLabelCubes)
         {
-        mcubes->SetInput(NULL);
-        mcubes = NULL;
+        labelSurface = labelCubes->GetLabelSurface(i);
         }
-      mcubes = vtkSmartPointer<vtkMarchingCubes>::New();
-      std::string            comment5 = "Marching Cubes " + labelName;
-      vtkPluginFilterWatcher watchThreshold(mcubes,
-                                            comment5.c_str(),
-                                            CLPProcessInformation,
-                                            1.0 / numFilterSteps,
-                                            currentFilterOffset / numFilterSteps);
-      currentFilterOffset += 1.0;
-      if (debug)
-        {
-        watchThreshold.QuietOn();
-        }
-      mcubes->SetInput(imageToStructuredPoints->GetOutput());
-      mcubes->SetValue(0, 100.5);
-      mcubes->ComputeScalarsOff();
-      mcubes->ComputeGradientsOff();
-      mcubes->ComputeNormalsOff();
-      (mcubes->GetOutput())->ReleaseDataFlagOn();
-      try
-        {
-        mcubes->Update();
-        }
-      catch(...)
+      else
         {
-        std::cerr << "ERROR while running marching cubes, for label " << i << std::endl;
-        return EXIT_FAILURE;
+        if (mcubes)
+          {
+          mcubes->SetInput(NULL);
+          mcubes = NULL;
+          }
+        mcubes = vtkSmartPointer<vtkMarchingCubes>::New();
+        std::string            comment5 = "Marching Cubes " + labelName;
+        vtkPluginFilterWatcher watchThreshold(mcubes,
+                                              comment5.c_str(),
+                                              CLPProcessInformation,
+                                              1.0 / numFilterSteps,
+                                              currentFilterOffset / numFilterSteps);
+        currentFilterOffset += 1.0;
+        if (debug)
+          {
+          watchThreshold.QuietOn();
+          }
+        mcubes->SetInput(imageToStructuredPoints->GetOutput());
+        mcubes->SetValue(0, 100.5);
+        mcubes->ComputeScalarsOff();
+        mcubes->ComputeGradientsOff();
+        mcubes->ComputeNormalsOff();
+        (mcubes->GetOutput())->ReleaseDataFlagOn();
+        try
+          {
+          mcubes->Update();
+          }
+        catch(...)
+          {
+          std::cerr << "ERROR while running marching cubes, for label " << i << std::endl;
+          return EXIT_FAILURE;
+          }
+        labelSurface = mcubes->GetOutput();
         }
       if (debug)
         {
-        std::cout << "\nNumber of polygons = " << (mcubes->GetOutput())->GetNumberOfPolys() << endl;
+        std::cout << "\nNumber of polygons = " << (labelSurface ? labelSurface->GetNumberOfPolys() : 0) << endl;
         }
 
-      if ((mcubes->GetOutput())->GetNumberOfPolys()  == 0)
+      if (labelSurface == NULL || labelSurface->GetNumberOfPolys()  == 0)
         {
         std::cout << "Cannot create a model from label " << i
                   << "\nNo polygons can be created,\nthere may be no voxels with this label in the volume." << endl;
@@ -1159,7 +1835,7 @@ int main(int argc, char * argv[])
                                            1.0 / numFilterSteps,
                                            currentFilterOffset / numFilterSteps);
         currentFilterOffset += 1.0;
-        writer->SetInput(cubes->GetOutput());
+        writer->SetInput(labelSurface);
         writer->SetFileType(2);
         std::string fileName;
         if (rootDir != "")
@@ -1211,7 +1887,7 @@ int main(int argc, char * argv[])
         }
       if (JointSmoothing == 0)
         {
-        decimator->SetInput(mcubes->GetOutput());
+        decimator->SetInput(labelSurface);
         }
       else
         {
@@ -1264,7 +1940,7 @@ int main(int argc, char * argv[])
           }
         else
           {
-          fileName = labelName + std::string("-MarchingCubes.vtk");
+          fileName = labelName + std::string("-Decimated.vtk");
           }
         if (debug)
           {
@@ -1614,115 +2290,126 @@ int main(int argc, char * argv[])
       writer = NULL;
       if (modelScene.GetPointer() != NULL)
         {
-        if (debug)
-          {
-          std::cout << "Adding model " << labelName << " to the output scene, with filename " << fileName.c_str()
-                    << endl;
-          }
-        // each model needs a mrml node, a storage node and a display node
-        vtkNew<vtkMRMLModelNode> mnode;
-        mnode->SetScene(modelScene.GetPointer());
-        mnode->SetName(labelName.c_str());
-
-        vtkNew<vtkMRMLModelStorageNode> snode;
-        snode->SetFileName(fileName.c_str());
-        if (modelScene->AddNode(snode.GetPointer()) == NULL)
-          {
-          std::cerr << "ERROR: unable to add the storage node to the model scene" << endl;
-          }
-        vtkNew<vtkMRMLModelDisplayNode> dnode;
-        dnode->SetColor(0.5, 0.5, 0.5);
-        double *rgba;
-        if (colorNode != NULL)
-          {
-          rgba = colorNode->GetLookupTable()->GetTableValue(i);
-          if (rgba != NULL)
-            {
-            if (debug)
-              {
-              std::cout << "Got colour: " << rgba[0] << " " << rgba[1] << " " << rgba[2] << " " << rgba[3] << endl;
-              }
-            dnode->SetColor(rgba[0], rgba[1], rgba[2]);
-            }
-          else
-            {
-            std::cerr << "Couldn't get look up table value for " << i << ", display node colour is not set (grey)"
-                      << endl;
-            }
-          }
+        ModelMakerAddModelToScene(modelScene.GetPointer(), labelName, fileName, i,
+                                  colorNode, topColorHierarchyNode, rnd, debug);
+        }
+      } // end of skipping an empty label
+    }   // end of loop over labels
 
-        dnode->SetVisibility(1);
-        modelScene->AddNode(dnode.GetPointer());
-        if (debug)
-          {
-          std::cout << "Added display node: id = " << (dnode->GetID() == NULL ? "(null)" : dnode->GetID()) << endl;
-          std::cout << "Setting model's storage node: id = "
-                    << (snode->GetID() == NULL ? "(null)" : snode->GetID()) << endl;
-          }
-        mnode->SetAndObserveStorageNodeID(snode->GetID());
-        mnode->SetAndObserveDisplayNodeID(dnode->GetID());
-        modelScene->AddNode(mnode.GetPointer());
-
-        // put it in the hierarchy, either the flat one by default or 
-        // try to find the matching color hierarchy node to make this an
-        // associated node
-        std::string colorName;
-        if (colorNode != NULL)
-          {
-          colorName = std::string(colorNode->GetColorNameAsFileName(i));
-          }
-        else
-          {
-          // might be in a testing case where the hierarchy nodes are
-          // numbered (made from the generic colors)
-          std::stringstream ss;
-          ss << i;
-          colorName = ss.str();
-          if (debug)
-            {
-            std::cout << "No color node, guessing at color name being same as label number " << colorName.c_str() << std::endl;
-            }
-          }
-        vtkMRMLNode *mrmlNode = NULL;
-        if (colorName.compare("") != 0)
-          {
-          mrmlNode = modelScene->GetFirstNodeByName(colorName.c_str());
-          }
-        // if there's no color hierarchy, or no color name or the mrml node
-        // named for the color isn't a model hierarchy node, use a flat hierarchy
-        if (topColorHierarchyNode == NULL ||
-            colorName.compare("") == 0 ||
-            mrmlNode == NULL ||
-            strcmp(mrmlNode->GetClassName(),"vtkMRMLModelHierarchyNode") != 0)
-          {
-          vtkNew<vtkMRMLModelHierarchyNode> mhnd;
-          mhnd->SetHideFromEditors(1);
-          modelScene->AddNode(mhnd.GetPointer());
-          mhnd->SetParentNodeID(rnd->GetID());
-          mhnd->SetModelNodeID(mnode->GetID());
-          }
-        else
+  if (parallel && labelJobs.size() > 0)
+    {
+    vtkImageData *labelVolume = image;
+    if (Pad)
+      {
+      padder->Update();
+      labelVolume = padder->GetOutput();
+      }
+    int wholeExtent[6];
+    labelVolume->GetExtent(wholeExtent);
+
+    // bounding boxes of all the labels, in one pass over the volume, unless
+    // their surfaces are already extracted
+    if (!useLabelCubes)
+      {
+      int minLabel = labelJobs[0].Label;
+      int maxLabel = labelJobs[0].Label;
+      for(::size_t l = 0; l < labelJobs.size(); l++)
+        {
+        minLabel = std::min(minLabel, labelJobs[l].Label);
+        maxLabel = std::max(maxLabel, labelJobs[l].Label);
+        }
+      std::vector<int> boxes(6 * (maxLabel - minLabel + 1));
+      for(::size_t b = 0; b < boxes.size(); b += 2)
+        {
+        boxes[b] = VTK_INT_MAX;
+        boxes[b + 1] = VTK_INT_MIN;
+        }
+      switch (labelVolume->GetScalarType())
+        {
+        vtkTemplateMacro(
+          ModelMakerLabelBoxes(static_cast<const VTK_TT *>(labelVolume->GetScalarPointer()),
+                               wholeExtent, minLabel, boxes));
+        default:
+          std::cerr << "ERROR: unsupported scalar type " << labelVolume->GetScalarType() << endl;
+          return EXIT_FAILURE;
+        }
+      for(::size_t l = 0; l < labelJobs.size(); l++)
+        {
+        ModelMakerLabelJob& job = labelJobs[l];
+        const int *box = &boxes[6 * (job.Label - minLabel)];
+        if (box[0] > box[1])
           {
-          // use the template color hierarchy
-          vtkMRMLModelHierarchyNode *colorHierarchyNode = vtkMRMLModelHierarchyNode::SafeDownCast(mrmlNode);
-          if (colorHierarchyNode)
-            {
-            colorHierarchyNode->SetAssociatedNodeID(mnode->GetID());
-            // and hide it so that it doesn't clutter up the tree
-            colorHierarchyNode->SetHideFromEditors(1);
-            if (debug)
-              {
-              std::cout << "Found a color hierarchy node with name " << colorHierarchyNode->GetName() << ", set it's associated node to this model id: " << mnode->GetID() << std::endl;
-              }
-            }
+          job.Status = LabelEmpty;
           }
-        if (debug)
+        // grow the box by one voxel so that the surface is closed
+        for(int axis = 0; axis < 3; axis++)
           {
-          std::cout << "...done adding model to output scene" << endl;
+          job.Extent[2 * axis] = std::max(box[2 * axis] - 1, wholeExtent[2 * axis]);
+          job.Extent[2 * axis + 1] = std::min(box[2 * axis + 1] + 1, wholeExtent[2 * axis + 1]);
           }
         }
-      } // end of skipping an empty label
-    }   // end of loop over labels
+      }
+
+    if (strcmp(FilterType.c_str(), "Sinc") == 0 && Smooth == 1)
+      {
+      std::cerr << "Warning: Smoothing iterations of 1 not allowed for Sinc filter, using 2" << endl;
+      Smooth = 2;
+      }
+
+    ModelMakerThreadData data;
+    data.Scalars = labelVolume->GetScalarPointer();
+    data.ScalarType = labelVolume->GetScalarType();
+    labelVolume->GetExtent(data.WholeExtent);
+    labelVolume->GetSpacing(data.Spacing);
+    labelVolume->GetOrigin(data.Origin);
+    data.IJKToRAS = transformIJKtoRAS->GetMatrix();
+    data.FilterType = FilterType;
+    data.Smooth = Smooth;
+    data.Decimate = Decimate;
+    data.SplitNormals = SplitNormals;
+    data.PointNormals = PointNormals;
+    data.SaveIntermediateModels = SaveIntermediateModels;
+    data.Debug = debug;
+    data.RootDir = rootDir;
+    data.Jobs = &labelJobs;
+    data.ProcessInformation = CLPProcessInformation;
+    data.ProgressStart = currentFilterOffset / numFilterSteps;
+    data.ProgressStep = (1.0 - data.ProgressStart) / labelJobs.size();
+    vtkNew<vtkMutexLock> lock;
+    data.Lock = lock.GetPointer();
+    data.NextJob = 0;
+    data.NumberOfJobsDone = 0;
+    data.Failed = false;
+
+    vtkNew<vtkMultiThreader> threader;
+    threader->SetNumberOfThreads(
+      std::min(numberOfThreads, static_cast<int>(labelJobs.size())));
+    threader->SetSingleMethod(ModelMakerThreadedExecute, &data);
+    threader->SingleMethodExecute();
+    if (data.Failed)
+      {
+      return EXIT_FAILURE;
+      }
+
+    // the scene is filled in label order, like the serial loop does
+    for(::size_t l = 0; l < labelJobs.size(); l++)
+      {
+      const ModelMakerLabelJob& job = labelJobs[l];
+      if (job.Status == LabelEmpty)
+        {
+        std::cout << "Cannot create a model from label " << job.Label
+                  << "\nNo polygons can be created,\nthere may be no voxels with this label in the volume." << endl;
+        std::cout << "...continuing" << endl;
+        }
+      else if (job.Status == LabelDone && modelScene.GetPointer() != NULL)
+        {
+        ModelMakerAddModelToScene(modelScene.GetPointer(), job.LabelName,
+                                  job.FileName, job.Label, colorNode,
+                                  topColorHierarchyNode, rnd, debug);
+        }
+      }
+    }
+
   if (debug)
     {
     std::cout << "End of looping over labels" << endl;
@@ -0,0 +1,64 @@
+# test_cmd .........: command to run without args
+# test_name ........: name of the test found in the testing wrapper <test_cmd>
+# input_volume .....: label map to make the models from
+# serial_dir .......: directory of the models made with 1 thread
+# threaded_dir .....: directory of the models made with several threads
+# threads ..........: number of threads of the threaded run
+# extra_args .......: optional arguments of both runs
+
+# Sanity checks
+set(expected_defined_vars test_cmd test_name input_volume serial_dir threaded_dir threads)
+foreach(var ${expected_defined_vars})
+  if(NOT ${var})
+    message(FATAL_ERROR "Variable ${var} not defined !")
+  endif()
+endforeach()
+
+# Make all the models of the label map with 1 thread and with <threads> threads
+foreach(run serial threaded)
+  if(run STREQUAL "serial")
+    set(run_threads 1)
+  else()
+    set(run_threads ${threads})
+  endif()
+  set(run_dir ${${run}_dir})
+  file(REMOVE_RECURSE ${run_dir})
+  file(MAKE_DIRECTORY ${run_dir})
+  execute_process(
+    COMMAND ${test_cmd} ${test_name}
+      --generateAll
+      --threads ${run_threads}
+      ${extra_args}
+      --modelSceneFile ${run_dir}/models.mrml
+      ${input_volume}
+    RESULT_VARIABLE exec_not_successful
+    )
+  if(exec_not_successful)
+    message(FATAL_ERROR "${test_cmd} failed with ${run_threads} thread(s)")
+  endif()
+endforeach()
+
+# The models must be identical whatever the number of threads
+file(GLOB serial_models RELATIVE ${serial_dir} ${serial_dir}/*.vtk)
+file(GLOB threaded_models RELATIVE ${threaded_dir} ${threaded_dir}/*.vtk)
+list(LENGTH serial_models model_count)
+if(model_count EQUAL 0)
+  message(FATAL_ERROR "No model made in ${serial_dir}")
+endif()
+list(SORT serial_models)
+list(SORT threaded_models)
+if(NOT "${serial_models}" STREQUAL "${threaded_models}")
+  message(FATAL_ERROR "Different models: ${serial_models} and ${threaded_models}")
+endif()
+
+foreach(model ${serial_models})
+  execute_process(
+    COMMAND ${CMAKE_COMMAND} -E compare_files ${serial_dir}/${model} ${threaded_dir}/${model}
+    RESULT_VARIABLE test_not_successful
+    OUTPUT_QUIET
+    ERROR_QUIET
+    )
+  if(test_not_successful)
+    message(SEND_ERROR "${threaded_dir}/${model} does not match ${serial_dir}/${model}!")
+  endif()
+endforeach()
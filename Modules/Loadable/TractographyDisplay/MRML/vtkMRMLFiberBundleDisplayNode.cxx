@@ -17,14 +17,25 @@ Version:   $Revision: 1.3 $
 #include "vtkMRMLFiberBundleNode.h"
 
 // MRML includes
+#include <vtkMRMLConfigure.h>
 #include "vtkMRMLDiffusionTensorDisplayPropertiesNode.h"
 #include "vtkMRMLDisplayableNode.h"
 #include "vtkMRMLScene.h"
 
+// Teem includes
+#ifdef MRML_USE_vtkTeem
+#include "vtkFiberBundleLevelOfDetail.h"
+#endif
+
 // VTK includes
+#include <vtkAlgorithmOutput.h>
+#include <vtkAssignAttribute.h>
 #include <vtkCommand.h>
+#include <vtkPassThrough.h>
+#include <vtkPolyData.h>
 
 // STD includes
+#include <algorithm>
 #include <sstream>
 
 //----------------------------------------------------------------------------
@@ -44,12 +55,149 @@ vtkMRMLFiberBundleDisplayNode::vtkMRMLFiberBundleDisplayNode()
 
   this->ScalarRange[0] = 0.;
   this->ScalarRange[1] = 1.;
+
+  this->LevelOfDetail = 0;
+  this->LevelOfDetailFilter = NULL;
+#ifdef MRML_USE_vtkTeem
+  this->LevelOfDetailFilter = vtkFiberBundleLevelOfDetail::New();
+#endif
+  this->LevelOfDetailOutput = vtkPassThrough::New();
+  this->FullDetailOutput = vtkPolyData::New();
+  this->FullDetailOutputPort = NULL;
+  this->DisplayOutputPort = NULL;
 }
 
 //----------------------------------------------------------------------------
 vtkMRMLFiberBundleDisplayNode::~vtkMRMLFiberBundleDisplayNode()
 {
   this->SetAndObserveDiffusionTensorDisplayPropertiesNodeID(NULL);
+#ifdef MRML_USE_vtkTeem
+  this->LevelOfDetailFilter->Delete();
+#endif
+  this->LevelOfDetailOutput->Delete();
+  this->FullDetailOutput->Delete();
+}
+
+//----------------------------------------------------------------------------
+void vtkMRMLFiberBundleDisplayNode::SetInputToPolyDataPipeline(vtkPolyData* polyData)
+{
+  this->InvalidateFullDetailOutput();
+#ifdef MRML_USE_vtkTeem
+  this->LevelOfDetailFilter->SetInput(polyData);
+  if (polyData)
+    {
+    this->PassThrough->SetInputConnection(this->LevelOfDetailFilter->GetOutputPort());
+    this->AssignAttribute->SetInputConnection(this->LevelOfDetailFilter->GetOutputPort());
+    }
+  else
+    {
+    this->PassThrough->SetInput(0);
+    this->AssignAttribute->SetInput(0);
+    }
+#else
+  this->Superclass::SetInputToPolyDataPipeline(polyData);
+#endif
+}
+
+//----------------------------------------------------------------------------
+vtkPolyData* vtkMRMLFiberBundleDisplayNode::GetInputPolyData()
+{
+#ifdef MRML_USE_vtkTeem
+  return vtkPolyData::SafeDownCast(this->LevelOfDetailFilter->GetInput());
+#else
+  return this->Superclass::GetInputPolyData();
+#endif
+}
+
+//----------------------------------------------------------------------------
+void vtkMRMLFiberBundleDisplayNode::SetLevelOfDetail(int level)
+{
+  // same range as vtkFiberBundleLevelOfDetail
+  level = std::min(std::max(level, 0), 16);
+  if (level == this->LevelOfDetail)
+    {
+    return;
+    }
+  if (this->LevelOfDetail == 0)
+    {
+    this->CacheFullDetailOutput();
+    }
+  this->LevelOfDetail = level;
+#ifdef MRML_USE_vtkTeem
+  this->LevelOfDetailFilter->SetLevel(level);
+#endif
+  // switch the output between the display pipeline and the cache
+  if (this->GetInputPolyData())
+    {
+    this->GetOutputPort();
+    }
+}
+
+//----------------------------------------------------------------------------
+vtkAlgorithmOutput* vtkMRMLFiberBundleDisplayNode
+::GetLevelOfDetailOutputPort(vtkAlgorithmOutput* displayPort)
+{
+  this->DisplayOutputPort = displayPort;
+  if (this->LevelOfDetail == 0 && this->IsFullDetailOutputValid())
+    {
+    this->LevelOfDetailOutput->SetInput(this->FullDetailOutput);
+    }
+  else
+    {
+    this->LevelOfDetailOutput->SetInputConnection(displayPort);
+    }
+  return this->LevelOfDetailOutput->GetOutputPort();
+}
+
+//----------------------------------------------------------------------------
+void vtkMRMLFiberBundleDisplayNode::CacheFullDetailOutput()
+{
+  if (!this->GetInputPolyData())
+    {
+    return;
+    }
+  // make sure the display port is the one of the current display pipeline
+  this->GetOutputPort();
+  if (!this->DisplayOutputPort || this->IsFullDetailOutputValid())
+    {
+    return;
+    }
+  vtkPolyData* output = vtkPolyData::SafeDownCast(
+    this->DisplayOutputPort->GetProducer()->GetOutputDataObject(
+      this->DisplayOutputPort->GetIndex()));
+  if (!output)
+    {
+    return;
+    }
+  // Up to date if the fibers have been rendered since the last change
+  output->Update();
+  this->FullDetailOutput->ShallowCopy(output);
+  this->FullDetailOutputPort = this->DisplayOutputPort;
+  this->FullDetailOutputTime.Modified();
+}
+
+//----------------------------------------------------------------------------
+void vtkMRMLFiberBundleDisplayNode::InvalidateFullDetailOutput()
+{
+  if (!this->FullDetailOutputPort)
+    {
+    return;
+    }
+  this->FullDetailOutputPort = NULL;
+  if (this->DisplayOutputPort)
+    {
+    this->LevelOfDetailOutput->SetInputConnection(this->DisplayOutputPort);
+    }
+  this->FullDetailOutput->Initialize();
+}
+
+//----------------------------------------------------------------------------
+bool vtkMRMLFiberBundleDisplayNode::IsFullDetailOutputValid()
+{
+  vtkPolyData* input = this->GetInputPolyData();
+  return input && this->FullDetailOutputPort &&
+    this->FullDetailOutputPort == this->DisplayOutputPort &&
+    input->GetMTime() < this->FullDetailOutputTime.GetMTime();
 }
 
 //----------------------------------------------------------------------------
@@ -125,6 +273,7 @@ void vtkMRMLFiberBundleDisplayNode::PrintSelf(ostream& os, vtkIndent indent)
   
   Superclass::PrintSelf(os,indent);
   os << indent << "ColorMode:             " << this->ColorMode << "\n";
+  os << indent << "LevelOfDetail:         " << this->LevelOfDetail << "\n";
 }
 
 //-----------------------------------------------------------
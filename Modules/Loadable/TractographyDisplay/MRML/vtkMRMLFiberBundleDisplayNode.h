@@ -28,7 +28,11 @@
 // Tractography includes
 #include "vtkSlicerTractographyDisplayModuleMRMLExport.h"
 
+class vtkAlgorithmOutput;
+class vtkFiberBundleLevelOfDetail;
 class vtkMRMLDiffusionTensorDisplayPropertiesNode;
+class vtkPassThrough;
+class vtkPolyData;
 
 class VTK_SLICER_TRACTOGRAPHYDISPLAY_MODULE_MRML_EXPORT vtkMRMLFiberBundleDisplayNode : public vtkMRMLModelDisplayNode
 {
@@ -152,6 +156,27 @@ class VTK_SLICER_TRACTOGRAPHYDISPLAY_MODULE_MRML_EXPORT vtkMRMLFiberBundleDispla
     this->SetColorMode ( this->colorModePointFiberOrientation );
   };
 
+  //--------------------------------------------------------------------------
+  /// Display Information: Level of detail for ALL nodes
+  //--------------------------------------------------------------------------
+
+  ///
+  /// Level of detail of the displayed fibers, 0 (full detail) by default.
+  /// Level n keeps one fiber out of 2^n with simplified polylines before
+  /// they are colored, turned into tubes or glyphed.
+  /// Changing it doesn't modify the node, the views only need to be rendered
+  /// again. It is not saved in the scene.
+  /// The full detail output is kept while the level is lowered: restoring
+  /// level 0 doesn't run the display pipeline again unless the fibers or the
+  /// display properties changed in the meantime.
+  /// \sa vtkFiberBundleLevelOfDetail
+  void SetLevelOfDetail(int level);
+  vtkGetMacro(LevelOfDetail, int);
+
+  ///
+  /// Reimplemented to return the input of the level of detail filter.
+  virtual vtkPolyData* GetInputPolyData();
+
   //--------------------------------------------------------------------------
   /// Display Information: ColorMode for glyphs
   //--------------------------------------------------------------------------
@@ -192,6 +217,40 @@ class VTK_SLICER_TRACTOGRAPHYDISPLAY_MODULE_MRML_EXPORT vtkMRMLFiberBundleDispla
 
   virtual void SetDiffusionTensorDisplayPropertiesNodeID(const char* id);
 
+  /// Reimplemented to insert the level of detail filter before the
+  /// pipeline of the display node.
+  virtual void SetInputToPolyDataPipeline(vtkPolyData* polyData);
+
+  /// Connect the output port of the display pipeline of the subclass to the
+  /// output of the node and return the output port of the node. At level 0,
+  /// the output is the cached full detail output as long as it is valid.
+  /// To be called by the GetOutputPort() of the subclasses.
+  vtkAlgorithmOutput* GetLevelOfDetailOutputPort(vtkAlgorithmOutput* displayPort);
+
+  /// Keep the output of the display pipeline, computed at full detail.
+  void CacheFullDetailOutput();
+
+  /// Release the cached full detail output. To be called by the subclasses
+  /// each time they reconfigure their display pipeline.
+  void InvalidateFullDetailOutput();
+
+  /// Return true if the cached full detail output is still what the display
+  /// pipeline would output at level 0.
+  bool IsFullDetailOutputValid();
+
+  /// Level of detail
+  int LevelOfDetail;
+  vtkFiberBundleLevelOfDetail *LevelOfDetailFilter;
+
+  /// Output of the node: the display pipeline or the cached full detail output
+  vtkPassThrough *LevelOfDetailOutput;
+  vtkPolyData *FullDetailOutput;
+  /// Port of the display pipeline the full detail output was cached from
+  vtkAlgorithmOutput *FullDetailOutputPort;
+  vtkTimeStamp FullDetailOutputTime;
+  /// Port of the display pipeline currently connected to the output
+  vtkAlgorithmOutput *DisplayOutputPort;
+
   /// ALL MRML nodes
   static std::vector<int> GetSupportedColorModes();
 
@@ -115,13 +115,15 @@ void vtkMRMLFiberBundleGlyphDisplayNode::PrintSelf(ostream& os, vtkIndent indent
 //----------------------------------------------------------------------------
 vtkAlgorithmOutput* vtkMRMLFiberBundleGlyphDisplayNode::GetOutputPort()
 {
-  return this->DiffusionTensorGlyphFilter->GetOutputPort();
+  return this->GetLevelOfDetailOutputPort(
+    this->DiffusionTensorGlyphFilter->GetOutputPort());
 }
 
 //----------------------------------------------------------------------------
 void vtkMRMLFiberBundleGlyphDisplayNode::UpdatePolyDataPipeline()
 {
   //this->Superclass::UpdatePolyDataPipeline();
+  this->InvalidateFullDetailOutput();
 
   this->DiffusionTensorGlyphFilter->SetInputConnection(
     this->Superclass::GetOutputPort());
@@ -27,6 +27,7 @@ Version:   $Revision: 1.3 $
 #include <vtkCellData.h>
 #include <vtkObjectFactory.h>
 #include <vtkPointData.h>
+#include <vtkPolyData.h>
 
 //----------------------------------------------------------------------------
 vtkMRMLNodeNewMacro(vtkMRMLFiberBundleLineDisplayNode);
@@ -103,13 +104,14 @@ vtkAlgorithmOutput* vtkMRMLFiberBundleLineDisplayNode::GetOutputPort()
     outputPort = this->TensorToColor->GetOutputPort();
     }
 
-  return outputPort;
+  return this->GetLevelOfDetailOutputPort(outputPort);
 }
 
 //----------------------------------------------------------------------------
 void vtkMRMLFiberBundleLineDisplayNode::UpdatePolyDataPipeline()
 {
   //this->Superclass::UpdatePolyDataPipeline();
+  this->InvalidateFullDetailOutput();
   this->TensorToColor->SetInputConnection(this->Superclass::GetOutputPort());
 
   if (!this->Visibility)
@@ -51,7 +51,6 @@ class VTK_SLICER_TRACTOGRAPHYDISPLAY_MODULE_MRML_EXPORT vtkMRMLFiberBundleLineDi
   /// Update the pipeline based on this node attributes
   virtual void UpdatePolyDataPipeline();
 
-
  protected:
   vtkMRMLFiberBundleLineDisplayNode ( );
   ~vtkMRMLFiberBundleLineDisplayNode ( );
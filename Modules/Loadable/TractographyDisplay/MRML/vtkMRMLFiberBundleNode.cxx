@@ -15,15 +15,18 @@ Version:   $Revision: 1.3 $
 // VTK includes
 #include <vtkCleanPolyData.h>
 #include <vtkCommand.h>
-#include <vtkExtractPolyDataGeometry.h>
 #include <vtkExtractSelectedPolyDataIds.h>
 #include <vtkIdTypeArray.h>
 #include <vtkInformation.h>
+#include <vtkMatrix4x4.h>
 #include <vtkObjectFactory.h>
 #include <vtkPlanes.h>
 #include <vtkSelection.h>
 #include <vtkSelectionNode.h>
 
+// vtkTeem includes
+#include <vtkFiberBundleLocator.h>
+
 // TractographyMRML includes
 #include "vtkMRMLFiberBundleGlyphDisplayNode.h"
 #include "vtkMRMLFiberBundleLineDisplayNode.h"
@@ -36,6 +39,7 @@ Version:   $Revision: 1.3 $
 #include <vtkMRMLScene.h>
 #include <vtkMRMLAnnotationNode.h>
 #include <vtkMRMLAnnotationROINode.h>
+#include <vtkMRMLTransformNode.h>
 
 // STD includes
 #include <algorithm>
@@ -64,7 +68,8 @@ vtkMRMLFiberBundleNode::vtkMRMLFiberBundleNode()
   this->SelectionWithAnnotationNodeMode = vtkMRMLFiberBundleNode::PositiveAnnotationNodeSelection;
   this->AnnotationNode = 0;
   this->AnnotationNodeID = 0;
-  this->ExtractPolyDataGeometry = 0;
+  this->ExtractROISelectedPolyDataIds = 0;
+  this->FiberLocator = 0;
   this->Planes = 0;
   this->SelectWithAnnotationNode = 0;
   this->EnableShuffleIDs = 1;
@@ -390,6 +395,8 @@ vtkMRMLFiberBundleDisplayNode* vtkMRMLFiberBundleNode::AddGlyphDisplayNode()
 void vtkMRMLFiberBundleNode::SetAndObservePolyData(vtkPolyData* polyData)
 {
   this->ExtractSelectedPolyDataIds->SetInput(0, polyData);
+  this->ExtractROISelectedPolyDataIds->SetInput(0, polyData);
+  this->FiberLocator->SetPolyData(polyData);
   this->Superclass::SetAndObservePolyData(polyData);
 
   if (polyData)
@@ -463,6 +470,10 @@ void vtkMRMLFiberBundleNode::SetSelectWithAnnotationNode(int _arg)
   if (this->SelectWithAnnotationNode != _arg)
     {
     this->SelectWithAnnotationNode = _arg;
+    if (this->SelectWithAnnotationNode)
+      {
+      this->UpdateROISelectedIds();
+      }
     this->SetPolyDataToDisplayNodes();
     this->Modified();
     }
@@ -476,14 +487,10 @@ void vtkMRMLFiberBundleNode::SetSelectionWithAnnotationNodeMode(int _arg)
     { 
     this->SelectionWithAnnotationNodeMode = _arg;
 
-    if (_arg == vtkMRMLFiberBundleNode::PositiveAnnotationNodeSelection)
-    {
-      this->ExtractPolyDataGeometry->ExtractInsideOn();
-      this->ExtractPolyDataGeometry->ExtractBoundaryCellsOn();
-    } else if (_arg == vtkMRMLFiberBundleNode::NegativeAnnotationNodeSelection) {
-      this->ExtractPolyDataGeometry->ExtractInsideOff();
-      this->ExtractPolyDataGeometry->ExtractBoundaryCellsOff();
-    }
+    if (this->SelectWithAnnotationNode)
+      {
+      this->UpdateROISelectedIds();
+      }
 
     this->Modified();
     // \tbd really needed ?
@@ -592,6 +599,11 @@ void vtkMRMLFiberBundleNode::UpdateSubsampling()
     arr->Modified();
     node->Modified();
     sel->Modified();
+
+    if (this->SelectWithAnnotationNode)
+      {
+      this->UpdateROISelectedIds();
+      }
     }
 
   /*
@@ -632,13 +644,23 @@ void vtkMRMLFiberBundleNode::PrepareROISelection()
   this->AnnotationNode = NULL;
   this->AnnotationNodeID = NULL;
 
-  this->ExtractPolyDataGeometry = vtkExtractPolyDataGeometry::New();
   this->Planes = vtkPlanes::New();
+  this->FiberLocator = vtkFiberBundleLocator::New();
 
-  this->ExtractPolyDataGeometry->ExtractInsideOn();
-  this->ExtractPolyDataGeometry->ExtractBoundaryCellsOn();
-  this->ExtractPolyDataGeometry->SetInputConnection(
-    this->CleanPolyDataPostSubsampling->GetOutputPort());
+  // The selected fibers are extracted from the input fibers in the order of
+  // the subsampling
+  this->ExtractROISelectedPolyDataIds = vtkExtractSelectedPolyDataIds::New();
+  vtkSelection* sel = vtkSelection::New();
+  vtkSelectionNode* node = vtkSelectionNode::New();
+  vtkIdTypeArray* arr = vtkIdTypeArray::New();
+  sel->AddNode(node);
+  node->GetProperties()->Set(vtkSelectionNode::CONTENT_TYPE(), vtkSelectionNode::INDICES);
+  node->GetProperties()->Set(vtkSelectionNode::FIELD_TYPE(), vtkSelectionNode::CELL);
+  node->SetSelectionList(arr);
+  this->ExtractROISelectedPolyDataIds->SetInput(1, sel);
+  arr->Delete();
+  node->Delete();
+  sel->Delete();
 
   this->SelectionWithAnnotationNodeMode = vtkMRMLFiberBundleNode::PositiveAnnotationNodeSelection;
 
@@ -649,7 +671,7 @@ void vtkMRMLFiberBundleNode::PrepareROISelection()
   this->CleanPolyDataPostROISelection->PointMergingOff();
 
   this->CleanPolyDataPostROISelection->SetInputConnection(
-    this->ExtractPolyDataGeometry->GetOutputPort());
+    this->ExtractROISelectedPolyDataIds->GetOutputPort());
 
   this->SelectWithAnnotationNode = 0;
 }
@@ -657,15 +679,9 @@ void vtkMRMLFiberBundleNode::PrepareROISelection()
 //----------------------------------------------------------------------------
 void vtkMRMLFiberBundleNode::UpdateROISelection()
 {
-  vtkMRMLAnnotationROINode* AnnotationROI =
-    vtkMRMLAnnotationROINode::SafeDownCast(this->AnnotationNode);
-  if (AnnotationROI)
-    {
-    AnnotationROI->GetTransformedPlanes(this->Planes);
-    this->ExtractPolyDataGeometry->SetImplicitFunction(this->Planes);
-    }
   if (this->GetSelectWithAnnotationNode())
     {
+    this->UpdateROISelectedIds();
     this->InvokeEvent(vtkMRMLModelNode::PolyDataModifiedEvent, this);
     }
 }
@@ -676,10 +692,90 @@ void vtkMRMLFiberBundleNode::CleanROISelection()
 {
   this->SetAndObserveAnnotationNodeID(NULL);
   this->CleanPolyDataPostROISelection->Delete();
-  this->ExtractPolyDataGeometry->Delete();
+  this->ExtractROISelectedPolyDataIds->Delete();
+  this->FiberLocator->Delete();
   this->Planes->Delete();
 }
 
+//----------------------------------------------------------------------------
+void vtkMRMLFiberBundleNode::UpdateROISelectedIds()
+{
+  vtkSelection* sel = vtkSelection::SafeDownCast(
+    this->ExtractROISelectedPolyDataIds->GetInput(1));
+  vtkSelection* subsamplingSel = vtkSelection::SafeDownCast(
+    this->ExtractSelectedPolyDataIds->GetInput(1));
+  if (!sel || !subsamplingSel)
+    {
+    return;
+    }
+  vtkIdTypeArray* selectedIds =
+    vtkIdTypeArray::SafeDownCast(sel->GetNode(0)->GetSelectionList());
+  vtkIdTypeArray* subsampledIds =
+    vtkIdTypeArray::SafeDownCast(subsamplingSel->GetNode(0)->GetSelectionList());
+  selectedIds->Initialize();
+
+  vtkMRMLAnnotationROINode* AnnotationROI =
+    vtkMRMLAnnotationROINode::SafeDownCast(this->AnnotationNode);
+  vtkPolyData* polyData = this->GetPolyData();
+  if (AnnotationROI && polyData)
+    {
+    AnnotationROI->GetTransformedPlanes(this->Planes);
+
+    // World bounds of the box, all the fibers are tested when the selection
+    // is outside the box or the box is not transformed linearly.
+    double bounds[6];
+    polyData->GetBounds(bounds);
+    double XYZ[3];
+    double RadiusXYZ[3];
+    AnnotationROI->GetXYZ(XYZ);
+    AnnotationROI->GetRadiusXYZ(RadiusXYZ);
+    vtkMRMLTransformNode* tnode = AnnotationROI->GetParentTransformNode();
+    vtkMatrix4x4* transformToWorld = vtkMatrix4x4::New();
+    if (!AnnotationROI->GetInsideOut() &&
+        (tnode == 0 || tnode->GetMatrixTransformToWorld(transformToWorld)))
+      {
+      for (int i = 0; i < 3; ++i)
+        {
+        bounds[2*i] = VTK_DOUBLE_MAX;
+        bounds[2*i+1] = -VTK_DOUBLE_MAX;
+        }
+      for (int corner = 0; corner < 8; ++corner)
+        {
+        double point[4] = {
+          XYZ[0] + ((corner & 1) ? RadiusXYZ[0] : -RadiusXYZ[0]),
+          XYZ[1] + ((corner & 2) ? RadiusXYZ[1] : -RadiusXYZ[1]),
+          XYZ[2] + ((corner & 4) ? RadiusXYZ[2] : -RadiusXYZ[2]),
+          1.};
+        transformToWorld->MultiplyPoint(point, point);
+        for (int i = 0; i < 3; ++i)
+          {
+          bounds[2*i] = std::min(bounds[2*i], point[i]);
+          bounds[2*i+1] = std::max(bounds[2*i+1], point[i]);
+          }
+        }
+      }
+    transformToWorld->Delete();
+
+    this->FiberLocator->UpdateSelection(this->Planes, bounds);
+
+    // Keep the order of the subsampling
+    const bool positive = (this->SelectionWithAnnotationNodeMode ==
+                           vtkMRMLFiberBundleNode::PositiveAnnotationNodeSelection);
+    for (vtkIdType i = 0; i < subsampledIds->GetNumberOfTuples(); ++i)
+      {
+      const vtkIdType fiberId = subsampledIds->GetValue(i);
+      if (this->FiberLocator->IsFiberSelected(fiberId) == positive)
+        {
+        selectedIds->InsertNextValue(fiberId);
+        }
+      }
+    }
+
+  selectedIds->Modified();
+  sel->GetNode(0)->Modified();
+  sel->Modified();
+}
+
 
 //---------------------------------------------------------------------------
 vtkMRMLStorageNode* vtkMRMLFiberBundleNode::CreateDefaultStorageNode()
@@ -32,7 +32,7 @@ class vtkMRMLFiberBundleDisplayNode;
 class vtkExtractSelectedPolyDataIds;
 class vtkMRMLAnnotationNode;
 class vtkIdTypeArray;
-class vtkExtractPolyDataGeometry;
+class vtkFiberBundleLocator;
 class vtkPlanes;
 class vtkCleanPolyData;
 
@@ -238,13 +238,19 @@ protected:
 
   vtkMRMLAnnotationNode *AnnotationNode;
   char *AnnotationNodeID;
-  vtkExtractPolyDataGeometry *ExtractPolyDataGeometry;
+  /// Extracts the subsampled fibers selected by the annotation node
+  vtkExtractSelectedPolyDataIds *ExtractROISelectedPolyDataIds;
+  vtkFiberBundleLocator *FiberLocator;
   vtkPlanes *Planes;
 
   virtual void PrepareROISelection();
   virtual void UpdateROISelection();
   virtual void CleanROISelection();
 
+  /// Update the ids of the subsampled fibers selected by the annotation
+  /// node. Only the fibers around the annotation node are tested.
+  virtual void UpdateROISelectedIds();
+
   virtual void SetAnnotationNodeID(const char* id);
 
 };
@@ -148,15 +148,16 @@ vtkAlgorithmOutput* vtkMRMLFiberBundleTubeDisplayNode::GetOutputPort()
 {
   if (this->GetColorMode () == vtkMRMLFiberBundleDisplayNode::colorModeScalarData)
     {
-    return this->TubeFilter->GetOutputPort();
+    return this->GetLevelOfDetailOutputPort(this->TubeFilter->GetOutputPort());
     }
-  return this->TensorToColor->GetOutputPort();
+  return this->GetLevelOfDetailOutputPort(this->TensorToColor->GetOutputPort());
 }
 
 //----------------------------------------------------------------------------
 void vtkMRMLFiberBundleTubeDisplayNode::UpdatePolyDataPipeline()
 {
   //this->Superclass::UpdatePolyDataPipeline();
+  this->InvalidateFullDetailOutput();
 
   this->ColorLinesByOrientation->SetInputConnection(
     this->Superclass::GetOutputPort());
@@ -62,6 +62,10 @@ vtkMRMLTractographyDisplayDisplayableManager::vtkMRMLTractographyDisplayDisplaya
 {
   this->EnableFiberEdit = 0;
   this->SelectedFiberBundleNode = 0;
+  this->InteractiveLevelOfDetail = 2;
+  this->LevelOfDetailMinimumNumberOfFibers = 10000;
+  this->LevelOfDetailIdleDelay = 300;
+  this->LevelOfDetailTimerId = 0;
 
   this->RemoveInteractorStyleObservableEvent(vtkCommand::LeftButtonPressEvent);
   this->RemoveInteractorStyleObservableEvent(vtkCommand::LeftButtonReleaseEvent);
@@ -74,6 +78,9 @@ vtkMRMLTractographyDisplayDisplayableManager::vtkMRMLTractographyDisplayDisplaya
   this->RemoveInteractorStyleObservableEvent(vtkCommand::EnterEvent);
   this->RemoveInteractorStyleObservableEvent(vtkCommand::LeaveEvent);
   this->AddInteractorStyleObservableEvent(vtkCommand::KeyPressEvent);
+  this->AddInteractorStyleObservableEvent(vtkCommand::StartInteractionEvent);
+  this->AddInteractorStyleObservableEvent(vtkCommand::EndInteractionEvent);
+  this->AddInteractorObservableEvent(vtkCommand::TimerEvent);
 }
 
 //---------------------------------------------------------------------------
@@ -97,6 +104,29 @@ int vtkMRMLTractographyDisplayDisplayableManager::ActiveInteractionModes()
 //---------------------------------------------------------------------------
 void vtkMRMLTractographyDisplayDisplayableManager::OnInteractorStyleEvent(int eventid)
 {
+  if (eventid == vtkCommand::StartInteractionEvent)
+    {
+    // the camera starts moving: coarse fibers until it stops
+    if (this->LevelOfDetailTimerId)
+      {
+      this->GetInteractor()->DestroyTimer(this->LevelOfDetailTimerId);
+      this->LevelOfDetailTimerId = 0;
+      }
+    this->SetFiberBundlesLevelOfDetail(this->InteractiveLevelOfDetail);
+    }
+  else if (eventid == vtkCommand::EndInteractionEvent)
+    {
+    // wait for the camera to be idle (e.g. between mouse wheel steps)
+    // before rendering the fibers in full detail
+    this->LevelOfDetailTimerId =
+      this->GetInteractor()->CreateOneShotTimer(this->LevelOfDetailIdleDelay);
+    if (!this->LevelOfDetailTimerId)
+      {
+      this->SetFiberBundlesLevelOfDetail(0);
+      this->RequestRender();
+      }
+    }
+
   //if (eventid == vtkCommand::LeftButtonReleaseEvent && keyPressed)
   if (this->GetEnableFiberEdit() &&
       eventid == vtkCommand::KeyPressEvent && 
@@ -215,6 +245,52 @@ void vtkMRMLTractographyDisplayDisplayableManager::OnInteractorStyleEvent(int ev
   return;
 }
 
+//---------------------------------------------------------------------------
+void vtkMRMLTractographyDisplayDisplayableManager::OnInteractorEvent(int eventid)
+{
+  if (eventid == vtkCommand::TimerEvent && this->LevelOfDetailTimerId &&
+      this->GetInteractor()->GetTimerEventId() == this->LevelOfDetailTimerId)
+    {
+    this->LevelOfDetailTimerId = 0;
+    this->SetFiberBundlesLevelOfDetail(0);
+    this->RequestRender();
+    }
+}
+
+//---------------------------------------------------------------------------
+void vtkMRMLTractographyDisplayDisplayableManager::SetFiberBundlesLevelOfDetail(int level)
+{
+  vtkMRMLScene* scene = this->GetMRMLScene();
+  if (!scene)
+    {
+    return;
+    }
+  // the lines, tubes and glyphs all have a level of detail
+  const char* displayNodeClasses[] = {"vtkMRMLFiberBundleLineDisplayNode",
+                                      "vtkMRMLFiberBundleTubeDisplayNode",
+                                      "vtkMRMLFiberBundleGlyphDisplayNode"};
+  for (int c = 0; c < 3; ++c)
+    {
+    const int numberOfDisplayNodes = scene->GetNumberOfNodesByClass(displayNodeClasses[c]);
+    for (int i = 0; i < numberOfDisplayNodes; ++i)
+      {
+      vtkMRMLFiberBundleDisplayNode* displayNode = vtkMRMLFiberBundleDisplayNode::SafeDownCast(
+        scene->GetNthNodeByClass(i, displayNodeClasses[c]));
+      if (!displayNode || displayNode->GetLevelOfDetail() == level)
+        {
+        continue;
+        }
+      vtkPolyData* polyData = displayNode->GetInputPolyData();
+      if (level == 0 ||
+          (displayNode->GetVisibility() && polyData &&
+           polyData->GetNumberOfLines() > this->LevelOfDetailMinimumNumberOfFibers))
+        {
+        displayNode->SetLevelOfDetail(level);
+        }
+      }
+    }
+}
+
 //---------------------------------------------------------------------------
 void vtkMRMLTractographyDisplayDisplayableManager::ClearSelectedFibers()
 {
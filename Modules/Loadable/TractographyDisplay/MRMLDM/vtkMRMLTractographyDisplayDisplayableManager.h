@@ -45,6 +45,23 @@ public:
   vtkGetMacro(EnableFiberEdit, int);
   vtkSetMacro(EnableFiberEdit, int);
 
+  /// Level of detail of the fiber bundles during the camera interactions,
+  /// 2 (one fiber out of 4) by default. 0 disables the level of detail.
+  /// It applies to the line, tube and glyph display nodes alike.
+  /// \sa vtkMRMLFiberBundleDisplayNode::SetLevelOfDetail()
+  vtkSetClampMacro(InteractiveLevelOfDetail, int, 0, 16);
+  vtkGetMacro(InteractiveLevelOfDetail, int);
+
+  /// Only the fiber bundles with more fibers are displayed with the
+  /// interactive level of detail, 10000 by default.
+  vtkSetMacro(LevelOfDetailMinimumNumberOfFibers, vtkIdType);
+  vtkGetMacro(LevelOfDetailMinimumNumberOfFibers, vtkIdType);
+
+  /// Time in ms without camera interaction after which the fiber bundles
+  /// are displayed in full detail again, 300 by default.
+  vtkSetMacro(LevelOfDetailIdleDelay, int);
+  vtkGetMacro(LevelOfDetailIdleDelay, int);
+
 protected:
   vtkMRMLTractographyDisplayDisplayableManager();
   ~vtkMRMLTractographyDisplayDisplayableManager();
@@ -57,6 +74,11 @@ protected:
   virtual void ProcessMRMLNodesEvents(vtkObject *caller, unsigned long event, void *callData);
 
   virtual void OnInteractorStyleEvent(int eventId);
+  virtual void OnInteractorEvent(int eventId);
+
+  /// Set the level of detail of the displayed fiber bundles, only the
+  /// bundles with enough fibers are lowered.
+  void SetFiberBundlesLevelOfDetail(int level);
 
   vtkMRMLFiberBundleNode* GetPickedFiber(vtkMRMLFiberBundleDisplayNode* displayNode,
                                                          vtkIdType pickedCell, vtkIdType &cellID);
@@ -68,6 +90,11 @@ protected:
 protected:
   
   int EnableFiberEdit;
+  int InteractiveLevelOfDetail;
+  vtkIdType LevelOfDetailMinimumNumberOfFibers;
+  int LevelOfDetailIdleDelay;
+  /// Timer that restores the full detail, 0 if none
+  int LevelOfDetailTimerId;
   vtkMRMLFiberBundleNode* SelectedFiberBundleNode;
   std::map <vtkIdType, std::vector<double> > SelectedCells;
 };
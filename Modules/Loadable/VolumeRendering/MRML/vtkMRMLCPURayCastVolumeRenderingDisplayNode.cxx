@@ -34,6 +34,8 @@ vtkMRMLNodeNewMacro(vtkMRMLCPURayCastVolumeRenderingDisplayNode);
 vtkMRMLCPURayCastVolumeRenderingDisplayNode::vtkMRMLCPURayCastVolumeRenderingDisplayNode()
 {
   this->RaycastTechnique = vtkMRMLCPURayCastVolumeRenderingDisplayNode::Composite;
+  this->ProgressiveRendering = 0;
+  this->PreIntegration = 0;
 }
 
 //----------------------------------------------------------------------------
@@ -59,6 +61,20 @@ void vtkMRMLCPURayCastVolumeRenderingDisplayNode::ReadXMLAttributes(const char**
       ss >> this->RaycastTechnique;
       continue;
       }
+    if (!strcmp(attName,"progressiveRendering"))
+      {
+      std::stringstream ss;
+      ss << attValue;
+      ss >> this->ProgressiveRendering;
+      continue;
+      }
+    if (!strcmp(attName,"preIntegration"))
+      {
+      std::stringstream ss;
+      ss << attValue;
+      ss >> this->PreIntegration;
+      continue;
+      }
     }
 }
 
@@ -70,6 +86,8 @@ void vtkMRMLCPURayCastVolumeRenderingDisplayNode::WriteXML(ostream& of, int nInd
   vtkIndent indent(nIndent);
 
   of << indent << " raycastTechnique=\"" << this->RaycastTechnique << "\"";
+  of << indent << " progressiveRendering=\"" << this->ProgressiveRendering << "\"";
+  of << indent << " preIntegration=\"" << this->PreIntegration << "\"";
 }
 
 //----------------------------------------------------------------------------
@@ -80,6 +98,8 @@ void vtkMRMLCPURayCastVolumeRenderingDisplayNode::Copy(vtkMRMLNode *anode)
   vtkMRMLCPURayCastVolumeRenderingDisplayNode *node = vtkMRMLCPURayCastVolumeRenderingDisplayNode::SafeDownCast(anode);
 
   this->SetRaycastTechnique(node->GetRaycastTechnique());
+  this->SetProgressiveRendering(node->GetProgressiveRendering());
+  this->SetPreIntegration(node->GetPreIntegration());
 
   this->EndModify(wasModifying);
 }
@@ -90,4 +110,6 @@ void vtkMRMLCPURayCastVolumeRenderingDisplayNode::PrintSelf(ostream& os, vtkInde
   this->Superclass::PrintSelf(os,indent);
 
   os << "RaycastTechnique: " << this->RaycastTechnique << "\n";
+  os << "ProgressiveRendering: " << this->ProgressiveRendering << "\n";
+  os << "PreIntegration: " << this->PreIntegration << "\n";
 }
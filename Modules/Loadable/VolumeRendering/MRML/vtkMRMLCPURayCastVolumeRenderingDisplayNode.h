@@ -56,6 +56,23 @@ public:
   vtkGetMacro (RaycastTechnique, int);
   vtkSetMacro (RaycastTechnique, int);
 
+  /// Progressive rendering: when the camera stops, a coarse image is
+  /// rendered first and refined in passes of higher image resolution and
+  /// finer sampling until full quality. A pass is aborted as soon as the
+  /// camera moves again. Off by default.
+  vtkGetMacro (ProgressiveRendering, int);
+  vtkSetMacro (ProgressiveRendering, int);
+  vtkBooleanMacro (ProgressiveRendering, int);
+
+  /// Preintegration: the color and opacity of each ray segment are looked
+  /// up in a table integrated over the scalars between its two samples,
+  /// which removes the slicing artifacts of sharp transfer functions at a
+  /// coarse sample distance. Only used by the composite technique of single
+  /// component volumes. Off by default.
+  vtkGetMacro (PreIntegration, int);
+  vtkSetMacro (PreIntegration, int);
+  vtkBooleanMacro (PreIntegration, int);
+
 protected:
   vtkMRMLCPURayCastVolumeRenderingDisplayNode();
   ~vtkMRMLCPURayCastVolumeRenderingDisplayNode();
@@ -71,6 +88,9 @@ protected:
    * 5: Illustrative Context Preserving Exploration
    * */
   int RaycastTechnique;
+
+  int ProgressiveRendering;
+  int PreIntegration;
 };
 
 #endif
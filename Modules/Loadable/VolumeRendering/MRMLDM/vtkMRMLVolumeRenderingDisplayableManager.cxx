@@ -51,7 +51,6 @@
 // VTK includes
 #include <vtkAbstractTransform.h>
 #include <vtkCallbackCommand.h>
-#include "vtkFixedPointVolumeRayCastMapper.h"
 #include "vtkGPUVolumeRayCastMapper.h"
 #include "vtkImageData.h"
 #include "vtkInteractorStyle.h"
@@ -119,6 +118,13 @@ vtkMRMLVolumeRenderingDisplayableManager::vtkMRMLVolumeRenderingDisplayableManag
   // 0fps is a special value that means it hasn't been set.
   this->OriginalDesiredUpdateRate = 0.;
 
+  this->ProgressiveRenderingNumberOfPasses = 3;
+  this->ProgressiveRenderingDelay = 20;
+  this->ProgressivePass = -1;
+  this->ProgressivePassAborted = false;
+  this->ProgressiveTimerId = 0;
+  this->AbortCheckObserverTag = 0;
+
   this->RemoveInteractorStyleObservableEvent(vtkCommand::LeftButtonPressEvent);
   this->RemoveInteractorStyleObservableEvent(vtkCommand::LeftButtonReleaseEvent);
   this->RemoveInteractorStyleObservableEvent(vtkCommand::RightButtonPressEvent);
@@ -131,6 +137,7 @@ vtkMRMLVolumeRenderingDisplayableManager::vtkMRMLVolumeRenderingDisplayableManag
   this->RemoveInteractorStyleObservableEvent(vtkCommand::LeaveEvent);
   this->AddInteractorStyleObservableEvent(vtkCommand::StartInteractionEvent);
   this->AddInteractorStyleObservableEvent(vtkCommand::EndInteractionEvent);
+  this->AddInteractorObservableEvent(vtkCommand::TimerEvent);
 }
 
 //---------------------------------------------------------------------------
@@ -138,6 +145,15 @@ vtkMRMLVolumeRenderingDisplayableManager::~vtkMRMLVolumeRenderingDisplayableMana
 {
   this->RemoveDisplayNodes();
 
+  if (this->ProgressiveTimerId && this->GetInteractor())
+    {
+    this->GetInteractor()->DestroyTimer(this->ProgressiveTimerId);
+    }
+  if (this->AbortCheckRenderWindow)
+    {
+    this->AbortCheckRenderWindow->RemoveObserver(this->AbortCheckObserverTag);
+    }
+
   if (this->VolumeRenderingLogic)
   {
     this->VolumeRenderingLogic->Delete();
@@ -221,7 +237,7 @@ void vtkMRMLVolumeRenderingDisplayableManager::Reset()
   //mapperEventsWithProgress->InsertNextValue(vtkCommand::ProgressEvent);
 
   // CPU mapper
-  vtkNew<vtkFixedPointVolumeRayCastMapper> newMapperRaycast;
+  vtkNew<vtkSlicerFixedPointVolumeRayCastMapper> newMapperRaycast;
   vtkSetAndObserveMRMLNodeEventsMacro(this->MapperRaycast,
                                       newMapperRaycast.GetPointer(),
                                       mapperEventsWithProgress.GetPointer());
@@ -524,16 +540,31 @@ void vtkMRMLVolumeRenderingDisplayableManager
 //---------------------------------------------------------------------------
 void vtkMRMLVolumeRenderingDisplayableManager
 ::UpdateCPURaycastMapper(
-  vtkFixedPointVolumeRayCastMapper* mapper,
+  vtkSlicerFixedPointVolumeRayCastMapper* mapper,
   vtkMRMLCPURayCastVolumeRenderingDisplayNode* vspNode)
 {
   this->UpdateMapper(mapper, vspNode);
   const bool highDef = vspNode->GetPerformanceControl() ==
     vtkMRMLVolumeRenderingDisplayNode::MaximumQuality;
-  mapper->SetAutoAdjustSampleDistances( highDef ? 0 : 1);
-  mapper->SetSampleDistance(this->GetSampleDistance(vspNode));
-  mapper->SetInteractiveSampleDistance(this->GetSampleDistance(vspNode));
-  mapper->SetImageSampleDistance(highDef ? 0.5 : 1.);
+  double sampleDistance = this->GetSampleDistance(vspNode);
+  double imageSampleDistance = highDef ? 0.5 : 1.;
+  const bool progressive =
+    this->ProgressivePass >= 0 && vspNode->GetProgressiveRendering();
+  if (progressive)
+    {
+    // Each pass halves the distances of the previous one, the last pass
+    // uses the regular distances. The distances are fixed so that the first
+    // pass is always fast, whatever the allocated render time.
+    const double coarseness = 1 << std::max(0,
+      this->ProgressiveRenderingNumberOfPasses - 1 - this->ProgressivePass);
+    sampleDistance *= coarseness;
+    imageSampleDistance *= coarseness;
+    }
+  mapper->SetAutoAdjustSampleDistances((highDef || progressive) ? 0 : 1);
+  mapper->SetSampleDistance(sampleDistance);
+  mapper->SetInteractiveSampleDistance(sampleDistance);
+  mapper->SetImageSampleDistance(imageSampleDistance);
+  mapper->SetPreIntegration(vspNode->GetPreIntegration());
 
   switch(vspNode->GetRaycastTechnique())
     {
@@ -655,7 +686,7 @@ int vtkMRMLVolumeRenderingDisplayableManager
                                               ->GetFgVolumeNode())->GetImageData());
     }
   int supported = 0;
-  if (volumeMapper->IsA("vtkFixedPointVolumeRayCastMapper"))
+  if (volumeMapper->IsA("vtkSlicerFixedPointVolumeRayCastMapper"))
     {
     supported = 1;
     }
@@ -808,7 +839,7 @@ bool vtkMRMLVolumeRenderingDisplayableManager::UpdateMapper(
   vtkVolumeMapper* volumeMapper = this->GetVolumeMapper(vspNode);
   if (vspNode->IsA("vtkMRMLCPURayCastVolumeRenderingDisplayNode"))
     {
-    this->UpdateCPURaycastMapper(vtkFixedPointVolumeRayCastMapper::SafeDownCast(volumeMapper),
+    this->UpdateCPURaycastMapper(vtkSlicerFixedPointVolumeRayCastMapper::SafeDownCast(volumeMapper),
                                  vtkMRMLCPURayCastVolumeRenderingDisplayNode::SafeDownCast(vspNode));
     }
   else if (vspNode->IsA("vtkMRMLNCIRayCastVolumeRenderingDisplayNode"))
@@ -1127,6 +1158,9 @@ void vtkMRMLVolumeRenderingDisplayableManager::OnVolumeRenderingDisplayNodeModif
     }
   bool wasVolumeVisible = this->IsVolumeInView();
 
+  // Any change (e.g. transfer function) is first rendered coarse
+  this->StartProgressiveRendering(dnode);
+
   this->UpdatePipelineFromDisplayNode(dnode);
 
   bool hasVolumeBeenRemoved = !this->IsVolumeInView() && wasVolumeVisible;
@@ -1135,6 +1169,10 @@ void vtkMRMLVolumeRenderingDisplayableManager::OnVolumeRenderingDisplayNodeModif
     {
     this->RequestRender();
     }
+  if (this->Interaction == 0 && dnode->GetVisibility())
+    {
+    this->ScheduleProgressiveRenderingPass();
+    }
 }
 
 //----------------------------------------------------------------------------
@@ -1362,8 +1400,12 @@ void vtkMRMLVolumeRenderingDisplayableManager::OnInteractorStyleEvent(int eventi
     case vtkCommand::EndInteractionEvent:
       //this->SetExpectedFPS(0.0001);
       this->SetupMapperFromParametersNode(this->DisplayedNode);
+      // The camera stops with a coarse image, refine it while it is still
+      this->ScheduleProgressiveRenderingPass();
       break;
     case vtkCommand::StartInteractionEvent:
+      // The camera moves, cancel the refinement and render coarse images
+      this->StartProgressiveRendering(this->DisplayedNode);
       this->SetupMapperFromParametersNode(this->DisplayedNode);
       //this->SetExpectedFPS(
       //  this->DisplayedNode ? this->DisplayedNode->GetExpectedFPS() : 15);
@@ -1374,6 +1416,122 @@ void vtkMRMLVolumeRenderingDisplayableManager::OnInteractorStyleEvent(int eventi
   this->Superclass::OnInteractorStyleEvent(eventid);
 }
 
+//----------------------------------------------------------------------------
+void vtkMRMLVolumeRenderingDisplayableManager::OnInteractorEvent(int eventid)
+{
+  if (eventid != vtkCommand::TimerEvent || !this->ProgressiveTimerId ||
+      this->GetInteractor()->GetTimerEventId() != this->ProgressiveTimerId)
+    {
+    return;
+    }
+  this->ProgressiveTimerId = 0;
+  if (this->ProgressivePass < 0 || this->Interaction > 0)
+    {
+    return;
+    }
+  // An aborted pass is rendered again, the camera did not move (otherwise
+  // StartInteractionEvent would have cancelled the timer), another event
+  // was pending.
+  if (!this->ProgressivePassAborted)
+    {
+    ++this->ProgressivePass;
+    }
+  this->ProgressivePassAborted = false;
+  if (this->ProgressivePass >= this->ProgressiveRenderingNumberOfPasses ||
+      !this->IsProgressiveRendering(this->DisplayedNode))
+    {
+    // The last pass has been fully rendered.
+    this->ProgressivePass = -1;
+    return;
+    }
+  this->SetupMapperFromParametersNode(this->DisplayedNode);
+  this->RequestRender();
+  // Wait for the pass to be rendered to know if it was aborted.
+  this->ScheduleProgressiveRenderingPass();
+}
+
+//----------------------------------------------------------------------------
+bool vtkMRMLVolumeRenderingDisplayableManager
+::IsProgressiveRendering(vtkMRMLVolumeRenderingDisplayNode* vspNode)
+{
+  vtkMRMLCPURayCastVolumeRenderingDisplayNode* cpuNode =
+    vtkMRMLCPURayCastVolumeRenderingDisplayNode::SafeDownCast(vspNode);
+  return cpuNode && cpuNode->GetProgressiveRendering() &&
+    this->ProgressiveRenderingNumberOfPasses > 1;
+}
+
+//----------------------------------------------------------------------------
+void vtkMRMLVolumeRenderingDisplayableManager
+::StartProgressiveRendering(vtkMRMLVolumeRenderingDisplayNode* vspNode)
+{
+  if (this->ProgressiveTimerId)
+    {
+    this->GetInteractor()->DestroyTimer(this->ProgressiveTimerId);
+    this->ProgressiveTimerId = 0;
+    }
+  this->ProgressivePassAborted = false;
+  if (!this->IsProgressiveRendering(vspNode))
+    {
+    this->ProgressivePass = -1;
+    return;
+    }
+  this->ProgressivePass = 0;
+
+  vtkRenderWindow* renderWindow =
+    this->GetRenderer() ? this->GetRenderer()->GetRenderWindow() : 0;
+  if (renderWindow && renderWindow != this->AbortCheckRenderWindow)
+    {
+    if (this->AbortCheckRenderWindow)
+      {
+      this->AbortCheckRenderWindow->RemoveObserver(this->AbortCheckObserverTag);
+      }
+    vtkNew<vtkCallbackCommand> abortCheckCommand;
+    abortCheckCommand->SetClientData(this);
+    abortCheckCommand->SetCallback(
+      vtkMRMLVolumeRenderingDisplayableManager::AbortCheckCallback);
+    this->AbortCheckObserverTag = renderWindow->AddObserver(
+      vtkCommand::AbortCheckEvent, abortCheckCommand.GetPointer());
+    this->AbortCheckRenderWindow = renderWindow;
+    }
+}
+
+//----------------------------------------------------------------------------
+void vtkMRMLVolumeRenderingDisplayableManager::ScheduleProgressiveRenderingPass()
+{
+  if (this->ProgressivePass < 0 || this->ProgressiveTimerId ||
+      !this->GetInteractor())
+    {
+    return;
+    }
+  this->ProgressiveTimerId =
+    this->GetInteractor()->CreateOneShotTimer(this->ProgressiveRenderingDelay);
+  if (!this->ProgressiveTimerId)
+    {
+    // No timer support, render at full quality right away.
+    this->ProgressivePass = -1;
+    this->SetupMapperFromParametersNode(this->DisplayedNode);
+    this->RequestRender();
+    }
+}
+
+//----------------------------------------------------------------------------
+void vtkMRMLVolumeRenderingDisplayableManager::AbortCheckCallback(
+  vtkObject* caller, unsigned long vtkNotUsed(eid),
+  void* clientData, void* vtkNotUsed(callData))
+{
+  vtkMRMLVolumeRenderingDisplayableManager* self =
+    reinterpret_cast<vtkMRMLVolumeRenderingDisplayableManager*>(clientData);
+  vtkRenderWindow* renderWindow = vtkRenderWindow::SafeDownCast(caller);
+  // The first pass is never aborted, there would be nothing to show.
+  if (self->ProgressivePass > 0 && renderWindow &&
+      renderWindow->GetEventPending())
+    {
+    // The previous (coarser) image stays displayed.
+    renderWindow->SetAbortRender(1);
+    self->ProgressivePassAborted = true;
+    }
+}
+
 //----------------------------------------------------------------------------
 int vtkMRMLVolumeRenderingDisplayableManager::ValidateDisplayNode(vtkMRMLVolumeRenderingDisplayNode* vspNode)
 {
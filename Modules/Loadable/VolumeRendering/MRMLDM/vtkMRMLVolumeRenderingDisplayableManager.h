@@ -24,7 +24,6 @@
 // VolumeRendering includes
 #include "vtkSlicerVolumeRenderingModuleMRMLDisplayableManagerExport.h"
 class vtkGPUVolumeRayCastMapper;
-class vtkFixedPointVolumeRayCastMapper;
 class vtkMRMLCPURayCastVolumeRenderingDisplayNode;
 class vtkMRMLGPUTextureMappingVolumeRenderingDisplayNode;
 class vtkMRMLGPURayCastVolumeRenderingDisplayNode;
@@ -33,6 +32,7 @@ class vtkMRMLNCIMultiVolumeRayCastVolumeRenderingDisplayNode;
 class vtkMRMLVolumeNode;
 class vtkMRMLVolumeRenderingDisplayNode;
 class vtkMRMLVolumeRenderingScenarioNode;
+class vtkSlicerFixedPointVolumeRayCastMapper;
 class vtkSlicerVolumeRenderingLogic;
 class vtkSlicerVolumeTextureMapper3D;
 class vtkSlicerGPURayCastVolumeMapper;
@@ -43,9 +43,12 @@ class vtkVolumeProperty;
 #include <vtkMRMLAbstractThreeDViewDisplayableManager.h>
 
 // VTK includes
+#include <vtkWeakPointer.h>
 class vtkIntArray;
 class vtkMatrix4x4;
+class vtkObject;
 class vtkPlanes;
+class vtkRenderWindow;
 class vtkTimerLog;
 class vtkVolume;
 class vtkVolumeMapper;
@@ -104,7 +107,7 @@ public:
 
   void UpdateMapper(vtkVolumeMapper* mapper,
                     vtkMRMLVolumeRenderingDisplayNode* vspNode);
-  void UpdateCPURaycastMapper(vtkFixedPointVolumeRayCastMapper* mapper,
+  void UpdateCPURaycastMapper(vtkSlicerFixedPointVolumeRayCastMapper* mapper,
                               vtkMRMLCPURayCastVolumeRenderingDisplayNode* vspNode);
   void UpdateNCIRaycastMapper(vtkSlicerGPURayCastVolumeMapper* mapper,
                               vtkMRMLNCIRayCastVolumeRenderingDisplayNode* vspNode);
@@ -151,6 +154,24 @@ public:
 
   static int DefaultGPUMemorySize;
 
+  /// Number of passes of the progressive rendering of the CPU ray cast
+  /// mapper, 3 by default. Each pass halves the image and sample distances
+  /// of the previous one, the last pass uses the display node settings.
+  /// \sa vtkMRMLCPURayCastVolumeRenderingDisplayNode::SetProgressiveRendering()
+  vtkSetClampMacro(ProgressiveRenderingNumberOfPasses, int, 1, 8);
+  vtkGetMacro(ProgressiveRenderingNumberOfPasses, int);
+
+  /// Time in ms between the end of a progressive rendering pass and the
+  /// start of the next one, 20 by default. It leaves time to the event loop
+  /// to notice that the camera moves before starting a longer pass.
+  vtkSetMacro(ProgressiveRenderingDelay, int);
+  vtkGetMacro(ProgressiveRenderingDelay, int);
+
+  /// Current progressive rendering pass, from 0 (the coarsest) to
+  /// ProgressiveRenderingNumberOfPasses - 1, or -1 if the volume is not
+  /// being refined.
+  vtkGetMacro(ProgressivePass, int);
+
 protected:
   vtkMRMLVolumeRenderingDisplayableManager();
   ~vtkMRMLVolumeRenderingDisplayableManager();
@@ -170,6 +191,18 @@ protected:
                                  void * callData);
 
   virtual void OnInteractorStyleEvent(int eventId);
+  virtual void OnInteractorEvent(int eventId);
+
+  /// Return true if the display node is rendered progressively.
+  bool IsProgressiveRendering(vtkMRMLVolumeRenderingDisplayNode* vspNode);
+  /// Go back to the first (coarsest) progressive rendering pass and cancel
+  /// the scheduled refinement if any.
+  void StartProgressiveRendering(vtkMRMLVolumeRenderingDisplayNode* vspNode);
+  /// Start a timer for the next progressive rendering pass.
+  void ScheduleProgressiveRenderingPass();
+  /// Abort the refinement passes when events (e.g. camera moves) are pending.
+  static void AbortCheckCallback(vtkObject* caller, unsigned long eid,
+                                 void* clientData, void* callData);
 
   //virtual void OnMRMLSceneNodeAdded(vtkMRMLNode* node);
 
@@ -194,7 +227,7 @@ protected:
 
   // Description:
   // The software accelerated software mapper
-  vtkFixedPointVolumeRayCastMapper *MapperRaycast;
+  vtkSlicerFixedPointVolumeRayCastMapper *MapperRaycast;
 
   // Description:
   // The gpu ray cast mapper.
@@ -230,6 +263,17 @@ protected:
   int Interaction;
   double OriginalDesiredUpdateRate;
 
+  int ProgressiveRenderingNumberOfPasses;
+  int ProgressiveRenderingDelay;
+  /// Current progressive rendering pass, -1 if not rendering progressively
+  int ProgressivePass;
+  /// True if the current pass was aborted and must be rendered again
+  bool ProgressivePassAborted;
+  /// Timer that starts the next pass, 0 if none
+  int ProgressiveTimerId;
+  vtkWeakPointer<vtkRenderWindow> AbortCheckRenderWindow;
+  unsigned long AbortCheckObserverTag;
+
 protected:
   void OnScenarioNodeModified();
   void OnVolumeRenderingDisplayNodeModified(vtkMRMLVolumeRenderingDisplayNode* dnode);
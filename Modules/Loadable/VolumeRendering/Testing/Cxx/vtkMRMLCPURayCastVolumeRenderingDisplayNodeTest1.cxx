@@ -0,0 +1,146 @@
+/*=auto=========================================================================
+
+  Portions (c) Copyright 2005 Brigham and Women's Hospital (BWH)
+  All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Program:   3D Slicer
+
+=========================================================================auto=*/
+
+// Volume Rendering includes
+#include "vtkMRMLCPURayCastVolumeRenderingDisplayNode.h"
+
+// MRML includes
+#include <vtkMRMLCoreTestingMacros.h>
+#include <vtkMRMLScene.h>
+
+// VTK includes
+#include <vtkNew.h>
+
+namespace
+{
+int basics();
+bool readWrite();
+bool copy();
+}
+
+//---------------------------------------------------------------------------
+int vtkMRMLCPURayCastVolumeRenderingDisplayNodeTest1(int , char * [] )
+{
+  bool res = true;
+  res = (basics() == EXIT_SUCCESS) && res;
+  res = readWrite() && res;
+  res = copy() && res;
+
+  return res ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+namespace
+{
+
+//---------------------------------------------------------------------------
+int basics()
+{
+  vtkSmartPointer< vtkMRMLCPURayCastVolumeRenderingDisplayNode > node1 =
+    vtkSmartPointer< vtkMRMLCPURayCastVolumeRenderingDisplayNode >::New();
+
+  EXERCISE_BASIC_OBJECT_METHODS( node1 );
+  EXERCISE_BASIC_MRML_METHODS(vtkMRMLCPURayCastVolumeRenderingDisplayNode, node1);
+
+  if (node1->GetProgressiveRendering() != 0)
+    {
+    std::cerr << __FUNCTION__ << ":" << __LINE__ << " failed:" << std::endl
+              << "  Progressive rendering is not off by default." << std::endl;
+    return EXIT_FAILURE;
+    }
+  if (node1->GetPreIntegration() != 0)
+    {
+    std::cerr << __FUNCTION__ << ":" << __LINE__ << " failed:" << std::endl
+              << "  Preintegration is not off by default." << std::endl;
+    return EXIT_FAILURE;
+    }
+  return EXIT_SUCCESS;
+}
+
+//---------------------------------------------------------------------------
+bool readWrite()
+{
+  vtkNew<vtkMRMLScene> scene;
+  vtkNew<vtkMRMLCPURayCastVolumeRenderingDisplayNode> displayNode;
+  scene->RegisterNodeClass(displayNode.GetPointer());
+
+  displayNode->SetProgressiveRendering(1);
+  displayNode->SetPreIntegration(1);
+  displayNode->SetRaycastTechnique(
+    vtkMRMLVolumeRenderingDisplayNode::MaximumIntensityProjection);
+  scene->AddNode(displayNode.GetPointer());
+
+  scene->SetSaveToXMLString(1);
+  scene->Commit();
+  std::string sceneXML = scene->GetSceneXMLString();
+
+  vtkNew<vtkMRMLScene> scene2;
+  scene2->RegisterNodeClass(displayNode.GetPointer());
+  scene2->SetLoadFromXMLString(1);
+  scene2->SetSceneXMLString(sceneXML);
+  scene2->Import();
+
+  vtkMRMLCPURayCastVolumeRenderingDisplayNode* displayNode2 =
+    vtkMRMLCPURayCastVolumeRenderingDisplayNode::SafeDownCast(
+      scene2->GetNthNodeByClass(0, "vtkMRMLCPURayCastVolumeRenderingDisplayNode"));
+  if (!displayNode2)
+    {
+    std::cout << __FUNCTION__ << ":" << __LINE__ << " failed:" << std::endl
+              << "  No CPU ray cast display node found in the loaded scene."
+              << std::endl;
+    return false;
+    }
+  if (displayNode2->GetProgressiveRendering() != 1 ||
+      displayNode2->GetPreIntegration() != 1 ||
+      displayNode2->GetRaycastTechnique() !=
+        vtkMRMLVolumeRenderingDisplayNode::MaximumIntensityProjection)
+    {
+    std::cout << __FUNCTION__ << ":" << __LINE__ << " failed:" << std::endl
+              << "  Wrong loaded progressive rendering "
+              << displayNode2->GetProgressiveRendering() << ", preintegration "
+              << displayNode2->GetPreIntegration() << " or technique "
+              << displayNode2->GetRaycastTechnique() << std::endl;
+    return false;
+    }
+  return true;
+}
+
+//---------------------------------------------------------------------------
+bool copy()
+{
+  vtkNew<vtkMRMLCPURayCastVolumeRenderingDisplayNode> displayNode;
+  displayNode->SetProgressiveRendering(1);
+  displayNode->SetPreIntegration(1);
+  vtkNew<vtkMRMLCPURayCastVolumeRenderingDisplayNode> displayNode2;
+  displayNode2->Copy(displayNode.GetPointer());
+  if (displayNode2->GetProgressiveRendering() != 1 ||
+      displayNode2->GetPreIntegration() != 1)
+    {
+    std::cout << __FUNCTION__ << ":" << __LINE__ << " failed:" << std::endl
+              << "  Progressive rendering or preintegration is not copied."
+              << std::endl;
+    return false;
+    }
+  displayNode->SetProgressiveRendering(0);
+  displayNode->SetPreIntegration(0);
+  displayNode2->Copy(displayNode.GetPointer());
+  if (displayNode2->GetProgressiveRendering() != 0 ||
+      displayNode2->GetPreIntegration() != 0)
+    {
+    std::cout << __FUNCTION__ << ":" << __LINE__ << " failed:" << std::endl
+              << "  Progressive rendering or preintegration is not copied back."
+              << std::endl;
+    return false;
+    }
+  return true;
+}
+
+}
@@ -0,0 +1,231 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+// VolumeRendering includes
+#include <vtkMRMLCPURayCastVolumeRenderingDisplayNode.h>
+#include <vtkMRMLVolumeRenderingDisplayableManager.h>
+
+// MRMLDisplayableManager includes
+#include <vtkMRMLDisplayableManagerGroup.h>
+#include <vtkThreeDViewInteractorStyle.h>
+
+// MRMLLogic includes
+#include <vtkMRMLApplicationLogic.h>
+
+// MRML includes
+#include <vtkMRMLScene.h>
+#include <vtkMRMLScalarVolumeNode.h>
+#include <vtkMRMLViewNode.h>
+#include <vtkMRMLVolumePropertyNode.h>
+
+// VTK includes
+#include <vtkCommand.h>
+#include <vtkImageData.h>
+#include <vtkNew.h>
+#include <vtkObjectFactory.h>
+#include <vtkRenderer.h>
+#include <vtkRenderWindow.h>
+#include <vtkRenderWindowInteractor.h>
+
+// STD includes
+#include <cstdlib>
+#include <iostream>
+
+namespace
+{
+
+//----------------------------------------------------------------------------
+// Interactor whose timers only fire on request, so that the progressive
+// rendering passes can be stepped through.
+class vtkTestTimerInteractor : public vtkRenderWindowInteractor
+{
+public:
+  static vtkTestTimerInteractor* New();
+  vtkTypeMacro(vtkTestTimerInteractor, vtkRenderWindowInteractor);
+
+  // The last created timer, 0 if it has been destroyed.
+  int PendingTimerId;
+
+  void FireTimer(int timerId)
+  {
+    this->SetTimerEventId(timerId);
+    this->InvokeEvent(vtkCommand::TimerEvent, &timerId);
+  }
+
+protected:
+  vtkTestTimerInteractor() : PendingTimerId(0) {}
+
+  virtual int InternalCreateTimer(int timerId, int vtkNotUsed(timerType),
+                                  unsigned long vtkNotUsed(duration))
+  {
+    this->PendingTimerId = timerId;
+    return 1;
+  }
+  virtual int InternalDestroyTimer(int vtkNotUsed(platformTimerId))
+  {
+    this->PendingTimerId = 0;
+    return 1;
+  }
+};
+
+vtkStandardNewMacro(vtkTestTimerInteractor);
+
+//----------------------------------------------------------------------------
+bool checkPass(vtkMRMLVolumeRenderingDisplayableManager* displayableManager,
+               int expectedPass, int line)
+{
+  if (displayableManager->GetProgressivePass() != expectedPass)
+    {
+    std::cerr << "Line " << line << ": pass "
+              << displayableManager->GetProgressivePass()
+              << " instead of " << expectedPass << std::endl;
+    return false;
+    }
+  return true;
+}
+
+} // end of anonymous namespace
+
+//----------------------------------------------------------------------------
+int vtkMRMLVolumeRenderingProgressiveRenderingTest(int vtkNotUsed(argc),
+                                                   char* vtkNotUsed(argv)[])
+{
+  // Renderer, RenderWindow and Interactor
+  vtkNew<vtkRenderer> renderer;
+  vtkNew<vtkRenderWindow> renderWindow;
+  vtkNew<vtkTestTimerInteractor> interactor;
+  renderWindow->SetSize(100, 100);
+  renderWindow->SetMultiSamples(0);
+  renderWindow->AddRenderer(renderer.GetPointer());
+  renderWindow->SetInteractor(interactor.GetPointer());
+  vtkNew<vtkThreeDViewInteractorStyle> interactorStyle;
+  interactor->SetInteractorStyle(interactorStyle.GetPointer());
+
+  // MRML scene
+  vtkNew<vtkMRMLScene> scene;
+  vtkNew<vtkMRMLApplicationLogic> applicationLogic;
+  applicationLogic->SetMRMLScene(scene.GetPointer());
+
+  vtkNew<vtkMRMLViewNode> viewNode;
+  scene->AddNode(viewNode.GetPointer());
+
+  vtkNew<vtkMRMLDisplayableManagerGroup> displayableManagerGroup;
+  displayableManagerGroup->SetRenderer(renderer.GetPointer());
+  displayableManagerGroup->SetMRMLDisplayableNode(viewNode.GetPointer());
+
+  vtkNew<vtkMRMLVolumeRenderingDisplayableManager> vrDisplayableManager;
+  vrDisplayableManager->SetMRMLApplicationLogic(applicationLogic.GetPointer());
+  displayableManagerGroup->AddDisplayableManager(vrDisplayableManager.GetPointer());
+  interactor->Initialize();
+
+  vtkNew<vtkImageData> imageData;
+  imageData->SetDimensions(8, 8, 8);
+  imageData->SetScalarTypeToUnsignedChar();
+  imageData->SetNumberOfScalarComponents(1);
+  imageData->AllocateScalars();
+  vtkNew<vtkMRMLScalarVolumeNode> volumeNode;
+  volumeNode->SetAndObserveImageData(imageData.GetPointer());
+  scene->AddNode(volumeNode.GetPointer());
+
+  vtkNew<vtkMRMLVolumePropertyNode> volumePropertyNode;
+  scene->AddNode(volumePropertyNode.GetPointer());
+
+  vtkNew<vtkMRMLCPURayCastVolumeRenderingDisplayNode> vrDisplayNode;
+  vrDisplayNode->SetAndObserveVolumeNodeID(volumeNode->GetID());
+  vrDisplayNode->SetAndObserveVolumePropertyNodeID(volumePropertyNode->GetID());
+  vrDisplayNode->SetProgressiveRendering(1);
+  vrDisplayNode->SetVisibility(1);
+  scene->AddNode(vrDisplayNode.GetPointer());
+
+  // The new volume is first rendered coarse, and a refinement is scheduled
+  const int numberOfPasses = vrDisplayableManager->GetProgressiveRenderingNumberOfPasses();
+  if (numberOfPasses < 2 ||
+      !checkPass(vrDisplayableManager.GetPointer(), 0, __LINE__) ||
+      !interactor->PendingTimerId)
+    {
+    std::cerr << "Line " << __LINE__ << ": no refinement scheduled" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // Each timer renders the next pass, until the last one
+  for (int pass = 1; pass < numberOfPasses; ++pass)
+    {
+    int timerId = interactor->PendingTimerId;
+    interactor->FireTimer(timerId);
+    if (!checkPass(vrDisplayableManager.GetPointer(), pass, __LINE__) ||
+        !interactor->PendingTimerId || interactor->PendingTimerId == timerId)
+      {
+      return EXIT_FAILURE;
+      }
+    }
+  interactor->FireTimer(interactor->PendingTimerId);
+  if (!checkPass(vrDisplayableManager.GetPointer(), -1, __LINE__))
+    {
+    return EXIT_FAILURE;
+    }
+
+  // A modified display node is rendered coarse and refined again
+  vrDisplayNode->Modified();
+  if (!checkPass(vrDisplayableManager.GetPointer(), 0, __LINE__))
+    {
+    return EXIT_FAILURE;
+    }
+  int timerId = interactor->PendingTimerId;
+  interactor->FireTimer(timerId);
+  if (!checkPass(vrDisplayableManager.GetPointer(), 1, __LINE__))
+    {
+    return EXIT_FAILURE;
+    }
+
+  // A camera move goes back to the coarsest pass and cancels the scheduled
+  // refinement.
+  timerId = interactor->PendingTimerId;
+  interactorStyle->InvokeEvent(vtkCommand::StartInteractionEvent);
+  if (!checkPass(vrDisplayableManager.GetPointer(), 0, __LINE__) ||
+      interactor->PendingTimerId != 0)
+    {
+    std::cerr << "Line " << __LINE__ << ": refinement not cancelled" << std::endl;
+    return EXIT_FAILURE;
+    }
+  // A late event of the cancelled timer is ignored
+  interactor->FireTimer(timerId);
+  if (!checkPass(vrDisplayableManager.GetPointer(), 0, __LINE__))
+    {
+    return EXIT_FAILURE;
+    }
+  // The refinement starts again when the camera stops
+  interactorStyle->InvokeEvent(vtkCommand::EndInteractionEvent);
+  if (!interactor->PendingTimerId)
+    {
+    std::cerr << "Line " << __LINE__ << ": no refinement scheduled" << std::endl;
+    return EXIT_FAILURE;
+    }
+  interactor->FireTimer(interactor->PendingTimerId);
+  if (!checkPass(vrDisplayableManager.GetPointer(), 1, __LINE__))
+    {
+    return EXIT_FAILURE;
+    }
+
+  // Without progressive rendering, there is no pass
+  vrDisplayNode->SetProgressiveRendering(0);
+  if (!checkPass(vrDisplayableManager.GetPointer(), -1, __LINE__) ||
+      interactor->PendingTimerId != 0)
+    {
+    return EXIT_FAILURE;
+    }
+
+  vrDisplayableManager->SetMRMLApplicationLogic(0);
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,89 @@
+/*=auto=========================================================================
+
+  Portions (c) Copyright 2005 Brigham and Women's Hospital (BWH)
+  All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Program:   3D Slicer
+
+=========================================================================auto=*/
+
+// Volume Rendering includes
+#include "vtkSlicerFixedPointGradientCache.h"
+
+// VTK includes
+#include <vtkImageData.h>
+#include <vtkNew.h>
+#include <vtkSphericalDirectionEncoder.h>
+
+// STD includes
+#include <cstdlib>
+#include <iostream>
+
+//---------------------------------------------------------------------------
+int vtkSlicerFixedPointGradientCacheTest1(int , char * [] )
+{
+  vtkNew<vtkSlicerFixedPointGradientCache> cache;
+  vtkNew<vtkSphericalDirectionEncoder> encoder;
+  vtkNew<vtkImageData> image;
+  image->SetDimensions(8, 6, 4);
+  image->SetScalarTypeToShort();
+  image->SetNumberOfScalarComponents(1);
+  image->AllocateScalars();
+
+  int mapper1 = 0;
+  int mapper2 = 0;
+  int computed = 1;
+  vtkSlicerFixedPointGradientCache::Gradients* gradients1 =
+    cache->AcquireGradients(&mapper1, image.GetPointer(), 1,
+                            encoder.GetPointer(), computed);
+  if (!gradients1 || computed ||
+      gradients1->NumberOfSlices != 4 || gradients1->SliceSize != 8 * 6)
+    {
+    std::cerr << "Line " << __LINE__ << ": wrong new gradients" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // A second user of the same image shares the computed gradients
+  vtkSlicerFixedPointGradientCache::Gradients* gradients2 =
+    cache->AcquireGradients(&mapper2, image.GetPointer(), 0,
+                            encoder.GetPointer(), computed);
+  if (gradients2 != gradients1 || !computed ||
+      cache->GetNumberOfGradients() != 1)
+    {
+    std::cerr << "Line " << __LINE__ << ": gradients not shared" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // A modified image needs new gradients, the old ones are kept as long
+  // as they are used.
+  image->Modified();
+  gradients1 = cache->AcquireGradients(&mapper1, image.GetPointer(), 1,
+                                       encoder.GetPointer(), computed);
+  if (gradients1 == gradients2 || computed ||
+      cache->GetNumberOfGradients() != 2)
+    {
+    std::cerr << "Line " << __LINE__ << ": gradients not recomputed" << std::endl;
+    return EXIT_FAILURE;
+    }
+  gradients2 = cache->AcquireGradients(&mapper2, image.GetPointer(), 1,
+                                       encoder.GetPointer(), computed);
+  if (gradients2 != gradients1 || !computed ||
+      cache->GetNumberOfGradients() != 1)
+    {
+    std::cerr << "Line " << __LINE__ << ": old gradients not released" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  cache->ReleaseGradients(&mapper1);
+  cache->ReleaseGradients(&mapper2);
+  if (cache->GetNumberOfGradients() != 0)
+    {
+    std::cerr << "Line " << __LINE__ << ": gradients not released" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,168 @@
+/*=auto=========================================================================
+
+  Portions (c) Copyright 2005 Brigham and Women's Hospital (BWH)
+  All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Program:   3D Slicer
+
+=========================================================================auto=*/
+
+// Volume Rendering includes
+#include "vtkSlicerFixedPointGradientCache.h"
+#include "vtkSlicerFixedPointVolumeRayCastMapper.h"
+
+// VTK includes
+#include <vtkColorTransferFunction.h>
+#include <vtkImageData.h>
+#include <vtkNew.h>
+#include <vtkPiecewiseFunction.h>
+#include <vtkRenderer.h>
+#include <vtkRenderWindow.h>
+#include <vtkVolume.h>
+#include <vtkVolumeProperty.h>
+
+// STD includes
+#include <cstdlib>
+#include <iostream>
+
+namespace
+{
+
+const int Dimensions[3] = {19, 13, 11};
+
+//---------------------------------------------------------------------------
+// A small anisotropic volume with a ramp, noise and flat regions, so that
+// some inner voxels have no gradient at a distance of 1 and are computed
+// voxel by voxel by the vectorized rows too.
+void createVolume(vtkImageData* image)
+{
+  image->SetDimensions(Dimensions[0], Dimensions[1], Dimensions[2]);
+  image->SetSpacing(1., 1.5, 2.5);
+  image->SetScalarTypeToShort();
+  image->SetNumberOfScalarComponents(1);
+  image->AllocateScalars();
+  short* ptr = static_cast<short*>(image->GetScalarPointer());
+  unsigned int seed = 1;
+  for (int k = 0; k < Dimensions[2]; ++k)
+    {
+    for (int j = 0; j < Dimensions[1]; ++j)
+      {
+      for (int i = 0; i < Dimensions[0]; ++i)
+        {
+        seed = seed * 1103515245 + 12345;
+        short value = static_cast<short>(40 * i - 25 * j + 10 * k);
+        if (i > 12 && j > 4)
+          {
+          // flat
+          value = 300;
+          }
+        else if (k > 6)
+          {
+          value += static_cast<short>((seed >> 16) % 200) - 100;
+          }
+        *(ptr++) = value;
+        }
+      }
+    }
+}
+
+//---------------------------------------------------------------------------
+// Render the volume with shading so that its gradients are computed
+// by the mapper.
+void computeGradients(vtkSlicerFixedPointVolumeRayCastMapper* mapper,
+                      vtkImageData* image)
+{
+  mapper->SetInput(image);
+  vtkNew<vtkSlicerFixedPointGradientCache> cache;
+  mapper->SetGradientCache(cache.GetPointer());
+
+  vtkNew<vtkPiecewiseFunction> opacity;
+  opacity->AddPoint(-1000., 0.);
+  opacity->AddPoint(1000., 1.);
+  vtkNew<vtkColorTransferFunction> color;
+  color->AddRGBPoint(-1000., 1., 1., 1.);
+  vtkNew<vtkVolumeProperty> property;
+  property->SetScalarOpacity(opacity.GetPointer());
+  property->SetColor(color.GetPointer());
+  property->ShadeOn();
+  vtkNew<vtkVolume> volume;
+  volume->SetMapper(mapper);
+  volume->SetProperty(property.GetPointer());
+
+  vtkNew<vtkRenderer> renderer;
+  renderer->AddVolume(volume.GetPointer());
+  vtkNew<vtkRenderWindow> renderWindow;
+  renderWindow->SetSize(50, 50);
+  renderWindow->AddRenderer(renderer.GetPointer());
+  renderer->ResetCamera();
+  renderWindow->Render();
+}
+
+} // end of anonymous namespace
+
+//---------------------------------------------------------------------------
+int vtkSlicerFixedPointVolumeRayCastMapperGradientsTest(int , char * [] )
+{
+  vtkNew<vtkImageData> image;
+  createVolume(image.GetPointer());
+
+  // The reference: voxel by voxel in one thread
+  vtkNew<vtkSlicerFixedPointVolumeRayCastMapper> voxelMapper;
+  voxelMapper->VectorizedGradientsOff();
+  voxelMapper->SetNumberOfThreads(1);
+  computeGradients(voxelMapper.GetPointer(), image.GetPointer());
+
+  // Vectorized rows in slabs that don't divide the volume evenly
+  vtkNew<vtkSlicerFixedPointVolumeRayCastMapper> vectorizedMapper;
+  if (!vectorizedMapper->GetVectorizedGradients())
+    {
+    std::cerr << "Line " << __LINE__ << ": the gradients are not "
+              << "vectorized by default" << std::endl;
+    return EXIT_FAILURE;
+    }
+  vectorizedMapper->SetNumberOfThreads(3);
+  computeGradients(vectorizedMapper.GetPointer(), image.GetPointer());
+
+  unsigned short** voxelNormal = voxelMapper->GetGradientNormal();
+  unsigned char** voxelMagnitude = voxelMapper->GetGradientMagnitude();
+  unsigned short** normal = vectorizedMapper->GetGradientNormal();
+  unsigned char** magnitude = vectorizedMapper->GetGradientMagnitude();
+  if (!voxelNormal || !voxelMagnitude || !normal || !magnitude ||
+      normal == voxelNormal)
+    {
+    std::cerr << "Line " << __LINE__ << ": gradients not computed"
+              << std::endl;
+    return EXIT_FAILURE;
+    }
+  const int sliceSize = Dimensions[0] * Dimensions[1];
+  int numberOfNonZeroMagnitudes = 0;
+  for (int k = 0; k < Dimensions[2]; ++k)
+    {
+    for (int i = 0; i < sliceSize; ++i)
+      {
+      if (normal[k][i] != voxelNormal[k][i] ||
+          magnitude[k][i] != voxelMagnitude[k][i])
+        {
+        std::cerr << "Line " << __LINE__ << ": wrong gradient of voxel ("
+                  << i % Dimensions[0] << ", " << i / Dimensions[0] << ", "
+                  << k << "): " << normal[k][i] << " "
+                  << static_cast<int>(magnitude[k][i]) << " instead of "
+                  << voxelNormal[k][i] << " "
+                  << static_cast<int>(voxelMagnitude[k][i]) << std::endl;
+        return EXIT_FAILURE;
+        }
+      numberOfNonZeroMagnitudes += (magnitude[k][i] != 0);
+      }
+    }
+  if (numberOfNonZeroMagnitudes == 0)
+    {
+    std::cerr << "Line " << __LINE__ << ": all the gradients are null"
+              << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  return EXIT_SUCCESS;
+}
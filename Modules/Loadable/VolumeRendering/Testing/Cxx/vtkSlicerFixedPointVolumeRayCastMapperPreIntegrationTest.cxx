@@ -0,0 +1,263 @@
+/*=auto=========================================================================
+
+  Portions (c) Copyright 2005 Brigham and Women's Hospital (BWH)
+  All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Program:   3D Slicer
+
+=========================================================================auto=*/
+
+// Volume Rendering includes
+#include "vtkSlicerFixedPointVolumeRayCastMapper.h"
+
+// VTK includes
+#include <vtkCamera.h>
+#include <vtkColorTransferFunction.h>
+#include <vtkImageData.h>
+#include <vtkNew.h>
+#include <vtkPiecewiseFunction.h>
+#include <vtkRenderer.h>
+#include <vtkRenderWindow.h>
+#include <vtkVolume.h>
+#include <vtkVolumeProperty.h>
+
+// STD includes
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+namespace
+{
+
+// The volume scalars go from 0 to 999, one scalar index per value
+const int TableSize = 1000;
+
+//---------------------------------------------------------------------------
+void createVolume(vtkImageData* image)
+{
+  image->SetDimensions(10, 10, 10);
+  image->SetScalarTypeToUnsignedShort();
+  image->SetNumberOfScalarComponents(1);
+  image->AllocateScalars();
+  unsigned short* ptr = static_cast<unsigned short*>(image->GetScalarPointer());
+  for (int i = 0; i < TableSize; ++i)
+    {
+    ptr[i] = static_cast<unsigned short>(i);
+    }
+}
+
+//---------------------------------------------------------------------------
+// Integrate the extinction and the extinction weighted color of the mapper
+// tables with the midpoint rule, along a segment whose scalar goes linearly
+// from the scalar index "first" to the end of the scalar index "last".
+void integrate(vtkSlicerFixedPointVolumeRayCastMapper* mapper,
+               int first, int last, double rgba[4])
+{
+  unsigned short* colorTable = mapper->GetColorTable(0);
+  unsigned short* opacityTable = mapper->GetScalarOpacityTable(0);
+  const int numberOfSteps = 8 * (last + 1 - first);
+  const double step = static_cast<double>(last + 1 - first) / numberOfSteps;
+  double tau = 0.;
+  double colorTau[3] = {0., 0., 0.};
+  for (int n = 0; n < numberOfSteps; ++n)
+    {
+    const int index = static_cast<int>(floor(first + (n + 0.5) * step));
+    const double alpha = std::min(opacityTable[index] / VTKKW_FP_SCALE, 0.99999);
+    const double sampleTau = -log(1. - alpha);
+    tau += sampleTau;
+    for (int c = 0; c < 3; ++c)
+      {
+      colorTau[c] += sampleTau * colorTable[3 * index + c] / VTKKW_FP_SCALE;
+      }
+    }
+  const double meanTau = tau / numberOfSteps;
+  rgba[3] = 1. - exp(-meanTau);
+  for (int c = 0; c < 3; ++c)
+    {
+    rgba[c] = tau > 0. ? colorTau[c] / tau * rgba[3] : 0.;
+    }
+}
+
+//---------------------------------------------------------------------------
+// Compare the preintegration table with the direct integration of the
+// segments between the bin centers, or over a whole bin.
+bool checkTable(vtkSlicerFixedPointVolumeRayCastMapper* mapper, int line)
+{
+  unsigned short* table = mapper->GetPreIntegrationTable();
+  const int shift = mapper->GetPreIntegrationShift();
+  const int numberOfBins = mapper->GetPreIntegrationNumberOfBins();
+  if (!table || shift != 2 || numberOfBins != 250)
+    {
+    std::cerr << "Line " << line << ": wrong table " << table << " of "
+              << numberOfBins << " bins, shift " << shift << std::endl;
+    return false;
+    }
+  const int binSize = 1 << shift;
+  for (int front = 0; front < numberOfBins; front += 3)
+    {
+    for (int back = 0; back < numberOfBins; back += 5)
+      {
+      int first = std::min(front, back) * binSize + binSize / 2;
+      int last = std::max(front, back) * binSize + binSize / 2;
+      if (front == back)
+        {
+        first = front * binSize;
+        last = first + binSize - 1;
+        }
+      double rgba[4];
+      integrate(mapper, first, last, rgba);
+      unsigned short* entry = table + (front * numberOfBins + back) * 4;
+      for (int c = 0; c < 4; ++c)
+        {
+        if (fabs(entry[c] - rgba[c] * VTKKW_FP_SCALE) > 2.)
+          {
+          std::cerr << "Line " << line << ": component " << c
+                    << " of the segment from bin " << front << " to bin "
+                    << back << " is " << entry[c] << " instead of "
+                    << rgba[c] * VTKKW_FP_SCALE << std::endl;
+          return false;
+          }
+        }
+      }
+    }
+  return true;
+}
+
+//---------------------------------------------------------------------------
+unsigned short entryOpacity(vtkSlicerFixedPointVolumeRayCastMapper* mapper,
+                            int front, int back)
+{
+  const int numberOfBins = mapper->GetPreIntegrationNumberOfBins();
+  return mapper->GetPreIntegrationTable()[(front * numberOfBins + back) * 4 + 3];
+}
+
+} // end of anonymous namespace
+
+//---------------------------------------------------------------------------
+int vtkSlicerFixedPointVolumeRayCastMapperPreIntegrationTest(int , char * [] )
+{
+  vtkNew<vtkImageData> image;
+  createVolume(image.GetPointer());
+
+  vtkNew<vtkSlicerFixedPointVolumeRayCastMapper> mapper;
+  mapper->SetInput(image.GetPointer());
+  mapper->SetAutoAdjustSampleDistances(0);
+  mapper->SetSampleDistance(1.);
+  mapper->SetInteractiveSampleDistance(1.);
+  mapper->SetBlendModeToComposite();
+  mapper->PreIntegrationOn();
+
+  // Steps of opacity, the case where slicing artifacts are the worst
+  vtkNew<vtkPiecewiseFunction> opacity;
+  opacity->AddPoint(0., 0.);
+  opacity->AddPoint(299., 0.);
+  opacity->AddPoint(300., 0.3);
+  opacity->AddPoint(699., 0.3);
+  opacity->AddPoint(700., 0.8);
+  opacity->AddPoint(999., 0.8);
+  vtkNew<vtkColorTransferFunction> color;
+  color->AddRGBPoint(0., 0., 0., 1.);
+  color->AddRGBPoint(500., 1., 0., 0.);
+  color->AddRGBPoint(999., 1., 1., 1.);
+  vtkNew<vtkVolumeProperty> property;
+  property->SetScalarOpacity(opacity.GetPointer());
+  property->SetColor(color.GetPointer());
+  property->SetInterpolationTypeToLinear();
+
+  vtkNew<vtkVolume> volume;
+  volume->SetMapper(mapper.GetPointer());
+  volume->SetProperty(property.GetPointer());
+
+  vtkNew<vtkRenderer> renderer;
+  renderer->AddVolume(volume.GetPointer());
+  vtkNew<vtkRenderWindow> renderWindow;
+  renderWindow->SetSize(50, 50);
+  renderWindow->AddRenderer(renderer.GetPointer());
+  renderer->ResetCamera();
+  renderWindow->Render();
+
+  if (mapper->GetTableShift()[0] != 0. || mapper->GetTableScale()[0] != 1.)
+    {
+    std::cerr << "Line " << __LINE__ << ": the scalars are not the table "
+              << "indices" << std::endl;
+    return EXIT_FAILURE;
+    }
+  if (!checkTable(mapper.GetPointer(), __LINE__))
+    {
+    return EXIT_FAILURE;
+    }
+
+  // A segment across the first step is more opaque than the transparent
+  // bin before the step and less than the bin after it.
+  if (entryOpacity(mapper.GetPointer(), 70, 70) != 0 ||
+      entryOpacity(mapper.GetPointer(), 70, 80) == 0 ||
+      entryOpacity(mapper.GetPointer(), 70, 80) >=
+        entryOpacity(mapper.GetPointer(), 80, 80) ||
+      entryOpacity(mapper.GetPointer(), 80, 70) !=
+        entryOpacity(mapper.GetPointer(), 70, 80))
+    {
+    std::cerr << "Line " << __LINE__ << ": the step is not integrated"
+              << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // Moving the camera does not rebuild the table
+  const unsigned long buildTime = mapper->GetPreIntegrationTableBuildTime();
+  const int tableLength = 4 * mapper->GetPreIntegrationNumberOfBins() *
+    mapper->GetPreIntegrationNumberOfBins();
+  std::vector<unsigned short> table(mapper->GetPreIntegrationTable(),
+                                    mapper->GetPreIntegrationTable() + tableLength);
+  renderer->GetActiveCamera()->Azimuth(40.);
+  renderer->GetActiveCamera()->Elevation(15.);
+  renderer->ResetCameraClippingRange();
+  renderWindow->Render();
+  if (mapper->GetPreIntegrationTableBuildTime() != buildTime ||
+      !std::equal(table.begin(), table.end(), mapper->GetPreIntegrationTable()))
+    {
+    std::cerr << "Line " << __LINE__ << ": the table is rebuilt when the "
+              << "transfer functions do not change" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // A new opacity step rebuilds it
+  opacity->AddPoint(499., 0.3);
+  opacity->AddPoint(500., 0.6);
+  renderWindow->Render();
+  if (mapper->GetPreIntegrationTableBuildTime() <= buildTime ||
+      std::equal(table.begin(), table.end(), mapper->GetPreIntegrationTable()) ||
+      !checkTable(mapper.GetPointer(), __LINE__))
+    {
+    std::cerr << "Line " << __LINE__ << ": the table is not rebuilt when "
+              << "the opacity changes" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // So does a new color
+  const unsigned long opacityBuildTime = mapper->GetPreIntegrationTableBuildTime();
+  color->AddRGBPoint(800., 0., 1., 0.);
+  renderWindow->Render();
+  if (mapper->GetPreIntegrationTableBuildTime() <= opacityBuildTime ||
+      !checkTable(mapper.GetPointer(), __LINE__))
+    {
+    std::cerr << "Line " << __LINE__ << ": the table is not rebuilt when "
+              << "the color changes" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // Without preintegration, there is no table
+  mapper->PreIntegrationOff();
+  renderWindow->Render();
+  if (mapper->GetPreIntegrationTable() != 0)
+    {
+    std::cerr << "Line " << __LINE__ << ": the table is not released"
+              << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,179 @@
+/*=auto=========================================================================
+
+  Portions (c) Copyright 2005 Brigham and Women's Hospital (BWH)
+  All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Program:   3D Slicer
+
+=========================================================================auto=*/
+
+// Volume Rendering includes
+#include "vtkSlicerFixedPointVolumeRayCastMapper.h"
+
+// VTK includes
+#include <vtkCamera.h>
+#include <vtkColorTransferFunction.h>
+#include <vtkImageData.h>
+#include <vtkNew.h>
+#include <vtkPiecewiseFunction.h>
+#include <vtkRenderer.h>
+#include <vtkRenderWindow.h>
+#include <vtkVolume.h>
+#include <vtkVolumeProperty.h>
+#include <vtkWindowToImageFilter.h>
+
+// STD includes
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+namespace
+{
+
+//---------------------------------------------------------------------------
+// A 64x64x64 volume, empty but for 2 small blocks, so that most of the
+// rays cross large empty nodes of the min/max octree.
+void createMostlyEmptyVolume(vtkImageData* image)
+{
+  image->SetDimensions(64, 64, 64);
+  image->SetScalarTypeToUnsignedChar();
+  image->SetNumberOfScalarComponents(1);
+  image->AllocateScalars();
+  unsigned char* ptr = static_cast<unsigned char*>(image->GetScalarPointer());
+  memset(ptr, 0, 64 * 64 * 64);
+  const int blocks[2][3] = {{40, 20, 30}, {10, 50, 12}};
+  for (int b = 0; b < 2; ++b)
+    {
+    for (int k = blocks[b][2]; k < blocks[b][2] + 6; ++k)
+      {
+      for (int j = blocks[b][1]; j < blocks[b][1] + 6; ++j)
+        {
+        for (int i = blocks[b][0]; i < blocks[b][0] + 6; ++i)
+          {
+          ptr[(k * 64 + j) * 64 + i] = 100 + 20 * b + 2 * (i + j + k) % 40;
+          }
+        }
+      }
+    }
+}
+
+//---------------------------------------------------------------------------
+void renderImage(vtkRenderWindow* renderWindow, vtkImageData* image)
+{
+  renderWindow->Render();
+  vtkNew<vtkWindowToImageFilter> windowToImage;
+  windowToImage->SetInput(renderWindow);
+  windowToImage->ReadFrontBufferOff();
+  windowToImage->Update();
+  image->DeepCopy(windowToImage->GetOutput());
+}
+
+//---------------------------------------------------------------------------
+int compareImages(vtkImageData* image1, vtkImageData* image2,
+                  int& numberOfNonBlackPixels)
+{
+  const int size = image1->GetNumberOfPoints() *
+    image1->GetNumberOfScalarComponents();
+  if (image2->GetNumberOfPoints() * image2->GetNumberOfScalarComponents() != size)
+    {
+    return -1;
+    }
+  unsigned char* ptr1 = static_cast<unsigned char*>(image1->GetScalarPointer());
+  unsigned char* ptr2 = static_cast<unsigned char*>(image2->GetScalarPointer());
+  int numberOfDifferences = 0;
+  numberOfNonBlackPixels = 0;
+  for (int i = 0; i < size; ++i)
+    {
+    numberOfDifferences += (ptr1[i] != ptr2[i]);
+    numberOfNonBlackPixels += (ptr1[i] != 0);
+    }
+  return numberOfDifferences;
+}
+
+} // end of anonymous namespace
+
+//---------------------------------------------------------------------------
+int vtkSlicerFixedPointVolumeRayCastMapperTest1(int , char * [] )
+{
+  vtkNew<vtkImageData> image;
+  createMostlyEmptyVolume(image.GetPointer());
+
+  vtkNew<vtkSlicerFixedPointVolumeRayCastMapper> mapper;
+  mapper->SetInput(image.GetPointer());
+  mapper->SetAutoAdjustSampleDistances(0);
+  mapper->SetSampleDistance(0.5);
+  mapper->SetInteractiveSampleDistance(0.5);
+  mapper->SetImageSampleDistance(1.);
+  if (!mapper->GetOctreeSpaceLeaping())
+    {
+    std::cerr << "Line " << __LINE__ << ": leaping is not on by default"
+              << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // The empty space is transparent
+  vtkNew<vtkPiecewiseFunction> opacity;
+  opacity->AddPoint(0., 0.);
+  opacity->AddPoint(90., 0.);
+  opacity->AddPoint(160., 0.3);
+  vtkNew<vtkColorTransferFunction> color;
+  color->AddRGBPoint(0., 0., 0., 0.);
+  color->AddRGBPoint(100., 1., 0.5, 0.);
+  color->AddRGBPoint(160., 1., 1., 1.);
+  vtkNew<vtkVolumeProperty> property;
+  property->SetScalarOpacity(opacity.GetPointer());
+  property->SetColor(color.GetPointer());
+  property->SetInterpolationTypeToLinear();
+
+  vtkNew<vtkVolume> volume;
+  volume->SetMapper(mapper.GetPointer());
+  volume->SetProperty(property.GetPointer());
+
+  vtkNew<vtkRenderer> renderer;
+  renderer->AddVolume(volume.GetPointer());
+  vtkNew<vtkRenderWindow> renderWindow;
+  renderWindow->SetSize(200, 200);
+  renderWindow->SetMultiSamples(0);
+  renderWindow->AddRenderer(renderer.GetPointer());
+  // Oblique rays, so that they leap across nodes of all the levels
+  renderer->ResetCamera();
+  renderer->GetActiveCamera()->Azimuth(30.);
+  renderer->GetActiveCamera()->Elevation(20.);
+  renderer->ResetCameraClippingRange();
+
+  // Shading uses another compositing helper
+  for (int shade = 0; shade < 2; ++shade)
+    {
+    property->SetShade(shade);
+
+    vtkNew<vtkImageData> leapImage;
+    mapper->OctreeSpaceLeapingOn();
+    renderImage(renderWindow.GetPointer(), leapImage.GetPointer());
+
+    vtkNew<vtkImageData> flatImage;
+    mapper->OctreeSpaceLeapingOff();
+    renderImage(renderWindow.GetPointer(), flatImage.GetPointer());
+
+    int numberOfNonBlackPixels = 0;
+    int numberOfDifferences = compareImages(
+      leapImage.GetPointer(), flatImage.GetPointer(), numberOfNonBlackPixels);
+    if (numberOfDifferences != 0)
+      {
+      std::cerr << "Line " << __LINE__ << ": shade " << shade << ", "
+                << numberOfDifferences << " pixel components differ when "
+                << "leaping over the empty space" << std::endl;
+      return EXIT_FAILURE;
+      }
+    if (numberOfNonBlackPixels == 0)
+      {
+      std::cerr << "Line " << __LINE__ << ": shade " << shade
+                << ", the blocks are not rendered" << std::endl;
+      return EXIT_FAILURE;
+      }
+    }
+
+  return EXIT_SUCCESS;
+}
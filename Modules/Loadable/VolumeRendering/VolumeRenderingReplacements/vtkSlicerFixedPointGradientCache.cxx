@@ -0,0 +1,203 @@
+/*=========================================================================
+
+  Program:   3D Slicer
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+=========================================================================*/
+#include "vtkSlicerFixedPointGradientCache.h"
+#include "vtkDataArray.h"
+#include "vtkDirectionEncoder.h"
+#include "vtkImageData.h"
+#include "vtkObjectFactory.h"
+#include "vtkPointData.h"
+#include "vtkSmartPointer.h"
+#include "vtkTimeStamp.h"
+
+#include <new>
+#include <set>
+#include <string>
+#include <vector>
+
+class vtkSlicerFixedPointGradientCache::vtkInternal
+{
+public:
+  class Entry : public vtkSlicerFixedPointGradientCache::Gradients
+  {
+  public:
+    Entry( int numSlices, int sliceSize );
+    ~Entry();
+
+    vtkImageData          *Input;
+    int                    Independent;
+    std::string            EncoderClassName;
+    vtkTimeStamp           BuildTime;
+    std::set<void*>        Users;
+    unsigned short        *ContiguousNormal;
+    unsigned char         *ContiguousMagnitude;
+  };
+
+  std::vector<Entry*> Entries;
+};
+
+vtkSlicerFixedPointGradientCache::vtkInternal::Entry::Entry( int numSlices,
+                                                            int sliceSize )
+{
+  this->Input          = NULL;
+  this->Independent    = 0;
+  this->NumberOfSlices = numSlices;
+  this->SliceSize      = sliceSize;
+  this->Normal         = new unsigned short *[numSlices];
+  this->Magnitude      = new unsigned char *[numSlices];
+
+  // first, attempt contiguous memory. If this fails, then go
+  // for non-contiguous
+  const size_t size = static_cast<size_t>(numSlices) * sliceSize;
+  this->ContiguousNormal    = new (std::nothrow) unsigned short [size];
+  this->ContiguousMagnitude = new (std::nothrow) unsigned char [size];
+
+  for ( int i = 0; i < numSlices; i++ )
+  {
+    this->Normal[i] = this->ContiguousNormal ?
+      this->ContiguousNormal + static_cast<size_t>(i)*sliceSize :
+      new unsigned short [sliceSize];
+    this->Magnitude[i] = this->ContiguousMagnitude ?
+      this->ContiguousMagnitude + static_cast<size_t>(i)*sliceSize :
+      new unsigned char [sliceSize];
+  }
+}
+
+vtkSlicerFixedPointGradientCache::vtkInternal::Entry::~Entry()
+{
+  // Contiguous? Delete in one chunk otherwise delete slice by slice
+  for ( int i = 0; i < this->NumberOfSlices; i++ )
+  {
+    if ( !this->ContiguousNormal )
+    {
+      delete [] this->Normal[i];
+    }
+    if ( !this->ContiguousMagnitude )
+    {
+      delete [] this->Magnitude[i];
+    }
+  }
+  delete [] this->ContiguousNormal;
+  delete [] this->ContiguousMagnitude;
+  delete [] this->Normal;
+  delete [] this->Magnitude;
+}
+
+vtkCxxRevisionMacro(vtkSlicerFixedPointGradientCache, "$Revision$");
+vtkStandardNewMacro(vtkSlicerFixedPointGradientCache);
+
+vtkSlicerFixedPointGradientCache::vtkSlicerFixedPointGradientCache()
+{
+  this->Internal = new vtkInternal;
+}
+
+vtkSlicerFixedPointGradientCache::~vtkSlicerFixedPointGradientCache()
+{
+  for ( size_t i = 0; i < this->Internal->Entries.size(); i++ )
+  {
+    delete this->Internal->Entries[i];
+  }
+  delete this->Internal;
+}
+
+vtkSlicerFixedPointGradientCache *vtkSlicerFixedPointGradientCache::GetGlobalCache()
+{
+  static vtkSmartPointer<vtkSlicerFixedPointGradientCache> globalCache;
+  if ( !globalCache )
+  {
+    globalCache = vtkSmartPointer<vtkSlicerFixedPointGradientCache>::New();
+  }
+  return globalCache;
+}
+
+vtkSlicerFixedPointGradientCache::Gradients *
+vtkSlicerFixedPointGradientCache::AcquireGradients( void *user,
+                                                    vtkImageData *input,
+                                                    int independent,
+                                                    vtkDirectionEncoder *directionEncoder,
+                                                    int &computed )
+{
+  const std::string encoderClassName = directionEncoder->GetClassName();
+  int components = input->GetPointData()->GetScalars()->GetNumberOfComponents();
+  if ( components == 1 )
+  {
+    // Same gradients for independent and dependent components
+    independent = 1;
+  }
+
+  // The gradients are still valid if the input was not modified since
+  // they were computed.
+  vtkInternal::Entry *entry = NULL;
+  std::vector<vtkInternal::Entry*>::iterator it;
+  for ( it = this->Internal->Entries.begin(); it != this->Internal->Entries.end(); ++it )
+  {
+    if ( (*it)->Input == input &&
+         (*it)->Independent == independent &&
+         (*it)->EncoderClassName == encoderClassName &&
+         input->GetMTime() < (*it)->BuildTime.GetMTime() )
+    {
+      entry = *it;
+      break;
+    }
+  }
+
+  if ( entry && entry->Users.count(user) )
+  {
+    computed = 1;
+    return entry;
+  }
+  this->ReleaseGradients( user );
+
+  computed = (entry != NULL);
+  if ( !entry )
+  {
+    int dim[3];
+    input->GetDimensions( dim );
+    entry = new vtkInternal::Entry( dim[2],
+      dim[0]*dim[1]*((independent)?(components):(1)) );
+    entry->Input = input;
+    entry->Independent = independent;
+    entry->EncoderClassName = encoderClassName;
+    entry->BuildTime.Modified();
+    this->Internal->Entries.push_back( entry );
+    vtkDebugMacro( "Gradients of " << input << " added to the cache" );
+  }
+  entry->Users.insert( user );
+  return entry;
+}
+
+void vtkSlicerFixedPointGradientCache::ReleaseGradients( void *user )
+{
+  std::vector<vtkInternal::Entry*>::iterator it;
+  for ( it = this->Internal->Entries.begin(); it != this->Internal->Entries.end(); ++it )
+  {
+    if ( (*it)->Users.erase( user ) )
+    {
+      if ( (*it)->Users.empty() )
+      {
+        vtkDebugMacro( "Gradients of " << (*it)->Input << " removed from the cache" );
+        delete *it;
+        this->Internal->Entries.erase( it );
+      }
+      // A user has one gradient volume at most
+      return;
+    }
+  }
+}
+
+int vtkSlicerFixedPointGradientCache::GetNumberOfGradients()
+{
+  return static_cast<int>(this->Internal->Entries.size());
+}
+
+void vtkSlicerFixedPointGradientCache::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os,indent);
+
+  os << indent << "Number Of Gradients: " << this->GetNumberOfGradients() << endl;
+}
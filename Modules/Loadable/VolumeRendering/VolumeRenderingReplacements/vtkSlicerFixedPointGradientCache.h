@@ -0,0 +1,90 @@
+/*=========================================================================
+
+  Program:   3D Slicer
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+=========================================================================*/
+
+// .NAME vtkSlicerFixedPointGradientCache - gradients shared by fixed point mappers
+// .SECTION Description
+// This is a helper class for storing the encoded gradients of the inputs
+// of vtkSlicerFixedPointVolumeRayCastMapper so that the mappers rendering
+// the same image (e.g. the same volume in several 3D views) compute and
+// store its gradients only once. The gradients of an image are kept as
+// long as one mapper uses them and until the image is modified.
+//
+// This class is not intended to be used directly, all the mappers share
+// the global cache by default.
+
+// .SECTION see also
+// vtkSlicerFixedPointVolumeRayCastMapper
+
+#ifndef __vtkSlicerFixedPointGradientCache_h
+#define __vtkSlicerFixedPointGradientCache_h
+#include "VolumeRenderingReplacementsExport.h"
+
+#include "vtkObject.h"
+
+class vtkDirectionEncoder;
+class vtkImageData;
+
+/// \ingroup Slicer_QtModules_VolumeRendering
+class Q_SLICER_QTMODULES_VOLUMERENDERING_REPLACEMENTS_EXPORT vtkSlicerFixedPointGradientCache : public vtkObject
+{
+public:
+  static vtkSlicerFixedPointGradientCache *New();
+  vtkTypeRevisionMacro(vtkSlicerFixedPointGradientCache,vtkObject);
+  virtual void PrintSelf(ostream& os, vtkIndent indent);
+
+  // Description:
+  // Cache shared by the mappers that are not given their own.
+  static vtkSlicerFixedPointGradientCache *GetGlobalCache();
+
+  // Description:
+  // Encoded gradients of an image. For each slice, one 16 bit direction
+  // (see vtkDirectionEncoder) and one 8 bit magnitude per voxel, per
+  // component if the components are independent.
+  class Gradients
+  {
+  public:
+    unsigned short **Normal;
+    unsigned char  **Magnitude;
+    int              NumberOfSlices;
+    int              SliceSize;
+  };
+
+  // Description:
+  // Return the gradients of input for user (e.g. a mapper), shared with
+  // the other users of the same input. If they were not computed yet,
+  // computed is set to 0, the memory is allocated and the caller must
+  // compute them before releasing them. The gradients previously
+  // acquired by user are released.
+  Gradients *AcquireGradients( void *user, vtkImageData *input,
+                               int independent,
+                               vtkDirectionEncoder *directionEncoder,
+                               int &computed );
+
+  // Description:
+  // The gradients acquired by user are not used anymore. They are
+  // deleted if they have no other user.
+  void ReleaseGradients( void *user );
+
+  // Description:
+  // Number of gradient volumes in the cache.
+  int GetNumberOfGradients();
+
+protected:
+  vtkSlicerFixedPointGradientCache();
+  ~vtkSlicerFixedPointGradientCache();
+
+  class vtkInternal;
+  vtkInternal *Internal;
+
+private:
+  vtkSlicerFixedPointGradientCache(const vtkSlicerFixedPointGradientCache&);  // Not implemented.
+  void operator=(const vtkSlicerFixedPointGradientCache&);  // Not implemented.
+};
+
+#endif
@@ -315,6 +315,7 @@ void vtkSlicerFixedPointCompositeGOHelperGenerateImageOneSimpleTrilin( T *data,
 {
   VTKKWRCHelper_InitializationAndLoopStartGOTrilin();
   VTKKWRCHelper_InitializeCompositeOneTrilin();
+  VTKKWRCHelper_InitializePreIntegration();
   VTKKWRCHelper_InitializeCompositeOneGOTrilin();
   VTKKWRCHelper_SpaceLeapSetup();
 
@@ -348,11 +349,18 @@ void vtkSlicerFixedPointCompositeGOHelperGenerateImageOneSimpleTrilin( T *data,
     VTKKWRCHelper_ComputeWeights(pos);
     VTKKWRCHelper_InterpolateScalar(val);
 
-    tmp[3] = scalarOpacityTable[0][val];
-    if ( !tmp[3] ) 
+    if ( preIntegrationTable )
       {
-      continue;
-      } 
+      VTKKWRCHelper_LookupPreIntegratedColorUS( val, tmp );
+      }
+    else
+      {
+      tmp[3] = scalarOpacityTable[0][val];
+      if ( !tmp[3] )
+        {
+        continue;
+        }
+      }
     
     if ( needToSampleGO )
       {
@@ -361,18 +369,25 @@ void vtkSlicerFixedPointCompositeGOHelperGenerateImageOneSimpleTrilin( T *data,
       }
     
     VTKKWRCHelper_InterpolateMagnitude(mag);
-    tmp[3] = (tmp[3] * gradientOpacityTable[0][mag] + 0x7fff)>>VTKKW_FP_SHIFT; 
-    if ( !tmp[3] ) 
+    if ( preIntegrationTable )
       {
-      continue;
-      } 
-    
-    tmp[0] = static_cast<unsigned short>                      
-      ((colorTable[0][3*val  ]*tmp[3] + 0x7fff)>>(VTKKW_FP_SHIFT));
-    tmp[1] = static_cast<unsigned short>                          
-      ((colorTable[0][3*val+1]*tmp[3] + 0x7fff)>>(VTKKW_FP_SHIFT));
-    tmp[2] = static_cast<unsigned short>                           
-      ((colorTable[0][3*val+2]*tmp[3] + 0x7fff)>>(VTKKW_FP_SHIFT));  
+      VTKKWRCHelper_ScalePreIntegratedColorGO( gradientOpacityTable[0][mag], tmp );
+      }
+    else
+      {
+      tmp[3] = (tmp[3] * gradientOpacityTable[0][mag] + 0x7fff)>>VTKKW_FP_SHIFT;
+      if ( !tmp[3] )
+        {
+        continue;
+        }
+
+      tmp[0] = static_cast<unsigned short>
+        ((colorTable[0][3*val  ]*tmp[3] + 0x7fff)>>(VTKKW_FP_SHIFT));
+      tmp[1] = static_cast<unsigned short>
+        ((colorTable[0][3*val+1]*tmp[3] + 0x7fff)>>(VTKKW_FP_SHIFT));
+      tmp[2] = static_cast<unsigned short>
+        ((colorTable[0][3*val+2]*tmp[3] + 0x7fff)>>(VTKKW_FP_SHIFT));
+      }
     
     VTKKWRCHelper_CompositeColorAndCheckEarlyTermination( color, tmp, remainingOpacity );
           
@@ -401,6 +416,7 @@ void vtkSlicerFixedPointCompositeGOHelperGenerateImageOneTrilin( T *data,
 {
   VTKKWRCHelper_InitializationAndLoopStartGOTrilin();
   VTKKWRCHelper_InitializeCompositeOneTrilin();
+  VTKKWRCHelper_InitializePreIntegration();
   VTKKWRCHelper_InitializeCompositeOneGOTrilin();
   VTKKWRCHelper_SpaceLeapSetup();
   
@@ -435,11 +451,18 @@ void vtkSlicerFixedPointCompositeGOHelperGenerateImageOneTrilin( T *data,
     VTKKWRCHelper_ComputeWeights(pos);
     VTKKWRCHelper_InterpolateScalar(val);
 
-    tmp[3] = scalarOpacityTable[0][val];
-    if ( !tmp[3] ) 
+    if ( preIntegrationTable )
       {
-      continue;
-      } 
+      VTKKWRCHelper_LookupPreIntegratedColorUS( val, tmp );
+      }
+    else
+      {
+      tmp[3] = scalarOpacityTable[0][val];
+      if ( !tmp[3] )
+        {
+        continue;
+        }
+      }
     
     if ( needToSampleGO )
       {
@@ -448,19 +471,26 @@ void vtkSlicerFixedPointCompositeGOHelperGenerateImageOneTrilin( T *data,
       }
     VTKKWRCHelper_InterpolateMagnitude(mag);
     
-    tmp[3] = (tmp[3] * gradientOpacityTable[0][mag] + 0x7fff)>>VTKKW_FP_SHIFT; 
-    if ( !tmp[3] ) 
+    if ( preIntegrationTable )
       {
-      continue;
-      } 
-    
-    tmp[0] = static_cast<unsigned short>                      
-      ((colorTable[0][3*val  ]*tmp[3] + 0x7fff)>>(VTKKW_FP_SHIFT));
-    tmp[1] = static_cast<unsigned short>                          
-      ((colorTable[0][3*val+1]*tmp[3] + 0x7fff)>>(VTKKW_FP_SHIFT));
-    tmp[2] = static_cast<unsigned short>                           
-      ((colorTable[0][3*val+2]*tmp[3] + 0x7fff)>>(VTKKW_FP_SHIFT));  
+      VTKKWRCHelper_ScalePreIntegratedColorGO( gradientOpacityTable[0][mag], tmp );
+      }
+    else
+      {
+      tmp[3] = (tmp[3] * gradientOpacityTable[0][mag] + 0x7fff)>>VTKKW_FP_SHIFT;
+      if ( !tmp[3] )
+        {
+        continue;
+        }
 
+      tmp[0] = static_cast<unsigned short>
+        ((colorTable[0][3*val  ]*tmp[3] + 0x7fff)>>(VTKKW_FP_SHIFT));
+      tmp[1] = static_cast<unsigned short>
+        ((colorTable[0][3*val+1]*tmp[3] + 0x7fff)>>(VTKKW_FP_SHIFT));
+      tmp[2] = static_cast<unsigned short>
+        ((colorTable[0][3*val+2]*tmp[3] + 0x7fff)>>(VTKKW_FP_SHIFT));
+      }
+    
     VTKKWRCHelper_CompositeColorAndCheckEarlyTermination( color, tmp, remainingOpacity );    
     }
   
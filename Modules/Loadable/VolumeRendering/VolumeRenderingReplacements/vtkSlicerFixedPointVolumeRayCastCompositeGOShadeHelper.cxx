@@ -334,6 +334,7 @@ void vtkSlicerFixedPointCompositeGOShadeHelperGenerateImageOneSimpleTrilin( T *d
 {
   VTKKWRCHelper_InitializationAndLoopStartGOShadeTrilin();
   VTKKWRCHelper_InitializeCompositeOneTrilin();
+  VTKKWRCHelper_InitializePreIntegration();
   VTKKWRCHelper_InitializeCompositeOneShadeTrilin();
   VTKKWRCHelper_InitializeCompositeOneGOTrilin();
   VTKKWRCHelper_SpaceLeapSetup();
@@ -374,11 +375,18 @@ void vtkSlicerFixedPointCompositeGOShadeHelperGenerateImageOneSimpleTrilin( T *d
     VTKKWRCHelper_ComputeWeights(pos);
     VTKKWRCHelper_InterpolateScalar(val);
     
-    tmp[3] = scalarOpacityTable[0][val];
-    if ( !tmp[3] ) 
+    if ( preIntegrationTable )
       {
-      continue;
-      } 
+      VTKKWRCHelper_LookupPreIntegratedColorUS( val, tmp );
+      }
+    else
+      {
+      tmp[3] = scalarOpacityTable[0][val];
+      if ( !tmp[3] )
+        {
+        continue;
+        }
+      }
     
     if ( needToSampleMagnitude )
       {
@@ -386,20 +394,26 @@ void vtkSlicerFixedPointCompositeGOShadeHelperGenerateImageOneSimpleTrilin( T *d
       needToSampleMagnitude = 0;
       }
     VTKKWRCHelper_InterpolateMagnitude(mag);
-    tmp[3] = (tmp[3] * gradientOpacityTable[0][mag] + 0x7fff)>>VTKKW_FP_SHIFT; 
-    if ( !tmp[3] ) 
+    if ( preIntegrationTable )
       {
-      continue;
-      } 
-    
-    tmp[0] = static_cast<unsigned short>                      
-      ((colorTable[0][3*val  ]*tmp[3] + 0x7fff)>>(VTKKW_FP_SHIFT));
-    tmp[1] = static_cast<unsigned short>                          
-      ((colorTable[0][3*val+1]*tmp[3] + 0x7fff)>>(VTKKW_FP_SHIFT));
-    tmp[2] = static_cast<unsigned short>                           
-      ((colorTable[0][3*val+2]*tmp[3] + 0x7fff)>>(VTKKW_FP_SHIFT));  
-        
+      VTKKWRCHelper_ScalePreIntegratedColorGO( gradientOpacityTable[0][mag], tmp );
+      }
+    else
+      {
+      tmp[3] = (tmp[3] * gradientOpacityTable[0][mag] + 0x7fff)>>VTKKW_FP_SHIFT;
+      if ( !tmp[3] )
+        {
+        continue;
+        }
 
+      tmp[0] = static_cast<unsigned short>
+        ((colorTable[0][3*val  ]*tmp[3] + 0x7fff)>>(VTKKW_FP_SHIFT));
+      tmp[1] = static_cast<unsigned short>
+        ((colorTable[0][3*val+1]*tmp[3] + 0x7fff)>>(VTKKW_FP_SHIFT));
+      tmp[2] = static_cast<unsigned short>
+        ((colorTable[0][3*val+2]*tmp[3] + 0x7fff)>>(VTKKW_FP_SHIFT));
+      }
+    
     if ( needToSampleDirection )
       {
       VTKKWRCHelper_GetCellDirectionValues( dirPtrABCD, dirPtrEFGH );
@@ -433,6 +447,7 @@ void vtkSlicerFixedPointCompositeGOShadeHelperGenerateImageOneTrilin( T *data,
 {
   VTKKWRCHelper_InitializationAndLoopStartGOShadeTrilin();
   VTKKWRCHelper_InitializeCompositeOneTrilin();
+  VTKKWRCHelper_InitializePreIntegration();
   VTKKWRCHelper_InitializeCompositeOneShadeTrilin();
   VTKKWRCHelper_InitializeCompositeOneGOTrilin();
   VTKKWRCHelper_SpaceLeapSetup();
@@ -474,11 +489,18 @@ void vtkSlicerFixedPointCompositeGOShadeHelperGenerateImageOneTrilin( T *data,
     VTKKWRCHelper_ComputeWeights(pos);
     VTKKWRCHelper_InterpolateScalar(val);
     
-    tmp[3] = scalarOpacityTable[0][val];
-    if ( !tmp[3] ) 
+    if ( preIntegrationTable )
       {
-      continue;
-      } 
+      VTKKWRCHelper_LookupPreIntegratedColorUS( val, tmp );
+      }
+    else
+      {
+      tmp[3] = scalarOpacityTable[0][val];
+      if ( !tmp[3] )
+        {
+        continue;
+        }
+      }
     
     if ( needToSampleMagnitude )
       {
@@ -486,24 +508,31 @@ void vtkSlicerFixedPointCompositeGOShadeHelperGenerateImageOneTrilin( T *data,
       needToSampleMagnitude = 0;
       }
     VTKKWRCHelper_InterpolateMagnitude(mag);
-    tmp[3] = (tmp[3] * gradientOpacityTable[0][mag] + 0x7fff)>>VTKKW_FP_SHIFT; 
-    if ( !tmp[3] ) 
+    if ( preIntegrationTable )
       {
-      continue;
-      } 
+      VTKKWRCHelper_ScalePreIntegratedColorGO( gradientOpacityTable[0][mag], tmp );
+      }
+    else
+      {
+      tmp[3] = (tmp[3] * gradientOpacityTable[0][mag] + 0x7fff)>>VTKKW_FP_SHIFT;
+      if ( !tmp[3] )
+        {
+        continue;
+        }
+
+      tmp[0] = static_cast<unsigned short>
+        ((colorTable[0][3*val  ]*tmp[3] + 0x7fff)>>(VTKKW_FP_SHIFT));
+      tmp[1] = static_cast<unsigned short>
+        ((colorTable[0][3*val+1]*tmp[3] + 0x7fff)>>(VTKKW_FP_SHIFT));
+      tmp[2] = static_cast<unsigned short>
+        ((colorTable[0][3*val+2]*tmp[3] + 0x7fff)>>(VTKKW_FP_SHIFT));
+      }
     
     if ( needToSampleDirection )
       {
       VTKKWRCHelper_GetCellDirectionValues( dirPtrABCD, dirPtrEFGH );
       needToSampleDirection = 0;
       }
-    
-    tmp[0] = static_cast<unsigned short>                      
-      ((colorTable[0][3*val  ]*tmp[3] + 0x7fff)>>(VTKKW_FP_SHIFT));
-    tmp[1] = static_cast<unsigned short>                          
-      ((colorTable[0][3*val+1]*tmp[3] + 0x7fff)>>(VTKKW_FP_SHIFT));
-    tmp[2] = static_cast<unsigned short>                           
-      ((colorTable[0][3*val+2]*tmp[3] + 0x7fff)>>(VTKKW_FP_SHIFT));        
 
     VTKKWRCHelper_InterpolateShading( diffuseShadingTable[0], specularShadingTable[0], tmp ); 
     VTKKWRCHelper_CompositeColorAndCheckEarlyTermination( color, tmp, remainingOpacity );    
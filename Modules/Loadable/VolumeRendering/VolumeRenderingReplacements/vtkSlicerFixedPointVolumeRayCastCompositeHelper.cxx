@@ -304,6 +304,7 @@ void vtkSlicerFixedPointCompositeHelperGenerateImageOneSimpleTrilin( T *data,
 {
   VTKKWRCHelper_InitializationAndLoopStartTrilin();
   VTKKWRCHelper_InitializeCompositeOneTrilin();
+  VTKKWRCHelper_InitializePreIntegration();
   VTKKWRCHelper_SpaceLeapSetup();
 
   for ( k = 0; k < numSteps; k++ )
@@ -333,7 +334,14 @@ void vtkSlicerFixedPointCompositeHelperGenerateImageOneSimpleTrilin( T *data,
     VTKKWRCHelper_ComputeWeights(pos);
     VTKKWRCHelper_InterpolateScalar(val);
 
-    VTKKWRCHelper_LookupColorUS( colorTable[0], scalarOpacityTable[0], val, tmp );        
+    if ( preIntegrationTable )
+      {
+      VTKKWRCHelper_LookupPreIntegratedColorUS( val, tmp );
+      }
+    else
+      {
+      VTKKWRCHelper_LookupColorUS( colorTable[0], scalarOpacityTable[0], val, tmp );
+      }
     VTKKWRCHelper_CompositeColorAndCheckEarlyTermination( color, tmp, remainingOpacity );          
     }
       
@@ -360,6 +368,7 @@ void vtkSlicerFixedPointCompositeHelperGenerateImageOneTrilin( T *data,
 {
   VTKKWRCHelper_InitializationAndLoopStartTrilin();
   VTKKWRCHelper_InitializeCompositeOneTrilin();
+  VTKKWRCHelper_InitializePreIntegration();
   VTKKWRCHelper_SpaceLeapSetup();
   
   for ( k = 0; k < numSteps; k++ )
@@ -389,7 +398,14 @@ void vtkSlicerFixedPointCompositeHelperGenerateImageOneTrilin( T *data,
     VTKKWRCHelper_ComputeWeights(pos);
     VTKKWRCHelper_InterpolateScalar(val);
     
-    VTKKWRCHelper_LookupColorUS( colorTable[0], scalarOpacityTable[0], val, tmp );
+    if ( preIntegrationTable )
+      {
+      VTKKWRCHelper_LookupPreIntegratedColorUS( val, tmp );
+      }
+    else
+      {
+      VTKKWRCHelper_LookupColorUS( colorTable[0], scalarOpacityTable[0], val, tmp );
+      }
     VTKKWRCHelper_CompositeColorAndCheckEarlyTermination( color, tmp, remainingOpacity );    
     }
     
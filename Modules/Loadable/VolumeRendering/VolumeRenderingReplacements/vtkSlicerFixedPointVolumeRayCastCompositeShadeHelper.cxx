@@ -312,6 +312,7 @@ void vtkSlicerFixedPointCompositeShadeHelperGenerateImageOneSimpleTrilin( T *dat
 {
   VTKKWRCHelper_InitializationAndLoopStartShadeTrilin();
   VTKKWRCHelper_InitializeCompositeOneTrilin();
+  VTKKWRCHelper_InitializePreIntegration();
   VTKKWRCHelper_InitializeCompositeOneShadeTrilin();
   VTKKWRCHelper_SpaceLeapSetup();
 
@@ -345,7 +346,14 @@ void vtkSlicerFixedPointCompositeShadeHelperGenerateImageOneSimpleTrilin( T *dat
     VTKKWRCHelper_ComputeWeights(pos);
     VTKKWRCHelper_InterpolateScalar(val);
     
-    VTKKWRCHelper_LookupColorUS( colorTable[0], scalarOpacityTable[0], val, tmp );
+    if ( preIntegrationTable )
+      {
+      VTKKWRCHelper_LookupPreIntegratedColorUS( val, tmp );
+      }
+    else
+      {
+      VTKKWRCHelper_LookupColorUS( colorTable[0], scalarOpacityTable[0], val, tmp );
+      }
     if ( needToSampleDirection )
       {
       VTKKWRCHelper_GetCellDirectionValues( dirPtrABCD, dirPtrEFGH );
@@ -379,6 +387,7 @@ void vtkSlicerFixedPointCompositeShadeHelperGenerateImageOneTrilin( T *data,
 {
   VTKKWRCHelper_InitializationAndLoopStartShadeTrilin();
   VTKKWRCHelper_InitializeCompositeOneTrilin();
+  VTKKWRCHelper_InitializePreIntegration();
   VTKKWRCHelper_InitializeCompositeOneShadeTrilin();
   VTKKWRCHelper_SpaceLeapSetup();
         
@@ -413,7 +422,14 @@ void vtkSlicerFixedPointCompositeShadeHelperGenerateImageOneTrilin( T *data,
     VTKKWRCHelper_ComputeWeights(pos);
     VTKKWRCHelper_InterpolateScalar(val);
     
-    VTKKWRCHelper_LookupColorUS( colorTable[0], scalarOpacityTable[0], val, tmp );
+    if ( preIntegrationTable )
+      {
+      VTKKWRCHelper_LookupPreIntegratedColorUS( val, tmp );
+      }
+    else
+      {
+      VTKKWRCHelper_LookupColorUS( colorTable[0], scalarOpacityTable[0], val, tmp );
+      }
     if ( needToSampleDirection )
       {
       VTKKWRCHelper_GetCellDirectionValues( dirPtrABCD, dirPtrEFGH );
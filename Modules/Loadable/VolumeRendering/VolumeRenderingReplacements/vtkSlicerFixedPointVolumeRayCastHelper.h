@@ -358,6 +358,45 @@
   COLOR[2] = static_cast<unsigned short>                                                \
     ((CTABLE[3*IDX+2]*COLOR[3] + 0x7fff)>>(VTKKW_FP_SHIFT));
 
+// Preintegrated transfer function, see
+// vtkSlicerFixedPointVolumeRayCastMapper::SetPreIntegration(). The color
+// of the ray segment ending at this sample is looked up from the bins of
+// the scalar index at both of its ends. The segment is reduced to this
+// sample when the previous step was not sampled (first step, empty space
+// or cropping).
+#define VTKKWRCHelper_InitializePreIntegration()                                        \
+  unsigned short *preIntegrationTable = mapper->GetPreIntegrationTable();               \
+  int             preIntegrationShift = mapper->GetPreIntegrationShift();               \
+  int             preIntegrationBins  = mapper->GetPreIntegrationNumberOfBins();        \
+  int             preIntegrationFront = -1;                                             \
+  unsigned int    preIntegrationStep  = 0;
+
+#define VTKKWRCHelper_LookupPreIntegratedColorUS( IDX, COLOR )                          \
+  {                                                                                     \
+  int _back  = (IDX) >> preIntegrationShift;                                            \
+  int _front = ( preIntegrationFront >= 0 && k == preIntegrationStep )?                 \
+    (preIntegrationFront):(_back);                                                      \
+  preIntegrationFront = _back;                                                          \
+  preIntegrationStep  = k + 1;                                                          \
+  unsigned short *_entry =                                                              \
+    preIntegrationTable + 4*(_front*preIntegrationBins + _back);                        \
+  COLOR[0] = _entry[0];                                                                 \
+  COLOR[1] = _entry[1];                                                                 \
+  COLOR[2] = _entry[2];                                                                 \
+  COLOR[3] = _entry[3];                                                                 \
+  }                                                                                     \
+  if ( !COLOR[3] ) {continue;}
+
+#define VTKKWRCHelper_ScalePreIntegratedColorGO( GOVALUE, COLOR )                       \
+  {                                                                                     \
+  unsigned int _go = GOVALUE;                                                           \
+  COLOR[3] = static_cast<unsigned short>((COLOR[3]*_go + 0x7fff)>>VTKKW_FP_SHIFT);      \
+  if ( !COLOR[3] ) {continue;}                                                          \
+  COLOR[0] = static_cast<unsigned short>((COLOR[0]*_go + 0x7fff)>>VTKKW_FP_SHIFT);      \
+  COLOR[1] = static_cast<unsigned short>((COLOR[1]*_go + 0x7fff)>>VTKKW_FP_SHIFT);      \
+  COLOR[2] = static_cast<unsigned short>((COLOR[2]*_go + 0x7fff)>>VTKKW_FP_SHIFT);      \
+  }
+
 #define VTKKWRCHelper_LookupShading( DTABLE, STABLE, NORMAL, COLOR )                            \
   COLOR[0] = static_cast<unsigned short>((DTABLE[3*NORMAL  ]*COLOR[0]+0x7fff)>>VTKKW_FP_SHIFT); \
   COLOR[1] = static_cast<unsigned short>((DTABLE[3*NORMAL+1]*COLOR[1]+0x7fff)>>VTKKW_FP_SHIFT); \
@@ -1114,6 +1153,11 @@
                                                                 \
   if ( !mmvalid )                                               \
     {                                                           \
+    if ( mapper->GetOctreeSpaceLeaping() )                      \
+      {                                                         \
+      k += mapper->LeapEmptySpace( pos, dir, mmpos,             \
+                                   numSteps - 1 - k );          \
+      }                                                         \
     continue;                                                   \
     }
 
@@ -39,6 +39,12 @@ PURPOSE.  See the above copyright notice for more information.
 #include "vtkTransform.h"
 #include "vtkVolumeProperty.h"
 #include "vtkSlicerFixedPointRayCastImage.h"
+//SLICERADD
+#include "vtkSlicerFixedPointGradientCache.h"
+//ENDSLICERADD
+
+#include <algorithm>
+#include <vector>
 
 
 vtkCxxRevisionMacro(vtkSlicerFixedPointVolumeRayCastMapper, "$Revision: 1.20.4.1 $");
@@ -142,6 +148,126 @@ void vtkSlicerFixedPointVolumeRayCastMapperFillInMinMaxVolume( T *dataPtr, unsig
     }
 }
 
+//SLICERADD
+// Compute the encoded normal and gradient magnitude of one scalar location.
+// Use a central difference if possible, otherwise a forward or backward
+// difference on the edges. Allow up to 3 tries to find the gradient -
+// looking out at a distance of 1, 2, and 3 units.
+template <class T>
+inline void vtkSlicerFixedPointVolumeRayCastMapperComputeVoxelGradient( T *cdptr,
+                                                                       T *dataPtr,
+                                                                       T *lastPixel,
+                                                                       int x, int y, int z,
+                                                                       int dim[3],
+                                                                       int xstep, int ystep, int zstep,
+                                                                       double aspect[3],
+                                                                       float scale,
+                                                                       float tolerance,
+                                                                       unsigned short *cdirPtr,
+                                                                       unsigned char  *cmagPtr,
+                                                                       vtkDirectionEncoder *directionEncoder )
+{
+    float n[3], t;
+    float gvalue=0;
+    int foundGradient = 0;
+    for ( int d = 1; d <= 3 && !foundGradient; d++ )
+    {
+        // Compute the X component
+        if ( x < d && (cdptr+d*xstep) <= lastPixel )
+        {
+            n[0] = 2.0*((float)*(cdptr) - (float)*(cdptr+d*xstep));
+        }
+        else if ( x >= dim[0] - d && (cdptr-d*xstep) >= dataPtr )
+        {
+            n[0] = 2.0*((float)*(cdptr-d*xstep) - (float)*(cdptr));
+        }
+        else if ( (cdptr+d*xstep) <= lastPixel && (cdptr-d*xstep) >= dataPtr )
+        {
+            n[0] = (float)*(cdptr-d*xstep) - (float)*(cdptr+d*xstep);
+        }
+        else
+        {
+            n[0] = 0;
+        }
+
+        // Compute the Y component
+        if ( y < d && (cdptr+d*ystep) <= lastPixel )
+        {
+            n[1] = 2.0*((float)*(cdptr) - (float)*(cdptr+d*ystep));
+        }
+        else if ( y >= dim[1] - d && (cdptr-d*ystep) >= dataPtr )
+        {
+            n[1] = 2.0*((float)*(cdptr-d*ystep) - (float)*(cdptr));
+        }
+        else if ( (cdptr+d*ystep) <= lastPixel && (cdptr-d*ystep) >= dataPtr )
+        {
+            n[1] = (float)*(cdptr-d*ystep) - (float)*(cdptr+d*ystep);
+        }
+        else
+        {
+            n[1] = 0;
+        }
+
+        // Compute the Z component
+        if ( z < d && (cdptr+d*zstep) <= lastPixel )
+        {
+            n[2] = 2.0*((float)*(cdptr) - (float)*(cdptr+d*zstep));
+        }
+        else if ( z >= dim[2] - d && (cdptr-d*zstep) >= dataPtr )
+        {
+            n[2] = 2.0*((float)*(cdptr-d*zstep) - (float)*(cdptr));
+        }
+        else if ( (cdptr+d*zstep) <= lastPixel && (cdptr-d*zstep) >= dataPtr )
+        {
+            n[2] = (float)*(cdptr-d*zstep) - (float)*(cdptr+d*zstep);
+        }
+        else
+        {
+            n[2] = 0;
+        }
+
+        // Take care of the aspect ratio of the data
+        // Scaling in the vtkVolume is isotropic, so this is the
+        // only place we have to worry about non-isotropic scaling.
+        n[0] /= d*aspect[0];
+        n[1] /= d*aspect[1];
+        n[2] /= d*aspect[2];
+
+        // Compute the gradient magnitude
+        t = sqrt( (double)( n[0]*n[0] +
+            n[1]*n[1] +
+            n[2]*n[2] ) );
+
+        // Encode this into an 8 bit value
+        gvalue = t * scale;
+
+        if ( d > 1 )
+        {
+            gvalue = 0;
+        }
+
+        gvalue = (gvalue<0.0)?(0.0):(gvalue);
+        gvalue = (gvalue>255.0)?(255.0):(gvalue);
+
+        // Normalize the gradient direction
+        if ( t > tolerance )
+        {
+            n[0] /= t;
+            n[1] /= t;
+            n[2] /= t;
+            foundGradient = 1;
+        }
+        else
+        {
+            n[0] = n[1] = n[2] = 0.0;
+        }
+    }
+
+    *cmagPtr = static_cast<unsigned char>(gvalue + 0.5);
+    *cdirPtr = directionEncoder->GetEncodedDirection( n );
+}
+//ENDSLICERADD
+
 template <class T>
 void vtkSlicerFixedPointVolumeRayCastMapperComputeGradients( T *dataPtr,
                                                             int dim[3],
@@ -152,15 +278,16 @@ void vtkSlicerFixedPointVolumeRayCastMapperComputeGradients( T *dataPtr,
                                                             unsigned short **gradientNormal,
                                                             unsigned char  **gradientMagnitude,
                                                             vtkDirectionEncoder *directionEncoder,
-                                                            vtkSlicerFixedPointVolumeRayCastMapper *me )
+                                                            vtkSlicerFixedPointVolumeRayCastMapper *me,
+                                                            int thread_id,
+                                                            int thread_count,
+                                                            int vectorized )
 {
     int                 x, y, z, c;
     int                 x_start, x_limit;
     int                 y_start, y_limit;
     int                 z_start, z_limit;
     T                   *dptr, *cdptr;
-    float               n[3], t;
-    float               gvalue=0;
     int                 xlow, xhigh;
     double              aspect[3];
     int                 xstep, ystep, zstep;
@@ -168,11 +295,6 @@ void vtkSlicerFixedPointVolumeRayCastMapperComputeGradients( T *dataPtr,
     unsigned short      *dirPtr, *cdirPtr;
     unsigned char       *magPtr, *cmagPtr;
 
-
-
-
-    me->InvokeEvent( vtkCommand::VolumeMapperComputeGradientsStartEvent, NULL );
-
     double avgSpacing = (spacing[0]+spacing[1]+spacing[2])/3.0;
 
     // adjust the aspect
@@ -211,10 +333,6 @@ void vtkSlicerFixedPointVolumeRayCastMapperComputeGradients( T *dataPtr,
         }
     }
 
-
-    int thread_id = 0;
-    int thread_count = 1;
-
     x_start = 0;
     x_limit = dim[0];
     y_start = 0;
@@ -247,6 +365,17 @@ void vtkSlicerFixedPointVolumeRayCastMapperComputeGradients( T *dataPtr,
 
     T *lastPixel = dataPtr + components*dim[0]*dim[1]*dim[2] - 1;
 
+    //SLICERADD
+    // Central differences of the inner voxels of a row, computed for the
+    // whole row at once in a loop without branches that the compiler can
+    // vectorize.
+    std::vector<float> rowGradients( 4 * dim[0] );
+    float *nx = &rowGradients[0];
+    float *ny = nx + dim[0];
+    float *nz = ny + dim[0];
+    float *nt = nz + dim[0];
+    //ENDSLICERADD
+
     // Loop through all the data and compute the encoded normal and
     // gradient magnitude for each scalar location
     //TODO LimitGradients in same way as done in Helper Classes
@@ -265,118 +394,75 @@ void vtkSlicerFixedPointVolumeRayCastMapperComputeGradients( T *dataPtr,
             dirPtr  = gradientDirPtr    + (y * dim[0] + xlow)*increment;
             magPtr  = gradientMagPtr    + (y * dim[0] + xlow)*increment;
 
-            for ( x = xlow; x < xhigh; x++ )
+            //SLICERADD
+            // The voxels on the border of the volume (and those without
+            // gradient at a distance of 1) are computed voxel by voxel.
+            const bool innerRow = ( vectorized &&
+                                    z > 0 && z < dim[2] - 1 &&
+                                    y > 0 && y < dim[1] - 1 &&
+                                    xlow == 0 && xhigh == dim[0] && dim[0] > 2 );
+            if ( innerRow )
             {
                 for ( c = 0; ( independent && c < components ) || c == 0; c++ )
                 {
-                    cdptr   = dptr   + ((independent)?(c):(components-1));
-                    cdirPtr = dirPtr + ((independent)?(c):(0));
-                    cmagPtr = magPtr + ((independent)?(c):(0));
-
-                    // Allow up to 3 tries to find the gadient - looking out at a distance of
-                    // 1, 2, and 3 units.
-                    int foundGradient = 0;
-                    for ( int d = 1; d <= 3 && !foundGradient; d++ )
+                    int coffset = (independent)?(c):(components-1);
+                    T *rowPtr = dptr + coffset;
+                    for ( x = 1; x < dim[0] - 1; x++ )
                     {
-                        // Use a central difference method if possible,
-                        // otherwise use a forward or backward difference if
-                        // we are on the edge
-                        // Compute the X component
-                        if ( x < d && (cdptr+d*xstep) <= lastPixel )
-                        {
-                            n[0] = 2.0*((float)*(cdptr) - (float)*(cdptr+d*xstep));
-                        }
-                        else if ( x >= dim[0] - d && (cdptr-d*xstep) >= dataPtr )
-                        {
-                            n[0] = 2.0*((float)*(cdptr-d*xstep) - (float)*(cdptr));
-                        }
-                        else if ( (cdptr+d*xstep) <= lastPixel && (cdptr-d*xstep) >= dataPtr )
-                        {
-                            n[0] = (float)*(cdptr-d*xstep) - (float)*(cdptr+d*xstep);
-                        } 
-                        else 
-                        {
-                            n[0] = 0;
-                        }
-
-                        // Compute the Y component
-                        if ( y < d && (cdptr+d*ystep) <= lastPixel )
-                        {
-                            n[1] = 2.0*((float)*(cdptr) - (float)*(cdptr+d*ystep));
-                        }
-                        else if ( y >= dim[1] - d && (cdptr-d*ystep) >= dataPtr )
-                        {
-                            n[1] = 2.0*((float)*(cdptr-d*ystep) - (float)*(cdptr));
-                        }
-                        else if ( (cdptr+d*ystep) <= lastPixel && (cdptr-d*ystep) >= dataPtr )
-                        {
-                            n[1] = (float)*(cdptr-d*ystep) - (float)*(cdptr+d*ystep);
-                        } 
-                        else 
-                        {
-                            n[1] = 0;
-                        }
-
-                        // Compute the Z component
-                        if ( z < d && (cdptr+d*zstep) <= lastPixel )
-                        {
-                            n[2] = 2.0*((float)*(cdptr) - (float)*(cdptr+d*zstep));
-                        }
-                        else if ( z >= dim[2] - d && (cdptr-d*zstep) >= dataPtr )
-                        {
-                            n[2] = 2.0*((float)*(cdptr-d*zstep) - (float)*(cdptr));
-                        }
-                        else if ( (cdptr+d*zstep) <= lastPixel && (cdptr-d*zstep) >= dataPtr )
-                        {
-                            n[2] = (float)*(cdptr-d*zstep) - (float)*(cdptr+d*zstep);
-                        } 
-                        else 
-                        {
-                            n[2] = 0;
-                        }
-
-
-                        // Take care of the aspect ratio of the data
-                        // Scaling in the vtkVolume is isotropic, so this is the
-                        // only place we have to worry about non-isotropic scaling.
-                        n[0] /= d*aspect[0];
-                        n[1] /= d*aspect[1];
-                        n[2] /= d*aspect[2];
-
-                        // Compute the gradient magnitude
-                        t = sqrt( (double)( n[0]*n[0] +
-                            n[1]*n[1] +
-                            n[2]*n[2] ) );
-
-
-                        // Encode this into an 8 bit value
-                        gvalue = t * scale[c];
+                        T *p = rowPtr + x*xstep;
+                        float gx = (float)*(p-xstep) - (float)*(p+xstep);
+                        float gy = (float)*(p-ystep) - (float)*(p+ystep);
+                        float gz = (float)*(p-zstep) - (float)*(p+zstep);
+                        gx /= aspect[0];
+                        gy /= aspect[1];
+                        gz /= aspect[2];
+                        nx[x] = gx;
+                        ny[x] = gy;
+                        nz[x] = gz;
+                        nt[x] = sqrt( (double)( gx*gx + gy*gy + gz*gz ) );
+                    }
 
-                        if ( d > 1 )
+                    for ( x = 0; x < dim[0]; x++ )
+                    {
+                        cdptr   = rowPtr + x*xstep;
+                        cdirPtr = dirPtr + x*increment + ((independent)?(c):(0));
+                        cmagPtr = magPtr + x*increment + ((independent)?(c):(0));
+                        if ( x == 0 || x == dim[0] - 1 || !(nt[x] > tolerance[c]) )
                         {
-                            gvalue = 0;
+                            vtkSlicerFixedPointVolumeRayCastMapperComputeVoxelGradient(
+                                cdptr, dataPtr, lastPixel, x, y, z, dim,
+                                xstep, ystep, zstep, aspect, scale[c], tolerance[c],
+                                cdirPtr, cmagPtr, directionEncoder );
+                            continue;
                         }
-
+                        float t = nt[x];
+                        float gvalue = t * scale[c];
                         gvalue = (gvalue<0.0)?(0.0):(gvalue);
                         gvalue = (gvalue>255.0)?(255.0):(gvalue);
-
-                        // Normalize the gradient direction
-                        if ( t > tolerance[c] )
-                        {
-                            n[0] /= t;
-                            n[1] /= t;
-                            n[2] /= t;
-                            foundGradient = 1;
-                        }
-                        else
-                        {
-                            n[0] = n[1] = n[2] = 0.0;
-                        }
+                        float n[3];
+                        n[0] = nx[x] / t;
+                        n[1] = ny[x] / t;
+                        n[2] = nz[x] / t;
+                        *cmagPtr = static_cast<unsigned char>(gvalue + 0.5);
+                        *cdirPtr = directionEncoder->GetEncodedDirection( n );
                     }
+                }
+                continue;
+            }
+            //ENDSLICERADD
 
+            for ( x = xlow; x < xhigh; x++ )
+            {
+                for ( c = 0; ( independent && c < components ) || c == 0; c++ )
+                {
+                    cdptr   = dptr   + ((independent)?(c):(components-1));
+                    cdirPtr = dirPtr + ((independent)?(c):(0));
+                    cmagPtr = magPtr + ((independent)?(c):(0));
 
-                    *cmagPtr = static_cast<unsigned char>(gvalue + 0.5);
-                    *cdirPtr = directionEncoder->GetEncodedDirection( n );
+                    vtkSlicerFixedPointVolumeRayCastMapperComputeVoxelGradient(
+                        cdptr, dataPtr, lastPixel, x, y, z, dim,
+                        xstep, ystep, zstep, aspect, scale[c], tolerance[c],
+                        cdirPtr, cmagPtr, directionEncoder );
                 }
 
                 dptr    +=   components;
@@ -384,7 +470,10 @@ void vtkSlicerFixedPointVolumeRayCastMapperComputeGradients( T *dataPtr,
                 magPtr  +=   increment;
             }
         }
-        if ( z%8 == 7 )
+        //SLICERADD
+        // Only the first thread (the calling thread) reports the progress
+        if ( thread_id == 0 && z%8 == 7 && z_limit - z_start > 1 )
+        //ENDSLICERADD
         {
             float args[1];
             args[0] =
@@ -393,9 +482,48 @@ void vtkSlicerFixedPointVolumeRayCastMapperComputeGradients( T *dataPtr,
             me->InvokeEvent( vtkCommand::VolumeMapperComputeGradientsProgressEvent, args );
         }
     }
+}
 
-    me->InvokeEvent( vtkCommand::VolumeMapperComputeGradientsEndEvent, NULL );
+//SLICERADD
+// Arguments of the threaded gradient computation
+struct vtkSlicerFixedPointVolumeRayCastMapperGradientsInfo
+{
+    vtkSlicerFixedPointVolumeRayCastMapper *Mapper;
+    void                *DataPtr;
+    int                  ScalarType;
+    int                  Dimensions[3];
+    double               Spacing[3];
+    int                  Components;
+    int                  Independent;
+    double               ScalarRange[4][2];
+    vtkDirectionEncoder *DirectionEncoder;
+    int                  Vectorized;
+};
+
+VTK_THREAD_RETURN_TYPE SlicerFixedPointVolumeRayCastMapper_ComputeGradients( void *arg )
+{
+    int threadID    = ((vtkMultiThreader::ThreadInfo *)(arg))->ThreadID;
+    int threadCount = ((vtkMultiThreader::ThreadInfo *)(arg))->NumberOfThreads;
+
+    vtkSlicerFixedPointVolumeRayCastMapperGradientsInfo *info =
+        static_cast<vtkSlicerFixedPointVolumeRayCastMapperGradientsInfo *>
+        (((vtkMultiThreader::ThreadInfo *)arg)->UserData);
+
+    switch ( info->ScalarType )
+    {
+        vtkTemplateMacro(
+            vtkSlicerFixedPointVolumeRayCastMapperComputeGradients(
+            (VTK_TT *)(info->DataPtr), info->Dimensions, info->Spacing,
+            info->Components, info->Independent, info->ScalarRange,
+            info->Mapper->GetGradientNormal(),
+            info->Mapper->GetGradientMagnitude(),
+            info->DirectionEncoder,
+            info->Mapper, threadID, threadCount, info->Vectorized ) );
+    }
+
+    return VTK_THREAD_RETURN_VALUE;
 }
+//ENDSLICERADD
 
 // Construct a new vtkSlicerFixedPointVolumeRayCastMapper with default values
 vtkSlicerFixedPointVolumeRayCastMapper::vtkSlicerFixedPointVolumeRayCastMapper()
@@ -465,11 +593,18 @@ vtkSlicerFixedPointVolumeRayCastMapper::vtkSlicerFixedPointVolumeRayCastMapper()
     this->SavedGradientsInput          = NULL;
     this->SavedParametersInput         = NULL;
 
-    this->NumberOfGradientSlices       = 0;
     this->GradientNormal               = NULL;
     this->GradientMagnitude            = NULL;
-    this->ContiguousGradientNormal     = NULL;
-    this->ContiguousGradientMagnitude  = NULL;
+    //SLICERADD
+    this->GradientCache                = vtkSlicerFixedPointGradientCache::GetGlobalCache();
+    this->GradientCache->Register( this );
+    this->VectorizedGradients          = 1;
+
+    this->PreIntegration               = 0;
+    this->PreIntegrationTable          = NULL;
+    this->PreIntegrationShift          = 0;
+    this->PreIntegrationNumberOfBins   = 0;
+    //ENDSLICERADD
 
     this->DirectionEncoder             = vtkSphericalDirectionEncoder::New();
     this->GradientShader               = vtkEncodedGradientShader::New();
@@ -506,6 +641,19 @@ vtkSlicerFixedPointVolumeRayCastMapper::vtkSlicerFixedPointVolumeRayCastMapper()
     this->MinMaxVolumeSize[3] = 0;
     this->SavedMinMaxInput = NULL;
 
+    //SLICERADD
+    this->OctreeSpaceLeaping = 1;
+    this->MinMaxOctree = NULL;
+    this->MinMaxOctreeNumberOfLevels = 0;
+    for ( int level = 0; level < VTKKW_MINMAX_OCTREE_MAX_LEVELS; level++ )
+    {
+        this->MinMaxOctreeSize[level][0] = 0;
+        this->MinMaxOctreeSize[level][1] = 0;
+        this->MinMaxOctreeSize[level][2] = 0;
+        this->MinMaxOctreeOffset[level] = 0;
+    }
+    //ENDSLICERADD
+
     this->Volume = NULL;
     //SLICERADD
     this->ManualInteractive=0;
@@ -571,44 +719,9 @@ vtkSlicerFixedPointVolumeRayCastMapper::~vtkSlicerFixedPointVolumeRayCastMapper(
     delete [] this->RowBounds;
     delete [] this->OldRowBounds;
 
-    int i;
-    if ( this->GradientNormal )
-    {
-        // Contiguous? Delete in one chunk otherwise delete slice by slice
-        if ( this->ContiguousGradientNormal )
-        {
-            delete [] this->ContiguousGradientNormal;
-            this->ContiguousGradientNormal = NULL;
-        }
-        else
-        {
-            for ( i = 0; i < this->NumberOfGradientSlices; i++ )
-            {
-                delete [] this->GradientNormal[i];
-            }
-        }
-        delete [] this->GradientNormal;
-        this->GradientNormal = NULL;
-    }
-
-    if ( this->GradientMagnitude )
-    {
-        // Contiguous? Delete in one chunk otherwise delete slice by slice
-        if ( this->ContiguousGradientMagnitude )
-        {
-            delete [] this->ContiguousGradientMagnitude;
-            this->ContiguousGradientMagnitude = NULL;
-        }
-        else
-        {
-            for ( i = 0; i < this->NumberOfGradientSlices; i++ )
-            {
-                delete [] this->GradientMagnitude[i];
-            }
-        }
-        delete [] this->GradientMagnitude;
-        this->GradientMagnitude = NULL;
-    }
+    //SLICERADD
+    this->SetGradientCache( NULL );
+    //ENDSLICERADD
 
     this->DirectionEncoder->Delete();
     this->GradientShader->Delete();
@@ -620,6 +733,10 @@ vtkSlicerFixedPointVolumeRayCastMapper::~vtkSlicerFixedPointVolumeRayCastMapper(
 
     // Delete storage used by min/max volume
     delete [] this->MinMaxVolume;
+    //SLICERADD
+    delete [] this->MinMaxOctree;
+    delete [] this->PreIntegrationTable;
+    //ENDSLICERADD
 }
 
 float vtkSlicerFixedPointVolumeRayCastMapper::ComputeRequiredImageSampleDistance( float desiredTime,
@@ -1008,14 +1125,28 @@ void vtkSlicerFixedPointVolumeRayCastMapper::UpdateMinMaxVolume( vtkVolume *vol
     int zero = 0;
     int nonZero = 0;
 
+    //SLICERADD
+    // Only the octree nodes above the cells whose flag changed need to be
+    // updated, unless the min/max values were recomputed
+    int rebuildOctree = ( needToUpdate&0x06 ) ||
+        this->MinMaxOctreeSize[0][0] != this->MinMaxVolumeSize[0] ||
+        this->MinMaxOctreeSize[0][1] != this->MinMaxVolumeSize[1] ||
+        this->MinMaxOctreeSize[0][2] != this->MinMaxVolumeSize[2];
+    std::vector<int> changedCells;
+    int cellId = 0;
+    //ENDSLICERADD
+
     for ( k = 0; k < this->MinMaxVolumeSize[2]; k++ )
     {
         for ( j = 0; j < this->MinMaxVolumeSize[1]; j++ )
         {
-            for ( i = 0; i < this->MinMaxVolumeSize[0]; i++ )
+            for ( i = 0; i < this->MinMaxVolumeSize[0]; i++, cellId++ )
             {
                 for ( c = 0; c < this->MinMaxVolumeSize[3]; c++ )
                 {
+                    //SLICERADD
+                    unsigned short previousFlag = tmpPtr[2]&0x00ff;
+                    //ENDSLICERADD
                     // We definite have 0 opacity because our maximum scalar value in
                     // this region is below the minimum scalar value with non-zero opacity
                     // for this component
@@ -1069,6 +1200,13 @@ void vtkSlicerFixedPointVolumeRayCastMapper::UpdateMinMaxVolume( vtkVolume *vol
                             zero++;
                         }
                     }
+                    //SLICERADD
+                    if ( c == 0 && !rebuildOctree &&
+                         previousFlag != (tmpPtr[2]&0x00ff) )
+                    {
+                        changedCells.push_back( cellId );
+                    }
+                    //ENDSLICERADD
                     tmpPtr += 3;
                 }
             }
@@ -1077,8 +1215,119 @@ void vtkSlicerFixedPointVolumeRayCastMapper::UpdateMinMaxVolume( vtkVolume *vol
 
     this->SavedMinMaxFlagTime.Modified();
 
+    //SLICERADD
+    this->UpdateMinMaxOctree( changedCells.empty() ? NULL : &changedCells[0],
+                              static_cast<int>(changedCells.size()), rebuildOctree );
+    //ENDSLICERADD
 }
 
+//SLICERADD
+void vtkSlicerFixedPointVolumeRayCastMapper::UpdateMinMaxOctree( int *changedCells,
+                                                                int numberOfChangedCells,
+                                                                int rebuild )
+{
+    int level;
+    if ( rebuild )
+    {
+        // Halve the size until there is only one node
+        this->MinMaxOctreeSize[0][0] = this->MinMaxVolumeSize[0];
+        this->MinMaxOctreeSize[0][1] = this->MinMaxVolumeSize[1];
+        this->MinMaxOctreeSize[0][2] = this->MinMaxVolumeSize[2];
+        int numberOfNodes = 0;
+        for ( level = 1; level < VTKKW_MINMAX_OCTREE_MAX_LEVELS; level++ )
+        {
+            int *size = this->MinMaxOctreeSize[level-1];
+            if ( size[0] <= 1 && size[1] <= 1 && size[2] <= 1 )
+            {
+                break;
+            }
+            this->MinMaxOctreeOffset[level] = numberOfNodes;
+            this->MinMaxOctreeSize[level][0] = (size[0] + 1) / 2;
+            this->MinMaxOctreeSize[level][1] = (size[1] + 1) / 2;
+            this->MinMaxOctreeSize[level][2] = (size[2] + 1) / 2;
+            numberOfNodes += this->MinMaxOctreeSize[level][0] *
+                this->MinMaxOctreeSize[level][1] *
+                this->MinMaxOctreeSize[level][2];
+        }
+        this->MinMaxOctreeNumberOfLevels = level;
+        delete [] this->MinMaxOctree;
+        this->MinMaxOctree = new unsigned char [numberOfNodes > 0 ? numberOfNodes : 1];
+    }
+
+    // Nodes to update at the current level, as indices in the level below
+    std::vector<int> changed;
+    if ( !rebuild )
+    {
+        changed.assign( changedCells, changedCells + numberOfChangedCells );
+    }
+    for ( level = 1; level < this->MinMaxOctreeNumberOfLevels; level++ )
+    {
+        int *childSize = this->MinMaxOctreeSize[level-1];
+        int *size = this->MinMaxOctreeSize[level];
+        unsigned char *nodes = this->MinMaxOctree + this->MinMaxOctreeOffset[level];
+
+        // The nodes to update
+        std::vector<int> parents;
+        if ( rebuild )
+        {
+            parents.resize( size[0] * size[1] * size[2] );
+            for ( int n = 0; n < static_cast<int>(parents.size()); n++ )
+            {
+                parents[n] = n;
+            }
+        }
+        else
+        {
+            if ( changed.empty() )
+            {
+                return;
+            }
+            for ( size_t n = 0; n < changed.size(); n++ )
+            {
+                int x = changed[n] % childSize[0];
+                int y = ( changed[n] / childSize[0] ) % childSize[1];
+                int z = changed[n] / ( childSize[0] * childSize[1] );
+                parents.push_back( ( (z/2) * size[1] + y/2 ) * size[0] + x/2 );
+            }
+            std::sort( parents.begin(), parents.end() );
+            parents.erase( std::unique( parents.begin(), parents.end() ), parents.end() );
+        }
+
+        changed.clear();
+        for ( size_t n = 0; n < parents.size(); n++ )
+        {
+            int x = parents[n] % size[0];
+            int y = ( parents[n] / size[0] ) % size[1];
+            int z = parents[n] / ( size[0] * size[1] );
+            unsigned char value = 0;
+            for ( int cz = 2*z; cz < 2*z+2 && cz < childSize[2] && !value; cz++ )
+            {
+                for ( int cy = 2*y; cy < 2*y+2 && cy < childSize[1] && !value; cy++ )
+                {
+                    for ( int cx = 2*x; cx < 2*x+2 && cx < childSize[0] && !value; cx++ )
+                    {
+                        int child = ( cz * childSize[1] + cy ) * childSize[0] + cx;
+                        if ( level == 1 )
+                        {
+                            value = (this->MinMaxVolume[3*this->MinMaxVolumeSize[3]*child + 2]&0x00ff) ? 1 : 0;
+                        }
+                        else
+                        {
+                            value = this->MinMaxOctree[this->MinMaxOctreeOffset[level-1] + child];
+                        }
+                    }
+                }
+            }
+            if ( rebuild || nodes[parents[n]] != value )
+            {
+                nodes[parents[n]] = value;
+                changed.push_back( parents[n] );
+            }
+        }
+    }
+}
+//ENDSLICERADD
+
 void vtkSlicerFixedPointVolumeRayCastMapper::UpdateCroppingRegions()
 {
     this->ConvertCroppingRegionPlanesToVoxels();
@@ -1220,6 +1469,9 @@ void vtkSlicerFixedPointVolumeRayCastMapper::PerVolumeInitialization( vtkRendere
     this->Volume = vol;
 
     this->UpdateColorTable( vol );
+    //SLICERADD
+    this->UpdatePreIntegrationTable();
+    //ENDSLICERADD
     this->UpdateGradients( vol );
     this->UpdateShadingTable( ren, vol );
     this->UpdateMinMaxVolume( vol );
@@ -2522,123 +2774,77 @@ void vtkSlicerFixedPointVolumeRayCastMapper::ComputeGradients( vtkVolume *vol )
     int components   = input->GetPointData()->GetScalars()->GetNumberOfComponents();
     int independent  = vol->GetProperty()->GetIndependentComponents();
 
-    int dim[3];
-    double spacing[3];
-    input->GetDimensions(dim);
-    input->GetSpacing(spacing);
-
-    // Find the scalar range
-    double scalarRange[4][2];
-    int c;
-    for ( c = 0; c < components; c++ )
+    //SLICERADD
+    // The gradients are shared by all the mappers rendering the same input,
+    // they are computed by the first one.
+    if ( !this->GradientCache )
     {
-        input->GetPointData()->GetScalars()->GetRange(scalarRange[c], c);
+        this->SetGradientCache( vtkSlicerFixedPointGradientCache::GetGlobalCache() );
     }
-
-    int sliceSize = dim[0]*dim[1]*((independent)?(components):(1));
-    int numSlices = dim[2];
-
-    int i;
-
-    // Delete the prior gradient normal information
-    if ( this->GradientNormal )
+    int computed = 0;
+    vtkSlicerFixedPointGradientCache::Gradients *gradients =
+        this->GradientCache->AcquireGradients( this, input, independent,
+                                               this->DirectionEncoder, computed );
+    this->GradientNormal    = gradients->Normal;
+    this->GradientMagnitude = gradients->Magnitude;
+    if ( computed )
     {
-        // Contiguous? Delete in one chunk otherwise delete slice by slice
-        if ( this->ContiguousGradientNormal )
-        {
-            delete [] this->ContiguousGradientNormal;
-            this->ContiguousGradientNormal = NULL;
-        }
-        else
-        {
-            for ( i = 0; i < this->NumberOfGradientSlices; i++ )
-            {
-                delete [] this->GradientNormal[i];
-            }
-        }
-        delete [] this->GradientNormal;
-        this->GradientNormal = NULL;
+        return;
     }
 
-    // Delete the prior gradient magnitude information
-    if ( this->GradientMagnitude )
+    vtkSlicerFixedPointVolumeRayCastMapperGradientsInfo info;
+    info.Mapper           = this;
+    info.DataPtr          = dataPtr;
+    info.ScalarType       = scalarType;
+    input->GetDimensions(info.Dimensions);
+    input->GetSpacing(info.Spacing);
+    info.Components       = components;
+    info.Independent      = independent;
+    info.DirectionEncoder = this->DirectionEncoder;
+    info.Vectorized       = this->VectorizedGradients;
+
+    // Find the scalar range
+    int c;
+    for ( c = 0; c < components; c++ )
     {
-        // Contiguous? Delete in one chunk otherwise delete slice by slice
-        if ( this->ContiguousGradientMagnitude )
-        {
-            delete [] this->ContiguousGradientMagnitude;
-            this->ContiguousGradientMagnitude = NULL;
-        }
-        else
-        {
-            for ( i = 0; i < this->NumberOfGradientSlices; i++ )
-            {
-                delete [] this->GradientMagnitude[i];
-            }
-        }
-        delete [] this->GradientMagnitude;
-        this->GradientMagnitude = NULL;
+        input->GetPointData()->GetScalars()->GetRange(info.ScalarRange[c], c);
     }
 
-    this->NumberOfGradientSlices = numSlices;
-    this->GradientNormal  = new unsigned short *[numSlices];
-    this->GradientMagnitude = new unsigned char *[numSlices];
+    this->InvokeEvent( vtkCommand::VolumeMapperComputeGradientsStartEvent, NULL );
 
-    // first, attempt contiguous memory. If this fails, then go
-    // for non-contiguous
-    this->ContiguousGradientNormal = new unsigned short [numSlices * sliceSize];
-    this->ContiguousGradientMagnitude = new unsigned char [numSlices * sliceSize];
+    // Each thread computes a slab of slices
+    this->Threader->SetSingleMethod( SlicerFixedPointVolumeRayCastMapper_ComputeGradients,
+                                     static_cast<void *>(&info) );
+    this->Threader->SingleMethodExecute();
 
-    if ( this->ContiguousGradientNormal )
-    {
-        // We were able to allocate contiguous space - we just need to set the
-        // slice pointers here
-        for ( i = 0; i < numSlices; i++ )
-        {
-            this->GradientNormal[i]  = this->ContiguousGradientNormal + i*sliceSize;
-        }
-    }
-    else
-    {
-        // We were not able to allocate contigous space - allocate it slice by slice
-        for ( i = 0; i < numSlices; i++ )
-        {
-            this->GradientNormal[i]  = new unsigned short [sliceSize];
-        }
-    }
+    this->InvokeEvent( vtkCommand::VolumeMapperComputeGradientsEndEvent, NULL );
+    //ENDSLICERADD
+}
 
-    if ( this->ContiguousGradientMagnitude )
+//SLICERADD
+void vtkSlicerFixedPointVolumeRayCastMapper::SetGradientCache( vtkSlicerFixedPointGradientCache *cache )
+{
+    if ( this->GradientCache == cache )
     {
-        // We were able to allocate contiguous space - we just need to set the
-        // slice pointers here
-        for ( i = 0; i < numSlices; i++ )
-        {
-            this->GradientMagnitude[i]  = this->ContiguousGradientMagnitude + i*sliceSize;
-        }
+        return;
     }
-    else
+    if ( this->GradientCache )
     {
-        // We were not able to allocate contigous space - allocate it slice by slice
-        for ( i = 0; i < numSlices; i++ )
-        {
-            this->GradientMagnitude[i] = new unsigned char [sliceSize];
-        }
+        this->GradientCache->ReleaseGradients( this );
+        this->GradientCache->UnRegister( this );
     }
-
-
-
-    switch ( scalarType )
+    this->GradientCache = cache;
+    if ( this->GradientCache )
     {
-        vtkTemplateMacro(
-            vtkSlicerFixedPointVolumeRayCastMapperComputeGradients(
-            (VTK_TT *)(dataPtr), dim, spacing, components,
-            independent, scalarRange,
-            this->GradientNormal,
-            this->GradientMagnitude,
-            this->DirectionEncoder,
-            this) );
+        this->GradientCache->Register( this );
     }
+    // The gradients are acquired from the new cache at the next render
+    this->GradientNormal    = NULL;
+    this->GradientMagnitude = NULL;
+    this->SavedGradientsInput = NULL;
+    this->Modified();
 }
+//ENDSLICERADD
 
 int vtkSlicerFixedPointVolumeRayCastMapper::UpdateShadingTable( vtkRenderer *ren,
                                                                vtkVolume *vol )
@@ -3090,6 +3296,104 @@ int vtkSlicerFixedPointVolumeRayCastMapper::UpdateColorTable( vtkVolume *vol )
     return 1;
 }
 
+//SLICERADD
+// Build the preintegration table from the color and scalar opacity tables
+// of the first component - this must be called after UpdateColorTable.
+// The opacity table is already corrected for the sample distance, so it
+// gives the extinction over one step for each scalar index. Assuming the
+// scalar varies linearly along a step, the extinction of the segment is
+// the mean extinction of the scalar indices between its two ends and its
+// color is their mean color weighted by extinction (the attenuation within
+// the segment is neglected). Prefix sums over the scalar indices give each
+// mean in constant time. The ends of the segment are binned to keep the
+// table small, a segment starting and ending in the same bin covers the
+// whole bin, otherwise it spans from the center of one bin to the other.
+void vtkSlicerFixedPointVolumeRayCastMapper::UpdatePreIntegrationTable()
+{
+    vtkImageData *input = this->GetInput();
+    if ( !this->PreIntegration ||
+        this->BlendMode != vtkVolumeMapper::COMPOSITE_BLEND ||
+        input->GetNumberOfScalarComponents() != 1 )
+    {
+        delete [] this->PreIntegrationTable;
+        this->PreIntegrationTable = NULL;
+        return;
+    }
+
+    // The tables only change in UpdateColorTable
+    if ( this->PreIntegrationTable &&
+        this->PreIntegrationTableBuildTime.GetMTime() >
+        this->SavedParametersMTime.GetMTime() )
+    {
+        return;
+    }
+
+    int tableSize = this->TableSize[0];
+    int shift = 0;
+    while ( ((tableSize-1) >> shift) > 255 )
+    {
+        shift++;
+    }
+    int numBins = ((tableSize-1) >> shift) + 1;
+
+    if ( !this->PreIntegrationTable || numBins != this->PreIntegrationNumberOfBins )
+    {
+        delete [] this->PreIntegrationTable;
+        this->PreIntegrationTable = new unsigned short [4*numBins*numBins];
+    }
+    this->PreIntegrationShift        = shift;
+    this->PreIntegrationNumberOfBins = numBins;
+
+    std::vector<double> sumTau( tableSize+1, 0.0 );
+    std::vector<double> sumColorTau( 3*(tableSize+1), 0.0 );
+    int i;
+    for ( i = 0; i < tableSize; i++ )
+    {
+        double alpha = this->ScalarOpacityTable[0][i] / static_cast<double>(VTKKW_FP_SCALE);
+        double tau   = -log( 1.0 - std::min( alpha, 0.99999 ) );
+        sumTau[i+1]  = sumTau[i] + tau;
+        for ( int j = 0; j < 3; j++ )
+        {
+            sumColorTau[3*(i+1)+j] = sumColorTau[3*i+j] + tau *
+                this->ColorTable[0][3*i+j] / static_cast<double>(VTKKW_FP_SCALE);
+        }
+    }
+
+    int binSize = 1 << shift;
+    unsigned short *entry = this->PreIntegrationTable;
+    for ( int front = 0; front < numBins; front++ )
+    {
+        for ( int back = 0; back < numBins; back++ )
+        {
+            int first, last;
+            if ( front == back )
+            {
+                first = front*binSize;
+                last  = std::min( first + binSize, tableSize ) - 1;
+            }
+            else
+            {
+                first = std::min( std::min( front, back )*binSize + binSize/2, tableSize-1 );
+                last  = std::min( std::max( front, back )*binSize + binSize/2, tableSize-1 );
+            }
+
+            double count   = last - first + 1;
+            double meanTau = (sumTau[last+1] - sumTau[first]) / count;
+            double alpha   = 1.0 - exp( -meanTau );
+            for ( int j = 0; j < 3; j++ )
+            {
+                double color = ( meanTau > 0.0 ) ?
+                    ((sumColorTau[3*(last+1)+j] - sumColorTau[3*first+j]) / count / meanTau) : 0.0;
+                entry[j] = static_cast<unsigned short>(color*alpha*VTKKW_FP_SCALE + 0.5);
+            }
+            entry[3] = static_cast<unsigned short>(alpha*VTKKW_FP_SCALE + 0.5);
+            entry += 4;
+        }
+    }
+
+    this->PreIntegrationTableBuildTime.Modified();
+}
+//ENDSLICERADD
 
 int vtkSlicerFixedPointVolumeRayCastMapper::ShouldUseNearestNeighborInterpolation( vtkVolume *vol )
 {
@@ -3120,6 +3424,11 @@ void vtkSlicerFixedPointVolumeRayCastMapper::PrintSelf(ostream& os, vtkIndent in
     os << indent << "ShadingRequired: " << this->ShadingRequired << endl;
     os << indent << "GradientOpacityRequired: " << this->GradientOpacityRequired
         << endl;
+    //SLICERADD
+    os << indent << "PreIntegration: " << this->PreIntegration << endl;
+    os << indent << "OctreeSpaceLeaping: " << this->OctreeSpaceLeaping << endl;
+    os << indent << "VectorizedGradients: " << this->VectorizedGradients << endl;
+    //ENDSLICERADD
 
     if ( this->RayCastImage )
     {
@@ -63,6 +63,10 @@ void qSlicerCPURayCastVolumeRenderingPropertiesWidgetPrivate
   this->populateRenderingTechniqueComboBox();
   QObject::connect(this->RenderingTechniqueComboBox, SIGNAL(currentIndexChanged(int)),
                    widget, SLOT(setRenderingTechnique(int)));
+  QObject::connect(this->ProgressiveRenderingCheckBox, SIGNAL(toggled(bool)),
+                   widget, SLOT(setProgressiveRendering(bool)));
+  QObject::connect(this->PreIntegrationCheckBox, SIGNAL(toggled(bool)),
+                   widget, SLOT(setPreIntegration(bool)));
 }
 
 // --------------------------------------------------------------------------
@@ -123,6 +127,10 @@ void qSlicerCPURayCastVolumeRenderingPropertiesWidget
     index = 0;
     }
   d->RenderingTechniqueComboBox->setCurrentIndex(index);
+  d->ProgressiveRenderingCheckBox->setChecked(
+    this->mrmlCPURayCastDisplayNode()->GetProgressiveRendering() != 0);
+  d->PreIntegrationCheckBox->setChecked(
+    this->mrmlCPURayCastDisplayNode()->GetPreIntegration() != 0);
 }
 
 //-----------------------------------------------------------------------------
@@ -137,3 +145,25 @@ void qSlicerCPURayCastVolumeRenderingPropertiesWidget
   int technique = d->RenderingTechniqueComboBox->itemData(index).toInt();
   this->mrmlCPURayCastDisplayNode()->SetRaycastTechnique(technique);
 }
+
+//-----------------------------------------------------------------------------
+void qSlicerCPURayCastVolumeRenderingPropertiesWidget
+::setProgressiveRendering(bool enable)
+{
+  if (!this->mrmlCPURayCastDisplayNode())
+    {
+    return;
+    }
+  this->mrmlCPURayCastDisplayNode()->SetProgressiveRendering(enable ? 1 : 0);
+}
+
+//-----------------------------------------------------------------------------
+void qSlicerCPURayCastVolumeRenderingPropertiesWidget
+::setPreIntegration(bool enable)
+{
+  if (!this->mrmlCPURayCastDisplayNode())
+    {
+    return;
+    }
+  this->mrmlCPURayCastDisplayNode()->SetPreIntegration(enable ? 1 : 0);
+}
@@ -269,8 +269,8 @@ class DataProbeInfoWidget(object):
         valueLabel = ""
         if volumeNode:
           nameLabel = self.fitName(volumeNode.GetName())
-          xyToIJK = layerLogic.GetXYToIJKTransform().GetMatrix()
-          ijkFloat = xyToIJK.MultiplyPoint(xyz+(1,))[:3]
+          xyToIJK = layerLogic.GetXYToIJKResliceTransform()
+          ijkFloat = xyToIJK.TransformPoint(xyz)
           ijk = []
           for element in ijkFloat:
             try:
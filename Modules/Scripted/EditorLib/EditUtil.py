@@ -200,17 +200,22 @@ class UndoRedo(object):
   class checkPoint(object):
     """Internal class to store one checkpoint
     step consisting of the stashed data
-    and the volumeNode it corresponds to
+    and the volumeNode it corresponds to.
+    The data is stashed in chunks: the chunks that did not
+    change since the reference checkPoint are shared with it.
     """
-    def __init__(self,volumeNode):
+    def __init__(self,volumeNode,reference=None):
       self.volumeNode = volumeNode
       self.stashImage = vtk.vtkImageData()
       self.stash = slicer.vtkImageStash()
       self.stashImage.DeepCopy( volumeNode.GetImageData() )
       self.stash.SetStashImage( self.stashImage )
+      self.stash.ChunkedOn()
+      if reference:
+        self.stash.SetReferenceStash( reference.stash )
       self.stash.ThreadedStash()
 
-    def restore(self):
+    def restore(self,current=None):
       """Unstash the volume but first check that the
       stash operation is not still ongoing in the other thread.
       TODO: the stash operation is determinisitic, so there's
@@ -223,6 +228,14 @@ class UndoRedo(object):
       """
       while self.stash.GetStashing():
         pass
+      # when the volume holds the data of the current checkPoint,
+      # only the chunks that differ need to be decompressed
+      if current and current.volumeNode == self.volumeNode:
+        while current.stash.GetStashing():
+          pass
+        if self.stash.UnstashInto( self.volumeNode.GetImageData(), current.stash ):
+          EditUtil().markVolumeNodeAsModified(self.volumeNode)
+          return
       self.stash.Unstash()
       self.volumeNode.GetImageData().DeepCopy( self.stashImage )
       EditUtil().markVolumeNodeAsModified(self.volumeNode)
@@ -250,14 +263,22 @@ class UndoRedo(object):
     """for managing undo/redo button state"""
     return self.enabled and self.redoList != []
 
-  def storeVolume(self,checkPointList,volumeNode):
+  def storeVolume(self,checkPointList,volumeNode,reference=None):
     """ Internal helper function
     Save a stashed copy of the given volume node into
-    the passed list (could be undo or redo list)
+    the passed list (could be undo or redo list).
+    The unchanged chunks are shared with the reference checkPoint,
+    the last one of the list by default.
     """
     if not self.enabled or not volumeNode or not volumeNode.GetImageData():
       return
-    checkPointList.append( self.checkPoint(volumeNode) )
+    if not reference and checkPointList != []:
+      reference = checkPointList[-1]
+    # the stashing threads leave the sharing of the chunks and the
+    # release of the references to this thread
+    for checkPoint in checkPointList:
+      checkPoint.stash.ShareChunks()
+    checkPointList.append( self.checkPoint(volumeNode,reference) )
     self.stateChangedCallback()
     if len(checkPointList) >= self.undoSize:
       return( checkPointList[1:] )
@@ -281,9 +302,9 @@ class UndoRedo(object):
     if self.undoList == []:
       return
     # store current state onto redoList
-    self.redoList = self.storeVolume( self.redoList, self.editUtil.getLabelVolume() )
+    self.redoList = self.storeVolume( self.redoList, self.editUtil.getLabelVolume(), self.undoList[-1] )
     # get the checkPoint to restore and remove it from the list
-    self.undoList[-1].restore()
+    self.undoList[-1].restore(self.redoList[-1] if self.redoList else None)
     self.undoList = self.undoList[:-1]
     self.stateChangedCallback()
 
@@ -296,8 +317,8 @@ class UndoRedo(object):
     if self.redoList == []:
       return
     # store current state onto undoList
-    self.undoList = self.storeVolume( self.undoList, self.editUtil.getLabelVolume() )
+    self.undoList = self.storeVolume( self.undoList, self.editUtil.getLabelVolume(), self.redoList[-1] )
     # get the checkPoint to restore and remove it from the list
-    self.redoList[-1].restore()
+    self.redoList[-1].restore(self.undoList[-1] if self.undoList else None)
     self.redoList = self.redoList[:-1]
     self.stateChangedCallback()
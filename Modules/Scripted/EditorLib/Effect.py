@@ -301,8 +301,8 @@ class EffectLogic(object):
 
   def layerXYToIJK(self,layerLogic,xyPoint):
     """return i j k in image space of the layer for a given x y"""
-    xyToIJK = layerLogic.GetXYToIJKTransform().GetMatrix()
-    ijk = xyToIJK.MultiplyPoint(xyPoint + (0,1,))[:3]
+    xyToIJK = layerLogic.GetXYToIJKResliceTransform()
+    ijk = xyToIJK.TransformPoint(xyPoint + (0,))
     i = int(round(ijk[0]))
     j = int(round(ijk[1]))
     k = int(round(ijk[2]))
@@ -416,6 +416,8 @@ class EffectLogic(object):
     slice view for the given layerLogic
     - optionally set those as the corners of a vtkImageSlicePaint"""
 
+    # the corners only map the slice linearly, even when the volume is
+    # under a nonlinear transform
     xyToIJK = layerLogic.GetXYToIJKTransform().GetMatrix()
     w,h,d = layerLogic.GetImageData().GetDimensions()
     xyCorners = ( (0,0), (w,0), (0,h), (w,h) )
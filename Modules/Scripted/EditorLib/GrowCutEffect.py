@@ -123,9 +123,13 @@ class GrowCutEffectLogic(Effect.EffectLogic):
 
   def __init__(self,sliceLogic):
     super(GrowCutEffectLogic,self).__init__(sliceLogic)
+    # the filter is kept so that running GrowCut again after adding seeds
+    # restarts from the previous segmentation
+    self.growCutFilter = vtkITK.vtkITKGrowCutSegmentationImageFilter()
+    self.growCutFilter.UsePreviousSegmentationOn()
 
   def growCut(self):
-    growCutFilter = vtkITK.vtkITKGrowCutSegmentationImageFilter()
+    growCutFilter = self.growCutFilter
     background = self.getScopedBackground()
     gestureInput = self.getScopedLabelInput()
     growCutOutput = self.getScopedLabelOutput()
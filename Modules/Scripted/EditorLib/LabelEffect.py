@@ -367,6 +367,8 @@ class LabelEffectLogic(Effect.EffectLogic):
 
     xlo, xhi, ylo, yhi, zlo, zhi = bounds
     labelLogic = self.sliceLogic.GetLabelLayer()
+    # the corners only map the slice linearly, even when the label volume
+    # is under a nonlinear transform
     xyToIJK = labelLogic.GetXYToIJKTransform().GetMatrix()
     tlIJK = xyToIJK.MultiplyPoint( (xlo, yhi, 0, 1) )[:3]
     trIJK = xyToIJK.MultiplyPoint( (xhi, yhi, 0, 1) )[:3]
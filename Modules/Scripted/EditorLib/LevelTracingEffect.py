@@ -182,6 +182,8 @@ class LevelTracingEffectTool(LabelEffect.LabelEffectTool):
     polyData = self.tracingFilter.GetOutput()
 
     backgroundLayer = self.logic.sliceLogic.GetBackgroundLayer()
+    # linear only: the traced outline is not bent by a nonlinear transform
+    # of the background volume
     xyToIJK = backgroundLayer.GetXYToIJKTransform().GetMatrix()
     self.ijkToXY.SetMatrix( xyToIJK )
     self.ijkToXY.Inverse()
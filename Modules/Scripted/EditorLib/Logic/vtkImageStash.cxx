@@ -16,10 +16,214 @@
 
 #include "vtkPointData.h"
 #include "vtkObjectFactory.h"
+#include "vtkSmartPointer.h"
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
 
 vtkCxxRevisionMacro(vtkImageStash, "$Revision: 12690 $");
 vtkStandardNewMacro(vtkImageStash);
 
+//----------------------------------------------------------------------------
+// Each chunk starts with its codec: the raw bytes, or runs of identical
+// tuples stored as a count followed by the tuple (label maps are mostly
+// long runs of the same label).
+class vtkImageStash::vtkInternal
+{
+public:
+  enum
+    {
+    Raw = 0,
+    RunLength = 1
+    };
+
+  vtkInternal()
+    {
+    this->ChunkSize = 0;
+    this->DataSize = 0;
+    this->TupleSize = 1;
+    }
+
+  vtkIdType GetChunkLength(vtkIdType chunk)
+    {
+    return std::min(this->ChunkSize, this->DataSize - chunk * this->ChunkSize);
+    }
+
+  bool HasSameLayout(vtkInternal *other)
+    {
+    return other->ChunkSize == this->ChunkSize &&
+           other->DataSize == this->DataSize &&
+           other->TupleSize == this->TupleSize &&
+           other->Chunks.size() == this->Chunks.size();
+    }
+
+  static bool IsSameChunk(vtkUnsignedCharArray *chunk, const std::vector<unsigned char>& encoded);
+  static bool IsSameChunk(vtkUnsignedCharArray *chunk, vtkUnsignedCharArray *other);
+  static void EncodeChunk(const unsigned char *data, vtkIdType length, int tupleSize,
+                          std::vector<unsigned char>& encoded);
+  static void DecodeChunk(vtkUnsignedCharArray *chunk, int tupleSize,
+                          unsigned char *data, vtkIdType length);
+
+  struct ThreadStruct
+    {
+    vtkInternal *Self;
+    vtkInternal *Reference;
+    unsigned char *Data;
+    std::vector<std::vector<unsigned char> > Encoded;
+    };
+  static VTK_THREAD_RETURN_TYPE StashThread(void *arg);
+  static VTK_THREAD_RETURN_TYPE UnstashThread(void *arg);
+  void RunThreads(vtkThreadFunctionType function, ThreadStruct *str);
+
+  std::vector<vtkSmartPointer<vtkUnsignedCharArray> > Chunks;
+  /// Size in bytes of the chunks (the last one can be smaller)
+  vtkIdType ChunkSize;
+  /// Size in bytes of the stashed scalars
+  vtkIdType DataSize;
+  /// Size in bytes of a tuple of the stashed scalars
+  int TupleSize;
+};
+
+//----------------------------------------------------------------------------
+bool vtkImageStash::vtkInternal::IsSameChunk(vtkUnsignedCharArray *chunk,
+                                             const std::vector<unsigned char>& encoded)
+{
+  return chunk &&
+         chunk->GetNumberOfTuples() == static_cast<vtkIdType>(encoded.size()) &&
+         memcmp(chunk->GetPointer(0), &encoded[0], encoded.size()) == 0;
+}
+
+//----------------------------------------------------------------------------
+bool vtkImageStash::vtkInternal::IsSameChunk(vtkUnsignedCharArray *chunk,
+                                             vtkUnsignedCharArray *other)
+{
+  if (chunk == other)
+    {
+    return true;
+    }
+  return chunk && other &&
+         chunk->GetNumberOfTuples() == other->GetNumberOfTuples() &&
+         memcmp(chunk->GetPointer(0), other->GetPointer(0),
+                chunk->GetNumberOfTuples()) == 0;
+}
+
+//----------------------------------------------------------------------------
+void vtkImageStash::vtkInternal::EncodeChunk(const unsigned char *data, vtkIdType length,
+                                            int tupleSize, std::vector<unsigned char>& encoded)
+{
+  encoded.clear();
+  encoded.push_back(RunLength);
+  const vtkIdType numberOfTuples = length / tupleSize;
+  const size_t runSize = sizeof(unsigned int) + tupleSize;
+  vtkIdType tuple = 0;
+  while (tuple < numberOfTuples)
+    {
+    const unsigned char *value = data + tuple * tupleSize;
+    unsigned int count = 1;
+    while (tuple + count < static_cast<vtkIdType>(numberOfTuples) &&
+           count < VTK_UNSIGNED_INT_MAX &&
+           memcmp(value, value + count * tupleSize, tupleSize) == 0)
+      {
+      ++count;
+      }
+    if (encoded.size() + runSize > static_cast<size_t>(length))
+      {
+      // noise does not compress, keep the chunk as is
+      encoded.resize(length + 1);
+      encoded[0] = Raw;
+      memcpy(&encoded[1], data, length);
+      return;
+      }
+    size_t position = encoded.size();
+    encoded.resize(position + runSize);
+    memcpy(&encoded[position], &count, sizeof(unsigned int));
+    memcpy(&encoded[position + sizeof(unsigned int)], value, tupleSize);
+    tuple += count;
+    }
+}
+
+//----------------------------------------------------------------------------
+void vtkImageStash::vtkInternal::DecodeChunk(vtkUnsignedCharArray *chunk, int tupleSize,
+                                            unsigned char *data, vtkIdType length)
+{
+  const unsigned char *encoded = chunk->GetPointer(0);
+  const unsigned char *end = encoded + chunk->GetNumberOfTuples();
+  if (*encoded == Raw)
+    {
+    memcpy(data, encoded + 1, length);
+    return;
+    }
+  ++encoded;
+  unsigned char *dataEnd = data + length;
+  while (encoded < end && data < dataEnd)
+    {
+    unsigned int count;
+    memcpy(&count, encoded, sizeof(unsigned int));
+    const unsigned char *value = encoded + sizeof(unsigned int);
+    if (tupleSize == 1)
+      {
+      memset(data, *value, count);
+      data += count;
+      }
+    else
+      {
+      for (unsigned int i = 0; i < count; ++i, data += tupleSize)
+        {
+        memcpy(data, value, tupleSize);
+        }
+      }
+    encoded = value + tupleSize;
+    }
+}
+
+//----------------------------------------------------------------------------
+VTK_THREAD_RETURN_TYPE vtkImageStash::vtkInternal::StashThread(void *arg)
+{
+  vtkMultiThreader::ThreadInfo *info = static_cast<vtkMultiThreader::ThreadInfo*>(arg);
+  ThreadStruct *str = static_cast<ThreadStruct*>(info->UserData);
+  vtkInternal *self = str->Self;
+  const vtkIdType numberOfChunks = static_cast<vtkIdType>(self->Chunks.size());
+  for (vtkIdType chunk = info->ThreadID; chunk < numberOfChunks; chunk += info->NumberOfThreads)
+    {
+    EncodeChunk(str->Data + chunk * self->ChunkSize, self->GetChunkLength(chunk),
+                self->TupleSize, str->Encoded[chunk]);
+    }
+  return VTK_THREAD_RETURN_VALUE;
+}
+
+//----------------------------------------------------------------------------
+VTK_THREAD_RETURN_TYPE vtkImageStash::vtkInternal::UnstashThread(void *arg)
+{
+  vtkMultiThreader::ThreadInfo *info = static_cast<vtkMultiThreader::ThreadInfo*>(arg);
+  ThreadStruct *str = static_cast<ThreadStruct*>(info->UserData);
+  vtkInternal *self = str->Self;
+  const vtkIdType numberOfChunks = static_cast<vtkIdType>(self->Chunks.size());
+  for (vtkIdType chunk = info->ThreadID; chunk < numberOfChunks; chunk += info->NumberOfThreads)
+    {
+    if (str->Reference &&
+        IsSameChunk(self->Chunks[chunk], str->Reference->Chunks[chunk]))
+      {
+      continue;
+      }
+    DecodeChunk(self->Chunks[chunk], self->TupleSize,
+                str->Data + chunk * self->ChunkSize, self->GetChunkLength(chunk));
+    }
+  return VTK_THREAD_RETURN_VALUE;
+}
+
+//----------------------------------------------------------------------------
+void vtkImageStash::vtkInternal::RunThreads(vtkThreadFunctionType function, ThreadStruct *str)
+{
+  // A local threader: the MultiThreader of the stash may be the one
+  // running this stash in the background
+  vtkSmartPointer<vtkMultiThreader> threader = vtkSmartPointer<vtkMultiThreader>::New();
+  threader->SetNumberOfThreads(std::max(1, std::min(
+    threader->GetNumberOfThreads(), static_cast<int>(this->Chunks.size()))));
+  threader->SetSingleMethod(function, str);
+  threader->SingleMethodExecute();
+}
+
 //----------------------------------------------------------------------------
 vtkImageStash::vtkImageStash()
 {
@@ -30,6 +234,11 @@ vtkImageStash::vtkImageStash()
   this->CompressionLevel = 1; // corresponds to Z_BEST_SPEED
   this->Stashing = 0;
   this->StashingThreadID = 0;
+  this->Chunked = 0;
+  this->NumberOfSlicesPerChunk = 8;
+  this->ReferenceStash = NULL;
+  this->NumberOfSharedChunks = 0;
+  this->Internal = new vtkInternal;
 }
 
 //----------------------------------------------------------------------------
@@ -56,6 +265,11 @@ vtkImageStash::~vtkImageStash()
     {
     this->Compressor->Delete();
     }
+  if (this->ReferenceStash)
+    {
+    this->ReferenceStash->Delete();
+    }
+  delete this->Internal;
 }
 
 //----------------------------------------------------------------------------
@@ -104,6 +318,15 @@ void vtkImageStash::Stash()
   vtkIdType scalarSize = size * numPrims;
 
   unsigned char *p = static_cast<unsigned char *>(scalars->WriteVoidPointer(0, numPrims));
+  if (this->Chunked)
+    {
+    this->StashChunks(p, scalarSize, size * scalars->GetNumberOfComponents());
+    scalars->SetNumberOfTuples(0);
+    scalars->Squeeze();
+    // nothing is shared yet when stashing in a thread
+    this->ShareChunks();
+    return;
+    }
   this->GetCompressor()->SetCompressionLevel(this->GetCompressionLevel());
   vtkUnsignedCharArray* compressedBuffer=this->GetCompressor()->Compress(p, scalarSize); // returns a new buffer that has to be deleted
   // The compressor allocates space that has the size of an uncompressed volume
@@ -145,7 +368,7 @@ void vtkImageStash::Unstash()
     return;
     }
 
-  if (!this->StashedScalars)
+  if (!this->StashedScalars && !this->Chunked)
     {
     vtkErrorMacro ("Cannot unstash - nothing in the stash");
     return;
@@ -161,6 +384,17 @@ void vtkImageStash::Unstash()
   // setting the number of tuples reallocates the right amount of data
   // so we can uncompress directly into the buffer
   scalars->SetNumberOfTuples(this->GetNumberOfTuples());
+  if (this->Chunked)
+    {
+    if (scalarSize != this->Internal->DataSize)
+      {
+      vtkErrorMacro ("Cannot unstash - the stash does not match the image scalars");
+      return;
+      }
+    this->ShareChunks();
+    this->UnstashChunks(static_cast<unsigned char *>(scalars->WriteVoidPointer(0, numPrims)), NULL);
+    return;
+    }
   vtkIdType stashedSize = this->StashedScalars->GetNumberOfTuples();
   unsigned char *scalar_p = 
       static_cast<unsigned char *>(scalars->WriteVoidPointer(0, numPrims));
@@ -169,6 +403,140 @@ void vtkImageStash::Unstash()
   this->GetCompressor()->Uncompress(stash_p, stashedSize, scalar_p, scalarSize);
 }
 
+//----------------------------------------------------------------------------
+void vtkImageStash::StashChunks(unsigned char *data, vtkIdType dataSize, int tupleSize)
+{
+  vtkInternal *internal = this->Internal;
+  int *dimensions = this->StashImage->GetDimensions();
+  internal->TupleSize = tupleSize;
+  internal->DataSize = dataSize;
+  internal->ChunkSize = static_cast<vtkIdType>(dimensions[0]) * dimensions[1] *
+                        this->NumberOfSlicesPerChunk * tupleSize;
+  if (internal->ChunkSize <= 0)
+    {
+    internal->ChunkSize = std::max(dataSize, static_cast<vtkIdType>(1));
+    }
+  internal->Chunks.clear();
+  internal->Chunks.resize((dataSize + internal->ChunkSize - 1) / internal->ChunkSize);
+
+  // This may run in the stashing thread: the reference stash is not
+  // accessed here, the chunks are shared later by ShareChunks.
+  vtkInternal::ThreadStruct str;
+  str.Self = internal;
+  str.Reference = NULL;
+  str.Data = data;
+  str.Encoded.resize(internal->Chunks.size());
+  internal->RunThreads(vtkInternal::StashThread, &str);
+
+  this->NumberOfSharedChunks = 0;
+  for (size_t chunk = 0; chunk < internal->Chunks.size(); ++chunk)
+    {
+    internal->Chunks[chunk] = vtkSmartPointer<vtkUnsignedCharArray>::New();
+    internal->Chunks[chunk]->SetNumberOfTuples(str.Encoded[chunk].size());
+    memcpy(internal->Chunks[chunk]->GetPointer(0), &str.Encoded[chunk][0],
+           str.Encoded[chunk].size());
+    }
+}
+
+//----------------------------------------------------------------------------
+void vtkImageStash::ShareChunks()
+{
+  if (!this->ReferenceStash || this->Stashing)
+    {
+    return;
+    }
+  if (this->ReferenceStash == this)
+    {
+    this->SetReferenceStash(NULL);
+    return;
+    }
+  // the reference may itself have chunks to share
+  this->ReferenceStash->ShareChunks();
+  if (this->ReferenceStash->GetStashing())
+    {
+    return;
+    }
+  vtkInternal *internal = this->Internal;
+  vtkInternal *reference = this->ReferenceStash->Internal;
+  if (this->Chunked && this->ReferenceStash->GetChunked() &&
+      internal->HasSameLayout(reference))
+    {
+    this->NumberOfSharedChunks = 0;
+    for (size_t chunk = 0; chunk < internal->Chunks.size(); ++chunk)
+      {
+      if (vtkInternal::IsSameChunk(internal->Chunks[chunk], reference->Chunks[chunk]))
+        {
+        internal->Chunks[chunk] = reference->Chunks[chunk];
+        ++this->NumberOfSharedChunks;
+        }
+      }
+    }
+  // the chunks are shared, there is no need to keep the reference alive
+  this->SetReferenceStash(NULL);
+}
+
+//----------------------------------------------------------------------------
+void vtkImageStash::UnstashChunks(unsigned char *data, vtkImageStash *imageStash)
+{
+  vtkInternal::ThreadStruct str;
+  str.Self = this->Internal;
+  str.Reference = NULL;
+  str.Data = data;
+  if (imageStash && imageStash != this && imageStash->GetChunked() &&
+      this->Internal->HasSameLayout(imageStash->Internal))
+    {
+    str.Reference = imageStash->Internal;
+    }
+  this->Internal->RunThreads(vtkInternal::UnstashThread, &str);
+}
+
+//----------------------------------------------------------------------------
+int vtkImageStash::UnstashInto(vtkImageData *image, vtkImageStash *imageStash)
+{
+  if (!this->Chunked || !this->StashImage || !image)
+    {
+    return 0;
+    }
+  if (this->GetStashing() || (imageStash && imageStash->GetStashing()))
+    {
+    vtkErrorMacro ("Cannot unstash - stashing is still underway in a thread");
+    return 0;
+    }
+  vtkDataArray *scalars = image->GetPointData()->GetScalars();
+  vtkDataArray *stashScalars = this->StashImage->GetPointData()->GetScalars();
+  int *dimensions = image->GetDimensions();
+  int *stashDimensions = this->StashImage->GetDimensions();
+  if (!scalars || !stashScalars ||
+      dimensions[0] != stashDimensions[0] ||
+      dimensions[1] != stashDimensions[1] ||
+      dimensions[2] != stashDimensions[2] ||
+      scalars->GetDataType() != stashScalars->GetDataType() ||
+      scalars->GetNumberOfComponents() != stashScalars->GetNumberOfComponents() ||
+      scalars->GetNumberOfTuples() != this->GetNumberOfTuples())
+    {
+    return 0;
+    }
+  vtkIdType numPrims = this->GetNumberOfTuples() * scalars->GetNumberOfComponents();
+  if (vtkDataArray::GetDataTypeSize(scalars->GetDataType()) * numPrims != this->Internal->DataSize)
+    {
+    return 0;
+    }
+  // the shared chunks are not decompressed
+  this->ShareChunks();
+  if (imageStash)
+    {
+    imageStash->ShareChunks();
+    }
+  this->UnstashChunks(static_cast<unsigned char *>(scalars->WriteVoidPointer(0, numPrims)), imageStash);
+  return 1;
+}
+
+//----------------------------------------------------------------------------
+int vtkImageStash::GetNumberOfChunks()
+{
+  return static_cast<int>(this->Internal->Chunks.size());
+}
+
 //----------------------------------------------------------------------------
 void vtkImageStash::PrintSelf(ostream& os, vtkIndent indent)
 {
@@ -179,6 +547,11 @@ void vtkImageStash::PrintSelf(ostream& os, vtkIndent indent)
   os << indent << "Stashed Scalars: " << this->GetStashedScalars() << "\n";
   if ( this->GetStashedScalars()) this->GetStashedScalars()->PrintSelf(os,indent.GetNextIndent());
   os << indent << "CompressionLevel: " << this->GetCompressionLevel() << "\n";
+  os << indent << "Chunked: " << this->GetChunked() << "\n";
+  os << indent << "NumberOfSlicesPerChunk: " << this->GetNumberOfSlicesPerChunk() << "\n";
+  os << indent << "NumberOfChunks: " << this->GetNumberOfChunks() << "\n";
+  os << indent << "NumberOfSharedChunks: " << this->GetNumberOfSharedChunks() << "\n";
+  os << indent << "ReferenceStash: " << this->GetReferenceStash() << "\n";
   os << indent << "Compressor: \n";
   this->GetCompressor()->PrintSelf(os,indent.GetNextIndent());
 }
@@ -14,6 +14,13 @@
 =========================================================================*/
 ///  vtkImageStash - 
 ///  Store an image data in a compressed form to save memory
+///
+///  By default the scalars are compressed with zlib in one buffer.
+///  When Chunked is on, the scalars are split in slabs of
+///  NumberOfSlicesPerChunk slices that are run length encoded in
+///  parallel; the chunks identical to the chunks of the ReferenceStash
+///  are shared instead of stored again, and UnstashInto only
+///  decompresses the chunks that differ from the image being restored.
 
 #ifndef __vtkImageStash_h
 #define __vtkImageStash_h
@@ -81,6 +88,50 @@ public:
   vtkSetObjectMacro(Compressor, vtkZLibDataCompressor);
   vtkGetObjectMacro(Compressor, vtkZLibDataCompressor);
 
+  /// 
+  /// Compress the scalars in independent chunks (off by default)
+  vtkSetMacro(Chunked, int);
+  vtkGetMacro(Chunked, int);
+  vtkBooleanMacro(Chunked, int);
+
+  /// 
+  /// Number of slices in each chunk, 8 by default
+  vtkSetClampMacro(NumberOfSlicesPerChunk, int, 1, VTK_INT_MAX);
+  vtkGetMacro(NumberOfSlicesPerChunk, int);
+
+  /// 
+  /// A previous stash of an image of the same size (typically the
+  /// previous undo step): the chunks with the same data are shared
+  /// with it by ShareChunks, which then releases it.
+  vtkSetObjectMacro(ReferenceStash, vtkImageStash);
+  vtkGetObjectMacro(ReferenceStash, vtkImageStash);
+
+  /// 
+  /// Share the chunks identical to the chunks of the ReferenceStash and
+  /// release the reference. Stash calls it, but ThreadedStash leaves it
+  /// to the thread that owns the stashes: call it once GetStashing()
+  /// returns 0 so that the reference counts of the stashes and chunks are
+  /// only changed by that thread. It does nothing while this stash or
+  /// the reference are stashing. Unstash and UnstashInto call it.
+  void ShareChunks();
+
+  /// 
+  /// Number of chunks of the chunked stash
+  int GetNumberOfChunks();
+
+  /// 
+  /// Number of chunks shared with the reference stash by ShareChunks
+  vtkGetMacro(NumberOfSharedChunks, int);
+
+  /// 
+  /// decompress the chunked stash into image, whose scalars were stashed
+  /// by imageStash and have not been modified since: only the chunks
+  /// that differ are decompressed. imageStash can be NULL to decompress
+  /// all the chunks. The stash image is left stashed.
+  /// Return 0 if the stash is not chunked or image does not have the
+  /// dimensions and scalars of the stash image.
+  int UnstashInto(vtkImageData *image, vtkImageStash *imageStash);
+
   // Description:
   // Check if compression thread is finished
   vtkSetMacro(Stashing, int);
@@ -97,6 +148,16 @@ protected:
   vtkZLibDataCompressor *Compressor;
   int CompressionLevel;
   int Stashing;
+  int Chunked;
+  int NumberOfSlicesPerChunk;
+  vtkImageStash *ReferenceStash;
+  int NumberOfSharedChunks;
+
+  void StashChunks(unsigned char *data, vtkIdType dataSize, int tupleSize);
+  void UnstashChunks(unsigned char *data, vtkImageStash *imageStash);
+
+  class vtkInternal;
+  vtkInternal* Internal;
 
 private:
   int StashingThreadID;
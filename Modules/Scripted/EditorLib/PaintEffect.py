@@ -325,8 +325,8 @@ class PaintEffectTool(LabelEffect.LabelEffectTool):
   def getLabelPixel(self,xy):
     sliceLogic = self.sliceWidget.sliceLogic()
     labelLogic = sliceLogic.GetLabelLayer()
-    xyToIJK = labelLogic.GetXYToIJKTransform().GetMatrix()
-    i,j,k,l = xyToIJK.MultiplyPoint( xy + (0, 1) )
+    xyToIJK = labelLogic.GetXYToIJKResliceTransform()
+    i,j,k = xyToIJK.TransformPoint( xy + (0,) )
     i = int(round(i))
     j = int(round(j))
     k = int(round(k))
@@ -520,8 +520,8 @@ class PaintEffectTool(LabelEffect.LabelEffectTool):
       # if there's no label, we can't paint
       return
 
-    xyToIJK = labelLogic.GetXYToIJKTransform().GetMatrix()
-    ijkFloat = xyToIJK.MultiplyPoint( (x, y, 0, 1) )
+    xyToIJK = labelLogic.GetXYToIJKResliceTransform()
+    ijkFloat = xyToIJK.TransformPoint( (x, y, 0) )
     ijk = []
     for e in ijkFloat:
       try:
@@ -572,6 +572,8 @@ class PaintEffectTool(LabelEffect.LabelEffectTool):
     bottom = y + bounds[2]
     top = y + bounds[3]
 
+    # the brush corners only map the slice linearly, even when the label
+    # volume is under a nonlinear transform
     xyToIJK = labelLogic.GetXYToIJKTransform().GetMatrix()
     tlIJK = xyToIJK.MultiplyPoint( (left, top, 0, 1) )
     trIJK = xyToIJK.MultiplyPoint( (right, top, 0, 1) )
@@ -137,8 +137,8 @@ class SaveIslandEffectLogic(IslandEffect.IslandEffectLogic):
     # change the label values based on the parameter node
     #
     labelLogic = self.sliceLogic.GetLabelLayer()
-    xyToIJK = labelLogic.GetXYToIJKTransform().GetMatrix()
-    ijk = xyToIJK.MultiplyPoint( xy + (0, 1) )[:3]
+    xyToIJK = labelLogic.GetXYToIJKResliceTransform()
+    ijk = xyToIJK.TransformPoint( xy + (0,) )
     ijk = map(lambda v: int(round(v)), ijk)
 
     connectivity = slicer.vtkImageConnectivity()
@@ -0,0 +1,106 @@
+import unittest
+import vtk, slicer
+import vtk.util.numpy_support
+import numpy
+
+class ImageStashTest(unittest.TestCase):
+  """Test the chunked stash used by the Editor undo/redo
+  """
+  def setUp(self):
+    pass
+
+  def runTest(self):
+    self.test_ChunkedRoundTrip()
+    self.test_RawFallback()
+    self.test_SharedChunks()
+
+  def createImage(self, scalars):
+    """An image of 32x24x40 short voxels with the given numpy scalars
+    (indexed k, j, i)"""
+    image = vtk.vtkImageData()
+    image.SetDimensions(32, 24, 40)
+    image.SetScalarTypeToShort()
+    image.SetNumberOfScalarComponents(1)
+    image.AllocateScalars()
+    self.array(image)[:] = scalars
+    return image
+
+  def array(self, image):
+    return vtk.util.numpy_support.vtk_to_numpy(
+      image.GetPointData().GetScalars()).reshape(40, 24, 32)
+
+  def labelMap(self):
+    """Two labels in a box and a ball"""
+    k, j, i = numpy.mgrid[0:40, 0:24, 0:32]
+    scalars = numpy.zeros((40, 24, 32), dtype=numpy.int16)
+    scalars[4:30, 2:10, 3:20] = 1
+    scalars[(i - 20)**2 + (j - 12)**2 + (k - 25)**2 < 64] = 2
+    return scalars
+
+  def stash(self, image, reference=None, threaded=False):
+    """Stash a copy of image in 5 chunks of 8 slices"""
+    stashImage = vtk.vtkImageData()
+    stashImage.DeepCopy(image)
+    stash = slicer.vtkImageStash()
+    stash.SetStashImage(stashImage)
+    stash.ChunkedOn()
+    stash.SetNumberOfSlicesPerChunk(8)
+    if reference:
+      stash.SetReferenceStash(reference)
+    if threaded:
+      stash.ThreadedStash()
+      while stash.GetStashing():
+        pass
+    else:
+      stash.Stash()
+    self.assertEqual(stash.GetNumberOfChunks(), 5)
+    self.assertEqual(stashImage.GetPointData().GetScalars().GetNumberOfTuples(), 0)
+    return stash
+
+  def test_ChunkedRoundTrip(self):
+    """The label map is restored as it was"""
+    scalars = self.labelMap()
+    stash = self.stash(self.createImage(scalars))
+    stash.Unstash()
+    self.assertTrue((self.array(stash.GetStashImage()) == scalars).all())
+
+  def test_RawFallback(self):
+    """Noise is stored as is, and restored as it was"""
+    numpy.random.seed(0)
+    scalars = numpy.random.randint(-1000, 1000, (40, 24, 32)).astype(numpy.int16)
+    # and the first chunk is run length encoded
+    scalars[0:8] = 7
+    stash = self.stash(self.createImage(scalars))
+    stash.Unstash()
+    self.assertTrue((self.array(stash.GetStashImage()) == scalars).all())
+
+  def test_SharedChunks(self):
+    """The chunks of the slabs that are not edited are shared with the
+    reference stash, and only the edited slabs are restored"""
+    scalars = self.labelMap()
+    image = self.createImage(scalars)
+    before = self.stash(image)
+
+    # edit the third slab only
+    editedScalars = scalars.copy()
+    editedScalars[18:22, 5:15, 5:15] = 3
+    self.array(image)[:] = editedScalars
+    after = self.stash(image, before, threaded=True)
+    # the stashing thread does not share the chunks
+    self.assertEqual(after.GetReferenceStash(), before)
+    after.ShareChunks()
+    self.assertEqual(after.GetNumberOfSharedChunks(), 4)
+    self.assertEqual(after.GetReferenceStash(), None)
+
+    # undo: the image holds the data of the "after" stash, the chunks of
+    # "before" that differ are restored into it. Mark the first slab to
+    # check that the shared chunks are not restored.
+    self.array(image)[0, 0, 0] = 5
+    self.assertTrue(before.UnstashInto(image, after))
+    expected = scalars.copy()
+    expected[0, 0, 0] = 5
+    self.assertTrue((self.array(image) == expected).all())
+
+    # the stash image is left stashed, and can still be unstashed
+    before.Unstash()
+    self.assertTrue((self.array(before.GetStashImage()) == scalars).all())